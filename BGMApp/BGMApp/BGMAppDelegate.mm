@@ -30,6 +30,7 @@
 #import "BGMAppVolumesController.h"
 #import "BGMAutoPauseMusic.h"
 #import "BGMAutoPauseMenuItem.h"
+#import "BGMBackgroundMusicDevice.h"
 #import "BGMDebugLoggingMenuItem.h"
 #import "BGMMusicPlayers.h"
 #import "BGMOutputDeviceMenuSection.h"
@@ -96,6 +97,12 @@ static NSString* const kOptShowDockIcon      = @"--show-dock-icon";
     // Stored user settings
     userDefaults = [self createUserDefaults];
 
+    [audioDevices setGainStagingEnabled:userDefaults.appVolumeGainStaging];
+    [audioDevices setPlayThroughLowLatency:userDefaults.playThroughLowLatency];
+    [audioDevices setPlayThroughTargetLatencyMs:userDefaults.playThroughTargetLatencyMS];
+    [audioDevices setPlayThroughOutputLookahead:userDefaults.playThroughOutputLookahead];
+    [audioDevices setPlayThroughImpulseResponsePath:userDefaults.playThroughImpulseResponsePath];
+
     // Add the status bar item. (The thing you click to show BGMApp's main menu.)
     statusBarItem = [[BGMStatusBarItem alloc] initWithMenu:self.bgmMenu
                                               audioDevices:audioDevices
@@ -372,6 +379,12 @@ static NSString* const kOptShowDockIcon      = @"--show-dock-icon";
     
     DebugMsg("BGMAppDelegate::applicationWillTerminate");
 
+    // Send any app volume changes that are still waiting to be sent, e.g. if the user quit right
+    // after moving a volume slider.
+    BGMLogAndSwallowExceptions("BGMAppDelegate::applicationWillTerminate", [] {
+        BGMBackgroundMusicDevice::FlushAppVolumeChanges();
+    });
+
     // Change the user's default output device back.
     NSError* error = [audioDevices unsetBGMDeviceAsOSDefault];
     
@@ -171,7 +171,7 @@
 forAppWithProcessID:(pid_t)processID
            bundleID:(NSString* __nullable)bundleID {
     // Update the app's volume.
-    audioDevices.bgmDevice.SetAppVolume(volume, processID, (__bridge_retained CFStringRef)bundleID);
+    [audioDevices setAppVolume:volume forAppWithProcessID:processID bundleID:bundleID];
 
     // If this volume is for FaceTime, set the volume for the avconferenced process as well. This
     // works around FaceTime not playing its own audio. It plays UI sounds through
@@ -198,7 +198,7 @@ forAppWithProcessID:(pid_t)processID
         if (proc_pidpath(pid, path, sizeof(path)) > 0 &&
             strncmp(path, "/usr/libexec/avconferenced", sizeof(path)) == 0) {
             DebugMsg("Setting avconferenced volume: %d", volume);
-            audioDevices.bgmDevice.SetAppVolume(volume, pid, nullptr);
+            [audioDevices setAppVolume:volume forAppWithProcessID:pid bundleID:nil];
             return;
         }
     }
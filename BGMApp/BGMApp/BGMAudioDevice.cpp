@@ -17,7 +17,7 @@
 //  BGMAudioDevice.cpp
 //  BGMApp
 //
-//  Copyright © 2017 Kyle Neideck
+//  Copyright © 2017, 2026 Kyle Neideck
 //
 
 // Self Include
@@ -25,6 +25,7 @@
 
 // Local Includes
 #include "BGM_Types.h"
+#include "BGMAudioDevicePropertyCache.h"
 
 // System Includes
 #include <AudioToolbox/AudioServices.h>
@@ -72,6 +73,88 @@ bool    BGMAudioDevice::CanBeOutputDeviceInBGMApp() const
             canBeDefault;
 }
 
+#pragma mark Cached Properties
+
+CFStringRef BGMAudioDevice::CopyDeviceUID() const
+{
+    return BGMAudioDevicePropertyCache::CopyString(GetObjectID(),
+                                                   BGMAudioDevicePropertyCache::kProperty_UID,
+                                                   [&] {
+                                                       return CAHALAudioDevice::CopyDeviceUID();
+                                                   });
+}
+
+CFStringRef BGMAudioDevice::CopyName() const
+{
+    return BGMAudioDevicePropertyCache::CopyString(GetObjectID(),
+                                                   BGMAudioDevicePropertyCache::kProperty_Name,
+                                                   [&] {
+                                                       return CAHALAudioDevice::CopyName();
+                                                   });
+}
+
+UInt32  BGMAudioDevice::GetTransportType() const
+{
+    return BGMAudioDevicePropertyCache::GetUInt32(
+            GetObjectID(),
+            BGMAudioDevicePropertyCache::kProperty_TransportType,
+            [&] { return CAHALAudioDevice::GetTransportType(); });
+}
+
+UInt32  BGMAudioDevice::GetIOBufferSize() const
+{
+    return BGMAudioDevicePropertyCache::GetUInt32(
+            GetObjectID(),
+            BGMAudioDevicePropertyCache::kProperty_IOBufferSize,
+            [&] { return CAHALAudioDevice::GetIOBufferSize(); });
+}
+
+void    BGMAudioDevice::SetIOBufferSize(UInt32 inBufferSize)
+{
+    CAHALAudioDevice::SetIOBufferSize(inBufferSize);
+    BGMAudioDevicePropertyCache::Invalidate(GetObjectID(),
+                                            BGMAudioDevicePropertyCache::kProperty_IOBufferSize);
+}
+
+UInt32  BGMAudioDevice::GetTotalNumberChannels(bool inIsInput) const
+{
+    return BGMAudioDevicePropertyCache::GetUInt32(
+            GetObjectID(),
+            inIsInput ? BGMAudioDevicePropertyCache::kProperty_InputChannels :
+                    BGMAudioDevicePropertyCache::kProperty_OutputChannels,
+            [&] { return CAHALAudioDevice::GetTotalNumberChannels(inIsInput); });
+}
+
+bool    BGMAudioDevice::IsHidden() const
+{
+    return BGMAudioDevicePropertyCache::GetUInt32(
+            GetObjectID(),
+            BGMAudioDevicePropertyCache::kProperty_IsHidden,
+            [&] { return CAHALAudioDevice::IsHidden() ? 1u : 0u; }) != 0;
+}
+
+bool    BGMAudioDevice::CanBeDefaultDevice(bool inIsInput, bool inIsSystem) const
+{
+    BGMAudioDevicePropertyCache::Property property;
+
+    if(inIsSystem)
+    {
+        property = inIsInput ?
+                BGMAudioDevicePropertyCache::kProperty_CanBeDefaultSystemInputDevice :
+                BGMAudioDevicePropertyCache::kProperty_CanBeDefaultSystemOutputDevice;
+    }
+    else
+    {
+        property = inIsInput ?
+                BGMAudioDevicePropertyCache::kProperty_CanBeDefaultInputDevice :
+                BGMAudioDevicePropertyCache::kProperty_CanBeDefaultOutputDevice;
+    }
+
+    return BGMAudioDevicePropertyCache::GetUInt32(GetObjectID(), property, [&] {
+        return CAHALAudioDevice::CanBeDefaultDevice(inIsInput, inIsSystem) ? 1u : 0u;
+    }) != 0;
+}
+
 #pragma mark Available Controls
 
 bool    BGMAudioDevice::HasSettableMasterVolume(AudioObjectPropertyScope inScope) const
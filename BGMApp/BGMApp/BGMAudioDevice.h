@@ -16,10 +16,13 @@
 //  BGMAudioDevice.h
 //  BGMApp
 //
-//  Copyright © 2017, 2020 Kyle Neideck
+//  Copyright © 2017, 2020, 2026 Kyle Neideck
 //
 //  A HAL audio device. Note that this class's only state is the AudioObjectID of the device.
 //
+//  Some of the properties BGMApp reads most often are cached, which is shared by all instances for
+//  the same device. See BGMAudioDevicePropertyCache.
+//
 
 #ifndef BGMApp__BGMAudioDevice
 #define BGMApp__BGMAudioDevice
@@ -78,6 +81,21 @@ public:
      */
     bool               CanBeOutputDeviceInBGMApp() const;
 
+#pragma mark Cached Properties
+
+    // These hide the CAHALAudioDevice functions with the same names, so they're used whenever the
+    // device is a BGMAudioDevice. They throw whatever the CAHALAudioDevice functions throw.
+
+    CFStringRef        CopyDeviceUID() const;
+    CFStringRef        CopyName() const;
+    UInt32             GetTransportType() const;
+    UInt32             GetIOBufferSize() const;
+    /*! Also removes the cached IO buffer size, so the new size is returned immediately. */
+    void               SetIOBufferSize(UInt32 inBufferSize);
+    UInt32             GetTotalNumberChannels(bool inIsInput) const;
+    bool               IsHidden() const;
+    bool               CanBeDefaultDevice(bool inIsInput, bool inIsSystem) const;
+
 #pragma mark Available Controls
 
     bool               HasSettableMasterVolume(AudioObjectPropertyScope inScope) const;
@@ -101,6 +101,36 @@ static const int kBGMErrorCode_ReturningEarly       = 2;
 // code received from the HAL.
 - (OSStatus) startPlayThroughSync:(BOOL)forUISoundsDevice;
 
+// Set an app's volume. If gain staging is enabled, the other apps' volumes might be updated as well.
+// See BGMBackgroundMusicDevice::SetAppVolume and BGMDeviceControlSync::SetAppVolume.
+- (void) setAppVolume:(SInt32)volume
+  forAppWithProcessID:(pid_t)processID
+             bundleID:(NSString* __nullable)bundleID;
+
+// Enable or disable raising the output device's volume to absorb boosted app volumes, rather than
+// boosting the apps in BGMDriver. Disabled by default. See BGMGainStaging.
+- (void) setGainStagingEnabled:(BOOL)enabled;
+
+// Set how much latency playthrough adds. Low latency keeps about one IO buffer of audio queued
+// instead of three, which can cause audible glitches if BGMApp's IOProcs are delayed. A non-zero
+// target latency, in milliseconds, overrides the preset. See BGMPlayThrough::SetLatencyPreset and
+// BGMPlayThrough::SetTargetLatencyMs.
+- (void) setPlayThroughLowLatency:(BOOL)lowLatency;
+- (void) setPlayThroughTargetLatencyMs:(Float64)targetLatencyMs;
+
+// Render playthrough's output lookaheadBuffers IO buffers ahead on a separate real-time thread, or
+// in the output IOProc if it's 0. See BGMPlayThrough::SetOutputPipelineLookahead.
+- (void) setPlayThroughOutputLookahead:(NSUInteger)lookaheadBuffers;
+
+// The latency playthrough is currently adding, in milliseconds, or 0 if playthrough isn't running.
+- (Float64) playThroughLatencyMs;
+
+// Convolve playthrough's output with the impulse response in the audio file at path, or stop
+// convolving it if path is nil. The file is read at the output device's sample rate, and read again
+// whenever the output device changes. Errors reading the file are logged and leave the output
+// unprocessed. See BGMPlayThrough::SetImpulseResponse.
+- (void) setPlayThroughImpulseResponsePath:(NSString* __nullable)path;
+
 // When the output device is changed, BGMAudioDeviceManager will send the ID of the new output
 // device to BGMXPCHelper through this connection.
 - (void) setBGMXPCHelperConnection:(NSXPCConnection* __nullable)connection;
@@ -38,6 +38,12 @@
 #import "CAAutoDisposer.h"
 #import "CAHALAudioSystemObject.h"
 
+// STL Includes
+#import <vector>
+
+// System Includes
+#import <AudioToolbox/ExtendedAudioFile.h>
+
 
 #pragma clang assume_nonnull begin
 
@@ -63,6 +69,10 @@
     BGMOutputVolumeMenuItem* __nullable outputVolumeMenuItem;
     BGMOutputDeviceMenuSection* __nullable outputDeviceMenuSection;
 
+    // The impulse response file to convolve playthrough's output with, or nil. Read again whenever
+    // the output device changes, since it's converted to the device's sample rate.
+    NSString* __nullable impulseResponsePath;
+
     NSRecursiveLock* stateLock;
 }
 
@@ -74,6 +84,7 @@
         bgmXPCHelperConnection = nil;
         outputVolumeMenuItem = nil;
         outputDeviceMenuSection = nil;
+        impulseResponsePath = nil;
         outputDevice = kAudioObjectUnknown;
 
         try {
@@ -261,6 +272,9 @@
         BGMAudioDevice newOutputDevice(newDeviceID);
         [self setOutputDeviceForPlaythroughAndControlSync:newOutputDevice];
         outputDevice = newOutputDevice;
+
+        // The new device might have a different sample rate.
+        [self loadImpulseResponse];
     }
 
     // Set the output device to use the new data source.
@@ -291,6 +305,8 @@
 // Changes the output device that playthrough plays audio to and that BGMDevice's controls are
 // kept in sync with. Throws CAException.
 - (void) setOutputDeviceForPlaythroughAndControlSync:(const BGMAudioDevice&)newOutputDevice {
+    [self logOutputPipelineStats];
+
     // Deactivate playthrough rather than stopping it so it can't be started by HAL notifications
     // while we're updating deviceControlSync.
     playThrough.Deactivate();
@@ -435,6 +451,238 @@
     return err;
 }
 
+#pragma mark App Volumes
+
+- (void) setAppVolume:(SInt32)volume
+  forAppWithProcessID:(pid_t)processID
+             bundleID:(NSString* __nullable)bundleID {
+    // deviceControlSync is thread safe, so we don't need to hold stateLock.
+    BGMLogAndSwallowExceptions("BGMAudioDeviceManager::setAppVolume", ([&] {
+        deviceControlSync.SetAppVolume(volume, processID, (__bridge CFStringRef)bundleID);
+    }));
+}
+
+- (void) setGainStagingEnabled:(BOOL)enabled {
+    BGMLogAndSwallowExceptions("BGMAudioDeviceManager::setGainStagingEnabled", ([&] {
+        deviceControlSync.SetGainStagingEnabled(enabled);
+    }));
+}
+
+#pragma mark Playthrough Latency
+
+- (void) setPlayThroughLowLatency:(BOOL)lowLatency {
+    BGMPlayThrough::LatencyPreset preset =
+            (lowLatency ? BGMPlayThrough::LatencyPreset::LowLatency
+                        : BGMPlayThrough::LatencyPreset::Safe);
+
+    @try {
+        [stateLock lock];
+
+        BGMLogAndSwallowExceptions("BGMAudioDeviceManager::setPlayThroughLowLatency", ([&] {
+            playThrough.SetLatencyPreset(preset);
+            playThrough_UISounds.SetLatencyPreset(preset);
+        }));
+    } @finally {
+        [stateLock unlock];
+    }
+}
+
+- (void) setPlayThroughTargetLatencyMs:(Float64)targetLatencyMs {
+    @try {
+        [stateLock lock];
+
+        BGMLogAndSwallowExceptions("BGMAudioDeviceManager::setPlayThroughTargetLatencyMs", ([&] {
+            playThrough.SetTargetLatencyMs(targetLatencyMs);
+            playThrough_UISounds.SetTargetLatencyMs(targetLatencyMs);
+        }));
+    } @finally {
+        [stateLock unlock];
+    }
+}
+
+- (void) setPlayThroughOutputLookahead:(NSUInteger)lookaheadBuffers {
+    @try {
+        [stateLock lock];
+
+        BGMLogAndSwallowExceptions("BGMAudioDeviceManager::setPlayThroughOutputLookahead", ([&] {
+            playThrough.SetOutputPipelineLookahead(static_cast<UInt32>(lookaheadBuffers));
+            playThrough_UISounds.SetOutputPipelineLookahead(static_cast<UInt32>(lookaheadBuffers));
+        }));
+    } @finally {
+        [stateLock unlock];
+    }
+}
+
+// Logs how well playthrough's output pipeline has kept up since it was last started, if it's
+// enabled. Called before changing the output device, which restarts the pipeline and resets its
+// stats. stateLock must be held.
+- (void) logOutputPipelineStats {
+    BGMLogAndSwallowExceptions("BGMAudioDeviceManager::logOutputPipelineStats", ([&] {
+        if (playThrough.GetOutputPipelineLatencyFrames() == 0) {
+            return;
+        }
+
+        BGMOutputPipeline::Stats stats = playThrough.GetOutputPipelineStats();
+
+        if (stats.mUnderruns > 0 || stats.mLateBuffers > 0 || stats.mDroppedBuffers > 0) {
+            LogWarning("BGMAudioDeviceManager::logOutputPipelineStats: The output pipeline "
+                       "couldn't keep up. cycles=%llu underruns=%llu late=%llu dropped=%llu "
+                       "budget=%lluns maxRender=%lluns maxTurnaround=%lluns",
+                       stats.mCycles,
+                       stats.mUnderruns,
+                       stats.mLateBuffers,
+                       stats.mDroppedBuffers,
+                       stats.mBudgetNs,
+                       stats.mMaxRenderNs,
+                       stats.mMaxTurnaroundNs);
+        } else {
+            DebugMsg("BGMAudioDeviceManager::logOutputPipelineStats: cycles=%llu budget=%lluns "
+                     "maxRender=%lluns maxTurnaround=%lluns",
+                     stats.mCycles,
+                     stats.mBudgetNs,
+                     stats.mMaxRenderNs,
+                     stats.mMaxTurnaroundNs);
+        }
+    }));
+}
+
+- (Float64) playThroughLatencyMs {
+    Float64 latencyMs = 0.0;
+
+    @try {
+        [stateLock lock];
+
+        BGMLogAndSwallowExceptions("BGMAudioDeviceManager::playThroughLatencyMs", ([&] {
+            UInt32 latencyFrames = playThrough.GetMeasuredLatencyFrames();
+
+            if (latencyFrames > 0) {
+                latencyMs = 1000.0 * latencyFrames / outputDevice.GetNominalSampleRate();
+            }
+        }));
+    } @finally {
+        [stateLock unlock];
+    }
+
+    return latencyMs;
+}
+
+#pragma mark Playthrough Convolution
+
+// Reads the audio file at path, converted to interleaved Float32 samples at sampleRate, and returns
+// its first BGMConvolver::kMaxImpulseResponseFrames frames. Throws CAException.
+static std::vector<Float32> ReadImpulseResponse(NSString* path,
+                                                Float64 sampleRate,
+                                                UInt32& outChannelCount) {
+    ExtAudioFileRef file = nullptr;
+    OSStatus err = ExtAudioFileOpenURL((__bridge CFURLRef)[NSURL fileURLWithPath:path], &file);
+    ThrowIfError(err, CAException(err), "ReadImpulseResponse: Couldn't open the file");
+
+    std::vector<Float32> samples;
+
+    try {
+        AudioStreamBasicDescription fileFormat {};
+        UInt32 size = sizeof(fileFormat);
+        err = ExtAudioFileGetProperty(file, kExtAudioFileProperty_FileDataFormat, &size, &fileFormat);
+        ThrowIfError(err, CAException(err), "ReadImpulseResponse: Couldn't get the file's format");
+
+        const UInt32 channelCount = fileFormat.mChannelsPerFrame;
+        ThrowIf(channelCount == 0,
+                CAException(kAudioFileUnsupportedDataFormatError),
+                "ReadImpulseResponse: The file has no channels");
+
+        // ExtAudioFile converts the samples to the output device's sample rate as it reads them.
+        AudioStreamBasicDescription clientFormat {};
+        clientFormat.mSampleRate = sampleRate;
+        clientFormat.mFormatID = kAudioFormatLinearPCM;
+        clientFormat.mFormatFlags = kAudioFormatFlagsNativeFloatPacked;
+        clientFormat.mChannelsPerFrame = channelCount;
+        clientFormat.mBitsPerChannel = 8 * sizeof(Float32);
+        clientFormat.mBytesPerFrame = channelCount * sizeof(Float32);
+        clientFormat.mFramesPerPacket = 1;
+        clientFormat.mBytesPerPacket = clientFormat.mBytesPerFrame;
+
+        err = ExtAudioFileSetProperty(file,
+                                      kExtAudioFileProperty_ClientDataFormat,
+                                      sizeof(clientFormat),
+                                      &clientFormat);
+        ThrowIfError(err, CAException(err), "ReadImpulseResponse: Couldn't set the client format");
+
+        const UInt32 maxFrames = BGMConvolver::kMaxImpulseResponseFrames;
+        samples.resize(maxFrames * channelCount);
+        UInt32 framesRead = 0;
+
+        while (framesRead < maxFrames) {
+            UInt32 frames = maxFrames - framesRead;
+
+            AudioBufferList bufferList;
+            bufferList.mNumberBuffers = 1;
+            bufferList.mBuffers[0].mNumberChannels = channelCount;
+            bufferList.mBuffers[0].mDataByteSize = frames * clientFormat.mBytesPerFrame;
+            bufferList.mBuffers[0].mData = &samples[framesRead * channelCount];
+
+            err = ExtAudioFileRead(file, &frames, &bufferList);
+            ThrowIfError(err, CAException(err), "ReadImpulseResponse: Couldn't read the file");
+
+            if (frames == 0) {
+                break;  // End of file.
+            }
+
+            framesRead += frames;
+        }
+
+        ThrowIf(framesRead == 0,
+                CAException(kAudioFileInvalidFileError),
+                "ReadImpulseResponse: The file is empty");
+
+        samples.resize(framesRead * channelCount);
+        outChannelCount = channelCount;
+    } catch (...) {
+        ExtAudioFileDispose(file);
+        throw;
+    }
+
+    ExtAudioFileDispose(file);
+
+    return samples;
+}
+
+- (void) setPlayThroughImpulseResponsePath:(NSString* __nullable)path {
+    @try {
+        [stateLock lock];
+
+        impulseResponsePath = path;
+        [self loadImpulseResponse];
+    } @finally {
+        [stateLock unlock];
+    }
+}
+
+// Reads impulseResponsePath at the output device's sample rate and gives it to playthrough, or
+// clears playthrough's impulse response if there isn't one. stateLock must be held.
+- (void) loadImpulseResponse {
+    BGMLogAndSwallowExceptions("BGMAudioDeviceManager::loadImpulseResponse", ([&] {
+        // Clear it first so the output is left unprocessed if the file can't be read.
+        playThrough.ClearImpulseResponse();
+        playThrough_UISounds.ClearImpulseResponse();
+
+        if (!impulseResponsePath || outputDevice.GetObjectID() == kAudioObjectUnknown) {
+            return;
+        }
+
+        UInt32 channelCount;
+        std::vector<Float32> samples = ReadImpulseResponse(BGMNN(impulseResponsePath),
+                                                           outputDevice.GetNominalSampleRate(),
+                                                           channelCount);
+
+        DebugMsg("BGMAudioDeviceManager::loadImpulseResponse: Read %lu frames from %s",
+                 samples.size() / channelCount,
+                 impulseResponsePath.UTF8String);
+
+        playThrough.SetImpulseResponse(samples, channelCount);
+        playThrough_UISounds.SetImpulseResponse(std::move(samples), channelCount);
+    }));
+}
+
 #pragma mark BGMXPCHelper Communication
 
 - (void) setBGMXPCHelperConnection:(NSXPCConnection* __nullable)connection {
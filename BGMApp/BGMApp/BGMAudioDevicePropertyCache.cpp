@@ -0,0 +1,319 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGMAudioDevicePropertyCache.cpp
+//  BGMApp
+//
+//  Copyright © 2026 Kyle Neideck
+//
+
+// Self Include
+#include "BGMAudioDevicePropertyCache.h"
+
+// Local Includes
+#include "BGM_Utils.h"
+
+// PublicUtility Includes
+#include "CAHALAudioObject.h"
+#include "CAPropertyAddress.h"
+
+// STL Includes
+#include <vector>
+
+// System Includes
+#include <Block.h>
+
+
+#pragma clang assume_nonnull begin
+
+// The properties the cache listens to on each device and the cached values each one affects.
+// kAudioDevicePropertyDeviceHasChanged and kAudioDevicePropertyDeviceIsAlive are handled
+// separately.
+static const struct
+{
+    AudioObjectPropertySelector                 mSelector;
+    BGMAudioDevicePropertyCache::Property       mProperties[2];
+    UInt32                                      mNumberOfProperties;
+} kInvalidatingProperties[] = {
+    { kAudioObjectPropertyName,
+      { BGMAudioDevicePropertyCache::kProperty_Name }, 1 },
+    { kAudioDevicePropertyBufferFrameSize,
+      { BGMAudioDevicePropertyCache::kProperty_IOBufferSize }, 1 },
+    { kAudioDevicePropertyStreamConfiguration,
+      { BGMAudioDevicePropertyCache::kProperty_InputChannels,
+        BGMAudioDevicePropertyCache::kProperty_OutputChannels }, 2 },
+    { kAudioDevicePropertyIsHidden,
+      { BGMAudioDevicePropertyCache::kProperty_IsHidden }, 1 },
+    { kAudioDevicePropertyDeviceCanBeDefaultDevice,
+      { BGMAudioDevicePropertyCache::kProperty_CanBeDefaultInputDevice,
+        BGMAudioDevicePropertyCache::kProperty_CanBeDefaultOutputDevice }, 2 },
+    { kAudioDevicePropertyDeviceCanBeDefaultSystemDevice,
+      { BGMAudioDevicePropertyCache::kProperty_CanBeDefaultSystemInputDevice,
+        BGMAudioDevicePropertyCache::kProperty_CanBeDefaultSystemOutputDevice }, 2 }
+};
+
+#pragma mark Accessors
+
+// static
+UInt32  BGMAudioDevicePropertyCache::GetUInt32(AudioObjectID inDevice,
+                                               Property inProperty,
+                                               const std::function<UInt32()>& inFetch)
+{
+    CachedValue value;
+
+    GetValue(inDevice, inProperty, value, [&] (CachedValue& outValue) {
+        outValue.mUInt32 = inFetch();
+    });
+
+    return value.mUInt32;
+}
+
+// static
+CFStringRef __nullable BGMAudioDevicePropertyCache::CopyString(
+        AudioObjectID inDevice,
+        Property inProperty,
+        const std::function<CFStringRef __nullable()>& inCopy)
+{
+    CachedValue value;
+
+    GetValue(inDevice, inProperty, value, [&] (CachedValue& outValue) {
+        // Takes ownership of the copied string.
+        outValue.mString = CACFString(inCopy());
+    });
+
+    return value.mString.CopyCFString();
+}
+
+#pragma mark Invalidation
+
+// static
+void    BGMAudioDevicePropertyCache::Invalidate(AudioObjectID inDevice, Property inProperty)
+{
+    State& state = GetState();
+    std::lock_guard<std::mutex> lock(state.mMutex);
+
+    auto device = state.mDevices.find(inDevice);
+
+    if(device != state.mDevices.end())
+    {
+        device->second.mValues[inProperty] = CachedValue();
+        device->second.mGeneration++;
+    }
+}
+
+// static
+void    BGMAudioDevicePropertyCache::PropertiesChanged(AudioObjectID inDevice,
+                                                       UInt32 inNumberAddresses,
+                                                       const AudioObjectPropertyAddress* inAddresses)
+{
+    State& state = GetState();
+    std::lock_guard<std::mutex> lock(state.mMutex);
+
+    auto device = state.mDevices.find(inDevice);
+
+    if(device == state.mDevices.end())
+    {
+        return;
+    }
+
+    CachedDevice& cachedDevice = device->second;
+
+    for(UInt32 i = 0; i < inNumberAddresses; i++)
+    {
+        switch(inAddresses[i].mSelector)
+        {
+            case kAudioDevicePropertyDeviceIsAlive:
+                // The device has been removed. Forget everything about it, even the values that
+                // can't change, in case the HAL reuses its ID. The HAL removes the listener with
+                // the device, so the block is leaked rather than released while the HAL might still
+                // be about to call it.
+                DebugMsg("BGMAudioDevicePropertyCache::PropertiesChanged: Device %u removed",
+                         inDevice);
+                state.mDevices.erase(device);
+                return;
+
+            case kAudioDevicePropertyDeviceHasChanged:
+                // "Clients should re-evaluate everything they need to know about the device", so
+                // remove all of the values that can change.
+                for(UInt32 property = 0; property < kNumberOfProperties; property++)
+                {
+                    if(!IsImmutable(static_cast<Property>(property)))
+                    {
+                        cachedDevice.mValues[property] = CachedValue();
+                    }
+                }
+                break;
+
+            default:
+                for(const auto& invalidating : kInvalidatingProperties)
+                {
+                    if(invalidating.mSelector == inAddresses[i].mSelector)
+                    {
+                        for(UInt32 j = 0; j < invalidating.mNumberOfProperties; j++)
+                        {
+                            cachedDevice.mValues[invalidating.mProperties[j]] = CachedValue();
+                        }
+                    }
+                }
+                break;
+        }
+    }
+
+    cachedDevice.mGeneration++;
+}
+
+#pragma mark Implementation
+
+// static
+bool    BGMAudioDevicePropertyCache::IsImmutable(Property inProperty)
+{
+    return (inProperty == kProperty_UID) || (inProperty == kProperty_TransportType);
+}
+
+// static
+void    BGMAudioDevicePropertyCache::GetValue(AudioObjectID inDevice,
+                                              Property inProperty,
+                                              CachedValue& outValue,
+                                              const std::function<void(CachedValue&)>& inFetch)
+{
+    if(inDevice == kAudioObjectUnknown)
+    {
+        // Let the HAL return the error.
+        inFetch(outValue);
+        return;
+    }
+
+    AddListenerIfNeeded(inDevice);
+
+    State& state = GetState();
+    UInt64 generation;
+
+    {
+        std::lock_guard<std::mutex> lock(state.mMutex);
+
+        CachedDevice& cachedDevice = state.mDevices[inDevice];
+
+        if(cachedDevice.mValues[inProperty].mIsCached)
+        {
+            outValue = cachedDevice.mValues[inProperty];
+            return;
+        }
+
+        generation = cachedDevice.mGeneration;
+    }
+
+    // Fetch the value without holding the mutex because it queries the HAL.
+    inFetch(outValue);
+
+    std::lock_guard<std::mutex> lock(state.mMutex);
+
+    auto device = state.mDevices.find(inDevice);
+
+    // Only cache the value if nothing has been invalidated since it was fetched and, unless the
+    // value can't change, the cache will be notified when it does.
+    bool shouldCache = (device != state.mDevices.end()) &&
+            (device->second.mGeneration == generation) &&
+            (IsImmutable(inProperty) ||
+                    (device->second.mListenerState == kListenerState_Added));
+
+    if(shouldCache)
+    {
+        outValue.mIsCached = true;
+        device->second.mValues[inProperty] = outValue;
+    }
+}
+
+// static
+void    BGMAudioDevicePropertyCache::AddListenerIfNeeded(AudioObjectID inDevice)
+{
+    State& state = GetState();
+    AudioObjectPropertyListenerBlock listenerBlock;
+
+    {
+        std::lock_guard<std::mutex> lock(state.mMutex);
+
+        CachedDevice& cachedDevice = state.mDevices[inDevice];
+
+        if(cachedDevice.mListenerState != kListenerState_NotAdded)
+        {
+            return;
+        }
+
+        cachedDevice.mListenerState = kListenerState_Adding;
+        cachedDevice.mListenerBlock =
+                Block_copy(^(UInt32 inNumberAddresses,
+                             const AudioObjectPropertyAddress* inAddresses) {
+                    PropertiesChanged(inDevice, inNumberAddresses, inAddresses);
+                });
+        listenerBlock = cachedDevice.mListenerBlock;
+    }
+
+    std::vector<CAPropertyAddress> addresses {
+        CAPropertyAddress(kAudioDevicePropertyDeviceHasChanged),
+        CAPropertyAddress(kAudioDevicePropertyDeviceIsAlive)
+    };
+
+    for(const auto& invalidating : kInvalidatingProperties)
+    {
+        addresses.push_back(CAPropertyAddress(invalidating.mSelector,
+                                              kAudioObjectPropertyScopeWildcard,
+                                              kAudioObjectPropertyElementWildcard));
+    }
+
+    // Values are only cached if all of the listeners are added, so if one fails the device's
+    // values will always be fetched from the HAL. The listeners that were added stay, which just
+    // means the cache will be notified about changes it doesn't need to know about.
+    bool added = true;
+
+    for(const CAPropertyAddress& address : addresses)
+    {
+        BGM_Utils::LogAndSwallowExceptions(BGMDbgArgs, [&] {
+            added = false;
+            CAHALAudioObject(inDevice).AddPropertyListenerBlock(address,
+                                                                dispatch_get_global_queue(
+                                                                        QOS_CLASS_DEFAULT, 0),
+                                                                listenerBlock);
+            added = true;
+        });
+
+        if(!added)
+        {
+            break;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(state.mMutex);
+
+    auto device = state.mDevices.find(inDevice);
+
+    if(device != state.mDevices.end() && device->second.mListenerBlock == listenerBlock)
+    {
+        device->second.mListenerState = added ? kListenerState_Added : kListenerState_Failed;
+    }
+}
+
+// static
+BGMAudioDevicePropertyCache::State& BGMAudioDevicePropertyCache::GetState()
+{
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wexit-time-destructors"
+    static State sState;
+#pragma clang diagnostic pop
+    return sState;
+}
+
+#pragma clang assume_nonnull end
+
@@ -0,0 +1,164 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGMAudioDevicePropertyCache.h
+//  BGMApp
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  Caches the values of audio device properties that BGMApp reads often but that rarely change,
+//  e.g. the device's name and UID, so reading them doesn't have to query coreaudiod each time.
+//  BGMAudioDevice uses it for its cached getters.
+//
+//  The values are shared by every BGMAudioDevice for the same device. Properties that can't change,
+//  like the UID, are only ever fetched once per device. The others are only cached after the cache
+//  has added a listener for the device's property change notifications, which remove them from the
+//  cache. If adding the listener fails, they're fetched from the HAL every time, as they were before
+//  the cache.
+//
+//  Reads can return a value that changed in the HAL very recently, before the HAL has sent the
+//  notification for the change. Code that needs to see its own changes immediately, like
+//  BGMAudioDevice::SetIOBufferSize, calls Invalidate.
+//
+//  Stream formats aren't cached. They do send notifications, on the device as well as the streams,
+//  but BGMPlayThrough only reads them once each time it's activated, so caching them would save
+//  nothing. Volume ranges aren't read often enough to be worth caching either.
+//
+
+#ifndef BGMApp__BGMAudioDevicePropertyCache
+#define BGMApp__BGMAudioDevicePropertyCache
+
+// PublicUtility Includes
+#include "CACFString.h"
+
+// STL Includes
+#include <functional>
+#include <map>
+#include <mutex>
+
+// System Includes
+#include <CoreAudio/AudioHardware.h>
+
+
+#pragma clang assume_nonnull begin
+
+class BGMAudioDevicePropertyCache
+{
+
+public:
+    enum Property
+    {
+        // Can't change.
+        kProperty_UID,
+        kProperty_TransportType,
+        // Can change. Only cached while the cache is listening to the device.
+        kProperty_Name,
+        kProperty_IOBufferSize,
+        kProperty_InputChannels,
+        kProperty_OutputChannels,
+        kProperty_IsHidden,
+        kProperty_CanBeDefaultInputDevice,
+        kProperty_CanBeDefaultOutputDevice,
+        kProperty_CanBeDefaultSystemInputDevice,
+        kProperty_CanBeDefaultSystemOutputDevice,
+        kNumberOfProperties
+    };
+
+    /*!
+     @return The cached value of inProperty for inDevice or, if it isn't cached, the value returned
+             by inFetch, which is called to get the value from the HAL.
+     @throws Whatever inFetch throws, in which case nothing is cached.
+     */
+    static UInt32               GetUInt32(AudioObjectID inDevice,
+                                          Property inProperty,
+                                          const std::function<UInt32()>& inFetch);
+    /*!
+     Like GetUInt32, but for properties with CFString values.
+
+     @return The value, which the caller is responsible for releasing, or null.
+     */
+    static CFStringRef __nullable CopyString(AudioObjectID inDevice,
+                                             Property inProperty,
+                                             const std::function<CFStringRef __nullable()>& inCopy);
+
+    /*! Remove inProperty's value for inDevice from the cache, if it's cached. */
+    static void                 Invalidate(AudioObjectID inDevice, Property inProperty);
+
+    /*!
+     Remove the values the changed properties affect from the cache. Called when the HAL notifies the
+     cache that some of inDevice's properties have changed.
+     */
+    static void                 PropertiesChanged(AudioObjectID inDevice,
+                                                  UInt32 inNumberAddresses,
+                                                  const AudioObjectPropertyAddress* inAddresses);
+
+private:
+    enum ListenerState
+    {
+        kListenerState_NotAdded,
+        kListenerState_Adding,
+        kListenerState_Added,
+        kListenerState_Failed
+    };
+
+    struct CachedValue
+    {
+        bool                    mIsCached = false;
+        UInt32                  mUInt32 = 0;
+        CACFString              mString;
+    };
+
+    struct CachedDevice
+    {
+        CachedValue             mValues[kNumberOfProperties];
+        // Incremented whenever values are removed, so a value fetched from the HAL before the
+        // property changed isn't stored after the notification for the change has been handled.
+        UInt64                  mGeneration = 0;
+        ListenerState           mListenerState = kListenerState_NotAdded;
+        // Never released because the listener is never removed. The HAL removes it when the device
+        // is removed.
+        AudioObjectPropertyListenerBlock __nullable mListenerBlock = nullptr;
+    };
+
+    static bool                 IsImmutable(Property inProperty);
+
+    /*!
+     Looks up the cached value. If it isn't cached, fetches it with inFetch and caches it if the
+     property can't change or the cache is listening to the device.
+     */
+    static void                 GetValue(AudioObjectID inDevice,
+                                         Property inProperty,
+                                         CachedValue& outValue,
+                                         const std::function<void(CachedValue&)>& inFetch);
+
+    /*! Adds the listener that invalidates inDevice's values if it hasn't been added already. */
+    static void                 AddListenerIfNeeded(AudioObjectID inDevice);
+
+    struct State
+    {
+        // Protects mDevices. Never held while calling into the HAL.
+        std::mutex                              mMutex;
+        std::map<AudioObjectID, CachedDevice>   mDevices;
+    };
+
+    static State&               GetState();
+
+};
+
+#pragma clang assume_nonnull end
+
+#endif /* BGMApp__BGMAudioDevicePropertyCache */
+
@@ -20,7 +20,8 @@
 //  Copyright © 2016 Kyle Neideck
 //
 //  When enabled, BGMAutoPauseMusic listens for notifications from BGMDevice to tell when music is playing and
-//  pauses the music player if other audio starts.
+//  pauses the music player if other audio starts. Or, if the user has chosen to duck the music player instead,
+//  it has BGMDriver turn the music player down while other audio is playing.
 //
 
 // Local Includes
@@ -25,6 +25,7 @@
 
 // Local Includes
 #include "BGM_Types.h"
+#include "BGM_Utils.h"
 #import "BGMMusicPlayer.h"
 
 // STL Includes
@@ -40,6 +41,8 @@ static Float32 const kUnpauseDelayWeightingFactor = 0.1f;
 
 @implementation BGMAutoPauseMusic {
     BOOL enabled;
+    // True if we've asked BGMDriver to duck the music player rather than pausing it ourselves.
+    BOOL ducking;
     
     BGMAudioDeviceManager* audioDevices;
     BGMMusicPlayers* musicPlayers;
@@ -67,6 +70,7 @@ static Float32 const kUnpauseDelayWeightingFactor = 0.1f;
         userDefaults = inUserDefaults;
         
         enabled = NO;
+        ducking = NO;
         wePaused = NO;
         
         dispatch_queue_attr_t attr;
@@ -250,17 +254,41 @@ static Float32 const kUnpauseDelayWeightingFactor = 0.1f;
 
 - (void) enable {
     if (!enabled) {
-        [audioDevices bgmDevice].AddPropertyListenerBlock(kBGMAudibleStateAddress, listenerQueue, listenerBlock);
+        if (userDefaults.duckMusicInsteadOfPausing) {
+            // BGMDriver ducks the music player itself, on its IO thread, so we don't need to listen
+            // for the audible state changing.
+            [self setMusicDuckingEnabled:YES];
+            ducking = YES;
+        } else {
+            [audioDevices bgmDevice].AddPropertyListenerBlock(kBGMAudibleStateAddress, listenerQueue, listenerBlock);
+        }
+
         enabled = YES;
     }
 }
 
 - (void) disable {
     if (enabled) {
-        [audioDevices bgmDevice].RemovePropertyListenerBlock(kBGMAudibleStateAddress, listenerQueue, listenerBlock);
+        if (ducking) {
+            [self setMusicDuckingEnabled:NO];
+            ducking = NO;
+        } else {
+            [audioDevices bgmDevice].RemovePropertyListenerBlock(kBGMAudibleStateAddress, listenerQueue, listenerBlock);
+        }
+
         enabled = NO;
     }
 }
 
+- (void) setMusicDuckingEnabled:(BOOL)duckingEnabled {
+    BGMLogAndSwallowExceptions("BGMAutoPauseMusic::setMusicDuckingEnabled", ([&] {
+        [audioDevices bgmDevice].SetMusicDucking(duckingEnabled,
+                                                 static_cast<Float32>(userDefaults.musicDuckingDepthDB),
+                                                 static_cast<Float32>(userDefaults.musicDuckingAttackMS),
+                                                 static_cast<Float32>(userDefaults.musicDuckingHoldMS),
+                                                 static_cast<Float32>(userDefaults.musicDuckingReleaseMS));
+    }));
+}
+
 @end
 
@@ -35,7 +35,12 @@
 #include "CACFDictionary.h"
 
 // STL Includes
+#include <chrono>
 #include <map>
+#include <mutex>
+
+// System Includes
+#include <dispatch/dispatch.h>
 
 
 #pragma clang assume_nonnull begin
@@ -143,7 +148,7 @@ void BGMBackgroundMusicDevice::SetAppVolume(SInt32 inVolume,
     inVolume = std::min(kAppRelativeVolumeMaxRawValue, inVolume);
 
     SendAppVolumeOrPanToBGMDevice(inVolume,
-                                  CFSTR(kBGMAppVolumesKey_RelativeVolume),
+                                  kBGMAppVolumesPackedField_RelativeVolume,
                                   inAppProcessID,
                                   inAppBundleID);
 }
@@ -160,45 +165,570 @@ void BGMBackgroundMusicDevice::SetAppPanPosition(SInt32 inPanPosition,
     inPanPosition = std::min(kAppPanRightRawValue, inPanPosition);
 
     SendAppVolumeOrPanToBGMDevice(inPanPosition,
-                                  CFSTR(kBGMAppVolumesKey_PanPosition),
+                                  kBGMAppVolumesPackedField_PanPosition,
                                   inAppProcessID,
                                   inAppBundleID);
 }
 
+void BGMBackgroundMusicDevice::SetAppVolumes(const std::vector<AppVolume>& inAppVolumes)
+{
+    std::vector<AppVolumeChange> appVolumeChanges;
+
+    for(const AppVolume& appVolume : inAppVolumes)
+    {
+        SInt32 volume = std::max(kAppRelativeVolumeMinRawValue, appVolume.mVolume);
+        volume = std::min(kAppRelativeVolumeMaxRawValue, volume);
+
+        // AddAppVolumeOrPanChange releases the bundle ID, like SetAppVolume, so pass it a copy.
+        AddAppVolumeOrPanChange(appVolumeChanges,
+                                volume,
+                                kBGMAppVolumesPackedField_RelativeVolume,
+                                appVolume.mProcessID,
+                                appVolume.mBundleID.CopyCFString());
+    }
+
+    SendPendingAppVolumeChanges(appVolumeChanges);
+}
+
+void BGMBackgroundMusicDevice::QueueAppVolumes(const std::vector<AppVolume>& inAppVolumes)
+{
+    std::vector<AppVolumeChange> appVolumeChanges;
+
+    for(const AppVolume& appVolume : inAppVolumes)
+    {
+        SInt32 volume = std::max(kAppRelativeVolumeMinRawValue, appVolume.mVolume);
+        volume = std::min(kAppRelativeVolumeMaxRawValue, volume);
+
+        AddAppVolumeOrPanChange(appVolumeChanges,
+                                volume,
+                                kBGMAppVolumesPackedField_RelativeVolume,
+                                appVolume.mProcessID,
+                                appVolume.mBundleID.CopyCFString());
+    }
+
+    if(!appVolumeChanges.empty())
+    {
+        QueueAppVolumeChanges(appVolumeChanges);
+    }
+}
+
 void BGMBackgroundMusicDevice::SendAppVolumeOrPanToBGMDevice(SInt32 inNewValue,
-                                                             CFStringRef inVolumeTypeKey,
+                                                             UInt32 inField,
                                                              pid_t inAppProcessID,
                                                              CFStringRef __nullable inAppBundleID)
 {
-    CACFArray appVolumeChanges(true);
+    std::vector<AppVolumeChange> appVolumeChanges;
+
+    AddAppVolumeOrPanChange(appVolumeChanges,
+                            inNewValue,
+                            inField,
+                            inAppProcessID,
+                            inAppBundleID);
 
-    auto addVolumeChange = [&] (pid_t pid, CFStringRef bundleID)
+    if(!appVolumeChanges.empty())
     {
-        CACFDictionary appVolumeChange(true);
+        QueueAppVolumeChanges(appVolumeChanges);
+    }
+}
+
+// The app volume and pan changes waiting to be sent. Shared by every BGMBackgroundMusicDevice for the
+// same reason as PackedAppVolumesState (below).
+struct BGMBackgroundMusicDevice::PendingAppVolumeChanges
+{
+    // Held while taking the pending changes and sending them, so changes reach BGMDevice in the
+    // order they were made and an older value can't be sent after a newer one. Must be locked
+    // before mMutex.
+    std::mutex                              mSendMutex;
+    // Protects the other members.
+    std::mutex                              mMutex;
+    // At most one change per app. See MergeAppVolumeChange.
+    std::vector<AppVolumeChange>            mChanges;
+    std::chrono::steady_clock::time_point   mLastSendTime;
+    bool                                    mSendScheduled = false;
+};
 
-        appVolumeChange.AddSInt32(CFSTR(kBGMAppVolumesKey_ProcessID), pid);
-        appVolumeChange.AddString(CFSTR(kBGMAppVolumesKey_BundleID), bundleID);
-        appVolumeChange.AddSInt32(inVolumeTypeKey, inNewValue);
+// static
+BGMBackgroundMusicDevice::PendingAppVolumeChanges&
+BGMBackgroundMusicDevice::GetPendingAppVolumeChanges()
+{
+    static PendingAppVolumeChanges sPendingChanges;
+    return sPendingChanges;
+}
 
-        appVolumeChanges.AppendDictionary(appVolumeChange.GetDict());
+void BGMBackgroundMusicDevice::QueueAppVolumeChanges(
+        const std::vector<AppVolumeChange>& inAppVolumeChanges)
+{
+    PendingAppVolumeChanges& pending = GetPendingAppVolumeChanges();
+    const auto sendInterval = std::chrono::milliseconds(kAppVolumeSendIntervalMs);
+
+    {
+        std::lock_guard<std::mutex> lock(pending.mMutex);
+
+        for(const AppVolumeChange& change : inAppVolumeChanges)
+        {
+            MergeAppVolumeChange(pending.mChanges, change);
+        }
+
+        if(pending.mSendScheduled)
+        {
+            // The changes will be sent with the others at the end of the interval.
+            return;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        auto nextSendTime = pending.mLastSendTime + sendInterval;
+
+        if(now < nextSendTime)
+        {
+            pending.mSendScheduled = true;
+
+            auto delayNs =
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(nextSendTime - now).count();
+
+            dispatch_after(dispatch_time(DISPATCH_TIME_NOW, delayNs),
+                           dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0),
+                           ^{
+                               BGMLogAndSwallowExceptions(
+                                       "BGMBackgroundMusicDevice::QueueAppVolumeChanges", [] {
+                                           FlushAppVolumeChanges();
+                                       });
+                           });
+
+            return;
+        }
+    }
+
+    // Nothing has been sent recently, so send the changes now rather than adding latency to the
+    // start of every drag.
+    SendPendingAppVolumeChanges({});
+}
+
+// static
+void BGMBackgroundMusicDevice::FlushAppVolumeChanges()
+{
+    PendingAppVolumeChanges& pending = GetPendingAppVolumeChanges();
+
+    {
+        std::lock_guard<std::mutex> lock(pending.mMutex);
+
+        // Clear this first so, if BGMDevice can't be found, the next change will try to send the
+        // pending changes again instead of waiting for a send that was never scheduled.
+        pending.mSendScheduled = false;
+
+        if(pending.mChanges.empty())
+        {
+            return;
+        }
+    }
+
+    // BGMApp usually creates a BGMBackgroundMusicDevice for each change, so the one that queued the
+    // changes might not exist anymore.
+    BGMBackgroundMusicDevice().SendPendingAppVolumeChanges({});
+}
+
+void BGMBackgroundMusicDevice::SendPendingAppVolumeChanges(
+        const std::vector<AppVolumeChange>& inAppVolumeChanges)
+{
+    PendingAppVolumeChanges& pending = GetPendingAppVolumeChanges();
+    std::lock_guard<std::mutex> sendLock(pending.mSendMutex);
+
+    std::vector<AppVolumeChange> appVolumeChanges;
+
+    {
+        std::lock_guard<std::mutex> lock(pending.mMutex);
+
+        appVolumeChanges.swap(pending.mChanges);
+        pending.mSendScheduled = false;
+
+        if(!appVolumeChanges.empty() || !inAppVolumeChanges.empty())
+        {
+            pending.mLastSendTime = std::chrono::steady_clock::now();
+        }
+    }
+
+    // The new changes are more recent, so they replace the pending ones for the same apps.
+    for(const AppVolumeChange& change : inAppVolumeChanges)
+    {
+        MergeAppVolumeChange(appVolumeChanges, change);
+    }
+
+    if(!appVolumeChanges.empty())
+    {
+        try
+        {
+            SendAppVolumeChangesToBGMDevice(appVolumeChanges);
+        }
+        catch(...)
+        {
+            // Put the changes back so they're sent next time instead of being lost. Changes queued
+            // while we were sending are newer, so they're merged over the ones that failed.
+            std::lock_guard<std::mutex> lock(pending.mMutex);
+
+            std::vector<AppVolumeChange> newerChanges;
+            newerChanges.swap(pending.mChanges);
+            pending.mChanges.swap(appVolumeChanges);
+
+            for(const AppVolumeChange& change : newerChanges)
+            {
+                MergeAppVolumeChange(pending.mChanges, change);
+            }
+
+            throw;
+        }
+    }
+}
+
+// static
+void BGMBackgroundMusicDevice::MergeAppVolumeChange(std::vector<AppVolumeChange>& ioChanges,
+                                                    const AppVolumeChange& inChange)
+{
+    for(AppVolumeChange& change : ioChanges)
+    {
+        bool sameApp = (change.mProcessID == inChange.mProcessID) &&
+                (change.mBundleID.IsValid() == inChange.mBundleID.IsValid()) &&
+                (!change.mBundleID.IsValid() || (change.mBundleID == inChange.mBundleID));
+
+        if(sameApp)
+        {
+            if((inChange.mFields & kBGMAppVolumesPackedField_RelativeVolume) != 0)
+            {
+                change.mRelativeVolume = inChange.mRelativeVolume;
+            }
+
+            if((inChange.mFields & kBGMAppVolumesPackedField_PanPosition) != 0)
+            {
+                change.mPanPosition = inChange.mPanPosition;
+            }
+
+            change.mFields |= inChange.mFields;
+            return;
+        }
+    }
+
+    ioChanges.push_back(inChange);
+}
+
+// static
+void BGMBackgroundMusicDevice::AddAppVolumeOrPanChange(
+        std::vector<AppVolumeChange>& ioAppVolumeChanges,
+        SInt32 inNewValue,
+        UInt32 inField,
+        pid_t inAppProcessID,
+        CFStringRef __nullable inAppBundleID)
+{
+    CACFString appBundleID(inAppBundleID);
+
+    auto addVolumeChange = [&] (pid_t pid, const CACFString& bundleID)
+    {
+        // BGMDevice wouldn't be able to find the app.
+        if((pid == -1) && !bundleID.IsValid())
+        {
+            return;
+        }
+
+        AppVolumeChange appVolumeChange;
+        appVolumeChange.mProcessID = pid;
+        appVolumeChange.mBundleID = bundleID;
+        appVolumeChange.mFields = inField;
+        appVolumeChange.mRelativeVolume =
+                (inField == kBGMAppVolumesPackedField_RelativeVolume) ? inNewValue : 0;
+        appVolumeChange.mPanPosition =
+                (inField == kBGMAppVolumesPackedField_PanPosition) ? inNewValue : 0;
+
+        ioAppVolumeChanges.push_back(appVolumeChange);
     };
 
-    addVolumeChange(inAppProcessID, inAppBundleID);
+    addVolumeChange(inAppProcessID, appBundleID);
 
     // Add the same change for each process the app is responsible for.
-    for(CACFString responsibleBundleID : ResponsibleBundleIDsOf(CACFString(inAppBundleID)))
+    for(const CACFString& responsibleBundleID : ResponsibleBundleIDsOf(appBundleID))
     {
         // Send -1 as the PID so this volume will only ever be matched by bundle ID.
-        addVolumeChange(-1, responsibleBundleID.GetCFString());
+        addVolumeChange(-1, responsibleBundleID);
+    }
+}
+
+namespace
+{
+    // The bundle ID tokens for kAudioDeviceCustomPropertyAppVolumesPacked. They're shared by every
+    // BGMBackgroundMusicDevice because BGMApp often creates one just to send a single change.
+    struct PackedAppVolumesState
+    {
+        std::mutex                          mMutex;
+        // 0 until the first change is sent. After that it's never 0, which is BGMDriver's initial
+        // session ID, so BGMDevice can't mistake its empty token table for ours.
+        UInt32                              mSessionID = 0;
+        std::map<CACFString, UInt32>        mTokens;
+
+        struct Device
+        {
+            bool                            mHasProperty = false;
+            // Indexed by token. True if the definition has been sent to this instance of BGMDevice.
+            std::vector<bool>               mDefinedTokens;
+        };
+
+        std::map<AudioObjectID, Device>     mDevices;
+
+        void StartNewSession()
+        {
+            do
+            {
+                mSessionID = arc4random();
+            } while(mSessionID == 0);
+
+            mTokens.clear();
+
+            for(auto& device : mDevices)
+            {
+                device.second.mDefinedTokens.clear();
+            }
+        }
+    };
+
+    PackedAppVolumesState& GetPackedAppVolumesState()
+    {
+        static PackedAppVolumesState sState;
+        return sState;
+    }
+
+    // Appends a value to a packed property's data.
+    template <typename T>
+    void Append(std::vector<UInt8>& ioData, const T& inValue)
+    {
+        const UInt8* bytes = reinterpret_cast<const UInt8*>(&inValue);
+        ioData.insert(ioData.end(), bytes, bytes + sizeof(T));
+    }
+}
+
+void BGMBackgroundMusicDevice::SendAppVolumeChangesToBGMDevice(
+        const std::vector<AppVolumeChange>& inAppVolumeChanges)
+{
+    PackedAppVolumesState& state = GetPackedAppVolumesState();
+    std::lock_guard<std::mutex> lock(state.mMutex);
+
+    if(state.mSessionID == 0)
+    {
+        state.StartNewSession();
+    }
+
+    // Give each bundle ID a token. If we've run out, start a new session, which makes BGMDevice
+    // forget the old tokens.
+    std::vector<UInt32> tokens;
+
+    for(int attempt = 0; attempt < 2; attempt++)
+    {
+        tokens.clear();
+
+        for(const AppVolumeChange& change : inAppVolumeChanges)
+        {
+            if(!change.mBundleID.IsValid() ||
+               (change.mBundleID.GetByteLength() > kBGMAppVolumesPackedMaxBundleIDLength))
+            {
+                tokens.push_back(kBGMAppVolumesPackedNoBundleID);
+                continue;
+            }
+
+            auto token = state.mTokens.find(change.mBundleID);
+
+            if(token == state.mTokens.end())
+            {
+                token = state.mTokens.emplace(change.mBundleID,
+                                              static_cast<UInt32>(state.mTokens.size())).first;
+            }
+
+            tokens.push_back(token->second);
+        }
+
+        if(state.mTokens.size() <= kBGMAppVolumesPackedMaxTokens)
+        {
+            break;
+        }
+
+        state.StartNewSession();
+    }
+
+    // Send the changes to BGMDevice and also to the instance of BGMDevice that handles UI sounds.
+    SendAppVolumeChanges(*this, inAppVolumeChanges, tokens);
+    SendAppVolumeChanges(mUISoundsBGMDevice, inAppVolumeChanges, tokens);
+}
+
+// static
+void BGMBackgroundMusicDevice::SendAppVolumeChanges(
+        BGMAudioDevice inDevice,
+        const std::vector<AppVolumeChange>& inAppVolumeChanges,
+        const std::vector<UInt32>& inTokens)
+{
+    PackedAppVolumesState& state = GetPackedAppVolumesState();
+
+    auto deviceState = state.mDevices.find(inDevice.GetObjectID());
+
+    if(deviceState == state.mDevices.end())
+    {
+        PackedAppVolumesState::Device newDeviceState;
+        newDeviceState.mHasProperty = inDevice.HasProperty(kBGMAppVolumesPackedAddress);
+        deviceState = state.mDevices.emplace(inDevice.GetObjectID(), newDeviceState).first;
     }
 
-    CFPropertyListRef changesPList = appVolumeChanges.AsPropertyList();
+    // Fall back to the older property for versions of BGMDriver that don't have the packed one, and
+    // for bundle IDs too long to pack, which shouldn't happen in practice.
+    bool canPack = deviceState->second.mHasProperty &&
+            (inAppVolumeChanges.size() <= kBGMAppVolumesPackedMaxRecords) &&
+            std::none_of(inAppVolumeChanges.begin(),
+                         inAppVolumeChanges.end(),
+                         [&] (const AppVolumeChange& change) {
+                             return change.mBundleID.IsValid() &&
+                                     (change.mBundleID.GetByteLength() >
+                                      kBGMAppVolumesPackedMaxBundleIDLength);
+                         });
+
+    if(!canPack)
+    {
+        SendAppVolumeChangesAsArray(inDevice, inAppVolumeChanges);
+        return;
+    }
 
-    // Send the change to BGMDevice.
-    SetPropertyData_CFType(kBGMAppVolumesAddress, changesPList);
+    std::vector<bool>& definedTokens = deviceState->second.mDefinedTokens;
+    definedTokens.resize(state.mTokens.size(), false);
+
+    auto pack = [&] {
+        std::vector<UInt8> data;
+        std::vector<UInt32> newTokens;
+
+        for(UInt32 token : inTokens)
+        {
+            if((token != kBGMAppVolumesPackedNoBundleID) && !definedTokens[token])
+            {
+                definedTokens[token] = true;
+                newTokens.push_back(token);
+            }
+        }
+
+        BGMAppVolumesPackedHeader header = {
+            kBGMAppVolumesPackedVersion,
+            state.mSessionID,
+            static_cast<UInt32>(inAppVolumeChanges.size()),
+            static_cast<UInt32>(newTokens.size())
+        };
+        Append(data, header);
+
+        for(size_t i = 0; i < inAppVolumeChanges.size(); i++)
+        {
+            const AppVolumeChange& change = inAppVolumeChanges[i];
+
+            BGMAppVolumesPackedRecord record = {
+                change.mProcessID,
+                inTokens[i],
+                change.mFields,
+                change.mRelativeVolume,
+                change.mPanPosition,
+                0
+            };
+            Append(data, record);
+        }
+
+        for(UInt32 token : newTokens)
+        {
+            for(size_t i = 0; i < inTokens.size(); i++)
+            {
+                if(inTokens[i] == token)
+                {
+                    const CACFString& bundleID = inAppVolumeChanges[i].mBundleID;
+                    UInt32 length = bundleID.GetByteLength();
+                    std::vector<char> utf8(length + 1);
+                    UInt32 size = length + 1;
+                    CACFString::GetCString(bundleID.GetCFString(), utf8.data(), size);
+
+                    BGMAppVolumesPackedBundleID definition = { token, length };
+                    Append(data, definition);
+                    data.insert(data.end(), utf8.begin(), utf8.begin() + length);
+                    break;
+                }
+            }
+        }
+
+        return data;
+    };
+
+    auto send = [&] (const std::vector<UInt8>& data) {
+        CFDataRef dataRef = CFDataCreate(kCFAllocatorDefault,
+                                         data.data(),
+                                         static_cast<CFIndex>(data.size()));
+        ThrowIfNULL(dataRef,
+                    CAException(kAudioHardwareUnspecifiedError),
+                    "BGMBackgroundMusicDevice::SendAppVolumeChanges: !dataRef");
+
+        try
+        {
+            inDevice.SetPropertyData_CFType(kBGMAppVolumesPackedAddress, dataRef);
+        }
+        catch(...)
+        {
+            CFRelease(dataRef);
+            throw;
+        }
+
+        CFRelease(dataRef);
+    };
 
-    // Also send it to the instance of BGMDevice that handles UI sounds.
-    mUISoundsBGMDevice.SetPropertyData_CFType(kBGMAppVolumesAddress, changesPList);
+    try
+    {
+        send(pack());
+    }
+    catch(const CAException& e)
+    {
+        // BGMDevice has probably forgotten our tokens, e.g. because coreaudiod restarted, so try
+        // again with all of the definitions.
+        DebugMsg("BGMBackgroundMusicDevice::SendAppVolumeChanges: Resending with definitions. "
+                 "Error: %d", e.GetError());
+        std::fill(definedTokens.begin(), definedTokens.end(), false);
+
+        try
+        {
+            send(pack());
+        }
+        catch(...)
+        {
+            // Don't assume it has the definitions from the failed attempt.
+            std::fill(definedTokens.begin(), definedTokens.end(), false);
+            throw;
+        }
+    }
+}
+
+// static
+void BGMBackgroundMusicDevice::SendAppVolumeChangesAsArray(
+        BGMAudioDevice inDevice,
+        const std::vector<AppVolumeChange>& inAppVolumeChanges)
+{
+    CACFArray appVolumeChanges(true);
+
+    for(const AppVolumeChange& change : inAppVolumeChanges)
+    {
+        CACFDictionary appVolumeChange(true);
+
+        appVolumeChange.AddSInt32(CFSTR(kBGMAppVolumesKey_ProcessID), change.mProcessID);
+
+        if(change.mBundleID.IsValid())
+        {
+            appVolumeChange.AddString(CFSTR(kBGMAppVolumesKey_BundleID),
+                                      change.mBundleID.GetCFString());
+        }
+
+        if((change.mFields & kBGMAppVolumesPackedField_RelativeVolume) != 0)
+        {
+            appVolumeChange.AddSInt32(CFSTR(kBGMAppVolumesKey_RelativeVolume),
+                                      change.mRelativeVolume);
+        }
+
+        if((change.mFields & kBGMAppVolumesPackedField_PanPosition) != 0)
+        {
+            appVolumeChange.AddSInt32(CFSTR(kBGMAppVolumesKey_PanPosition), change.mPanPosition);
+        }
+
+        appVolumeChanges.AppendDictionary(appVolumeChange.GetDict());
+    }
+
+    inDevice.SetPropertyData_CFType(kBGMAppVolumesAddress, appVolumeChanges.AsPropertyList());
 }
 
 // This is a temporary solution that lets us control the volumes of some multiprocess apps, i.e.
@@ -292,6 +822,65 @@ BGMDeviceAudibleState BGMBackgroundMusicDevice::GetAudibleState() const
     return audibleState;
 }
 
+#pragma mark IO Stats
+
+bool BGMBackgroundMusicDevice::GetIOStats(BGMDeviceIOStats& outStats) const
+{
+    if(!HasProperty(kBGMIOStatsAddress))
+    {
+        return false;
+    }
+
+    CFTypeRef propertyDataRef = GetPropertyData_CFType(kBGMIOStatsAddress);
+
+    ThrowIfNULL(propertyDataRef,
+                CAException(kAudioHardwareIllegalOperationError),
+                "BGMBackgroundMusicDevice::GetIOStats: !propertyDataRef");
+
+    const CFIndex statsSize = static_cast<CFIndex>(sizeof(BGMDeviceIOStats));
+    CFDataRef statsData = static_cast<CFDataRef>(propertyDataRef);
+    bool isValid = (CFGetTypeID(propertyDataRef) == CFDataGetTypeID()) &&
+            (CFDataGetLength(statsData) == statsSize);
+
+    if(isValid)
+    {
+        CFDataGetBytes(statsData,
+                       CFRangeMake(0, statsSize),
+                       reinterpret_cast<UInt8*>(&outStats));
+    }
+
+    CFRelease(propertyDataRef);
+
+    ThrowIf(!isValid,
+            CAException(kAudioHardwareIllegalOperationError),
+            "BGMBackgroundMusicDevice::GetIOStats: Property was not a CFData of the expected size");
+    ThrowIf(outStats.mVersion != kBGMIOStatsVersion,
+            CAException(kAudioHardwareIllegalOperationError),
+            "BGMBackgroundMusicDevice::GetIOStats: Unexpected version");
+
+    return true;
+}
+
+#pragma mark Music Ducking
+
+void BGMBackgroundMusicDevice::SetMusicDucking(bool inEnabled,
+                                               Float32 inDepthDb,
+                                               Float32 inAttackMs,
+                                               Float32 inHoldMs,
+                                               Float32 inReleaseMs)
+{
+    CACFDictionary ducking(true);
+    ducking.AddBool(CFSTR(kBGMMusicDuckingKey_Enabled), inEnabled);
+    ducking.AddFloat32(CFSTR(kBGMMusicDuckingKey_DepthDb), inDepthDb);
+    ducking.AddFloat32(CFSTR(kBGMMusicDuckingKey_AttackMs), inAttackMs);
+    ducking.AddFloat32(CFSTR(kBGMMusicDuckingKey_HoldMs), inHoldMs);
+    ducking.AddFloat32(CFSTR(kBGMMusicDuckingKey_ReleaseMs), inReleaseMs);
+
+    // Only the main instance of BGMDevice has the music player as a client, so the UI sounds
+    // instance doesn't need the settings.
+    SetPropertyData_CFType(kBGMMusicDuckingAddress, ducking.AsPropertyList());
+}
+
 #pragma mark Music Player
 
 pid_t BGMBackgroundMusicDevice::GetMusicPlayerProcessID() const
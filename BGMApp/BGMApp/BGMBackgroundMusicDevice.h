@@ -41,6 +41,7 @@
 #include "BGM_Types.h"
 
 // PublicUtility Includes
+#include "CACFArray.h"
 #include "CACFString.h"
 
 // STL Includes
@@ -83,6 +84,14 @@ public:
 #pragma mark App Volumes
 
 public:
+    /*! An app's relative volume. See SetAppVolume. */
+    struct AppVolume
+    {
+        SInt32          mVolume;
+        pid_t           mProcessID;
+        CACFString      mBundleID;
+    };
+
     /*!
      @return The current value of BGMDevice's kAudioDeviceCustomPropertyAppVolumes property. See
              BGM_Types.h.
@@ -91,6 +100,10 @@ public:
      */
     CFArrayRef          GetAppVolumes() const;
     /*!
+     Set an app's relative volume. Meant to be called for every change the user makes, e.g. on each
+     mouse-moved event while they drag a slider, so the changes are coalesced. See
+     QueueAppVolumes.
+
      @param inVolume A value between kAppRelativeVolumeMinRawValue and kAppRelativeVolumeMaxRawValue
                      from BGM_Types.h. See kBGMAppVolumesKey_RelativeVolume in BGM_Types.h.
      @param inAppProcessID The ID of app's main process (or the process it uses to play audio, if
@@ -98,13 +111,15 @@ public:
                            processes, you can just set the volume for each of them. Pass -1 to omit
                            this param.
      @param inAppBundleID The app's bundle ID. Pass null to omit this param.
-     @throws CAException If the HAL returns an error when this function sends the volume change to
-                         BGMDevice.
+     @throws CAException If this function sends the volume change to BGMDevice immediately and the
+                         HAL returns an error.
      */
     void                SetAppVolume(SInt32 inVolume,
                                      pid_t inAppProcessID,
                                      CFStringRef __nullable inAppBundleID);
     /*!
+     Set an app's pan position. Coalesced in the same way as SetAppVolume.
+
      @param inPanPosition A value between kAppPanLeftRawValue and kAppPanRightRawValue from
                           BGM_Types.h. A negative value has a higher proportion of left channel, and
                           a positive value has a higher proportion of right channel.
@@ -113,19 +128,120 @@ public:
                            processes, you can just set the pan position for each of them. Pass -1 to
                            omit this param.
      @param inAppBundleID The app's bundle ID. Pass null to omit this param.
-     @throws CAException If the HAL returns an error when this function sends the pan position
-                         change to BGMDevice.
+     @throws CAException If this function sends the pan position change to BGMDevice immediately
+                         and the HAL returns an error.
      */
     void                SetAppPanPosition(SInt32 inPanPosition,
                                           pid_t inAppProcessID,
                                           CFStringRef __nullable inAppBundleID);
+    /*!
+     Set the relative volumes of several apps in a single update, so BGMDriver changes them all in
+     the same IO cycle. The volumes are clamped in the same way as SetAppVolume.
+
+     Not rate-limited. Any queued changes are sent in the same update, unless these volumes replace
+     them.
+
+     @throws CAException If the HAL returns an error when this function sends the volume changes to
+                         BGMDevice.
+     */
+    void                SetAppVolumes(const std::vector<AppVolume>& inAppVolumes);
+    /*!
+     Like SetAppVolumes, but queues the volumes rather than always sending them immediately.
+
+     Queued changes are sent to BGMDevice together, at most once per kAppVolumeSendIntervalMs. Only
+     the latest value for each app is kept, so while the user drags a volume or pan slider BGMDevice
+     gets a property update every kAppVolumeSendIntervalMs instead of one per mouse-moved event. If
+     nothing has been sent recently, the changes are sent immediately. Otherwise they're sent from a
+     dispatch queue at the end of the interval, and errors are logged rather than thrown. The latest
+     value is always sent eventually.
+
+     @throws CAException If this function sends the volume changes to BGMDevice immediately and the
+                         HAL returns an error.
+     */
+    void                QueueAppVolumes(const std::vector<AppVolume>& inAppVolumes);
+    /*!
+     Send any queued app volume and pan changes to BGMDevice now. For example, before BGMApp quits.
+
+     @throws CAException If BGMDevice can't be found or the HAL returns an error.
+     */
+    static void         FlushAppVolumeChanges();
+
+    /*! The minimum time between sending queued app volume and pan changes, in milliseconds. */
+    static const UInt32 kAppVolumeSendIntervalMs = 20;
 
 private:
+    /*!
+     A change to an app's relative volume and/or pan position. mFields is a combination of the
+     kBGMAppVolumesPackedField_ flags from BGM_Types.h.
+     */
+    struct AppVolumeChange
+    {
+        pid_t           mProcessID;
+        CACFString      mBundleID;
+        UInt32          mFields;
+        SInt32          mRelativeVolume;
+        SInt32          mPanPosition;
+    };
+
+    /*!
+     Add the change for the app and for each process it's responsible for to ioAppVolumeChanges.
+     Takes ownership of inAppBundleID.
+
+     @param inField kBGMAppVolumesPackedField_RelativeVolume or
+                    kBGMAppVolumesPackedField_PanPosition.
+     */
+    static void         AddAppVolumeOrPanChange(std::vector<AppVolumeChange>& ioAppVolumeChanges,
+                                                SInt32 inNewValue,
+                                                UInt32 inField,
+                                                pid_t inAppProcessID,
+                                                CFStringRef __nullable inAppBundleID);
+    /*!
+     Send the changes to both instances of BGMDevice, using kAudioDeviceCustomPropertyAppVolumesPacked
+     if BGMDriver has it and kAudioDeviceCustomPropertyAppVolumes otherwise.
+     */
+    void                SendAppVolumeChangesToBGMDevice(
+                                const std::vector<AppVolumeChange>& inAppVolumeChanges);
+    /*!
+     Send the changes to one instance of BGMDevice. If it doesn't have the definitions of the
+     changes' bundle ID tokens, they're sent as well.
+
+     @param inTokens The bundle ID token for each change, or kBGMAppVolumesPackedNoBundleID.
+     */
+    static void         SendAppVolumeChanges(BGMAudioDevice inDevice,
+                                             const std::vector<AppVolumeChange>& inAppVolumeChanges,
+                                             const std::vector<UInt32>& inTokens);
+    /*! Send the changes in the older kAudioDeviceCustomPropertyAppVolumes format. */
+    static void         SendAppVolumeChangesAsArray(
+                                BGMAudioDevice inDevice,
+                                const std::vector<AppVolumeChange>& inAppVolumeChanges);
+
     void                SendAppVolumeOrPanToBGMDevice(SInt32 inNewValue,
-                                                      CFStringRef inVolumeTypeKey,
+                                                      UInt32 inField,
                                                       pid_t inAppProcessID,
                                                       CFStringRef __nullable inAppBundleID);
 
+    /*! The changes waiting to be sent. Defined in BGMBackgroundMusicDevice.cpp. */
+    struct PendingAppVolumeChanges;
+    static PendingAppVolumeChanges& GetPendingAppVolumeChanges();
+
+    /*!
+     Add the changes to the pending changes and send them if nothing has been sent in the last
+     kAppVolumeSendIntervalMs. Otherwise, schedule them to be sent at the end of the interval.
+     */
+    void                QueueAppVolumeChanges(const std::vector<AppVolumeChange>& inAppVolumeChanges);
+    /*!
+     Send the pending changes, with inAppVolumeChanges merged into them, to BGMDevice. If sending
+     them throws, they're all put back in the pending changes, so the next send retries them.
+     */
+    void                SendPendingAppVolumeChanges(
+                                const std::vector<AppVolumeChange>& inAppVolumeChanges);
+    /*!
+     Add inChange to ioChanges, or, if ioChanges already has a change for the same app, replace the
+     fields of that change that inChange sets.
+     */
+    static void         MergeAppVolumeChange(std::vector<AppVolumeChange>& ioChanges,
+                                             const AppVolumeChange& inChange);
+
     static std::vector<CACFString>
                         ResponsibleBundleIDsOf(CACFString inParentBundleID);
 
@@ -141,6 +257,41 @@ public:
      */
     BGMDeviceAudibleState GetAudibleState() const;
 
+#pragma mark IO Stats
+
+public:
+    /*!
+     Get the timing statistics BGMDriver has recorded for BGMDevice's IO operations.
+
+     @param outStats Set to the value of the property if this function returns true.
+     @return False if BGMDevice doesn't have the property, i.e. BGMDriver was built without it.
+     @throws CAException If the HAL returns an error or the property's data is invalid, e.g. because
+                         it was written by an incompatible version of BGMDriver.
+     @see kAudioDeviceCustomPropertyIOStats in BGM_Types.h.
+     */
+    bool                GetIOStats(BGMDeviceIOStats& outStats) const;
+
+#pragma mark Music Ducking
+
+public:
+    /*!
+     Set BGMDevice's music ducking settings, i.e. whether BGMDriver should turn the music player down
+     while other audio is playing and how. See BGM_MusicDucker in BGMDriver.
+
+     @param inEnabled True to duck the music player.
+     @param inDepthDb How far to turn the music player down, in dB.
+     @param inAttackMs The time to turn the music player down once other audio starts.
+     @param inHoldMs The time to wait after the other audio stops.
+     @param inReleaseMs The time to turn the music player back up.
+     @throws CAException If the HAL returns an error.
+     @see kAudioDeviceCustomPropertyMusicDucking in BGM_Types.h.
+     */
+    void                SetMusicDucking(bool inEnabled,
+                                        Float32 inDepthDb,
+                                        Float32 inAttackMs,
+                                        Float32 inHoldMs,
+                                        Float32 inReleaseMs);
+
 #pragma mark Music Player
 
 public:
@@ -0,0 +1,586 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGMConvolver.cpp
+//  BGMApp
+//
+//  Copyright © 2026 Kyle Neideck
+//
+
+// Self Include
+#include "BGMConvolver.h"
+
+// Local Includes
+#include "BGM_Utils.h"
+
+// PublicUtility Includes
+#include "CADebugMacros.h"
+#include "CAException.h"
+
+// STL Includes
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <utility>
+
+// System Includes
+#include <CoreAudio/AudioHardwareBase.h>
+
+
+#pragma clang assume_nonnull begin
+
+#pragma mark Construction/Destruction
+
+BGMConvolver::BGMConvolver()
+{
+}
+
+BGMConvolver::~BGMConvolver()
+{
+    {
+        std::lock_guard<std::mutex> theLock(mLoaderMutex);
+        mStopLoader = true;
+    }
+
+    mLoaderCondition.notify_all();
+
+    if(mLoaderThread.joinable())
+    {
+        mLoaderThread.join();
+    }
+}
+
+#pragma mark Configuration
+
+void    BGMConvolver::Configure(UInt32 inChannelCount, UInt32 inMaxFramesPerBuffer)
+{
+    std::lock_guard<std::mutex> theLock(mLoaderMutex);
+
+    // Round the partition size up to a power of two for the FFT.
+    UInt32 thePartitionFrames = kMinPartitionFrames;
+
+    while(thePartitionFrames < inMaxFramesPerBuffer)
+    {
+        thePartitionFrames *= 2;
+    }
+
+    mChannelCount = inChannelCount;
+    mPartitionFrames = thePartitionFrames;
+    mBinCount = thePartitionFrames + 1;
+    mMaxPartitions = (kMaxImpulseResponseFrames + thePartitionFrames - 1) / thePartitionFrames;
+
+    mFFT.Configure(thePartitionFrames * 2);
+
+    const size_t theSpectraSize = size_t(inChannelCount) * mMaxPartitions * mBinCount;
+
+    for(ImpulseResponse& theImpulseResponse : mImpulseResponses)
+    {
+        theImpulseResponse.mChannelCount = 0;
+        theImpulseResponse.mPartitionCount = 0;
+        theImpulseResponse.mReal.assign(theSpectraSize, 0.0f);
+        theImpulseResponse.mImag.assign(theSpectraSize, 0.0f);
+    }
+
+    mFDLReal.assign(theSpectraSize, 0.0f);
+    mFDLImag.assign(theSpectraSize, 0.0f);
+    mInputBlocks.assign(size_t(inChannelCount) * thePartitionFrames * 2, 0.0f);
+    mOutputBlocks.assign(size_t(inChannelCount) * thePartitionFrames, 0.0f);
+    mTimeScratch.assign(thePartitionFrames * 2, 0.0f);
+    mSumReal.assign(mBinCount, 0.0f);
+    mSumImag.assign(mBinCount, 0.0f);
+
+    mPublishedIndex = kNoImpulseResponse;
+    mActive = false;
+    mBlockFill = 0;
+    mFDLHead = 0;
+    mFDLValidCount = 0;
+
+    // The IO thread isn't running, so the impulse response can be transformed for the new
+    // partition size here rather than on the loader thread.
+    mLoadPending = false;
+    PrepareImpulseResponse();
+}
+
+void    BGMConvolver::SetImpulseResponse(std::vector<Float32> inSamples, UInt32 inChannelCount)
+{
+    ThrowIf(inChannelCount == 0,
+            CAException(kAudioHardwareIllegalOperationError),
+            "BGMConvolver::SetImpulseResponse: No channels");
+
+    {
+        std::lock_guard<std::mutex> theLock(mLoaderMutex);
+
+        // Drop any partial frame and the frames past the maximum length.
+        const size_t theFrameCount = std::min(inSamples.size() / inChannelCount,
+                                              size_t(kMaxImpulseResponseFrames));
+        inSamples.resize(theFrameCount * inChannelCount);
+
+        mImpulseResponseSamples = std::move(inSamples);
+        mImpulseResponseChannelCount = inChannelCount;
+        mLoadPending = true;
+
+        if(!mLoaderThread.joinable())
+        {
+            StartLoaderThread();
+        }
+    }
+
+    mLoaderCondition.notify_all();
+}
+
+void    BGMConvolver::ClearImpulseResponse()
+{
+    std::lock_guard<std::mutex> theLock(mLoaderMutex);
+
+    mImpulseResponseSamples.clear();
+    mImpulseResponseChannelCount = 0;
+    mLoadPending = false;
+    mPublishedIndex = kNoImpulseResponse;
+}
+
+UInt32  BGMConvolver::GetLatencyFrames() const
+{
+    // mPartitionFrames is only changed by Configure, which can't be called during IO, and the IO
+    // thread only needs the published index.
+    return (mPublishedIndex.load() == kNoImpulseResponse) ? 0 : mPartitionFrames;
+}
+
+#pragma mark Loader Thread
+
+void    BGMConvolver::StartLoaderThread()
+{
+    mLoaderThread = std::thread([this] { LoaderThreadMain(); });
+}
+
+void    BGMConvolver::LoaderThreadMain()
+{
+    std::unique_lock<std::mutex> theLock(mLoaderMutex);
+
+    while(!mStopLoader)
+    {
+        mLoaderCondition.wait(theLock, [this] { return mLoadPending || mStopLoader; });
+
+        if(mLoadPending && !mStopLoader)
+        {
+            mLoadPending = false;
+            PrepareImpulseResponse();
+        }
+    }
+}
+
+void    BGMConvolver::PrepareImpulseResponse()
+{
+    if(mChannelCount == 0)
+    {
+        // Not configured yet. Configure will call this again.
+        return;
+    }
+
+    if(mImpulseResponseSamples.empty())
+    {
+        mPublishedIndex = kNoImpulseResponse;
+        return;
+    }
+
+    // Use the buffer that isn't published. The IO thread could still be reading it if it was
+    // published before the current one, but only until the end of its current IO cycle.
+    const SInt32 theIndex = (mPublishedIndex.load() == 0) ? 1 : 0;
+
+    while(mReadingIndex.load() == theIndex)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    ImpulseResponse& theImpulseResponse = mImpulseResponses[theIndex];
+
+    const UInt32 theSourceChannelCount = mImpulseResponseChannelCount;
+    const UInt32 theFrameCount = static_cast<UInt32>(mImpulseResponseSamples.size() / theSourceChannelCount);
+
+    theImpulseResponse.mChannelCount = std::min(theSourceChannelCount, mChannelCount);
+    theImpulseResponse.mPartitionCount =
+            std::min((theFrameCount + mPartitionFrames - 1) / mPartitionFrames, mMaxPartitions);
+
+    // The loader thread has its own FFT because mFFT's work buffers are used on the IO thread.
+    FFT theFFT;
+    theFFT.Configure(mPartitionFrames * 2);
+
+    // Scale the spectra so FFT::Inverse gives the convolution at unity gain.
+    const Float32 theScale = 1.0f / static_cast<Float32>(mPartitionFrames);
+    std::vector<Float32> theTime(mPartitionFrames * 2, 0.0f);
+
+    for(UInt32 theChannel = 0; theChannel < theImpulseResponse.mChannelCount; theChannel++)
+    {
+        for(UInt32 thePartition = 0; thePartition < theImpulseResponse.mPartitionCount; thePartition++)
+        {
+            // The partition goes in the first half of the FFT's input and the second half stays
+            // zero.
+            for(UInt32 i = 0; i < mPartitionFrames; i++)
+            {
+                const UInt32 theFrame = thePartition * mPartitionFrames + i;
+                theTime[i] = (theFrame < theFrameCount) ?
+                        mImpulseResponseSamples[size_t(theFrame) * theSourceChannelCount + theChannel] :
+                        0.0f;
+            }
+
+            const size_t theOffset =
+                    (size_t(theChannel) * mMaxPartitions + thePartition) * mBinCount;
+            Float32* theReal = &theImpulseResponse.mReal[theOffset];
+            Float32* theImag = &theImpulseResponse.mImag[theOffset];
+
+            theFFT.Forward(theTime.data(), theReal, theImag);
+
+            for(UInt32 theBin = 0; theBin < mBinCount; theBin++)
+            {
+                theReal[theBin] *= theScale;
+                theImag[theBin] *= theScale;
+            }
+        }
+    }
+
+    mPublishedIndex = theIndex;
+
+    DebugMsg("BGMConvolver::PrepareImpulseResponse: Loaded %u frames as %u partitions of %u frames",
+             theFrameCount,
+             theImpulseResponse.mPartitionCount,
+             mPartitionFrames);
+}
+
+#pragma mark Processing
+
+SInt32  BGMConvolver::AcquireImpulseResponseRT()
+{
+    // Mark the index as being read and then check it's still the published one. If the loader
+    // thread published a new one in between, it might not have seen the mark, so use the new one.
+    // These are sequentially consistent, so the loader thread can't miss the mark and then have
+    // the old index read here.
+    SInt32 theIndex = mPublishedIndex.load();
+
+    while(true)
+    {
+        mReadingIndex = theIndex;
+        const SInt32 thePublishedIndex = mPublishedIndex.load();
+
+        if(thePublishedIndex == theIndex)
+        {
+            return theIndex;
+        }
+
+        theIndex = thePublishedIndex;
+    }
+}
+
+void    BGMConvolver::ProcessRT(Float32* ioBuffer, UInt32 inFrameCount, UInt32 inChannelCount)
+{
+    if((inChannelCount != mChannelCount) || (mChannelCount == 0))
+    {
+        return;
+    }
+
+    const SInt32 theIndex = AcquireImpulseResponseRT();
+
+    if(theIndex == kNoImpulseResponse)
+    {
+        mActive = false;
+        mReadingIndex = kNoImpulseResponse;
+        return;
+    }
+
+    if(!mActive)
+    {
+        // Start from silence rather than whatever was left from the last time the convolver was
+        // active. The FDL's old slots are ignored until they've been refilled.
+        std::fill(mInputBlocks.begin(), mInputBlocks.end(), 0.0f);
+        std::fill(mOutputBlocks.begin(), mOutputBlocks.end(), 0.0f);
+        mBlockFill = 0;
+        mFDLValidCount = 0;
+        mActive = true;
+    }
+
+    const ImpulseResponse& theImpulseResponse = mImpulseResponses[theIndex];
+    const UInt32 theBlockFrames = mPartitionFrames * 2;
+    UInt32 theOffset = 0;
+
+    while(theOffset < inFrameCount)
+    {
+        const UInt32 theFrames = std::min(inFrameCount - theOffset, mPartitionFrames - mBlockFill);
+
+        // Collect the input for the current partition and play the output for the previous one.
+        for(UInt32 theChannel = 0; theChannel < mChannelCount; theChannel++)
+        {
+            Float32* theInput =
+                    &mInputBlocks[size_t(theChannel) * theBlockFrames + mPartitionFrames + mBlockFill];
+            const Float32* theOutput = &mOutputBlocks[size_t(theChannel) * mPartitionFrames + mBlockFill];
+            Float32* theSample = ioBuffer + size_t(theOffset) * mChannelCount + theChannel;
+
+            for(UInt32 i = 0; i < theFrames; i++)
+            {
+                theInput[i] = *theSample;
+                *theSample = theOutput[i];
+                theSample += mChannelCount;
+            }
+        }
+
+        mBlockFill += theFrames;
+        theOffset += theFrames;
+
+        if(mBlockFill == mPartitionFrames)
+        {
+            ProcessPartitionRT(theImpulseResponse);
+            mBlockFill = 0;
+        }
+    }
+
+    mReadingIndex = kNoImpulseResponse;
+}
+
+void    BGMConvolver::ProcessPartitionRT(const ImpulseResponse& inImpulseResponse)
+{
+    const UInt32 theBlockFrames = mPartitionFrames * 2;
+    const UInt32 theBinCount = mBinCount;
+
+    mFDLHead = (mFDLHead + 1) % mMaxPartitions;
+    mFDLValidCount = std::min(mFDLValidCount + 1, mMaxPartitions);
+
+    const UInt32 thePartitionCount = std::min(inImpulseResponse.mPartitionCount, mFDLValidCount);
+
+    for(UInt32 theChannel = 0; theChannel < mChannelCount; theChannel++)
+    {
+        Float32* theBlock = &mInputBlocks[size_t(theChannel) * theBlockFrames];
+        const size_t theFDLChannel = size_t(theChannel) * mMaxPartitions;
+
+        // Add the spectrum of the last two partitions of input to the FDL.
+        mFFT.Forward(theBlock,
+                     &mFDLReal[(theFDLChannel + mFDLHead) * theBinCount],
+                     &mFDLImag[(theFDLChannel + mFDLHead) * theBinCount]);
+
+        // Multiply each partition of the impulse response by the input from that many partitions
+        // ago and sum them.
+        const size_t theIRChannel = size_t(theChannel % inImpulseResponse.mChannelCount) * mMaxPartitions;
+
+        std::fill(mSumReal.begin(), mSumReal.end(), 0.0f);
+        std::fill(mSumImag.begin(), mSumImag.end(), 0.0f);
+
+        for(UInt32 thePartition = 0; thePartition < thePartitionCount; thePartition++)
+        {
+            const UInt32 theSlot = (mFDLHead + mMaxPartitions - thePartition) % mMaxPartitions;
+
+            MultiplyAccumulate(&mFDLReal[(theFDLChannel + theSlot) * theBinCount],
+                               &mFDLImag[(theFDLChannel + theSlot) * theBinCount],
+                               &inImpulseResponse.mReal[(theIRChannel + thePartition) * theBinCount],
+                               &inImpulseResponse.mImag[(theIRChannel + thePartition) * theBinCount],
+                               mSumReal.data(),
+                               mSumImag.data(),
+                               theBinCount);
+        }
+
+        // The second half of the inverse FFT is the output. The first half is the circular
+        // convolution's wrap-around, which overlap-save throws away.
+        mFFT.Inverse(mSumReal.data(), mSumImag.data(), mTimeScratch.data());
+        memcpy(&mOutputBlocks[size_t(theChannel) * mPartitionFrames],
+               &mTimeScratch[mPartitionFrames],
+               mPartitionFrames * sizeof(Float32));
+
+        // This partition's input becomes the previous partition's.
+        memcpy(theBlock, theBlock + mPartitionFrames, mPartitionFrames * sizeof(Float32));
+    }
+}
+
+// static
+void    BGMConvolver::MultiplyAccumulate(const Float32* __restrict inAReal,
+                                         const Float32* __restrict inAImag,
+                                         const Float32* __restrict inBReal,
+                                         const Float32* __restrict inBImag,
+                                         Float32* __restrict ioSumReal,
+                                         Float32* __restrict ioSumImag,
+                                         UInt32 inBinCount)
+{
+    // The pointers are restrict so the compiler can vectorise this. It's most of the convolver's
+    // work for long impulse responses.
+    for(UInt32 theBin = 0; theBin < inBinCount; theBin++)
+    {
+        ioSumReal[theBin] += inAReal[theBin] * inBReal[theBin] - inAImag[theBin] * inBImag[theBin];
+        ioSumImag[theBin] += inAReal[theBin] * inBImag[theBin] + inAImag[theBin] * inBReal[theBin];
+    }
+}
+
+#pragma mark FFT
+
+void    BGMConvolver::FFT::Configure(UInt32 inSize)
+{
+    BGMAssert((inSize >= 4) && ((inSize & (inSize - 1)) == 0),
+              "BGMConvolver::FFT::Configure: Size must be a power of two");
+
+    mSize = inSize;
+    mHalfSize = inSize / 2;
+
+    UInt32 theBits = 0;
+
+    while((1U << theBits) < mHalfSize)
+    {
+        theBits++;
+    }
+
+    mBitReversed.resize(mHalfSize);
+
+    for(UInt32 i = 0; i < mHalfSize; i++)
+    {
+        UInt32 theReversed = 0;
+
+        for(UInt32 theBit = 0; theBit < theBits; theBit++)
+        {
+            theReversed |= ((i >> theBit) & 1) << (theBits - 1 - theBit);
+        }
+
+        mBitReversed[i] = theReversed;
+    }
+
+    mTwiddleReal.resize(std::max(mHalfSize / 2, 1U));
+    mTwiddleImag.resize(std::max(mHalfSize / 2, 1U));
+
+    for(UInt32 k = 0; k < mHalfSize / 2; k++)
+    {
+        const Float64 theAngle = -2.0 * M_PI * k / mHalfSize;
+        mTwiddleReal[k] = static_cast<Float32>(cos(theAngle));
+        mTwiddleImag[k] = static_cast<Float32>(sin(theAngle));
+    }
+
+    mSplitReal.resize(mHalfSize + 1);
+    mSplitImag.resize(mHalfSize + 1);
+
+    for(UInt32 k = 0; k <= mHalfSize; k++)
+    {
+        const Float64 theAngle = -2.0 * M_PI * k / mSize;
+        mSplitReal[k] = static_cast<Float32>(cos(theAngle));
+        mSplitImag[k] = static_cast<Float32>(sin(theAngle));
+    }
+
+    mWorkReal.assign(mHalfSize, 0.0f);
+    mWorkImag.assign(mHalfSize, 0.0f);
+}
+
+void    BGMConvolver::FFT::Complex(Float32* ioReal, Float32* ioImag) const
+{
+    const UInt32 theSize = mHalfSize;
+
+    for(UInt32 i = 0; i < theSize; i++)
+    {
+        const UInt32 j = mBitReversed[i];
+
+        if(i < j)
+        {
+            std::swap(ioReal[i], ioReal[j]);
+            std::swap(ioImag[i], ioImag[j]);
+        }
+    }
+
+    for(UInt32 theHalf = 1; theHalf < theSize; theHalf *= 2)
+    {
+        const UInt32 theStride = theSize / (theHalf * 2);
+
+        for(UInt32 theStart = 0; theStart < theSize; theStart += theHalf * 2)
+        {
+            Float32* __restrict theTopReal = ioReal + theStart;
+            Float32* __restrict theTopImag = ioImag + theStart;
+            Float32* __restrict theBottomReal = ioReal + theStart + theHalf;
+            Float32* __restrict theBottomImag = ioImag + theStart + theHalf;
+
+            for(UInt32 j = 0; j < theHalf; j++)
+            {
+                const Float32 theWReal = mTwiddleReal[j * theStride];
+                const Float32 theWImag = mTwiddleImag[j * theStride];
+                const Float32 theReal = theWReal * theBottomReal[j] - theWImag * theBottomImag[j];
+                const Float32 theImag = theWReal * theBottomImag[j] + theWImag * theBottomReal[j];
+
+                theBottomReal[j] = theTopReal[j] - theReal;
+                theBottomImag[j] = theTopImag[j] - theImag;
+                theTopReal[j] += theReal;
+                theTopImag[j] += theImag;
+            }
+        }
+    }
+}
+
+void    BGMConvolver::FFT::Forward(const Float32* inTime, Float32* outReal, Float32* outImag)
+{
+    const UInt32 theHalfSize = mHalfSize;
+
+    // Treat the even samples as the real parts and the odd samples as the imaginary parts.
+    for(UInt32 i = 0; i < theHalfSize; i++)
+    {
+        mWorkReal[i] = inTime[i * 2];
+        mWorkImag[i] = inTime[i * 2 + 1];
+    }
+
+    Complex(mWorkReal.data(), mWorkImag.data());
+
+    // Separate the spectra of the even and odd samples and combine them.
+    for(UInt32 k = 0; k <= theHalfSize; k++)
+    {
+        const UInt32 theK = (k == theHalfSize) ? 0 : k;
+        const UInt32 theMirror = (k == 0) ? 0 : theHalfSize - k;
+
+        const Float32 theAReal = mWorkReal[theK];
+        const Float32 theAImag = mWorkImag[theK];
+        const Float32 theBReal = mWorkReal[theMirror];
+        const Float32 theBImag = -mWorkImag[theMirror];
+
+        const Float32 theEvenReal = 0.5f * (theAReal + theBReal);
+        const Float32 theEvenImag = 0.5f * (theAImag + theBImag);
+        const Float32 theOddReal = 0.5f * (theAImag - theBImag);
+        const Float32 theOddImag = -0.5f * (theAReal - theBReal);
+
+        outReal[k] = theEvenReal + mSplitReal[k] * theOddReal - mSplitImag[k] * theOddImag;
+        outImag[k] = theEvenImag + mSplitReal[k] * theOddImag + mSplitImag[k] * theOddReal;
+    }
+}
+
+void    BGMConvolver::FFT::Inverse(const Float32* inReal, const Float32* inImag, Float32* outTime)
+{
+    const UInt32 theHalfSize = mHalfSize;
+
+    // Rebuild the spectra of the even and odd samples and pack them into one complex spectrum.
+    for(UInt32 k = 0; k < theHalfSize; k++)
+    {
+        const Float32 theAReal = inReal[k];
+        const Float32 theAImag = inImag[k];
+        const Float32 theBReal = inReal[theHalfSize - k];
+        const Float32 theBImag = -inImag[theHalfSize - k];
+
+        const Float32 theEvenReal = 0.5f * (theAReal + theBReal);
+        const Float32 theEvenImag = 0.5f * (theAImag + theBImag);
+        const Float32 theDiffReal = 0.5f * (theAReal - theBReal);
+        const Float32 theDiffImag = 0.5f * (theAImag - theBImag);
+        // Multiply by the conjugate of the split twiddle.
+        const Float32 theOddReal = theDiffReal * mSplitReal[k] + theDiffImag * mSplitImag[k];
+        const Float32 theOddImag = theDiffImag * mSplitReal[k] - theDiffReal * mSplitImag[k];
+
+        mWorkReal[k] = theEvenReal - theOddImag;
+        mWorkImag[k] = theEvenImag + theOddReal;
+    }
+
+    // Swapping the real and imaginary parts makes the forward FFT an (unnormalised) inverse one.
+    Complex(mWorkImag.data(), mWorkReal.data());
+
+    for(UInt32 i = 0; i < theHalfSize; i++)
+    {
+        outTime[i * 2] = mWorkReal[i];
+        outTime[i * 2 + 1] = mWorkImag[i];
+    }
+}
+
+#pragma clang assume_nonnull end
+
@@ -0,0 +1,224 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGMConvolver.h
+//  BGMApp
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  Convolves the playthrough audio with an impulse response, e.g. to correct the frequency response
+//  of the user's speakers or headphones. BGMPlayThrough runs it on the output device's IO thread.
+//
+//  This is a uniformly partitioned overlap-save convolver. The impulse response is split into
+//  partitions of mPartitionFrames frames and each partition is transformed with an FFT twice that
+//  size. Each time a partition's worth of input has been collected, its spectrum is added to a
+//  frequency-domain delay line (FDL) and the output is the inverse FFT of the sum of the FDL's
+//  spectra multiplied by the impulse response's partitions. The cost per frame only grows with the
+//  number of partitions' multiply-adds, so impulse responses up to kMaxImpulseResponseFrames frames
+//  are practical. The output is delayed by one partition.
+//
+//  Everything the IO thread uses is allocated by Configure. Impulse responses are transformed on a
+//  loader thread into whichever of the two impulse response buffers the IO thread isn't using and
+//  then published by swapping an index, so the IO thread never waits for them.
+//
+
+#ifndef BGMApp__BGMConvolver
+#define BGMApp__BGMConvolver
+
+// STL Includes
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// System Includes
+#include <MacTypes.h>
+
+
+#pragma clang assume_nonnull begin
+
+class BGMConvolver
+{
+
+public:
+    // About 1.4 seconds at 48 kHz.
+    static const UInt32         kMaxImpulseResponseFrames = 65536;
+    // The partitions are at least this long, so tiny IO buffers don't make the FDL huge.
+    static const UInt32         kMinPartitionFrames = 64;
+
+public:
+                                BGMConvolver();
+                                ~BGMConvolver();
+                                BGMConvolver(const BGMConvolver&) = delete;
+                                BGMConvolver& operator=(const BGMConvolver&) = delete;
+
+    /*!
+     Allocate the FFT tables, delay lines and impulse response buffers for the output device.
+     The partition size is the device's IO buffer size, rounded up to a power of two, and the
+     impulse response, if there is one, is transformed again for it.
+
+     Not real-time safe. ProcessRT must not be running.
+
+     @param inChannelCount The number of interleaved channels ProcessRT will be given.
+     @param inMaxFramesPerBuffer Usually the output device's IO buffer size.
+     */
+    void                        Configure(UInt32 inChannelCount, UInt32 inMaxFramesPerBuffer);
+
+    /*!
+     Set the impulse response to convolve the audio with. It's transformed on the loader thread, so
+     this returns immediately and the IO thread switches to it a little later. Frames past
+     kMaxImpulseResponseFrames are ignored.
+
+     Can be called from any non-real-time thread.
+
+     @param inSamples The impulse response, at the output device's sample rate. Interleaved if it
+                      has more than one channel.
+     @param inChannelCount Output channel n is convolved with channel (n % inChannelCount).
+     */
+    void                        SetImpulseResponse(std::vector<Float32> inSamples,
+                                                   UInt32 inChannelCount);
+
+    /*! Stop convolving the audio. Can be called from any non-real-time thread. */
+    void                        ClearImpulseResponse();
+
+    /*!
+     @return The number of frames the convolution delays the audio by, which is one partition, or
+             0 if it's not convolving the audio. Can be called from any thread.
+     */
+    UInt32                      GetLatencyFrames() const;
+
+    /*!
+     Convolve the audio in ioBuffer with the current impulse response. Leaves it unchanged, without
+     any delay, if there isn't one or inChannelCount doesn't match the one given to Configure.
+
+     Real-time safe. Should only be called on one thread at a time.
+
+     @param ioBuffer Interleaved, inChannelCount channels.
+     */
+    void                        ProcessRT(Float32* ioBuffer,
+                                          UInt32 inFrameCount,
+                                          UInt32 inChannelCount);
+
+private:
+    // A real FFT, done as a complex FFT of half the size. The tables are precomputed by Configure,
+    // so the transforms don't allocate.
+    class FFT
+    {
+    public:
+        void                    Configure(UInt32 inSize);
+
+        // Transforms mSize real samples into mSize / 2 + 1 bins.
+        void                    Forward(const Float32* inTime, Float32* outReal, Float32* outImag);
+        // The inverse of Forward, except that the result is multiplied by mSize / 2.
+        void                    Inverse(const Float32* inReal, const Float32* inImag, Float32* outTime);
+
+    private:
+        // An unnormalised, in-place complex FFT of mHalfSize points. Swapping ioReal and ioImag
+        // makes it an inverse FFT.
+        void                    Complex(Float32* ioReal, Float32* ioImag) const;
+
+        UInt32                  mSize = 0;
+        UInt32                  mHalfSize = 0;
+        std::vector<UInt32>     mBitReversed;
+        // e^(-2πik / mHalfSize) for k in [0, mHalfSize / 2).
+        std::vector<Float32>    mTwiddleReal;
+        std::vector<Float32>    mTwiddleImag;
+        // e^(-2πik / mSize) for k in [0, mHalfSize].
+        std::vector<Float32>    mSplitReal;
+        std::vector<Float32>    mSplitImag;
+        std::vector<Float32>    mWorkReal;
+        std::vector<Float32>    mWorkImag;
+    };
+
+    struct ImpulseResponse
+    {
+        UInt32                  mChannelCount = 0;
+        UInt32                  mPartitionCount = 0;
+        // Indexed by channel, then partition, then bin. Already scaled for FFT::Inverse.
+        std::vector<Float32>    mReal;
+        std::vector<Float32>    mImag;
+    };
+
+    static const SInt32         kNoImpulseResponse = -1;
+
+    void                        StartLoaderThread();
+    void                        LoaderThreadMain();
+    // Transforms mImpulseResponseSamples into the buffer the IO thread isn't reading and publishes
+    // it. mLoaderMutex must be held.
+    void                        PrepareImpulseResponse();
+
+    // Reads the index of the latest impulse response and marks it as being read, so the loader
+    // thread won't overwrite it. Real-time safe.
+    SInt32                      AcquireImpulseResponseRT();
+    void                        ProcessPartitionRT(const ImpulseResponse& inImpulseResponse);
+    // ioSum += inA * inB, for complex spectra of inBinCount bins.
+    static void                 MultiplyAccumulate(const Float32* __restrict inAReal,
+                                                   const Float32* __restrict inAImag,
+                                                   const Float32* __restrict inBReal,
+                                                   const Float32* __restrict inBImag,
+                                                   Float32* __restrict ioSumReal,
+                                                   Float32* __restrict ioSumImag,
+                                                   UInt32 inBinCount);
+
+private:
+    // Guards the configuration, the impulse response samples and the loader thread's state. Never
+    // taken on the IO thread.
+    std::mutex                  mLoaderMutex;
+    std::condition_variable     mLoaderCondition;
+    std::thread                 mLoaderThread;
+    bool                        mLoadPending = false;
+    bool                        mStopLoader = false;
+
+    std::vector<Float32>        mImpulseResponseSamples;
+    UInt32                      mImpulseResponseChannelCount = 0;
+
+    UInt32                      mChannelCount = 0;
+    UInt32                      mPartitionFrames = 0;
+    UInt32                      mBinCount = 0;
+    UInt32                      mMaxPartitions = 0;
+
+    ImpulseResponse             mImpulseResponses[2];
+    // The index in mImpulseResponses of the latest impulse response, or kNoImpulseResponse.
+    std::atomic<SInt32>         mPublishedIndex { kNoImpulseResponse };
+    // The index the IO thread is reading, or kNoImpulseResponse.
+    std::atomic<SInt32>         mReadingIndex { kNoImpulseResponse };
+
+    // Only used on the IO thread.
+    FFT                         mFFT;
+    bool                        mActive = false;
+    // The number of frames of the current partition that have been collected.
+    UInt32                      mBlockFill = 0;
+    // The FDL, indexed by channel, then slot, then bin. mFDLHead is the newest slot.
+    std::vector<Float32>        mFDLReal;
+    std::vector<Float32>        mFDLImag;
+    UInt32                      mFDLHead = 0;
+    // The number of slots filled since the convolver was last (re)activated.
+    UInt32                      mFDLValidCount = 0;
+    // For each channel, the previous partition's input followed by the current one's.
+    std::vector<Float32>        mInputBlocks;
+    // For each channel, the output for the previous partition, which is played during this one.
+    std::vector<Float32>        mOutputBlocks;
+    std::vector<Float32>        mTimeScratch;
+    std::vector<Float32>        mSumReal;
+    std::vector<Float32>        mSumImag;
+
+};
+
+#pragma clang assume_nonnull end
+
+#endif /* BGMApp__BGMConvolver */
+
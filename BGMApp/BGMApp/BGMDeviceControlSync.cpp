@@ -107,6 +107,13 @@ void    BGMDeviceControlSync::Activate()
         }
         
         mActive = true;
+
+        if(mGainStagingEnabled)
+        {
+            BGMLogAndSwallowExceptionsMsg("BGMDeviceControlSync::Activate", "Gain staging", [&] {
+                UpdateOutputVolume();
+            });
+        }
     }
     else
     {
@@ -125,6 +132,17 @@ void    BGMDeviceControlSync::Deactivate()
         // Deregister listeners
         if(mBGMDevice.GetObjectID() != kAudioDeviceUnknown)
         {
+            // Take the gain staging boost off the output device so it isn't left louder than
+            // BGMDevice.
+            if(mGainStaging.GetBoostDb() != 0.0f)
+            {
+                BGMLogAndSwallowExceptionsMsg("BGMDeviceControlSync::Deactivate", "Gain staging", [&] {
+                    mOutputDevice.CopyVolumeFrom(mBGMDevice, kAudioObjectPropertyScopeOutput);
+                    mGainStaging.ResetBoost();
+                    SendAppVolumes();
+                });
+            }
+
             BGMLogAndSwallowExceptions("BGMDeviceControlSync::Deactivate", [&] {
                 mBGMDevice.RemovePropertyListener(kVolumePropertyAddress,
                                                   &BGMDeviceControlSync::BGMDeviceListenerProc,
@@ -148,7 +166,8 @@ void    BGMDeviceControlSync::Deactivate()
 
 #pragma mark Accessors
 
-void    BGMDeviceControlSync::SetDevices(AudioObjectID inBGMDevice, AudioObjectID inOutputDevice)
+void    BGMDeviceControlSync::SetDevices(const BGMBackgroundMusicDevice& inBGMDevice,
+                                         AudioObjectID inOutputDevice)
 {
     CAMutex::Locker locker(mMutex);
 
@@ -156,8 +175,9 @@ void    BGMDeviceControlSync::SetDevices(AudioObjectID inBGMDevice, AudioObjectI
 
     Deactivate();
 
-    mBGMDevice = inBGMDevice;
-    mBGMDeviceControlsList.SetBGMDevice(inBGMDevice);
+    mBGMDevice = inBGMDevice.GetObjectID();
+    mBackgroundMusicDevice.reset(new BGMBackgroundMusicDevice(inBGMDevice));
+    mBGMDeviceControlsList.SetBGMDevice(inBGMDevice.GetObjectID());
     mOutputDevice = inOutputDevice;
     
     if(wasActive)
@@ -166,6 +186,116 @@ void    BGMDeviceControlSync::SetDevices(AudioObjectID inBGMDevice, AudioObjectI
     }
 }
 
+#pragma mark Gain Staging
+
+void    BGMDeviceControlSync::SetGainStagingEnabled(bool inEnabled)
+{
+    CAMutex::Locker locker(mMutex);
+
+    if(inEnabled != mGainStagingEnabled)
+    {
+        DebugMsg("BGMDeviceControlSync::SetGainStagingEnabled: %s gain staging",
+                 inEnabled ? "Enabling" : "Disabling");
+
+        mGainStagingEnabled = inEnabled;
+
+        if(mActive)
+        {
+            UpdateOutputVolume();
+        }
+    }
+}
+
+void    BGMDeviceControlSync::SetAppVolume(SInt32 inVolume,
+                                           pid_t inAppProcessID,
+                                           CFStringRef __nullable inAppBundleID)
+{
+    CAMutex::Locker locker(mMutex);
+
+    mGainStaging.SetAppVolume(inVolume, inAppProcessID, inAppBundleID);
+
+    bool boostChanged = false;
+
+    if(mGainStagingEnabled && mActive)
+    {
+        boostChanged = mGainStaging.UpdateOutputVolume(mBGMDevice, mOutputDevice);
+    }
+
+    if(boostChanged)
+    {
+        // Every app's volume depends on the boost, so send them all together. Send them now rather
+        // than queueing them so they change at the same time as the output device's volume.
+        SendAppVolumes();
+    }
+    else if(mGainStaging.GetBoostDb() != 0.0f)
+    {
+        // This is called for each step as the user drags an app's volume slider, so queue the
+        // volumes to have them coalesced. See BGMBackgroundMusicDevice::QueueAppVolumes.
+        GetBackgroundMusicDevice().QueueAppVolumes(mGainStaging.GetStagedAppVolumes());
+    }
+    else
+    {
+        BGMBackgroundMusicDevice::AppVolume appVolume;
+        appVolume.mVolume = inVolume;
+        appVolume.mProcessID = inAppProcessID;
+
+        if(inAppBundleID)
+        {
+            appVolume.mBundleID = inAppBundleID;
+        }
+
+        GetBackgroundMusicDevice().QueueAppVolumes({ appVolume });
+    }
+}
+
+Float32 BGMDeviceControlSync::GetOutputVolumeBoostDb()
+{
+    CAMutex::Locker locker(mMutex);
+    return mGainStaging.GetBoostDb();
+}
+
+void    BGMDeviceControlSync::UpdateOutputVolume()
+{
+    bool boostChanged;
+
+    if(mGainStagingEnabled)
+    {
+        boostChanged = mGainStaging.UpdateOutputVolume(mBGMDevice, mOutputDevice);
+    }
+    else
+    {
+        mOutputDevice.CopyVolumeFrom(mBGMDevice, kAudioObjectPropertyScopeOutput);
+        boostChanged = mGainStaging.ResetBoost();
+    }
+
+    if(boostChanged)
+    {
+        DebugMsg("BGMDeviceControlSync::UpdateOutputVolume: Output device boost changed to %f dB",
+                 mGainStaging.GetBoostDb());
+        SendAppVolumes();
+    }
+}
+
+void    BGMDeviceControlSync::SendAppVolumes()
+{
+    std::vector<BGMBackgroundMusicDevice::AppVolume> appVolumes =
+            mGainStaging.GetStagedAppVolumes();
+
+    if(!appVolumes.empty())
+    {
+        GetBackgroundMusicDevice().SetAppVolumes(appVolumes);
+    }
+}
+
+BGMBackgroundMusicDevice& BGMDeviceControlSync::GetBackgroundMusicDevice()
+{
+    ThrowIf(!mBackgroundMusicDevice,
+            BGM_DeviceNotSetException(),
+            "BGMDeviceControlSync::GetBackgroundMusicDevice: BGMDevice isn't set");
+
+    return *mBackgroundMusicDevice;
+}
+
 #pragma mark Listener Procs
 
 // static
@@ -210,7 +340,7 @@ OSStatus    BGMDeviceControlSync::BGMDeviceListenerProc(AudioObjectID inObjectID
                     // Update the output device's volume.
                     if(checkState())
                     {
-                        refCon->mOutputDevice.CopyVolumeFrom(refCon->mBGMDevice, scope);
+                        refCon->UpdateOutputVolume();
                     }
                 }
                 break;
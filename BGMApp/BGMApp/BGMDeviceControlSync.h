@@ -27,6 +27,9 @@
 //  When the value of one of BGMDevice's controls is changed, BGMDeviceControlSync copies the new
 //  value to the output device.
 //
+//  If gain staging is enabled, the output device's volume is raised above BGMDevice's to absorb
+//  boosted app volumes and the apps are turned down to match. See BGMGainStaging.
+//
 //  Thread safe.
 //
 
@@ -35,12 +38,17 @@
 
 // Local Includes
 #include "BGMAudioDevice.h"
+#include "BGMBackgroundMusicDevice.h"
 #include "BGMDeviceControlsList.h"
+#include "BGMGainStaging.h"
 
 // PublicUtility Includes
 #include "CAHALAudioSystemObject.h"
 #include "CAMutex.h"
 
+// STL Includes
+#include <memory>
+
 // System Includes
 #include <AudioToolbox/AudioServices.h>
 
@@ -84,14 +92,58 @@ public:
 #pragma mark Accessors
 
     /*!
-     Set the IDs of BGMDevice and the output device to synchronise with.
+     Set BGMDevice and the ID of the output device to synchronise with. The app volumes are sent to
+     inBGMDevice.
 
      @throws BGM_DeviceNotSetException if BGMDevice isn't set.
      @throws CAException if the HAL or one of the new devices returns an error while restarting
                          synchronisation. This BGMDeviceControlSync will be deactivated if this
                          function throws, but its devices will still be set.
      */
-    void                SetDevices(AudioObjectID inBGMDevice, AudioObjectID inOutputDevice);
+    void                SetDevices(const BGMBackgroundMusicDevice& inBGMDevice,
+                                   AudioObjectID inOutputDevice);
+
+#pragma mark Gain Staging
+
+    /*!
+     Enable or disable moving the gain of boosted app volumes to the output device. Disabled by
+     default. When it's disabled, the output device's volume is copied from BGMDevice unchanged and
+     the app volumes are sent to BGMDevice as requested.
+
+     @throws CAException If the HAL returns an error while updating the output device's volume or
+                         the app volumes.
+     */
+    void                SetGainStagingEnabled(bool inEnabled);
+
+    /*!
+     Set an app's volume. Use this instead of BGMBackgroundMusicDevice::SetAppVolume so the app
+     volumes can be compensated for the output device's boost. If that changes, the other apps'
+     volumes are updated in the same batch. The parameters are the same as SetAppVolume's.
+
+     Unless the boost changes, the volumes are queued and coalesced, like SetAppVolume's.
+
+     @throws CAException If the HAL returns an error.
+     */
+    void                SetAppVolume(SInt32 inVolume,
+                                     pid_t inAppProcessID,
+                                     CFStringRef __nullable inAppBundleID);
+
+    /*! @return The amount the output device's volume is currently raised by, in dB. */
+    Float32             GetOutputVolumeBoostDb();
+
+private:
+    /*!
+     Copy BGMDevice's volume to the output device, plus the boost if gain staging is enabled, and
+     resend the app volumes if the boost changed. mMutex must be held.
+     */
+    void                UpdateOutputVolume();
+    /*! Send the app volumes, compensated for the current boost, to BGMDevice. */
+    void                SendAppVolumes();
+    /*!
+     @return The BGMDevice set by SetDevices, to send the app volumes to. mMutex must be held.
+     @throws BGM_DeviceNotSetException if SetDevices hasn't been called.
+     */
+    BGMBackgroundMusicDevice& GetBackgroundMusicDevice();
 
 #pragma mark Listener Procs
     
@@ -110,8 +162,15 @@ private:
     
     BGMAudioDevice      mBGMDevice     { (AudioObjectID)kAudioObjectUnknown };
     BGMAudioDevice      mOutputDevice  { (AudioObjectID)kAudioObjectUnknown };
+    // The same device as mBGMDevice. Kept so sending the app volumes doesn't have to look BGMDevice
+    // up each time. Null until SetDevices is called, because BGMBackgroundMusicDevice's constructor
+    // queries the HAL and throws if BGMDevice isn't installed.
+    std::unique_ptr<BGMBackgroundMusicDevice> mBackgroundMusicDevice;
 
     BGMDeviceControlsList mBGMDeviceControlsList;
+
+    bool                mGainStagingEnabled = false;
+    BGMGainStaging      mGainStaging;
     
 };
 
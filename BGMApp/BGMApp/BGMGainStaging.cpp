@@ -0,0 +1,212 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGMGainStaging.cpp
+//  BGMApp
+//
+//  Copyright © 2026 Kyle Neideck
+//
+
+// Self Include
+#include "BGMGainStaging.h"
+
+// Local Includes
+#include "BGM_Types.h"
+
+// STL Includes
+#include <algorithm>
+#include <cmath>
+
+
+#pragma clang assume_nonnull begin
+
+// BGMDriver scales the relative volume curve's output by this, so the maximum app volume is +12 dB.
+static const Float32 kMaxAppGain = 4.0f;
+
+static const AudioObjectPropertyScope kScope = kAudioObjectPropertyScopeOutput;
+
+#pragma mark Construction/Destruction
+
+BGMGainStaging::BGMGainStaging()
+{
+    mRelativeVolumeCurve.AddRange(kAppRelativeVolumeMinRawValue,
+                                  kAppRelativeVolumeMaxRawValue,
+                                  kAppRelativeVolumeMinDbValue,
+                                  kAppRelativeVolumeMaxDbValue);
+}
+
+#pragma mark App Volumes
+
+void BGMGainStaging::SetAppVolume(SInt32 inVolume,
+                                  pid_t inAppProcessID,
+                                  CFStringRef __nullable inAppBundleID)
+{
+    inVolume = std::max(kAppRelativeVolumeMinRawValue, inVolume);
+    inVolume = std::min(kAppRelativeVolumeMaxRawValue, inVolume);
+
+    for(BGMBackgroundMusicDevice::AppVolume& appVolume : mAppVolumes)
+    {
+        bool pidMatches = (inAppProcessID != -1) && (appVolume.mProcessID == inAppProcessID);
+        bool bundleIDMatches = inAppBundleID && appVolume.mBundleID.IsEqualTo(inAppBundleID);
+
+        if(pidMatches || bundleIDMatches)
+        {
+            appVolume.mVolume = inVolume;
+
+            // Fill in whichever IDs we didn't have.
+            if(appVolume.mProcessID == -1)
+            {
+                appVolume.mProcessID = inAppProcessID;
+            }
+
+            if(!appVolume.mBundleID.IsValid() && inAppBundleID)
+            {
+                appVolume.mBundleID = inAppBundleID;
+            }
+
+            return;
+        }
+    }
+
+    BGMBackgroundMusicDevice::AppVolume appVolume;
+    appVolume.mVolume = inVolume;
+    appVolume.mProcessID = inAppProcessID;
+
+    if(inAppBundleID)
+    {
+        // Retains the string.
+        appVolume.mBundleID = inAppBundleID;
+    }
+
+    mAppVolumes.push_back(appVolume);
+}
+
+std::vector<BGMBackgroundMusicDevice::AppVolume> BGMGainStaging::GetStagedAppVolumes() const
+{
+    // The output device is raised by mBoostDb, so turn each app down by the same amount.
+    Float32 compensation = powf(10.0f, -mBoostDb / 20.0f);
+
+    std::vector<BGMBackgroundMusicDevice::AppVolume> stagedAppVolumes = mAppVolumes;
+
+    for(BGMBackgroundMusicDevice::AppVolume& appVolume : stagedAppVolumes)
+    {
+        appVolume.mVolume = AppVolumeForGain(GainForAppVolume(appVolume.mVolume) * compensation);
+    }
+
+    return stagedAppVolumes;
+}
+
+#pragma mark Output Volume
+
+bool BGMGainStaging::UpdateOutputVolume(const BGMAudioDevice& inBGMDevice,
+                                        BGMAudioDevice& inOutputDevice)
+{
+    Float32 boostDb = 0.0f;
+
+    if(inBGMDevice.HasVolumeControl(kScope, kMasterChannel) &&
+       inOutputDevice.HasSettableMasterVolume(kScope))
+    {
+        Float32 userVolume = inBGMDevice.GetVolumeControlScalarValue(kScope, kMasterChannel);
+
+        // Don't make the output device audible if the user has turned it all the way down.
+        if(userVolume > 0.0f)
+        {
+            Float32 userVolumeDb =
+                    inOutputDevice.GetVolumeControlDecibelForScalarValue(kScope,
+                                                                         kMasterChannel,
+                                                                         userVolume);
+            Float32 maxVolumeDb =
+                    inOutputDevice.GetVolumeControlDecibelForScalarValue(kScope,
+                                                                         kMasterChannel,
+                                                                         1.0f);
+
+            boostDb = CalculateBoostDb(GetRequiredBoostDb(), userVolumeDb, maxVolumeDb);
+
+            if(boostDb > 0.0f)
+            {
+                inOutputDevice.SetVolumeControlDecibelValue(kScope,
+                                                            kMasterChannel,
+                                                            userVolumeDb + boostDb);
+            }
+        }
+
+        if(boostDb == 0.0f)
+        {
+            // Copy the scalar value directly so nothing changes when there's no boost.
+            inOutputDevice.SetVolumeControlScalarValue(kScope, kMasterChannel, userVolume);
+        }
+    }
+    else
+    {
+        inOutputDevice.CopyVolumeFrom(inBGMDevice, kScope);
+    }
+
+    bool boostChanged = (boostDb != mBoostDb);
+    mBoostDb = boostDb;
+
+    return boostChanged;
+}
+
+bool BGMGainStaging::ResetBoost()
+{
+    bool hadBoost = (mBoostDb != 0.0f);
+    mBoostDb = 0.0f;
+    return hadBoost;
+}
+
+Float32 BGMGainStaging::GetRequiredBoostDb() const
+{
+    Float32 maxGain = 1.0f;
+
+    for(const BGMBackgroundMusicDevice::AppVolume& appVolume : mAppVolumes)
+    {
+        maxGain = std::max(maxGain, GainForAppVolume(appVolume.mVolume));
+    }
+
+    return 20.0f * log10f(maxGain);
+}
+
+#pragma mark Gain Calculations
+
+Float32 BGMGainStaging::GainForAppVolume(SInt32 inVolume) const
+{
+    return mRelativeVolumeCurve.ConvertRawToScalar(inVolume) * kMaxAppGain;
+}
+
+SInt32 BGMGainStaging::AppVolumeForGain(Float32 inGain) const
+{
+    // ConvertScalarToRaw clamps the scalar to [0, 1].
+    return mRelativeVolumeCurve.ConvertScalarToRaw(inGain / kMaxAppGain);
+}
+
+// static
+Float32 BGMGainStaging::CalculateBoostDb(Float32 inRequiredBoostDb,
+                                         Float32 inUserVolumeDb,
+                                         Float32 inMaxVolumeDb)
+{
+    Float32 headroomDb = inMaxVolumeDb - inUserVolumeDb;
+
+    // The comparisons are written this way so NaNs give no boost.
+    if(!(headroomDb > 0.0f) || !(inRequiredBoostDb > 0.0f))
+    {
+        return 0.0f;
+    }
+
+    return std::min(inRequiredBoostDb, headroomDb);
+}
+
+#pragma clang assume_nonnull end
+
@@ -0,0 +1,146 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGMGainStaging.h
+//  BGMApp
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  Moves the gain of boosted app volumes from BGMDriver to the output device.
+//
+//  An app volume above the midpoint makes BGMDriver multiply the app's samples by up to 4 (+12 dB),
+//  which clips if the app's audio is already near full scale. When an app's volume is boosted,
+//  BGMGainStaging raises the output device's volume by as much of the boost as the device has
+//  headroom for and turns every app it knows about down by the same amount. The relative levels
+//  stay the same, but the gain is applied after the audio leaves BGMDriver's Float32 mix.
+//
+//  Only apps BGMApp has set a volume for are turned down, so other audio, e.g. from processes that
+//  aren't listed in BGMApp's menu, will be louder while the output device is raised. If the output
+//  device is already at full volume, BGMDriver still applies (and clips) the boost.
+//
+//  Not thread safe.
+//
+
+#ifndef BGMApp__BGMGainStaging
+#define BGMApp__BGMGainStaging
+
+// Local Includes
+#include "BGMAudioDevice.h"
+#include "BGMBackgroundMusicDevice.h"
+
+// PublicUtility Includes
+#include "CAVolumeCurve.h"
+
+// STL Includes
+#include <vector>
+
+
+#pragma clang assume_nonnull begin
+
+class BGMGainStaging
+{
+
+#pragma mark Construction/Destruction
+
+public:
+                        BGMGainStaging();
+
+#pragma mark App Volumes
+
+public:
+    /*!
+     Record the volume BGMApp has requested for an app. Replaces the app's previous volume, if it
+     has one. Apps are matched by process ID or bundle ID, like in BGMDriver.
+
+     @param inVolume A raw app volume, as in BGMBackgroundMusicDevice::SetAppVolume.
+     @param inAppProcessID The app's process ID, or -1 to omit it.
+     @param inAppBundleID The app's bundle ID, or null to omit it.
+     */
+    void                SetAppVolume(SInt32 inVolume,
+                                     pid_t inAppProcessID,
+                                     CFStringRef __nullable inAppBundleID);
+
+    /*! @return The volumes that were requested for the apps, without any compensation. */
+    std::vector<BGMBackgroundMusicDevice::AppVolume>
+                        GetRequestedAppVolumes() const { return mAppVolumes; }
+    /*!
+     @return The volumes to send to BGMDevice, i.e. the requested volumes turned down by the boost
+             currently applied to the output device.
+     */
+    std::vector<BGMBackgroundMusicDevice::AppVolume>
+                        GetStagedAppVolumes() const;
+
+#pragma mark Output Volume
+
+public:
+    /*!
+     Copy BGMDevice's volume to the output device, raised by as much of the required boost as the
+     output device has room for. Falls back to BGMAudioDevice::CopyVolumeFrom without a boost if
+     either device has no settable master volume control.
+
+     @return True if the boost changed, in which case the caller should send the staged app volumes
+             to BGMDevice again.
+     @throws CAException If the HAL returns an error.
+     */
+    bool                UpdateOutputVolume(const BGMAudioDevice& inBGMDevice,
+                                           BGMAudioDevice& inOutputDevice);
+
+    /*!
+     Forget the boost, e.g. after setting the output device's volume back to BGMDevice's. Doesn't
+     change any devices.
+
+     @return True if there was a boost.
+     */
+    bool                ResetBoost();
+
+    /*! @return The boost currently applied to the output device, in dB. */
+    Float32             GetBoostDb() const { return mBoostDb; }
+    /*! @return The boost needed to play the loudest app at its requested volume, in dB. */
+    Float32             GetRequiredBoostDb() const;
+
+#pragma mark Gain Calculations
+
+public:
+    /*! @return The gain BGMDriver multiplies an app's samples by for a raw app volume. */
+    Float32             GainForAppVolume(SInt32 inVolume) const;
+    /*! @return The raw app volume closest to the given gain. */
+    SInt32              AppVolumeForGain(Float32 inGain) const;
+
+    /*!
+     @param inRequiredBoostDb See GetRequiredBoostDb.
+     @param inUserVolumeDb The volume the user has set, in the output device's dB.
+     @param inMaxVolumeDb The output device's maximum volume, in dB.
+     @return The boost to apply to the output device, in dB. Never negative and never more than the
+             output device's headroom.
+     */
+    static Float32      CalculateBoostDb(Float32 inRequiredBoostDb,
+                                         Float32 inUserVolumeDb,
+                                         Float32 inMaxVolumeDb);
+
+private:
+    // Matches BGM_Clients::mRelativeVolumeCurve in BGMDriver.
+    CAVolumeCurve       mRelativeVolumeCurve;
+
+    std::vector<BGMBackgroundMusicDevice::AppVolume> mAppVolumes;
+
+    Float32             mBoostDb = 0.0f;
+
+};
+
+#pragma clang assume_nonnull end
+
+#endif /* BGMApp__BGMGainStaging */
+
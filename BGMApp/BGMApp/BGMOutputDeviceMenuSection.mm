@@ -197,7 +197,7 @@ static NSInteger const kOutputDeviceMenuItemTag = 5;
     }
 }
 
-- (NSArray<NSMenuItem*>*) createMenuItemsForDevice:(CAHALAudioDevice)device {
+- (NSArray<NSMenuItem*>*) createMenuItemsForDevice:(BGMAudioDevice)device {
     // We fill this array with a menu item for each output device (or each data source for each device) on
     // the system.
     NSMutableArray<NSMenuItem*>* items = [NSMutableArray new];
@@ -257,7 +257,7 @@ static NSInteger const kOutputDeviceMenuItemTag = 5;
     return items;
 }
 
-- (NSMenuItem*) createMenuItemForDevice:(CAHALAudioDevice)device
+- (NSMenuItem*) createMenuItemForDevice:(BGMAudioDevice)device
                            dataSourceID:(NSNumber* __nullable)dataSourceID
                                   title:(NSString* __nullable)title
                                 toolTip:(NSString* __nullable)toolTip {
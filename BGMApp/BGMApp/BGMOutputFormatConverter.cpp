@@ -0,0 +1,453 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGMOutputFormatConverter.cpp
+//  BGMApp
+//
+//  Copyright © 2026 Kyle Neideck
+//
+
+// Self Include
+#include "BGMOutputFormatConverter.h"
+
+// PublicUtility Includes
+#include "CADebugMacros.h"
+#include "CAException.h"
+
+// STL Includes
+#include <algorithm>
+#include <cstring>
+
+// System Includes
+#include <CoreAudio/AudioHardwareBase.h>
+
+
+#pragma clang assume_nonnull begin
+
+#pragma mark Configuration
+
+void    BGMOutputFormatConverter::Configure(UInt32 inSourceChannelCount,
+                                            const std::vector<AudioStreamBasicDescription>& inStreamFormats,
+                                            const std::vector<UInt32>& inChannelMap,
+                                            UInt32 inMaxFramesPerBuffer)
+{
+    // Leave the converter unconfigured if this throws.
+    mSourceChannelCount = 0;
+    mMaxFramesPerBuffer = 0;
+    mIsPassthrough = false;
+    mBuffers.clear();
+    mRoutes.clear();
+    mRouteSources.clear();
+
+    std::vector<DestinationBuffer> theBuffers;
+    UInt32 theDeviceChannelCount = 0;
+
+    for(const AudioStreamBasicDescription& theFormat : inStreamFormats)
+    {
+        const bool theIsNonInterleaved = (theFormat.mFormatFlags & kAudioFormatFlagIsNonInterleaved) != 0;
+        const UInt32 theBufferCount = theIsNonInterleaved ? theFormat.mChannelsPerFrame : 1;
+
+        for(UInt32 i = 0; i < theBufferCount; i++)
+        {
+            DestinationBuffer theBuffer = MakeDestinationBuffer(theFormat);
+            theBuffer.mFirstRoute = theDeviceChannelCount;
+            theDeviceChannelCount += theBuffer.mChannelCount;
+            theBuffers.push_back(theBuffer);
+        }
+    }
+
+    mRoutes.resize(theDeviceChannelCount);
+
+    // Group the source channels by the device channel they're routed to.
+    for(UInt32 theDeviceChannel = 0; theDeviceChannel < mRoutes.size(); theDeviceChannel++)
+    {
+        Route& theRoute = mRoutes[theDeviceChannel];
+        theRoute.mFirstSource = static_cast<UInt32>(mRouteSources.size());
+
+        for(UInt32 theSourceChannel = 0;
+            theSourceChannel < std::min(inSourceChannelCount, static_cast<UInt32>(inChannelMap.size()));
+            theSourceChannel++)
+        {
+            if(inChannelMap[theSourceChannel] == theDeviceChannel + 1)
+            {
+                mRouteSources.push_back(theSourceChannel);
+                theRoute.mSourceCount++;
+            }
+        }
+
+        theRoute.mGain = (theRoute.mSourceCount > 1) ? (1.0f / theRoute.mSourceCount) : 1.0f;
+    }
+
+    size_t theScratchSize = 0;
+
+    for(const DestinationBuffer& theBuffer : theBuffers)
+    {
+        if(theBuffer.mFormat != SampleFormat::Float32)
+        {
+            theScratchSize = std::max(theScratchSize,
+                                      size_t(theBuffer.mChannelCount) * inMaxFramesPerBuffer);
+        }
+    }
+
+    mSourceChannelCount = inSourceChannelCount;
+
+    for(DestinationBuffer& theBuffer : theBuffers)
+    {
+        theBuffer.mIsIdentity = IsIdentity(theBuffer);
+    }
+
+    mScratch.assign(theScratchSize, 0.0f);
+    mBuffers = std::move(theBuffers);
+    mMaxFramesPerBuffer = inMaxFramesPerBuffer;
+    mIsPassthrough = (mBuffers.size() == 1) &&
+                     (mBuffers[0].mFormat == SampleFormat::Float32) &&
+                     mBuffers[0].mIsIdentity;
+
+    DebugMsg("BGMOutputFormatConverter::Configure: %u source channels, %u device channels in %lu "
+             "buffers, passthrough: %d",
+             inSourceChannelCount,
+             static_cast<UInt32>(mRoutes.size()),
+             static_cast<unsigned long>(mBuffers.size()),
+             mIsPassthrough);
+}
+
+// static
+BGMOutputFormatConverter::DestinationBuffer
+BGMOutputFormatConverter::MakeDestinationBuffer(const AudioStreamBasicDescription& inFormat)
+{
+    const bool theIsNonInterleaved = (inFormat.mFormatFlags & kAudioFormatFlagIsNonInterleaved) != 0;
+    const bool theIsNativeEndian = (inFormat.mFormatFlags & kAudioFormatFlagIsBigEndian) ==
+            (kAudioFormatFlagsNativeEndian & kAudioFormatFlagIsBigEndian);
+
+    DestinationBuffer theBuffer;
+    theBuffer.mChannelCount = theIsNonInterleaved ? 1 : inFormat.mChannelsPerFrame;
+
+    // For non-interleaved formats, mBytesPerFrame is the size of one channel's frame.
+    if(theBuffer.mChannelCount > 0 && (inFormat.mBytesPerFrame % theBuffer.mChannelCount) == 0)
+    {
+        theBuffer.mBytesPerSample = inFormat.mBytesPerFrame / theBuffer.mChannelCount;
+    }
+
+    ThrowIf((inFormat.mFormatID != kAudioFormatLinearPCM) ||
+                    !theIsNativeEndian ||
+                    (inFormat.mFramesPerPacket != 1) ||
+                    (inFormat.mChannelsPerFrame == 0) ||
+                    (theBuffer.mBytesPerSample == 0),
+            CAException(kAudioDeviceUnsupportedFormatError),
+            "BGMOutputFormatConverter::MakeDestinationBuffer: Unsupported format");
+
+    const bool theIsFloat = (inFormat.mFormatFlags & kAudioFormatFlagIsFloat) != 0;
+    const bool theIsSignedInteger = (inFormat.mFormatFlags & kAudioFormatFlagIsSignedInteger) != 0;
+    const UInt32 theBits = inFormat.mBitsPerChannel;
+    const UInt32 theBytes = theBuffer.mBytesPerSample;
+
+    if(theIsFloat && theBits == 32 && theBytes == 4)
+    {
+        theBuffer.mFormat = SampleFormat::Float32;
+    }
+    else if(theIsSignedInteger && theBits == 16 && theBytes == 2)
+    {
+        theBuffer.mFormat = SampleFormat::Int16;
+        theBuffer.mScale = 32768.0f;
+        theBuffer.mMaxValue = 32767.0f;
+    }
+    else if(theIsSignedInteger && theBits == 24 && theBytes == 3)
+    {
+        theBuffer.mFormat = SampleFormat::Int24Packed;
+        theBuffer.mScale = 8388608.0f;
+        theBuffer.mMaxValue = 8388607.0f;
+    }
+    else if(theIsSignedInteger && theBits == 24 && theBytes == 4)
+    {
+        theBuffer.mFormat = SampleFormat::Int32;
+        theBuffer.mScale = 8388608.0f;
+        theBuffer.mMaxValue = 8388607.0f;
+        theBuffer.mShift = (inFormat.mFormatFlags & kAudioFormatFlagIsAlignedHigh) ? 8 : 0;
+    }
+    else if(theIsSignedInteger && theBits == 32 && theBytes == 4)
+    {
+        theBuffer.mFormat = SampleFormat::Int32;
+        theBuffer.mScale = 2147483648.0f;
+        // The largest Float32 below 2^31. 2^31 - 1 would be rounded up to 2^31, which overflows.
+        theBuffer.mMaxValue = 2147483520.0f;
+    }
+    else
+    {
+        Throw(CAException(kAudioDeviceUnsupportedFormatError));
+    }
+
+    return theBuffer;
+}
+
+bool    BGMOutputFormatConverter::IsIdentity(const DestinationBuffer& inBuffer) const
+{
+    if(inBuffer.mChannelCount != mSourceChannelCount)
+    {
+        return false;
+    }
+
+    for(UInt32 theChannel = 0; theChannel < inBuffer.mChannelCount; theChannel++)
+    {
+        const Route& theRoute = mRoutes[inBuffer.mFirstRoute + theChannel];
+
+        if(theRoute.mSourceCount != 1 || mRouteSources[theRoute.mFirstSource] != theChannel)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// static
+std::vector<UInt32> BGMOutputFormatConverter::MakeChannelMap(UInt32 inSourceChannelCount,
+                                                             UInt32 inDeviceChannelCount,
+                                                             UInt32 inStereoLeft,
+                                                             UInt32 inStereoRight)
+{
+    std::vector<UInt32> theMap(inSourceChannelCount, kUnrouted);
+
+    if(inDeviceChannelCount == 1)
+    {
+        std::fill(theMap.begin(), theMap.end(), 1);
+    }
+    else if(inSourceChannelCount == 2 &&
+            inStereoLeft >= 1 && inStereoLeft <= inDeviceChannelCount &&
+            inStereoRight >= 1 && inStereoRight <= inDeviceChannelCount &&
+            inStereoLeft != inStereoRight)
+    {
+        theMap[0] = inStereoLeft;
+        theMap[1] = inStereoRight;
+    }
+    else
+    {
+        for(UInt32 theChannel = 0;
+            theChannel < std::min(inSourceChannelCount, inDeviceChannelCount);
+            theChannel++)
+        {
+            theMap[theChannel] = theChannel + 1;
+        }
+    }
+
+    return theMap;
+}
+
+#pragma mark Conversion
+
+UInt32  BGMOutputFormatConverter::GetFrameCount(const AudioBufferList& inOutput) const
+{
+    if(mBuffers.empty() ||
+       inOutput.mNumberBuffers != mBuffers.size() ||
+       inOutput.mBuffers[0].mNumberChannels != mBuffers[0].mChannelCount)
+    {
+        return 0;
+    }
+
+    return inOutput.mBuffers[0].mDataByteSize /
+            (mBuffers[0].mBytesPerSample * mBuffers[0].mChannelCount);
+}
+
+bool    BGMOutputFormatConverter::ConvertRT(const Float32* inSource,
+                                            UInt32 inFrameCount,
+                                            AudioBufferList* ioOutput)
+{
+    bool theSucceeded = (ioOutput->mNumberBuffers == mBuffers.size()) &&
+                        (inFrameCount <= mMaxFramesPerBuffer);
+
+    for(UInt32 i = 0; i < ioOutput->mNumberBuffers; i++)
+    {
+        AudioBuffer& theOutput = ioOutput->mBuffers[i];
+        UInt32 theBytesWritten = 0;
+
+        if(theSucceeded && theOutput.mNumberChannels != mBuffers[i].mChannelCount)
+        {
+            theSucceeded = false;
+        }
+
+        if(theSucceeded && theOutput.mData != nullptr)
+        {
+            const DestinationBuffer& theBuffer = mBuffers[i];
+            const UInt32 theBytesPerFrame = theBuffer.mBytesPerSample * theBuffer.mChannelCount;
+            const UInt32 theFrameCount = std::min(inFrameCount,
+                                                  theOutput.mDataByteSize / theBytesPerFrame);
+            if(theBuffer.mFormat == SampleFormat::Float32)
+            {
+                if(theBuffer.mIsIdentity)
+                {
+                    memcpy(theOutput.mData, inSource, theFrameCount * theBytesPerFrame);
+                }
+                else
+                {
+                    RouteRT(theBuffer, inSource, theFrameCount, static_cast<Float32*>(theOutput.mData));
+                }
+            }
+            else
+            {
+                // If the buffer has the same channels as the source, convert straight from it.
+                const Float32* theSamples = inSource;
+
+                if(!theBuffer.mIsIdentity)
+                {
+                    RouteRT(theBuffer, inSource, theFrameCount, mScratch.data());
+                    theSamples = mScratch.data();
+                }
+
+                ConvertSamplesRT(theBuffer,
+                                 theSamples,
+                                 theFrameCount * theBuffer.mChannelCount,
+                                 theOutput.mData);
+            }
+
+            theBytesWritten = theFrameCount * theBytesPerFrame;
+        }
+
+        if(theOutput.mData != nullptr && theBytesWritten < theOutput.mDataByteSize)
+        {
+            memset(static_cast<Byte*>(theOutput.mData) + theBytesWritten,
+                   0,
+                   theOutput.mDataByteSize - theBytesWritten);
+        }
+    }
+
+    return theSucceeded;
+}
+
+void    BGMOutputFormatConverter::RouteRT(const DestinationBuffer& inBuffer,
+                                          const Float32* inSource,
+                                          UInt32 inFrameCount,
+                                          Float32* ioSamples) const
+{
+    const UInt32 theSourceStride = mSourceChannelCount;
+    const UInt32 theStride = inBuffer.mChannelCount;
+
+    for(UInt32 theChannel = 0; theChannel < theStride; theChannel++)
+    {
+        const Route& theRoute = mRoutes[inBuffer.mFirstRoute + theChannel];
+        Float32* const theOut = ioSamples + theChannel;
+
+        if(theRoute.mSourceCount == 0)
+        {
+            for(UInt32 theFrame = 0; theFrame < inFrameCount; theFrame++)
+            {
+                theOut[theFrame * theStride] = 0.0f;
+            }
+
+            continue;
+        }
+
+        const Float32* theIn = inSource + mRouteSources[theRoute.mFirstSource];
+
+        for(UInt32 theFrame = 0; theFrame < inFrameCount; theFrame++)
+        {
+            theOut[theFrame * theStride] = theIn[theFrame * theSourceStride];
+        }
+
+        if(theRoute.mSourceCount > 1)
+        {
+            // Average the source channels, e.g. to play stereo on a mono device.
+            for(UInt32 i = 1; i < theRoute.mSourceCount; i++)
+            {
+                theIn = inSource + mRouteSources[theRoute.mFirstSource + i];
+
+                for(UInt32 theFrame = 0; theFrame < inFrameCount; theFrame++)
+                {
+                    theOut[theFrame * theStride] += theIn[theFrame * theSourceStride];
+                }
+            }
+
+            for(UInt32 theFrame = 0; theFrame < inFrameCount; theFrame++)
+            {
+                theOut[theFrame * theStride] *= theRoute.mGain;
+            }
+        }
+    }
+}
+
+// Scales a sample to an integer format's range, clamps it and rounds it to the nearest integer.
+// Written so the loops that call it vectorise: no calls and the branches are selects. NaNs become
+// the most negative value rather than being undefined.
+static inline SInt32 ToInteger(Float32 inSample, Float32 inScale, Float32 inMaxValue)
+{
+    Float32 theValue = inSample * inScale;
+    theValue = (theValue > -inScale) ? theValue : -inScale;
+    theValue = (theValue < inMaxValue) ? theValue : inMaxValue;
+    return static_cast<SInt32>(theValue + ((theValue < 0.0f) ? -0.5f : 0.5f));
+}
+
+// static
+void    BGMOutputFormatConverter::ConvertSamplesRT(const DestinationBuffer& inBuffer,
+                                                   const Float32* inSamples,
+                                                   UInt32 inSampleCount,
+                                                   void* outSamples)
+{
+    const Float32 theScale = inBuffer.mScale;
+    const Float32 theMaxValue = inBuffer.mMaxValue;
+
+    switch(inBuffer.mFormat)
+    {
+        case SampleFormat::Int16:
+        {
+            SInt16* const theOut = static_cast<SInt16*>(outSamples);
+
+            for(UInt32 i = 0; i < inSampleCount; i++)
+            {
+                theOut[i] = static_cast<SInt16>(ToInteger(inSamples[i], theScale, theMaxValue));
+            }
+
+            break;
+        }
+
+        case SampleFormat::Int24Packed:
+        {
+            // Little-endian, like every Mac BGMApp runs on. MakeDestinationBuffer only accepts
+            // native-endian formats.
+            Byte* const theOut = static_cast<Byte*>(outSamples);
+
+            for(UInt32 i = 0; i < inSampleCount; i++)
+            {
+                const UInt32 theValue =
+                        static_cast<UInt32>(ToInteger(inSamples[i], theScale, theMaxValue));
+                theOut[i * 3] = static_cast<Byte>(theValue);
+                theOut[i * 3 + 1] = static_cast<Byte>(theValue >> 8);
+                theOut[i * 3 + 2] = static_cast<Byte>(theValue >> 16);
+            }
+
+            break;
+        }
+
+        case SampleFormat::Int32:
+        {
+            SInt32* const theOut = static_cast<SInt32*>(outSamples);
+            const UInt32 theShift = inBuffer.mShift;
+
+            for(UInt32 i = 0; i < inSampleCount; i++)
+            {
+                // Shift as unsigned, since shifting negative numbers left is undefined.
+                theOut[i] = static_cast<SInt32>(
+                        static_cast<UInt32>(ToInteger(inSamples[i], theScale, theMaxValue)) << theShift);
+            }
+
+            break;
+        }
+
+        case SampleFormat::Float32:
+            memcpy(outSamples, inSamples, inSampleCount * sizeof(Float32));
+            break;
+    }
+}
+
+#pragma clang assume_nonnull end
+
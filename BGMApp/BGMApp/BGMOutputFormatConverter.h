@@ -0,0 +1,194 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGMOutputFormatConverter.h
+//  BGMApp
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  Writes the playthrough audio, which is always interleaved Float32 in BGMDevice's channel
+//  layout, to the output device's buffers in the device's own layout and sample format.
+//  BGMPlayThrough runs it on the output device's IO thread when the output device isn't simply
+//  one interleaved Float32 stream with the same channels as BGMDevice.
+//
+//  Output devices can have any number of streams, each of which can be interleaved or not and can
+//  have any number of channels. Each of the source's channels is routed to one of the device's
+//  channels, counted from 1 across all of its streams, as in
+//  kAudioDevicePropertyPreferredChannelsForStereo. The device's other channels are silent. If
+//  more than one source channel is routed to a device channel, they're averaged, e.g. to play
+//  stereo on a mono device.
+//
+//  The device's virtual formats are usually Float32, but they can be 16, 24 or 32-bit signed
+//  integers, e.g. if the device's driver doesn't let the HAL mix. The samples are first routed
+//  into a contiguous Float32 scratch buffer in the device buffer's layout and then converted in
+//  one pass over it, which the compiler can vectorise.
+//
+
+#ifndef BGMApp__BGMOutputFormatConverter
+#define BGMApp__BGMOutputFormatConverter
+
+// STL Includes
+#include <vector>
+
+// System Includes
+#include <CoreAudio/CoreAudioTypes.h>
+
+
+#pragma clang assume_nonnull begin
+
+class BGMOutputFormatConverter
+{
+
+public:
+    // A device channel number that means the source channel isn't played.
+    static const UInt32         kUnrouted = 0;
+
+public:
+    /*!
+     Set up the routing and allocate the scratch buffer for the output device's streams.
+
+     Not real-time safe. ConvertRT must not be running.
+
+     @param inSourceChannelCount The number of interleaved channels ConvertRT will be given.
+     @param inStreamFormats The virtual formats of the output device's output streams, in order.
+     @param inChannelMap The device channel, counting from 1, to play each of the source's
+                         channels on, or kUnrouted. Channels past the end of the map are unrouted.
+     @param inMaxFramesPerBuffer Usually the output device's IO buffer size.
+     @throws CAException kAudioDeviceUnsupportedFormatError if one of the formats isn't supported,
+                         in which case the converter is left unconfigured.
+     */
+    void                        Configure(UInt32 inSourceChannelCount,
+                                          const std::vector<AudioStreamBasicDescription>& inStreamFormats,
+                                          const std::vector<UInt32>& inChannelMap,
+                                          UInt32 inMaxFramesPerBuffer);
+
+    /*!
+     @return True if the source's samples can be written to the output device's buffer as they are,
+             i.e. the device has one interleaved Float32 stream with the same channels as the
+             source and each source channel is routed to the same channel on the device.
+     */
+    bool                        IsPassthrough() const { return mIsPassthrough; }
+
+    UInt32                      GetSourceChannelCount() const { return mSourceChannelCount; }
+    UInt32                      GetMaxFramesPerBuffer() const { return mMaxFramesPerBuffer; }
+
+    /*!
+     @return The number of frames in ioOutput's first buffer, according to the format Configure was
+             given, or 0 if ioOutput doesn't match it. Real-time safe.
+     */
+    UInt32                      GetFrameCount(const AudioBufferList& inOutput) const;
+
+    /*!
+     Route and convert the frames in inSource to the output device's buffers. Device channels
+     nothing is routed to, and any frames in ioOutput past inFrameCount, are filled with silence.
+
+     Real-time safe. Should only be called on one thread at a time.
+
+     @param inSource Interleaved Float32, GetSourceChannelCount() channels.
+     @param inFrameCount At most GetMaxFramesPerBuffer().
+     @param ioOutput The output device's buffers.
+     @return False if ioOutput doesn't match the formats Configure was given or inFrameCount is too
+             large, in which case ioOutput is filled with silence.
+     */
+    bool                        ConvertRT(const Float32* inSource,
+                                          UInt32 inFrameCount,
+                                          AudioBufferList* ioOutput);
+
+    /*!
+     Choose which device channels to play the source's channels on. Stereo is played on the
+     device's preferred channels for stereo. A source with more channels is played on the device's
+     first channels in order. On a mono device, every source channel is mixed into its one channel.
+
+     @param inStereoLeft,inStereoRight The device's kAudioDevicePropertyPreferredChannelsForStereo.
+                                       Ignored if they aren't valid channels of the device.
+     @return The channel map for Configure.
+     */
+    static std::vector<UInt32>  MakeChannelMap(UInt32 inSourceChannelCount,
+                                               UInt32 inDeviceChannelCount,
+                                               UInt32 inStereoLeft,
+                                               UInt32 inStereoRight);
+
+private:
+    enum class SampleFormat
+    {
+        Float32,
+        Int16,
+        // Three bytes per sample, native-endian.
+        Int24Packed,
+        // 24 or 32-bit samples in four bytes, shifted left by mShift.
+        Int32
+    };
+
+    // The samples of one AudioBuffer in the output device's buffer list. Non-interleaved streams
+    // have one per channel.
+    struct DestinationBuffer
+    {
+        SampleFormat            mFormat = SampleFormat::Float32;
+        UInt32                  mChannelCount = 0;
+        UInt32                  mBytesPerSample = 0;
+        // The integer formats' full scale and the largest sample value, as Float32s.
+        Float32                 mScale = 1.0f;
+        Float32                 mMaxValue = 1.0f;
+        UInt32                  mShift = 0;
+        // The index of the buffer's first channel in mRoutes.
+        UInt32                  mFirstRoute = 0;
+        // True if the buffer has the source's channels in the same order.
+        bool                    mIsIdentity = false;
+    };
+
+    // The source channels mixed into one device channel.
+    struct Route
+    {
+        // Indices into mRouteSources.
+        UInt32                  mFirstSource = 0;
+        UInt32                  mSourceCount = 0;
+        Float32                 mGain = 1.0f;
+    };
+
+    static DestinationBuffer    MakeDestinationBuffer(const AudioStreamBasicDescription& inFormat);
+    bool                        IsIdentity(const DestinationBuffer& inBuffer) const;
+
+    // Writes the channels inBuffer's routes select from inSource to ioSamples, interleaved.
+    void                        RouteRT(const DestinationBuffer& inBuffer,
+                                        const Float32* inSource,
+                                        UInt32 inFrameCount,
+                                        Float32* ioSamples) const;
+
+    // Converts inSampleCount contiguous Float32 samples to inBuffer's integer format.
+    static void                 ConvertSamplesRT(const DestinationBuffer& inBuffer,
+                                                 const Float32* inSamples,
+                                                 UInt32 inSampleCount,
+                                                 void* outSamples);
+
+private:
+    UInt32                      mSourceChannelCount = 0;
+    UInt32                      mMaxFramesPerBuffer = 0;
+    bool                        mIsPassthrough = false;
+
+    std::vector<DestinationBuffer> mBuffers;
+    // One per device channel.
+    std::vector<Route>          mRoutes;
+    std::vector<UInt32>         mRouteSources;
+
+    // Float32 samples in the layout of the largest of mBuffers, for the integer formats.
+    std::vector<Float32>        mScratch;
+
+};
+
+#pragma clang assume_nonnull end
+
+#endif /* BGMApp__BGMOutputFormatConverter */
+
@@ -0,0 +1,358 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGMOutputPipeline.cpp
+//  BGMApp
+//
+//  Copyright © 2026 Kyle Neideck
+//
+
+// Self Include
+#include "BGMOutputPipeline.h"
+
+// Local Includes
+#include "BGM_Utils.h"
+
+// PublicUtility Includes
+#include "CADebugMacros.h"
+#include "CAException.h"
+#include "CAHostTimeBase.h"
+
+// STL Includes
+#include <algorithm>
+#include <cstring>
+#include <system_error>
+#include <utility>
+
+// System Includes
+#include <CoreAudio/AudioHardwareBase.h>
+#include <mach/mach.h>
+#include <mach/thread_policy.h>
+#include <pthread.h>
+
+
+#pragma clang assume_nonnull begin
+
+#pragma mark Construction/Destruction
+
+BGMOutputPipeline::~BGMOutputPipeline()
+{
+    Stop();
+}
+
+#pragma mark Control
+
+void    BGMOutputPipeline::Start(RenderFunction inRender,
+                                 UInt32 inChannelCount,
+                                 UInt32 inMaxFramesPerBuffer,
+                                 Float64 inSampleRate,
+                                 UInt32 inLookaheadBuffers)
+{
+    ThrowIf(inChannelCount == 0 || inMaxFramesPerBuffer == 0 || !(inSampleRate > 0.0),
+            CAException(kAudioHardwareIllegalOperationError),
+            "BGMOutputPipeline::Start: Invalid format");
+
+    Stop();
+
+    const UInt32 lookaheadBuffers = std::max(inLookaheadBuffers, 1U);
+
+    mRender = std::move(inRender);
+    mChannelCount = inChannelCount;
+    mMaxFramesPerBuffer = inMaxFramesPerBuffer;
+    mLatencyFrames = lookaheadBuffers * inMaxFramesPerBuffer;
+    mPeriodNs = static_cast<UInt64>(inMaxFramesPerBuffer / inSampleRate * 1e9);
+    mBudgetNs = mPeriodNs * lookaheadBuffers;
+
+    // Room for the lookahead, the buffer being written and the one being read.
+    mRingFrames = 1;
+
+    while(mRingFrames < UInt64(lookaheadBuffers + 2) * inMaxFramesPerBuffer)
+    {
+        mRingFrames *= 2;
+    }
+
+    mRing.assign(mRingFrames * inChannelCount, 0.0f);
+    mRenderBuffer.assign(size_t(inMaxFramesPerBuffer) * inChannelCount, 0.0f);
+
+    // The ring starts with the lookahead already in it, as silence.
+    mReadPosition = 0;
+    mWritePosition = mLatencyFrames;
+    mRequestsWritten = 0;
+    mRequestsRead = 0;
+
+    mCycles = 0;
+    mUnderruns = 0;
+    mLateBuffers = 0;
+    mDroppedBuffers = 0;
+    mRenderFailures = 0;
+    mMaxRenderNs = 0;
+    mMaxTurnaroundNs = 0;
+
+    kern_return_t error =
+            semaphore_create(mach_task_self(), &mWakeWorkerSemaphore, SYNC_POLICY_FIFO, 0);
+    BGM_Utils::ThrowIfMachError("BGMOutputPipeline::Start", "semaphore_create", error);
+
+    mStopWorker = false;
+
+    try
+    {
+        mWorkerThread = std::thread(&BGMOutputPipeline::WorkerThreadMain, this);
+    }
+    catch(const std::system_error& e)
+    {
+        LogError("BGMOutputPipeline::Start: Failed to start the worker thread: %s", e.what());
+        semaphore_destroy(mach_task_self(), mWakeWorkerSemaphore);
+        mWakeWorkerSemaphore = SEMAPHORE_NULL;
+        Throw(CAException(kAudioHardwareUnspecifiedError));
+    }
+
+    mRunning = true;
+
+    DebugMsg("BGMOutputPipeline::Start: Started with %u frames (%llu ns) of lookahead",
+             mLatencyFrames,
+             mBudgetNs);
+}
+
+void    BGMOutputPipeline::Stop()
+{
+    if(!mWorkerThread.joinable())
+    {
+        return;
+    }
+
+    mRunning = false;
+    mStopWorker = true;
+
+    kern_return_t error = semaphore_signal(mWakeWorkerSemaphore);
+    BGM_Utils::LogIfMachError("BGMOutputPipeline::Stop", "semaphore_signal", error);
+
+    if(error == KERN_SUCCESS)
+    {
+        mWorkerThread.join();
+
+        error = semaphore_destroy(mach_task_self(), mWakeWorkerSemaphore);
+        BGM_Utils::LogIfMachError("BGMOutputPipeline::Stop", "semaphore_destroy", error);
+    }
+    else
+    {
+        // Same as in ~BGMPlayThroughRTLogger. If we couldn't wake the worker, it's not safe to wait
+        // for it or to destroy the semaphore.
+        mWorkerThread.detach();
+    }
+
+    mWakeWorkerSemaphore = SEMAPHORE_NULL;
+}
+
+UInt32  BGMOutputPipeline::GetLatencyFrames() const
+{
+    return IsRunning() ? mLatencyFrames : 0;
+}
+
+BGMOutputPipeline::Stats    BGMOutputPipeline::GetStats() const
+{
+    Stats stats;
+    stats.mCycles = mCycles.load(std::memory_order_relaxed);
+    stats.mUnderruns = mUnderruns.load(std::memory_order_relaxed);
+    stats.mLateBuffers = mLateBuffers.load(std::memory_order_relaxed);
+    stats.mDroppedBuffers = mDroppedBuffers.load(std::memory_order_relaxed);
+    stats.mRenderFailures = mRenderFailures.load(std::memory_order_relaxed);
+    stats.mBudgetNs = mBudgetNs;
+    stats.mMaxRenderNs = mMaxRenderNs.load(std::memory_order_relaxed);
+    stats.mMaxTurnaroundNs = mMaxTurnaroundNs.load(std::memory_order_relaxed);
+    return stats;
+}
+
+#pragma mark IOProc
+
+void    BGMOutputPipeline::ReadRT(Float32* outBuffer, UInt32 inFrameCount, SInt64 inSampleTime)
+{
+    mCycles.fetch_add(1, std::memory_order_relaxed);
+
+    // Copy out the frames the worker has rendered.
+    const UInt64 readPosition = mReadPosition.load(std::memory_order_relaxed);
+    const UInt64 writePosition = mWritePosition.load(std::memory_order_acquire);
+    const UInt32 framesReady = (writePosition > readPosition) ?
+            static_cast<UInt32>(std::min(writePosition - readPosition, UInt64(inFrameCount))) :
+            0;
+
+    const UInt32 ringOffset = static_cast<UInt32>(readPosition & (mRingFrames - 1));
+    const UInt32 framesBeforeWrap = std::min(framesReady, static_cast<UInt32>(mRingFrames - ringOffset));
+
+    memcpy(outBuffer,
+           &mRing[size_t(ringOffset) * mChannelCount],
+           size_t(framesBeforeWrap) * mChannelCount * sizeof(Float32));
+    memcpy(outBuffer + size_t(framesBeforeWrap) * mChannelCount,
+           mRing.data(),
+           size_t(framesReady - framesBeforeWrap) * mChannelCount * sizeof(Float32));
+
+    if(framesReady < inFrameCount)
+    {
+        memset(outBuffer + size_t(framesReady) * mChannelCount,
+               0,
+               size_t(inFrameCount - framesReady) * mChannelCount * sizeof(Float32));
+        mUnderruns.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    mReadPosition.store(readPosition + inFrameCount, std::memory_order_release);
+
+    // Ask the worker to render the frames for inSampleTime, to be played after the lookahead.
+    const UInt32 requestsWritten = mRequestsWritten.load(std::memory_order_relaxed);
+
+    if(requestsWritten - mRequestsRead.load(std::memory_order_acquire) < kMaxRequests)
+    {
+        mRequests[requestsWritten % kMaxRequests] = {
+            inSampleTime,
+            inFrameCount,
+            readPosition + mLatencyFrames,
+            CAHostTimeBase::GetTheCurrentTime()
+        };
+        mRequestsWritten.store(requestsWritten + 1, std::memory_order_release);
+
+        semaphore_signal(mWakeWorkerSemaphore);
+    }
+    else
+    {
+        // The worker is too far behind. Those frames will be silent.
+        mDroppedBuffers.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+#pragma mark Worker Thread
+
+void    BGMOutputPipeline::WorkerThreadMain()
+{
+    DebugMsg("BGMOutputPipeline::WorkerThreadMain: Starting the output worker thread");
+
+    SetWorkerThreadPolicy();
+
+    while(true)
+    {
+        kern_return_t error = semaphore_wait(mWakeWorkerSemaphore);
+        BGM_Utils::LogIfMachError("BGMOutputPipeline::WorkerThreadMain", "semaphore_wait", error);
+
+        if(mStopWorker)
+        {
+            break;
+        }
+
+        // ReadRT signals once per request, but we might have been woken late, so handle all of the
+        // requests waiting. Any extra signals just wake us with nothing to do.
+        UInt32 requestsRead = mRequestsRead.load(std::memory_order_relaxed);
+
+        while(requestsRead != mRequestsWritten.load(std::memory_order_acquire))
+        {
+            const Request request = mRequests[requestsRead % kMaxRequests];
+            mRequestsRead.store(++requestsRead, std::memory_order_release);
+
+            RenderRequest(request);
+        }
+    }
+
+    DebugMsg("BGMOutputPipeline::WorkerThreadMain: Output worker thread exiting");
+}
+
+void    BGMOutputPipeline::SetWorkerThreadPolicy() const
+{
+    // Like the HAL's IO threads, except the worker's deadline is the end of the lookahead rather
+    // than the end of the cycle.
+    thread_time_constraint_policy_data_t policy;
+    policy.period = static_cast<uint32_t>(CAHostTimeBase::ConvertFromNanos(mPeriodNs));
+    policy.computation = static_cast<uint32_t>(CAHostTimeBase::ConvertFromNanos(mPeriodNs / 2));
+    policy.constraint = static_cast<uint32_t>(CAHostTimeBase::ConvertFromNanos(mBudgetNs));
+    policy.preemptible = true;
+
+    kern_return_t error = thread_policy_set(pthread_mach_thread_np(pthread_self()),
+                                            THREAD_TIME_CONSTRAINT_POLICY,
+                                            reinterpret_cast<thread_policy_t>(&policy),
+                                            THREAD_TIME_CONSTRAINT_POLICY_COUNT);
+    BGM_Utils::LogIfMachError("BGMOutputPipeline::SetWorkerThreadPolicy", "thread_policy_set", error);
+}
+
+void    BGMOutputPipeline::RenderRequest(const Request& inRequest)
+{
+    const UInt64 renderStartHostTime = CAHostTimeBase::GetTheCurrentTime();
+    const UInt32 frameCount = std::min(inRequest.mFrameCount, mMaxFramesPerBuffer);
+
+    if(!mRender(mRenderBuffer.data(), frameCount, inRequest.mSampleTime))
+    {
+        std::fill(mRenderBuffer.begin(), mRenderBuffer.end(), 0.0f);
+        mRenderFailures.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    const UInt64 renderEndHostTime = CAHostTimeBase::GetTheCurrentTime();
+    UpdateMax(mMaxRenderNs, CAHostTimeBase::ConvertToNanos(renderEndHostTime - renderStartHostTime));
+    UpdateMax(mMaxTurnaroundNs,
+              CAHostTimeBase::ConvertToNanos(renderEndHostTime - inRequest.mRequestHostTime));
+
+    // The frames belong at inRequest.mRingPosition. Skip any that ReadRT has already needed (and
+    // played as silence) and any that overlap the last buffer, which can happen if the IO buffer
+    // size changes. Fill the gap with silence if a request was dropped.
+    const UInt64 endPosition = inRequest.mRingPosition + frameCount;
+    const UInt64 writePosition = mWritePosition.load(std::memory_order_relaxed);
+    const UInt64 readPosition = mReadPosition.load(std::memory_order_acquire);
+
+    if(readPosition > inRequest.mRingPosition)
+    {
+        mLateBuffers.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if(endPosition <= std::max(writePosition, readPosition))
+    {
+        return;
+    }
+
+    if(endPosition - readPosition > mRingFrames)
+    {
+        // ReadRT has stopped reading, so there's no room. Shouldn't happen while it's running.
+        mDroppedBuffers.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    const UInt64 gapStart = std::max(writePosition, readPosition);
+    const UInt64 startPosition = std::max(inRequest.mRingPosition, gapStart);
+
+    for(UInt64 position = gapStart; position < endPosition; position++)
+    {
+        Float32* frame = &mRing[size_t(position & (mRingFrames - 1)) * mChannelCount];
+
+        if(position < startPosition)
+        {
+            std::fill(frame, frame + mChannelCount, 0.0f);
+        }
+        else
+        {
+            memcpy(frame,
+                   &mRenderBuffer[size_t(position - inRequest.mRingPosition) * mChannelCount],
+                   mChannelCount * sizeof(Float32));
+        }
+    }
+
+    mWritePosition.store(endPosition, std::memory_order_release);
+}
+
+// static
+void    BGMOutputPipeline::UpdateMax(std::atomic<UInt64>& ioMax, UInt64 inValue)
+{
+    UInt64 currentMax = ioMax.load(std::memory_order_relaxed);
+
+    while(inValue > currentMax &&
+          !ioMax.compare_exchange_weak(currentMax, inValue, std::memory_order_relaxed))
+    {
+    }
+}
+
+#pragma clang assume_nonnull end
+
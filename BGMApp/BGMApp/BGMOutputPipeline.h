@@ -0,0 +1,203 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGMOutputPipeline.h
+//  BGMApp
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  BGMPlayThrough's optional pipelined output mode. Normally, OutputDeviceIOProc fetches the
+//  frames from the ring buffer and runs the output DSP (currently just BGMConvolver) itself, so
+//  the more processing we add, the closer it gets to missing the HAL's deadline. In pipelined
+//  mode, a worker thread with a time-constraint policy does that work and writes the results to a
+//  single-producer, single-consumer ring, and the IOProc just copies them out.
+//
+//  In each IO cycle, ReadRT copies out the frames the worker rendered earlier and then asks the
+//  worker to render the frames for the IOProc's current read head. Those are played
+//  inLookaheadBuffers cycles later, so the worker has that many whole cycles to render them
+//  instead of whatever's left of the IOProc's, at the cost of the same amount of extra latency.
+//
+//  The stats count the cycles where the worker didn't keep up and how close it came, so we can
+//  see how much margin pipelining actually buys.
+//
+
+#ifndef BGMApp__BGMOutputPipeline
+#define BGMApp__BGMOutputPipeline
+
+// STL Includes
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <vector>
+
+// System Includes
+#include <MacTypes.h>
+#include <mach/semaphore.h>
+
+
+#pragma clang assume_nonnull begin
+
+class BGMOutputPipeline
+{
+
+public:
+    /*!
+     Renders frames for the output on the worker thread. Fills ioBuffer with inFrameCount
+     interleaved frames, starting at the input device's sample time inSampleTime, and returns true,
+     or returns false if it can't, in which case they're played as silence. Must be real-time safe.
+     */
+    typedef std::function<bool(Float32* ioBuffer, UInt32 inFrameCount, SInt64 inSampleTime)>
+                                RenderFunction;
+
+    struct Stats
+    {
+        // The number of times ReadRT has been called.
+        UInt64                  mCycles;
+        // The number of cycles where the worker hadn't rendered all of the frames ReadRT needed,
+        // so some of them were played as silence.
+        UInt64                  mUnderruns;
+        // The number of buffers the worker finished after they were due to be played.
+        UInt64                  mLateBuffers;
+        // The number of buffers the worker couldn't render at all because it was too far behind.
+        UInt64                  mDroppedBuffers;
+        // The number of times the RenderFunction returned false.
+        UInt64                  mRenderFailures;
+        // How long the worker has to render each buffer, i.e. the lookahead.
+        UInt64                  mBudgetNs;
+        // The longest the RenderFunction has taken.
+        UInt64                  mMaxRenderNs;
+        // The longest from ReadRT requesting a buffer to it being ready. The smallest margin the
+        // pipeline has achieved is mBudgetNs - mMaxTurnaroundNs.
+        UInt64                  mMaxTurnaroundNs;
+    };
+
+public:
+                                BGMOutputPipeline() = default;
+                                ~BGMOutputPipeline();
+                                // Disallow copying
+                                BGMOutputPipeline(const BGMOutputPipeline&) = delete;
+                                BGMOutputPipeline& operator=(const BGMOutputPipeline&) = delete;
+
+    /*!
+     Allocate the ring and start the worker thread. Stops the pipeline first if it's running. Also
+     resets the stats. Not real-time safe. ReadRT must not be running.
+
+     @param inRender Called on the worker thread to render each buffer.
+     @param inChannelCount The number of interleaved channels.
+     @param inMaxFramesPerBuffer Usually the output device's IO buffer size.
+     @param inSampleRate The output device's sample rate. Used for the worker's time constraints.
+     @param inLookaheadBuffers How many IO cycles ahead the worker runs. At least 1.
+     @throws CAException If the worker thread can't be created.
+     */
+    void                        Start(RenderFunction inRender,
+                                      UInt32 inChannelCount,
+                                      UInt32 inMaxFramesPerBuffer,
+                                      Float64 inSampleRate,
+                                      UInt32 inLookaheadBuffers);
+
+    /*! Stop the worker thread. Not real-time safe. ReadRT must not be running. */
+    void                        Stop();
+
+    /*! Real-time safe. */
+    bool                        IsRunning() const { return mRunning.load(); }
+
+    /*! @return The channel count given to Start. */
+    UInt32                      GetChannelCount() const { return mChannelCount; }
+
+    /*! @return The extra latency the pipeline adds, in frames, or 0 if it isn't running. */
+    UInt32                      GetLatencyFrames() const;
+
+    /*! Can be called from any thread. The values are only approximately consistent. */
+    Stats                       GetStats() const;
+
+    /*!
+     Copy the next inFrameCount frames the worker has rendered to outBuffer and ask the worker to
+     render inFrameCount frames for inSampleTime. Any frames the worker hasn't rendered yet are
+     silent.
+
+     Real-time safe. Should only be called on the output device's IO thread.
+
+     @param outBuffer Interleaved. Must have the channel count given to Start.
+     @param inSampleTime The sample time (in the input device's time base) of the frames the IOProc
+                         would play now if the pipeline wasn't being used.
+     */
+    void                        ReadRT(Float32* outBuffer, UInt32 inFrameCount, SInt64 inSampleTime);
+
+private:
+    struct Request
+    {
+        SInt64                  mSampleTime;
+        UInt32                  mFrameCount;
+        // The position in the ring the frames go, which ReadRT reaches after the lookahead.
+        UInt64                  mRingPosition;
+        // When the request was made, in host time, for the turnaround stats.
+        UInt64                  mRequestHostTime;
+    };
+
+    void                        WorkerThreadMain();
+    void                        SetWorkerThreadPolicy() const;
+    // Renders the frames for one request and writes them to the ring. Only called on the worker
+    // thread.
+    void                        RenderRequest(const Request& inRequest);
+
+    static void                 UpdateMax(std::atomic<UInt64>& ioMax, UInt64 inValue);
+
+private:
+    // The worker can fall this many requests behind before ReadRT starts dropping them.
+    static const UInt32         kMaxRequests = 8;
+
+    // Only changed by Start and Stop.
+    RenderFunction              mRender;
+    UInt32                      mChannelCount = 0;
+    UInt32                      mMaxFramesPerBuffer = 0;
+    UInt32                      mLatencyFrames = 0;
+    UInt64                      mPeriodNs = 0;
+    UInt64                      mBudgetNs = 0;
+    // The ring's capacity in frames. A power of two, so the positions can be masked.
+    UInt64                      mRingFrames = 0;
+    std::vector<Float32>        mRing;
+    // The worker renders each buffer here before copying it into the ring.
+    std::vector<Float32>        mRenderBuffer;
+
+    // The total number of frames written to and read from the ring. Only the worker changes
+    // mWritePosition and only ReadRT changes mReadPosition.
+    std::atomic<UInt64>         mWritePosition { 0 };
+    std::atomic<UInt64>         mReadPosition { 0 };
+
+    // The render requests, from ReadRT to the worker, as another SPSC ring.
+    Request                     mRequests[kMaxRequests];
+    std::atomic<UInt32>         mRequestsWritten { 0 };
+    std::atomic<UInt32>         mRequestsRead { 0 };
+
+    semaphore_t                 mWakeWorkerSemaphore { SEMAPHORE_NULL };
+    std::thread                 mWorkerThread;
+    std::atomic<bool>           mRunning { false };
+    std::atomic<bool>           mStopWorker { false };
+
+    std::atomic<UInt64>         mCycles { 0 };
+    std::atomic<UInt64>         mUnderruns { 0 };
+    std::atomic<UInt64>         mLateBuffers { 0 };
+    std::atomic<UInt64>         mDroppedBuffers { 0 };
+    std::atomic<UInt64>         mRenderFailures { 0 };
+    std::atomic<UInt64>         mMaxRenderNs { 0 };
+    std::atomic<UInt64>         mMaxTurnaroundNs { 0 };
+
+};
+
+#pragma clang assume_nonnull end
+
+#endif /* BGMApp__BGMOutputPipeline */
+
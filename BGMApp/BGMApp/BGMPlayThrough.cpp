@@ -17,7 +17,7 @@
 //  BGMPlayThrough.cpp
 //  BGMApp
 //
-//  Copyright © 2016, 2017, 2020 Kyle Neideck
+//  Copyright © 2016, 2017, 2020, 2026 Kyle Neideck
 //
 
 // Self Include
@@ -33,6 +33,8 @@
 
 // STL Includes
 #include <algorithm>  // For std::max
+#include <cmath>  // For std::round
+#include <utility>  // For std::move
 
 // System Includes
 #include <mach/mach_init.h>
@@ -44,6 +46,22 @@
 // went wrong. If that happens, we try to stop them from a non-IO thread and continue anyway. 
 static const UInt32 kStopIOProcTimeoutInIOCycles = 600;
 
+// The latency presets' targets for the number of frames to keep in the ring buffer ahead of the
+// output IOProc's read head, in IO buffers. See BGMPlayThrough::LatencyPreset.
+static const UInt32 kLowLatencyTargetInIOBuffers = 1;
+static const UInt32 kSafeTargetInIOBuffers = 3;
+
+// The number of output IO cycles the output IOProc measures the ring buffer's occupancy over before
+// deciding whether it has drifted from the target. Scheduling jitter only makes the occupancy spike
+// for a cycle or two, but clock drift moves it for the whole window.
+static const UInt32 kOccupancyWindowCycles = 32;
+
+// Once the output IOProc has decided to correct the occupancy, it moves its read head by at most one
+// frame in this many output frames, so the correction is spread over many IO cycles as lots of tiny
+// skips or repeats instead of one audible jump. That's 0.4%, which is still much faster than any
+// real pair of clocks drift apart.
+static const UInt32 kOccupancyCorrectionFrameInterval = 256;
+
 #pragma mark Construction/Destruction
 
 BGMPlayThrough::BGMPlayThrough(BGMAudioDevice inInputDevice, BGMAudioDevice inOutputDevice)
@@ -158,6 +176,11 @@ void    BGMPlayThrough::Activate()
         mInputDevice.AddPropertyListener(CAPropertyAddress(kAudioDeviceProcessorOverload),
                                          &BGMPlayThrough::BGMDeviceListenerProc,
                                          this);
+        // So we can reallocate the ring buffer when BGMDevice's number of channels changes.
+        mInputDevice.AddPropertyListener(CAPropertyAddress(kAudioDevicePropertyStreamConfiguration,
+                                                           kAudioObjectPropertyScopeInput),
+                                         &BGMPlayThrough::BGMDeviceListenerProc,
+                                         this);
         
         bool isBGMDevice = true;
         CATry
@@ -210,6 +233,14 @@ void    BGMPlayThrough::Deactivate()
                                                     this);
             });
             
+            BGMLogAndSwallowExceptions("BGMPlayThrough::Deactivate", [&] {
+                mInputDevice.RemovePropertyListener(
+                        CAPropertyAddress(kAudioDevicePropertyStreamConfiguration,
+                                          kAudioObjectPropertyScopeInput),
+                        &BGMPlayThrough::BGMDeviceListenerProc,
+                        this);
+            });
+            
             BGMLogAndSwallowExceptions("BGMPlayThrough::Deactivate", [&] {
                 mInputDevice.RemovePropertyListener(kBGMRunningSomewhereOtherThanBGMAppAddress,
                                                     &BGMPlayThrough::BGMDeviceListenerProc,
@@ -231,30 +262,126 @@ void    BGMPlayThrough::Deactivate()
 
 void    BGMPlayThrough::AllocateBuffer()
 {
-    // Allocate the ring buffer that will hold the data passing between the devices
-    UInt32 numberStreams = 1;
-    AudioStreamBasicDescription outputFormat[1];
-    mOutputDevice.GetCurrentVirtualFormats(false, numberStreams, outputFormat);
-    
-    if(numberStreams < 1)
+    // The ring buffer, the convolver and the output pipeline all work in BGMDevice's format, which
+    // is always interleaved Float32. If the output device's format is different, OutputDeviceIOProc
+    // converts the frames to it with mOutputConverter at the end of each IO cycle.
+    UInt32 numberInputStreams = 1;
+    AudioStreamBasicDescription inputFormat;
+    mInputDevice.GetCurrentVirtualFormats(true, numberInputStreams, &inputFormat);
+
+    if(numberInputStreams < 1)
     {
         Throw(CAException(kAudioHardwareUnsupportedOperationError));
     }
+
+    const bool inputIsInterleavedFloat32 =
+            (inputFormat.mFormatID == kAudioFormatLinearPCM) &&
+            ((inputFormat.mFormatFlags & kAudioFormatFlagIsFloat) != 0) &&
+            ((inputFormat.mFormatFlags & kAudioFormatFlagIsNonInterleaved) == 0) &&
+            (inputFormat.mBitsPerChannel == 32) &&
+            (inputFormat.mChannelsPerFrame > 0) &&
+            (inputFormat.mBytesPerFrame == inputFormat.mChannelsPerFrame * SizeOf32(Float32));
+
+    if(!inputIsInterleavedFloat32)
+    {
+        LogError("BGMPlayThrough::AllocateBuffer: Unsupported input format");
+        Throw(CAException(kAudioDeviceUnsupportedFormatError));
+    }
+
+    // Get the formats of all of the output device's streams.
+    std::vector<AudioStreamBasicDescription> outputFormats(mOutputDevice.GetNumberStreams(false));
+    UInt32 numberOutputStreams = static_cast<UInt32>(outputFormats.size());
+
+    if(numberOutputStreams > 0)
+    {
+        mOutputDevice.GetCurrentVirtualFormats(false, numberOutputStreams, outputFormats.data());
+        outputFormats.resize(numberOutputStreams);
+    }
+
+    if(numberOutputStreams < 1)
+    {
+        Throw(CAException(kAudioHardwareUnsupportedOperationError));
+    }
+
+    UInt32 outputChannelCount = 0;
+
+    for(const AudioStreamBasicDescription& format : outputFormats)
+    {
+        outputChannelCount += format.mChannelsPerFrame;
+    }
+
+    // Play stereo on the channels the user has chosen for it in Audio MIDI Setup, which aren't
+    // necessarily the device's first two.
+    UInt32 stereoLeft = 1;
+    UInt32 stereoRight = 2;
+
+    BGMLogAndSwallowExceptions("BGMPlayThrough::AllocateBuffer", [&] {
+        if(mOutputDevice.HasPreferredStereoChannels(false))
+        {
+            mOutputDevice.GetPreferredStereoChannels(false, stereoLeft, stereoRight);
+        }
+    });
+
+    const std::vector<UInt32> channelMap =
+            BGMOutputFormatConverter::MakeChannelMap(inputFormat.mChannelsPerFrame,
+                                                     outputChannelCount,
+                                                     stereoLeft,
+                                                     stereoRight);
+
+    // BGMDevice's IO buffer size is set to match the output device's when playthrough is
+    // activated, so this is both devices' IO buffer size.
+    const UInt32 ioBufferFrameSize = mOutputDevice.GetIOBufferSize();
+    const UInt32 targetOccupancy =
+            CalculateTargetOccupancy(ioBufferFrameSize, mOutputDevice.GetNominalSampleRate());
     
     // Need to lock the buffer mutexes to make sure the IOProcs aren't accessing it. The order is
     // important here. We always lock them in the same order to prevent deadlocks.
     CAMutex::Locker lockerInput(mBufferInputMutex);
     CAMutex::Locker lockerOutput(mBufferOutputMutex);
 
+    // The output pipeline's worker thread reads mBuffer without taking the mutexes.
+    mOutputPipeline.Stop();
+
+    // Set up the conversion to the output device's format before replacing the ring buffer, since
+    // it throws if the format isn't supported. In that case the converter is left unconfigured,
+    // so OutputDeviceIOProc just plays silence.
+    mOutputConverter.Configure(inputFormat.mChannelsPerFrame,
+                               outputFormats,
+                               channelMap,
+                               ioBufferFrameSize);
+    mOutputScratch.assign(size_t(ioBufferFrameSize) * inputFormat.mChannelsPerFrame, 0.0f);
+    mInputBytesPerFrame = inputFormat.mBytesPerFrame;
+
     mBuffer = std::unique_ptr<CARingBuffer>(new CARingBuffer);
 
-    // The calculation for the size of the buffer is from Apple's CAPlayThrough.cpp sample code
-    //
-    // TODO: Test playthrough with hardware with more than 2 channels per frame, a sample (virtual) format other than
-    //       32-bit floats and/or an IO buffer size other than 512 frames
-    mBuffer->Allocate(outputFormat[0].mChannelsPerFrame,
-                      outputFormat[0].mBytesPerFrame,
-                      mOutputDevice.GetIOBufferSize() * 20);
+    // The buffer has to hold the target occupancy, up to two IO buffers of drift above it (see
+    // HoldTargetOccupancy), the IO buffer the input IOProc is writing and the one the output
+    // IOProc is reading. CARingBuffer rounds it up to a power of two. BGMDevice's stream is
+    // interleaved, so the ring buffer only needs one buffer.
+    mBuffer->Allocate(1, inputFormat.mBytesPerFrame, targetOccupancy + 4 * ioBufferFrameSize);
+
+    DebugMsg("BGMPlayThrough::AllocateBuffer: Target occupancy %u frames, IO buffer %u frames",
+             targetOccupancy,
+             ioBufferFrameSize);
+
+    mTargetOccupancyFrames = targetOccupancy;
+    mOccupancyToleranceFrames = ioBufferFrameSize;
+    mTargetLatencyFrames = targetOccupancy + ioBufferFrameSize;
+
+    // The new buffer is empty, so OutputDeviceIOProc has to wait for it to fill up to the target
+    // again before it can start reading from it.
+    mReadHeadIsAnchored = false;
+
+    // Reallocate the convolver's delay lines and FFT tables. It processes BGMDevice's channels,
+    // before they're routed to the output device's. This has to be done with mBufferOutputMutex
+    // held because OutputDeviceIOProc uses the convolver.
+    mConvolver.Configure(inputFormat.mChannelsPerFrame, ioBufferFrameSize);
+
+    ConfigureOutputPipeline();
+
+#if BGM_UnitTest
+    mBufferAllocationCount.fetch_add(1, std::memory_order_relaxed);
+#endif
 }
 
 void    BGMPlayThrough::DeallocateBuffer()
@@ -263,9 +390,46 @@ void    BGMPlayThrough::DeallocateBuffer()
     // important here. We always lock them in the same order to prevent deadlocks.
     CAMutex::Locker lockerInput(mBufferInputMutex);
     CAMutex::Locker lockerOutput(mBufferOutputMutex);
+    mOutputPipeline.Stop();
     mBuffer = nullptr;  // Note that the buffer's destructor will deallocate it.
 }
 
+void    BGMPlayThrough::ConfigureOutputPipeline()
+{
+    mOutputPipeline.Stop();
+
+    // The pipeline renders BGMDevice's channels, like the ring buffer holds, and OutputDeviceIOProc
+    // converts them to the output device's format afterwards.
+    const UInt32 channelCount = mOutputConverter.GetSourceChannelCount();
+
+    if(mOutputPipelineLookahead == 0 || !mBuffer || channelCount == 0)
+    {
+        return;
+    }
+
+    try
+    {
+        mOutputPipeline.Start([this, channelCount](Float32* ioBuffer,
+                                                   UInt32 inFrameCount,
+                                                   SInt64 inSampleTime) {
+                                  return RenderPipelinedOutput(ioBuffer,
+                                                               inFrameCount,
+                                                               inSampleTime,
+                                                               channelCount);
+                              },
+                              channelCount,
+                              mOutputDevice.GetIOBufferSize(),
+                              mOutputDevice.GetNominalSampleRate(),
+                              mOutputPipelineLookahead);
+    }
+    catch(const CAException& e)
+    {
+        // OutputDeviceIOProc will just render the output itself.
+        LogError("BGMPlayThrough::ConfigureOutputPipeline: Failed to start the output pipeline");
+        BGMLogException(e);
+    }
+}
+
 void    BGMPlayThrough::CreateIOProcIDs()
 {
     CAMutex::Locker stateLocker(mStateMutex);
@@ -474,6 +638,11 @@ void    BGMPlayThrough::Start()
     }
     
     DebugMsg("BGMPlayThrough::Start: Starting playthrough");
+
+    // Reallocate the ring buffer, which also restarts the output pipeline, so neither of them play
+    // any frames left over from the last time playthrough was running. This also sizes the buffer
+    // and the latency target for the output device's current IO buffer size.
+    AllocateBuffer();
     
     // Start our IOProcs.
     try
@@ -746,6 +915,9 @@ OSStatus    BGMPlayThrough::Stop()
     mFirstInputSampleTime = -1;
     mLastInputSampleTime = -1;
     mLastOutputSampleTime = -1;
+    mInputSilenceStartTime = -1;
+    mReadHeadIsAnchored = false;
+    mMeasuredLatencyFrames = 0;
     
     return noErr; // TODO: Why does this return anything and why always noErr?
 }
@@ -805,6 +977,235 @@ void    BGMPlayThrough::StopIfIdle()
     }
 }
 
+#pragma mark Convolution
+
+void    BGMPlayThrough::SetImpulseResponse(std::vector<Float32> inSamples, UInt32 inChannelCount)
+{
+    // BGMConvolver does its own locking and never blocks the IOProc, so this doesn't need any of
+    // our mutexes.
+    mConvolver.SetImpulseResponse(std::move(inSamples), inChannelCount);
+}
+
+void    BGMPlayThrough::ClearImpulseResponse()
+{
+    mConvolver.ClearImpulseResponse();
+}
+
+UInt32  BGMPlayThrough::GetConvolutionLatencyFrames() const
+{
+    return mConvolver.GetLatencyFrames();
+}
+
+#pragma mark Output Pipeline
+
+void    BGMPlayThrough::SetOutputPipelineLookahead(UInt32 inLookaheadBuffers)
+{
+    CAMutex::Locker stateLocker(mStateMutex);
+
+    if(inLookaheadBuffers != mOutputPipelineLookahead)
+    {
+        DebugMsg("BGMPlayThrough::SetOutputPipelineLookahead: %u buffers", inLookaheadBuffers);
+
+        mOutputPipelineLookahead = inLookaheadBuffers;
+
+        CAMutex::Locker lockerInput(mBufferInputMutex);
+        CAMutex::Locker lockerOutput(mBufferOutputMutex);
+        ConfigureOutputPipeline();
+    }
+}
+
+BGMOutputPipeline::Stats BGMPlayThrough::GetOutputPipelineStats() const
+{
+    return mOutputPipeline.GetStats();
+}
+
+UInt32  BGMPlayThrough::GetOutputPipelineLatencyFrames() const
+{
+    return mOutputPipeline.GetLatencyFrames();
+}
+
+bool    BGMPlayThrough::RenderPipelinedOutput(Float32* ioBuffer,
+                                              UInt32 inFrameCount,
+                                              SInt64 inSampleTime,
+                                              UInt32 inChannelCount)
+{
+    // This runs on mOutputPipeline's worker thread, which is always stopped before mBuffer is
+    // reallocated, so it doesn't need to take the buffer mutexes. OutputDeviceIOProc still
+    // calculates the read head.
+    AudioBufferList bufferList = {
+        1, { { inChannelCount, inFrameCount * inChannelCount * SizeOf32(Float32), ioBuffer } }
+    };
+
+    CARingBufferError err = mBuffer->Fetch(&bufferList, inFrameCount, inSampleTime);
+
+    if(err != kCARingBufferError_OK)
+    {
+        return false;
+    }
+
+    mConvolver.ProcessRT(ioBuffer, inFrameCount, inChannelCount);
+    return true;
+}
+
+#pragma mark Latency
+
+void    BGMPlayThrough::SetLatencyPreset(LatencyPreset inPreset)
+{
+    CAMutex::Locker stateLocker(mStateMutex);
+
+    if((inPreset != mLatencyPreset) || (mTargetLatencyMs != 0.0))
+    {
+        DebugMsg("BGMPlayThrough::SetLatencyPreset: %s",
+                 (inPreset == LatencyPreset::LowLatency ? "Low latency" : "Safe"));
+
+        mLatencyPreset = inPreset;
+        mTargetLatencyMs = 0.0;
+
+        // If the buffer hasn't been allocated yet, the target will be applied when it is.
+        if(mBuffer)
+        {
+            AllocateBuffer();
+        }
+    }
+}
+
+void    BGMPlayThrough::SetTargetLatencyMs(Float64 inTargetMs)
+{
+    CAMutex::Locker stateLocker(mStateMutex);
+
+    inTargetMs = std::max(0.0, inTargetMs);
+
+    if(inTargetMs != mTargetLatencyMs)
+    {
+        DebugMsg("BGMPlayThrough::SetTargetLatencyMs: %f ms", inTargetMs);
+
+        mTargetLatencyMs = inTargetMs;
+
+        if(mBuffer)
+        {
+            AllocateBuffer();
+        }
+    }
+}
+
+UInt32  BGMPlayThrough::GetTargetLatencyFrames() const
+{
+    return mTargetLatencyFrames;
+}
+
+UInt32  BGMPlayThrough::GetMeasuredLatencyFrames() const
+{
+    const UInt32 measuredLatencyFrames = mMeasuredLatencyFrames;
+
+    if(measuredLatencyFrames == 0)
+    {
+        return 0;
+    }
+
+    return measuredLatencyFrames + GetOutputPipelineLatencyFrames() + GetConvolutionLatencyFrames();
+}
+
+UInt32  BGMPlayThrough::CalculateTargetOccupancy(UInt32 inIOBufferFrameSize,
+                                                 Float64 inSampleRate) const
+{
+    UInt32 targetOccupancy;
+
+    if((mTargetLatencyMs > 0.0) && (inSampleRate > 0.0))
+    {
+        // The output device plays each IO buffer one IO cycle after OutputDeviceIOProc fills it,
+        // so one IO buffer of the latency is spent after the frames have left the ring buffer.
+        // Limit the target to one second so a bad setting can't make us allocate a huge buffer.
+        const Float64 targetLatencyFrames =
+                std::round(std::min(mTargetLatencyMs, 1000.0) * inSampleRate / 1000.0);
+
+        targetOccupancy =
+                static_cast<UInt32>(std::max(0.0, targetLatencyFrames - inIOBufferFrameSize));
+    }
+    else
+    {
+        targetOccupancy = inIOBufferFrameSize *
+                ((mLatencyPreset == LatencyPreset::LowLatency) ? kLowLatencyTargetInIOBuffers
+                                                              : kSafeTargetInIOBuffers);
+    }
+
+    // OutputDeviceIOProc reads a whole IO buffer from the ring buffer in each cycle, so the read
+    // head can't be any closer to the input than that.
+    return std::max(targetOccupancy, inIOBufferFrameSize);
+}
+
+SInt64  BGMPlayThrough::HoldTargetOccupancy(SInt64 inOccupancy, UInt32 inOutputFrameCount)
+{
+    if(mOccupancyCorrectionFrames != 0)
+    {
+        // Still correcting, so the occupancy is moving. Start a new window once that's finished.
+        mWindowCycles = 0;
+        return TakeOccupancyCorrectionStep(inOutputFrameCount);
+    }
+
+    if(mWindowCycles == 0)
+    {
+        mWindowMinOccupancy = inOccupancy;
+        mWindowMaxOccupancy = inOccupancy;
+    }
+
+    mWindowMinOccupancy = std::min(mWindowMinOccupancy, inOccupancy);
+    mWindowMaxOccupancy = std::max(mWindowMaxOccupancy, inOccupancy);
+
+    if(++mWindowCycles < kOccupancyWindowCycles)
+    {
+        return 0;
+    }
+
+    mWindowCycles = 0;
+
+    const SInt64 target = mTargetOccupancyFrames;
+    const SInt64 tolerance = mOccupancyToleranceFrames;
+    SInt64 correction = 0;
+
+    // Input that arrives late makes the occupancy dip and output that runs late makes it spike,
+    // but only for a cycle or two. So if even the lowest occupancy in the window is too high, the
+    // input device's clock must be running faster than the output device's. Skip the read head
+    // forward, which drops frames, to stop the latency from growing. And if even the highest is
+    // too low, the output device's clock is faster, so move the read head back, which repeats
+    // frames, before the output catches up to the input.
+    if(mWindowMinOccupancy > target + tolerance)
+    {
+        correction = mWindowMinOccupancy - target;
+    }
+    else if(mWindowMaxOccupancy < target - tolerance)
+    {
+        correction = mWindowMaxOccupancy - target;
+    }
+
+    // Report the highest occupancy rather than the latest, since late input makes the occupancy
+    // look lower than the latency really is.
+    mMeasuredLatencyFrames =
+            static_cast<UInt32>(std::max(SInt64(0), mWindowMaxOccupancy - correction)) +
+                    inOutputFrameCount;
+
+#if BGM_UnitTest
+    if(correction != 0)
+    {
+        mReanchorCount.fetch_add(1, std::memory_order_relaxed);
+    }
+#endif
+
+    mOccupancyCorrectionFrames = correction;
+
+    return TakeOccupancyCorrectionStep(inOutputFrameCount);
+}
+
+SInt64  BGMPlayThrough::TakeOccupancyCorrectionStep(UInt32 inOutputFrameCount)
+{
+    const SInt64 maxStep =
+            std::max(SInt64(1), SInt64(inOutputFrameCount / kOccupancyCorrectionFrameInterval));
+    const SInt64 step = std::min(maxStep, std::max(-maxStep, mOccupancyCorrectionFrames));
+
+    mOccupancyCorrectionFrames -= step;
+
+    return step;
+}
+
 #pragma mark BGMDevice Listener
 
 // TODO: Listen for changes to the sample rate and IO buffer size of the output device and update the input device to match
@@ -853,6 +1254,10 @@ OSStatus    BGMPlayThrough::BGMDeviceListenerProc(AudioObjectID inObjectID,
             case kAudioDeviceCustomPropertyDeviceIsRunningSomewhereOtherThanBGMApp:
                 HandleBGMDeviceIsRunningSomewhereOtherThanBGMApp(refCon);
                 break;
+
+            case kAudioDevicePropertyStreamConfiguration:
+                HandleBGMDeviceStreamConfigurationChanged(refCon);
+                break;
                 
             default:
                 // We might get properties we didn't ask for, so we just ignore them.
@@ -930,6 +1335,27 @@ void    BGMPlayThrough::HandleBGMDeviceIsRunningSomewhereOtherThanBGMApp(BGMPlay
     });
 }
 
+// static
+void    BGMPlayThrough::HandleBGMDeviceStreamConfigurationChanged(BGMPlayThrough* refCon)
+{
+    DebugMsg("BGMPlayThrough::HandleBGMDeviceStreamConfigurationChanged: Got notification");
+
+    // Dispatched for the same reasons as HandleBGMDeviceIsRunning. Until the ring buffer has been
+    // reallocated, InputDeviceIOProc drops the input if it has a different number of channels.
+    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+        BGMLogAndSwallowExceptions("HandleBGMDeviceStreamConfigurationChanged", [&refCon]() {
+            CAMutex::Locker stateLocker(refCon->mStateMutex);
+
+            // If the buffer hasn't been allocated yet, it will be allocated for BGMDevice's new
+            // format when playthrough starts.
+            if(refCon->mActive && refCon->mBuffer)
+            {
+                refCon->AllocateBuffer();
+            }
+        });
+    });
+}
+
 // static
 bool    BGMPlayThrough::IsRunningSomewhereOtherThanBGMApp(const BGMAudioDevice& inBGMDevice)
 {
@@ -977,8 +1403,6 @@ OSStatus    BGMPlayThrough::InputDeviceIOProc(AudioObjectID           inDevice,
         refCon->mFirstInputSampleTime = inInputTime->mSampleTime;
     }
     
-    UInt32 framesToStore = inInputData->mBuffers[0].mDataByteSize / (SizeOf32(Float32) * 2);
-
     // See the comments in OutputDeviceIOProc where it locks mBufferOutputMutex.
     CAMutex::Tryer tryer(refCon->mBufferInputMutex);
 
@@ -986,8 +1410,31 @@ OSStatus    BGMPlayThrough::InputDeviceIOProc(AudioObjectID           inDevice,
     // mBufferOutputMutex. Explained further in OutputDeviceIOProc.
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wthread-safety"
-    if(tryer.HasLock() && refCon->mBuffer)
+    if(tryer.HasLock() && refCon->mBuffer &&
+       (inInputData->mNumberBuffers == 1) && (refCon->mInputBytesPerFrame > 0))
     {
+        if(inInputData->mBuffers[0].mNumberChannels !=
+           refCon->mOutputConverter.GetSourceChannelCount())
+        {
+            // BGMDevice's format has changed, e.g. from stereo to 5.1, and the ring buffer hasn't
+            // been reallocated for it yet. (See HandleBGMDeviceStreamConfigurationChanged.) The
+            // ring buffer's frames are a different size, so storing these would garble it. Drop
+            // them instead.
+            return noErr;
+        }
+
+        // BGMDevice has a single interleaved stream. (See AllocateBuffer.)
+        UInt32 framesToStore = inInputData->mBuffers[0].mDataByteSize / refCon->mInputBytesPerFrame;
+
+        // The silence still has to be stored, since OutputDeviceIOProc follows the ring buffer's
+        // end time, but OutputDeviceIOProc won't need to read it back. See mInputSilenceStartTime.
+        const bool isSilent = IsSilent(inInputData);
+
+        if(!isSilent)
+        {
+            refCon->mInputSilenceStartTime = -1;
+        }
+
         CARingBufferError err =
                 refCon->mBuffer->Store(inInputData,
                                        framesToStore,
@@ -996,6 +1443,11 @@ OSStatus    BGMPlayThrough::InputDeviceIOProc(AudioObjectID           inDevice,
 #pragma clang diagnostic pop
         refCon->mRTLogger.LogIfRingBufferError_Store(err);
 
+        if(isSilent && (err == kCARingBufferError_OK) && (refCon->mInputSilenceStartTime == -1))
+        {
+            refCon->mInputSilenceStartTime = inInputTime->mSampleTime;
+        }
+
         refCon->mLastInputSampleTime = inInputTime->mSampleTime;
     }
     else
@@ -1058,9 +1510,6 @@ OSStatus    BGMPlayThrough::OutputDeviceIOProc(AudioObjectID           inDevice,
     // If this is the first time this IOProc has been called since starting playthrough...
     if(refCon->mLastOutputSampleTime == -1)
     {
-        // Calculate the number of frames between the read and write heads
-        refCon->mInToOutSampleOffset = inOutputTime->mSampleTime - refCon->mLastInputSampleTime;
-        
         // Log if we dropped frames
         refCon->mRTLogger.LogIfDroppedFrames(refCon->mFirstInputSampleTime,
                                              refCon->mLastInputSampleTime);
@@ -1071,8 +1520,6 @@ OSStatus    BGMPlayThrough::OutputDeviceIOProc(AudioObjectID           inDevice,
     CARingBuffer::SampleTime lastInputSampleTime =
         static_cast<CARingBuffer::SampleTime>(refCon->mLastInputSampleTime);
     
-    UInt32 framesToOutput = outOutputData->mBuffers[0].mDataByteSize / (SizeOf32(Float32) * 2);
-
     // When the input and output devices are set, during start up or because the user changed the
     // output device, this class (re)allocates the ring buffer (mBuffer). We try to take this
     // lock before accessing the buffer to make sure it's allocated.
@@ -1093,47 +1540,143 @@ OSStatus    BGMPlayThrough::OutputDeviceIOProc(AudioObjectID           inDevice,
 #pragma clang diagnostic ignored "-Wthread-safety"
     if(tryer.HasLock() && refCon->mBuffer)
     {
-        // Very occasionally (at least for me) our read head gets ahead of input, i.e. we haven't
-        // received any new input since this IOProc was last called, and we have to recalculate its
-        // position. I figure this might be caused by clock drift but I'm really not sure. It also
-        // happens if the input or output sample times are restarted from zero.
-        //
-        // We also recalculate the offset if the read head is outside of the ring buffer. This
-        // happens for example when you plug in or unplug headphones, which causes the output sample
-        // times to be restarted from zero.
-        //
-        // The vast majority of the time, just using lastInputSampleTime as the read head time
-        // instead of the one we calculate would work fine (and would also account for the above).
-        SInt64 bufferStartTime, bufferEndTime;
+        // The number of frames the output device wants, or 0 if its buffers don't match the
+        // formats mOutputConverter was configured for, e.g. because they've just changed.
+        const UInt32 framesToOutput = refCon->mOutputConverter.GetFrameCount(*outOutputData);
+        const bool isPassthrough = refCon->mOutputConverter.IsPassthrough();
+        const UInt32 channelCount = refCon->mOutputConverter.GetSourceChannelCount();
+
+        SInt64 bufferStartTime = 0, bufferEndTime = 0;
         CARingBufferError err = refCon->mBuffer->GetTimeBounds(bufferStartTime, bufferEndTime);
-        bool outOfBounds = false;
 
-        if(err == kCARingBufferError_OK)
+        // The number of frames of input in the ring buffer ahead of the read head.
+        SInt64 occupancy = bufferEndTime - readHeadSampleTime;
+
+        if(refCon->mReadHeadIsAnchored)
         {
-            outOfBounds = (readHeadSampleTime < bufferStartTime)
-                    || (readHeadSampleTime - framesToOutput > bufferEndTime);
+            // Occasionally our read head gets ahead of input, i.e. we haven't received enough new
+            // input since this IOProc was last called, and we have to recalculate its position.
+            // This happens if the input IOProc is late, if the output device's clock is running
+            // faster than the input device's and HoldTargetOccupancy hasn't caught it in time, or
+            // if the input sample times are restarted from zero.
+            //
+            // We also recalculate the offset if the read head is outside of the ring buffer. This
+            // happens for example when you plug in or unplug headphones, which causes the output
+            // sample times to be restarted from zero.
+            const bool outOfBounds =
+                    (err != kCARingBufferError_OK) || (readHeadSampleTime < bufferStartTime);
+
+            if((occupancy < framesToOutput) || outOfBounds)
+            {
+                refCon->mRTLogger.LogNoSamplesReady(lastInputSampleTime,
+                                                    readHeadSampleTime,
+                                                    refCon->mInToOutSampleOffset);
+
+#if BGM_UnitTest
+                refCon->mReanchorCount.fetch_add(1, std::memory_order_relaxed);
+#endif
+
+                refCon->mReadHeadIsAnchored = false;
+            }
         }
 
-        if(lastInputSampleTime < readHeadSampleTime || outOfBounds)
+        if(!refCon->mReadHeadIsAnchored &&
+           (err == kCARingBufferError_OK) &&
+           (bufferEndTime - bufferStartTime >= refCon->mTargetOccupancyFrames))
         {
-            refCon->mRTLogger.LogNoSamplesReady(lastInputSampleTime,
-                                                readHeadSampleTime,
-                                                refCon->mInToOutSampleOffset);
-
-            // Recalculate the in-to-out offset and read head.
-            refCon->mInToOutSampleOffset = inOutputTime->mSampleTime - lastInputSampleTime;
-            readHeadSampleTime = static_cast<CARingBuffer::SampleTime>(
-                    inOutputTime->mSampleTime - refCon->mInToOutSampleOffset);
+            // Put the read head mTargetOccupancyFrames behind the newest input. If the ring buffer
+            // doesn't have that many frames yet, e.g. because playthrough has just started, we
+            // wait for it to fill up instead so we don't have to move the read head again
+            // straight away.
+            readHeadSampleTime = bufferEndTime - refCon->mTargetOccupancyFrames;
+            refCon->mInToOutSampleOffset = inOutputTime->mSampleTime - readHeadSampleTime;
+            occupancy = refCon->mTargetOccupancyFrames;
+            refCon->mWindowCycles = 0;
+            refCon->mOccupancyCorrectionFrames = 0;
+            refCon->mMeasuredLatencyFrames = refCon->mTargetOccupancyFrames + framesToOutput;
+            refCon->mReadHeadIsAnchored = true;
         }
 
-        // Copy the frames from the ring buffer.
-        err = refCon->mBuffer->Fetch(outOutputData, framesToOutput, readHeadSampleTime);
-        refCon->mRTLogger.LogIfRingBufferError_Fetch(err);
+        if(refCon->mReadHeadIsAnchored)
+        {
+            // Keep the occupancy close to the target as the devices' clocks drift apart.
+            const SInt64 correction = refCon->HoldTargetOccupancy(occupancy, framesToOutput);
 
-        if(err != kCARingBufferError_OK)
+            if(correction != 0)
+            {
+                refCon->mInToOutSampleOffset -= correction;
+                readHeadSampleTime += correction;
+            }
+        }
+
+        if(!refCon->mReadHeadIsAnchored ||
+           (framesToOutput == 0) ||
+           (!isPassthrough && (framesToOutput > refCon->mOutputConverter.GetMaxFramesPerBuffer())))
         {
+            // Play silence while the ring buffer fills up to the target or if we can't write to the
+            // output device's buffers.
             FillWithSilence(outOutputData);
         }
+        else if(!refCon->mOutputPipeline.IsRunning() &&
+                (refCon->mConvolver.GetLatencyFrames() == 0) &&
+                (refCon->mInputSilenceStartTime != -1) &&
+                (readHeadSampleTime >= refCon->mInputSilenceStartTime) &&
+                (readHeadSampleTime + framesToOutput <= bufferEndTime))
+        {
+            // BGMDevice has been silent since before the read head and, without an impulse
+            // response, the output DSP wouldn't change that. So skip fetching, convolving and
+            // converting the frames and just play silence. mInputSilenceStartTime is read after
+            // bufferEndTime, so every frame up to bufferEndTime is part of the silence.
+            FillWithSilence(outOutputData);
+        }
+        else
+        {
+            // Render the frames in BGMDevice's format, straight into the output device's buffer if
+            // its format is the same or into mOutputScratch if they have to be converted.
+            Float32* renderBuffer = isPassthrough ?
+                    static_cast<Float32*>(outOutputData->mBuffers[0].mData) :
+                    refCon->mOutputScratch.data();
+            bool rendered = true;
+
+            if(refCon->mOutputPipeline.IsRunning())
+            {
+                // The pipeline's worker thread fetches and processes the frames for this read
+                // head, which will be played after the lookahead, so just copy out the ones it
+                // rendered earlier.
+                refCon->mOutputPipeline.ReadRT(renderBuffer, framesToOutput, readHeadSampleTime);
+            }
+            else
+            {
+                // Copy the frames from the ring buffer.
+                AudioBufferList renderBufferList = {
+                    1, { { channelCount,
+                           framesToOutput * channelCount * SizeOf32(Float32),
+                           renderBuffer } }
+                };
+
+                err = refCon->mBuffer->Fetch(&renderBufferList, framesToOutput, readHeadSampleTime);
+                refCon->mRTLogger.LogIfRingBufferError_Fetch(err);
+                rendered = (err == kCARingBufferError_OK);
+
+                if(rendered)
+                {
+                    // Apply the room/headphone correction, if there is any.
+                    refCon->mConvolver.ProcessRT(renderBuffer, framesToOutput, channelCount);
+                }
+            }
+
+            if(!rendered)
+            {
+                FillWithSilence(outOutputData);
+            }
+            else if(!isPassthrough)
+            {
+                // Route the channels to the output device's and convert the samples to its format.
+                refCon->mOutputConverter.ConvertRT(refCon->mOutputScratch.data(),
+                                                   framesToOutput,
+                                                   outOutputData);
+            }
+        }
     }
     else
     {
@@ -1156,6 +1699,31 @@ inline void BGMPlayThrough::FillWithSilence(AudioBufferList* ioBuffer)
     }
 }
 
+// static
+bool    BGMPlayThrough::IsSilent(const AudioBufferList* inBuffer)
+{
+    for(UInt32 i = 0; i < inBuffer->mNumberBuffers; i++)
+    {
+        const Float32* theSamples = static_cast<const Float32*>(inBuffer->mBuffers[i].mData);
+        const UInt32 theSampleCount = inBuffer->mBuffers[i].mDataByteSize / SizeOf32(Float32);
+
+        if(theSamples == nullptr)
+        {
+            continue;
+        }
+
+        for(UInt32 j = 0; j < theSampleCount; j++)
+        {
+            if(theSamples[j] != 0.0f)
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
 // static
 bool    BGMPlayThrough::UpdateIOProcState(const char* inCallerName,
                                           BGMPlayThroughRTLogger& inRTLogger,
@@ -17,7 +17,7 @@
 //  BGMPlayThrough.h
 //  BGMApp
 //
-//  Copyright © 2016, 2017, 2020 Kyle Neideck
+//  Copyright © 2016, 2017, 2020, 2026 Kyle Neideck
 //
 //  Reads audio from an input device and immediately writes it to an output device. We currently use this class with the input
 //  device always set to BGMDevice and the output device set to the one selected in the preferences menu.
@@ -41,6 +41,9 @@
 
 // Local Includes
 #include "BGMAudioDevice.h"
+#include "BGMConvolver.h"
+#include "BGMOutputFormatConverter.h"
+#include "BGMOutputPipeline.h"
 #include "BGMPlayThroughRTLogger.h"
 
 // PublicUtility Includes
@@ -52,6 +55,7 @@
 #include <atomic>
 #include <algorithm>
 #include <memory>
+#include <vector>
 
 // System Includes
 #include <mach/semaphore.h>
@@ -93,6 +97,9 @@ public:
 private:
     void                AllocateBuffer() REQUIRES(mStateMutex);
     void                DeallocateBuffer();
+    /*! (Re)starts mOutputPipeline if it's enabled, or stops it if it isn't. */
+    void                ConfigureOutputPipeline()
+                            REQUIRES(mStateMutex, mBufferInputMutex, mBufferOutputMutex);
 
     /*! @throws CAException */
     void                CreateIOProcIDs();
@@ -126,6 +133,96 @@ private:
 public:
     OSStatus            Stop();
     void                StopIfIdle();
+
+public:
+    /*!
+     Convolve the audio with an impulse response before it's played, e.g. for room or headphone
+     correction. The impulse response should be at the output device's sample rate. It's
+     transformed on a background thread, so this returns before the output switches to it. See
+     BGMConvolver::SetImpulseResponse.
+
+     @throws CAException If inChannelCount is 0.
+     */
+    void                SetImpulseResponse(std::vector<Float32> inSamples, UInt32 inChannelCount);
+    /*! Stop convolving the audio. */
+    void                ClearImpulseResponse();
+    /*!
+     @return The number of frames the convolution delays the output by, or 0 if there's no impulse
+             response. One IO buffer, rounded up to a power of two.
+     */
+    UInt32              GetConvolutionLatencyFrames() const;
+
+    /*!
+     Render the output on a separate real-time worker thread, inLookaheadBuffers IO cycles ahead of
+     the output IOProc, instead of in the IOProc itself. This gives the output DSP (e.g. the
+     convolution) much more time to finish before the deadline, but adds inLookaheadBuffers IO
+     buffers of latency. 0, the default, disables it. Takes effect immediately.
+     */
+    void                SetOutputPipelineLookahead(UInt32 inLookaheadBuffers);
+    /*!
+     @return The output pipeline's overload counters and the deadline margin it's achieved since it
+             was last (re)started. See BGMOutputPipeline::Stats.
+     */
+    BGMOutputPipeline::Stats GetOutputPipelineStats() const;
+    /*! @return The extra latency the output pipeline adds, in frames, or 0 if it's disabled. */
+    UInt32              GetOutputPipelineLatencyFrames() const;
+
+    // How much audio to keep buffered between the input and output devices. More protects against
+    // glitches when the devices' IO threads are late or their clocks drift apart, at the cost of
+    // latency.
+    enum class          LatencyPreset
+                        {
+                            // Play each input buffer in the first output cycle after it arrives.
+                            // Any late input makes the output glitch.
+                            LowLatency,
+                            // Keep three IO buffers buffered, which covers an input cycle being
+                            // up to a whole IO buffer late. The default.
+                            Safe
+                        };
+
+    /*!
+     Set how much audio to keep buffered between the devices and forget any target set with
+     SetTargetLatencyMs. The ring buffer is reallocated for the new target, so changing it while
+     playthrough is running causes a short glitch.
+
+     @throws CAException
+     */
+    void                SetLatencyPreset(LatencyPreset inPreset);
+    /*!
+     Like SetLatencyPreset, but with an explicit target. The latency here is the time between the
+     input device capturing a frame and the output device starting to play it, not counting the
+     devices' own latencies, the output pipeline or the convolution. It's at least two IO buffers:
+     the input device's and the output device's. Pass 0 to go back to using the preset.
+
+     @throws CAException
+     */
+    void                SetTargetLatencyMs(Float64 inTargetMs);
+    /*! @return The latency target, as above, in frames at the output device's sample rate. */
+    UInt32              GetTargetLatencyFrames() const;
+    /*!
+     @return The latency playthrough has measured recently, in frames at the output device's sample
+             rate, or 0 if it isn't playing audio. Unlike the target, this includes the output
+             pipeline's and the convolution's latency.
+     */
+    UInt32              GetMeasuredLatencyFrames() const;
+
+private:
+    /*!
+     @return The number of frames OutputDeviceIOProc should keep in mBuffer ahead of its read head
+             to meet the latency target.
+     */
+    UInt32              CalculateTargetOccupancy(UInt32 inIOBufferFrameSize,
+                                                 Float64 inSampleRate) const REQUIRES(mStateMutex);
+    /*!
+     Called by OutputDeviceIOProc in each IO cycle with the number of frames in mBuffer ahead of
+     its read head. Returns how far to move the read head forward (or back, if negative) in this
+     cycle to get that back to mTargetOccupancyFrames, or 0 if it's still close enough. A
+     correction is spread over as many cycles as it takes, a few frames at a time, so it doesn't
+     make an audible jump. Real-time safe.
+     */
+    SInt64              HoldTargetOccupancy(SInt64 inOccupancy, UInt32 inOutputFrameCount);
+    /*! Take the next part of mOccupancyCorrectionFrames. See HoldTargetOccupancy. */
+    SInt64              TakeOccupancyCorrectionStep(UInt32 inOutputFrameCount);
     
 private:
     
@@ -135,6 +232,11 @@ private:
                                               void* __nullable inClientData);
     static void         HandleBGMDeviceIsRunning(BGMPlayThrough* refCon);
     static void         HandleBGMDeviceIsRunningSomewhereOtherThanBGMApp(BGMPlayThrough* refCon);
+    /*!
+     Reallocates the ring buffer, the convolver and the output pipeline for BGMDevice's new format
+     after its number of channels changes.
+     */
+    static void         HandleBGMDeviceStreamConfigurationChanged(BGMPlayThrough* refCon);
     
     static bool         IsRunningSomewhereOtherThanBGMApp(const BGMAudioDevice& inBGMDevice);
 
@@ -153,9 +255,21 @@ private:
                                            const AudioTimeStamp*   inOutputTime,
                                            void* __nullable        inClientData);
 
+    /*!
+     mOutputPipeline's RenderFunction. Fetches the frames from the ring buffer and applies the
+     output DSP, like OutputDeviceIOProc does when the pipeline is disabled. Real-time safe.
+     */
+    bool                RenderPipelinedOutput(Float32* ioBuffer,
+                                              UInt32 inFrameCount,
+                                              SInt64 inSampleTime,
+                                              UInt32 inChannelCount) NO_THREAD_SAFETY_ANALYSIS;
+
     /*! Fills the given ABL with zeroes to make it silent. */
     static inline void  FillWithSilence(AudioBufferList* ioBuffer);
 
+    /*! @return True if every sample in the given ABL is 0. Stops at the first one that isn't. */
+    static bool         IsSilent(const AudioBufferList* inBuffer);
+
     // The state of an IOProc. Used by the IOProc to tell other threads when it's finished starting. Used by other
     // threads to tell the IOProc to stop itself. (Probably used for other things as well.)
     enum class          IOState
@@ -171,10 +285,50 @@ private:
                                           AudioDeviceIOProcID __nullable inIOProcID,
                                           BGMAudioDevice& inDevice,
                                           IOState& outNewState);
+
+#if BGM_UnitTest
+
+#pragma mark Test Helpers
+
+public:
+    /*!
+     * @return The number of times OutputDeviceIOProc has had to recalculate the position of its read
+     *         head, e.g. because the input and output devices' clocks drifted apart.
+     */
+    UInt64              GetReanchorCount() const
+                            { return mReanchorCount.load(std::memory_order_relaxed); }
+    /*! @return The number of times the ring buffer has been allocated. */
+    UInt64              GetBufferAllocationCount() const
+                            { return mBufferAllocationCount.load(std::memory_order_relaxed); }
+
+#endif /* BGM_UnitTest */
     
 private:
     std::unique_ptr<CARingBuffer>    mBuffer PT_GUARDED_BY(mBufferInputMutex)
                                         PT_GUARDED_BY(mBufferOutputMutex) { nullptr };
+
+    // Applies the impulse response, if there is one, to the output. Only reconfigured with
+    // mBufferOutputMutex held, since OutputDeviceIOProc uses it while it holds that mutex.
+    BGMConvolver        mConvolver;
+
+    // Routes the output from BGMDevice's channels to the output device's and converts it to the
+    // output device's format, if it isn't the same. mOutputScratch holds the output before it's
+    // converted and mInputBytesPerFrame is BGMDevice's frame size. These are only changed with
+    // mBufferInputMutex and mBufferOutputMutex held, since the IOProcs use them.
+    BGMOutputFormatConverter mOutputConverter;
+    std::vector<Float32> mOutputScratch;
+    UInt32              mInputBytesPerFrame { 0 };
+
+    // The number of IO buffers of lookahead for mOutputPipeline, or 0 if it's disabled.
+    UInt32              mOutputPipelineLookahead GUARDED_BY(mStateMutex) { 0 };
+
+    LatencyPreset       mLatencyPreset GUARDED_BY(mStateMutex) { LatencyPreset::Safe };
+    // Overrides mLatencyPreset if it isn't 0.
+    Float64             mTargetLatencyMs GUARDED_BY(mStateMutex) { 0.0 };
+    // Only started and stopped with mBufferInputMutex and mBufferOutputMutex held, so the IOProc
+    // isn't using it. Its worker thread reads mBuffer without taking either mutex, so it's always
+    // stopped before mBuffer is reallocated.
+    BGMOutputPipeline   mOutputPipeline;
     
     AudioDeviceIOProcID __nullable mInputDeviceIOProcID { nullptr };
     AudioDeviceIOProcID __nullable mOutputDeviceIOProcID { nullptr };
@@ -224,9 +378,43 @@ private:
     Float64             mFirstInputSampleTime = -1;
     Float64             mLastInputSampleTime = -1;
     Float64             mLastOutputSampleTime = -1;
+
+    // The sample time of the first frame of the run of silent input InputDeviceIOProc has most
+    // recently stored in mBuffer, or -1 if the latest input wasn't silent. While BGMDevice is idle,
+    // OutputDeviceIOProc plays silence for the frames after this instead of fetching and
+    // processing them. Set after the silence is stored and cleared before the next audio is, so
+    // it never covers frames that aren't silent.
+    std::atomic<Float64> mInputSilenceStartTime { -1 };
     
     // Subtract this from the output time to get the input time.
     Float64             mInToOutSampleOffset { 0.0 };
+    // False until OutputDeviceIOProc has set mInToOutSampleOffset so its read head is
+    // mTargetOccupancyFrames behind the newest input. Set back to false to make it do that again,
+    // e.g. after the input device's sample times have been restarted.
+    bool                mReadHeadIsAnchored = false;
+
+    // The number of frames OutputDeviceIOProc keeps in mBuffer ahead of its read head and how far
+    // that can drift before it moves the read head back. Only changed with both buffer mutexes
+    // held, when mBuffer is allocated.
+    UInt32              mTargetOccupancyFrames { 0 };
+    UInt32              mOccupancyToleranceFrames { 0 };
+    // The lowest and highest numbers of frames seen in mBuffer ahead of the read head in the
+    // current window of output IO cycles. See HoldTargetOccupancy.
+    SInt64              mWindowMinOccupancy { 0 };
+    SInt64              mWindowMaxOccupancy { 0 };
+    UInt32              mWindowCycles { 0 };
+    // How much further HoldTargetOccupancy still has to move the read head to finish the current
+    // correction.
+    SInt64              mOccupancyCorrectionFrames { 0 };
+
+    // For GetTargetLatencyFrames and GetMeasuredLatencyFrames.
+    std::atomic<UInt32> mTargetLatencyFrames { 0 };
+    std::atomic<UInt32> mMeasuredLatencyFrames { 0 };
+
+#if BGM_UnitTest
+    std::atomic<UInt64> mReanchorCount { 0 };
+    std::atomic<UInt64> mBufferAllocationCount { 0 };
+#endif
 
     BGMPlayThroughRTLogger mRTLogger;
 
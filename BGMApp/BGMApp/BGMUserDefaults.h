@@ -65,6 +65,39 @@
 @property NSUInteger pauseDelayMS;
 @property NSUInteger maxUnpauseDelayMS;
 
+// If true, when auto-pause is enabled, BGMDriver turns the music player down while other audio is
+// playing instead of BGMApp pausing it. Defaults to false. See kAudioDeviceCustomPropertyMusicDucking
+// in BGM_Types.h.
+@property BOOL duckMusicInsteadOfPausing;
+// How far to turn the music player down, in dB. Clamped to [-96, 0].
+@property NSInteger musicDuckingDepthDB;
+// How long BGMDriver takes to turn the music player down, how long it waits after the other audio
+// stops and how long it takes to turn the music player back up, in milliseconds. Clamped to
+// [0, 10000].
+@property NSUInteger musicDuckingAttackMS;
+@property NSUInteger musicDuckingHoldMS;
+@property NSUInteger musicDuckingReleaseMS;
+
+// If true, BGMApp raises the output device's volume to absorb app volumes set above 50% and turns
+// the apps down to match, instead of BGMDriver boosting them, which can clip. Defaults to false.
+// See BGMGainStaging.
+@property BOOL appVolumeGainStaging;
+
+// If true, playthrough keeps less audio queued, which lowers its latency but makes glitches more
+// likely when the system is busy. Defaults to false. See BGMPlayThrough::LatencyPreset.
+@property BOOL playThroughLowLatency;
+// Overrides playThroughLowLatency if non-zero. In milliseconds. Defaults to 0. Clamped to [0, 1000].
+@property NSUInteger playThroughTargetLatencyMS;
+// If non-zero, playthrough renders its output this many IO buffers ahead on a separate thread, which
+// gives the output DSP more time at the cost of that many IO buffers of latency. Defaults to 0.
+// Clamped to [0, 4]. See BGMPlayThrough::SetOutputPipelineLookahead.
+@property NSUInteger playThroughOutputLookahead;
+
+// The path to an audio file with an impulse response to convolve playthrough's output with, e.g.
+// for room or headphone correction, or nil to leave the output unprocessed. Defaults to nil. See
+// BGMPlayThrough::SetImpulseResponse.
+@property NSString* __nullable playThroughImpulseResponsePath;
+
 @end
 
 #pragma clang assume_nonnull end
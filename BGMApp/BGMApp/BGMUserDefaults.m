@@ -36,6 +36,16 @@ static NSString* const kDefaultKeyPreferredDeviceUIDs   = @"PreferredDeviceUIDs"
 static NSString* const kDefaultKeyStatusBarIcon         = @"StatusBarIcon";
 static NSString* const kDefaultKeyPauseDelayMS          = @"PauseDelayMS";
 static NSString* const kDefaultKeyMaxUnpauseDelayMS     = @"MaxUnpauseDelayMS";
+static NSString* const kDefaultKeyDuckMusic             = @"DuckMusicInsteadOfPausing";
+static NSString* const kDefaultKeyDuckingDepthDB        = @"MusicDuckingDepthDB";
+static NSString* const kDefaultKeyDuckingAttackMS       = @"MusicDuckingAttackMS";
+static NSString* const kDefaultKeyDuckingHoldMS         = @"MusicDuckingHoldMS";
+static NSString* const kDefaultKeyDuckingReleaseMS      = @"MusicDuckingReleaseMS";
+static NSString* const kDefaultKeyGainStaging          = @"AppVolumeGainStaging";
+static NSString* const kDefaultKeyPlayThroughLowLatency = @"PlayThroughLowLatency";
+static NSString* const kDefaultKeyPlayThroughTargetLatencyMS = @"PlayThroughTargetLatencyMS";
+static NSString* const kDefaultKeyPlayThroughOutputLookahead = @"PlayThroughOutputLookahead";
+static NSString* const kDefaultKeyPlayThroughImpulseResponsePath = @"PlayThroughImpulseResponsePath";
 
 // Labels for Keychain Data
 static NSString* const kKeychainLabelGPMDPAuthCode =
@@ -62,7 +72,16 @@ static NSString* const kKeychainLabelGPMDPAuthCode =
         NSDictionary* defaultsDict = @{ 
             kDefaultKeyAutoPauseMusicEnabled: @YES,
             kDefaultKeyPauseDelayMS: @1500,
-            kDefaultKeyMaxUnpauseDelayMS: @3500
+            kDefaultKeyMaxUnpauseDelayMS: @3500,
+            kDefaultKeyDuckMusic: @NO,
+            kDefaultKeyDuckingDepthDB: @-20,
+            kDefaultKeyDuckingAttackMS: @5,
+            kDefaultKeyDuckingHoldMS: @300,
+            kDefaultKeyDuckingReleaseMS: @500,
+            kDefaultKeyGainStaging: @NO,
+            kDefaultKeyPlayThroughLowLatency: @NO,
+            kDefaultKeyPlayThroughTargetLatencyMS: @0,
+            kDefaultKeyPlayThroughOutputLookahead: @0
         };
 
         if (defaults) {
@@ -148,6 +167,105 @@ static NSString* const kKeychainLabelGPMDPAuthCode =
     [self setInt:kDefaultKeyStatusBarIcon to:icon];
 }
 
+#pragma mark Music Ducking
+
+- (BOOL) duckMusicInsteadOfPausing {
+    return [self getBool:kDefaultKeyDuckMusic];
+}
+
+- (void) setDuckMusicInsteadOfPausing:(BOOL)duckMusicInsteadOfPausing {
+    [self setBool:kDefaultKeyDuckMusic to:duckMusicInsteadOfPausing];
+}
+
+- (NSInteger) musicDuckingDepthDB {
+    NSInteger depth = [self getInt:kDefaultKeyDuckingDepthDB or:-20];
+    return MAX(-96, MIN(0, depth));
+}
+
+- (void) setMusicDuckingDepthDB:(NSInteger)musicDuckingDepthDB {
+    [self setInt:kDefaultKeyDuckingDepthDB to:MAX(-96, MIN(0, musicDuckingDepthDB))];
+}
+
+- (NSUInteger) musicDuckingAttackMS {
+    return [self getDuckingTimeMS:kDefaultKeyDuckingAttackMS or:5];
+}
+
+- (void) setMusicDuckingAttackMS:(NSUInteger)musicDuckingAttackMS {
+    [self setInt:kDefaultKeyDuckingAttackMS to:(NSInteger)MIN(10000, musicDuckingAttackMS)];
+}
+
+- (NSUInteger) musicDuckingHoldMS {
+    return [self getDuckingTimeMS:kDefaultKeyDuckingHoldMS or:300];
+}
+
+- (void) setMusicDuckingHoldMS:(NSUInteger)musicDuckingHoldMS {
+    [self setInt:kDefaultKeyDuckingHoldMS to:(NSInteger)MIN(10000, musicDuckingHoldMS)];
+}
+
+- (NSUInteger) musicDuckingReleaseMS {
+    return [self getDuckingTimeMS:kDefaultKeyDuckingReleaseMS or:500];
+}
+
+- (void) setMusicDuckingReleaseMS:(NSUInteger)musicDuckingReleaseMS {
+    [self setInt:kDefaultKeyDuckingReleaseMS to:(NSInteger)MIN(10000, musicDuckingReleaseMS)];
+}
+
+- (NSUInteger) getDuckingTimeMS:(NSString*)key or:(NSInteger)valueIfNil {
+    // Clamp to the range BGMDriver accepts: 0ms to 10000ms
+    NSInteger time = [self getInt:key or:valueIfNil];
+    return (NSUInteger)MAX(0, MIN(10000, time));
+}
+
+#pragma mark App Volumes
+
+- (BOOL) appVolumeGainStaging {
+    return [self getBool:kDefaultKeyGainStaging];
+}
+
+- (void) setAppVolumeGainStaging:(BOOL)appVolumeGainStaging {
+    [self setBool:kDefaultKeyGainStaging to:appVolumeGainStaging];
+}
+
+#pragma mark Playthrough Latency
+
+- (BOOL) playThroughLowLatency {
+    return [self getBool:kDefaultKeyPlayThroughLowLatency];
+}
+
+- (void) setPlayThroughLowLatency:(BOOL)playThroughLowLatency {
+    [self setBool:kDefaultKeyPlayThroughLowLatency to:playThroughLowLatency];
+}
+
+- (NSUInteger) playThroughTargetLatencyMS {
+    NSInteger latency = [self getInt:kDefaultKeyPlayThroughTargetLatencyMS or:0];
+    return (NSUInteger)MAX(0, MIN(1000, latency));
+}
+
+- (void) setPlayThroughTargetLatencyMS:(NSUInteger)playThroughTargetLatencyMS {
+    [self setInt:kDefaultKeyPlayThroughTargetLatencyMS
+              to:(NSInteger)MIN(1000, playThroughTargetLatencyMS)];
+}
+
+- (NSUInteger) playThroughOutputLookahead {
+    NSInteger lookahead = [self getInt:kDefaultKeyPlayThroughOutputLookahead or:0];
+    return (NSUInteger)MAX(0, MIN(4, lookahead));
+}
+
+- (void) setPlayThroughOutputLookahead:(NSUInteger)playThroughOutputLookahead {
+    [self setInt:kDefaultKeyPlayThroughOutputLookahead
+              to:(NSInteger)MIN(4, playThroughOutputLookahead)];
+}
+
+#pragma mark Playthrough Convolution
+
+- (NSString* __nullable) playThroughImpulseResponsePath {
+    return [self get:kDefaultKeyPlayThroughImpulseResponsePath];
+}
+
+- (void) setPlayThroughImpulseResponsePath:(NSString* __nullable)playThroughImpulseResponsePath {
+    [self set:kDefaultKeyPlayThroughImpulseResponsePath to:playThroughImpulseResponsePath];
+}
+
 #pragma mark Google Play Music Desktop Player
 
 - (NSString* __nullable) googlePlayMusicDesktopPlayerPermanentAuthCode {
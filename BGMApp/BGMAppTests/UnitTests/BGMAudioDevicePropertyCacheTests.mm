@@ -0,0 +1,230 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGMAudioDevicePropertyCacheTests.mm
+//  BGMAppUnitTests
+//
+//  Copyright © 2026 Kyle Neideck
+//
+
+// Unit Include
+#import "BGMAudioDevicePropertyCache.h"
+
+// Local Includes
+#import "BGM_Types.h"
+#import "BGMAudioDevice.h"
+#import "MockAudioObjects.h"
+
+// STL Includes
+#import <memory>
+#import <vector>
+
+// System Includes
+#import <XCTest/XCTest.h>
+
+
+// Notes:
+//  - The mock HAL can't add listener blocks, so the cache only caches the properties that can't
+//    change, e.g. the UID, in these tests. The others are read from the mock HAL every time.
+//  - The mock devices' IDs are derived from their UIDs, so the cache would remember them between
+//    tests. The tests tell the cache the devices have been removed to stop that.
+
+@interface BGMAudioDevicePropertyCacheTests : XCTestCase
+
+@end
+
+@implementation BGMAudioDevicePropertyCacheTests {
+    std::vector<std::shared_ptr<MockAudioDevice>> mockDevices;
+}
+
+- (void) setUp {
+    [super setUp];
+
+    mockDevices = {
+        MockAudioObjects::CreateMockDevice(kBGMDeviceUID),
+        MockAudioObjects::CreateMockDevice("Mock Output Device 1"),
+        MockAudioObjects::CreateMockDevice("Mock Output Device 2"),
+        MockAudioObjects::CreateMockDevice("Mock Output Device 3")
+    };
+
+    [self removeDevicesFromCache];
+}
+
+- (void) tearDown {
+    [self removeDevicesFromCache];
+    mockDevices.clear();
+    MockAudioObjects::DestroyMocks();
+    [super tearDown];
+}
+
+- (void) removeDevicesFromCache {
+    const AudioObjectPropertyAddress isAlive = {
+        kAudioDevicePropertyDeviceIsAlive,
+        kAudioObjectPropertyScopeGlobal,
+        kAudioObjectPropertyElementMaster
+    };
+
+    for(std::shared_ptr<MockAudioDevice> mockDevice : mockDevices)
+    {
+        BGMAudioDevicePropertyCache::PropertiesChanged(mockDevice->GetObjectID(), 1, &isAlive);
+    }
+}
+
+- (UInt32) totalPropertyReadCount {
+    UInt32 count = 0;
+
+    for(std::shared_ptr<MockAudioDevice> mockDevice : mockDevices)
+    {
+        count += mockDevice->mPropertyReadCount;
+    }
+
+    return count;
+}
+
+// Reads the properties BGMOutputDeviceMenuSection reads for each device when it populates the
+// output device menu.
+- (void) openOutputDeviceMenu {
+    for(std::shared_ptr<MockAudioDevice> mockDevice : mockDevices)
+    {
+        BGMAudioDevice device(mockDevice->GetObjectID());
+
+        if(device.CanBeOutputDeviceInBGMApp())
+        {
+            CFRelease(device.CopyName());
+            device.GetTransportType();
+        }
+    }
+}
+
+// Reads the properties that BGMAudioDeviceManager and BGMPreferredOutputDevices read when the output
+// device changes.
+- (void) switchOutputDeviceTo:(std::shared_ptr<MockAudioDevice>)mockDevice {
+    BGMAudioDevice device(mockDevice->GetObjectID());
+    XCTAssertFalse(device.IsBGMDeviceInstance());
+    XCTAssertTrue(device.CanBeOutputDeviceInBGMApp());
+    CFRelease(device.CopyDeviceUID());
+}
+
+- (void) testUIDFetchedOnce {
+    BGMAudioDevice device(mockDevices[1]->GetObjectID());
+
+    for(int i = 0; i < 10; i++)
+    {
+        CFStringRef uid = device.CopyDeviceUID();
+        XCTAssertTrue(CFEqual(uid, CFSTR("Mock Output Device 1")));
+        CFRelease(uid);
+
+        XCTAssertFalse(device.IsBGMDevice());
+        XCTAssertFalse(BGMAudioDevice(mockDevices[1]->GetObjectID()).IsBGMDeviceInstance());
+        XCTAssertTrue(BGMAudioDevice(mockDevices[0]->GetObjectID()).IsBGMDevice());
+    }
+
+    XCTAssertEqual(mockDevices[0]->mPropertyReadCount, 1u);
+    XCTAssertEqual(mockDevices[1]->mPropertyReadCount, 1u);
+}
+
+- (void) testTransportTypeFetchedOnce {
+    mockDevices[1]->mTransportType = kAudioDeviceTransportTypeAirPlay;
+
+    for(int i = 0; i < 10; i++)
+    {
+        XCTAssertEqual(BGMAudioDevice(mockDevices[1]->GetObjectID()).GetTransportType(),
+                       kAudioDeviceTransportTypeAirPlay);
+    }
+
+    XCTAssertEqual(mockDevices[1]->mPropertyReadCount, 1u);
+}
+
+- (void) testMenuOpen {
+    std::vector<UInt32> readsPerOpen;
+
+    for(int i = 0; i < 5; i++)
+    {
+        UInt32 readsBefore = [self totalPropertyReadCount];
+        [self openOutputDeviceMenu];
+        readsPerOpen.push_back([self totalPropertyReadCount] - readsBefore);
+
+        NSLog(@"Opening the output device menu read %u properties from the mock HAL",
+              readsPerOpen.back());
+    }
+
+    // The first time the menu opens, the UID and transport type of each device are fetched. After
+    // that, they're cached.
+    const UInt32 kNumDevices = static_cast<UInt32>(mockDevices.size());
+    // Every device but BGMDevice has a transport type read.
+    const UInt32 kImmutableReadsPerOpen = kNumDevices + (kNumDevices - 1);
+
+    for(size_t i = 1; i < readsPerOpen.size(); i++)
+    {
+        XCTAssertEqual(readsPerOpen[i], readsPerOpen[0] - kImmutableReadsPerOpen);
+    }
+}
+
+- (void) testDeviceSwitch {
+    [self switchOutputDeviceTo:mockDevices[1]];
+    [self switchOutputDeviceTo:mockDevices[2]];
+
+    UInt32 readsBefore = [self totalPropertyReadCount];
+
+    [self switchOutputDeviceTo:mockDevices[1]];
+    [self switchOutputDeviceTo:mockDevices[2]];
+
+    UInt32 readsAfter = [self totalPropertyReadCount];
+
+    NSLog(@"Switching between two cached output devices read %u properties from the mock HAL",
+          readsAfter - readsBefore);
+
+    // The UIDs aren't fetched again. The properties that can change are, since the mock HAL can't
+    // notify the cache when they change.
+    XCTAssertEqual(readsAfter - readsBefore, 2 * 3u);
+}
+
+- (void) testPropertiesThatCanChangeNotCachedWithoutListener {
+    BGMAudioDevice device(mockDevices[1]->GetObjectID());
+
+    mockDevices[1]->mName = "Before";
+    CFStringRef name = device.CopyName();
+    XCTAssertTrue(CFEqual(name, CFSTR("Before")));
+    CFRelease(name);
+
+    // The mock HAL doesn't send a notification for this, so the cache must not have kept the old
+    // name.
+    mockDevices[1]->mName = "After";
+    name = device.CopyName();
+    XCTAssertTrue(CFEqual(name, CFSTR("After")));
+    CFRelease(name);
+
+    device.SetIOBufferSize(256);
+    XCTAssertEqual(device.GetIOBufferSize(), 256u);
+    device.SetIOBufferSize(1024);
+    XCTAssertEqual(device.GetIOBufferSize(), 1024u);
+}
+
+- (void) testRemovedDeviceForgotten {
+    BGMAudioDevice device(mockDevices[1]->GetObjectID());
+
+    CFRelease(device.CopyDeviceUID());
+    CFRelease(device.CopyDeviceUID());
+    XCTAssertEqual(mockDevices[1]->mPropertyReadCount, 1u);
+
+    [self removeDevicesFromCache];
+
+    CFRelease(device.CopyDeviceUID());
+    XCTAssertEqual(mockDevices[1]->mPropertyReadCount, 2u);
+}
+
+@end
+
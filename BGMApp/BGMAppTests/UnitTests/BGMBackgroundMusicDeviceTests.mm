@@ -0,0 +1,203 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGMBackgroundMusicDeviceTests.mm
+//  BGMAppUnitTests
+//
+//  Copyright © 2026 Kyle Neideck
+//
+
+// Unit Include
+#import "BGMBackgroundMusicDevice.h"
+
+// Local Includes
+#import "BGM_Types.h"
+#import "MockAudioObjects.h"
+
+// PublicUtility Includes
+#import "CACFDictionary.h"
+
+// STL Includes
+#import <chrono>
+#import <memory>
+
+// System Includes
+#import <XCTest/XCTest.h>
+
+
+@interface BGMBackgroundMusicDeviceTests : XCTestCase
+
+@end
+
+@implementation BGMBackgroundMusicDeviceTests {
+    std::shared_ptr<MockAudioDevice> mockBGMDevice;
+    std::shared_ptr<MockAudioDevice> mockUISoundsDevice;
+}
+
+- (void) setUp {
+    [super setUp];
+
+    mockBGMDevice = MockAudioObjects::CreateMockDevice(kBGMDeviceUID);
+    mockUISoundsDevice = MockAudioObjects::CreateMockDevice(kBGMDeviceUID_UISounds);
+
+    // Start each test at the beginning of a send interval, i.e. with the next change sent
+    // immediately.
+    BGMBackgroundMusicDevice::FlushAppVolumeChanges();
+    [self waitForSendInterval];
+}
+
+- (void) tearDown {
+    BGMBackgroundMusicDevice::FlushAppVolumeChanges();
+    MockAudioObjects::DestroyMocks();
+    [super tearDown];
+}
+
+- (void) waitForSendInterval {
+    // Twice the interval so any scheduled send has finished.
+    [NSThread sleepForTimeInterval:(2 * BGMBackgroundMusicDevice::kAppVolumeSendIntervalMs / 1000.0)];
+}
+
+// Finds the change for inProcessID in the most recent update sent to inDevice.
+- (BOOL) appVolumeChange:(CACFDictionary&)outChange
+                  device:(const MockAudioDevice&)inDevice
+               processID:(pid_t)inProcessID {
+    for(UInt32 i = 0; i < inDevice.mAppVolumes.GetNumberItems(); i++)
+    {
+        CACFDictionary change(false);
+        inDevice.mAppVolumes.GetCACFDictionary(i, change);
+
+        SInt32 pid = 0;
+
+        if(change.GetSInt32(CFSTR(kBGMAppVolumesKey_ProcessID), pid) && (pid == inProcessID))
+        {
+            outChange = change;
+            return YES;
+        }
+    }
+
+    return NO;
+}
+
+- (void) testDragIsCoalesced {
+    BGMBackgroundMusicDevice bgmDevice;
+
+    // Simulate the user dragging an app's volume slider from one end to the other, with a
+    // mouse-moved event for each step.
+    auto startTime = std::chrono::steady_clock::now();
+
+    for(SInt32 volume = kAppRelativeVolumeMinRawValue;
+        volume <= kAppRelativeVolumeMaxRawValue;
+        volume++)
+    {
+        bgmDevice.SetAppVolume(volume, 100, CFSTR("com.example.app"));
+    }
+
+    auto dragMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - startTime).count();
+
+    [self waitForSendInterval];
+
+    const UInt32 kEventCount = kAppRelativeVolumeMaxRawValue - kAppRelativeVolumeMinRawValue + 1;
+    // The first change is sent immediately and then at most one update per interval, plus the
+    // final one.
+    const UInt32 kMaxUpdates =
+            2 + static_cast<UInt32>(dragMs) / BGMBackgroundMusicDevice::kAppVolumeSendIntervalMs;
+
+    for(std::shared_ptr<MockAudioDevice> device : { mockBGMDevice, mockUISoundsDevice })
+    {
+        NSLog(@"%u volume changes sent to BGMDevice as %u property updates in %lld ms",
+              kEventCount,
+              device->mAppVolumesUpdateCount,
+              dragMs);
+
+        XCTAssertGreaterThanOrEqual(device->mAppVolumesUpdateCount, 1u);
+        XCTAssertLessThanOrEqual(device->mAppVolumesUpdateCount, kMaxUpdates);
+        XCTAssertLessThan(device->mAppVolumesUpdateCount, kEventCount);
+
+        // The final volume is always sent.
+        CACFDictionary change(false);
+        XCTAssertTrue([self appVolumeChange:change device:*device processID:100]);
+
+        SInt32 volume = -1;
+        XCTAssertTrue(change.GetSInt32(CFSTR(kBGMAppVolumesKey_RelativeVolume), volume));
+        XCTAssertEqual(volume, kAppRelativeVolumeMaxRawValue);
+    }
+}
+
+- (void) testVolumeAndPanMerged {
+    BGMBackgroundMusicDevice bgmDevice;
+
+    // Sent immediately.
+    bgmDevice.SetAppVolume(10, 100, CFSTR("com.example.app"));
+    XCTAssertEqual(mockBGMDevice->mAppVolumesUpdateCount, 1u);
+
+    // Queued and merged into one change for the app.
+    bgmDevice.SetAppVolume(20, 100, CFSTR("com.example.app"));
+    bgmDevice.SetAppPanPosition(-30, 100, CFSTR("com.example.app"));
+    bgmDevice.SetAppVolume(40, 100, CFSTR("com.example.app"));
+
+    [self waitForSendInterval];
+
+    XCTAssertEqual(mockBGMDevice->mAppVolumesUpdateCount, 2u);
+    XCTAssertEqual(mockBGMDevice->mAppVolumes.GetNumberItems(), 1u);
+
+    CACFDictionary change(false);
+    XCTAssertTrue([self appVolumeChange:change device:*mockBGMDevice processID:100]);
+
+    SInt32 volume = -1;
+    SInt32 pan = 0;
+    XCTAssertTrue(change.GetSInt32(CFSTR(kBGMAppVolumesKey_RelativeVolume), volume));
+    XCTAssertTrue(change.GetSInt32(CFSTR(kBGMAppVolumesKey_PanPosition), pan));
+    XCTAssertEqual(volume, 40);
+    XCTAssertEqual(pan, -30);
+}
+
+- (void) testSetAppVolumesSendsQueuedChanges {
+    BGMBackgroundMusicDevice bgmDevice;
+
+    bgmDevice.SetAppVolume(10, 100, CFSTR("com.example.a"));
+    bgmDevice.SetAppPanPosition(25, 100, CFSTR("com.example.a"));
+    bgmDevice.SetAppVolume(60, 101, CFSTR("com.example.b"));
+
+    // Replaces the queued volume for b and sends a's pan position in the same update.
+    BGMBackgroundMusicDevice::AppVolume appVolume;
+    appVolume.mVolume = 70;
+    appVolume.mProcessID = 101;
+    appVolume.mBundleID = CFSTR("com.example.b");
+    bgmDevice.SetAppVolumes({ appVolume });
+
+    XCTAssertEqual(mockBGMDevice->mAppVolumesUpdateCount, 2u);
+    XCTAssertEqual(mockBGMDevice->mAppVolumes.GetNumberItems(), 2u);
+
+    CACFDictionary changeA(false);
+    SInt32 pan = 0;
+    XCTAssertTrue([self appVolumeChange:changeA device:*mockBGMDevice processID:100]);
+    XCTAssertTrue(changeA.GetSInt32(CFSTR(kBGMAppVolumesKey_PanPosition), pan));
+    XCTAssertEqual(pan, 25);
+
+    CACFDictionary changeB(false);
+    SInt32 volume = -1;
+    XCTAssertTrue([self appVolumeChange:changeB device:*mockBGMDevice processID:101]);
+    XCTAssertTrue(changeB.GetSInt32(CFSTR(kBGMAppVolumesKey_RelativeVolume), volume));
+    XCTAssertEqual(volume, 70);
+
+    // Nothing was left queued.
+    [self waitForSendInterval];
+    XCTAssertEqual(mockBGMDevice->mAppVolumesUpdateCount, 2u);
+}
+
+@end
+
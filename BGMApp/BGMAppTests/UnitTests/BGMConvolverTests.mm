@@ -0,0 +1,237 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGMConvolverTests.mm
+//  BGMAppUnitTests
+//
+//  Copyright © 2026 Kyle Neideck
+//
+
+// Unit Include
+#import "BGMConvolver.h"
+
+// PublicUtility Includes
+#import "CAException.h"
+
+// STL Includes
+#import <algorithm>
+#import <chrono>
+#import <cmath>
+#import <thread>
+#import <vector>
+
+// System Includes
+#import <XCTest/XCTest.h>
+
+
+static const UInt32 kChannelCount = 2;
+
+// Deterministic noise in [-1, 1].
+static std::vector<Float32> MakeNoise(UInt32 inSampleCount, UInt32 inSeed)
+{
+    std::vector<Float32> theNoise(inSampleCount);
+    UInt32 theState = inSeed;
+
+    for(Float32& theSample : theNoise)
+    {
+        theState = theState * 1664525 + 1013904223;
+        theSample = static_cast<Float32>(theState >> 8) / static_cast<Float32>(1 << 23) - 1.0f;
+    }
+
+    return theNoise;
+}
+
+@interface BGMConvolverTests : XCTestCase
+
+@end
+
+@implementation BGMConvolverTests
+
+// The impulse responses are loaded on a background thread, so wait until the convolver reports
+// the latency of one.
+- (void) waitForImpulseResponse:(const BGMConvolver&)convolver {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+
+    while(convolver.GetLatencyFrames() == 0 && std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    XCTAssertNotEqual(convolver.GetLatencyFrames(), 0u);
+}
+
+// Passes the frames through the convolver in buffers of varying sizes, none larger than
+// maxFrames, like an IOProc would.
+- (std::vector<Float32>) process:(const std::vector<Float32>&)input
+                       convolver:(BGMConvolver&)convolver
+                       maxFrames:(UInt32)maxFrames {
+    std::vector<Float32> output(input);
+    const UInt32 frameCount = static_cast<UInt32>(input.size() / kChannelCount);
+    UInt32 offset = 0;
+
+    while(offset < frameCount)
+    {
+        UInt32 frames = std::min(maxFrames - (offset % 7), frameCount - offset);
+        convolver.ProcessRT(&output[offset * kChannelCount], frames, kChannelCount);
+        offset += frames;
+    }
+
+    return output;
+}
+
+- (void) testBypassedWithoutImpulseResponse {
+    BGMConvolver convolver;
+    convolver.Configure(kChannelCount, 512);
+
+    XCTAssertEqual(convolver.GetLatencyFrames(), 0u);
+
+    std::vector<Float32> input = MakeNoise(2048 * kChannelCount, 1);
+    XCTAssert([self process:input convolver:convolver maxFrames:512] == input);
+}
+
+- (void) testLatencyIsOnePartition {
+    BGMConvolver convolver;
+    convolver.Configure(kChannelCount, 512);
+    convolver.SetImpulseResponse({ 1.0f }, 1);
+    [self waitForImpulseResponse:convolver];
+    XCTAssertEqual(convolver.GetLatencyFrames(), 512u);
+
+    // Buffer sizes that aren't powers of two are rounded up, and small ones are rounded up to
+    // kMinPartitionFrames.
+    convolver.Configure(kChannelCount, 500);
+    XCTAssertEqual(convolver.GetLatencyFrames(), 512u);
+    convolver.Configure(kChannelCount, 14);
+    XCTAssertEqual(convolver.GetLatencyFrames(), BGMConvolver::kMinPartitionFrames);
+}
+
+- (void) testUnitImpulseDelaysByOnePartition {
+    BGMConvolver convolver;
+    convolver.Configure(kChannelCount, 256);
+    convolver.SetImpulseResponse({ 1.0f }, 1);
+    [self waitForImpulseResponse:convolver];
+
+    const UInt32 latency = convolver.GetLatencyFrames();
+    std::vector<Float32> input = MakeNoise(4096 * kChannelCount, 2);
+    std::vector<Float32> output = [self process:input convolver:convolver maxFrames:256];
+
+    for(UInt32 i = 0; i < latency * kChannelCount; i++)
+    {
+        XCTAssertEqualWithAccuracy(output[i], 0.0f, 1e-6f);
+    }
+
+    for(UInt32 i = latency * kChannelCount; i < output.size(); i++)
+    {
+        XCTAssertEqualWithAccuracy(output[i], input[i - latency * kChannelCount], 1e-5f);
+    }
+}
+
+- (void) testMatchesDirectConvolution {
+    // Long enough to be split into several partitions, and not a multiple of the partition size.
+    const UInt32 irFrames = 1000;
+    std::vector<Float32> impulseResponse = MakeNoise(irFrames * kChannelCount, 3);
+
+    BGMConvolver convolver;
+    convolver.Configure(kChannelCount, 100);
+    convolver.SetImpulseResponse(impulseResponse, kChannelCount);
+    [self waitForImpulseResponse:convolver];
+
+    const UInt32 latency = convolver.GetLatencyFrames();
+    const UInt32 frameCount = 6000;
+    std::vector<Float32> input = MakeNoise(frameCount * kChannelCount, 4);
+    std::vector<Float32> output = [self process:input convolver:convolver maxFrames:100];
+
+    Float64 maxError = 0.0;
+
+    for(UInt32 frame = latency; frame < frameCount; frame++)
+    {
+        for(UInt32 channel = 0; channel < kChannelCount; channel++)
+        {
+            const UInt32 inputFrame = frame - latency;
+            Float64 expected = 0.0;
+
+            for(UInt32 k = 0; k < irFrames && k <= inputFrame; k++)
+            {
+                expected += impulseResponse[k * kChannelCount + channel] *
+                        input[(inputFrame - k) * kChannelCount + channel];
+            }
+
+            maxError = std::max(maxError, fabs(expected - output[frame * kChannelCount + channel]));
+        }
+    }
+
+    XCTAssertLessThan(maxError, 1e-3);
+}
+
+- (void) testMonoImpulseResponseAppliesToAllChannels {
+    BGMConvolver convolver;
+    convolver.Configure(kChannelCount, 128);
+    convolver.SetImpulseResponse({ 0.0f, 0.5f }, 1);
+    [self waitForImpulseResponse:convolver];
+
+    const UInt32 delay = convolver.GetLatencyFrames() + 1;
+    std::vector<Float32> input = MakeNoise(1024 * kChannelCount, 5);
+    std::vector<Float32> output = [self process:input convolver:convolver maxFrames:128];
+
+    for(UInt32 i = delay * kChannelCount; i < output.size(); i++)
+    {
+        XCTAssertEqualWithAccuracy(output[i], 0.5f * input[i - delay * kChannelCount], 1e-5f);
+    }
+}
+
+- (void) testClearImpulseResponse {
+    BGMConvolver convolver;
+    convolver.Configure(kChannelCount, 512);
+    convolver.SetImpulseResponse(MakeNoise(4096, 6), 1);
+    [self waitForImpulseResponse:convolver];
+
+    convolver.ClearImpulseResponse();
+    XCTAssertEqual(convolver.GetLatencyFrames(), 0u);
+
+    std::vector<Float32> input = MakeNoise(2048 * kChannelCount, 7);
+    XCTAssert([self process:input convolver:convolver maxFrames:512] == input);
+}
+
+- (void) testChannelCountMismatchIsBypassed {
+    BGMConvolver convolver;
+    convolver.Configure(6, 512);
+    convolver.SetImpulseResponse({ 0.5f }, 1);
+    [self waitForImpulseResponse:convolver];
+
+    std::vector<Float32> input = MakeNoise(2048 * kChannelCount, 8);
+    XCTAssert([self process:input convolver:convolver maxFrames:512] == input);
+}
+
+- (void) testNoChannelsThrows {
+    BGMConvolver convolver;
+    convolver.Configure(kChannelCount, 512);
+
+    bool threw = false;
+
+    try
+    {
+        convolver.SetImpulseResponse({ 1.0f }, 0);
+    }
+    catch(const CAException&)
+    {
+        threw = true;
+    }
+
+    XCTAssert(threw);
+    XCTAssertEqual(convolver.GetLatencyFrames(), 0u);
+}
+
+@end
+
@@ -0,0 +1,273 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGMGainStagingTests.mm
+//  BGMAppUnitTests
+//
+//  Copyright © 2026 Kyle Neideck
+//
+
+// Unit Include
+#import "BGMGainStaging.h"
+
+// Local Includes
+#import "BGM_Types.h"
+#import "BGMBackgroundMusicDevice.h"
+#import "MockAudioObjects.h"
+
+// PublicUtility Includes
+#import "CACFDictionary.h"
+
+// STL Includes
+#import <cmath>
+#import <memory>
+
+// System Includes
+#import <XCTest/XCTest.h>
+
+
+@interface BGMGainStagingTests : XCTestCase
+
+@end
+
+@implementation BGMGainStagingTests {
+    std::shared_ptr<MockAudioDevice> mockBGMDevice;
+    std::shared_ptr<MockAudioDevice> mockUISoundsDevice;
+    std::shared_ptr<MockAudioDevice> mockOutputDevice;
+}
+
+- (void) setUp {
+    [super setUp];
+
+    mockBGMDevice = MockAudioObjects::CreateMockDevice(kBGMDeviceUID);
+    mockUISoundsDevice = MockAudioObjects::CreateMockDevice(kBGMDeviceUID_UISounds);
+    mockOutputDevice = MockAudioObjects::CreateMockDevice("Mock Output Device");
+
+    mockBGMDevice->mHasVolumeControl = true;
+    mockOutputDevice->mHasVolumeControl = true;
+    mockOutputDevice->mMinVolumeDb = -64.0f;
+    mockOutputDevice->mMaxVolumeDb = 0.0f;
+}
+
+- (void) tearDown {
+    MockAudioObjects::DestroyMocks();
+    [super tearDown];
+}
+
+// Sets BGMDevice's volume, i.e. the volume the user has chosen, so it corresponds to inDb on the
+// output device.
+- (void) setUserVolumeDb:(Float32)inDb {
+    mockBGMDevice->mVolumeDb =
+            mockBGMDevice->VolumeScalarToDecibels(mockOutputDevice->VolumeDecibelsToScalar(inDb));
+}
+
+- (Float32) gainDb:(const BGMGainStaging&)gainStaging appVolume:(SInt32)appVolume {
+    return 20.0f * log10f(gainStaging.GainForAppVolume(appVolume));
+}
+
+- (void) testGainConversionsMatchBGMDriver {
+    BGMGainStaging gainStaging;
+
+    XCTAssertEqual(gainStaging.GainForAppVolume(kAppRelativeVolumeMinRawValue), 0.0f);
+    XCTAssertEqualWithAccuracy(gainStaging.GainForAppVolume(50), 1.0f, 0.0001f);
+    XCTAssertEqualWithAccuracy(gainStaging.GainForAppVolume(kAppRelativeVolumeMaxRawValue),
+                               4.0f,
+                               0.0001f);
+
+    for(SInt32 volume = kAppRelativeVolumeMinRawValue;
+        volume <= kAppRelativeVolumeMaxRawValue;
+        volume++)
+    {
+        XCTAssertEqual(gainStaging.AppVolumeForGain(gainStaging.GainForAppVolume(volume)), volume);
+    }
+
+    // Out of range gains are clamped.
+    XCTAssertEqual(gainStaging.AppVolumeForGain(100.0f), kAppRelativeVolumeMaxRawValue);
+    XCTAssertEqual(gainStaging.AppVolumeForGain(-1.0f), kAppRelativeVolumeMinRawValue);
+}
+
+- (void) testCalculateBoostDb {
+    // Enough headroom for the whole boost.
+    XCTAssertEqual(BGMGainStaging::CalculateBoostDb(12.0f, -20.0f, 0.0f), 12.0f);
+    // Limited by the headroom.
+    XCTAssertEqual(BGMGainStaging::CalculateBoostDb(12.0f, -6.0f, 0.0f), 6.0f);
+    XCTAssertEqual(BGMGainStaging::CalculateBoostDb(12.0f, 0.0f, 0.0f), 0.0f);
+    XCTAssertEqual(BGMGainStaging::CalculateBoostDb(12.0f, 3.0f, 0.0f), 0.0f);
+    // Nothing to absorb.
+    XCTAssertEqual(BGMGainStaging::CalculateBoostDb(0.0f, -20.0f, 0.0f), 0.0f);
+    XCTAssertEqual(BGMGainStaging::CalculateBoostDb(NAN, -20.0f, 0.0f), 0.0f);
+    XCTAssertEqual(BGMGainStaging::CalculateBoostDb(12.0f, NAN, 0.0f), 0.0f);
+}
+
+- (void) testRequiredBoost {
+    BGMGainStaging gainStaging;
+    XCTAssertEqual(gainStaging.GetRequiredBoostDb(), 0.0f);
+
+    gainStaging.SetAppVolume(30, 100, CFSTR("com.example.quiet"));
+    XCTAssertEqual(gainStaging.GetRequiredBoostDb(), 0.0f);
+
+    gainStaging.SetAppVolume(kAppRelativeVolumeMaxRawValue, 101, CFSTR("com.example.loud"));
+    XCTAssertEqualWithAccuracy(gainStaging.GetRequiredBoostDb(), 20.0f * log10f(4.0f), 0.001f);
+
+    // Setting the same app's volume again, matched by bundle ID, replaces its volume.
+    gainStaging.SetAppVolume(50, -1, CFSTR("com.example.loud"));
+    XCTAssertEqualWithAccuracy(gainStaging.GetRequiredBoostDb(), 0.0f, 0.001f);
+    XCTAssertEqual(gainStaging.GetRequestedAppVolumes().size(), 2u);
+}
+
+- (void) testNoBoostedApps {
+    BGMGainStaging gainStaging;
+    gainStaging.SetAppVolume(50, 100, CFSTR("com.example.a"));
+    gainStaging.SetAppVolume(20, 101, CFSTR("com.example.b"));
+
+    [self setUserVolumeDb:-30.0f];
+
+    BGMAudioDevice bgmDevice(CFSTR(kBGMDeviceUID));
+    BGMAudioDevice outputDevice(CFSTR("Mock Output Device"));
+
+    XCTAssertFalse(gainStaging.UpdateOutputVolume(bgmDevice, outputDevice));
+    XCTAssertEqual(gainStaging.GetBoostDb(), 0.0f);
+    XCTAssertEqualWithAccuracy(mockOutputDevice->mVolumeDb, -30.0f, 0.001f);
+
+    // The app volumes are sent unchanged.
+    std::vector<BGMBackgroundMusicDevice::AppVolume> staged = gainStaging.GetStagedAppVolumes();
+    XCTAssertEqual(staged.size(), 2u);
+    XCTAssertEqual(staged[0].mVolume, 50);
+    XCTAssertEqual(staged[1].mVolume, 20);
+}
+
+- (void) testBoostAbsorbedByOutputDevice {
+    BGMGainStaging gainStaging;
+    gainStaging.SetAppVolume(kAppRelativeVolumeMaxRawValue, 100, CFSTR("com.example.loud"));
+    gainStaging.SetAppVolume(50, 101, CFSTR("com.example.unity"));
+    gainStaging.SetAppVolume(25, 102, CFSTR("com.example.quiet"));
+
+    [self setUserVolumeDb:-30.0f];
+
+    BGMAudioDevice bgmDevice(CFSTR(kBGMDeviceUID));
+    BGMAudioDevice outputDevice(CFSTR("Mock Output Device"));
+
+    XCTAssertTrue(gainStaging.UpdateOutputVolume(bgmDevice, outputDevice));
+
+    // The whole +12 dB fits, so the loudest app is played at unity gain by BGMDriver.
+    const Float32 maxBoostDb = 20.0f * log10f(4.0f);
+    XCTAssertEqualWithAccuracy(gainStaging.GetBoostDb(), maxBoostDb, 0.001f);
+    XCTAssertEqualWithAccuracy(mockOutputDevice->mVolumeDb, -30.0f + maxBoostDb, 0.001f);
+
+    std::vector<BGMBackgroundMusicDevice::AppVolume> staged = gainStaging.GetStagedAppVolumes();
+    XCTAssertEqual(staged.size(), 3u);
+    XCTAssertEqual(staged[0].mVolume, 50);
+
+    // Each app's overall gain, BGMDriver's plus the output device's boost, should be what was
+    // requested, give or take the resolution of the raw app volumes.
+    std::vector<BGMBackgroundMusicDevice::AppVolume> requested =
+            gainStaging.GetRequestedAppVolumes();
+
+    for(size_t i = 0; i < staged.size(); i++)
+    {
+        Float32 requestedDb = [self gainDb:gainStaging appVolume:requested[i].mVolume];
+        Float32 actualDb =
+                [self gainDb:gainStaging appVolume:staged[i].mVolume] + gainStaging.GetBoostDb();
+        XCTAssertEqualWithAccuracy(actualDb, requestedDb, 1.0f);
+        XCTAssertLessThanOrEqual(staged[i].mVolume, 50);
+    }
+
+    // Calling it again without any changes doesn't change the boost.
+    XCTAssertFalse(gainStaging.UpdateOutputVolume(bgmDevice, outputDevice));
+}
+
+- (void) testBoostLimitedByHeadroom {
+    BGMGainStaging gainStaging;
+    gainStaging.SetAppVolume(kAppRelativeVolumeMaxRawValue, 100, CFSTR("com.example.loud"));
+
+    // Only 6 dB below the output device's maximum.
+    [self setUserVolumeDb:-6.0f];
+
+    BGMAudioDevice bgmDevice(CFSTR(kBGMDeviceUID));
+    BGMAudioDevice outputDevice(CFSTR("Mock Output Device"));
+
+    XCTAssertTrue(gainStaging.UpdateOutputVolume(bgmDevice, outputDevice));
+    XCTAssertEqualWithAccuracy(gainStaging.GetBoostDb(), 6.0f, 0.001f);
+    XCTAssertEqualWithAccuracy(mockOutputDevice->mVolumeDb, 0.0f, 0.001f);
+
+    // BGMDriver applies the rest of the boost.
+    std::vector<BGMBackgroundMusicDevice::AppVolume> staged = gainStaging.GetStagedAppVolumes();
+    Float32 remainingDb = [self gainDb:gainStaging appVolume:staged[0].mVolume];
+    XCTAssertEqualWithAccuracy(remainingDb, 20.0f * log10f(4.0f) - 6.0f, 0.5f);
+
+    // Turning the user's volume down makes room for the rest of it.
+    [self setUserVolumeDb:-40.0f];
+    XCTAssertTrue(gainStaging.UpdateOutputVolume(bgmDevice, outputDevice));
+    XCTAssertEqualWithAccuracy(gainStaging.GetBoostDb(), 20.0f * log10f(4.0f), 0.001f);
+    XCTAssertEqual(gainStaging.GetStagedAppVolumes()[0].mVolume, 50);
+}
+
+- (void) testNoBoostWhenMuted {
+    BGMGainStaging gainStaging;
+    gainStaging.SetAppVolume(kAppRelativeVolumeMaxRawValue, 100, CFSTR("com.example.loud"));
+
+    // The user has turned the volume all the way down.
+    mockBGMDevice->mVolumeDb = mockBGMDevice->mMinVolumeDb;
+
+    BGMAudioDevice bgmDevice(CFSTR(kBGMDeviceUID));
+    BGMAudioDevice outputDevice(CFSTR("Mock Output Device"));
+
+    XCTAssertFalse(gainStaging.UpdateOutputVolume(bgmDevice, outputDevice));
+    XCTAssertEqual(gainStaging.GetBoostDb(), 0.0f);
+    XCTAssertEqual(mockOutputDevice->mVolumeDb, mockOutputDevice->mMinVolumeDb);
+    XCTAssertEqual(gainStaging.GetStagedAppVolumes()[0].mVolume, kAppRelativeVolumeMaxRawValue);
+}
+
+- (void) testStagedVolumesSentInOneUpdate {
+    BGMGainStaging gainStaging;
+    gainStaging.SetAppVolume(kAppRelativeVolumeMaxRawValue, 100, CFSTR("com.example.loud"));
+    gainStaging.SetAppVolume(40, 101, CFSTR("com.example.other"));
+
+    [self setUserVolumeDb:-30.0f];
+
+    BGMBackgroundMusicDevice bgmDevice;
+    BGMAudioDevice outputDevice(CFSTR("Mock Output Device"));
+
+    gainStaging.UpdateOutputVolume(bgmDevice, outputDevice);
+    bgmDevice.SetAppVolumes(gainStaging.GetStagedAppVolumes());
+
+    // Both instances of BGMDevice get every app's volume in a single property update.
+    for(std::shared_ptr<MockAudioDevice> device : { mockBGMDevice, mockUISoundsDevice })
+    {
+        XCTAssertEqual(device->mAppVolumesUpdateCount, 1u);
+        XCTAssertEqual(device->mAppVolumes.GetNumberItems(), 2u);
+
+        std::vector<BGMBackgroundMusicDevice::AppVolume> staged =
+                gainStaging.GetStagedAppVolumes();
+
+        for(UInt32 i = 0; i < device->mAppVolumes.GetNumberItems(); i++)
+        {
+            CACFDictionary appVolume(false);
+            device->mAppVolumes.GetCACFDictionary(i, appVolume);
+
+            SInt32 pid = 0;
+            SInt32 volume = -1;
+            XCTAssertTrue(appVolume.GetSInt32(CFSTR(kBGMAppVolumesKey_ProcessID), pid));
+            XCTAssertTrue(appVolume.GetSInt32(CFSTR(kBGMAppVolumesKey_RelativeVolume), volume));
+
+            XCTAssertEqual(pid, staged[i].mProcessID);
+            XCTAssertEqual(volume, staged[i].mVolume);
+        }
+    }
+}
+
+@end
+
@@ -0,0 +1,496 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGMOutputFormatConverterTests.mm
+//  BGMAppUnitTests
+//
+//  Copyright © 2026 Kyle Neideck
+//
+
+// Unit Include
+#import "BGMOutputFormatConverter.h"
+
+// PublicUtility Includes
+#import "CAException.h"
+
+// STL Includes
+#import <cstddef>  // For offsetof
+#import <cstring>
+#import <vector>
+
+// System Includes
+#import <XCTest/XCTest.h>
+
+
+static const UInt32 kFrames = 64;
+static const AudioFormatFlags kFloat = kAudioFormatFlagIsFloat | kAudioFormatFlagIsPacked;
+static const AudioFormatFlags kInteger = kAudioFormatFlagIsSignedInteger | kAudioFormatFlagIsPacked;
+
+static AudioStreamBasicDescription MakeFormat(AudioFormatFlags inFlags,
+                                              UInt32 inChannelCount,
+                                              UInt32 inBitsPerChannel,
+                                              UInt32 inBytesPerSample)
+{
+    const bool theIsNonInterleaved = (inFlags & kAudioFormatFlagIsNonInterleaved) != 0;
+
+    AudioStreamBasicDescription theFormat = {};
+    theFormat.mSampleRate = 44100.0;
+    theFormat.mFormatID = kAudioFormatLinearPCM;
+    theFormat.mFormatFlags = inFlags | kAudioFormatFlagsNativeEndian;
+    theFormat.mFramesPerPacket = 1;
+    theFormat.mChannelsPerFrame = inChannelCount;
+    theFormat.mBitsPerChannel = inBitsPerChannel;
+    theFormat.mBytesPerFrame = inBytesPerSample * (theIsNonInterleaved ? 1 : inChannelCount);
+    theFormat.mBytesPerPacket = theFormat.mBytesPerFrame;
+    return theFormat;
+}
+
+// Stereo where each sample is different: the left channel counts up from 1/1024 and the right
+// counts down from -1/1024.
+static std::vector<Float32> MakeStereoSource(UInt32 inFrameCount)
+{
+    std::vector<Float32> theSource(inFrameCount * 2);
+
+    for(UInt32 i = 0; i < inFrameCount; i++)
+    {
+        theSource[i * 2] = static_cast<Float32>(i + 1) / 1024.0f;
+        theSource[i * 2 + 1] = -static_cast<Float32>(i + 1) / 1024.0f;
+    }
+
+    return theSource;
+}
+
+// The buffers the HAL would give the output IOProc for a device with the given streams, filled
+// with garbage so the tests can tell which samples the converter wrote.
+class TestOutput
+{
+
+public:
+    TestOutput(const std::vector<AudioStreamBasicDescription>& inFormats, UInt32 inFrameCount)
+    {
+        for(const AudioStreamBasicDescription& theFormat : inFormats)
+        {
+            const bool theIsNonInterleaved =
+                    (theFormat.mFormatFlags & kAudioFormatFlagIsNonInterleaved) != 0;
+            const UInt32 theBufferCount = theIsNonInterleaved ? theFormat.mChannelsPerFrame : 1;
+
+            for(UInt32 i = 0; i < theBufferCount; i++)
+            {
+                mChannelCounts.push_back(theIsNonInterleaved ? 1 : theFormat.mChannelsPerFrame);
+                mData.push_back(std::vector<Byte>(inFrameCount * theFormat.mBytesPerFrame, 0xAB));
+            }
+        }
+
+        mBufferList.resize(offsetof(AudioBufferList, mBuffers) +
+                           sizeof(AudioBuffer) * mData.size());
+        Get()->mNumberBuffers = static_cast<UInt32>(mData.size());
+
+        for(UInt32 i = 0; i < mData.size(); i++)
+        {
+            Get()->mBuffers[i].mNumberChannels = mChannelCounts[i];
+            Get()->mBuffers[i].mDataByteSize = static_cast<UInt32>(mData[i].size());
+            Get()->mBuffers[i].mData = mData[i].data();
+        }
+    }
+
+    AudioBufferList* Get() { return reinterpret_cast<AudioBufferList*>(mBufferList.data()); }
+
+    // The sample for inChannel of inFrame in inBuffer, which must have samples of type T.
+    template<typename T>
+    T Sample(UInt32 inBuffer, UInt32 inFrame, UInt32 inChannel) const
+    {
+        T theSample;
+        memcpy(&theSample,
+               &mData[inBuffer][(inFrame * mChannelCounts[inBuffer] + inChannel) * sizeof(T)],
+               sizeof(T));
+        return theSample;
+    }
+
+    // A sample from a packed 24-bit buffer, sign extended.
+    SInt32 Int24Sample(UInt32 inBuffer, UInt32 inFrame, UInt32 inChannel) const
+    {
+        const Byte* theBytes =
+                &mData[inBuffer][(inFrame * mChannelCounts[inBuffer] + inChannel) * 3];
+        const UInt32 theValue = theBytes[0] | (theBytes[1] << 8) | (theBytes[2] << 16);
+        return static_cast<SInt32>(theValue << 8) >> 8;
+    }
+
+    bool IsSilent() const
+    {
+        for(const std::vector<Byte>& theData : mData)
+        {
+            for(Byte theByte : theData)
+            {
+                if(theByte != 0)
+                {
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    }
+
+private:
+    std::vector<UInt32>            mChannelCounts;
+    std::vector<std::vector<Byte>> mData;
+    std::vector<Byte>              mBufferList;
+
+};
+
+// Converts a single sample of stereo to a stereo device with the given integer format and returns
+// the left channel's sample, as written by the converter.
+template<typename T>
+static T ConvertOneSample(Float32 inSample, const AudioStreamBasicDescription& inFormat)
+{
+    BGMOutputFormatConverter theConverter;
+    theConverter.Configure(2, { inFormat }, { 1, 2 }, 1);
+
+    TestOutput theOutput({ inFormat }, 1);
+    const Float32 theSource[2] = { inSample, 0.0f };
+    theConverter.ConvertRT(theSource, 1, theOutput.Get());
+
+    return theOutput.Sample<T>(0, 0, 0);
+}
+
+@interface BGMOutputFormatConverterTests : XCTestCase
+
+@end
+
+@implementation BGMOutputFormatConverterTests
+
+- (void) testMakeChannelMap {
+    // Stereo goes to the preferred channels.
+    XCTAssert(BGMOutputFormatConverter::MakeChannelMap(2, 2, 1, 2) == std::vector<UInt32>({ 1, 2 }));
+    XCTAssert(BGMOutputFormatConverter::MakeChannelMap(2, 2, 2, 1) == std::vector<UInt32>({ 2, 1 }));
+    XCTAssert(BGMOutputFormatConverter::MakeChannelMap(2, 8, 3, 4) == std::vector<UInt32>({ 3, 4 }));
+
+    // Unless they aren't valid.
+    XCTAssert(BGMOutputFormatConverter::MakeChannelMap(2, 8, 9, 4) == std::vector<UInt32>({ 1, 2 }));
+    XCTAssert(BGMOutputFormatConverter::MakeChannelMap(2, 8, 0, 0) == std::vector<UInt32>({ 1, 2 }));
+    XCTAssert(BGMOutputFormatConverter::MakeChannelMap(2, 8, 3, 3) == std::vector<UInt32>({ 1, 2 }));
+
+    // Everything is mixed to a mono device's channel.
+    XCTAssert(BGMOutputFormatConverter::MakeChannelMap(2, 1, 1, 2) == std::vector<UInt32>({ 1, 1 }));
+    XCTAssert(BGMOutputFormatConverter::MakeChannelMap(6, 1, 1, 2) ==
+              std::vector<UInt32>({ 1, 1, 1, 1, 1, 1 }));
+
+    // Other channel counts are played on the device's first channels. Channels the device
+    // doesn't have aren't played.
+    XCTAssert(BGMOutputFormatConverter::MakeChannelMap(6, 8, 3, 4) ==
+              std::vector<UInt32>({ 1, 2, 3, 4, 5, 6 }));
+    XCTAssert(BGMOutputFormatConverter::MakeChannelMap(6, 2, 1, 2) ==
+              std::vector<UInt32>({ 1, 2, 0, 0, 0, 0 }));
+}
+
+- (void) testPassthrough {
+    BGMOutputFormatConverter converter;
+
+    converter.Configure(2, { MakeFormat(kFloat, 2, 32, 4) }, { 1, 2 }, kFrames);
+    XCTAssertTrue(converter.IsPassthrough());
+
+    // Swapped channels.
+    converter.Configure(2, { MakeFormat(kFloat, 2, 32, 4) }, { 2, 1 }, kFrames);
+    XCTAssertFalse(converter.IsPassthrough());
+
+    // More channels, more streams, non-interleaved and integer formats.
+    converter.Configure(2, { MakeFormat(kFloat, 8, 32, 4) }, { 1, 2 }, kFrames);
+    XCTAssertFalse(converter.IsPassthrough());
+    converter.Configure(2,
+                        { MakeFormat(kFloat, 2, 32, 4), MakeFormat(kFloat, 2, 32, 4) },
+                        { 1, 2 },
+                        kFrames);
+    XCTAssertFalse(converter.IsPassthrough());
+    converter.Configure(2,
+                        { MakeFormat(kFloat | kAudioFormatFlagIsNonInterleaved, 2, 32, 4) },
+                        { 1, 2 },
+                        kFrames);
+    XCTAssertFalse(converter.IsPassthrough());
+    converter.Configure(2, { MakeFormat(kInteger, 2, 16, 2) }, { 1, 2 }, kFrames);
+    XCTAssertFalse(converter.IsPassthrough());
+}
+
+- (void) testMultichannelInterleaved {
+    const std::vector<AudioStreamBasicDescription> formats = { MakeFormat(kFloat, 8, 32, 4) };
+
+    BGMOutputFormatConverter converter;
+    converter.Configure(2, formats, { 3, 4 }, kFrames);
+
+    TestOutput output(formats, kFrames);
+    XCTAssertEqual(converter.GetFrameCount(*output.Get()), kFrames);
+
+    std::vector<Float32> source = MakeStereoSource(kFrames);
+    XCTAssertTrue(converter.ConvertRT(source.data(), kFrames, output.Get()));
+
+    for(UInt32 frame = 0; frame < kFrames; frame++)
+    {
+        for(UInt32 channel = 0; channel < 8; channel++)
+        {
+            const Float32 expected = (channel == 2) ? source[frame * 2] :
+                                     (channel == 3) ? source[frame * 2 + 1] : 0.0f;
+            XCTAssertEqual(output.Sample<Float32>(0, frame, channel), expected);
+        }
+    }
+}
+
+- (void) testNonInterleaved {
+    const std::vector<AudioStreamBasicDescription> formats = {
+        MakeFormat(kFloat | kAudioFormatFlagIsNonInterleaved, 4, 32, 4)
+    };
+
+    BGMOutputFormatConverter converter;
+    converter.Configure(2, formats, { 3, 4 }, kFrames);
+
+    TestOutput output(formats, kFrames);
+    XCTAssertEqual(output.Get()->mNumberBuffers, 4u);
+    XCTAssertEqual(converter.GetFrameCount(*output.Get()), kFrames);
+
+    std::vector<Float32> source = MakeStereoSource(kFrames);
+    XCTAssertTrue(converter.ConvertRT(source.data(), kFrames, output.Get()));
+
+    for(UInt32 frame = 0; frame < kFrames; frame++)
+    {
+        XCTAssertEqual(output.Sample<Float32>(0, frame, 0), 0.0f);
+        XCTAssertEqual(output.Sample<Float32>(1, frame, 0), 0.0f);
+        XCTAssertEqual(output.Sample<Float32>(2, frame, 0), source[frame * 2]);
+        XCTAssertEqual(output.Sample<Float32>(3, frame, 0), source[frame * 2 + 1]);
+    }
+}
+
+- (void) testMultipleStreams {
+    // The channel numbers count across the streams, so 5 and 6 are the second stream's third and
+    // fourth channels.
+    const std::vector<AudioStreamBasicDescription> formats = {
+        MakeFormat(kFloat, 2, 32, 4),
+        MakeFormat(kFloat, 6, 32, 4)
+    };
+
+    BGMOutputFormatConverter converter;
+    converter.Configure(2, formats, { 5, 6 }, kFrames);
+
+    TestOutput output(formats, kFrames);
+    std::vector<Float32> source = MakeStereoSource(kFrames);
+    XCTAssertTrue(converter.ConvertRT(source.data(), kFrames, output.Get()));
+
+    for(UInt32 frame = 0; frame < kFrames; frame++)
+    {
+        XCTAssertEqual(output.Sample<Float32>(0, frame, 0), 0.0f);
+        XCTAssertEqual(output.Sample<Float32>(0, frame, 1), 0.0f);
+
+        for(UInt32 channel = 0; channel < 6; channel++)
+        {
+            const Float32 expected = (channel == 2) ? source[frame * 2] :
+                                     (channel == 3) ? source[frame * 2 + 1] : 0.0f;
+            XCTAssertEqual(output.Sample<Float32>(1, frame, channel), expected);
+        }
+    }
+}
+
+- (void) testMonoDownmix {
+    const std::vector<AudioStreamBasicDescription> formats = { MakeFormat(kFloat, 1, 32, 4) };
+
+    BGMOutputFormatConverter converter;
+    converter.Configure(2, formats, BGMOutputFormatConverter::MakeChannelMap(2, 1, 1, 2), kFrames);
+
+    TestOutput output(formats, kFrames);
+    std::vector<Float32> source = MakeStereoSource(kFrames);
+    source[0] = 0.5f;
+    source[1] = 0.25f;
+    XCTAssertTrue(converter.ConvertRT(source.data(), kFrames, output.Get()));
+
+    XCTAssertEqual(output.Sample<Float32>(0, 0, 0), 0.375f);
+
+    // The rest of the test source's frames cancel out.
+    for(UInt32 frame = 1; frame < kFrames; frame++)
+    {
+        XCTAssertEqual(output.Sample<Float32>(0, frame, 0), 0.0f);
+    }
+}
+
+- (void) testInt16 {
+    const AudioStreamBasicDescription format = MakeFormat(kInteger, 2, 16, 2);
+
+    XCTAssertEqual(ConvertOneSample<SInt16>(0.0f, format), 0);
+    XCTAssertEqual(ConvertOneSample<SInt16>(0.5f, format), 16384);
+    XCTAssertEqual(ConvertOneSample<SInt16>(-0.25f, format), -8192);
+    XCTAssertEqual(ConvertOneSample<SInt16>(-1.0f, format), -32768);
+    // Rounded to the nearest value.
+    XCTAssertEqual(ConvertOneSample<SInt16>(1.6f / 32768.0f, format), 2);
+    XCTAssertEqual(ConvertOneSample<SInt16>(-1.6f / 32768.0f, format), -2);
+    // Clipped.
+    XCTAssertEqual(ConvertOneSample<SInt16>(1.0f, format), 32767);
+    XCTAssertEqual(ConvertOneSample<SInt16>(2.0f, format), 32767);
+    XCTAssertEqual(ConvertOneSample<SInt16>(-2.0f, format), -32768);
+}
+
+- (void) testInt24Packed {
+    const AudioStreamBasicDescription format = MakeFormat(kInteger, 2, 24, 3);
+
+    BGMOutputFormatConverter converter;
+    converter.Configure(2, { format }, { 1, 2 }, kFrames);
+
+    TestOutput output({ format }, kFrames);
+    std::vector<Float32> source = MakeStereoSource(kFrames);
+    source[0] = 0.5f;
+    source[1] = -1.0f;
+    source[2] = 1.0f;
+    source[3] = -0.25f;
+    XCTAssertTrue(converter.ConvertRT(source.data(), kFrames, output.Get()));
+
+    XCTAssertEqual(output.Int24Sample(0, 0, 0), 4194304);
+    XCTAssertEqual(output.Int24Sample(0, 0, 1), -8388608);
+    XCTAssertEqual(output.Int24Sample(0, 1, 0), 8388607);
+    XCTAssertEqual(output.Int24Sample(0, 1, 1), -2097152);
+
+    for(UInt32 frame = 2; frame < kFrames; frame++)
+    {
+        XCTAssertEqual(output.Int24Sample(0, frame, 0), static_cast<SInt32>(frame + 1) * 8192);
+        XCTAssertEqual(output.Int24Sample(0, frame, 1), -static_cast<SInt32>(frame + 1) * 8192);
+    }
+}
+
+- (void) testInt24InFourBytes {
+    // Aligned high, i.e. in the top three bytes.
+    const AudioStreamBasicDescription alignedHigh =
+            MakeFormat(kInteger | kAudioFormatFlagIsAlignedHigh, 2, 24, 4);
+    XCTAssertEqual(ConvertOneSample<SInt32>(0.5f, alignedHigh), 4194304 * 256);
+    XCTAssertEqual(ConvertOneSample<SInt32>(-1.0f, alignedHigh), -8388608 * 256);
+    XCTAssertEqual(ConvertOneSample<SInt32>(1.0f, alignedHigh), 8388607 * 256);
+
+    // Aligned low.
+    AudioStreamBasicDescription alignedLow = MakeFormat(kInteger, 2, 24, 4);
+    alignedLow.mFormatFlags &= ~kAudioFormatFlagIsPacked;
+    XCTAssertEqual(ConvertOneSample<SInt32>(0.5f, alignedLow), 4194304);
+    XCTAssertEqual(ConvertOneSample<SInt32>(-1.0f, alignedLow), -8388608);
+}
+
+- (void) testInt32 {
+    const AudioStreamBasicDescription format = MakeFormat(kInteger, 2, 32, 4);
+
+    XCTAssertEqual(ConvertOneSample<SInt32>(0.0f, format), 0);
+    XCTAssertEqual(ConvertOneSample<SInt32>(0.5f, format), 1073741824);
+    XCTAssertEqual(ConvertOneSample<SInt32>(-1.0f, format), INT32_MIN);
+    // Clipped to the largest Float32 that fits, rather than overflowing.
+    XCTAssertEqual(ConvertOneSample<SInt32>(1.0f, format), 2147483520);
+    XCTAssertEqual(ConvertOneSample<SInt32>(8.0f, format), 2147483520);
+}
+
+- (void) testIntegerMultichannel {
+    // The integer formats can be routed as well.
+    const std::vector<AudioStreamBasicDescription> formats = { MakeFormat(kInteger, 8, 16, 2) };
+
+    BGMOutputFormatConverter converter;
+    converter.Configure(2, formats, { 7, 8 }, kFrames);
+
+    TestOutput output(formats, kFrames);
+    std::vector<Float32> source = MakeStereoSource(kFrames);
+    XCTAssertTrue(converter.ConvertRT(source.data(), kFrames, output.Get()));
+
+    for(UInt32 frame = 0; frame < kFrames; frame++)
+    {
+        for(UInt32 channel = 0; channel < 6; channel++)
+        {
+            XCTAssertEqual(output.Sample<SInt16>(0, frame, channel), 0);
+        }
+
+        XCTAssertEqual(output.Sample<SInt16>(0, frame, 6), static_cast<SInt32>(frame + 1) * 32);
+        XCTAssertEqual(output.Sample<SInt16>(0, frame, 7), -static_cast<SInt32>(frame + 1) * 32);
+    }
+}
+
+- (void) testUnsupportedFormats {
+    AudioStreamBasicDescription bigEndian = MakeFormat(kInteger, 2, 16, 2);
+    bigEndian.mFormatFlags ^= kAudioFormatFlagIsBigEndian;
+
+    AudioStreamBasicDescription notPCM = MakeFormat(kFloat, 2, 32, 4);
+    notPCM.mFormatID = kAudioFormatAC3;
+
+    const std::vector<AudioStreamBasicDescription> unsupported = {
+        bigEndian,
+        notPCM,
+        MakeFormat(kFloat, 2, 64, 8),
+        MakeFormat(kInteger, 2, 8, 1),
+        MakeFormat(kAudioFormatFlagIsPacked, 2, 16, 2)
+    };
+
+    for(const AudioStreamBasicDescription& format : unsupported)
+    {
+        BGMOutputFormatConverter converter;
+        converter.Configure(2, { MakeFormat(kFloat, 2, 32, 4) }, { 1, 2 }, kFrames);
+
+        // Even if only one of the streams isn't supported.
+        XCTAssertThrows(converter.Configure(2,
+                                            { MakeFormat(kFloat, 2, 32, 4), format },
+                                            { 1, 2 },
+                                            kFrames));
+
+        // The converter is left unconfigured, so it just writes silence.
+        TestOutput output({ MakeFormat(kFloat, 2, 32, 4) }, kFrames);
+        std::vector<Float32> source = MakeStereoSource(kFrames);
+
+        XCTAssertFalse(converter.IsPassthrough());
+        XCTAssertEqual(converter.GetFrameCount(*output.Get()), 0u);
+        XCTAssertFalse(converter.ConvertRT(source.data(), kFrames, output.Get()));
+        XCTAssertTrue(output.IsSilent());
+    }
+}
+
+- (void) testMismatchedBuffersGetSilence {
+    BGMOutputFormatConverter converter;
+    converter.Configure(2, { MakeFormat(kFloat, 8, 32, 4) }, { 1, 2 }, kFrames);
+
+    std::vector<Float32> source = MakeStereoSource(kFrames * 2);
+
+    // The wrong number of channels.
+    TestOutput stereo({ MakeFormat(kFloat, 2, 32, 4) }, kFrames);
+    XCTAssertEqual(converter.GetFrameCount(*stereo.Get()), 0u);
+    XCTAssertFalse(converter.ConvertRT(source.data(), kFrames, stereo.Get()));
+    XCTAssertTrue(stereo.IsSilent());
+
+    // The wrong number of buffers.
+    TestOutput twoStreams({ MakeFormat(kFloat, 8, 32, 4), MakeFormat(kFloat, 8, 32, 4) }, kFrames);
+    XCTAssertEqual(converter.GetFrameCount(*twoStreams.Get()), 0u);
+    XCTAssertFalse(converter.ConvertRT(source.data(), kFrames, twoStreams.Get()));
+    XCTAssertTrue(twoStreams.IsSilent());
+
+    // More frames than Configure was told to expect.
+    TestOutput tooLong({ MakeFormat(kFloat, 8, 32, 4) }, kFrames * 2);
+    XCTAssertEqual(converter.GetFrameCount(*tooLong.Get()), kFrames * 2);
+    XCTAssertFalse(converter.ConvertRT(source.data(), kFrames * 2, tooLong.Get()));
+    XCTAssertTrue(tooLong.IsSilent());
+}
+
+- (void) testShortSourceIsPaddedWithSilence {
+    const std::vector<AudioStreamBasicDescription> formats = { MakeFormat(kInteger, 2, 32, 4) };
+
+    BGMOutputFormatConverter converter;
+    converter.Configure(2, formats, { 1, 2 }, kFrames);
+
+    TestOutput output(formats, kFrames);
+    std::vector<Float32> source = MakeStereoSource(kFrames);
+    XCTAssertTrue(converter.ConvertRT(source.data(), kFrames / 2, output.Get()));
+
+    XCTAssertNotEqual(output.Sample<SInt32>(0, kFrames / 2 - 1, 0), 0);
+
+    for(UInt32 frame = kFrames / 2; frame < kFrames; frame++)
+    {
+        XCTAssertEqual(output.Sample<SInt32>(0, frame, 0), 0);
+        XCTAssertEqual(output.Sample<SInt32>(0, frame, 1), 0);
+    }
+}
+
+@end
+
@@ -0,0 +1,203 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGMOutputPipelineTests.mm
+//  BGMAppUnitTests
+//
+//  Copyright © 2026 Kyle Neideck
+//
+
+// Unit Include
+#import "BGMOutputPipeline.h"
+
+// STL Includes
+#import <atomic>
+#import <chrono>
+#import <thread>
+#import <vector>
+
+// System Includes
+#import <XCTest/XCTest.h>
+
+
+static const UInt32 kChannelCount = 2;
+static const UInt32 kFramesPerBuffer = 256;
+static const Float64 kSampleRate = 48000.0;
+
+@interface BGMOutputPipelineTests : XCTestCase
+
+@end
+
+@implementation BGMOutputPipelineTests {
+    BGMOutputPipeline pipeline;
+    // Incremented each time the render function is called.
+    std::atomic<UInt32> renderCount;
+    // The render function sleeps for this long every tenth call, to simulate overloads.
+    std::atomic<UInt32> slowRenderMs;
+    std::atomic<bool> failRenders;
+}
+
+- (void) setUp {
+    [super setUp];
+    renderCount = 0;
+    slowRenderMs = 0;
+    failRenders = false;
+}
+
+- (void) tearDown {
+    pipeline.Stop();
+    [super tearDown];
+}
+
+// Starts the pipeline with a render function that fills each frame with its sample time, so the
+// tests can check which frames were played when.
+- (void) startWithLookahead:(UInt32)lookahead {
+    pipeline.Start([self](Float32* ioBuffer, UInt32 inFrameCount, SInt64 inSampleTime) {
+                       UInt32 count = ++renderCount;
+
+                       if(slowRenderMs > 0 && count % 10 == 0)
+                       {
+                           std::this_thread::sleep_for(std::chrono::milliseconds(slowRenderMs));
+                       }
+
+                       for(UInt32 frame = 0; frame < inFrameCount; frame++)
+                       {
+                           for(UInt32 channel = 0; channel < kChannelCount; channel++)
+                           {
+                               ioBuffer[frame * kChannelCount + channel] =
+                                       static_cast<Float32>(inSampleTime + frame);
+                           }
+                       }
+
+                       return !failRenders;
+                   },
+                   kChannelCount,
+                   kFramesPerBuffer,
+                   kSampleRate,
+                   lookahead);
+}
+
+// Calls ReadRT once per IO cycle, roughly in real time, the way OutputDeviceIOProc would. Checks
+// each frame is either silent or the frame from the pipeline's latency ago. Returns the number of
+// silent frames.
+- (UInt32) runCycles:(UInt32)cycles {
+    const UInt32 latency = pipeline.GetLatencyFrames();
+    const auto period = std::chrono::microseconds(
+            static_cast<long long>(kFramesPerBuffer / kSampleRate * 1e6));
+
+    std::vector<Float32> buffer(kFramesPerBuffer * kChannelCount);
+    SInt64 sampleTime = 100000;
+    UInt32 silentFrames = 0;
+
+    for(UInt32 cycle = 0; cycle < cycles; cycle++)
+    {
+        pipeline.ReadRT(buffer.data(), kFramesPerBuffer, sampleTime);
+
+        for(UInt32 frame = 0; frame < kFramesPerBuffer; frame++)
+        {
+            Float32 sample = buffer[frame * kChannelCount];
+
+            if(sample == 0.0f)
+            {
+                silentFrames++;
+            }
+            else
+            {
+                XCTAssertEqual(sample, static_cast<Float32>(sampleTime - latency + frame));
+                XCTAssertEqual(buffer[frame * kChannelCount + 1], sample);
+            }
+        }
+
+        sampleTime += kFramesPerBuffer;
+        std::this_thread::sleep_for(period);
+    }
+
+    return silentFrames;
+}
+
+- (void) testLatency {
+    XCTAssertFalse(pipeline.IsRunning());
+    XCTAssertEqual(pipeline.GetLatencyFrames(), 0u);
+
+    [self startWithLookahead:2];
+    XCTAssert(pipeline.IsRunning());
+    XCTAssertEqual(pipeline.GetLatencyFrames(), 2 * kFramesPerBuffer);
+    XCTAssertEqual(pipeline.GetChannelCount(), kChannelCount);
+
+    // At least one buffer of lookahead.
+    [self startWithLookahead:0];
+    XCTAssertEqual(pipeline.GetLatencyFrames(), kFramesPerBuffer);
+
+    pipeline.Stop();
+    XCTAssertFalse(pipeline.IsRunning());
+    XCTAssertEqual(pipeline.GetLatencyFrames(), 0u);
+}
+
+- (void) testOutputIsDelayedByLookahead {
+    [self startWithLookahead:2];
+
+    // Only the lookahead, which starts as silence, should be silent.
+    XCTAssertEqual([self runCycles:100], 2 * kFramesPerBuffer);
+
+    BGMOutputPipeline::Stats stats = pipeline.GetStats();
+    XCTAssertEqual(stats.mCycles, 100u);
+    XCTAssertEqual(stats.mUnderruns, 0u);
+    XCTAssertEqual(stats.mLateBuffers, 0u);
+    XCTAssertEqual(stats.mDroppedBuffers, 0u);
+    XCTAssertEqual(stats.mRenderFailures, 0u);
+    XCTAssertEqual(stats.mBudgetNs, static_cast<UInt64>(2 * kFramesPerBuffer / kSampleRate * 1e9));
+    XCTAssertLessThanOrEqual(stats.mMaxRenderNs, stats.mMaxTurnaroundNs);
+}
+
+- (void) testOverloadsAreCountedAndStayInSync {
+    // Longer than the whole lookahead.
+    slowRenderMs = 15;
+    [self startWithLookahead:1];
+
+    // runCycles checks the frames that aren't silent are still the right ones.
+    XCTAssertGreaterThan([self runCycles:60], kFramesPerBuffer);
+
+    BGMOutputPipeline::Stats stats = pipeline.GetStats();
+    XCTAssertGreaterThan(stats.mUnderruns, 0u);
+    XCTAssertGreaterThan(stats.mLateBuffers, 0u);
+    XCTAssertGreaterThan(stats.mMaxTurnaroundNs, stats.mBudgetNs);
+}
+
+- (void) testRenderFailuresAreSilent {
+    failRenders = true;
+    [self startWithLookahead:1];
+
+    XCTAssertEqual([self runCycles:20], 20 * kFramesPerBuffer);
+    XCTAssertGreaterThan(pipeline.GetStats().mRenderFailures, 0u);
+}
+
+- (void) testRestartResetsStats {
+    slowRenderMs = 15;
+    [self startWithLookahead:1];
+    [self runCycles:20];
+    XCTAssertGreaterThan(pipeline.GetStats().mCycles, 0u);
+
+    slowRenderMs = 0;
+    [self startWithLookahead:1];
+
+    BGMOutputPipeline::Stats stats = pipeline.GetStats();
+    XCTAssertEqual(stats.mCycles, 0u);
+    XCTAssertEqual(stats.mUnderruns, 0u);
+    XCTAssertEqual(stats.mMaxTurnaroundNs, 0u);
+}
+
+@end
+
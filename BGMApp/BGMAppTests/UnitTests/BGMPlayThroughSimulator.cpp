@@ -0,0 +1,562 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGMPlayThroughSimulator.cpp
+//  BGMAppUnitTests
+//
+//  Copyright © 2026 Kyle Neideck
+//
+
+// Self Include
+#include "BGMPlayThroughSimulator.h"
+
+// Local Includes
+#include "MockAudioObjects.h"
+
+// BGM Includes
+#include "BGM_Types.h"
+#include "BGM_Utils.h"
+#include "BGMAudioDevice.h"
+
+// STL Includes
+#include <algorithm>
+#include <chrono>
+#include <cstddef>  // For offsetof
+#include <sstream>
+#include <thread>
+
+
+#pragma clang assume_nonnull begin
+
+// The input frames are numbered by writing (frame number + 1) to each sample, so zero still means
+// silence. Float32 can only represent integers exactly up to 2^24, which is a bit over six minutes
+// of audio at 44.1 kHz.
+static const UInt64 kMaxInputFrames = 1 << 24;
+
+BGMPlayThroughSimulator::BGMPlayThroughSimulator(const Config& inConfig)
+:
+    mConfig(inConfig),
+    mRandom(inConfig.mSeed),
+    mHasRun(false),
+    mInputChannelCount(2),
+    mPlayThrough(nullptr),
+    mOutputLeftChannel(0),
+    mOutputRightChannel(0),
+    mOutputHasStarted(false),
+    mLastPlayedInputFrame(0),
+    mLastInToOutOffset(0),
+    mTotalLatencyMs(0.0)
+{
+    ThrowIf(mConfig.mIOBufferFrameSize == 0,
+            CAException(kAudioHardwareIllegalOperationError),
+            "BGMPlayThroughSimulator::BGMPlayThroughSimulator: IO buffer size must be non-zero");
+    // Leave some room for clock skew and the cycles run while stopping.
+    ThrowIf(mConfig.mInputChannelCountAfterChange == 0,
+            CAException(kAudioHardwareIllegalOperationError),
+            "BGMPlayThroughSimulator::BGMPlayThroughSimulator: Input must have channels");
+    ThrowIf((mConfig.mOutputCycleCount + 1000ULL) * mConfig.mIOBufferFrameSize * 2 > kMaxInputFrames,
+            CAException(kAudioHardwareIllegalOperationError),
+            "BGMPlayThroughSimulator::BGMPlayThroughSimulator: Simulation too long");
+
+    mInput.mMock = MockAudioObjects::CreateMockDevice(kBGMDeviceUID);
+    mOutput.mMock = MockAudioObjects::CreateMockDevice("Mock Output Device");
+
+    mInput.mNsPerFrame =
+            NSEC_PER_SEC / (mConfig.mSampleRate * (1.0 + mConfig.mInputClockSkewPPM / 1e6));
+    mOutput.mNsPerFrame =
+            NSEC_PER_SEC / (mConfig.mSampleRate * (1.0 + mConfig.mOutputClockSkewPPM / 1e6));
+
+    mInput.mTimestampResetCycles = mConfig.mInputTimestampResetCycles;
+    mOutput.mTimestampResetCycles = mConfig.mOutputTimestampResetCycles;
+
+    if(!mConfig.mOutputStreamFormats.empty())
+    {
+        mOutput.mMock->mStreamFormats = mConfig.mOutputStreamFormats;
+    }
+
+    mOutput.mMock->mPreferredStereoLeft = mConfig.mOutputPreferredStereoLeft;
+    mOutput.mMock->mPreferredStereoRight = mConfig.mOutputPreferredStereoRight;
+
+    for(SimulatedDevice* device : { &mInput, &mOutput })
+    {
+        device->mMock->mNominalSampleRate = mConfig.mSampleRate;
+        device->mMock->mIOBufferSize = mConfig.mIOBufferFrameSize;
+
+        for(AudioStreamBasicDescription& format : device->mMock->mStreamFormats)
+        {
+            format.mSampleRate = mConfig.mSampleRate;
+        }
+    }
+
+    // The mock BGMDevice's virtual format is interleaved stereo until mInputFormatChangeCycle.
+    mInput.mBuffer.resize(mConfig.mIOBufferFrameSize * mInputChannelCount);
+
+    ConfigureOutputBuffers();
+}
+
+BGMPlayThroughSimulator::~BGMPlayThroughSimulator()
+{
+    MockAudioObjects::DestroyMocks();
+}
+
+BGMPlayThroughSimulator::Report BGMPlayThroughSimulator::Run()
+{
+    ThrowIf(mHasRun,
+            CAException(kAudioHardwareIllegalOperationError),
+            "BGMPlayThroughSimulator::Run: Already run");
+    mHasRun = true;
+
+    BGMPlayThrough playThrough(BGMAudioDevice(mInput.mMock->GetObjectID()),
+                               BGMAudioDevice(mOutput.mMock->GetObjectID()));
+    playThrough.SetLatencyPreset(mConfig.mLatencyPreset);
+    playThrough.SetTargetLatencyMs(mConfig.mTargetLatencyMs);
+    playThrough.Start();
+
+    mPlayThrough = &playThrough;
+
+    const UInt32 frames = mConfig.mIOBufferFrameSize;
+
+    // The input device's first IO cycle ends once it has captured a buffer. The output device's
+    // first cycle starts straight away.
+    ScheduleNextCall(mInput, frames * mInput.mNsPerFrame);
+    ScheduleNextCall(mOutput, 0.0);
+
+    while(mReport.mOutputCycles < mConfig.mOutputCycleCount)
+    {
+        RunNextCycle(true);
+    }
+
+    mReport.mReanchors = playThrough.GetReanchorCount();
+    mReport.mTargetLatencyFrames = playThrough.GetTargetLatencyFrames();
+    mReport.mMeasuredLatencyFrames = playThrough.GetMeasuredLatencyFrames();
+
+    StopPlayThrough(playThrough);
+
+    mPlayThrough = nullptr;
+
+    const UInt64 playedFrames =
+            mReport.mOutputFrames - mReport.mFramesBeforeFirstInput - mReport.mSilentFrames;
+
+    if(playedFrames > 0)
+    {
+        mReport.mMeanLatencyMs = mTotalLatencyMs / playedFrames;
+    }
+
+    return mReport;
+}
+
+void    BGMPlayThroughSimulator::ScheduleNextCall(SimulatedDevice& ioDevice, Float64 inDeadlineNs)
+{
+    Float64 jitterNs = 0.0;
+
+    if(mConfig.mSchedulingJitterNs > 0)
+    {
+        std::uniform_real_distribution<Float64> jitter(0.0, mConfig.mSchedulingJitterNs);
+        jitterNs = jitter(mRandom);
+    }
+
+    // A late call can't delay the device's later calls, but they can't overtake it either.
+    ioDevice.mNextCallTimeNs = std::max(inDeadlineNs + jitterNs, ioDevice.mNextCallTimeNs);
+}
+
+void    BGMPlayThroughSimulator::RunNextCycle(bool inRecordOutput)
+{
+    if(mInput.mNextCallTimeNs <= mOutput.mNextCallTimeNs)
+    {
+        RunInputCycle();
+    }
+    else
+    {
+        RunOutputCycle(inRecordOutput);
+    }
+}
+
+void    BGMPlayThroughSimulator::RunInputCycle()
+{
+    const UInt32 frames = mConfig.mIOBufferFrameSize;
+    const UInt64 cycle = mInput.mNextCycle++;
+    const UInt64 firstFrame = cycle * frames;
+
+    UpdateSampleTimeBase(mInput, cycle, firstFrame);
+
+    const bool formatChanged =
+            (mConfig.mInputFormatChangeCycle != 0) && (cycle == mConfig.mInputFormatChangeCycle);
+
+    if(formatChanged)
+    {
+        mInputChannelCount = mConfig.mInputChannelCountAfterChange;
+        mInput.mBuffer.resize(frames * mInputChannelCount);
+        mInput.mMock->mStreamFormats = {
+            MockAudioDevice::MakeFloat32StreamFormat(mInputChannelCount)
+        };
+        mInput.mMock->mStreamFormats[0].mSampleRate = mConfig.mSampleRate;
+    }
+
+    MockAudioDevice& mock = *mInput.mMock;
+
+    if(mock.mIOProcIsRunning && mock.mIOProc)
+    {
+        const bool silent = (cycle >= mConfig.mSilentInputStartCycle) &&
+                (cycle - mConfig.mSilentInputStartCycle < mConfig.mSilentInputCycleCount);
+        const UInt32 channels = mInputChannelCount;
+
+        for(UInt32 i = 0; i < frames; i++)
+        {
+            Float32 sample = silent ? 0.0f : static_cast<Float32>(firstFrame + i + 1);
+            std::fill_n(&mInput.mBuffer[i * channels], channels, sample);
+        }
+
+        AudioBufferList inputData;
+        inputData.mNumberBuffers = 1;
+        inputData.mBuffers[0].mNumberChannels = channels;
+        inputData.mBuffers[0].mDataByteSize = frames * SizeOf32(Float32) * channels;
+        inputData.mBuffers[0].mData = mInput.mBuffer.data();
+
+        AudioBufferList outputData;
+        outputData.mNumberBuffers = 0;
+
+        const Float64 sampleTime = static_cast<Float64>(firstFrame - mInput.mSampleTimeBase);
+
+        // The input device captured these frames during the IO buffer that just ended.
+        AudioTimeStamp now = MakeTimeStamp(sampleTime + frames, mInput.mNextCallTimeNs);
+        AudioTimeStamp inputTime = MakeTimeStamp(sampleTime, firstFrame * mInput.mNsPerFrame);
+        AudioTimeStamp outputTime = {};
+
+        mock.mIOProc(mock.GetObjectID(),
+                     &now,
+                     &inputData,
+                     &inputTime,
+                     &outputData,
+                     &outputTime,
+                     mock.mIOProcClientData);
+    }
+
+    if(formatChanged)
+    {
+        NotifyInputFormatChanged();
+    }
+
+    ScheduleNextCall(mInput, (cycle + 2) * frames * mInput.mNsPerFrame);
+}
+
+void    BGMPlayThroughSimulator::NotifyInputFormatChanged()
+{
+    if(!mConfig.mNotifyInputFormatChange || !mPlayThrough)
+    {
+        return;
+    }
+
+    const UInt64 allocationCount = mPlayThrough->GetBufferAllocationCount();
+
+    mInput.mMock->NotifyPropertyListeners(kAudioDevicePropertyStreamConfiguration);
+
+    // BGMPlayThrough reallocates its ring buffer on another thread. Wait for it, so the simulation
+    // stays deterministic. Give up after a while, in case it never does, and let the test fail.
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+
+    while((mPlayThrough->GetBufferAllocationCount() == allocationCount) &&
+          (std::chrono::steady_clock::now() < deadline))
+    {
+        std::this_thread::yield();
+    }
+}
+
+void    BGMPlayThroughSimulator::RunOutputCycle(bool inRecordOutput)
+{
+    const UInt32 frames = mConfig.mIOBufferFrameSize;
+    const UInt64 cycle = mOutput.mNextCycle++;
+    const UInt64 firstFrame = cycle * frames;
+
+    UpdateSampleTimeBase(mOutput, cycle, firstFrame);
+
+    MockAudioDevice& mock = *mOutput.mMock;
+
+    // If the IOProc isn't running, the device plays silence.
+    std::fill(mOutput.mBuffer.begin(), mOutput.mBuffer.end(), 0.0f);
+
+    if(mock.mIOProcIsRunning && mock.mIOProc)
+    {
+        AudioBufferList inputData;
+        inputData.mNumberBuffers = 0;
+
+        const Float64 sampleTime = static_cast<Float64>(firstFrame - mOutput.mSampleTimeBase);
+
+        // The device will start playing these frames after it finishes playing the previous IO
+        // buffer.
+        AudioTimeStamp now = MakeTimeStamp(sampleTime - frames, mOutput.mNextCallTimeNs);
+        AudioTimeStamp inputTime = {};
+        AudioTimeStamp outputTime =
+                MakeTimeStamp(sampleTime, (firstFrame + frames) * mOutput.mNsPerFrame);
+
+        mock.mIOProc(mock.GetObjectID(),
+                     &now,
+                     &inputData,
+                     &inputTime,
+                     MakeOutputBufferList(),
+                     &outputTime,
+                     mock.mIOProcClientData);
+    }
+
+    if(inRecordOutput)
+    {
+        RecordOutput(firstFrame);
+        mReport.mOutputCycles++;
+    }
+
+    ScheduleNextCall(mOutput, (cycle + 1) * frames * mOutput.mNsPerFrame);
+}
+
+void    BGMPlayThroughSimulator::RecordOutput(UInt64 inFirstFrame)
+{
+    const UInt32 frames = mConfig.mIOBufferFrameSize;
+
+    for(UInt32 i = 0; i < frames; i++)
+    {
+        mReport.mOutputFrames++;
+
+        // Decode the frame number from the left channel. The right should always be the same and
+        // the other channels should be silent.
+        const Float32 sample = GetOutputSample(mOutputLeftChannel, i);
+
+        if(GetOutputSample(mOutputRightChannel, i) != sample)
+        {
+            mReport.mMisroutedSamples++;
+        }
+
+        for(UInt32 channel = 0; channel < mOutputChannels.size(); channel++)
+        {
+            if((channel != mOutputLeftChannel) &&
+               (channel != mOutputRightChannel) &&
+               (GetOutputSample(channel, i) != 0.0f))
+            {
+                mReport.mMisroutedSamples++;
+            }
+        }
+
+        if(sample == 0.0f)
+        {
+            if(mOutputHasStarted)
+            {
+                mReport.mSilentFrames++;
+            }
+            else
+            {
+                mReport.mFramesBeforeFirstInput++;
+            }
+
+            continue;
+        }
+
+        const UInt64 outputFrame = inFirstFrame + i;
+        const UInt64 inputFrame = static_cast<UInt64>(sample) - 1;
+        const SInt64 inToOutOffset =
+                static_cast<SInt64>(outputFrame) - static_cast<SInt64>(inputFrame);
+
+        if(mOutputHasStarted)
+        {
+            UInt64 skippedFrames = 0;
+
+            if(inputFrame > mLastPlayedInputFrame + 1)
+            {
+                skippedFrames = inputFrame - mLastPlayedInputFrame - 1;
+                mReport.mDroppedFrames += skippedFrames;
+            }
+            else if(inputFrame <= mLastPlayedInputFrame)
+            {
+                skippedFrames = mLastPlayedInputFrame - inputFrame + 1;
+                mReport.mRepeatedFrames += skippedFrames;
+            }
+
+            mReport.mLargestSkipFrames = std::max(mReport.mLargestSkipFrames, skippedFrames);
+
+            if(inToOutOffset != mLastInToOutOffset)
+            {
+                mReport.mLatencyChanges++;
+            }
+        }
+
+        // The output device plays each frame one IO buffer after its IOProc asks for it.
+        const Float64 playedTimeNs = (outputFrame + frames) * mOutput.mNsPerFrame;
+        const Float64 capturedTimeNs = inputFrame * mInput.mNsPerFrame;
+        const Float64 latencyMs = (playedTimeNs - capturedTimeNs) / NSEC_PER_MSEC;
+
+        if(!mOutputHasStarted)
+        {
+            mReport.mMinLatencyMs = latencyMs;
+            mReport.mMaxLatencyMs = latencyMs;
+        }
+
+        mReport.mMinLatencyMs = std::min(mReport.mMinLatencyMs, latencyMs);
+        mReport.mMaxLatencyMs = std::max(mReport.mMaxLatencyMs, latencyMs);
+        mReport.mFinalLatencyMs = latencyMs;
+        mTotalLatencyMs += latencyMs;
+
+        mOutputHasStarted = true;
+        mLastPlayedInputFrame = inputFrame;
+        mLastInToOutOffset = inToOutOffset;
+    }
+}
+
+void    BGMPlayThroughSimulator::StopPlayThrough(BGMPlayThrough& ioPlayThrough)
+{
+    // BGMPlayThrough::Stop waits for the IOProcs to stop themselves, so it has to be called on
+    // another thread while this one keeps running IO cycles.
+    std::thread stopThread([&ioPlayThrough] {
+        try
+        {
+            ioPlayThrough.Stop();
+        }
+        catch(...)
+        {
+            LogError("BGMPlayThroughSimulator::StopPlayThrough: Stop threw an exception");
+        }
+    });
+
+    while(mInput.mMock->mIOProcIsRunning || mOutput.mMock->mIOProcIsRunning)
+    {
+        RunNextCycle(false);
+        // Let the other thread get the state mutex.
+        std::this_thread::yield();
+    }
+
+    stopThread.join();
+}
+
+// static
+void    BGMPlayThroughSimulator::UpdateSampleTimeBase(SimulatedDevice& ioDevice,
+                                                      UInt64 inCycle,
+                                                      UInt64 inFirstFrame)
+{
+    const std::vector<UInt64>& resets = ioDevice.mTimestampResetCycles;
+
+    if(std::find(resets.begin(), resets.end(), inCycle) != resets.end())
+    {
+        ioDevice.mSampleTimeBase = inFirstFrame;
+    }
+}
+
+// static
+AudioTimeStamp  BGMPlayThroughSimulator::MakeTimeStamp(Float64 inSampleTime, Float64 inHostTimeNs)
+{
+    // The mock HAL's host clock ticks in nanoseconds. BGMPlayThrough only uses the sample times.
+    AudioTimeStamp timeStamp = {};
+    timeStamp.mSampleTime = inSampleTime;
+    timeStamp.mHostTime = static_cast<UInt64>(inHostTimeNs);
+    timeStamp.mRateScalar = 1.0;
+    timeStamp.mFlags = kAudioTimeStampSampleHostTimeValid | kAudioTimeStampRateScalarValid;
+    return timeStamp;
+}
+
+#pragma mark Output Buffers
+
+void    BGMPlayThroughSimulator::ConfigureOutputBuffers()
+{
+    const UInt32 frames = mConfig.mIOBufferFrameSize;
+    UInt32 sampleCount = 0;
+
+    for(const AudioStreamBasicDescription& format : mOutput.mMock->mStreamFormats)
+    {
+        ThrowIf((format.mFormatFlags & kAudioFormatFlagIsFloat) == 0 ||
+                    format.mBitsPerChannel != 32,
+                CAException(kAudioDeviceUnsupportedFormatError),
+                "BGMPlayThroughSimulator::ConfigureOutputBuffers: Output must be Float32");
+
+        const bool isNonInterleaved = (format.mFormatFlags & kAudioFormatFlagIsNonInterleaved) != 0;
+        const UInt32 bufferCount = isNonInterleaved ? format.mChannelsPerFrame : 1;
+        const UInt32 channelsPerBuffer = isNonInterleaved ? 1 : format.mChannelsPerFrame;
+
+        for(UInt32 i = 0; i < bufferCount; i++)
+        {
+            mOutputBuffers.push_back({ sampleCount, channelsPerBuffer });
+
+            for(UInt32 channel = 0; channel < channelsPerBuffer; channel++)
+            {
+                mOutputChannels.push_back({ sampleCount + channel, channelsPerBuffer });
+            }
+
+            sampleCount += frames * channelsPerBuffer;
+        }
+    }
+
+    ThrowIf(mOutputChannels.empty(),
+            CAException(kAudioDeviceUnsupportedFormatError),
+            "BGMPlayThroughSimulator::ConfigureOutputBuffers: Output device has no channels");
+
+    mOutput.mBuffer.resize(sampleCount);
+    mOutputBufferList.resize(offsetof(AudioBufferList, mBuffers) +
+                             sizeof(AudioBuffer) * mOutputBuffers.size());
+
+    // Stereo is played on both channels of a mono device.
+    const UInt32 channelCount = static_cast<UInt32>(mOutputChannels.size());
+    mOutputLeftChannel = (channelCount == 1) ? 0 : mConfig.mOutputPreferredStereoLeft - 1;
+    mOutputRightChannel = (channelCount == 1) ? 0 : mConfig.mOutputPreferredStereoRight - 1;
+
+    ThrowIf(mOutputLeftChannel >= channelCount || mOutputRightChannel >= channelCount,
+            CAException(kAudioHardwareIllegalOperationError),
+            "BGMPlayThroughSimulator::ConfigureOutputBuffers: Invalid preferred stereo channels");
+}
+
+AudioBufferList*    BGMPlayThroughSimulator::MakeOutputBufferList()
+{
+    AudioBufferList* bufferList = reinterpret_cast<AudioBufferList*>(mOutputBufferList.data());
+    bufferList->mNumberBuffers = static_cast<UInt32>(mOutputBuffers.size());
+
+    for(UInt32 i = 0; i < mOutputBuffers.size(); i++)
+    {
+        const UInt32 channels = mOutputBuffers[i].second;
+
+        bufferList->mBuffers[i].mNumberChannels = channels;
+        bufferList->mBuffers[i].mDataByteSize =
+                mConfig.mIOBufferFrameSize * channels * SizeOf32(Float32);
+        bufferList->mBuffers[i].mData = &mOutput.mBuffer[mOutputBuffers[i].first];
+    }
+
+    return bufferList;
+}
+
+Float32 BGMPlayThroughSimulator::GetOutputSample(UInt32 inChannel, UInt32 inFrame) const
+{
+    const OutputChannel& channel = mOutputChannels[inChannel];
+    return mOutput.mBuffer[channel.mFirstSample + inFrame * channel.mStride];
+}
+
+#pragma mark Report
+
+std::string BGMPlayThroughSimulator::Report::ToString() const
+{
+    std::ostringstream theString;
+
+    theString << "Output cycles: " << mOutputCycles
+              << ", frames before first input: " << mFramesBeforeFirstInput
+              << ", silent frames: " << mSilentFrames
+              << ", dropped frames: " << mDroppedFrames
+              << ", repeated frames: " << mRepeatedFrames
+              << ", largest skip: " << mLargestSkipFrames
+              << ", re-anchors: " << mReanchors
+              << ", latency changes: " << mLatencyChanges
+              << ", latency (ms): min " << mMinLatencyMs
+              << ", mean " << mMeanLatencyMs
+              << ", max " << mMaxLatencyMs
+              << ", final " << mFinalLatencyMs
+              << ", latency (frames): target " << mTargetLatencyFrames
+              << ", measured " << mMeasuredLatencyFrames
+              << ", misrouted samples: " << mMisroutedSamples;
+
+    return theString.str();
+}
+
+#pragma clang assume_nonnull end
+
@@ -0,0 +1,258 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGMPlayThroughSimulator.h
+//  BGMAppUnitTests
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  Runs BGMPlayThrough against the mock HAL with a virtual clock, so we can see how its ring
+//  buffer and read head behave with different IO buffer sizes, drifting device clocks, devices
+//  restarting their sample times, etc. without real hardware and much faster than real time.
+//
+//  The simulator creates a mock BGMDevice (the input device) and a mock output device, starts
+//  playthrough between them and then calls the IOProcs BGMPlayThrough registered with the mock
+//  devices, in the order the deadlines of their IO cycles come up on the virtual clock:
+//
+//    - The input device's IOProc is called once it has captured a full IO buffer. The buffer's
+//      frames are numbered consecutively from the start of the simulation, so every frame of
+//      input is unique.
+//    - The output device's IOProc is called one IO buffer before the device will start playing
+//      the frames it asks for.
+//
+//  Each device's sample rate can be skewed from the nominal rate, its sample time can be
+//  restarted from zero at given IO cycles (like when you unplug headphones) and each call can be
+//  delayed by a random amount (scheduling jitter). Everything is seeded, so a configuration always
+//  produces the same calls and the same report.
+//
+//  Apart from the re-anchor count and the latencies BGMPlayThrough reports about itself, the report
+//  is built only from what BGMPlayThrough writes to the output device, by decoding the input frame
+//  numbers from the output.
+//
+//  The output device can have any number of Float32 streams, interleaved or not. The frame numbers
+//  are decoded from its preferred channels for stereo, and any audio on its other channels is
+//  reported as misrouted.
+//
+
+#ifndef BGMAppUnitTests__BGMPlayThroughSimulator
+#define BGMAppUnitTests__BGMPlayThroughSimulator
+
+// Local Includes
+#include "MockAudioDevice.h"
+
+// BGM Includes
+#include "BGMPlayThrough.h"
+
+// STL Includes
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+// System Includes
+#include <CoreAudio/CoreAudio.h>
+
+
+#pragma clang assume_nonnull begin
+
+class BGMPlayThroughSimulator
+{
+
+public:
+    struct Config
+    {
+        Float64                 mSampleRate = 44100.0;
+        // The IO buffer size of both devices. (BGMPlayThrough sets the input device's to match
+        // the output device's anyway.)
+        UInt32                  mIOBufferFrameSize = 512;
+        // How long to run playthrough for, in the output device's IO cycles.
+        UInt32                  mOutputCycleCount = 2000;
+        // How much faster each device's clock runs than the nominal sample rate, in parts per
+        // million. Can be negative.
+        Float64                 mInputClockSkewPPM = 0.0;
+        Float64                 mOutputClockSkewPPM = 0.0;
+        // The maximum amount each IOProc call can be late by. (Calls to the same device's IOProc
+        // are still made in order.)
+        UInt64                  mSchedulingJitterNs = 0;
+        // The IO cycles, counted from zero for each device, at which the device restarts its
+        // sample times from zero. For example, the output device's sample times restart when you
+        // plug in or unplug headphones.
+        std::vector<UInt64>     mInputTimestampResetCycles;
+        std::vector<UInt64>     mOutputTimestampResetCycles;
+        // The input device captures silence, like BGMDevice while nothing is playing, for this
+        // many IO cycles from mSilentInputStartCycle (counted from zero).
+        UInt64                  mSilentInputStartCycle = 0;
+        UInt64                  mSilentInputCycleCount = 0;
+        // From this input IO cycle (counted from zero), BGMDevice's stream has
+        // mInputChannelCountAfterChange channels instead of two, e.g. because the user set it to
+        // 5.1. 0 means it never changes. The input IOProc is called with the new format first,
+        // then, if mNotifyInputFormatChange is true, the simulator sends the notifications the HAL
+        // would and waits for BGMPlayThrough to handle them before it runs the next IO cycle.
+        UInt64                  mInputFormatChangeCycle = 0;
+        UInt32                  mInputChannelCountAfterChange = 2;
+        bool                    mNotifyInputFormatChange = true;
+        // See BGMPlayThrough::SetLatencyPreset and BGMPlayThrough::SetTargetLatencyMs. The target
+        // overrides the preset if it isn't 0.
+        BGMPlayThrough::LatencyPreset mLatencyPreset = BGMPlayThrough::LatencyPreset::Safe;
+        Float64                 mTargetLatencyMs = 0.0;
+        // The virtual formats of the output device's streams. Empty means the mock device's
+        // default, one interleaved stereo stream. They must be Float32, since the simulator
+        // decodes the frame numbers from the samples.
+        std::vector<AudioStreamBasicDescription> mOutputStreamFormats;
+        // The output device's kAudioDevicePropertyPreferredChannelsForStereo. Ignored if the
+        // device only has one channel.
+        UInt32                  mOutputPreferredStereoLeft = 1;
+        UInt32                  mOutputPreferredStereoRight = 2;
+        UInt32                  mSeed = 1;
+    };
+
+    struct Report
+    {
+        UInt64                  mOutputCycles = 0;
+        UInt64                  mOutputFrames = 0;
+        // The frames of silence BGMPlayThrough wrote before the first frame of input.
+        UInt64                  mFramesBeforeFirstInput = 0;
+        // The frames of silence after the first frame of input, e.g. because a fetch from the ring
+        // buffer failed.
+        UInt64                  mSilentFrames = 0;
+        // Input frames BGMPlayThrough never played (including those replaced by silence) and input
+        // frames it played more than once.
+        UInt64                  mDroppedFrames = 0;
+        UInt64                  mRepeatedFrames = 0;
+        // The most input frames dropped or repeated at once, i.e. the biggest discontinuity in the
+        // output.
+        UInt64                  mLargestSkipFrames = 0;
+        // The number of times BGMPlayThrough recalculated the position of its read head. See
+        // BGMPlayThrough::GetReanchorCount.
+        UInt64                  mReanchors = 0;
+        // The number of times the distance between the input and output, i.e. the latency, jumped.
+        // A re-anchor doesn't always cause one.
+        UInt64                  mLatencyChanges = 0;
+        // The time from when the input device captured a frame to when the output device played
+        // it.
+        Float64                 mMinLatencyMs = 0.0;
+        Float64                 mMaxLatencyMs = 0.0;
+        Float64                 mMeanLatencyMs = 0.0;
+        Float64                 mFinalLatencyMs = 0.0;
+        // What BGMPlayThrough reported at the end of the simulation. See
+        // BGMPlayThrough::GetTargetLatencyFrames and BGMPlayThrough::GetMeasuredLatencyFrames.
+        UInt32                  mTargetLatencyFrames = 0;
+        UInt32                  mMeasuredLatencyFrames = 0;
+        // Non-silent samples on the output device's channels other than its preferred stereo
+        // channels, plus frames where the right channel didn't match the left.
+        UInt64                  mMisroutedSamples = 0;
+
+        // For logging.
+        std::string             ToString() const;
+    };
+
+public:
+                                BGMPlayThroughSimulator(const Config& inConfig);
+                                // Destroys the mock devices.
+                                ~BGMPlayThroughSimulator();
+                                BGMPlayThroughSimulator(const BGMPlayThroughSimulator&) = delete;
+                                BGMPlayThroughSimulator& operator=(const BGMPlayThroughSimulator&) = delete;
+
+    /*!
+     * Start playthrough, run it for the configured number of output IO cycles and then stop it.
+     * Can only be called once.
+     */
+    Report                      Run();
+
+private:
+    struct SimulatedDevice
+    {
+        std::shared_ptr<MockAudioDevice> mMock;
+        // The length of one frame according to the device's (possibly skewed) clock.
+        Float64                 mNsPerFrame = 0.0;
+        UInt64                  mNextCycle = 0;
+        // The host time of the device's next IOProc call, including jitter.
+        Float64                 mNextCallTimeNs = 0.0;
+        // The frame (counted from the start of the simulation) the device's sample times are
+        // currently relative to.
+        UInt64                  mSampleTimeBase = 0;
+        std::vector<UInt64>     mTimestampResetCycles;
+        std::vector<Float32>    mBuffer;
+    };
+
+    // Where one of the output device's channels is in mOutput.mBuffer.
+    struct OutputChannel
+    {
+        // The index of the channel's sample for the first frame.
+        UInt32                  mFirstSample;
+        UInt32                  mStride;
+    };
+
+    void                        ScheduleNextCall(SimulatedDevice& ioDevice, Float64 inDeadlineNs);
+    // Runs whichever device's next IO cycle comes first. Each device's IOProc is only called if
+    // it's running.
+    void                        RunNextCycle(bool inRecordOutput);
+    void                        RunInputCycle();
+    // Sends the notification the HAL would after the mock BGMDevice's format changes, if configured
+    // to, and waits for BGMPlayThrough to handle it.
+    void                        NotifyInputFormatChanged();
+    void                        RunOutputCycle(bool inRecordOutput);
+    void                        RecordOutput(UInt64 inFirstFrame);
+    // Stops playthrough the way the HAL would see it happen, i.e. keeps calling the IOProcs until
+    // they stop themselves.
+    void                        StopPlayThrough(BGMPlayThrough& ioPlayThrough);
+    static void                 UpdateSampleTimeBase(SimulatedDevice& ioDevice,
+                                                     UInt64 inCycle,
+                                                     UInt64 inFirstFrame);
+    static AudioTimeStamp       MakeTimeStamp(Float64 inSampleTime, Float64 inHostTimeNs);
+
+    // Lays out the output device's buffers in mOutput.mBuffer according to its stream formats.
+    void                        ConfigureOutputBuffers();
+    // Fills mOutputBufferList with the output device's buffers and returns it.
+    AudioBufferList*            MakeOutputBufferList();
+    Float32                     GetOutputSample(UInt32 inChannel, UInt32 inFrame) const;
+
+private:
+    Config                      mConfig;
+    std::mt19937                mRandom;
+    bool                        mHasRun;
+
+    SimulatedDevice             mInput;
+    SimulatedDevice             mOutput;
+    // The number of channels in the mock BGMDevice's stream. The frame number is written to all
+    // of them.
+    UInt32                      mInputChannelCount;
+    // Only set while Run is running.
+    BGMPlayThrough* __nullable  mPlayThrough;
+
+    // For each of the output device's AudioBuffers, its first sample in mOutput.mBuffer and its
+    // number of channels.
+    std::vector<std::pair<UInt32, UInt32>> mOutputBuffers;
+    std::vector<OutputChannel>  mOutputChannels;
+    // Indices into mOutputChannels.
+    UInt32                      mOutputLeftChannel;
+    UInt32                      mOutputRightChannel;
+    // Storage for the output device's AudioBufferList, which can have more than one buffer.
+    std::vector<Byte>           mOutputBufferList;
+
+    Report                      mReport;
+    // The state of the output decoder. See RecordOutput.
+    bool                        mOutputHasStarted;
+    UInt64                      mLastPlayedInputFrame;
+    SInt64                      mLastInToOutOffset;
+    Float64                     mTotalLatencyMs;
+
+};
+
+#pragma clang assume_nonnull end
+
+#endif /* BGMAppUnitTests__BGMPlayThroughSimulator */
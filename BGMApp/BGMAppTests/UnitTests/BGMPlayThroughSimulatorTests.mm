@@ -0,0 +1,405 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGMPlayThroughSimulatorTests.mm
+//  BGMAppUnitTests
+//
+//  Copyright © 2026 Kyle Neideck
+//
+
+// Unit Include
+#import "BGMPlayThroughSimulator.h"
+
+// STL Includes
+#import <vector>
+
+// System Includes
+#import <XCTest/XCTest.h>
+
+
+@interface BGMPlayThroughSimulatorTests : XCTestCase
+
+@end
+
+@implementation BGMPlayThroughSimulatorTests
+
+- (BGMPlayThroughSimulator::Report) run:(const BGMPlayThroughSimulator::Config&)config {
+    BGMPlayThroughSimulator::Report report = BGMPlayThroughSimulator(config).Run();
+    NSLog(@"BGMPlayThroughSimulatorTests: %s", report.ToString().c_str());
+
+    XCTAssertEqual(report.mOutputCycles, config.mOutputCycleCount);
+    XCTAssertEqual(report.mOutputFrames,
+                   static_cast<UInt64>(config.mOutputCycleCount) * config.mIOBufferFrameSize);
+    // Stereo should only ever be played on the output device's preferred channels for it.
+    XCTAssertEqual(report.mMisroutedSamples, 0u);
+
+    return report;
+}
+
+// Runs playthrough to an output device with the given streams and checks it plays every frame
+// exactly as it would to a stereo device.
+- (void) runWithOutputStreams:(const std::vector<AudioStreamBasicDescription>&)streams
+                   stereoLeft:(UInt32)left
+                  stereoRight:(UInt32)right {
+    BGMPlayThroughSimulator::Config config;
+    config.mOutputCycleCount = 500;
+    config.mOutputStreamFormats = streams;
+    config.mOutputPreferredStereoLeft = left;
+    config.mOutputPreferredStereoRight = right;
+
+    BGMPlayThroughSimulator::Report report = [self run:config];
+
+    XCTAssertEqual(report.mDroppedFrames, 0u);
+    XCTAssertEqual(report.mRepeatedFrames, 0u);
+    XCTAssertEqual(report.mSilentFrames, 0u);
+    XCTAssertEqual(report.mReanchors, 0u);
+    XCTAssertEqual(report.mMeasuredLatencyFrames, 4 * 512u);
+}
+
+- (void) testSteadyState {
+    BGMPlayThroughSimulator::Config config;
+    BGMPlayThroughSimulator::Report report = [self run:config];
+
+    // With perfect clocks, BGMPlayThrough should never have to move its read head.
+    XCTAssertEqual(report.mDroppedFrames, 0u);
+    XCTAssertEqual(report.mRepeatedFrames, 0u);
+    XCTAssertEqual(report.mSilentFrames, 0u);
+    XCTAssertEqual(report.mReanchors, 0u);
+    XCTAssertEqual(report.mLatencyChanges, 0u);
+
+    // The safe preset keeps three IO buffers in the ring buffer and the output device plays each
+    // buffer one IO cycle after its IOProc is called.
+    const Float64 fourBuffersMs = 4 * 512 / 44.1;
+    XCTAssertEqualWithAccuracy(report.mMinLatencyMs, fourBuffersMs, 0.01);
+    XCTAssertEqualWithAccuracy(report.mMaxLatencyMs, fourBuffersMs, 0.01);
+
+    // BGMPlayThrough should measure the same latency the simulator does.
+    XCTAssertEqual(report.mTargetLatencyFrames, 4 * 512u);
+    XCTAssertEqual(report.mMeasuredLatencyFrames, 4 * 512u);
+}
+
+- (void) testSteadyStateLowLatency {
+    BGMPlayThroughSimulator::Config config;
+    config.mLatencyPreset = BGMPlayThrough::LatencyPreset::LowLatency;
+
+    BGMPlayThroughSimulator::Report report = [self run:config];
+
+    XCTAssertEqual(report.mDroppedFrames, 0u);
+    XCTAssertEqual(report.mRepeatedFrames, 0u);
+    XCTAssertEqual(report.mSilentFrames, 0u);
+    XCTAssertEqual(report.mReanchors, 0u);
+
+    // The output IOProc is called a buffer ahead and reads the buffer the input IOProc just wrote.
+    const Float64 twoBuffersMs = 2 * 512 / 44.1;
+    XCTAssertEqualWithAccuracy(report.mMinLatencyMs, twoBuffersMs, 0.01);
+    XCTAssertEqualWithAccuracy(report.mMaxLatencyMs, twoBuffersMs, 0.01);
+    XCTAssertEqual(report.mMeasuredLatencyFrames, 2 * 512u);
+}
+
+- (void) testTargetLatency {
+    BGMPlayThroughSimulator::Config config;
+    // Not a whole number of IO buffers.
+    config.mTargetLatencyMs = 30.0;
+
+    BGMPlayThroughSimulator::Report report = [self run:config];
+
+    XCTAssertEqual(report.mDroppedFrames, 0u);
+    XCTAssertEqual(report.mRepeatedFrames, 0u);
+    XCTAssertEqual(report.mReanchors, 0u);
+
+    // 30 ms is 1323 frames.
+    XCTAssertEqual(report.mTargetLatencyFrames, 1323u);
+    XCTAssertEqual(report.mMeasuredLatencyFrames, 1323u);
+    XCTAssertEqualWithAccuracy(report.mMinLatencyMs, 30.0, 0.01);
+    XCTAssertEqualWithAccuracy(report.mMaxLatencyMs, 30.0, 0.01);
+}
+
+- (void) testTargetLatencyTooLow {
+    // The latency can't be less than the input and output devices' IO buffers.
+    BGMPlayThroughSimulator::Config config;
+    config.mTargetLatencyMs = 1.0;
+
+    BGMPlayThroughSimulator::Report report = [self run:config];
+
+    XCTAssertEqual(report.mTargetLatencyFrames, 2 * 512u);
+    XCTAssertEqual(report.mDroppedFrames, 0u);
+    XCTAssertEqual(report.mRepeatedFrames, 0u);
+}
+
+- (void) testBufferSizes {
+    for(UInt32 frameSize : { 64u, 256u, 1024u, 2048u })
+    {
+        BGMPlayThroughSimulator::Config config;
+        config.mIOBufferFrameSize = frameSize;
+        config.mOutputCycleCount = 500;
+
+        BGMPlayThroughSimulator::Report report = [self run:config];
+
+        XCTAssertEqual(report.mDroppedFrames, 0u);
+        XCTAssertEqual(report.mRepeatedFrames, 0u);
+        XCTAssertEqual(report.mReanchors, 0u);
+    }
+}
+
+- (void) testOutputClockFasterThanInput {
+    // The output device consumes frames faster than the input device produces them, so the read
+    // head gets closer to the input and BGMPlayThrough has to move it back to the target.
+    BGMPlayThroughSimulator::Config config;
+    config.mOutputClockSkewPPM = 1000.0;
+    config.mOutputCycleCount = 3000;
+
+    BGMPlayThroughSimulator::Report report = [self run:config];
+
+    XCTAssertGreaterThan(report.mReanchors, 0u);
+    XCTAssertGreaterThan(report.mRepeatedFrames, 0u);
+    XCTAssertEqual(report.mDroppedFrames, 0u);
+    XCTAssertGreaterThan(report.mLatencyChanges, 0u);
+    // The correction should be spread out, repeating at most a couple of frames at a time (one in
+    // every 256 frames of each IO buffer), rather than repeating hundreds at once.
+    XCTAssertGreaterThan(report.mLargestSkipFrames, 0u);
+    XCTAssertLessThanOrEqual(report.mLargestSkipFrames, 512 / 256u);
+    XCTAssertEqual(report.mSilentFrames, 0u);
+}
+
+- (void) testOutputClockSlowerThanInput {
+    // The input gets further and further ahead of the read head, so BGMPlayThrough has to skip the
+    // read head forward to stop the latency from growing.
+    BGMPlayThroughSimulator::Config config;
+    config.mOutputClockSkewPPM = -1000.0;
+    config.mOutputCycleCount = 3000;
+
+    BGMPlayThroughSimulator::Report report = [self run:config];
+
+    XCTAssertGreaterThan(report.mReanchors, 0u);
+    XCTAssertGreaterThan(report.mDroppedFrames, 0u);
+    XCTAssertEqual(report.mRepeatedFrames, 0u);
+    // About 1.5 million frames at 1000 ppm is about 35 ms of drift, which is how much the latency
+    // would have grown by if BGMPlayThrough hadn't corrected it.
+    XCTAssertLessThan(report.mMaxLatencyMs - report.mMinLatencyMs, 3 * 512 / 44.1);
+    XCTAssertLessThan(report.mMaxLatencyMs, 4 * 512 / 44.1 + 30.0);
+    // And it should drop a couple of frames at a time rather than skipping hundreds at once.
+    XCTAssertGreaterThan(report.mLargestSkipFrames, 0u);
+    XCTAssertLessThanOrEqual(report.mLargestSkipFrames, 512 / 256u);
+    XCTAssertEqual(report.mSilentFrames, 0u);
+}
+
+- (void) testClockDriftSmallIOBuffers {
+    // With small IO buffers, the read head is moved at most one frame per IO cycle, which has to
+    // be enough to keep up with the drift.
+    for(Float64 skewPPM : { 2000.0, -2000.0 })
+    {
+        BGMPlayThroughSimulator::Config config;
+        config.mIOBufferFrameSize = 64;
+        config.mOutputClockSkewPPM = skewPPM;
+        config.mOutputCycleCount = 20000;
+
+        BGMPlayThroughSimulator::Report report = [self run:config];
+
+        XCTAssertGreaterThan(report.mReanchors, 0u);
+        XCTAssertEqual(report.mLargestSkipFrames, 1u);
+        XCTAssertEqual(report.mSilentFrames, 0u);
+        XCTAssertLessThan(report.mMaxLatencyMs - report.mMinLatencyMs, 3 * 64 / 44.1);
+    }
+}
+
+- (void) testOutputTimestampReset {
+    // E.g. headphones being plugged in and then unplugged.
+    BGMPlayThroughSimulator::Config config;
+    config.mOutputTimestampResetCycles = { 500, 1000 };
+
+    BGMPlayThroughSimulator::Report report = [self run:config];
+
+    // The read head ends up outside the ring buffer after each reset, so it has to be moved, but
+    // it should be moved back to the same input frame.
+    XCTAssertGreaterThanOrEqual(report.mReanchors, 2u);
+    XCTAssertEqual(report.mDroppedFrames, 0u);
+    XCTAssertEqual(report.mRepeatedFrames, 0u);
+    XCTAssertEqual(report.mSilentFrames, 0u);
+}
+
+- (void) testInputTimestampReset {
+    BGMPlayThroughSimulator::Config config;
+    config.mInputTimestampResetCycles = { 700 };
+
+    BGMPlayThroughSimulator::Report report = [self run:config];
+
+    XCTAssertGreaterThanOrEqual(report.mReanchors, 1u);
+    XCTAssertEqual(report.mRepeatedFrames, 0u);
+    // The input frames that were in the ring buffer when the input device restarted its sample
+    // times are lost, since CARingBuffer throws them out. BGMPlayThrough then waits for it to fill
+    // up to the target again.
+    XCTAssertLessThanOrEqual(report.mDroppedFrames, 3 * 512u);
+    XCTAssertLessThanOrEqual(report.mSilentFrames, 3 * 512u);
+}
+
+- (void) testSchedulingJitter {
+    // Calls can be up to a full IO buffer late, so the input IOProc will sometimes run after the
+    // output IOProc it would normally run before.
+    BGMPlayThroughSimulator::Config config;
+    config.mSchedulingJitterNs = static_cast<UInt64>(512 / 44100.0 * NSEC_PER_SEC);
+
+    BGMPlayThroughSimulator::Report report = [self run:config];
+
+    // The safe preset keeps enough in the ring buffer to cover the jitter, so the read head never
+    // has to move.
+    XCTAssertEqual(report.mReanchors, 0u);
+    XCTAssertEqual(report.mDroppedFrames, 0u);
+    XCTAssertEqual(report.mRepeatedFrames, 0u);
+    XCTAssertEqual(report.mSilentFrames, 0u);
+    // At most one IO buffer more than the target, if the read head was positioned while an input
+    // cycle was late.
+    XCTAssertLessThanOrEqual(report.mMaxLatencyMs, 5 * 512 / 44.1 + 0.01);
+}
+
+- (void) testSchedulingJitterLowLatency {
+    BGMPlayThroughSimulator::Config config;
+    config.mSchedulingJitterNs = static_cast<UInt64>(512 / 44100.0 * NSEC_PER_SEC);
+    config.mLatencyPreset = BGMPlayThrough::LatencyPreset::LowLatency;
+
+    BGMPlayThroughSimulator::Report lowLatency = [self run:config];
+
+    config.mLatencyPreset = BGMPlayThrough::LatencyPreset::Safe;
+    BGMPlayThroughSimulator::Report safe = [self run:config];
+
+    // Unless the read head was positioned while an input cycle was late, the first late input
+    // cycle makes it catch up to the input, so it has to be moved back, which repeats a buffer.
+    XCTAssertLessThanOrEqual(lowLatency.mReanchors, 1u);
+    XCTAssertEqual(lowLatency.mRepeatedFrames, lowLatency.mReanchors * 512);
+    XCTAssertEqual(lowLatency.mDroppedFrames, 0u);
+    // After that, it's far enough behind to cover the jitter, but still closer to the input than
+    // with the safe preset.
+    XCTAssertLessThanOrEqual(lowLatency.mMaxLatencyMs, 3 * 512 / 44.1 + 0.01);
+    XCTAssertLessThan(lowLatency.mMaxLatencyMs, safe.mMinLatencyMs);
+}
+
+- (void) testMultichannelOutput {
+    // E.g. an audio interface with its speakers on channels 3 and 4.
+    [self runWithOutputStreams:{ MockAudioDevice::MakeFloat32StreamFormat(8) }
+                    stereoLeft:3
+                   stereoRight:4];
+}
+
+- (void) testNonInterleavedOutput {
+    [self runWithOutputStreams:{ MockAudioDevice::MakeFloat32StreamFormat(2, false) }
+                    stereoLeft:1
+                   stereoRight:2];
+    [self runWithOutputStreams:{ MockAudioDevice::MakeFloat32StreamFormat(6, false) }
+                    stereoLeft:5
+                   stereoRight:6];
+}
+
+- (void) testMultipleOutputStreams {
+    // The preferred channels are counted across all of the device's streams, so 5 and 6 are the
+    // second stream's third and fourth.
+    [self runWithOutputStreams:{ MockAudioDevice::MakeFloat32StreamFormat(2),
+                                 MockAudioDevice::MakeFloat32StreamFormat(6) }
+                    stereoLeft:5
+                   stereoRight:6];
+    // And with the stereo pair split across two streams.
+    [self runWithOutputStreams:{ MockAudioDevice::MakeFloat32StreamFormat(1),
+                                 MockAudioDevice::MakeFloat32StreamFormat(4, false) }
+                    stereoLeft:1
+                   stereoRight:2];
+}
+
+- (void) testMonoOutput {
+    // Both channels are played on the device's one channel. They're identical in the simulator's
+    // input, so it should get the same samples.
+    [self runWithOutputStreams:{ MockAudioDevice::MakeFloat32StreamFormat(1) }
+                    stereoLeft:1
+                   stereoRight:2];
+}
+
+- (void) testSilentInput {
+    // While BGMDevice is silent, the output IOProc plays silence without reading the ring buffer.
+    // It should still play exactly the silent frames, and no others, and keep its read head where
+    // it was.
+    BGMPlayThroughSimulator::Config config;
+    config.mSilentInputStartCycle = 300;
+    config.mSilentInputCycleCount = 1000;
+
+    BGMPlayThroughSimulator::Report report = [self run:config];
+
+    const UInt64 silentInputFrames = 1000 * 512u;
+    XCTAssertEqual(report.mSilentFrames, silentInputFrames);
+    // The silent input frames can't be decoded from the output, so they're counted as dropped.
+    XCTAssertEqual(report.mDroppedFrames, silentInputFrames);
+    XCTAssertEqual(report.mRepeatedFrames, 0u);
+    XCTAssertEqual(report.mReanchors, 0u);
+    XCTAssertEqual(report.mLatencyChanges, 0u);
+    XCTAssertEqual(report.mMeasuredLatencyFrames, 4 * 512u);
+}
+
+- (void) testInputChannelCountChange {
+    // E.g. the user switching BGMDevice from stereo to 5.1 or 7.1 in Audio MIDI Setup while audio
+    // is playing.
+    for(UInt32 channels : { 6u, 8u })
+    {
+        BGMPlayThroughSimulator::Config config;
+        config.mInputFormatChangeCycle = 700;
+        config.mInputChannelCountAfterChange = channels;
+
+        BGMPlayThroughSimulator::Report report = [self run:config];
+
+        // The input IOProc should drop the first cycle of new input, since it doesn't fit the
+        // stereo ring buffer, and the frames that were still in the ring buffer are lost when it's
+        // reallocated. Then playthrough should wait for the new one to fill up and carry on as
+        // before.
+        XCTAssertEqual(report.mRepeatedFrames, 0u);
+        XCTAssertGreaterThan(report.mDroppedFrames, 0u);
+        XCTAssertLessThanOrEqual(report.mDroppedFrames, 5 * 512u);
+        XCTAssertLessThanOrEqual(report.mSilentFrames, 5 * 512u);
+        XCTAssertEqualWithAccuracy(report.mFinalLatencyMs, 4 * 512 / 44.1, 0.01);
+        XCTAssertEqual(report.mMeasuredLatencyFrames, 4 * 512u);
+    }
+}
+
+- (void) testInputChannelCountChangeWithoutNotification {
+    // If BGMPlayThrough never hears about the new format, it should play silence rather than
+    // storing the 5.1 frames in the stereo ring buffer and playing garbage.
+    BGMPlayThroughSimulator::Config config;
+    config.mInputFormatChangeCycle = 700;
+    config.mInputChannelCountAfterChange = 6;
+    config.mNotifyInputFormatChange = false;
+
+    BGMPlayThroughSimulator::Report report = [self run:config];
+
+    XCTAssertEqual(report.mRepeatedFrames, 0u);
+    XCTAssertEqual(report.mDroppedFrames, 0u);
+    XCTAssertGreaterThanOrEqual(report.mSilentFrames, (2000 - 700 - 8) * 512u);
+    // The last frame played was from before the format changed.
+    XCTAssertEqualWithAccuracy(report.mFinalLatencyMs, 4 * 512 / 44.1, 0.01);
+}
+
+- (void) testDeterministic {
+    BGMPlayThroughSimulator::Config config;
+    config.mOutputClockSkewPPM = 300.0;
+    config.mSchedulingJitterNs = 5 * NSEC_PER_MSEC;
+    config.mOutputTimestampResetCycles = { 1234 };
+    config.mSeed = 42;
+
+    BGMPlayThroughSimulator::Report first = [self run:config];
+    BGMPlayThroughSimulator::Report second = [self run:config];
+
+    XCTAssertEqual(first.mReanchors, second.mReanchors);
+    XCTAssertEqual(first.mDroppedFrames, second.mDroppedFrames);
+    XCTAssertEqual(first.mRepeatedFrames, second.mRepeatedFrames);
+    XCTAssertEqual(first.mSilentFrames, second.mSilentFrames);
+    XCTAssertEqual(first.mFinalLatencyMs, second.mFinalLatencyMs);
+}
+
+@end
+
@@ -86,6 +86,7 @@
     std::set<AudioObjectPropertySelector> expectedProperties {
             kAudioDevicePropertyDeviceIsRunning,
             kAudioDeviceProcessorOverload,
+            kAudioDevicePropertyStreamConfiguration,
             kAudioDeviceCustomPropertyDeviceIsRunningSomewhereOtherThanBGMApp
     };
 
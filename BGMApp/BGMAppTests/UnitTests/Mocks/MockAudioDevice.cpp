@@ -17,7 +17,7 @@
 //  MockAudioDevice.cpp
 //  BGMAppUnitTests
 //
-//  Copyright © 2020 Kyle Neideck
+//  Copyright © 2020, 2026 Kyle Neideck
 //
 
 // Self Include
@@ -27,14 +27,30 @@
 #include "BGM_Types.h"
 
 // STL Includes
+#include <algorithm>
 #include <functional>
 
 
 MockAudioDevice::MockAudioDevice(const std::string& inUID)
 :
     mUID(inUID),
+    mName(inUID),
+    mTransportType(kAudioDeviceTransportTypeVirtual),
+    mIsHidden(false),
+    mCanBeDefaultDevice(true),
     mNominalSampleRate(44100.0),
     mIOBufferSize(512),
+    mIOProc(nullptr),
+    mIOProcClientData(nullptr),
+    mIOProcIsRunning(false),
+    mHasVolumeControl(false),
+    mVolumeDb(0.0f),
+    mMinVolumeDb(-64.0f),
+    mMaxVolumeDb(0.0f),
+    mAppVolumesUpdateCount(0),
+    mStreamFormats({ MakeFloat32StreamFormat(2) }),
+    mPreferredStereoLeft(1),
+    mPreferredStereoRight(2),
     MockAudioObject(static_cast<AudioObjectID>(std::hash<std::string>{}(inUID)))
 {
 }
@@ -59,3 +75,33 @@ void MockAudioDevice::SetPlayerBundleID(const CACFString& inPlayerBundleID)
     mPlayerBundleID = inPlayerBundleID;
 }
 
+Float32 MockAudioDevice::VolumeScalarToDecibels(Float32 inScalar) const
+{
+    inScalar = std::max(0.0f, std::min(1.0f, inScalar));
+    return mMinVolumeDb + inScalar * (mMaxVolumeDb - mMinVolumeDb);
+}
+
+Float32 MockAudioDevice::VolumeDecibelsToScalar(Float32 inDecibels) const
+{
+    inDecibels = std::max(mMinVolumeDb, std::min(mMaxVolumeDb, inDecibels));
+    return (inDecibels - mMinVolumeDb) / (mMaxVolumeDb - mMinVolumeDb);
+}
+
+// static
+AudioStreamBasicDescription MockAudioDevice::MakeFloat32StreamFormat(UInt32 inChannelsPerFrame,
+                                                                     bool inIsInterleaved)
+{
+    AudioStreamBasicDescription format = {};
+    format.mSampleRate = 44100.0;
+    format.mFormatID = kAudioFormatLinearPCM;
+    format.mFormatFlags =
+            kAudioFormatFlagIsFloat | kAudioFormatFlagsNativeEndian | kAudioFormatFlagIsPacked |
+            (inIsInterleaved ? 0 : kAudioFormatFlagIsNonInterleaved);
+    format.mFramesPerPacket = 1;
+    format.mChannelsPerFrame = inChannelsPerFrame;
+    format.mBitsPerChannel = 32;
+    format.mBytesPerFrame = sizeof(Float32) * (inIsInterleaved ? inChannelsPerFrame : 1);
+    format.mBytesPerPacket = format.mBytesPerFrame;
+    return format;
+}
+
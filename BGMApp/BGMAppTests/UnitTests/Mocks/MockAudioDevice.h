@@ -17,7 +17,7 @@
 //  MockAudioObject.h
 //  BGMAppUnitTests
 //
-//  Copyright © 2020 Kyle Neideck
+//  Copyright © 2020, 2026 Kyle Neideck
 //
 
 #ifndef BGMAppUnitTests__MockAudioDevice
@@ -26,8 +26,13 @@
 // Superclass Includes
 #include "MockAudioObject.h"
 
+// PublicUtility Includes
+#include "CACFArray.h"
+
 // STL Includes
+#include <atomic>
 #include <string>
+#include <vector>
 
 
 /*!
@@ -56,14 +61,69 @@ public:
      */
     void SetPlayerBundleID(const CACFString& inPlayerBundleID);
 
+    /*!
+     * Convert between the mock volume control's scalar and decibel values. The mock's volume curve
+     * is linear in dB from mMinVolumeDb to mMaxVolumeDb.
+     */
+    Float32 VolumeScalarToDecibels(Float32 inScalar) const;
+    Float32 VolumeDecibelsToScalar(Float32 inDecibels) const;
+
+    /*!
+     * @return The virtual format of a native-endian Float32 stream with inChannelsPerFrame
+     *         channels, for mStreamFormats.
+     */
+    static AudioStreamBasicDescription MakeFloat32StreamFormat(UInt32 inChannelsPerFrame,
+                                                               bool inIsInterleaved = true);
+
     /*!
      * The device's UID. The UID is a persistent token used to identify a particular audio device
      * across boot sessions.
      */
     const std::string mUID;
+    std::string mName;
+    UInt32 mTransportType;
+    bool mIsHidden;
+    bool mCanBeDefaultDevice;
     Float64 mNominalSampleRate;
     UInt32 mIOBufferSize;
 
+    /*!
+     * The IOProc most recently registered with CAHALAudioDevice::CreateIOProcID, and its client
+     * data. The mock HAL never calls it itself. See BGMPlayThroughSimulator, which does.
+     */
+    AudioDeviceIOProc mIOProc;
+    void* mIOProcClientData;
+    /*!
+     * True between calls to CAHALAudioDevice::StartIOProc and CAHALAudioDevice::StopIOProc. This
+     * can be set from any thread because StopIOProc can be called from inside the IOProc.
+     */
+    std::atomic<bool> mIOProcIsRunning;
+
+    /*!
+     * The device's master output volume control. The mock devices don't have per-channel volume
+     * controls. False by default, in which case the volume functions in CAHALAudioDevice throw.
+     */
+    bool mHasVolumeControl;
+    Float32 mVolumeDb;
+    Float32 mMinVolumeDb;
+    Float32 mMaxVolumeDb;
+
+    /*!
+     * The value of the most recent kAudioDeviceCustomPropertyAppVolumes update sent to this device
+     * and the number of updates that have been sent.
+     */
+    CACFArray mAppVolumes;
+    UInt32 mAppVolumesUpdateCount;
+
+    /*!
+     * The virtual formats of the device's streams, which are the same for input and output, and
+     * its kAudioDevicePropertyPreferredChannelsForStereo. By default, the device has one
+     * interleaved stereo Float32 stream and prefers channels 1 and 2 for stereo.
+     */
+    std::vector<AudioStreamBasicDescription> mStreamFormats;
+    UInt32 mPreferredStereoLeft;
+    UInt32 mPreferredStereoRight;
+
 private:
     CACFString mPlayerBundleID { "" };
 
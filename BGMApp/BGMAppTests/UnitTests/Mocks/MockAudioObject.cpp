@@ -35,3 +35,43 @@ AudioObjectID MockAudioObject::GetObjectID() const
     return mAudioObjectID;
 }
 
+void MockAudioObject::NotifyPropertyListeners(AudioObjectPropertySelector inSelector)
+{
+    // Copy the listeners, since a listener proc could add or remove listeners.
+    const std::vector<Listener> listeners = mListeners;
+
+    for(const Listener& listener : listeners)
+    {
+        if(listener.mAddress.mSelector == inSelector)
+        {
+            listener.mProc(mAudioObjectID, 1, &listener.mAddress, listener.mClientData);
+        }
+    }
+}
+
+void MockAudioObject::AddPropertyListener(const AudioObjectPropertyAddress& inAddress,
+                                          AudioObjectPropertyListenerProc inListenerProc,
+                                          void* inClientData)
+{
+    mPropertiesWithListeners.insert(inAddress.mSelector);
+    mListeners.push_back({ inAddress, inListenerProc, inClientData });
+}
+
+void MockAudioObject::RemovePropertyListener(const AudioObjectPropertyAddress& inAddress,
+                                             AudioObjectPropertyListenerProc inListenerProc,
+                                             void* inClientData)
+{
+    mPropertiesWithListeners.erase(inAddress.mSelector);
+
+    for(auto it = mListeners.begin(); it != mListeners.end(); it++)
+    {
+        if((it->mAddress.mSelector == inAddress.mSelector) &&
+           (it->mProc == inListenerProc) &&
+           (it->mClientData == inClientData))
+        {
+            mListeners.erase(it);
+            break;
+        }
+    }
+}
+
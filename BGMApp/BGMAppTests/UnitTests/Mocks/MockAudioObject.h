@@ -28,6 +28,7 @@
 
 // STL Includes
 #include <set>
+#include <vector>
 
 // System Includes
 #include <CoreAudio/CoreAudio.h>
@@ -52,8 +53,37 @@ public:
      */
     std::set<AudioObjectPropertySelector> mPropertiesWithListeners;
 
+    /*!
+     * Call the listener procs that have been added for the property, like the HAL would after the
+     * property changes. Called on the caller's thread.
+     */
+    void NotifyPropertyListeners(AudioObjectPropertySelector inSelector);
+
+    /*! Called by the mock CAHALAudioObject::AddPropertyListener and RemovePropertyListener. */
+    void AddPropertyListener(const AudioObjectPropertyAddress& inAddress,
+                             AudioObjectPropertyListenerProc inListenerProc,
+                             void* inClientData);
+    void RemovePropertyListener(const AudioObjectPropertyAddress& inAddress,
+                                AudioObjectPropertyListenerProc inListenerProc,
+                                void* inClientData);
+
+    /*!
+     * The number of times the object's properties have been read from the mock HAL. Each read would
+     * be a call to coreaudiod with the real HAL. Only counted for the properties tests have needed
+     * to count so far.
+     */
+    UInt32 mPropertyReadCount = 0;
+
 private:
+    struct Listener
+    {
+        AudioObjectPropertyAddress mAddress;
+        AudioObjectPropertyListenerProc mProc;
+        void* mClientData;
+    };
+
     AudioObjectID mAudioObjectID;
+    std::vector<Listener> mListeners;
 
 };
 
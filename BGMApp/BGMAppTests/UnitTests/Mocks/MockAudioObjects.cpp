@@ -51,6 +51,7 @@ std::shared_ptr<MockAudioDevice> MockAudioObjects::CreateMockDevice(const std::s
 void MockAudioObjects::DestroyMocks()
 {
     sDevices.clear();
+    sDevicesByUID.clear();
 }
 
 // static
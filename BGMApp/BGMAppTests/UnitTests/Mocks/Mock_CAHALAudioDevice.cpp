@@ -17,7 +17,7 @@
 //  Mock_CAHALAudioDevice.cpp
 //  BGMAppUnitTests
 //
-//  Copyright © 2020 Kyle Neideck
+//  Copyright © 2020, 2026 Kyle Neideck
 //
 
 // Self Include
@@ -35,6 +35,9 @@
 #include "CAHALAudioSystemObject.h"
 #include "CAPropertyAddress.h"
 
+// STL Includes
+#include <algorithm>
+
 
 #pragma clang diagnostic ignored "-Wunused-parameter"
 
@@ -56,15 +59,27 @@ CAHALAudioDevice::~CAHALAudioDevice()
 
 void	CAHALAudioDevice::GetCurrentVirtualFormats(bool inIsInput, UInt32& ioNumberStreams, AudioStreamBasicDescription* outFormats) const
 {
-    ioNumberStreams = 1;
-    CAPropertyAddress theAddress(kAudioStreamPropertyVirtualFormat);
-    UInt32 theSize = sizeof(AudioStreamBasicDescription);
-    GetPropertyData(theAddress, 0, NULL, theSize, outFormats);
+    std::shared_ptr<MockAudioDevice> mockDevice = MockAudioObjects::GetAudioDevice(GetObjectID());
+    mockDevice->mPropertyReadCount++;
+    ioNumberStreams =
+            std::min(ioNumberStreams, static_cast<UInt32>(mockDevice->mStreamFormats.size()));
+    std::copy(mockDevice->mStreamFormats.begin(),
+              mockDevice->mStreamFormats.begin() + ioNumberStreams,
+              outFormats);
+}
+
+UInt32	CAHALAudioDevice::GetNumberStreams(bool inIsInput) const
+{
+    std::shared_ptr<MockAudioDevice> mockDevice = MockAudioObjects::GetAudioDevice(GetObjectID());
+    mockDevice->mPropertyReadCount++;
+    return static_cast<UInt32>(mockDevice->mStreamFormats.size());
 }
 
 UInt32	CAHALAudioDevice::GetIOBufferSize() const
 {
-    return MockAudioObjects::GetAudioDevice(GetObjectID())->mIOBufferSize;
+    std::shared_ptr<MockAudioDevice> mockDevice = MockAudioObjects::GetAudioDevice(GetObjectID());
+    mockDevice->mPropertyReadCount++;
+    return mockDevice->mIOBufferSize;
 }
 
 void	CAHALAudioDevice::SetIOBufferSize(UInt32 inBufferSize)
@@ -79,16 +94,35 @@ bool	CAHALAudioDevice::IsAlive() const
 
 AudioDeviceIOProcID	CAHALAudioDevice::CreateIOProcID(AudioDeviceIOProc inIOProc, void* inClientData)
 {
+    std::shared_ptr<MockAudioDevice> mockDevice = MockAudioObjects::GetAudioDevice(GetObjectID());
+    mockDevice->mIOProc = inIOProc;
+    mockDevice->mIOProcClientData = inClientData;
+
     return reinterpret_cast<AudioDeviceIOProcID>(0x99990000);
 }
 
 void	CAHALAudioDevice::DestroyIOProcID(AudioDeviceIOProcID inIOProcID)
 {
+    std::shared_ptr<MockAudioDevice> mockDevice = MockAudioObjects::GetAudioDevice(GetObjectID());
+    mockDevice->mIOProc = nullptr;
+    mockDevice->mIOProcClientData = nullptr;
+}
+
+void	CAHALAudioDevice::StartIOProc(AudioDeviceIOProcID inIOProcID)
+{
+    MockAudioObjects::GetAudioDevice(GetObjectID())->mIOProcIsRunning = true;
+}
+
+void	CAHALAudioDevice::StopIOProc(AudioDeviceIOProcID inIOProcID)
+{
+    MockAudioObjects::GetAudioDevice(GetObjectID())->mIOProcIsRunning = false;
 }
 
 Float64	CAHALAudioDevice::GetNominalSampleRate() const
 {
-    return MockAudioObjects::GetAudioDevice(GetObjectID())->mNominalSampleRate;
+    std::shared_ptr<MockAudioDevice> mockDevice = MockAudioObjects::GetAudioDevice(GetObjectID());
+    mockDevice->mPropertyReadCount++;
+    return mockDevice->mNominalSampleRate;
 }
 
 void	CAHALAudioDevice::SetNominalSampleRate(Float64 inSampleRate)
@@ -98,83 +132,108 @@ void	CAHALAudioDevice::SetNominalSampleRate(Float64 inSampleRate)
 
 CFStringRef    CAHALAudioDevice::CopyDeviceUID() const
 {
-    std::string uid = MockAudioObjects::GetAudioDevice(GetObjectID())->mUID;
-    return CACFString(uid.c_str()).CopyCFString();
+    std::shared_ptr<MockAudioDevice> mockDevice = MockAudioObjects::GetAudioDevice(GetObjectID());
+    mockDevice->mPropertyReadCount++;
+    return CACFString(mockDevice->mUID.c_str()).CopyCFString();
 }
 
-#pragma mark Unimplemented Methods
+UInt32	CAHALAudioDevice::GetTransportType() const
+{
+    std::shared_ptr<MockAudioDevice> mockDevice = MockAudioObjects::GetAudioDevice(GetObjectID());
+    mockDevice->mPropertyReadCount++;
+    return mockDevice->mTransportType;
+}
 
-bool	CAHALAudioDevice::HasModelUID() const
+bool	CAHALAudioDevice::CanBeDefaultDevice(bool inIsInput, bool inIsSystem) const
 {
-    Throw(new CAException(kAudio_UnimplementedError));
+    std::shared_ptr<MockAudioDevice> mockDevice = MockAudioObjects::GetAudioDevice(GetObjectID());
+    mockDevice->mPropertyReadCount++;
+    return mockDevice->mCanBeDefaultDevice;
 }
 
-CFStringRef	CAHALAudioDevice::CopyModelUID() const
+bool	CAHALAudioDevice::IsHidden() const
 {
-    Throw(new CAException(kAudio_UnimplementedError));
+    std::shared_ptr<MockAudioDevice> mockDevice = MockAudioObjects::GetAudioDevice(GetObjectID());
+    mockDevice->mPropertyReadCount++;
+    return mockDevice->mIsHidden;
 }
 
-CFStringRef	CAHALAudioDevice::CopyConfigurationApplicationBundleID() const
+UInt32	CAHALAudioDevice::GetTotalNumberChannels(bool inIsInput) const
 {
-    Throw(new CAException(kAudio_UnimplementedError));
+    std::shared_ptr<MockAudioDevice> mockDevice = MockAudioObjects::GetAudioDevice(GetObjectID());
+    mockDevice->mPropertyReadCount++;
+
+    UInt32 numberChannels = 0;
+
+    for(const AudioStreamBasicDescription& format : mockDevice->mStreamFormats)
+    {
+        numberChannels += format.mChannelsPerFrame;
+    }
+
+    return numberChannels;
 }
 
-CFURLRef	CAHALAudioDevice::CopyIconLocation() const
+bool	CAHALAudioDevice::HasPreferredStereoChannels(bool inIsInput) const
 {
-    Throw(new CAException(kAudio_UnimplementedError));
+    return true;
 }
 
-UInt32	CAHALAudioDevice::GetTransportType() const
+void	CAHALAudioDevice::GetPreferredStereoChannels(bool inIsInput, UInt32& outLeft, UInt32& outRight) const
 {
-    Throw(new CAException(kAudio_UnimplementedError));
+    std::shared_ptr<MockAudioDevice> mockDevice = MockAudioObjects::GetAudioDevice(GetObjectID());
+    mockDevice->mPropertyReadCount++;
+    outLeft = mockDevice->mPreferredStereoLeft;
+    outRight = mockDevice->mPreferredStereoRight;
 }
 
-bool	CAHALAudioDevice::CanBeDefaultDevice(bool inIsInput, bool inIsSystem) const
+#pragma mark Unimplemented Methods
+
+bool	CAHALAudioDevice::HasModelUID() const
 {
     Throw(new CAException(kAudio_UnimplementedError));
 }
 
-bool	CAHALAudioDevice::HasDevicePlugInStatus() const
+CFStringRef	CAHALAudioDevice::CopyModelUID() const
 {
     Throw(new CAException(kAudio_UnimplementedError));
 }
 
-OSStatus	CAHALAudioDevice::GetDevicePlugInStatus() const
+CFStringRef	CAHALAudioDevice::CopyConfigurationApplicationBundleID() const
 {
     Throw(new CAException(kAudio_UnimplementedError));
 }
 
-bool	CAHALAudioDevice::IsHidden() const
+CFURLRef	CAHALAudioDevice::CopyIconLocation() const
 {
     Throw(new CAException(kAudio_UnimplementedError));
 }
 
-pid_t	CAHALAudioDevice::GetHogModeOwner() const
+bool	CAHALAudioDevice::HasDevicePlugInStatus() const
 {
     Throw(new CAException(kAudio_UnimplementedError));
 }
 
-bool	CAHALAudioDevice::IsHogModeSettable() const
+OSStatus	CAHALAudioDevice::GetDevicePlugInStatus() const
 {
     Throw(new CAException(kAudio_UnimplementedError));
 }
 
-bool	CAHALAudioDevice::TakeHogMode()
+pid_t	CAHALAudioDevice::GetHogModeOwner() const
 {
     Throw(new CAException(kAudio_UnimplementedError));
 }
 
-void	CAHALAudioDevice::ReleaseHogMode()
+bool	CAHALAudioDevice::IsHogModeSettable() const
 {
     Throw(new CAException(kAudio_UnimplementedError));
 }
 
-bool	CAHALAudioDevice::HasPreferredStereoChannels(bool inIsInput) const
+bool	CAHALAudioDevice::TakeHogMode()
 {
     Throw(new CAException(kAudio_UnimplementedError));
 }
 
-void	CAHALAudioDevice::GetPreferredStereoChannels(bool inIsInput, UInt32& outLeft, UInt32& outRight) const
+void	CAHALAudioDevice::ReleaseHogMode()
 {
     Throw(new CAException(kAudio_UnimplementedError));
 }
@@ -214,11 +273,6 @@ AudioObjectID	CAHALAudioDevice::GetRelatedAudioDeviceByIndex(UInt32 inIndex) con
     Throw(new CAException(kAudio_UnimplementedError));
 }
 
-UInt32	CAHALAudioDevice::GetNumberStreams(bool inIsInput) const
-{
-    Throw(new CAException(kAudio_UnimplementedError));
-}
-
 void	CAHALAudioDevice::GetStreams(bool inIsInput, UInt32& ioNumberStreams, AudioObjectID* outStreamList) const
 {
     Throw(new CAException(kAudio_UnimplementedError));
@@ -229,11 +283,6 @@ AudioObjectID	CAHALAudioDevice::GetStreamByIndex(bool inIsInput, UInt32 inIndex)
     Throw(new CAException(kAudio_UnimplementedError));
 }
 
-UInt32	CAHALAudioDevice::GetTotalNumberChannels(bool inIsInput) const
-{
-    Throw(new CAException(kAudio_UnimplementedError));
-}
-
 void	CAHALAudioDevice::GetCurrentPhysicalFormats(bool inIsInput, UInt32& ioNumberStreams, AudioStreamBasicDescription* outFormats) const
 {
     Throw(new CAException(kAudio_UnimplementedError));
@@ -319,21 +368,11 @@ void	CAHALAudioDevice::GetIOBufferSizeRange(UInt32& outMinimum, UInt32& outMaxim
     Throw(new CAException(kAudio_UnimplementedError));
 }
 
-void	CAHALAudioDevice::StartIOProc(AudioDeviceIOProcID inIOProcID)
-{
-    Throw(new CAException(kAudio_UnimplementedError));
-}
-
 void	CAHALAudioDevice::StartIOProcAtTime(AudioDeviceIOProcID inIOProcID, AudioTimeStamp& ioStartTime, bool inIsInput, bool inIgnoreHardware)
 {
     Throw(new CAException(kAudio_UnimplementedError));
 }
 
-void	CAHALAudioDevice::StopIOProc(AudioDeviceIOProcID inIOProcID)
-{
-    Throw(new CAException(kAudio_UnimplementedError));
-}
-
 void	CAHALAudioDevice::GetIOProcStreamUsage(AudioDeviceIOProcID inIOProcID, bool inIsInput, bool* outStreamUsage) const
 {
     Throw(new CAException(kAudio_UnimplementedError));
@@ -369,44 +408,64 @@ void	CAHALAudioDevice::GetNearestStartTime(AudioTimeStamp& ioTime, bool inIsInpu
     Throw(new CAException(kAudio_UnimplementedError));
 }
 
+// Returns the mock device if it has the volume control. Throws otherwise.
+static std::shared_ptr<MockAudioDevice> MockDeviceWithVolumeControl(AudioObjectID inObjectID,
+                                                                    UInt32 inChannel)
+{
+    std::shared_ptr<MockAudioDevice> theDevice = MockAudioObjects::GetAudioDevice(inObjectID);
+
+    if(!theDevice->mHasVolumeControl || (inChannel != kMasterChannel))
+    {
+        Throw(CAException(kAudioHardwareUnknownPropertyError));
+    }
+
+    return theDevice;
+}
+
 bool	CAHALAudioDevice::HasVolumeControl(AudioObjectPropertyScope inScope, UInt32 inChannel) const
 {
-    Throw(new CAException(kAudio_UnimplementedError));
+    return MockAudioObjects::GetAudioDevice(GetObjectID())->mHasVolumeControl &&
+            (inChannel == kMasterChannel);
 }
 
 bool	CAHALAudioDevice::VolumeControlIsSettable(AudioObjectPropertyScope inScope, UInt32 inChannel) const
 {
-    Throw(new CAException(kAudio_UnimplementedError));
+    return HasVolumeControl(inScope, inChannel);
 }
 
 Float32	CAHALAudioDevice::GetVolumeControlScalarValue(AudioObjectPropertyScope inScope, UInt32 inChannel) const
 {
-    Throw(new CAException(kAudio_UnimplementedError));
+    std::shared_ptr<MockAudioDevice> theDevice = MockDeviceWithVolumeControl(GetObjectID(), inChannel);
+    return theDevice->VolumeDecibelsToScalar(theDevice->mVolumeDb);
 }
 
 Float32	CAHALAudioDevice::GetVolumeControlDecibelValue(AudioObjectPropertyScope inScope, UInt32 inChannel) const
 {
-    Throw(new CAException(kAudio_UnimplementedError));
+    return MockDeviceWithVolumeControl(GetObjectID(), inChannel)->mVolumeDb;
 }
 
 void	CAHALAudioDevice::SetVolumeControlScalarValue(AudioObjectPropertyScope inScope, UInt32 inChannel, Float32 inValue)
 {
-    Throw(new CAException(kAudio_UnimplementedError));
+    std::shared_ptr<MockAudioDevice> theDevice = MockDeviceWithVolumeControl(GetObjectID(), inChannel);
+    theDevice->mVolumeDb = theDevice->VolumeScalarToDecibels(inValue);
 }
 
 void	CAHALAudioDevice::SetVolumeControlDecibelValue(AudioObjectPropertyScope inScope, UInt32 inChannel, Float32 inValue)
 {
-    Throw(new CAException(kAudio_UnimplementedError));
+    std::shared_ptr<MockAudioDevice> theDevice = MockDeviceWithVolumeControl(GetObjectID(), inChannel);
+    // Clamp the value like a real device would.
+    theDevice->mVolumeDb =
+            std::max(theDevice->mMinVolumeDb, std::min(theDevice->mMaxVolumeDb, inValue));
 }
 
 Float32	CAHALAudioDevice::GetVolumeControlScalarForDecibelValue(AudioObjectPropertyScope inScope, UInt32 inChannel, Float32 inValue) const
 {
-    Throw(new CAException(kAudio_UnimplementedError));
+    return MockDeviceWithVolumeControl(GetObjectID(), inChannel)->VolumeDecibelsToScalar(inValue);
 }
 
 Float32	CAHALAudioDevice::GetVolumeControlDecibelForScalarValue(AudioObjectPropertyScope inScope, UInt32 inChannel, Float32 inValue) const
 {
-    Throw(new CAException(kAudio_UnimplementedError));
+    return MockDeviceWithVolumeControl(GetObjectID(), inChannel)->VolumeScalarToDecibels(inValue);
 }
 
 bool	CAHALAudioDevice::HasSubVolumeControl(AudioObjectPropertyScope inScope, UInt32 inChannel) const
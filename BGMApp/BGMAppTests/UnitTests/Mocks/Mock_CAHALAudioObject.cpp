@@ -52,6 +52,11 @@ AudioObjectID	CAHALAudioObject::GetObjectID() const
 
 void	CAHALAudioObject::GetPropertyData(const AudioObjectPropertyAddress& inAddress, UInt32 inQualifierDataSize, const void* inQualifierData, UInt32& ioDataSize, void* outData) const
 {
+    if(ObjectExists(GetObjectID()))
+    {
+        MockAudioObjects::GetAudioObject(GetObjectID())->mPropertyReadCount++;
+    }
+
     switch(inAddress.mSelector)
     {
         case kAudioDeviceCustomPropertyMusicPlayerBundleID:
@@ -76,22 +81,6 @@ void	CAHALAudioObject::GetPropertyData(const AudioObjectPropertyAddress& inAddre
             *reinterpret_cast<UInt32*>(outData) = 1;
             break;
 
-        case kAudioStreamPropertyVirtualFormat:
-        {
-            AudioStreamBasicDescription* outASBD =
-                    reinterpret_cast<AudioStreamBasicDescription*>(outData);
-            outASBD->mSampleRate = 44100.0;
-            outASBD->mFormatID = kAudioFormatLinearPCM;
-            outASBD->mFormatFlags =
-                    kAudioFormatFlagIsFloat | kAudioFormatFlagsNativeEndian | kAudioFormatFlagIsPacked;
-            outASBD->mBytesPerPacket = 8;
-            outASBD->mFramesPerPacket = 1;
-            outASBD->mBytesPerFrame = 8;
-            outASBD->mChannelsPerFrame = 2;
-            outASBD->mBitsPerChannel = 32;
-            break;
-        }
-
         default:
             Throw(new CAException(kAudio_UnimplementedError));
     }
@@ -105,6 +94,15 @@ void	CAHALAudioObject::SetPropertyData(const AudioObjectPropertyAddress& inAddre
             MockAudioObjects::GetAudioDevice(GetObjectID())->SetPlayerBundleID(
                     CACFString(*reinterpret_cast<const CFStringRef*>(inData), false));
             break;
+        case kAudioDeviceCustomPropertyAppVolumes:
+            {
+                std::shared_ptr<MockAudioDevice> theDevice =
+                        MockAudioObjects::GetAudioDevice(GetObjectID());
+                // Retains the array.
+                theDevice->mAppVolumes = *reinterpret_cast<const CFArrayRef*>(inData);
+                theDevice->mAppVolumesUpdateCount++;
+            }
+            break;
         default:
             break;
     }
@@ -125,13 +123,33 @@ UInt32	CAHALAudioObject::GetPropertyDataSize(const AudioObjectPropertyAddress& i
 void	CAHALAudioObject::AddPropertyListener(const AudioObjectPropertyAddress& inAddress, AudioObjectPropertyListenerProc inListenerProc, void* inClientData)
 {
     MockAudioObjects::GetAudioObject(GetObjectID())->
-            mPropertiesWithListeners.insert(inAddress.mSelector);
+            AddPropertyListener(inAddress, inListenerProc, inClientData);
 }
 
 void	CAHALAudioObject::RemovePropertyListener(const AudioObjectPropertyAddress& inAddress, AudioObjectPropertyListenerProc inListenerProc, void* inClientData)
 {
     MockAudioObjects::GetAudioObject(GetObjectID())->
-            mPropertiesWithListeners.erase(inAddress.mSelector);
+            RemovePropertyListener(inAddress, inListenerProc, inClientData);
+}
+
+bool	CAHALAudioObject::ObjectExists(AudioObjectID inObjectID)
+{
+    try
+    {
+        MockAudioObjects::GetAudioObject(inObjectID);
+        return true;
+    }
+    catch(...)
+    {
+        return false;
+    }
+}
+
+CFStringRef	CAHALAudioObject::CopyName() const
+{
+    std::shared_ptr<MockAudioDevice> theDevice = MockAudioObjects::GetAudioDevice(GetObjectID());
+    theDevice->mPropertyReadCount++;
+    return CACFString(theDevice->mName.c_str()).CopyCFString();
 }
 
 #pragma mark Unimplemented Methods
@@ -156,11 +174,6 @@ CFStringRef	CAHALAudioObject::CopyOwningPlugInBundleID() const
     Throw(new CAException(kAudio_UnimplementedError));
 }
 
-CFStringRef	CAHALAudioObject::CopyName() const
-{
-    Throw(new CAException(kAudio_UnimplementedError));
-}
-
 CFStringRef	CAHALAudioObject::CopyManufacturer() const
 {
     Throw(new CAException(kAudio_UnimplementedError));
@@ -181,11 +194,6 @@ CFStringRef	CAHALAudioObject::CopyNumberNameForElement(AudioObjectPropertyScope
     Throw(new CAException(kAudio_UnimplementedError));
 }
 
-bool	CAHALAudioObject::ObjectExists(AudioObjectID inObjectID)
-{
-    Throw(new CAException(kAudio_UnimplementedError));
-}
-
 UInt32	CAHALAudioObject::GetNumberOwnedObjects(AudioClassID inClass) const
 {
     Throw(new CAException(kAudio_UnimplementedError));
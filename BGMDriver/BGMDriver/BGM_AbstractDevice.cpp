@@ -46,80 +46,61 @@ BGM_AbstractDevice::~BGM_AbstractDevice()
 
 #pragma mark Property Operations
 
+//static
+const BGM_PropertyTable<BGM_AbstractDevice>& BGM_AbstractDevice::GetPropertyTable()
+{
+    // None of these are settable. Subclasses that let clients set any of them, or that know the
+    // sizes of the ones listed with size 0 here, handle them before asking this class.
+    static constexpr BGM_PropertyDescriptor<BGM_AbstractDevice> kProperties[] = {
+        { kAudioObjectPropertyName,                            0, sizeof(CFStringRef),    nullptr },
+        { kAudioObjectPropertyManufacturer,                    0, sizeof(CFStringRef),    nullptr },
+        { kAudioDevicePropertyDeviceUID,                       0, sizeof(CFStringRef),    nullptr },
+        { kAudioDevicePropertyModelUID,                        0, sizeof(CFStringRef),    nullptr },
+        { kAudioDevicePropertyTransportType,                   0, sizeof(UInt32),         nullptr },
+        { kAudioDevicePropertyRelatedDevices,                  0, sizeof(AudioObjectID),  nullptr },
+        { kAudioDevicePropertyClockDomain,                     0, sizeof(UInt32),         nullptr },
+        { kAudioDevicePropertyDeviceIsAlive,                   0, sizeof(AudioClassID),   nullptr },
+        { kAudioDevicePropertyDeviceIsRunning,                 0, sizeof(UInt32),         nullptr },
+        { kAudioDevicePropertyDeviceCanBeDefaultDevice,        0, sizeof(UInt32),         nullptr },
+        { kAudioDevicePropertyDeviceCanBeDefaultSystemDevice,  0, sizeof(UInt32),         nullptr },
+        { kAudioDevicePropertyLatency,                         0, sizeof(UInt32),         nullptr },
+        { kAudioDevicePropertyStreams,                         0, 0,                      nullptr },
+        { kAudioObjectPropertyControlList,                     0, 0,                      nullptr },
+        { kAudioDevicePropertySafetyOffset,                    0, sizeof(UInt32),         nullptr },
+        { kAudioDevicePropertyNominalSampleRate,               0, sizeof(Float64),        nullptr },
+        { kAudioDevicePropertyAvailableNominalSampleRates,     0, 0,                      nullptr },
+        { kAudioDevicePropertyIsHidden,                        0, sizeof(UInt32),         nullptr },
+        { kAudioDevicePropertyZeroTimeStampPeriod,             0, sizeof(UInt32),         nullptr }
+    };
+
+    static_assert(BGM_PropertySelectorsAreUnique(kProperties),
+                  "BGM_AbstractDevice has duplicate properties");
+
+    static constexpr auto kPropertySlots = BGM_MakePropertySlots<BGM_PropertyShift(kProperties)>(kProperties);
+    static constexpr BGM_PropertyTable<BGM_AbstractDevice> kPropertyTable(kPropertySlots);
+    return kPropertyTable;
+}
+
 bool    BGM_AbstractDevice::HasProperty(AudioObjectID inObjectID,
                                         pid_t inClientPID,
                                         const AudioObjectPropertyAddress& inAddress) const
 {
-    bool theAnswer = false;
-    
-    switch(inAddress.mSelector)
-    {
-        case kAudioObjectPropertyName:
-        case kAudioObjectPropertyManufacturer:
-        case kAudioDevicePropertyDeviceUID:
-        case kAudioDevicePropertyModelUID:
-        case kAudioDevicePropertyTransportType:
-        case kAudioDevicePropertyRelatedDevices:
-        case kAudioDevicePropertyClockDomain:
-        case kAudioDevicePropertyDeviceIsAlive:
-        case kAudioDevicePropertyDeviceIsRunning:
-        case kAudioDevicePropertyDeviceCanBeDefaultDevice:
-        case kAudioDevicePropertyDeviceCanBeDefaultSystemDevice:
-        case kAudioDevicePropertyLatency:
-        case kAudioDevicePropertyStreams:
-        case kAudioObjectPropertyControlList:
-        case kAudioDevicePropertySafetyOffset:
-        case kAudioDevicePropertyNominalSampleRate:
-        case kAudioDevicePropertyAvailableNominalSampleRates:
-        case kAudioDevicePropertyIsHidden:
-        case kAudioDevicePropertyZeroTimeStampPeriod:
-            theAnswer = true;
-            break;
-            
-        default:
-            theAnswer = BGM_Object::HasProperty(inObjectID, inClientPID, inAddress);
-            break;
-    };
+    auto theProperty = GetPropertyTable().Find(inAddress.mSelector);
 
-    return theAnswer;
+    return (theProperty != nullptr) ?
+            theProperty->HasProperty(inAddress) :
+            BGM_Object::HasProperty(inObjectID, inClientPID, inAddress);
 }
 
 bool    BGM_AbstractDevice::IsPropertySettable(AudioObjectID inObjectID,
                                                pid_t inClientPID,
                                                const AudioObjectPropertyAddress& inAddress) const
 {
-    bool theAnswer = false;
+    auto theProperty = GetPropertyTable().Find(inAddress.mSelector);
 
-    switch(inAddress.mSelector)
-    {
-        case kAudioObjectPropertyName:
-        case kAudioObjectPropertyManufacturer:
-        case kAudioDevicePropertyDeviceUID:
-        case kAudioDevicePropertyModelUID:
-        case kAudioDevicePropertyTransportType:
-        case kAudioDevicePropertyRelatedDevices:
-        case kAudioDevicePropertyClockDomain:
-        case kAudioDevicePropertyDeviceIsAlive:
-        case kAudioDevicePropertyDeviceIsRunning:
-        case kAudioDevicePropertyDeviceCanBeDefaultDevice:
-        case kAudioDevicePropertyDeviceCanBeDefaultSystemDevice:
-        case kAudioDevicePropertyLatency:
-        case kAudioDevicePropertyStreams:
-        case kAudioObjectPropertyControlList:
-        case kAudioDevicePropertySafetyOffset:
-        case kAudioDevicePropertyNominalSampleRate:
-        case kAudioDevicePropertyAvailableNominalSampleRates:
-        case kAudioDevicePropertyIsHidden:
-        case kAudioDevicePropertyZeroTimeStampPeriod:
-            theAnswer = false;
-            break;
-            
-        default:
-            theAnswer = BGM_Object::IsPropertySettable(inObjectID, inClientPID, inAddress);
-            break;
-    };
-
-    return theAnswer;
+    return (theProperty != nullptr) ?
+            theProperty->IsSettable() :
+            BGM_Object::IsPropertySettable(inObjectID, inClientPID, inAddress);
 }
 
 UInt32    BGM_AbstractDevice::GetPropertyDataSize(AudioObjectID inObjectID,
@@ -128,96 +109,15 @@ UInt32    BGM_AbstractDevice::GetPropertyDataSize(AudioObjectID inObjectID,
                                                   UInt32 inQualifierDataSize,
                                                   const void* __nullable inQualifierData) const
 {
-    UInt32 theAnswer = 0;
-
-    switch(inAddress.mSelector)
-    {
-        case kAudioObjectPropertyName:
-            theAnswer = sizeof(CFStringRef);
-            break;
-
-        case kAudioObjectPropertyManufacturer:
-            theAnswer = sizeof(CFStringRef);
-            break;
-
-        case kAudioDevicePropertyDeviceUID:
-            theAnswer = sizeof(CFStringRef);
-            break;
-
-        case kAudioDevicePropertyModelUID:
-            theAnswer = sizeof(CFStringRef);
-            break;
-
-        case kAudioDevicePropertyTransportType:
-            theAnswer = sizeof(UInt32);
-            break;
-
-        case kAudioDevicePropertyRelatedDevices:
-            theAnswer = sizeof(AudioObjectID);
-            break;
-
-        case kAudioDevicePropertyClockDomain:
-            theAnswer = sizeof(UInt32);
-            break;
-
-        case kAudioDevicePropertyDeviceCanBeDefaultDevice:
-            theAnswer = sizeof(UInt32);
-            break;
-
-        case kAudioDevicePropertyDeviceCanBeDefaultSystemDevice:
-            theAnswer = sizeof(UInt32);
-            break;
-
-        case kAudioDevicePropertyDeviceIsAlive:
-            theAnswer = sizeof(AudioClassID);
-            break;
-
-        case kAudioDevicePropertyDeviceIsRunning:
-            theAnswer = sizeof(UInt32);
-            break;
-
-        case kAudioDevicePropertyLatency:
-            theAnswer = sizeof(UInt32);
-            break;
-
-        case kAudioDevicePropertyStreams:
-            theAnswer = 0;
-            break;
-
-        case kAudioObjectPropertyControlList:
-            theAnswer = 0;
-            break;
-
-        case kAudioDevicePropertySafetyOffset:
-            theAnswer = sizeof(UInt32);
-            break;
-
-        case kAudioDevicePropertyNominalSampleRate:
-            theAnswer = sizeof(Float64);
-            break;
-
-        case kAudioDevicePropertyAvailableNominalSampleRates:
-            theAnswer = 0;
-            break;
-
-        case kAudioDevicePropertyIsHidden:
-            theAnswer = sizeof(UInt32);
-            break;
-
-        case kAudioDevicePropertyZeroTimeStampPeriod:
-            theAnswer = sizeof(UInt32);
-            break;
-            
-        default:
-            theAnswer = BGM_Object::GetPropertyDataSize(inObjectID,
-                                                        inClientPID,
-                                                        inAddress,
-                                                        inQualifierDataSize,
-                                                        inQualifierData);
-            break;
-    };
-
-    return theAnswer;
+    auto theProperty = GetPropertyTable().Find(inAddress.mSelector);
+
+    return (theProperty != nullptr) ?
+            theProperty->GetDataSize(*this, inAddress) :
+            BGM_Object::GetPropertyDataSize(inObjectID,
+                                            inClientPID,
+                                            inAddress,
+                                            inQualifierDataSize,
+                                            inQualifierData);
 }
 
 void    BGM_AbstractDevice::GetPropertyData(AudioObjectID inObjectID,
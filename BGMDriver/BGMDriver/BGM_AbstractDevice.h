@@ -26,6 +26,9 @@
 // SuperClass Includes
 #include "BGM_Object.h"
 
+// Local Includes
+#include "BGM_PropertyTable.h"
+
 
 #pragma clang assume_nonnull begin
 
@@ -64,6 +67,9 @@ public:
                                                 UInt32& outDataSize,
                                                 void* outData) const;
 
+private:
+    static const BGM_PropertyTable<BGM_AbstractDevice>& GetPropertyTable();
+
 #pragma mark IO Operations
 
 public:
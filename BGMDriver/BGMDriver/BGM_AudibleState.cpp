@@ -24,6 +24,9 @@
 // Self Include
 #include "BGM_AudibleState.h"
 
+// Local Includes
+#include "BGM_IOKernels.h"
+
 // PublicUtility Includes
 #include "CADebugMacros.h"
 #pragma clang diagnostic push
@@ -41,6 +44,7 @@ static const Float32 kSampleVolumeMarginRaw = 0.0001f;
 BGM_AudibleState::BGM_AudibleState()
 :
     mState(kBGMDeviceIsSilent),
+    mLastBufferWasSilent(false),
     mSampleTimes({0, 0, 0, 0})
 {
 }
@@ -54,6 +58,7 @@ BGMDeviceAudibleState   BGM_AudibleState::GetState() const noexcept
 void    BGM_AudibleState::Reset() noexcept
 {
     mState = kBGMDeviceIsSilent;
+    mLastBufferWasSilent = false;
 
     mSampleTimes.latestSilent = 0;
     mSampleTimes.latestAudibleNonMusic = 0;
@@ -63,6 +68,7 @@ void    BGM_AudibleState::Reset() noexcept
 
 void    BGM_AudibleState::UpdateWithClientIO(bool inClientIsMusicPlayer,
                                              UInt32 inIOBufferFrameSize,
+                                             UInt32 inChannelCount,
                                              Float64 inOutputSampleTime,
                                              const Float32* inBuffer)
 {
@@ -71,9 +77,11 @@ void    BGM_AudibleState::UpdateWithClientIO(bool inClientIsMusicPlayer,
 
     Float64 endFrameSampleTime = inOutputSampleTime + inIOBufferFrameSize - 1;
 
+    mLastBufferWasSilent = false;
+
     if(inClientIsMusicPlayer)
     {
-        if(BufferIsAudible(inIOBufferFrameSize, inBuffer))
+        if(BufferIsAudible(inIOBufferFrameSize, inChannelCount, inBuffer))
         {
             mSampleTimes.latestAudibleMusic = std::max(mSampleTimes.latestAudibleMusic,
                                                        endFrameSampleTime);
@@ -87,7 +95,7 @@ void    BGM_AudibleState::UpdateWithClientIO(bool inClientIsMusicPlayer,
     else if(endFrameSampleTime > mSampleTimes.latestAudibleNonMusic &&  // Don't bother checking the
                                                                         // buffer if it won't change
                                                                         // anything.
-            BufferIsAudible(inIOBufferFrameSize, inBuffer))
+            BufferIsAudible(inIOBufferFrameSize, inChannelCount, inBuffer))
     {
         mSampleTimes.latestAudibleNonMusic = std::max(mSampleTimes.latestAudibleNonMusic,
                                                       endFrameSampleTime);
@@ -95,13 +103,14 @@ void    BGM_AudibleState::UpdateWithClientIO(bool inClientIsMusicPlayer,
 }
 
 bool    BGM_AudibleState::UpdateWithMixedIO(UInt32 inIOBufferFrameSize,
+                                            UInt32 inChannelCount,
                                             Float64 inOutputSampleTime,
                                             const Float32* inBuffer)
 {
     // Update the sample time of the most recent silent sample we've received. (The music player
     // client is not considered separate for the latest silent sample.)
 
-    bool audible = BufferIsAudible(inIOBufferFrameSize, inBuffer);
+    bool audible = BufferIsAudible(inIOBufferFrameSize, inChannelCount, inBuffer);
 
     // The sample time of the last frame we're looking at.
     Float64 endFrameSampleTime = inOutputSampleTime + inIOBufferFrameSize - 1;
@@ -169,8 +178,9 @@ bool    BGM_AudibleState::RecalculateState(Float64 inEndFrameSampleTime)
     return didChangeState;
 }
 
-// static
-bool    BGM_AudibleState::BufferIsAudible(UInt32 inIOBufferFrameSize, const Float32* inBuffer)
+bool    BGM_AudibleState::BufferIsAudible(UInt32 inIOBufferFrameSize,
+                                          UInt32 inChannelCount,
+                                          const Float32* inBuffer) noexcept
 {
     // Check each frame to see if any are audible. This could be much more accurate, but seems to
     // work well enough for now.
@@ -184,29 +194,16 @@ bool    BGM_AudibleState::BufferIsAudible(UInt32 inIOBufferFrameSize, const Floa
     // A fairly long period of silence before unpausing the music player isn't a big problem, which
     // means BGMApp can wait much longer before unpausing than before pausing. So this function errs
     // toward considering the buffer silent, which helps BGMApp ignore short sounds.
-    if(inIOBufferFrameSize > 0)
-    {
-        // Bounds for the left channel samples.
-        Float32 firstSampleLLower = inBuffer[0] - kSampleVolumeMarginRaw;
-        Float32 firstSampleLUpper = inBuffer[0] + kSampleVolumeMarginRaw;
-        // Bounds for the right channel samples.
-        Float32 firstSampleRLower = inBuffer[1] - kSampleVolumeMarginRaw;
-        Float32 firstSampleRUpper = inBuffer[1] + kSampleVolumeMarginRaw;
-
-        for(UInt32 i = 0; i < inIOBufferFrameSize * 2; i += 2)
-        {
-            bool audibleL =
-                    (inBuffer[i] < firstSampleLLower) || (inBuffer[i] > firstSampleLUpper);
-            bool audibleR =
-                    (inBuffer[i + 1] < firstSampleRLower) || (inBuffer[i + 1] > firstSampleRUpper);
-
-            if(audibleL || audibleR)
-            {
-                return true;
-            }
-        }
-    }
+    //
+    // The same scan finds buffers that are entirely 0, which idle clients send, for
+    // LastBufferWasSilent.
+    BGM_IOKernels::Audibility theAudibility = BGM_IOKernels::GetAudibility(inBuffer,
+                                                                           inIOBufferFrameSize,
+                                                                           inChannelCount,
+                                                                           kSampleVolumeMarginRaw);
+
+    mLastBufferWasSilent = (theAudibility == BGM_IOKernels::Audibility::Silent);
 
-    return false;
+    return theAudibility == BGM_IOKernels::Audibility::Audible;
 }
 
@@ -64,6 +64,7 @@ public:
      */
     void                        UpdateWithClientIO(bool inClientIsMusicPlayer,
                                                    UInt32 inIOBufferFrameSize,
+                                                   UInt32 inChannelCount,
                                                    Float64 inOutputSampleTime,
                                                    const Float32* inBuffer);
     /*!
@@ -75,17 +76,42 @@ public:
      @return True if the audible state changed.
      */
     bool                        UpdateWithMixedIO(UInt32 inIOBufferFrameSize,
+                                                  UInt32 inChannelCount,
                                                   Float64 inOutputSampleTime,
                                                   const Float32* inBuffer);
 
+    /*!
+     @return The sample time of the latest audible frame read by UpdateWithClientIO from a client
+             other than the music player, or 0 if there hasn't been one since the last Reset. Unlike
+             GetState, this is updated immediately.
+
+     Real-time safe. Not thread safe.
+     */
+    Float64                     GetLatestAudibleNonMusicSampleTime() const noexcept
+                                    { return mSampleTimes.latestAudibleNonMusic; }
+
+    /*!
+     @return True if every sample in the buffer given to the last call to UpdateWithClientIO or
+             UpdateWithMixedIO was 0, i.e. the buffer was digitally silent, so BGM_Device can skip
+             processing that wouldn't change it. False if the buffer wasn't checked, which
+             UpdateWithClientIO skips when it wouldn't change the audible state.
+
+     Real-time safe. Not thread safe.
+     */
+    bool                        LastBufferWasSilent() const noexcept
+                                    { return mLastBufferWasSilent; }
+
 private:
     bool                        RecalculateState(Float64 inEndFrameSampleTime);
 
-    static bool                 BufferIsAudible(UInt32 inIOBufferFrameSize,
-                                                const Float32* inBuffer);
+    // Also sets mLastBufferWasSilent.
+    bool                        BufferIsAudible(UInt32 inIOBufferFrameSize,
+                                                UInt32 inChannelCount,
+                                                const Float32* inBuffer) noexcept;
 
 private:
     BGMDeviceAudibleState       mState;
+    bool                        mLastBufferWasSilent;
 
     struct
     {
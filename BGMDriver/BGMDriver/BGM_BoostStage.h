@@ -0,0 +1,129 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_BoostStage.h
+//  BGMDriver
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  Decides when BGM_Device's system-wide volume boost stage runs. At 0 dB the stage is disabled,
+//  so the device doesn't ask to do kAudioServerPlugInIOOperationProcessMix, the mix limiter stays
+//  off (unless the user has turned it on) and the device's latency doesn't include its lookahead.
+//  Above 0 dB the stage is enabled and the mix limiter is required, since the boost can push the
+//  mix past full scale.
+//
+//  The host only asks whether the device will do ProcessMix when IO starts, so the stage is only
+//  enabled or disabled in a config change, while IO is stopped.
+//
+
+#ifndef BGMDriver__BGM_BoostStage
+#define BGMDriver__BGM_BoostStage
+
+// Local Includes
+#include "BGM_Limiter.h"
+
+// STL Includes
+#include <atomic>
+
+// System Includes
+#include <MacTypes.h>
+
+
+#pragma clang assume_nonnull begin
+
+class BGM_BoostStage
+{
+
+public:
+    explicit                    BGM_BoostStage(BGM_Limiters& inLimiters)
+                                :
+                                    mLimiters(inLimiters)
+                                {
+                                }
+                                BGM_BoostStage(const BGM_BoostStage&) = delete;
+                                BGM_BoostStage& operator=(const BGM_BoostStage&) = delete;
+
+    /*! @return True if the stage has to be enabled to apply a boost of inBoostDb. */
+    static bool                 IsNeeded(Float32 inBoostDb) { return inBoostDb > 0.0f; }
+
+    bool                        IsEnabled() const { return mEnabled.load(); }
+
+    /*!
+     @return True if the stage has to be enabled or disabled, with a config change, for a boost of
+             inBoostDb. Can be called from any thread.
+     */
+    bool                        NeedsUpdate(Float32 inBoostDb) const
+                                {
+                                    return IsNeeded(inBoostDb) != IsEnabled();
+                                }
+
+    /*!
+     Enable the stage, and require the mix limiter, if inBoostDb is above 0 dB, or disable it
+     otherwise. Should only be called while IO is stopped.
+
+     @return True if the stage was disabled and is now enabled, in which case the boost's gain
+             ramp should start from unity gain.
+     */
+    bool                        Update(Float32 inBoostDb)
+                                {
+                                    bool theWasEnabled = IsEnabled();
+                                    mEnabled.store(IsNeeded(inBoostDb));
+                                    mLimiters.SetMixRequired(IsEnabled());
+                                    return IsEnabled() && !theWasEnabled;
+                                }
+
+    /*!
+     @param inVolumeWillApplyToAudio True if the device applies its own volume control's volume in
+                                     ProcessMix, like the UI sounds instance does.
+     @return True if the device should do kAudioServerPlugInIOOperationProcessMix.
+     */
+    bool                        WillDoProcessMix(bool inVolumeWillApplyToAudio) const
+                                {
+                                    return inVolumeWillApplyToAudio || IsEnabled();
+                                }
+
+    /*!
+     @return How long to wait after the boost is set to 0 dB before disabling the stage, in
+             nanoseconds. The stage keeps running until then, so the boost's gain can finish
+             ramping down to unity and the mix doesn't jump from its boosted level when IO
+             restarts.
+     */
+    static UInt64               GetDisableDelayNs(UInt32 inRampLengthFrames, Float64 inSampleRate)
+                                {
+                                    if(inSampleRate <= 0.0)
+                                    {
+                                        return 0;
+                                    }
+
+                                    // The ramp starts in the first IO cycle after the change, so
+                                    // allow for the largest IO buffer as well.
+                                    Float64 theFrames = inRampLengthFrames + kMaxIOBufferFrameSize;
+                                    return static_cast<UInt64>(theFrames / inSampleRate * 1e9);
+                                }
+
+private:
+    // The largest IO buffer the HAL lets clients set.
+    static const UInt32         kMaxIOBufferFrameSize = 4096;
+
+    BGM_Limiters&               mLimiters;
+    std::atomic<bool>           mEnabled { false };
+
+};
+
+#pragma clang assume_nonnull end
+
+#endif /* BGMDriver__BGM_BoostStage */
+
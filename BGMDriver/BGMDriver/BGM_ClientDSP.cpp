@@ -0,0 +1,770 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_ClientDSP.cpp
+//  BGMDriver
+//
+//  Copyright © 2026 Kyle Neideck
+//
+
+// Self Include
+#include "BGM_ClientDSP.h"
+
+// PublicUtility Includes
+#include "CAException.h"
+#include "CADebugMacros.h"
+
+// STL Includes
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+
+#pragma clang assume_nonnull begin
+
+// 20 * log10(2). Converts log2 of a level to dB, so the compressor can use log2f and exp2f.
+static const Float32 kDbPerLog2 = 6.0205999f;
+
+// Filter state smaller than this is flushed to zero at the end of each buffer, so the filters
+// don't end up working with subnormal numbers after the audio goes silent.
+static const Float32 kStateFlushThreshold = 1.0e-15f;
+
+// Once the compressor's gain reduction gets this small while it's releasing, it's snapped to 0 dB
+// so the compressor can go idle.
+static const Float32 kGainReductionSnapDb = 0.001f;
+
+// Clamps inValue to [inMin, inMax]. NaNs are replaced with inMin.
+static inline Float32 Clamp(Float32 inValue, Float32 inMin, Float32 inMax)
+{
+    return (inValue >= inMin) ? std::min(inValue, inMax) : inMin;
+}
+
+// The fraction of the distance to the target left after one frame of a one-pole smoother with
+// the given time constant.
+static inline Float32 SmoothingCoefficient(Float32 inTimeMs, Float64 inSampleRate)
+{
+    const Float64 theFrames = inTimeMs / 1000.0 * inSampleRate;
+    return (theFrames > 1.0) ? static_cast<Float32>(exp(-1.0 / theFrames)) : 0.0f;
+}
+
+#pragma mark Settings
+
+// static
+BGM_DSPChain::Band BGM_DSPChain::GetDefaultBand()
+{
+    Band theBand;
+    theBand.mType = kBGMAppDSPBandType_Peak;
+    theBand.mFrequencyHz = 1000.0f;
+    theBand.mGainDb = 0.0f;
+    theBand.mQ = 0.7071f;
+    return theBand;
+}
+
+// static
+BGM_DSPChain::Compressor BGM_DSPChain::GetDefaultCompressor()
+{
+    Compressor theCompressor;
+    theCompressor.mEnabled = false;
+    theCompressor.mThresholdDb = -18.0f;
+    theCompressor.mRatio = 3.0f;
+    theCompressor.mKneeDb = 6.0f;
+    theCompressor.mAttackMs = 10.0f;
+    theCompressor.mReleaseMs = 150.0f;
+    theCompressor.mMakeupDb = 0.0f;
+    return theCompressor;
+}
+
+// static
+BGM_DSPChain::Settings BGM_DSPChain::GetDefaultSettings()
+{
+    Settings theSettings;
+    theSettings.mBandCount = 0;
+    std::fill(theSettings.mBands, theSettings.mBands + kMaxBands, GetDefaultBand());
+    theSettings.mCompressor = GetDefaultCompressor();
+    return theSettings;
+}
+
+// static
+BGM_DSPChain::Settings BGM_DSPChain::ClampSettings(const Settings& inSettings)
+{
+    Settings theSettings = inSettings;
+
+    theSettings.mBandCount = std::min(inSettings.mBandCount, kMaxBands);
+
+    for(UInt32 i = 0; i < theSettings.mBandCount; i++)
+    {
+        Band& theBand = theSettings.mBands[i];
+
+        if((theBand.mType < kBGMAppDSPBandType_LowCut) || (theBand.mType > kBGMAppDSPBandType_Peak))
+        {
+            theBand.mType = kBGMAppDSPBandType_Peak;
+        }
+
+        theBand.mFrequencyHz = Clamp(theBand.mFrequencyHz, 10.0f, 20000.0f);
+        theBand.mGainDb = Clamp(theBand.mGainDb, -24.0f, 24.0f);
+        theBand.mQ = Clamp(theBand.mQ, 0.1f, 18.0f);
+    }
+
+    Compressor& theCompressor = theSettings.mCompressor;
+    theCompressor.mThresholdDb = Clamp(theCompressor.mThresholdDb, -60.0f, 0.0f);
+    theCompressor.mRatio = Clamp(theCompressor.mRatio, 1.0f, 20.0f);
+    theCompressor.mKneeDb = Clamp(theCompressor.mKneeDb, 0.0f, 24.0f);
+    theCompressor.mAttackMs = Clamp(theCompressor.mAttackMs, 0.0f, 5000.0f);
+    theCompressor.mReleaseMs = Clamp(theCompressor.mReleaseMs, 0.0f, 5000.0f);
+    theCompressor.mMakeupDb = Clamp(theCompressor.mMakeupDb, 0.0f, 24.0f);
+
+    return theSettings;
+}
+
+// static
+bool    BGM_DSPChain::IsBypassed(const Settings& inSettings)
+{
+    return (inSettings.mBandCount == 0) && !inSettings.mCompressor.mEnabled;
+}
+
+#pragma mark Construction/Reset
+
+BGM_DSPChain::BGM_DSPChain()
+:
+    mChannelCount(2)
+{
+    SetSettings(GetDefaultSettings(), 44100.0);
+    Reset();
+}
+
+void    BGM_DSPChain::Reset()
+{
+    memset(mBandState, 0, sizeof(mBandState));
+    mGainReductionDb = 0.0f;
+}
+
+void    BGM_DSPChain::SetSettings(const Settings& inSettings, Float64 inSampleRate)
+{
+    for(UInt32 i = 0; i < inSettings.mBandCount; i++)
+    {
+        // Keep the state of the bands that are the same type, since they're most likely the same
+        // filter with a different frequency or gain.
+        if((i >= mBandCount) || (mBandTypes[i] != inSettings.mBands[i].mType))
+        {
+            memset(mBandState[i], 0, sizeof(mBandState[i]));
+        }
+
+        mBandTypes[i] = inSettings.mBands[i].mType;
+        mCoefficients[i] = CalculateCoefficients(inSettings.mBands[i], inSampleRate);
+    }
+
+    mBandCount = inSettings.mBandCount;
+
+    const Compressor& theCompressor = inSettings.mCompressor;
+
+    if(!theCompressor.mEnabled)
+    {
+        mGainReductionDb = 0.0f;
+    }
+
+    mCompressorEnabled = theCompressor.mEnabled;
+    mThresholdDb = theCompressor.mThresholdDb;
+    mKneeDb = theCompressor.mKneeDb;
+    mSlope = 1.0f - 1.0f / theCompressor.mRatio;
+    mAttackCoefficient = SmoothingCoefficient(theCompressor.mAttackMs, inSampleRate);
+    mReleaseCoefficient = SmoothingCoefficient(theCompressor.mReleaseMs, inSampleRate);
+    mMakeupDb = theCompressor.mMakeupDb;
+    mMakeupGain = exp2f(mMakeupDb / kDbPerLog2);
+}
+
+// static
+BGM_DSPChain::Coefficients BGM_DSPChain::CalculateCoefficients(const Band& inBand,
+                                                              Float64 inSampleRate)
+{
+    // These are the filters from Robert Bristow-Johnson's "Cookbook formulae for audio EQ biquad
+    // filter coefficients".
+    const Float64 theFrequencyHz = std::min(static_cast<Float64>(inBand.mFrequencyHz),
+                                            0.49 * inSampleRate);
+    const Float64 theW0 = 2.0 * M_PI * theFrequencyHz / inSampleRate;
+    const Float64 theCosW0 = cos(theW0);
+    const Float64 theAlpha = sin(theW0) / (2.0 * inBand.mQ);
+    const Float64 theA = pow(10.0, inBand.mGainDb / 40.0);
+    const Float64 theShelfTerm = 2.0 * sqrt(theA) * theAlpha;
+
+    Float64 b0, b1, b2, a0, a1, a2;
+
+    switch(inBand.mType)
+    {
+        case kBGMAppDSPBandType_LowCut:
+            b0 = (1.0 + theCosW0) / 2.0;
+            b1 = -(1.0 + theCosW0);
+            b2 = b0;
+            a0 = 1.0 + theAlpha;
+            a1 = -2.0 * theCosW0;
+            a2 = 1.0 - theAlpha;
+            break;
+
+        case kBGMAppDSPBandType_HighCut:
+            b0 = (1.0 - theCosW0) / 2.0;
+            b1 = 1.0 - theCosW0;
+            b2 = b0;
+            a0 = 1.0 + theAlpha;
+            a1 = -2.0 * theCosW0;
+            a2 = 1.0 - theAlpha;
+            break;
+
+        case kBGMAppDSPBandType_LowShelf:
+            b0 = theA * ((theA + 1.0) - (theA - 1.0) * theCosW0 + theShelfTerm);
+            b1 = 2.0 * theA * ((theA - 1.0) - (theA + 1.0) * theCosW0);
+            b2 = theA * ((theA + 1.0) - (theA - 1.0) * theCosW0 - theShelfTerm);
+            a0 = (theA + 1.0) + (theA - 1.0) * theCosW0 + theShelfTerm;
+            a1 = -2.0 * ((theA - 1.0) + (theA + 1.0) * theCosW0);
+            a2 = (theA + 1.0) + (theA - 1.0) * theCosW0 - theShelfTerm;
+            break;
+
+        case kBGMAppDSPBandType_HighShelf:
+            b0 = theA * ((theA + 1.0) + (theA - 1.0) * theCosW0 + theShelfTerm);
+            b1 = -2.0 * theA * ((theA - 1.0) + (theA + 1.0) * theCosW0);
+            b2 = theA * ((theA + 1.0) + (theA - 1.0) * theCosW0 - theShelfTerm);
+            a0 = (theA + 1.0) - (theA - 1.0) * theCosW0 + theShelfTerm;
+            a1 = 2.0 * ((theA - 1.0) - (theA + 1.0) * theCosW0);
+            a2 = (theA + 1.0) - (theA - 1.0) * theCosW0 - theShelfTerm;
+            break;
+
+        case kBGMAppDSPBandType_Peak:
+        default:
+            b0 = 1.0 + theAlpha * theA;
+            b1 = -2.0 * theCosW0;
+            b2 = 1.0 - theAlpha * theA;
+            a0 = 1.0 + theAlpha / theA;
+            a1 = -2.0 * theCosW0;
+            a2 = 1.0 - theAlpha / theA;
+            break;
+    }
+
+    // Normalise so a0 is 1.
+    Coefficients theCoefficients;
+    theCoefficients.mB0 = static_cast<Float32>(b0 / a0);
+    theCoefficients.mB1 = static_cast<Float32>(b1 / a0);
+    theCoefficients.mB2 = static_cast<Float32>(b2 / a0);
+    theCoefficients.mA1 = static_cast<Float32>(a1 / a0);
+    theCoefficients.mA2 = static_cast<Float32>(a2 / a0);
+    return theCoefficients;
+}
+
+#pragma mark Processing
+
+void    BGM_DSPChain::ProcessRT(Float32* ioBuffer,
+                                UInt32 inFrameCount,
+                                UInt32 inChannelCount,
+                                bool inBufferIsSilent)
+{
+    if((inChannelCount == 0) || (inChannelCount > BGM_IOKernels::kMaxChannelCount))
+    {
+        return;
+    }
+
+    // The filters' state would belong to the wrong channels.
+    if(inChannelCount != mChannelCount)
+    {
+        mChannelCount = inChannelCount;
+        Reset();
+    }
+
+    // With no state in the filters, each band's output for silence is silence, and the compressor
+    // only applies its makeup gain to it. So an idle client's buffers can be skipped entirely. The
+    // state is flushed to exactly 0 once a band's tail has died away, so this is exact.
+    if(inBufferIsSilent && IsAtRest())
+    {
+        return;
+    }
+
+    for(UInt32 i = 0; i < mBandCount; i++)
+    {
+        ProcessBand(i, ioBuffer, inFrameCount);
+    }
+
+    if(mCompressorEnabled)
+    {
+        ProcessCompressor(ioBuffer, inFrameCount);
+    }
+}
+
+bool    BGM_DSPChain::IsAtRest() const
+{
+    if(mGainReductionDb != 0.0f)
+    {
+        return false;
+    }
+
+    for(UInt32 i = 0; i < mBandCount; i++)
+    {
+        for(UInt32 j = 0; j < mChannelCount; j++)
+        {
+            if((mBandState[i][j] != 0.0f) ||
+               (mBandState[i][BGM_IOKernels::kMaxChannelCount + j] != 0.0f))
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+template <UInt32 kChannels>
+struct BGM_DSPChain::BandKernel
+{
+    static void Run(UInt32 inChannelCount,
+                    Float32* ioBuffer,
+                    UInt32 inFrameCount,
+                    const Coefficients* inCoefficients,
+                    Float32* ioState)
+    {
+        const UInt32 theChannels = (kChannels != 0) ? kChannels : inChannelCount;
+        const UInt32 kZ2 = BGM_IOKernels::kMaxChannelCount;
+
+        // Copy everything into locals so the compiler can keep it all in registers.
+        const Float32 b0 = inCoefficients->mB0;
+        const Float32 b1 = inCoefficients->mB1;
+        const Float32 b2 = inCoefficients->mB2;
+        const Float32 a1 = inCoefficients->mA1;
+        const Float32 a2 = inCoefficients->mA2;
+
+        Float32 theZ1[BGM_IOKernels::kMaxChannelCount];
+        Float32 theZ2[BGM_IOKernels::kMaxChannelCount];
+
+        for(UInt32 i = 0; i < theChannels; i++)
+        {
+            theZ1[i] = ioState[i];
+            theZ2[i] = ioState[kZ2 + i];
+        }
+
+        for(UInt32 theFrame = 0; theFrame < inFrameCount; theFrame++)
+        {
+            Float32* theSamples = ioBuffer + theFrame * theChannels;
+
+            // The channels are independent, so each line below can be one SIMD instruction.
+            for(UInt32 i = 0; i < theChannels; i++)
+            {
+                const Float32 theIn = theSamples[i];
+                const Float32 theOut = b0 * theIn + theZ1[i];
+
+                theZ1[i] = b1 * theIn - a1 * theOut + theZ2[i];
+                theZ2[i] = b2 * theIn - a2 * theOut;
+
+                theSamples[i] = theOut;
+            }
+        }
+
+        for(UInt32 i = 0; i < theChannels; i++)
+        {
+            ioState[i] = (fabsf(theZ1[i]) < kStateFlushThreshold) ? 0.0f : theZ1[i];
+            ioState[kZ2 + i] = (fabsf(theZ2[i]) < kStateFlushThreshold) ? 0.0f : theZ2[i];
+        }
+    }
+};
+
+void    BGM_DSPChain::ProcessBand(UInt32 inBandIndex, Float32* ioBuffer, UInt32 inFrameCount)
+{
+    BGM_IOKernels::DispatchOnChannelCount<BandKernel>(mChannelCount,
+                                                      ioBuffer,
+                                                      inFrameCount,
+                                                      &mCoefficients[inBandIndex],
+                                                      mBandState[inBandIndex]);
+}
+
+void    BGM_DSPChain::ProcessCompressor(Float32* ioBuffer, UInt32 inFrameCount)
+{
+    // The level where the knee starts. Frames below it don't need any gain reduction.
+    const Float32 theKneeStartLevel = exp2f((mThresholdDb - mKneeDb / 2.0f) / kDbPerLog2);
+
+    const UInt32 theChannels = mChannelCount;
+
+    for(UInt32 theOffset = 0; theOffset < inFrameCount; theOffset += kChunkFrames)
+    {
+        Float32* theChunk = ioBuffer + theOffset * theChannels;
+        const UInt32 theChunkFrames = std::min(kChunkFrames, inFrameCount - theOffset);
+
+        if(mGainReductionDb == 0.0f)
+        {
+            // mGains is overwritten below, so it can hold the frames' peaks for now.
+            const Float32 theChunkPeak =
+                    BGM_IOKernels::GetFramePeaks(theChunk, theChunkFrames, theChannels, mGains);
+
+            if(theChunkPeak <= theKneeStartLevel)
+            {
+                // Nothing to compress, so only the makeup gain needs to be applied.
+                if(mMakeupGain != 1.0f)
+                {
+                    BGM_IOKernels::ApplyGain(theChunk, theChunkFrames, theChannels, mMakeupGain);
+                }
+
+                continue;
+            }
+        }
+
+        Float32 theGainReductionDb = mGainReductionDb;
+
+        for(UInt32 theFrame = 0; theFrame < theChunkFrames; theFrame++)
+        {
+            // The level of the frame is its loudest channel's.
+            const Float32* theSamples = theChunk + theFrame * theChannels;
+            Float32 theLevel = fabsf(theSamples[0]);
+
+            for(UInt32 i = 1; i < theChannels; i++)
+            {
+                theLevel = std::max(theLevel, fabsf(theSamples[i]));
+            }
+
+            Float32 theTargetDb = 0.0f;
+
+            if(theLevel > theKneeStartLevel)
+            {
+                const Float32 theOverDb = kDbPerLog2 * log2f(theLevel) - mThresholdDb;
+
+                if(2.0f * theOverDb >= mKneeDb)
+                {
+                    theTargetDb = mSlope * theOverDb;
+                }
+                else
+                {
+                    // Inside the knee. (The knee can't be 0 here.)
+                    const Float32 theIntoKneeDb = theOverDb + mKneeDb / 2.0f;
+                    theTargetDb = mSlope * theIntoKneeDb * theIntoKneeDb / (2.0f * mKneeDb);
+                }
+            }
+
+            const Float32 theCoefficient =
+                    (theTargetDb > theGainReductionDb) ? mAttackCoefficient : mReleaseCoefficient;
+            theGainReductionDb = theTargetDb + theCoefficient * (theGainReductionDb - theTargetDb);
+
+            if((theTargetDb == 0.0f) && (theGainReductionDb < kGainReductionSnapDb))
+            {
+                theGainReductionDb = 0.0f;
+            }
+
+            mGains[theFrame] = exp2f((mMakeupDb - theGainReductionDb) / kDbPerLog2);
+        }
+
+        mGainReductionDb = theGainReductionDb;
+
+        BGM_IOKernels::ApplyFrameGains(theChunk, theChunkFrames, theChannels, mGains, false);
+    }
+}
+
+#pragma mark BGM_ClientDSP
+
+BGM_ClientDSP::BGM_ClientDSP()
+:
+    mAppCount(0),
+    mUseCounter(0)
+{
+    const BGM_DSPChain::Settings theDefaultSettings = BGM_DSPChain::GetDefaultSettings();
+
+    for(Slot& theSlot : mSlots)
+    {
+        theSlot.mInUse = false;
+        theSlot.mProcessID = -1;
+        theSlot.mSettings = theDefaultSettings;
+        theSlot.mGeneration = 0;
+        theSlot.mWritingGeneration = 0;
+        theSlot.mBuffers[0] = theDefaultSettings;
+        theSlot.mBuffers[1] = theDefaultSettings;
+    }
+
+    for(Entry& theEntry : mEntries)
+    {
+        theEntry.mInUse = false;
+        theEntry.mClientID = 0;
+        theEntry.mLastUsed = 0;
+        theEntry.mSlot = -1;
+        theEntry.mGeneration = 0;
+        theEntry.mHasSettings = false;
+        theEntry.mSampleRate = 0.0;
+        theEntry.mSettings = theDefaultSettings;
+    }
+}
+
+SInt32  BGM_ClientDSP::SetAppSettings(pid_t inProcessID,
+                                      const BGM_String& inBundleID,
+                                      const BGM_DSPChain::Settings& inSettings)
+{
+    ThrowIf((inProcessID == -1) && !inBundleID.IsValid(),
+            CAException(kAudioHardwareIllegalOperationError),
+            "BGM_ClientDSP::SetAppSettings: No PID or bundle ID");
+
+    CAMutex::Locker theLocker(mMutex);
+
+    SInt32 theSlotIndex = -1;
+
+    for(UInt32 i = 0; i < kMaxApps; i++)
+    {
+        if(mSlots[i].mInUse && Matches(mSlots[i], inProcessID, inBundleID))
+        {
+            theSlotIndex = static_cast<SInt32>(i);
+            break;
+        }
+    }
+
+    if(theSlotIndex == -1)
+    {
+        for(UInt32 i = 0; i < kMaxApps; i++)
+        {
+            if(!mSlots[i].mInUse)
+            {
+                theSlotIndex = static_cast<SInt32>(i);
+                mSlots[i].mInUse = true;
+                mAppCount++;
+                break;
+            }
+        }
+    }
+
+    ThrowIf(theSlotIndex == -1,
+            CAException(kAudioHardwareIllegalOperationError),
+            "BGM_ClientDSP::SetAppSettings: Too many apps");
+
+    Slot& theSlot = mSlots[theSlotIndex];
+
+    // Fill in whichever IDs we didn't have, like BGMGainStaging::SetAppVolume.
+    if(inProcessID != -1)
+    {
+        theSlot.mProcessID = inProcessID;
+    }
+
+    if(inBundleID.IsValid())
+    {
+        theSlot.mBundleID = inBundleID;
+    }
+
+    theSlot.mSettings = BGM_DSPChain::ClampSettings(inSettings);
+    WriteSlot(theSlot, theSlot.mSettings);
+
+    return theSlotIndex;
+}
+
+void    BGM_ClientDSP::RemoveApp(SInt32 inSlot)
+{
+    if((inSlot < 0) || (inSlot >= static_cast<SInt32>(kMaxApps)))
+    {
+        return;
+    }
+
+    CAMutex::Locker theLocker(mMutex);
+
+    Slot& theSlot = mSlots[inSlot];
+
+    if(theSlot.mInUse)
+    {
+        theSlot.mInUse = false;
+        theSlot.mProcessID = -1;
+        theSlot.mBundleID = BGM_String();
+        theSlot.mSettings = BGM_DSPChain::GetDefaultSettings();
+        // Publish the default settings as well, in case a client still has the slot.
+        WriteSlot(theSlot, theSlot.mSettings);
+        mAppCount--;
+    }
+}
+
+SInt32  BGM_ClientDSP::FindApp(pid_t inProcessID, const BGM_String& inBundleID) const
+{
+    CAMutex::Locker theLocker(mMutex);
+
+    for(UInt32 i = 0; i < kMaxApps; i++)
+    {
+        if(mSlots[i].mInUse && Matches(mSlots[i], inProcessID, inBundleID))
+        {
+            return static_cast<SInt32>(i);
+        }
+    }
+
+    return -1;
+}
+
+std::vector<BGM_ClientDSP::AppSettings> BGM_ClientDSP::CopyAppSettings() const
+{
+    CAMutex::Locker theLocker(mMutex);
+
+    std::vector<AppSettings> theAppSettings;
+
+    for(const Slot& theSlot : mSlots)
+    {
+        if(theSlot.mInUse)
+        {
+            theAppSettings.push_back({ theSlot.mProcessID, theSlot.mBundleID, theSlot.mSettings });
+        }
+    }
+
+    return theAppSettings;
+}
+
+BGM_ClientDSP::AppSettings BGM_ClientDSP::CopyAppSettings(SInt32 inSlot) const
+{
+    ThrowIf((inSlot < 0) || (inSlot >= static_cast<SInt32>(kMaxApps)),
+            CAException(kAudioHardwareIllegalOperationError),
+            "BGM_ClientDSP::CopyAppSettings: Slot out of range");
+
+    CAMutex::Locker theLocker(mMutex);
+
+    const Slot& theSlot = mSlots[inSlot];
+
+    ThrowIf(!theSlot.mInUse,
+            CAException(kAudioHardwareIllegalOperationError),
+            "BGM_ClientDSP::CopyAppSettings: Slot not in use");
+
+    return { theSlot.mProcessID, theSlot.mBundleID, theSlot.mSettings };
+}
+
+bool    BGM_ClientDSP::Matches(const Slot& inSlot,
+                               pid_t inProcessID,
+                               const BGM_String& inBundleID) const
+{
+    bool thePIDMatches = (inProcessID != -1) && (inSlot.mProcessID == inProcessID);
+    bool theBundleIDMatches = inBundleID.IsValid() &&
+                              inSlot.mBundleID.IsValid() &&
+                              (inSlot.mBundleID == inBundleID);
+    return thePIDMatches || theBundleIDMatches;
+}
+
+// static
+void    BGM_ClientDSP::WriteSlot(Slot& ioSlot, const BGM_DSPChain::Settings& inSettings)
+{
+    const UInt32 theGeneration = ioSlot.mGeneration.load(std::memory_order_relaxed) + 1;
+
+    // Tell the IO thread we're about to overwrite the buffer for the generation before last, in
+    // case it's still copying it.
+    ioSlot.mWritingGeneration.store(theGeneration, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    ioSlot.mBuffers[theGeneration % 2] = inSettings;
+
+    ioSlot.mGeneration.store(theGeneration, std::memory_order_release);
+}
+
+// static
+bool    BGM_ClientDSP::ReadSlotRT(const Slot& inSlot,
+                                  bool inForce,
+                                  UInt32& ioGeneration,
+                                  BGM_DSPChain::Settings& outSettings)
+{
+    const UInt32 theGeneration = inSlot.mGeneration.load(std::memory_order_acquire);
+
+    if(!inForce && (theGeneration == ioGeneration))
+    {
+        return false;
+    }
+
+    // Copy into a local first, so a torn copy never replaces the caller's settings.
+    const BGM_DSPChain::Settings theSettings = inSlot.mBuffers[theGeneration % 2];
+
+    // If the writer started on the generation after next while we were copying, it was writing
+    // to the buffer we copied.
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    if(inSlot.mWritingGeneration.load(std::memory_order_relaxed) - theGeneration >= 2)
+    {
+        return false;
+    }
+
+    outSettings = theSettings;
+    ioGeneration = theGeneration;
+    return true;
+}
+
+void    BGM_ClientDSP::Reset()
+{
+    for(Entry& theEntry : mEntries)
+    {
+        theEntry.mInUse = false;
+    }
+}
+
+void    BGM_ClientDSP::ProcessClientRT(UInt32 inClientID,
+                                       SInt32 inSlot,
+                                       Float32* ioBuffer,
+                                       UInt32 inFrameCount,
+                                       UInt32 inChannelCount,
+                                       Float64 inSampleRate,
+                                       bool inBufferIsSilent)
+{
+    if((inSlot < 0) || (inSlot >= static_cast<SInt32>(kMaxApps)))
+    {
+        return;
+    }
+
+    // Finds the client's chain the same way BGM_ClientGainRamps::NextBufferRT finds its ramp.
+    Entry* theEntry = nullptr;
+    Entry* theLeastRecentlyUsed = &mEntries[0];
+
+    for(Entry& theCandidate : mEntries)
+    {
+        if(theCandidate.mInUse && (theCandidate.mClientID == inClientID))
+        {
+            theEntry = &theCandidate;
+            break;
+        }
+
+        if(!theCandidate.mInUse ||
+           (theLeastRecentlyUsed->mInUse && (theCandidate.mLastUsed < theLeastRecentlyUsed->mLastUsed)))
+        {
+            theLeastRecentlyUsed = &theCandidate;
+        }
+    }
+
+    if(!theEntry)
+    {
+        theEntry = theLeastRecentlyUsed;
+        theEntry->mInUse = true;
+        theEntry->mClientID = inClientID;
+        theEntry->mHasSettings = false;
+    }
+
+    theEntry->mLastUsed = ++mUseCounter;
+
+    if(theEntry->mSlot != inSlot)
+    {
+        // The client's app was given a different slot, or this is a new client.
+        theEntry->mSlot = inSlot;
+        theEntry->mHasSettings = false;
+    }
+
+    if(!theEntry->mHasSettings)
+    {
+        theEntry->mChain.Reset();
+    }
+
+    if(ReadSlotRT(mSlots[inSlot],
+                  !theEntry->mHasSettings,
+                  theEntry->mGeneration,
+                  theEntry->mSettings))
+    {
+        theEntry->mHasSettings = true;
+        theEntry->mSampleRate = inSampleRate;
+        theEntry->mChain.SetSettings(theEntry->mSettings, inSampleRate);
+    }
+    else if(!theEntry->mHasSettings)
+    {
+        // The settings were being written while we copied them. Leave the audio unprocessed until
+        // the next buffer rather than use a torn copy.
+        return;
+    }
+    else if(theEntry->mSampleRate != inSampleRate)
+    {
+        theEntry->mSampleRate = inSampleRate;
+        theEntry->mChain.SetSettings(theEntry->mSettings, inSampleRate);
+    }
+
+    theEntry->mChain.ProcessRT(ioBuffer, inFrameCount, inChannelCount, inBufferIsSilent);
+}
+
+#pragma clang assume_nonnull end
+
@@ -0,0 +1,357 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_ClientDSP.h
+//  BGMDriver
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  The EQ and compressor BGM_Device can apply to each app's audio, for
+//  kAudioDeviceCustomPropertyAppDSP.
+//
+//  BGM_DSPChain is the processing for one client: a cascade of biquad filters followed by a
+//  feed-forward compressor. All of its state is allocated up front, so changing its settings and
+//  processing audio are both real-time safe.
+//
+//  The biquads are transposed direct form II, which is the form that works best with Float32
+//  samples. Each filter makes one pass over the buffer and filters all of the channels in the same
+//  iteration, so the channels' arithmetic can be done with one set of SIMD instructions. (vDSP's
+//  biquad functions would need a setup allocated for each change of coefficients.)
+//
+//  The compressor is linked across the channels and computes its gain in dB, with a soft knee. While the audio
+//  stays under the knee and the compressor isn't releasing, it only applies the makeup gain.
+//
+
+#ifndef BGMDriver__BGM_ClientDSP
+#define BGMDriver__BGM_ClientDSP
+
+// Local Includes
+#include "BGM_Types.h"
+#include "BGM_IOKernels.h"
+#include "BGM_Platform.h"
+
+// PublicUtility Includes
+#include "CAMutex.h"
+
+// STL Includes
+#include <atomic>
+#include <vector>
+
+// System Includes
+#include <MacTypes.h>
+#include <sys/types.h>
+
+
+#pragma clang assume_nonnull begin
+
+class BGM_DSPChain
+{
+
+public:
+    static const UInt32         kMaxBands = kBGMAppDSPMaxBands;
+
+    struct Band
+    {
+        // One of the kBGMAppDSPBandType values.
+        SInt32                  mType;
+        Float32                 mFrequencyHz;
+        // Ignored by the cut filters.
+        Float32                 mGainDb;
+        Float32                 mQ;
+    };
+
+    struct Compressor
+    {
+        bool                    mEnabled;
+        Float32                 mThresholdDb;
+        Float32                 mRatio;
+        Float32                 mKneeDb;
+        Float32                 mAttackMs;
+        Float32                 mReleaseMs;
+        Float32                 mMakeupDb;
+    };
+
+    // The ranges are documented with the kAudioDeviceCustomPropertyAppDSP keys in BGM_Types.h.
+    struct Settings
+    {
+        UInt32                  mBandCount;
+        Band                    mBands[kMaxBands];
+        Compressor              mCompressor;
+    };
+
+    /*! @return A flat band: a peak filter at 1 kHz with a gain of 0 dB and a Q of 0.7071. */
+    static Band                 GetDefaultBand();
+    /*! @return A disabled compressor with a -18 dBFS threshold, 3:1 ratio, 10 ms attack, etc. */
+    static Compressor           GetDefaultCompressor();
+    /*! @return No bands and the default compressor, i.e. settings that don't change the audio. */
+    static Settings             GetDefaultSettings();
+
+    /*!
+     @return inSettings with each value clamped to its range. NaNs are replaced with the closest
+             limit and unknown band types with kBGMAppDSPBandType_Peak.
+     */
+    static Settings             ClampSettings(const Settings& inSettings);
+
+    /*! @return True if the settings have no bands and the compressor is disabled. */
+    static bool                 IsBypassed(const Settings& inSettings);
+
+public:
+                                BGM_DSPChain();
+                                BGM_DSPChain(const BGM_DSPChain&) = delete;
+                                BGM_DSPChain& operator=(const BGM_DSPChain&) = delete;
+
+    /*! Clear the filters' state and the compressor's gain reduction. Real-time safe. */
+    void                        Reset();
+
+    /*!
+     Calculate the filter coefficients, etc. for inSettings. The filters' state is kept for the
+     bands whose types haven't changed, so the audio doesn't click. Real-time safe.
+
+     @param inSettings Should already be clamped. See ClampSettings.
+     */
+    void                        SetSettings(const Settings& inSettings, Float64 inSampleRate);
+
+    /*!
+     Filter and compress the frames in ioBuffer. The chain is reset if the channel count isn't the
+     same as the last call's. Real-time safe, but not thread safe.
+
+     @param ioBuffer Interleaved.
+     @param inChannelCount From 1 to BGM_IOKernels::kMaxChannelCount.
+     @param inBufferIsSilent True if every sample in ioBuffer is 0. If the chain is at rest, the
+                             buffer is left as it is, since processing it wouldn't change it or
+                             the chain's state.
+     */
+    void                        ProcessRT(Float32* ioBuffer,
+                                          UInt32 inFrameCount,
+                                          UInt32 inChannelCount,
+                                          bool inBufferIsSilent = false);
+
+    /*!
+     @return True if the filters have no state left over from earlier audio and the compressor
+             isn't reducing the gain, i.e. the chain's output for silence would be silence.
+     */
+    bool                        IsAtRest() const;
+
+private:
+    struct Coefficients
+    {
+        Float32                 mB0;
+        Float32                 mB1;
+        Float32                 mB2;
+        Float32                 mA1;
+        Float32                 mA2;
+    };
+
+    static Coefficients         CalculateCoefficients(const Band& inBand, Float64 inSampleRate);
+
+    // Filters the frames with one band. See BGM_IOKernels::DispatchOnChannelCount.
+    template <UInt32 kChannels>
+    struct                      BandKernel;
+
+    void                        ProcessBand(UInt32 inBandIndex,
+                                            Float32* ioBuffer,
+                                            UInt32 inFrameCount);
+    void                        ProcessCompressor(Float32* ioBuffer, UInt32 inFrameCount);
+
+private:
+    // The frames are compressed in chunks so the per-frame gains fit in mGains.
+    static const UInt32         kChunkFrames = 128;
+
+    UInt32                      mBandCount;
+    SInt32                      mBandTypes[kMaxBands];
+    Coefficients                mCoefficients[kMaxBands];
+    // The filters' state: z^-1 for each channel, then z^-2 for each channel.
+    Float32                     mBandState[kMaxBands][2 * BGM_IOKernels::kMaxChannelCount];
+    UInt32                      mChannelCount;
+
+    bool                        mCompressorEnabled;
+    Float32                     mThresholdDb;
+    Float32                     mKneeDb;
+    // 1 - 1 / ratio. The fraction of the level over the threshold that's removed.
+    Float32                     mSlope;
+    // The fraction of the distance to the target gain reduction left after one frame.
+    Float32                     mAttackCoefficient;
+    Float32                     mReleaseCoefficient;
+    Float32                     mMakeupGain;
+    Float32                     mMakeupDb;
+    // The current gain reduction, in dB. Positive or 0.
+    Float32                     mGainReductionDb;
+
+    Float32                     mGains[kChunkFrames];
+
+};
+
+//==================================================================================================
+//	BGM_ClientDSP
+//
+//  The DSP settings for the apps and a BGM_DSPChain for each client of those apps.
+//
+//  Each app's settings are kept in one of kMaxApps slots. BGM_Device stores the index of an app's
+//  slot in its clients (BGM_Client::mDSPSlot), the same way it stores their relative volumes, so
+//  the IO thread only has to look the client up once. Clients with a slot of -1 don't have any
+//  DSP, which ProcessClientRT's callers should check first.
+//
+//  A slot's settings are double buffered. The writer fills the buffer the IO thread isn't reading
+//  and then publishes it by incrementing the slot's generation. The IO thread copies the settings
+//  for a generation it hasn't seen and then checks the writer didn't start overwriting them while
+//  it was copying. If it did, the IO thread keeps its current settings until the next buffer, so it
+//  never waits for the writer.
+//
+//  The clients' chains are kept the same way as BGM_ClientGainRamps. When they're all taken, the
+//  least recently used one is reset and given to the client that needs one.
+//==================================================================================================
+
+class BGM_ClientDSP
+{
+
+public:
+    static const UInt32         kMaxApps = kBGMAppDSPMaxApps;
+
+    struct AppSettings
+    {
+        // -1 if the app is only identified by its bundle ID.
+        pid_t                   mProcessID;
+        // Invalid if the app is only identified by its process ID.
+        BGM_String              mBundleID;
+        BGM_DSPChain::Settings  mSettings;
+    };
+
+public:
+                                BGM_ClientDSP();
+                                BGM_ClientDSP(const BGM_ClientDSP&) = delete;
+                                BGM_ClientDSP& operator=(const BGM_ClientDSP&) = delete;
+
+    /*!
+     Set an app's settings, replacing its current settings if it has any. Apps are matched by
+     process ID or bundle ID, like in BGM_ClientMap. Out of range settings are clamped.
+
+     Not real-time safe. Can be called from any non-real-time thread.
+
+     @param inProcessID The app's process ID, or -1 to omit it.
+     @param inBundleID The app's bundle ID. Can be invalid to omit it.
+     @return The index of the app's slot.
+     @throws CAException If all of the slots are in use or neither ID is given.
+     */
+    SInt32                      SetAppSettings(pid_t inProcessID,
+                                               const BGM_String& inBundleID,
+                                               const BGM_DSPChain::Settings& inSettings);
+
+    /*!
+     Free an app's slot. The caller should make sure no clients still use it, i.e. set their
+     BGM_Client::mDSPSlot to -1, first. Not real-time safe.
+     */
+    void                        RemoveApp(SInt32 inSlot);
+
+    /*! @return The index of the slot for the app with either ID, or -1 if it doesn't have one. */
+    SInt32                      FindApp(pid_t inProcessID, const BGM_String& inBundleID) const;
+
+    /*! @return The settings for each app that has a slot. Not real-time safe. */
+    std::vector<AppSettings>    CopyAppSettings() const;
+
+    /*!
+     @return The IDs and settings of the app in slot inSlot. Not real-time safe.
+     @throws CAException If the slot is out of range or not in use.
+     */
+    AppSettings                 CopyAppSettings(SInt32 inSlot) const;
+
+    /*!
+     @return True if any app has a slot. Real-time safe. BGM_Device checks this before looking
+             up the client's slot, so it doesn't cost anything when no apps have DSP.
+     */
+    bool                        HasAppsRT() const { return mAppCount.load() > 0; }
+
+    /*! Reset all of the chains, e.g. when IO starts. Not thread safe. */
+    void                        Reset();
+
+    /*!
+     Apply the settings in slot inSlot to a client's audio, using the client's own chain. Does
+     nothing if the slot is out of range. Real-time safe. Should only be called on the IO thread.
+
+     @param ioBuffer Interleaved, with inChannelCount channels. See BGM_DSPChain::ProcessRT.
+     @param inBufferIsSilent See BGM_DSPChain::ProcessRT.
+     */
+    void                        ProcessClientRT(UInt32 inClientID,
+                                                SInt32 inSlot,
+                                                Float32* ioBuffer,
+                                                UInt32 inFrameCount,
+                                                UInt32 inChannelCount,
+                                                Float64 inSampleRate,
+                                                bool inBufferIsSilent = false);
+
+private:
+    struct Slot
+    {
+        // Only used by the writers, with mMutex held.
+        bool                    mInUse;
+        pid_t                   mProcessID;
+        BGM_String              mBundleID;
+        BGM_DSPChain::Settings  mSettings;
+
+        // The double buffer. mBuffers[mGeneration % 2] holds the latest settings and the writer
+        // sets mWritingGeneration before it starts filling the other buffer.
+        std::atomic<UInt32>     mGeneration;
+        std::atomic<UInt32>     mWritingGeneration;
+        BGM_DSPChain::Settings  mBuffers[2];
+    };
+
+    // Publishes inSettings to the IO thread. mMutex must be held.
+    static void                 WriteSlot(Slot& ioSlot, const BGM_DSPChain::Settings& inSettings);
+
+    // Copies the slot's latest settings into outSettings, unless they're for ioGeneration and
+    // inForce is false. Returns false if it didn't copy them or they were overwritten while it
+    // was, in which case outSettings is left unchanged. Real-time safe.
+    static bool                 ReadSlotRT(const Slot& inSlot,
+                                           bool inForce,
+                                           UInt32& ioGeneration,
+                                           BGM_DSPChain::Settings& outSettings);
+
+    bool                        Matches(const Slot& inSlot,
+                                        pid_t inProcessID,
+                                        const BGM_String& inBundleID) const;
+
+private:
+    struct Entry
+    {
+        bool                    mInUse;
+        UInt32                  mClientID;
+        UInt64                  mLastUsed;
+        // The slot and generation of the settings the chain was last given. mHasSettings is false
+        // until it's been given any.
+        SInt32                  mSlot;
+        UInt32                  mGeneration;
+        bool                    mHasSettings;
+        Float64                 mSampleRate;
+        BGM_DSPChain::Settings  mSettings;
+        BGM_DSPChain            mChain;
+    };
+
+    // The same as BGM_ClientGainRamps.
+    static const UInt32         kMaxClients = 64;
+
+    CAMutex                     mMutex { "Client DSP" };
+    Slot                        mSlots[kMaxApps];
+    std::atomic<UInt32>         mAppCount;
+
+    // Only used on the IO thread.
+    Entry                       mEntries[kMaxClients];
+    UInt64                      mUseCounter;
+
+};
+
+#pragma clang assume_nonnull end
+
+#endif /* BGMDriver__BGM_ClientDSP */
+
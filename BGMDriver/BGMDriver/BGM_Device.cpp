@@ -34,6 +34,8 @@
 // Local Includes
 #include "BGM_PlugIn.h"
 #include "BGM_XPCHelper.h"
+#include "BGM_IOKernels.h"
+#include "BGM_PersistentState.h"
 #include "BGM_Utils.h"
 
 // PublicUtility Includes
@@ -46,6 +48,7 @@
 #include "CAHostTimeBase.h"
 
 // STL Includes
+#include <algorithm>
 #include <stdexcept>
 
 // System Includes
@@ -83,7 +86,18 @@ void	BGM_Device::StaticInitializer()
                                    kObjectID_Stream_Input,
                                    kObjectID_Stream_Output,
 								   kObjectID_Volume_Output_Master,
-								   kObjectID_Mute_Output_Master);
+								   kObjectID_Mute_Output_Master,
+                                   kObjectID_Volume_Boost);
+
+        // Set up the system-wide volume boost. It starts at 0 dB, so the device doesn't process the
+        // mix until the user turns it up.
+        BGM_VolumeControl& theBoostControl = sInstance->mBoostControl;
+        theBoostControl.SetVolumeRange(kBoostMinRawValue,
+                                       kBoostMaxRawValue,
+                                       kBoostMinDbValue,
+                                       kBoostMaxDbValue);
+        theBoostControl.SetWillApplyVolumeToAudio(true);
+
         sInstance->Activate();
 
         // The instance for system (UI) sounds.
@@ -94,7 +108,8 @@ void	BGM_Device::StaticInitializer()
                                            kObjectID_Stream_Input_UI_Sounds,
                                            kObjectID_Stream_Output_UI_Sounds,
                                            kObjectID_Volume_Output_Master_UI_Sounds,
-                                           kAudioObjectUnknown);  // No mute control.
+                                           kAudioObjectUnknown,   // No mute control.
+                                           kAudioObjectUnknown);  // No boost control.
 
         // Set up the UI sounds device's volume control.
         BGM_VolumeControl& theUISoundsVolumeControl = sUISoundsInstance->mVolumeControl;
@@ -128,7 +143,8 @@ BGM_Device::BGM_Device(AudioObjectID inObjectID,
                        AudioObjectID inInputStreamID,
                        AudioObjectID inOutputStreamID,
 					   AudioObjectID inOutputVolumeControlID,
-					   AudioObjectID inOutputMuteControlID)
+					   AudioObjectID inOutputMuteControlID,
+					   AudioObjectID inBoostControlID)
 :
 	BGM_AbstractDevice(inObjectID, kAudioObjectPlugInObject),
 	mStateMutex("Device State"),
@@ -138,11 +154,23 @@ BGM_Device::BGM_Device(AudioObjectID inObjectID,
 	mDeviceModelUID(inDeviceModelUID),
     mWrappedAudioEngine(nullptr),
     mClients(inObjectID, &mTaskQueue),
-    mInputStream(inInputStreamID, inObjectID, false, kSampleRateDefault),
-    mOutputStream(inOutputStreamID, inObjectID, false, kSampleRateDefault),
+    mInputStream(inInputStreamID,
+                 inObjectID,
+                 false,
+                 kSampleRateDefault,
+                 1,
+                 BGM_IOKernels::kMaxChannelCount),
+    mOutputStream(inOutputStreamID,
+                  inObjectID,
+                  false,
+                  kSampleRateDefault,
+                  1,
+                  BGM_IOKernels::kMaxChannelCount),
     mAudibleState(),
     mVolumeControl(inOutputVolumeControlID, GetObjectID()),
-    mMuteControl(inOutputMuteControlID, GetObjectID())
+    mMuteControl(inOutputMuteControlID, GetObjectID()),
+    mBoostControl(inBoostControlID, GetObjectID(), kAudioObjectPropertyScopeGlobal),
+    mBoostStage(mLimiters)
 {
     // Initialises the loopback clock with the default sample rate and, if there is one, sets the wrapped device to the same sample rate
     SetSampleRate(kSampleRateDefault, true);
@@ -159,18 +187,30 @@ void	BGM_Device::Activate()
 	//	Open the connection to the driver and initialize things.
 	//_HW_Open();
 
+    // Restore the settings from before coreaudiod was restarted (or the system was), so they're
+    // applied as soon as the apps start playing audio instead of when BGMApp launches and sets them.
+    // This has to happen before the controls are activated, since it can disable them.
+    BGMLogAndSwallowExceptions("BGM_Device::Activate", [&] {
+        RestorePersistentState();
+    });
+
 	mInputStream.Activate();
 	mOutputStream.Activate();
 
-	if(mVolumeControl.GetObjectID() != kAudioObjectUnknown)
+	if(mVolumeControl.GetObjectID() != kAudioObjectUnknown && mPendingOutputVolumeControlEnabled)
 	{
 		mVolumeControl.Activate();
 	}
 
-    if(mMuteControl.GetObjectID() != kAudioObjectUnknown)
+    if(mMuteControl.GetObjectID() != kAudioObjectUnknown && mPendingOutputMuteControlEnabled)
 	{
 		mMuteControl.Activate();
 	}
+
+    if(mBoostControl.GetObjectID() != kAudioObjectUnknown)
+	{
+		mBoostControl.Activate();
+	}
 	
 	//	Call the super-class, which just marks the object as active
 	BGM_AbstractDevice::Activate();
@@ -189,6 +229,7 @@ void	BGM_Device::Deactivate()
 	mOutputStream.Deactivate();
     mVolumeControl.Deactivate();
     mMuteControl.Deactivate();
+    mBoostControl.Deactivate();
 
 	//	mark the object inactive by calling the super-class
 	BGM_AbstractDevice::Deactivate();
@@ -203,10 +244,13 @@ void    BGM_Device::InitLoopback()
     mLoopbackTime.hostTicksPerFrame = CAHostTimeBase::GetFrequency() / mLoopbackSampleRate;
     
     //  Allocate (or re-allocate) the loopback buffer.
-    //  2 channels * 32-bit float = bytes in each frame
+    //  mChannelCount channels * 32-bit float = bytes in each frame
     //  Pass 1 for nChannels because it's going to be storing interleaved audio, which means we
     //  don't need a separate buffer for each channel.
-	mLoopbackRingBuffer.Allocate(1, 2 * sizeof(Float32), kLoopbackRingBufferFrameSize);
+	mLoopbackRingBuffer.Allocate(1,
+                                 mChannelCount * sizeof(Float32),
+                                 kLoopbackRingBufferFrameSize);
+    mLoopbackSilenceStartTime = -1;
 }
 
 #pragma mark Property Operations
@@ -295,7 +339,7 @@ void	BGM_Device::SetPropertyData(AudioObjectID inObjectID, pid_t inClientPID, co
                                                        inData);
 		if(IsStreamID(inObjectID))
 		{
-            // When one of the stream's sample rate changes, set the new sample rate for both
+            // When one of the stream's sample rate or number of channels changes, set it for both
             // streams and the device. The streams check the new format before this point but don't
             // change until the device tells them to, as it has to get the host to pause IO first.
             if(inAddress.mSelector == kAudioStreamPropertyVirtualFormat ||
@@ -304,199 +348,157 @@ void	BGM_Device::SetPropertyData(AudioObjectID inObjectID, pid_t inClientPID, co
                 const AudioStreamBasicDescription* theNewFormat =
                     reinterpret_cast<const AudioStreamBasicDescription*>(inData);
                 RequestSampleRate(theNewFormat->mSampleRate);
+                RequestChannelCount(theNewFormat->mChannelsPerFrame);
             }
 		}
+        else if(inObjectID == mBoostControl.GetObjectID())
+        {
+            RequestBoostStageUpdate();
+        }
 	}
 }
 
 #pragma mark Device Property Operations
 
-bool	BGM_Device::Device_HasProperty(AudioObjectID inObjectID, pid_t inClientPID, const AudioObjectPropertyAddress& inAddress) const
+//static
+const BGM_PropertyTable<BGM_Device>& BGM_Device::GetPropertyTable()
 {
 	//	For each object, this driver implements all the required properties plus a few extras that
 	//	are useful but not required. There is more detailed commentary about each property in the
 	//	Device_GetPropertyData() method.
-	
-	bool theAnswer = false;
-	switch(inAddress.mSelector)
-	{
-        case kAudioDevicePropertyStreams:
-        case kAudioDevicePropertyIcon:
-        case kAudioObjectPropertyCustomPropertyInfoList:
-        case kAudioDeviceCustomPropertyDeviceAudibleState:
-        case kAudioDeviceCustomPropertyMusicPlayerProcessID:
-        case kAudioDeviceCustomPropertyMusicPlayerBundleID:
-        case kAudioDeviceCustomPropertyDeviceIsRunningSomewhereOtherThanBGMApp:
-        case kAudioDeviceCustomPropertyAppVolumes:
-        case kAudioDeviceCustomPropertyEnabledOutputControls:
-			theAnswer = true;
-			break;
-			
-		case kAudioDevicePropertyLatency:
-		case kAudioDevicePropertySafetyOffset:
-		case kAudioDevicePropertyPreferredChannelsForStereo:
-		case kAudioDevicePropertyPreferredChannelLayout:
-		case kAudioDevicePropertyDeviceCanBeDefaultDevice:
-		case kAudioDevicePropertyDeviceCanBeDefaultSystemDevice:
-			theAnswer = (inAddress.mScope == kAudioObjectPropertyScopeInput) || (inAddress.mScope == kAudioObjectPropertyScopeOutput);
-			break;
-			
-		default:
-			theAnswer = BGM_AbstractDevice::HasProperty(inObjectID, inClientPID, inAddress);
-			break;
+	//
+	//	The device's properties that BGM_AbstractDevice also implements are listed here when this class
+	//	changes whether they're settable, their size or the scopes they're in.
+	static constexpr BGM_PropertyDescriptor<BGM_Device> kProperties[] = {
+		{ kAudioObjectPropertyOwnedObjects, 0, 0, &BGM_Device::GetOwnedObjectsDataSize },
+		{ kAudioDevicePropertyStreams, 0, 0, &BGM_Device::GetStreamsDataSize },
+		{ kAudioObjectPropertyControlList, 0, 0, &BGM_Device::GetControlListDataSize },
+		{ kAudioDevicePropertyLatency, kBGMPropertyFlag_InputOutputScopes, sizeof(UInt32), nullptr },
+		{ kAudioDevicePropertySafetyOffset, kBGMPropertyFlag_InputOutputScopes, sizeof(UInt32), nullptr },
+		{ kAudioDevicePropertyDeviceCanBeDefaultDevice, kBGMPropertyFlag_InputOutputScopes, sizeof(UInt32), nullptr },
+		{ kAudioDevicePropertyDeviceCanBeDefaultSystemDevice, kBGMPropertyFlag_InputOutputScopes, sizeof(UInt32), nullptr },
+		{ kAudioDevicePropertyNominalSampleRate, kBGMPropertyFlag_Settable, sizeof(Float64), nullptr },
+		{ kAudioDevicePropertyAvailableNominalSampleRates, 0, 1 * sizeof(AudioValueRange), nullptr },
+		{ kAudioDevicePropertyPreferredChannelsForStereo, kBGMPropertyFlag_InputOutputScopes, 2 * sizeof(UInt32), nullptr },
+		{ kAudioDevicePropertyPreferredChannelLayout, kBGMPropertyFlag_InputOutputScopes, 0, &BGM_Device::GetPreferredChannelLayoutDataSize },
+		{ kAudioDevicePropertyIcon, 0, sizeof(CFURLRef), nullptr },
+		{ kAudioObjectPropertyCustomPropertyInfoList, 0, sizeof(AudioServerPlugInCustomPropertyInfo) * kNumberOfCustomProperties, nullptr },
+		{ kAudioDeviceCustomPropertyDeviceAudibleState, 0, sizeof(CFNumberRef), nullptr },
+		{ kAudioDeviceCustomPropertyMusicPlayerProcessID, kBGMPropertyFlag_Settable, sizeof(CFPropertyListRef), nullptr },
+		{ kAudioDeviceCustomPropertyMusicPlayerBundleID, kBGMPropertyFlag_Settable, sizeof(CFStringRef), nullptr },
+		{ kAudioDeviceCustomPropertyDeviceIsRunningSomewhereOtherThanBGMApp, 0, sizeof(CFBooleanRef), nullptr },
+		{ kAudioDeviceCustomPropertyAppVolumes, kBGMPropertyFlag_Settable, sizeof(CFPropertyListRef), nullptr },
+		{ kAudioDeviceCustomPropertyEnabledOutputControls, kBGMPropertyFlag_Settable, sizeof(CFArrayRef), nullptr },
+		{ kAudioDeviceCustomPropertyMusicDucking, kBGMPropertyFlag_Settable, sizeof(CFDictionaryRef), nullptr },
+		{ kAudioDeviceCustomPropertyLimiter, kBGMPropertyFlag_Settable, sizeof(CFDictionaryRef), nullptr },
+		{ kAudioDeviceCustomPropertyAppDSP, kBGMPropertyFlag_Settable, sizeof(CFArrayRef), nullptr },
+		{ kAudioDeviceCustomPropertyAppVolumesPacked, kBGMPropertyFlag_Settable, sizeof(CFDataRef), nullptr },
+		{ kAudioDeviceCustomPropertyVolumeRampLength, kBGMPropertyFlag_Settable, sizeof(CFNumberRef), nullptr },
+#if BGM_IOStatsEnabled
+		{ kAudioDeviceCustomPropertyIOStats, 0, sizeof(CFDataRef), nullptr },
+#endif
 	};
-	return theAnswer;
+
+	static_assert(BGM_PropertySelectorsAreUnique(kProperties), "BGM_Device has duplicate properties");
+
+	static constexpr auto kPropertySlots = BGM_MakePropertySlots<BGM_PropertyShift(kProperties)>(kProperties);
+	static constexpr BGM_PropertyTable<BGM_Device> kPropertyTable(kPropertySlots);
+	return kPropertyTable;
+}
+
+bool	BGM_Device::Device_HasProperty(AudioObjectID inObjectID, pid_t inClientPID, const AudioObjectPropertyAddress& inAddress) const
+{
+	auto theProperty = GetPropertyTable().Find(inAddress.mSelector);
+
+	return (theProperty != nullptr) ?
+			theProperty->HasProperty(inAddress) :
+			BGM_AbstractDevice::HasProperty(inObjectID, inClientPID, inAddress);
 }
 
 bool	BGM_Device::Device_IsPropertySettable(AudioObjectID inObjectID, pid_t inClientPID, const AudioObjectPropertyAddress& inAddress) const
 {
-	//	For each object, this driver implements all the required properties plus a few extras that
-	//	are useful but not required. There is more detailed commentary about each property in the
-	//	Device_GetPropertyData() method.
-	
-	bool theAnswer = false;
-	switch(inAddress.mSelector)
-    {
-		case kAudioDevicePropertyStreams:
-		case kAudioDevicePropertyLatency:
-		case kAudioDevicePropertySafetyOffset:
-        case kAudioDevicePropertyPreferredChannelsForStereo:
-        case kAudioDevicePropertyPreferredChannelLayout:
-		case kAudioDevicePropertyDeviceCanBeDefaultDevice:
-		case kAudioDevicePropertyDeviceCanBeDefaultSystemDevice:
-        case kAudioDevicePropertyIcon:
-        case kAudioObjectPropertyCustomPropertyInfoList:
-        case kAudioDeviceCustomPropertyDeviceAudibleState:
-        case kAudioDeviceCustomPropertyDeviceIsRunningSomewhereOtherThanBGMApp:
-			theAnswer = false;
-			break;
-            
-        case kAudioDevicePropertyNominalSampleRate:
-        case kAudioDeviceCustomPropertyMusicPlayerProcessID:
-        case kAudioDeviceCustomPropertyMusicPlayerBundleID:
-        case kAudioDeviceCustomPropertyAppVolumes:
-        case kAudioDeviceCustomPropertyEnabledOutputControls:
-			theAnswer = true;
-			break;
-		
-		default:
-			theAnswer = BGM_AbstractDevice::IsPropertySettable(inObjectID, inClientPID, inAddress);
-			break;
-	};
-	return theAnswer;
+	auto theProperty = GetPropertyTable().Find(inAddress.mSelector);
+
+	return (theProperty != nullptr) ?
+			theProperty->IsSettable() :
+			BGM_AbstractDevice::IsPropertySettable(inObjectID, inClientPID, inAddress);
 }
 
 UInt32	BGM_Device::Device_GetPropertyDataSize(AudioObjectID inObjectID, pid_t inClientPID, const AudioObjectPropertyAddress& inAddress, UInt32 inQualifierDataSize, const void* inQualifierData) const
 {
-	//	For each object, this driver implements all the required properties plus a few extras that
-	//	are useful but not required. There is more detailed commentary about each property in the
-	//	Device_GetPropertyData() method.
-	
+	auto theProperty = GetPropertyTable().Find(inAddress.mSelector);
+
+	return (theProperty != nullptr) ?
+			theProperty->GetDataSize(*this, inAddress) :
+			BGM_AbstractDevice::GetPropertyDataSize(inObjectID, inClientPID, inAddress, inQualifierDataSize, inQualifierData);
+}
+
+UInt32	BGM_Device::GetOwnedObjectsDataSize(const AudioObjectPropertyAddress& inAddress) const
+{
 	UInt32 theAnswer = 0;
 
-	switch(inAddress.mSelector)
+	switch(inAddress.mScope)
 	{
-		case kAudioObjectPropertyOwnedObjects:
-            {
-                switch(inAddress.mScope)
-                {
-                    case kAudioObjectPropertyScopeGlobal:
-                        theAnswer = GetNumberOfSubObjects() * sizeof(AudioObjectID);
-                        break;
-                        
-                    case kAudioObjectPropertyScopeInput:
-                        theAnswer = kNumberOfInputSubObjects * sizeof(AudioObjectID);
-                        break;
-                        
-                    case kAudioObjectPropertyScopeOutput:
-                        theAnswer = kNumberOfOutputStreams * sizeof(AudioObjectID);
-                        theAnswer += GetNumberOfOutputControls() * sizeof(AudioObjectID);
-                        break;
-
-					default:
-						break;
-                };
-            }
+		case kAudioObjectPropertyScopeGlobal:
+			theAnswer = GetNumberOfSubObjects() * sizeof(AudioObjectID);
 			break;
 
-        case kAudioDevicePropertyStreams:
-            {
-                switch(inAddress.mScope)
-                {
-                    case kAudioObjectPropertyScopeGlobal:
-                        theAnswer = kNumberOfStreams * sizeof(AudioObjectID);
-                        break;
-                        
-                    case kAudioObjectPropertyScopeInput:
-                        theAnswer = kNumberOfInputStreams * sizeof(AudioObjectID);
-                        break;
-                        
-                    case kAudioObjectPropertyScopeOutput:
-                        theAnswer = kNumberOfOutputStreams * sizeof(AudioObjectID);
-                        break;
-
-					default:
-						break;
-                };
-            }
+		case kAudioObjectPropertyScopeInput:
+			theAnswer = kNumberOfInputSubObjects * sizeof(AudioObjectID);
 			break;
 
-        case kAudioObjectPropertyControlList:
-            theAnswer = GetNumberOfOutputControls() * sizeof(AudioObjectID);
-            break;
-
-		case kAudioDevicePropertyAvailableNominalSampleRates:
-			theAnswer = 1 * sizeof(AudioValueRange);
+		case kAudioObjectPropertyScopeOutput:
+			theAnswer = kNumberOfOutputStreams * sizeof(AudioObjectID);
+			theAnswer += GetNumberOfOutputControls() * sizeof(AudioObjectID);
 			break;
 
-		case kAudioDevicePropertyPreferredChannelsForStereo:
-			theAnswer = 2 * sizeof(UInt32);
+		default:
 			break;
+	};
 
-		case kAudioDevicePropertyPreferredChannelLayout:
-			theAnswer = offsetof(AudioChannelLayout, mChannelDescriptions) + (2 * sizeof(AudioChannelDescription));
+	return theAnswer;
+}
+
+UInt32	BGM_Device::GetStreamsDataSize(const AudioObjectPropertyAddress& inAddress) const
+{
+	UInt32 theAnswer = 0;
+
+	switch(inAddress.mScope)
+	{
+		case kAudioObjectPropertyScopeGlobal:
+			theAnswer = kNumberOfStreams * sizeof(AudioObjectID);
 			break;
 
-        case kAudioDevicePropertyIcon:
-            theAnswer = sizeof(CFURLRef);
-            break;
-            
-        case kAudioObjectPropertyCustomPropertyInfoList:
-            theAnswer = sizeof(AudioServerPlugInCustomPropertyInfo) * 6;
-            break;
-            
-        case kAudioDeviceCustomPropertyDeviceAudibleState:
-            theAnswer = sizeof(CFNumberRef);
-            break;
+		case kAudioObjectPropertyScopeInput:
+			theAnswer = kNumberOfInputStreams * sizeof(AudioObjectID);
+			break;
 
-        case kAudioDeviceCustomPropertyMusicPlayerProcessID:
-            theAnswer = sizeof(CFPropertyListRef);
+		case kAudioObjectPropertyScopeOutput:
+			theAnswer = kNumberOfOutputStreams * sizeof(AudioObjectID);
 			break;
-            
-        case kAudioDeviceCustomPropertyMusicPlayerBundleID:
-            theAnswer = sizeof(CFStringRef);
-            break;
-            
-        case kAudioDeviceCustomPropertyDeviceIsRunningSomewhereOtherThanBGMApp:
-            theAnswer = sizeof(CFBooleanRef);
-            break;
-            
-        case kAudioDeviceCustomPropertyAppVolumes:
-            theAnswer = sizeof(CFPropertyListRef);
-            break;
 
-        case kAudioDeviceCustomPropertyEnabledOutputControls:
-            theAnswer = sizeof(CFArrayRef);
-            break;
-		
 		default:
-			theAnswer = BGM_AbstractDevice::GetPropertyDataSize(inObjectID, inClientPID, inAddress, inQualifierDataSize, inQualifierData);
 			break;
 	};
 
 	return theAnswer;
 }
 
+UInt32	BGM_Device::GetControlListDataSize(const AudioObjectPropertyAddress& inAddress) const
+{
+	#pragma unused(inAddress)
+
+	return (GetNumberOfOutputControls() + GetNumberOfGlobalControls()) * sizeof(AudioObjectID);
+}
+
+UInt32	BGM_Device::GetPreferredChannelLayoutDataSize(const AudioObjectPropertyAddress& inAddress) const
+{
+	#pragma unused(inAddress)
+
+	return static_cast<UInt32>(offsetof(AudioChannelLayout, mChannelDescriptions) +
+	                           (mChannelCount * sizeof(AudioChannelDescription)));
+}
+
 void	BGM_Device::Device_GetPropertyData(AudioObjectID inObjectID, pid_t inClientPID, const AudioObjectPropertyAddress& inAddress, UInt32 inQualifierDataSize, const void* inQualifierData, UInt32 inDataSize, UInt32& outDataSize, void* outData) const
 {
 	//	For each object, this driver implements all the required properties plus a few extras that
@@ -576,6 +578,14 @@ void	BGM_Device::Device_GetPropertyData(AudioObjectID inObjectID, pid_t inClient
                         {
 							reinterpret_cast<AudioObjectID*>(outData)[3] = mMuteControl.GetObjectID();
                         }
+
+                        // The boost control has global scope, so it goes after the output controls.
+                        UInt32 theBoostControlIndex = kNumberOfStreams + GetNumberOfOutputControls();
+
+                        if(theNumberItemsToFetch > theBoostControlIndex && mBoostControl.IsActive())
+                        {
+                            reinterpret_cast<AudioObjectID*>(outData)[theBoostControlIndex] = mBoostControl.GetObjectID();
+                        }
                     }
 					break;
 					
@@ -746,9 +756,9 @@ void	BGM_Device::Device_GetPropertyData(AudioObjectID inObjectID, pid_t inClient
                 //	number is allowed to be smaller than the actual size of the list, in which
                 //	case only that many items will be returned.
                 theNumberItemsToFetch = inDataSize / sizeof(AudioObjectID);
-                if(theNumberItemsToFetch > 2)
+                if(theNumberItemsToFetch > 3)
                 {
-                    theNumberItemsToFetch = 2;
+                    theNumberItemsToFetch = 3;
                 }
 
                 UInt32 theNumberOfItemsFetched = 0;
@@ -775,15 +785,32 @@ void	BGM_Device::Device_GetPropertyData(AudioObjectID inObjectID, pid_t inClient
                     reinterpret_cast<AudioObjectID*>(outData)[1] = mMuteControl.GetObjectID();
                     theNumberOfItemsFetched++;
                 }
+
+                if(theNumberItemsToFetch > theNumberOfItemsFetched && mBoostControl.IsActive())
+                {
+                    reinterpret_cast<AudioObjectID*>(outData)[theNumberOfItemsFetched] = mBoostControl.GetObjectID();
+                    theNumberOfItemsFetched++;
+                }
                 
                 //	report how much we wrote
                 outDataSize = theNumberOfItemsFetched * sizeof(AudioObjectID);
             }
 			break;
 
-        // TODO: Should we return the real kAudioDevicePropertyLatency and/or
-        //       kAudioDevicePropertySafetyOffset for the real/wrapped output device?
-        //       If so, should we also add on the extra latency added by Background Music? 
+        case kAudioDevicePropertyLatency:
+            // This property returns the presentation latency of the device. The only latency the
+            // device adds itself is the limiters' lookahead, which delays the audio in both
+            // directions.
+            //
+            // TODO: Should we return the real kAudioDevicePropertyLatency and/or
+            //       kAudioDevicePropertySafetyOffset for the real/wrapped output device?
+            ThrowIf(inDataSize < sizeof(UInt32),
+                    CAException(kAudioHardwareBadPropertySizeError),
+                    "BGM_Device::Device_GetPropertyData: not enough space for the return value of "
+                    "kAudioDevicePropertyLatency for the device");
+            *reinterpret_cast<UInt32*>(outData) = mLimiters.GetLatencyFrames();
+            outDataSize = sizeof(UInt32);
+            break;
 
 		case kAudioDevicePropertyNominalSampleRate:
 			//	This property returns the nominal sample rate of the device.
@@ -842,16 +869,28 @@ void	BGM_Device::Device_GetPropertyData(AudioObjectID inObjectID, pid_t inClient
 
 		case kAudioDevicePropertyPreferredChannelLayout:
 			//	This property returns the default AudioChannelLayout to use for the device
-			//	by default. For this device, we return a stereo ACL.
+			//	by default. For this device, we return a stereo, 5.1 or 7.1 ACL, depending on the
+			//	streams' format. The channels are in the order the IO kernels expect. See
+			//	BGM_IOKernels::kMaxChannelCount.
 			{
-				UInt32 theACLSize = offsetof(AudioChannelLayout, mChannelDescriptions) + (2 * sizeof(AudioChannelDescription));
+				static const AudioChannelLabel kChannelLabels[BGM_IOKernels::kMaxChannelCount] = {
+					kAudioChannelLabel_Left,
+					kAudioChannelLabel_Right,
+					kAudioChannelLabel_Center,
+					kAudioChannelLabel_LFEScreen,
+					kAudioChannelLabel_LeftSurround,
+					kAudioChannelLabel_RightSurround,
+					kAudioChannelLabel_RearSurroundLeft,
+					kAudioChannelLabel_RearSurroundRight
+				};
+				UInt32 theACLSize = GetPreferredChannelLayoutDataSize(inAddress);
 				ThrowIf(inDataSize < theACLSize, CAException(kAudioHardwareBadPropertySizeError), "BGM_Device::Device_GetPropertyData: not enough space for the return value of kAudioDevicePropertyPreferredChannelLayout for the device");
 				((AudioChannelLayout*)outData)->mChannelLayoutTag = kAudioChannelLayoutTag_UseChannelDescriptions;
 				((AudioChannelLayout*)outData)->mChannelBitmap = 0;
-				((AudioChannelLayout*)outData)->mNumberChannelDescriptions = 2;
-				for(theItemIndex = 0; theItemIndex < 2; ++theItemIndex)
+				((AudioChannelLayout*)outData)->mNumberChannelDescriptions = mChannelCount;
+				for(theItemIndex = 0; theItemIndex < mChannelCount; ++theItemIndex)
 				{
-					((AudioChannelLayout*)outData)->mChannelDescriptions[theItemIndex].mChannelLabel = kAudioChannelLabel_Left + theItemIndex;
+					((AudioChannelLayout*)outData)->mChannelDescriptions[theItemIndex].mChannelLabel = kChannelLabels[theItemIndex];
 					((AudioChannelLayout*)outData)->mChannelDescriptions[theItemIndex].mChannelFlags = 0;
 					((AudioChannelLayout*)outData)->mChannelDescriptions[theItemIndex].mCoordinates[0] = 0;
 					((AudioChannelLayout*)outData)->mChannelDescriptions[theItemIndex].mCoordinates[1] = 0;
@@ -889,9 +928,9 @@ void	BGM_Device::Device_GetPropertyData(AudioObjectID inObjectID, pid_t inClient
             theNumberItemsToFetch = inDataSize / sizeof(AudioServerPlugInCustomPropertyInfo);
             
             //	clamp it to the number of items we have
-            if(theNumberItemsToFetch > 6)
+            if(theNumberItemsToFetch > kNumberOfCustomProperties)
             {
-                theNumberItemsToFetch = 6;
+                theNumberItemsToFetch = kNumberOfCustomProperties;
             }
             
             if(theNumberItemsToFetch > 0)
@@ -930,6 +969,44 @@ void	BGM_Device::Device_GetPropertyData(AudioObjectID inObjectID, pid_t inClient
                 ((AudioServerPlugInCustomPropertyInfo*)outData)[5].mPropertyDataType = kAudioServerPlugInCustomPropertyDataTypeCFPropertyList;
                 ((AudioServerPlugInCustomPropertyInfo*)outData)[5].mQualifierDataType = kAudioServerPlugInCustomPropertyDataTypeNone;
             }
+            if(theNumberItemsToFetch > 6)
+            {
+                ((AudioServerPlugInCustomPropertyInfo*)outData)[6].mSelector = kAudioDeviceCustomPropertyMusicDucking;
+                ((AudioServerPlugInCustomPropertyInfo*)outData)[6].mPropertyDataType = kAudioServerPlugInCustomPropertyDataTypeCFPropertyList;
+                ((AudioServerPlugInCustomPropertyInfo*)outData)[6].mQualifierDataType = kAudioServerPlugInCustomPropertyDataTypeNone;
+            }
+            if(theNumberItemsToFetch > 7)
+            {
+                ((AudioServerPlugInCustomPropertyInfo*)outData)[7].mSelector = kAudioDeviceCustomPropertyLimiter;
+                ((AudioServerPlugInCustomPropertyInfo*)outData)[7].mPropertyDataType = kAudioServerPlugInCustomPropertyDataTypeCFPropertyList;
+                ((AudioServerPlugInCustomPropertyInfo*)outData)[7].mQualifierDataType = kAudioServerPlugInCustomPropertyDataTypeNone;
+            }
+            if(theNumberItemsToFetch > 8)
+            {
+                ((AudioServerPlugInCustomPropertyInfo*)outData)[8].mSelector = kAudioDeviceCustomPropertyAppDSP;
+                ((AudioServerPlugInCustomPropertyInfo*)outData)[8].mPropertyDataType = kAudioServerPlugInCustomPropertyDataTypeCFPropertyList;
+                ((AudioServerPlugInCustomPropertyInfo*)outData)[8].mQualifierDataType = kAudioServerPlugInCustomPropertyDataTypeNone;
+            }
+            if(theNumberItemsToFetch > 9)
+            {
+                ((AudioServerPlugInCustomPropertyInfo*)outData)[9].mSelector = kAudioDeviceCustomPropertyAppVolumesPacked;
+                ((AudioServerPlugInCustomPropertyInfo*)outData)[9].mPropertyDataType = kAudioServerPlugInCustomPropertyDataTypeCFPropertyList;
+                ((AudioServerPlugInCustomPropertyInfo*)outData)[9].mQualifierDataType = kAudioServerPlugInCustomPropertyDataTypeNone;
+            }
+            if(theNumberItemsToFetch > 10)
+            {
+                ((AudioServerPlugInCustomPropertyInfo*)outData)[10].mSelector = kAudioDeviceCustomPropertyVolumeRampLength;
+                ((AudioServerPlugInCustomPropertyInfo*)outData)[10].mPropertyDataType = kAudioServerPlugInCustomPropertyDataTypeCFPropertyList;
+                ((AudioServerPlugInCustomPropertyInfo*)outData)[10].mQualifierDataType = kAudioServerPlugInCustomPropertyDataTypeNone;
+            }
+#if BGM_IOStatsEnabled
+            if(theNumberItemsToFetch > 11)
+            {
+                ((AudioServerPlugInCustomPropertyInfo*)outData)[11].mSelector = kAudioDeviceCustomPropertyIOStats;
+                ((AudioServerPlugInCustomPropertyInfo*)outData)[11].mPropertyDataType = kAudioServerPlugInCustomPropertyDataTypeCFPropertyList;
+                ((AudioServerPlugInCustomPropertyInfo*)outData)[11].mQualifierDataType = kAudioServerPlugInCustomPropertyDataTypeNone;
+            }
+#endif
 
             outDataSize = theNumberItemsToFetch * sizeof(AudioServerPlugInCustomPropertyInfo);
             break;
@@ -996,6 +1073,155 @@ void	BGM_Device::Device_GetPropertyData(AudioObjectID inObjectID, pid_t inClient
             }
             break;
 
+        case kAudioDeviceCustomPropertyMusicDucking:
+            {
+                ThrowIf(inDataSize < sizeof(CFDictionaryRef), CAException(kAudioHardwareBadPropertySizeError), "BGM_Device::Device_GetPropertyData: not enough space for the return value of kAudioDeviceCustomPropertyMusicDucking for the device");
+
+                BGM_MusicDucker::Parameters theParameters = mMusicDucker.GetParameters();
+
+                CACFDictionary theDucking(false);
+                theDucking.AddBool(CFSTR(kBGMMusicDuckingKey_Enabled), theParameters.mEnabled);
+                theDucking.AddFloat32(CFSTR(kBGMMusicDuckingKey_DepthDb), theParameters.mDepthDb);
+                theDucking.AddFloat32(CFSTR(kBGMMusicDuckingKey_AttackMs), theParameters.mAttackMs);
+                theDucking.AddFloat32(CFSTR(kBGMMusicDuckingKey_HoldMs), theParameters.mHoldMs);
+                theDucking.AddFloat32(CFSTR(kBGMMusicDuckingKey_ReleaseMs), theParameters.mReleaseMs);
+
+                *reinterpret_cast<CFDictionaryRef*>(outData) = theDucking.GetCFDictionary();
+                outDataSize = sizeof(CFDictionaryRef);
+            }
+            break;
+
+        case kAudioDeviceCustomPropertyLimiter:
+            {
+                ThrowIf(inDataSize < sizeof(CFDictionaryRef), CAException(kAudioHardwareBadPropertySizeError), "BGM_Device::Device_GetPropertyData: not enough space for the return value of kAudioDeviceCustomPropertyLimiter for the device");
+
+                BGM_Limiters::Settings theSettings = mLimiters.GetSettings();
+
+                CACFDictionary theLimiter(false);
+                theLimiter.AddBool(CFSTR(kBGMLimiterKey_ClientsEnabled), theSettings.mClientsEnabled);
+                theLimiter.AddBool(CFSTR(kBGMLimiterKey_MixEnabled), theSettings.mMixEnabled);
+                theLimiter.AddFloat32(CFSTR(kBGMLimiterKey_ThresholdDb), theSettings.mParameters.mThresholdDb);
+                theLimiter.AddFloat32(CFSTR(kBGMLimiterKey_KneeDb), theSettings.mParameters.mKneeDb);
+                theLimiter.AddFloat32(CFSTR(kBGMLimiterKey_ReleaseMs), theSettings.mParameters.mReleaseMs);
+
+                *reinterpret_cast<CFDictionaryRef*>(outData) = theLimiter.GetCFDictionary();
+                outDataSize = sizeof(CFDictionaryRef);
+            }
+            break;
+
+        case kAudioDeviceCustomPropertyAppDSP:
+            {
+                ThrowIf(inDataSize < sizeof(CFArrayRef), CAException(kAudioHardwareBadPropertySizeError), "BGM_Device::Device_GetPropertyData: not enough space for the return value of kAudioDeviceCustomPropertyAppDSP for the device");
+
+                CACFArray theAppDSP(false);
+
+                for(const BGM_ClientDSP::AppSettings& theApp : mClientDSP.CopyAppSettings())
+                {
+                    // The array retains these, so they can be released when they go out of scope.
+                    CACFDictionary theAppDict(true);
+
+                    if(theApp.mProcessID != -1)
+                    {
+                        theAppDict.AddSInt32(CFSTR(kBGMAppVolumesKey_ProcessID), theApp.mProcessID);
+                    }
+
+                    if(theApp.mBundleID.IsValid())
+                    {
+                        theAppDict.AddString(CFSTR(kBGMAppVolumesKey_BundleID), theApp.mBundleID.GetCFString());
+                    }
+
+                    CACFArray theBands(true);
+
+                    for(UInt32 i = 0; i < theApp.mSettings.mBandCount; i++)
+                    {
+                        const BGM_DSPChain::Band& theBand = theApp.mSettings.mBands[i];
+
+                        CACFDictionary theBandDict(true);
+                        theBandDict.AddSInt32(CFSTR(kBGMAppDSPBandKey_Type), theBand.mType);
+                        theBandDict.AddFloat32(CFSTR(kBGMAppDSPBandKey_FrequencyHz), theBand.mFrequencyHz);
+                        theBandDict.AddFloat32(CFSTR(kBGMAppDSPBandKey_GainDb), theBand.mGainDb);
+                        theBandDict.AddFloat32(CFSTR(kBGMAppDSPBandKey_Q), theBand.mQ);
+                        theBands.AppendDictionary(theBandDict.GetDict());
+                    }
+
+                    theAppDict.AddArray(CFSTR(kBGMAppDSPKey_EQBands), theBands.GetCFArray());
+
+                    const BGM_DSPChain::Compressor& theCompressor = theApp.mSettings.mCompressor;
+
+                    if(theCompressor.mEnabled)
+                    {
+                        CACFDictionary theCompressorDict(true);
+                        theCompressorDict.AddFloat32(CFSTR(kBGMAppDSPCompressorKey_ThresholdDb), theCompressor.mThresholdDb);
+                        theCompressorDict.AddFloat32(CFSTR(kBGMAppDSPCompressorKey_Ratio), theCompressor.mRatio);
+                        theCompressorDict.AddFloat32(CFSTR(kBGMAppDSPCompressorKey_KneeDb), theCompressor.mKneeDb);
+                        theCompressorDict.AddFloat32(CFSTR(kBGMAppDSPCompressorKey_AttackMs), theCompressor.mAttackMs);
+                        theCompressorDict.AddFloat32(CFSTR(kBGMAppDSPCompressorKey_ReleaseMs), theCompressor.mReleaseMs);
+                        theCompressorDict.AddFloat32(CFSTR(kBGMAppDSPCompressorKey_MakeupDb), theCompressor.mMakeupDb);
+                        theAppDict.AddDictionary(CFSTR(kBGMAppDSPKey_Compressor), theCompressorDict.GetDict());
+                    }
+
+                    theAppDSP.AppendDictionary(theAppDict.GetDict());
+                }
+
+                *reinterpret_cast<CFArrayRef*>(outData) = theAppDSP.GetCFArray();
+                outDataSize = sizeof(CFArrayRef);
+            }
+            break;
+
+        case kAudioDeviceCustomPropertyAppVolumesPacked:
+            {
+                ThrowIf(inDataSize < sizeof(CFDataRef), CAException(kAudioHardwareBadPropertySizeError), "BGM_Device::Device_GetPropertyData: not enough space for the return value of kAudioDeviceCustomPropertyAppVolumesPacked for the device");
+
+                // Just the header, so clients can tell whether we still have their bundle ID tokens.
+                BGMAppVolumesPackedHeader theHeader = {};
+                theHeader.mVersion = kBGMAppVolumesPackedVersion;
+                theHeader.mSessionID = mClients.GetPackedAppVolumesSessionID();
+
+                CFDataRef theData = CFDataCreate(kCFAllocatorDefault,
+                                                 reinterpret_cast<const UInt8*>(&theHeader),
+                                                 sizeof(BGMAppVolumesPackedHeader));
+                ThrowIfNULL(theData, CAException(kAudioHardwareUnspecifiedError), "BGM_Device::Device_GetPropertyData: could not create the data for kAudioDeviceCustomPropertyAppVolumesPacked");
+
+                *reinterpret_cast<CFDataRef*>(outData) = theData;
+                outDataSize = sizeof(CFDataRef);
+            }
+            break;
+
+        case kAudioDeviceCustomPropertyVolumeRampLength:
+            {
+                ThrowIf(inDataSize < sizeof(CFNumberRef), CAException(kAudioHardwareBadPropertySizeError), "BGM_Device::Device_GetPropertyData: not enough space for the return value of kAudioDeviceCustomPropertyVolumeRampLength for the device");
+
+                // The controls' ramps are always set to the same length as the clients'.
+                SInt32 theLengthFrames = static_cast<SInt32>(mClientGainRamps.GetRampLengthFrames());
+                *reinterpret_cast<CFNumberRef*>(outData) =
+                        CFNumberCreate(kCFAllocatorDefault, kCFNumberSInt32Type, &theLengthFrames);
+                outDataSize = sizeof(CFNumberRef);
+            }
+            break;
+
+#if BGM_IOStatsEnabled
+        case kAudioDeviceCustomPropertyIOStats:
+            {
+                ThrowIf(inDataSize < sizeof(CFDataRef), CAException(kAudioHardwareBadPropertySizeError), "BGM_Device::Device_GetPropertyData: not enough space for the return value of kAudioDeviceCustomPropertyIOStats for the device");
+
+                // The IO stats are read without locking, like the audible state, so the IO threads
+                // never have to wait for us. The past client stats only lock the client map's
+                // shadow maps, which the IO threads don't use.
+                BGMDeviceIOStats theStats;
+                mIOStats.GetStats(theStats);
+                mClients.GetPastClientStats(theStats);
+
+                CFDataRef theData = CFDataCreate(kCFAllocatorDefault,
+                                                 reinterpret_cast<const UInt8*>(&theStats),
+                                                 sizeof(BGMDeviceIOStats));
+                ThrowIfNULL(theData, CAException(kAudioHardwareUnspecifiedError), "BGM_Device::Device_GetPropertyData: could not create the data for kAudioDeviceCustomPropertyIOStats");
+
+                *reinterpret_cast<CFDataRef*>(outData) = theData;
+                outDataSize = sizeof(CFDataRef);
+            }
+            break;
+#endif
+
 		default:
 			BGM_AbstractDevice::GetPropertyData(inObjectID, inClientPID, inAddress, inQualifierDataSize, inQualifierData, inDataSize, outDataSize, outData);
 			break;
@@ -1070,56 +1296,257 @@ static void ValidateAppVolumesProperty(const CACFArray& inAppVolumes)
     }
 }
 
-void	BGM_Device::Device_SetPropertyData(AudioObjectID inObjectID, pid_t inClientPID, const AudioObjectPropertyAddress& inAddress, UInt32 inQualifierDataSize, const void* inQualifierData, UInt32 inDataSize, const void* inData)
+// Reads the settings given for the kAudioDeviceCustomPropertyMusicDucking property into ioParameters.
+// Settings that aren't included are left unchanged. Throws
+// CAException(kAudioHardwareIllegalOperationError) if a setting has the wrong type.
+static void ReadMusicDuckingProperty(const CACFDictionary& inDucking,
+                                     BGM_MusicDucker::Parameters& ioParameters)
 {
-	switch(inAddress.mSelector)
-	{
-        case kAudioDevicePropertyNominalSampleRate:
-            ThrowIf(inDataSize < sizeof(Float64),
-                    CAException(kAudioHardwareBadPropertySizeError),
-                    "BGM_Device::Device_SetPropertyData: wrong size for the data for kAudioDevicePropertyNominalSampleRate");
-            RequestSampleRate(*reinterpret_cast<const Float64*>(inData));
-            break;
-            
-        case kAudioDeviceCustomPropertyMusicPlayerProcessID:
-            {
-                ThrowIf(inDataSize < sizeof(CFNumberRef), CAException(kAudioHardwareBadPropertySizeError), "BGM_Device::Device_SetPropertyData: wrong size for the data for kAudioDeviceCustomPropertyMusicPlayerProcessID");
-                
-                CFNumberRef pidRef = *reinterpret_cast<const CFNumberRef*>(inData);
-                
-                ThrowIf(pidRef == NULL, CAException(kAudioHardwareIllegalOperationError), "BGM_Device::Device_SetPropertyData: null reference given for kAudioDeviceCustomPropertyMusicPlayerProcessID");
-                ThrowIf(CFGetTypeID(pidRef) != CFNumberGetTypeID(), CAException(kAudioHardwareIllegalOperationError), "BGM_Device::Device_SetPropertyData: CFType given for kAudioDeviceCustomPropertyMusicPlayerProcessID was not a CFNumber");
-                
-                // Get the pid out of the CFNumber we received
-                // (Not using CACFNumber::GetSInt32 here because it would return 0 if CFNumberGetValue didn't write to our
-                // pid variable, and we want that to be an error.)
-                pid_t pid = INT_MIN;
-                // CFNumberGetValue docs: "If the conversion is lossy, or the value is out of range, false is returned."
-                Boolean success = CFNumberGetValue(pidRef, kCFNumberIntType, &pid);
-                
-                ThrowIf(!success, CAException(kAudioHardwareIllegalOperationError), "BGM_Device::Device_SetPropertyData: probable error from CFNumberGetValue when reading pid for kAudioDeviceCustomPropertyMusicPlayerProcessID");
-                
-                CAMutex::Locker theStateLocker(mStateMutex);
-                
-                bool propertyWasChanged = false;
-                
-                try
-                {
-                    propertyWasChanged = mClients.SetMusicPlayer(pid);
-                }
-                catch(BGM_InvalidClientPIDException)
-                {
-                    Throw(CAException(kAudioHardwareIllegalOperationError));
-                }
-                
-                if(propertyWasChanged)
-                {
-                    // Send notification
-                    CADispatchQueue::GetGlobalSerialQueue().Dispatch(false,	^{
-                        AudioObjectPropertyAddress theChangedProperties[] = { kBGMMusicPlayerProcessIDAddress, kBGMMusicPlayerBundleIDAddress };
-                        BGM_PlugIn::Host_PropertiesChanged(inObjectID, 2, theChangedProperties);
-                    });
-                }
+    CFTypeRef theValue = nullptr;
+
+    if(inDucking.GetCFType(CFSTR(kBGMMusicDuckingKey_Enabled), theValue))
+    {
+        ThrowIf(!inDucking.GetBool(CFSTR(kBGMMusicDuckingKey_Enabled), ioParameters.mEnabled),
+                CAException(kAudioHardwareIllegalOperationError),
+                "BGM_Device::ReadMusicDuckingProperty: Enabled is not a CFBoolean");
+    }
+
+    struct { const CFStringRef mKey; Float32& mValue; } theFloatSettings[] = {
+        { CFSTR(kBGMMusicDuckingKey_DepthDb), ioParameters.mDepthDb },
+        { CFSTR(kBGMMusicDuckingKey_AttackMs), ioParameters.mAttackMs },
+        { CFSTR(kBGMMusicDuckingKey_HoldMs), ioParameters.mHoldMs },
+        { CFSTR(kBGMMusicDuckingKey_ReleaseMs), ioParameters.mReleaseMs }
+    };
+
+    for(auto& theSetting : theFloatSettings)
+    {
+        if(inDucking.GetCFType(theSetting.mKey, theValue))
+        {
+            ThrowIf(!theValue || (CFGetTypeID(theValue) != CFNumberGetTypeID()),
+                    CAException(kAudioHardwareIllegalOperationError),
+                    "BGM_Device::ReadMusicDuckingProperty: Setting is not a CFNumber");
+            inDucking.GetFloat32(theSetting.mKey, theSetting.mValue);
+        }
+    }
+}
+
+// Reads the settings given for the kAudioDeviceCustomPropertyLimiter property into ioSettings, like
+// ReadMusicDuckingProperty.
+static void ReadLimiterProperty(const CACFDictionary& inLimiter, BGM_Limiters::Settings& ioSettings)
+{
+    CFTypeRef theValue = nullptr;
+
+    struct { const CFStringRef mKey; bool& mValue; } theBoolSettings[] = {
+        { CFSTR(kBGMLimiterKey_ClientsEnabled), ioSettings.mClientsEnabled },
+        { CFSTR(kBGMLimiterKey_MixEnabled), ioSettings.mMixEnabled }
+    };
+
+    for(auto& theSetting : theBoolSettings)
+    {
+        if(inLimiter.GetCFType(theSetting.mKey, theValue))
+        {
+            ThrowIf(!inLimiter.GetBool(theSetting.mKey, theSetting.mValue),
+                    CAException(kAudioHardwareIllegalOperationError),
+                    "BGM_Device::ReadLimiterProperty: Setting is not a CFBoolean");
+        }
+    }
+
+    struct { const CFStringRef mKey; Float32& mValue; } theFloatSettings[] = {
+        { CFSTR(kBGMLimiterKey_ThresholdDb), ioSettings.mParameters.mThresholdDb },
+        { CFSTR(kBGMLimiterKey_KneeDb), ioSettings.mParameters.mKneeDb },
+        { CFSTR(kBGMLimiterKey_ReleaseMs), ioSettings.mParameters.mReleaseMs }
+    };
+
+    for(auto& theSetting : theFloatSettings)
+    {
+        if(inLimiter.GetCFType(theSetting.mKey, theValue))
+        {
+            ThrowIf(!theValue || (CFGetTypeID(theValue) != CFNumberGetTypeID()),
+                    CAException(kAudioHardwareIllegalOperationError),
+                    "BGM_Device::ReadLimiterProperty: Setting is not a CFNumber");
+            inLimiter.GetFloat32(theSetting.mKey, theSetting.mValue);
+        }
+    }
+}
+
+// Reads the settings given for the kAudioDeviceCustomPropertyAppDSP property. Each app's settings start
+// from BGM_DSPChain's defaults, so the keys that aren't included are reset. Throws
+// CAException(kAudioHardwareIllegalOperationError) if a setting has the wrong type, an app has no PID or
+// bundle ID or has too many bands. Nothing is applied, so a bad app doesn't leave the others half set.
+static std::vector<BGM_ClientDSP::AppSettings> ReadAppDSPProperty(const CACFArray& inAppDSP)
+{
+    std::vector<BGM_ClientDSP::AppSettings> theApps;
+    CFTypeRef theValue = nullptr;
+
+    for(UInt32 i = 0; i < inAppDSP.GetNumberItems(); i++)
+    {
+        ThrowIf(!inAppDSP.GetCFType(i, theValue) || !theValue ||
+                (CFGetTypeID(theValue) != CFDictionaryGetTypeID()),
+                CAException(kAudioHardwareIllegalOperationError),
+                "BGM_Device::ReadAppDSPProperty: Element is not a CFDictionary");
+
+        CACFDictionary theAppDict(static_cast<CFDictionaryRef>(theValue), false);
+        BGM_ClientDSP::AppSettings theApp { -1, BGM_String(), BGM_DSPChain::GetDefaultSettings() };
+
+        if(theAppDict.GetCFType(CFSTR(kBGMAppVolumesKey_ProcessID), theValue))
+        {
+            ThrowIf(!theAppDict.GetSInt32(CFSTR(kBGMAppVolumesKey_ProcessID), theApp.mProcessID),
+                    CAException(kAudioHardwareIllegalOperationError),
+                    "BGM_Device::ReadAppDSPProperty: ProcessID is not a CFNumber");
+        }
+
+        if(theAppDict.GetCFType(CFSTR(kBGMAppVolumesKey_BundleID), theValue))
+        {
+            theAppDict.GetCACFString(CFSTR(kBGMAppVolumesKey_BundleID), theApp.mBundleID);
+            ThrowIf(!theApp.mBundleID.IsValid(),
+                    CAException(kAudioHardwareIllegalOperationError),
+                    "BGM_Device::ReadAppDSPProperty: BundleID is not a CFString");
+        }
+
+        ThrowIf((theApp.mProcessID == -1) && !theApp.mBundleID.IsValid(),
+                CAException(kAudioHardwareIllegalOperationError),
+                "BGM_Device::ReadAppDSPProperty: Neither ProcessID nor BundleID present");
+
+        if(theAppDict.GetCFType(CFSTR(kBGMAppDSPKey_EQBands), theValue))
+        {
+            ThrowIf(!theValue || (CFGetTypeID(theValue) != CFArrayGetTypeID()),
+                    CAException(kAudioHardwareIllegalOperationError),
+                    "BGM_Device::ReadAppDSPProperty: EQBands is not a CFArray");
+
+            CACFArray theBands(static_cast<CFArrayRef>(theValue), false);
+
+            ThrowIf(theBands.GetNumberItems() > BGM_DSPChain::kMaxBands,
+                    CAException(kAudioHardwareIllegalOperationError),
+                    "BGM_Device::ReadAppDSPProperty: Too many EQ bands");
+
+            theApp.mSettings.mBandCount = theBands.GetNumberItems();
+
+            for(UInt32 j = 0; j < theBands.GetNumberItems(); j++)
+            {
+                ThrowIf(!theBands.GetCFType(j, theValue) || !theValue ||
+                        (CFGetTypeID(theValue) != CFDictionaryGetTypeID()),
+                        CAException(kAudioHardwareIllegalOperationError),
+                        "BGM_Device::ReadAppDSPProperty: EQ band is not a CFDictionary");
+
+                CACFDictionary theBandDict(static_cast<CFDictionaryRef>(theValue), false);
+                BGM_DSPChain::Band& theBand = theApp.mSettings.mBands[j];
+
+                if(theBandDict.GetCFType(CFSTR(kBGMAppDSPBandKey_Type), theValue))
+                {
+                    ThrowIf(!theBandDict.GetSInt32(CFSTR(kBGMAppDSPBandKey_Type), theBand.mType),
+                            CAException(kAudioHardwareIllegalOperationError),
+                            "BGM_Device::ReadAppDSPProperty: Band type is not a CFNumber");
+                }
+
+                struct { const CFStringRef mKey; Float32& mValue; } theFloatSettings[] = {
+                    { CFSTR(kBGMAppDSPBandKey_FrequencyHz), theBand.mFrequencyHz },
+                    { CFSTR(kBGMAppDSPBandKey_GainDb), theBand.mGainDb },
+                    { CFSTR(kBGMAppDSPBandKey_Q), theBand.mQ }
+                };
+
+                for(auto& theSetting : theFloatSettings)
+                {
+                    if(theBandDict.GetCFType(theSetting.mKey, theValue))
+                    {
+                        ThrowIf(!theValue || (CFGetTypeID(theValue) != CFNumberGetTypeID()),
+                                CAException(kAudioHardwareIllegalOperationError),
+                                "BGM_Device::ReadAppDSPProperty: Band setting is not a CFNumber");
+                        theBandDict.GetFloat32(theSetting.mKey, theSetting.mValue);
+                    }
+                }
+            }
+        }
+
+        if(theAppDict.GetCFType(CFSTR(kBGMAppDSPKey_Compressor), theValue))
+        {
+            ThrowIf(!theValue || (CFGetTypeID(theValue) != CFDictionaryGetTypeID()),
+                    CAException(kAudioHardwareIllegalOperationError),
+                    "BGM_Device::ReadAppDSPProperty: Compressor is not a CFDictionary");
+
+            CACFDictionary theCompressorDict(static_cast<CFDictionaryRef>(theValue), false);
+            BGM_DSPChain::Compressor& theCompressor = theApp.mSettings.mCompressor;
+            theCompressor.mEnabled = true;
+
+            struct { const CFStringRef mKey; Float32& mValue; } theFloatSettings[] = {
+                { CFSTR(kBGMAppDSPCompressorKey_ThresholdDb), theCompressor.mThresholdDb },
+                { CFSTR(kBGMAppDSPCompressorKey_Ratio), theCompressor.mRatio },
+                { CFSTR(kBGMAppDSPCompressorKey_KneeDb), theCompressor.mKneeDb },
+                { CFSTR(kBGMAppDSPCompressorKey_AttackMs), theCompressor.mAttackMs },
+                { CFSTR(kBGMAppDSPCompressorKey_ReleaseMs), theCompressor.mReleaseMs },
+                { CFSTR(kBGMAppDSPCompressorKey_MakeupDb), theCompressor.mMakeupDb }
+            };
+
+            for(auto& theSetting : theFloatSettings)
+            {
+                if(theCompressorDict.GetCFType(theSetting.mKey, theValue))
+                {
+                    ThrowIf(!theValue || (CFGetTypeID(theValue) != CFNumberGetTypeID()),
+                            CAException(kAudioHardwareIllegalOperationError),
+                            "BGM_Device::ReadAppDSPProperty: Compressor setting is not a CFNumber");
+                    theCompressorDict.GetFloat32(theSetting.mKey, theSetting.mValue);
+                }
+            }
+        }
+
+        theApps.push_back(theApp);
+    }
+
+    return theApps;
+}
+
+void	BGM_Device::Device_SetPropertyData(AudioObjectID inObjectID, pid_t inClientPID, const AudioObjectPropertyAddress& inAddress, UInt32 inQualifierDataSize, const void* inQualifierData, UInt32 inDataSize, const void* inData)
+{
+	switch(inAddress.mSelector)
+	{
+        case kAudioDevicePropertyNominalSampleRate:
+            ThrowIf(inDataSize < sizeof(Float64),
+                    CAException(kAudioHardwareBadPropertySizeError),
+                    "BGM_Device::Device_SetPropertyData: wrong size for the data for kAudioDevicePropertyNominalSampleRate");
+            RequestSampleRate(*reinterpret_cast<const Float64*>(inData));
+            break;
+            
+        case kAudioDeviceCustomPropertyMusicPlayerProcessID:
+            {
+                ThrowIf(inDataSize < sizeof(CFNumberRef), CAException(kAudioHardwareBadPropertySizeError), "BGM_Device::Device_SetPropertyData: wrong size for the data for kAudioDeviceCustomPropertyMusicPlayerProcessID");
+                
+                CFNumberRef pidRef = *reinterpret_cast<const CFNumberRef*>(inData);
+                
+                ThrowIf(pidRef == NULL, CAException(kAudioHardwareIllegalOperationError), "BGM_Device::Device_SetPropertyData: null reference given for kAudioDeviceCustomPropertyMusicPlayerProcessID");
+                ThrowIf(CFGetTypeID(pidRef) != CFNumberGetTypeID(), CAException(kAudioHardwareIllegalOperationError), "BGM_Device::Device_SetPropertyData: CFType given for kAudioDeviceCustomPropertyMusicPlayerProcessID was not a CFNumber");
+                
+                // Get the pid out of the CFNumber we received
+                // (Not using CACFNumber::GetSInt32 here because it would return 0 if CFNumberGetValue didn't write to our
+                // pid variable, and we want that to be an error.)
+                pid_t pid = INT_MIN;
+                // CFNumberGetValue docs: "If the conversion is lossy, or the value is out of range, false is returned."
+                Boolean success = CFNumberGetValue(pidRef, kCFNumberIntType, &pid);
+                
+                ThrowIf(!success, CAException(kAudioHardwareIllegalOperationError), "BGM_Device::Device_SetPropertyData: probable error from CFNumberGetValue when reading pid for kAudioDeviceCustomPropertyMusicPlayerProcessID");
+                
+                CAMutex::Locker theStateLocker(mStateMutex);
+                
+                bool propertyWasChanged = false;
+                
+                try
+                {
+                    propertyWasChanged = mClients.SetMusicPlayer(pid);
+                }
+                catch(BGM_InvalidClientPIDException)
+                {
+                    Throw(CAException(kAudioHardwareIllegalOperationError));
+                }
+                
+                if(propertyWasChanged)
+                {
+                    // Setting the music player by PID unsets its bundle ID.
+                    RequestPersistentStateSave();
+
+                    // Send notification
+                    CADispatchQueue::GetGlobalSerialQueue().Dispatch(false,	^{
+                        AudioObjectPropertyAddress theChangedProperties[] = { kBGMMusicPlayerProcessIDAddress, kBGMMusicPlayerBundleIDAddress };
+                        BGM_PlugIn::Host_PropertiesChanged(inObjectID, 2, theChangedProperties);
+                    });
+                }
             }
             break;
             
@@ -1141,6 +1568,8 @@ void	BGM_Device::Device_SetPropertyData(AudioObjectID inObjectID, pid_t inClient
                 
                 if(propertyWasChanged)
                 {
+                    RequestPersistentStateSave();
+
                     // Send notification
                     CADispatchQueue::GetGlobalSerialQueue().Dispatch(false,	^{
                         AudioObjectPropertyAddress theChangedProperties[] = { kBGMMusicPlayerBundleIDAddress, kBGMMusicPlayerProcessIDAddress };
@@ -1178,6 +1607,8 @@ void	BGM_Device::Device_SetPropertyData(AudioObjectID inObjectID, pid_t inClient
 
                 if(propertyWasChanged)
                 {
+                    RequestPersistentStateSave();
+
                     // Send notification
                     CADispatchQueue::GetGlobalSerialQueue().Dispatch(false,	^{
                         AudioObjectPropertyAddress theChangedProperties[] = { kBGMAppVolumesAddress };
@@ -1187,6 +1618,87 @@ void	BGM_Device::Device_SetPropertyData(AudioObjectID inObjectID, pid_t inClient
             }
             break;
 
+        case kAudioDeviceCustomPropertyAppVolumesPacked:
+            {
+                ThrowIf(inDataSize < sizeof(CFDataRef), CAException(kAudioHardwareBadPropertySizeError), "BGM_Device::Device_SetPropertyData: wrong size for the data for kAudioDeviceCustomPropertyAppVolumesPacked");
+
+                CFDataRef theDataRef = *reinterpret_cast<const CFDataRef*>(inData);
+
+                ThrowIfNULL(theDataRef, CAException(kAudioHardwareIllegalOperationError), "BGM_Device::Device_SetPropertyData: kAudioDeviceCustomPropertyAppVolumesPacked cannot be set to NULL");
+                ThrowIf(CFGetTypeID(theDataRef) != CFDataGetTypeID(), CAException(kAudioHardwareIllegalOperationError), "BGM_Device::Device_SetPropertyData: CFType given for kAudioDeviceCustomPropertyAppVolumesPacked was not a CFData");
+
+                bool propertyWasChanged = false;
+
+                CAMutex::Locker theStateLocker(mStateMutex);
+
+                try
+                {
+                    propertyWasChanged =
+                            mClients.SetClientsRelativeVolumesPacked(CFDataGetBytePtr(theDataRef),
+                                                                     static_cast<size_t>(CFDataGetLength(theDataRef)));
+                }
+                catch(BGM_InvalidClientRelativeVolumeException)
+                {
+                    Throw(CAException(kAudioHardwareIllegalOperationError));
+                }
+
+                if(propertyWasChanged)
+                {
+                    RequestPersistentStateSave();
+
+                    // The changes are visible through kAudioDeviceCustomPropertyAppVolumes.
+                    CADispatchQueue::GetGlobalSerialQueue().Dispatch(false,	^{
+                        AudioObjectPropertyAddress theChangedProperties[] = { kBGMAppVolumesAddress };
+                        BGM_PlugIn::Host_PropertiesChanged(inObjectID, 1, theChangedProperties);
+                    });
+                }
+            }
+            break;
+
+        case kAudioDeviceCustomPropertyVolumeRampLength:
+            {
+                ThrowIf(inDataSize < sizeof(CFNumberRef), CAException(kAudioHardwareBadPropertySizeError), "BGM_Device::Device_SetPropertyData: wrong size for the data for kAudioDeviceCustomPropertyVolumeRampLength");
+
+                CFNumberRef theLengthRef = *reinterpret_cast<const CFNumberRef*>(inData);
+
+                ThrowIfNULL(theLengthRef, CAException(kAudioHardwareIllegalOperationError), "BGM_Device::Device_SetPropertyData: kAudioDeviceCustomPropertyVolumeRampLength cannot be set to NULL");
+                ThrowIf(CFGetTypeID(theLengthRef) != CFNumberGetTypeID(), CAException(kAudioHardwareIllegalOperationError), "BGM_Device::Device_SetPropertyData: CFType given for kAudioDeviceCustomPropertyVolumeRampLength was not a CFNumber");
+
+                SInt64 theLengthFrames = -1;
+                Boolean success = CFNumberGetValue(theLengthRef, kCFNumberSInt64Type, &theLengthFrames);
+
+                ThrowIf(!success || theLengthFrames < 0, CAException(kAudioHardwareIllegalOperationError), "BGM_Device::Device_SetPropertyData: invalid value for kAudioDeviceCustomPropertyVolumeRampLength");
+
+                // Clamp the length here, rather than on the IO thread. The setters clamp it as well,
+                // but the cast to UInt32 could wrap.
+                UInt32 theClampedLengthFrames = static_cast<UInt32>(
+                        std::min(theLengthFrames,
+                                 static_cast<SInt64>(BGM_GainRamp::kMaxLengthFrames)));
+
+                bool propertyWasChanged;
+
+                {
+                    CAMutex::Locker theStateLocker(mStateMutex);
+
+                    propertyWasChanged =
+                            (theClampedLengthFrames != mClientGainRamps.GetRampLengthFrames());
+
+                    // The ramps that are already going finish at their old lengths.
+                    mClientGainRamps.SetRampLengthFrames(theClampedLengthFrames);
+                    mVolumeControl.SetGainRampLengthFrames(theClampedLengthFrames);
+                    mBoostControl.SetGainRampLengthFrames(theClampedLengthFrames);
+                }
+
+                if(propertyWasChanged)
+                {
+                    CADispatchQueue::GetGlobalSerialQueue().Dispatch(false,	^{
+                        AudioObjectPropertyAddress theChangedProperties[] = { kBGMVolumeRampLengthAddress };
+                        BGM_PlugIn::Host_PropertiesChanged(inObjectID, 1, theChangedProperties);
+                    });
+                }
+            }
+            break;
+
         case kAudioDeviceCustomPropertyEnabledOutputControls:
             {
                 ThrowIf(inDataSize < sizeof(CFArrayRef),
@@ -1232,6 +1744,152 @@ void	BGM_Device::Device_SetPropertyData(AudioObjectID inObjectID, pid_t inClient
             }
             break;
 
+        case kAudioDeviceCustomPropertyMusicDucking:
+            {
+                ThrowIf(inDataSize < sizeof(CFDictionaryRef),
+                        CAException(kAudioHardwareBadPropertySizeError),
+                        "BGM_Device::Device_SetPropertyData: wrong size for the data for "
+                        "kAudioDeviceCustomPropertyMusicDucking");
+
+                CFDictionaryRef theDuckingRef = *reinterpret_cast<const CFDictionaryRef*>(inData);
+
+                ThrowIfNULL(theDuckingRef,
+                            CAException(kAudioHardwareIllegalOperationError),
+                            "BGM_Device::Device_SetPropertyData: null reference given for "
+                            "kAudioDeviceCustomPropertyMusicDucking");
+                ThrowIf(CFGetTypeID(theDuckingRef) != CFDictionaryGetTypeID(),
+                        CAException(kAudioHardwareIllegalOperationError),
+                        "BGM_Device::Device_SetPropertyData: CFType given for "
+                        "kAudioDeviceCustomPropertyMusicDucking was not a CFDictionary");
+
+                {
+                    // The state mutex stops two clients setting different keys at the same time
+                    // from losing one of the changes. The IO thread doesn't need it.
+                    CAMutex::Locker theStateLocker(mStateMutex);
+
+                    BGM_MusicDucker::Parameters theParameters = mMusicDucker.GetParameters();
+                    ReadMusicDuckingProperty(CACFDictionary(theDuckingRef, false), theParameters);
+                    mMusicDucker.SetParameters(theParameters);
+                }
+
+                // Send the notification asynchronously, like for the app volumes, in case a
+                // listener tries to get the property while we're still handling this call.
+                CADispatchQueue::GetGlobalSerialQueue().Dispatch(false, ^{
+                    AudioObjectPropertyAddress theChangedProperties[] = { kBGMMusicDuckingAddress };
+                    BGM_PlugIn::Host_PropertiesChanged(inObjectID, 1, theChangedProperties);
+                });
+            }
+            break;
+
+        case kAudioDeviceCustomPropertyLimiter:
+            {
+                ThrowIf(inDataSize < sizeof(CFDictionaryRef),
+                        CAException(kAudioHardwareBadPropertySizeError),
+                        "BGM_Device::Device_SetPropertyData: wrong size for the data for "
+                        "kAudioDeviceCustomPropertyLimiter");
+
+                CFDictionaryRef theLimiterRef = *reinterpret_cast<const CFDictionaryRef*>(inData);
+
+                ThrowIfNULL(theLimiterRef,
+                            CAException(kAudioHardwareIllegalOperationError),
+                            "BGM_Device::Device_SetPropertyData: null reference given for "
+                            "kAudioDeviceCustomPropertyLimiter");
+                ThrowIf(CFGetTypeID(theLimiterRef) != CFDictionaryGetTypeID(),
+                        CAException(kAudioHardwareIllegalOperationError),
+                        "BGM_Device::Device_SetPropertyData: CFType given for "
+                        "kAudioDeviceCustomPropertyLimiter was not a CFDictionary");
+
+                bool theLatencyChanged;
+
+                {
+                    // See kAudioDeviceCustomPropertyMusicDucking.
+                    CAMutex::Locker theStateLocker(mStateMutex);
+
+                    UInt32 theOldLatencyFrames = mLimiters.GetLatencyFrames();
+                    BGM_Limiters::Settings theSettings = mLimiters.GetSettings();
+                    ReadLimiterProperty(CACFDictionary(theLimiterRef, false), theSettings);
+                    mLimiters.SetSettings(theSettings);
+                    theLatencyChanged = (mLimiters.GetLatencyFrames() != theOldLatencyFrames);
+                }
+
+                CADispatchQueue::GetGlobalSerialQueue().Dispatch(false, ^{
+                    // Enabling or disabling a limiter changes the device's latency.
+                    AudioObjectPropertyAddress theChangedProperties[] = {
+                        kBGMLimiterAddress,
+                        { kAudioDevicePropertyLatency,
+                          kAudioObjectPropertyScopeOutput,
+                          kAudioObjectPropertyElementMaster },
+                        { kAudioDevicePropertyLatency,
+                          kAudioObjectPropertyScopeInput,
+                          kAudioObjectPropertyElementMaster }
+                    };
+                    BGM_PlugIn::Host_PropertiesChanged(inObjectID,
+                                                       theLatencyChanged ? 3 : 1,
+                                                       theChangedProperties);
+                });
+            }
+            break;
+
+        case kAudioDeviceCustomPropertyAppDSP:
+            {
+                ThrowIf(inDataSize < sizeof(CFArrayRef),
+                        CAException(kAudioHardwareBadPropertySizeError),
+                        "BGM_Device::Device_SetPropertyData: wrong size for the data for "
+                        "kAudioDeviceCustomPropertyAppDSP");
+
+                CFArrayRef theAppDSPRef = *reinterpret_cast<const CFArrayRef*>(inData);
+
+                ThrowIfNULL(theAppDSPRef,
+                            CAException(kAudioHardwareIllegalOperationError),
+                            "BGM_Device::Device_SetPropertyData: null reference given for "
+                            "kAudioDeviceCustomPropertyAppDSP");
+                ThrowIf(CFGetTypeID(theAppDSPRef) != CFArrayGetTypeID(),
+                        CAException(kAudioHardwareIllegalOperationError),
+                        "BGM_Device::Device_SetPropertyData: CFType given for "
+                        "kAudioDeviceCustomPropertyAppDSP was not a CFArray");
+
+                std::vector<BGM_ClientDSP::AppSettings> theApps =
+                        ReadAppDSPProperty(CACFArray(theAppDSPRef, false));
+
+                {
+                    CAMutex::Locker theStateLocker(mStateMutex);
+
+                    for(const BGM_ClientDSP::AppSettings& theApp : theApps)
+                    {
+                        SInt32 theSlot = mClientDSP.FindApp(theApp.mProcessID, theApp.mBundleID);
+
+                        if(BGM_DSPChain::IsBypassed(theApp.mSettings))
+                        {
+                            if(theSlot != -1)
+                            {
+                                // Take the slot away from the app's clients before freeing it, in
+                                // case it's given to another app. The slot can have an ID the
+                                // property didn't include, so use the slot's IDs.
+                                BGM_ClientDSP::AppSettings theSlotApp = mClientDSP.CopyAppSettings(theSlot);
+                                mClients.SetClientsDSPSlot(theSlotApp.mProcessID, theSlotApp.mBundleID, -1);
+                                mClientDSP.RemoveApp(theSlot);
+                            }
+                        }
+                        else
+                        {
+                            // Publish the settings before giving the slot to the app's clients.
+                            theSlot = mClientDSP.SetAppSettings(theApp.mProcessID,
+                                                                theApp.mBundleID,
+                                                                theApp.mSettings);
+
+                            BGM_ClientDSP::AppSettings theSlotApp = mClientDSP.CopyAppSettings(theSlot);
+                            mClients.SetClientsDSPSlot(theSlotApp.mProcessID, theSlotApp.mBundleID, theSlot);
+                        }
+                    }
+                }
+
+                CADispatchQueue::GetGlobalSerialQueue().Dispatch(false, ^{
+                    AudioObjectPropertyAddress theChangedProperties[] = { kBGMAppDSPAddress };
+                    BGM_PlugIn::Host_PropertiesChanged(inObjectID, 1, theChangedProperties);
+                });
+            }
+            break;
+
 		default:
 			BGM_AbstractDevice::SetPropertyData(inObjectID, inClientPID, inAddress, inQualifierDataSize, inQualifierData, inDataSize, inData);
 			break;
@@ -1332,6 +1990,8 @@ void	BGM_Device::StopIO(UInt32 inClientID)
 
 void	BGM_Device::GetZeroTimeStamp(Float64& outSampleTime, UInt64& outHostTime, UInt64& outSeed)
 {
+    BGM_IOStats::Timer theTimer(mIOStats, kBGMIOStatsOperation_GetZeroTimeStamp);
+
 	// accessing the buffers requires holding the IO mutex
 	CAMutex::Locker theIOLocker(mIOMutex);
     
@@ -1381,7 +2041,9 @@ void	BGM_Device::WillDoIOOperation(UInt32 inOperationID, bool& outWillDo, bool&
 			break;
 
         case kAudioServerPlugInIOOperationProcessMix:
-            outWillDo = mVolumeControl.WillApplyVolumeToAudioRT();
+            // The boost stage is only enabled or disabled during a config change, so this can't go
+            // stale while IO is running.
+            outWillDo = mBoostStage.WillDoProcessMix(mVolumeControl.WillApplyVolumeToAudioRT());
             outWillDoInPlace = true;
             break;
 
@@ -1422,11 +2084,20 @@ void	BGM_Device::BeginIOOperation(UInt32 inOperationID, UInt32 inIOBufferFrameSi
 void	BGM_Device::DoIOOperation(AudioObjectID inStreamObjectID, UInt32 inClientID, UInt32 inOperationID, UInt32 inIOBufferFrameSize, const AudioServerPlugInIOCycleInfo& inIOCycleInfo, void* ioMainBuffer, void* ioSecondaryBuffer)
 {
     #pragma unused(inStreamObjectID, ioSecondaryBuffer)
+
+    // The deadline for the IO cycle, for mIOStats. mLoopbackSampleRate only changes while IO is
+    // stopped for a configuration change, so we don't need to take the state lock to read it.
+    UInt64 theIOBufferDurationNs =
+            static_cast<UInt64>(inIOBufferFrameSize * NSEC_PER_SEC / mLoopbackSampleRate);
     
 	switch(inOperationID)
 	{
 		case kAudioServerPlugInIOOperationReadInput:
             {
+                BGM_IOStats::Timer theTimer(mIOStats,
+                                            kBGMIOStatsOperation_ReadInput,
+                                            inIOCycleInfo.mIOCycleCounter,
+                                            theIOBufferDurationNs);
                 CAMutex::Locker theIOLocker(mIOMutex);
 
                 // Copy the audio data out of our ring buffer.
@@ -1446,16 +2117,56 @@ void	BGM_Device::DoIOOperation(AudioObjectID inStreamObjectID, UInt32 inClientID
             
         case kAudioServerPlugInIOOperationProcessOutput:
             {
-                bool theClientIsMusicPlayer = mClients.IsMusicPlayerRT(inClientID);
-                
-                CAMutex::Locker theIOLocker(mIOMutex);
-                // Called in this IO operation so we can get the music player client's data separately
-				mAudibleState.UpdateWithClientIO(theClientIsMusicPlayer,
-												 inIOBufferFrameSize,
-												 inIOCycleInfo.mOutputTime.mSampleTime,
-												 reinterpret_cast<const Float32*>(ioMainBuffer));
+                BGM_IOStats::Timer theTimer(mIOStats,
+                                            kBGMIOStatsOperation_ProcessOutput,
+                                            inIOCycleInfo.mIOCycleCounter,
+                                            theIOBufferDurationNs);
+
+                // True if the client's buffer is all zeros, which it usually is for clients that
+                // are running IO but not playing anything. Found by the audible state's scan, so
+                // it doesn't cost an extra pass over the buffer.
+                bool theBufferIsSilent;
+
+                {
+                    bool theClientIsMusicPlayer = mClients.IsMusicPlayerRT(inClientID);
+
+                    CAMutex::Locker theIOLocker(mIOMutex);
+                    // Called in this IO operation so we can get the music player client's data separately
+                    mAudibleState.UpdateWithClientIO(theClientIsMusicPlayer,
+                                                     inIOBufferFrameSize,
+                                                     mChannelCount,
+                                                     inIOCycleInfo.mOutputTime.mSampleTime,
+                                                     reinterpret_cast<const Float32*>(ioMainBuffer));
+                    theBufferIsSilent = mAudibleState.LastBufferWasSilent();
+
+                    if(theClientIsMusicPlayer)
+                    {
+                        // Turn the music player down while other audio is playing, if it's
+                        // enabled. This has to be after UpdateWithClientIO so the audible state
+                        // sees the music at its normal volume. The ducker still has to be told
+                        // about silent buffers, so it keeps its ramp in step with the IO cycles.
+                        BGM_IOKernels::GainRamp theDuckingGain =
+                                mMusicDucker.NextMusicBufferRT(
+                                        inIOBufferFrameSize,
+                                        inIOCycleInfo.mOutputTime.mSampleTime,
+                                        mAudibleState.GetLatestAudibleNonMusicSampleTime(),
+                                        mLoopbackSampleRate);
+
+                        if(!theBufferIsSilent)
+                        {
+                            BGM_IOKernels::ApplyGain(reinterpret_cast<Float32*>(ioMainBuffer),
+                                                     inIOBufferFrameSize,
+                                                     mChannelCount,
+                                                     theDuckingGain);
+                        }
+                    }
+                }
+
+                ApplyClientRelativeVolume(inClientID,
+                                          inIOBufferFrameSize,
+                                          theBufferIsSilent,
+                                          ioMainBuffer);
             }
-            ApplyClientRelativeVolume(inClientID, inIOBufferFrameSize, ioMainBuffer);
             break;
 
         case kAudioServerPlugInIOOperationProcessMix:
@@ -1466,22 +2177,44 @@ void	BGM_Device::DoIOOperation(AudioObjectID inStreamObjectID, UInt32 inClientID
                             "BGM_Device::DoIOOperation: Buffer for "
                                     "kAudioServerPlugInIOOperationProcessMix must not be null");
 
+                BGM_IOStats::Timer theTimer(mIOStats,
+                                            kBGMIOStatsOperation_ProcessMix,
+                                            inIOCycleInfo.mIOCycleCounter,
+                                            theIOBufferDurationNs);
                 CAMutex::Locker theIOLocker(mIOMutex);
 
                 // We ask to do this IO operation so this device can apply its own volume to the
                 // stream. Currently, only the UI sounds device does.
-                mVolumeControl.ApplyVolumeToAudioRT(reinterpret_cast<Float32*>(ioMainBuffer),
-                                                    inIOBufferFrameSize);
+                if(mVolumeControl.WillApplyVolumeToAudioRT())
+                {
+                    mVolumeControl.ApplyVolumeToAudioRT(reinterpret_cast<Float32*>(ioMainBuffer),
+                                                        inIOBufferFrameSize,
+                                                        mChannelCount);
+                }
+
+                // Apply the system-wide boost. If the mix limiter is enabled, it catches any peaks
+                // the boost pushes over full scale when WriteMix is done.
+                if(mBoostStage.IsEnabled())
+                {
+                    mBoostControl.ApplyVolumeToAudioRT(reinterpret_cast<Float32*>(ioMainBuffer),
+                                                       inIOBufferFrameSize,
+                                                       mChannelCount);
+                }
             }
             break;
 
         case kAudioServerPlugInIOOperationWriteMix:
             {
+                BGM_IOStats::Timer theTimer(mIOStats,
+                                            kBGMIOStatsOperation_WriteMix,
+                                            inIOCycleInfo.mIOCycleCounter,
+                                            theIOBufferDurationNs);
                 CAMutex::Locker theIOLocker(mIOMutex);
 
                 bool didChangeState =
                         mAudibleState.UpdateWithMixedIO(
                                 inIOBufferFrameSize,
+                                mChannelCount,
                                 inIOCycleInfo.mOutputTime.mSampleTime,
                                 reinterpret_cast<const Float32*>(ioMainBuffer));
 
@@ -1492,9 +2225,28 @@ void	BGM_Device::DoIOOperation(AudioObjectID inStreamObjectID, UInt32 inClientID
 							kAudioDeviceCustomPropertyDeviceAudibleState, GetObjectID());
                 }
 
+                bool theMixIsSilent =
+                        mLimiters.IsMixOutputSilentRT(mAudibleState.LastBufferWasSilent());
+
+                if(mLimiters.IsMixEnabled())
+                {
+                    // Limit the mix instead of letting it clip. This has to be after
+                    // UpdateWithMixedIO because the limiter delays the audio.
+                    BGM_Limiter::Result theResult =
+                            mLimiters.ProcessMixRT(reinterpret_cast<Float32*>(ioMainBuffer),
+                                                   inIOBufferFrameSize,
+                                                   mChannelCount,
+                                                   mLoopbackSampleRate);
+                    mIOStats.RecordLimiter(kBGMIOStatsLimiter_Mix,
+                                           inIOBufferFrameSize,
+                                           theResult.mLimitedFrameCount,
+                                           theResult.mMaxGainReductionDb);
+                }
+
                 // Copy the audio data into our ring buffer.
                 WriteOutputData(inIOBufferFrameSize,
                                 inIOCycleInfo.mOutputTime.mSampleTime,
+                                theMixIsSilent,
                                 ioMainBuffer);
             }
 			break;
@@ -1517,19 +2269,32 @@ void	BGM_Device::EndIOOperation(UInt32 inOperationID, UInt32 inIOBufferFrameSize
         // We don't have to hold the IO mutex here because mTaskQueue and mClients don't change and adding a task to
         // mTaskQueue is thread safe.
         mTaskQueue.QueueAsync_StopClientIO(&mClients, inClientID);
+
+        // This is called on the IO thread, which might be about to stop. If it isn't, because
+        // other clients are still doing IO, mIOStats will just start recording for it again.
+        mIOStats.IOThreadWillStop();
     }
 }
 
 void	BGM_Device::ReadInputData(UInt32 inIOBufferFrameSize, Float64 inSampleTime, void* outBuffer)
 {
+    // If the mix has been silent since before these frames, they were never stored, so just write
+    // silence. (Fetch would also return silence for them, since they're after the ring buffer's end
+    // time, but it would have to read the time bounds first.)
+    if((mLoopbackSilenceStartTime != -1) && (inSampleTime >= mLoopbackSilenceStartTime))
+    {
+        memset(outBuffer, 0, inIOBufferFrameSize * sizeof(Float32) * mChannelCount);
+        return;
+    }
+
     // Wrap the provided buffer in an AudioBufferList.
     AudioBufferList abl = {
         .mNumberBuffers = 1,
         .mBuffers[0] = {
-            .mNumberChannels = 2,
-            // Each frame is 2 Float32 samples (one per channel). The number of frames * the number
-            // of bytes per frame = the size of outBuffer in bytes.
-            .mDataByteSize = static_cast<UInt32>(inIOBufferFrameSize * sizeof(Float32) * 2),
+            .mNumberChannels = mChannelCount,
+            // Each frame is mChannelCount Float32 samples (one per channel). The number of frames *
+            // the number of bytes per frame = the size of outBuffer in bytes.
+            .mDataByteSize = static_cast<UInt32>(inIOBufferFrameSize * sizeof(Float32) * mChannelCount),
             .mData = outBuffer
         }
     };
@@ -1559,16 +2324,35 @@ void	BGM_Device::ReadInputData(UInt32 inIOBufferFrameSize, Float64 inSampleTime,
     }
 }
 
-void	BGM_Device::WriteOutputData(UInt32 inIOBufferFrameSize, Float64 inSampleTime, const void* inBuffer)
+void	BGM_Device::WriteOutputData(UInt32 inIOBufferFrameSize,
+                                    Float64 inSampleTime,
+                                    bool inBufferIsSilent,
+                                    const void* inBuffer)
 {
+    // Instead of copying silent buffers into the ring buffer, just remember when the silence
+    // started. ReadInputData writes silence for the frames after that, and when the audio starts
+    // again, CARingBuffer::Store zeroes the frames it skipped over (once, rather than for every
+    // buffer).
+    if(inBufferIsSilent)
+    {
+        if(mLoopbackSilenceStartTime == -1)
+        {
+            mLoopbackSilenceStartTime = inSampleTime;
+        }
+
+        return;
+    }
+
+    mLoopbackSilenceStartTime = -1;
+
     // Wrap the provided buffer in an AudioBufferList.
     AudioBufferList abl = {
         .mNumberBuffers = 1,
         .mBuffers[0] = {
-            .mNumberChannels = 2,
-            // Each frame is 2 Float32 samples (one per channel). The number of frames * the number
-            // of bytes per frame = the size of inBuffer in bytes.
-            .mDataByteSize = static_cast<UInt32>(inIOBufferFrameSize * sizeof(Float32) * 2),
+            .mNumberChannels = mChannelCount,
+            // Each frame is mChannelCount Float32 samples (one per channel). The number of frames *
+            // the number of bytes per frame = the size of inBuffer in bytes.
+            .mDataByteSize = static_cast<UInt32>(inIOBufferFrameSize * sizeof(Float32) * mChannelCount),
             .mData = const_cast<void *>(inBuffer)
         }
     };
@@ -1587,50 +2371,98 @@ void	BGM_Device::WriteOutputData(UInt32 inIOBufferFrameSize, Float64 inSampleTim
     }
 }
 
-void	BGM_Device::ApplyClientRelativeVolume(UInt32 inClientID, UInt32 inIOBufferFrameSize, void* ioBuffer) const
+void	BGM_Device::ApplyClientRelativeVolume(UInt32 inClientID,
+                                              UInt32 inIOBufferFrameSize,
+                                              bool inBufferIsSilent,
+                                              void* ioBuffer)
 {
+    // Ramp to the client's new volume when it changes, rather than jumping to it, so it doesn't
+    // click.
+    Float32 theTargetRelativeVolume = mClients.GetClientRelativeVolumeRT(inClientID);
+    BGM_IOKernels::GainRamp theRelativeVolume;
+
+    {
+        // The ramps are only used on the IO thread, but the HAL could replace the IO thread while
+        // IO is running.
+        CAMutex::Locker theIOLocker(mIOMutex);
+        theRelativeVolume = mClientGainRamps.NextBufferRT(inClientID,
+                                                          theTargetRelativeVolume,
+                                                          inIOBufferFrameSize);
+    }
+
     Float32* theBuffer = reinterpret_cast<Float32*>(ioBuffer);
-    Float32 theRelativeVolume = mClients.GetClientRelativeVolumeRT(inClientID);
-    
-    auto thePanPositionInt = mClients.GetClientPanPositionRT(inClientID);
-    Float32 thePanPosition = static_cast<Float32>(thePanPositionInt) / 100.0f;
-    
-    // TODO When we get around to supporting devices with more than two channels it would be worth looking into
-    //      kAudioFormatProperty_PanningMatrix and kAudioFormatProperty_BalanceFade in AudioFormat.h.
-    
-    // TODO precompute matrix coefficients w/ volume and do everything in one pass
-    
-    // Apply balance w/ crossfeed to the frames in the buffer.
-    // Expect samples interleaved, starting with left
-    if (thePanPosition > 0.0f) {
-        for (UInt32 i = 0; i < inIOBufferFrameSize * 2; i += 2) {
-            auto L = i;
-            auto R = i + 1;
-            
-            theBuffer[R] = theBuffer[R] + theBuffer[L] * thePanPosition;
-            theBuffer[L] = theBuffer[L] * (1 - thePanPosition);
+    SInt32 thePanPosition = mClients.GetClientPanPositionRT(inClientID);
+
+    // Panning and scaling silence wouldn't change it. The ramp above still has to be advanced,
+    // though, so it stays in step with the client's buffers.
+    if(mLimiters.AreClientsEnabled())
+    {
+        // Limit the client's audio instead of clamping it, so boosted clients don't clip.
+        if(!inBufferIsSilent)
+        {
+            BGM_IOKernels::ApplyPan(theBuffer, inIOBufferFrameSize, mChannelCount, thePanPosition);
+            BGM_IOKernels::ApplyGain(theBuffer, inIOBufferFrameSize, mChannelCount, theRelativeVolume);
         }
-    } else if (thePanPosition < 0.0f) {
-        for (UInt32 i = 0; i < inIOBufferFrameSize * 2; i += 2) {
-            auto L = i;
-            auto R = i + 1;
-            
-            theBuffer[L] = theBuffer[L] + theBuffer[R] * (-thePanPosition);
-            theBuffer[R] = theBuffer[R] * (1 + thePanPosition);
+
+        // Before the limiter, so it catches any peaks the EQ adds. The limiter still has to see
+        // silent buffers because it delays the audio.
+        ApplyClientDSP(inClientID, inIOBufferFrameSize, inBufferIsSilent, theBuffer);
+
+        BGM_Limiter::Result theResult;
+
+        {
+            CAMutex::Locker theIOLocker(mIOMutex);
+            theResult = mLimiters.ProcessClientRT(inClientID,
+                                                  theBuffer,
+                                                  inIOBufferFrameSize,
+                                                  mChannelCount,
+                                                  mLoopbackSampleRate);
         }
-    }
 
-    if(theRelativeVolume != 1.0f)
+        mIOStats.RecordLimiter(kBGMIOStatsLimiter_Clients,
+                               inIOBufferFrameSize,
+                               theResult.mLimitedFrameCount,
+                               theResult.mMaxGainReductionDb);
+    }
+    else
     {
-        for(UInt32 i = 0; i < inIOBufferFrameSize * 2; i++)
+        if(!inBufferIsSilent)
         {
-            Float32 theAdjustedSample = theBuffer[i] * theRelativeVolume;
-            
-            // Clamp to [-1, 1].
-            // (This way is roughly 6 times faster than using std::min and std::max because the compiler can vectorize the loop.)
-            const Float32 theAdjustedSampleClippedBelow = theAdjustedSample < -1.0f ? -1.0f : theAdjustedSample;
-            theBuffer[i] = theAdjustedSampleClippedBelow > 1.0f ? 1.0f : theAdjustedSampleClippedBelow;
+            BGM_IOKernels::ApplyPanAndRelativeVolume(theBuffer,
+                                                     inIOBufferFrameSize,
+                                                     mChannelCount,
+                                                     thePanPosition,
+                                                     theRelativeVolume);
         }
+
+        ApplyClientDSP(inClientID, inIOBufferFrameSize, inBufferIsSilent, theBuffer);
+    }
+}
+
+void	BGM_Device::ApplyClientDSP(UInt32 inClientID,
+                                   UInt32 inIOBufferFrameSize,
+                                   bool inBufferIsSilent,
+                                   Float32* ioBuffer)
+{
+    // Skip looking up the client when no apps have DSP settings, which is the usual case.
+    if(!mClientDSP.HasAppsRT())
+    {
+        return;
+    }
+
+    SInt32 theDSPSlot = mClients.GetClientDSPSlotRT(inClientID);
+
+    if(theDSPSlot != -1)
+    {
+        // The clients' chains are only used on the IO thread. See mClientGainRamps.
+        CAMutex::Locker theIOLocker(mIOMutex);
+        mClientDSP.ProcessClientRT(inClientID,
+                                   theDSPSlot,
+                                   ioBuffer,
+                                   inIOBufferFrameSize,
+                                   mChannelCount,
+                                   mLoopbackSampleRate,
+                                   inBufferIsSilent);
     }
 }
 
@@ -1670,6 +2502,36 @@ void    BGM_Device::RequestEnabledControls(bool inVolumeEnabled, bool inMuteEnab
     }
 }
 
+void    BGM_Device::RequestBoostStageUpdate()
+{
+    CAMutex::Locker theStateLocker(mStateMutex);
+
+    bool theBoostStageNeeded = BGM_BoostStage::IsNeeded(mBoostControl.GetVolumeDb());
+
+    if(mBoostStage.NeedsUpdate(mBoostControl.GetVolumeDb()))
+    {
+        DebugMsg("BGM_Device::RequestBoostStageUpdate: %s boost stage",
+                 (theBoostStageNeeded ? "Enabling" : "Disabling"));
+
+        // The host only asks whether we'll do ProcessMix when IO starts, so ask it to reconfigure
+        // the device. PerformConfigChange checks the boost control again, so it's fine if it's
+        // changed back by then.
+        //
+        // Enabling the stage can't wait, but when disabling it we keep applying the boost until its
+        // gain has ramped down to unity. Otherwise the mix would jump from its boosted level to
+        // unity gain when the host restarts IO.
+        UInt64 theDelayNs = theBoostStageNeeded ? 0 :
+                BGM_BoostStage::GetDisableDelayNs(mBoostControl.GetGainRampLengthFrames(),
+                                                  mLoopbackSampleRate);
+        AudioObjectID theDeviceObjectID = GetObjectID();
+        UInt64 action = static_cast<UInt64>(ChangeAction::SetBoostStageEnabled);
+
+        CADispatchQueue::GetGlobalSerialQueue().Dispatch(theDelayNs, ^{
+            BGM_PlugIn::Host_RequestDeviceConfigurationChange(theDeviceObjectID, action, nullptr);
+        });
+    }
+}
+
 Float64	BGM_Device::GetSampleRate() const
 {
     // The sample rate is guarded by the state lock. Note that we don't need to take the IO lock.
@@ -1720,6 +2582,36 @@ void	BGM_Device::RequestSampleRate(Float64 inRequestedSampleRate)
     }
 }
 
+UInt32	BGM_Device::GetChannelCount() const
+{
+    return mChannelCount;
+}
+
+void	BGM_Device::RequestChannelCount(UInt32 inRequestedChannelCount)
+{
+    // Like the sample rate, this can only change while IO is stopped. See RequestSampleRate.
+    ThrowIf(!mOutputStream.IsSupportedChannelCount(inRequestedChannelCount),
+            CAException(kAudioDeviceUnsupportedFormatError),
+            "BGM_Device::RequestChannelCount: unsupported number of channels");
+
+    DebugMsg("BGM_Device::RequestChannelCount: Channel count change requested: %u",
+             inRequestedChannelCount);
+
+    CAMutex::Locker theStateLocker(mStateMutex);
+
+    if(inRequestedChannelCount != mChannelCount)
+    {
+        mPendingChannelCount = inRequestedChannelCount;
+
+        auto requestChannelCount = ^{
+			UInt64 action = static_cast<UInt64>(ChangeAction::SetChannelCount);
+            BGM_PlugIn::Host_RequestDeviceConfigurationChange(GetObjectID(), action, nullptr);
+        };
+
+        CADispatchQueue::GetGlobalSerialQueue().Dispatch(false, requestChannelCount);
+    }
+}
+
 BGM_Object&  BGM_Device::GetOwnedObjectByID(AudioObjectID inObjectID)
 {
 	// C++ is weird. See "Avoid Duplication in const and Non-const Member Functions" in Item 3 of Effective C++.
@@ -1744,6 +2636,10 @@ const BGM_Object&  BGM_Device::GetOwnedObjectByID(AudioObjectID inObjectID) cons
 	{
 		return mMuteControl;
 	}
+	else if(inObjectID == mBoostControl.GetObjectID())
+	{
+		return mBoostControl;
+	}
 	else
 	{
 		LogError("BGM_Device::GetOwnedObjectByID: Unknown object ID. inObjectID = %u", inObjectID);
@@ -1753,7 +2649,7 @@ const BGM_Object&  BGM_Device::GetOwnedObjectByID(AudioObjectID inObjectID) cons
 
 UInt32	BGM_Device::GetNumberOfSubObjects() const
 {
-	return kNumberOfInputSubObjects + GetNumberOfOutputSubObjects();
+	return kNumberOfInputSubObjects + GetNumberOfOutputSubObjects() + GetNumberOfGlobalControls();
 }
 
 UInt32	BGM_Device::GetNumberOfOutputSubObjects() const
@@ -1780,6 +2676,13 @@ UInt32	BGM_Device::GetNumberOfOutputControls() const
     return theAnswer;
 }
 
+UInt32	BGM_Device::GetNumberOfGlobalControls() const
+{
+	CAMutex::Locker theStateLocker(mStateMutex);
+
+    return mBoostControl.IsActive() ? 1 : 0;
+}
+
 void    BGM_Device::SetEnabledControls(bool inVolumeEnabled, bool inMuteEnabled)
 {
     CAMutex::Locker theStateLocker(mStateMutex);
@@ -1813,6 +2716,8 @@ void    BGM_Device::SetEnabledControls(bool inVolumeEnabled, bool inMuteEnabled)
 			mMuteControl.Deactivate();
 		}
     }
+
+    RequestPersistentStateSave();
 }
 
 void BGM_Device::SetSampleRate(Float64 inSampleRate, bool force)
@@ -1856,11 +2761,155 @@ void BGM_Device::SetSampleRate(Float64 inSampleRate, bool force)
     }
 }
 
+void    BGM_Device::SetChannelCount(UInt32 inNewChannelCount)
+{
+    ThrowIf(!mOutputStream.IsSupportedChannelCount(inNewChannelCount),
+            CAException(kAudioDeviceUnsupportedFormatError),
+            "BGM_Device::SetChannelCount: unsupported number of channels");
+
+    CAMutex::Locker theStateLocker(mStateMutex);
+
+    if(inNewChannelCount != mChannelCount)
+    {
+        DebugMsg("BGM_Device::SetChannelCount: Changing the number of channels from %u to %u",
+                 mChannelCount,
+                 inNewChannelCount);
+
+        // The loopback buffer's frames change size, so it has to be reallocated. The limiters and
+        // DSP chains reset themselves the next time they're given a different number of channels.
+        mChannelCount = inNewChannelCount;
+        InitLoopback();
+
+        mInputStream.SetChannelCount(inNewChannelCount);
+        mOutputStream.SetChannelCount(inNewChannelCount);
+    }
+}
+
 bool    BGM_Device::IsStreamID(AudioObjectID inObjectID) const noexcept
 {
     return (inObjectID == mInputStream.GetObjectID()) || (inObjectID == mOutputStream.GetObjectID());
 }
 
+#pragma mark Persistent State
+
+void    BGM_Device::RestorePersistentState()
+{
+    if(GetObjectID() != kObjectID_Device)
+    {
+        // Only the main instance saves its settings.
+        return;
+    }
+
+    CFPropertyListRef theData = NULL;
+    OSStatus theError = BGM_PlugIn::Host_CopyFromStorage(CFSTR(kPersistentStateStorageKey), &theData);
+
+    if(theError != kAudioHardwareNoError || theData == NULL)
+    {
+        DebugMsg("BGM_Device::RestorePersistentState: No saved state. theError=%d", theError);
+        return;
+    }
+
+    BGM_PersistentState::State theState;
+    bool theStateIsValid = false;
+
+    if(CFGetTypeID(theData) == CFDataGetTypeID())
+    {
+        CFDataRef theDataRef = static_cast<CFDataRef>(theData);
+        theStateIsValid = BGM_PersistentState::Decode(CFDataGetBytePtr(theDataRef),
+                                                      static_cast<size_t>(CFDataGetLength(theDataRef)),
+                                                      theState);
+    }
+
+    CFRelease(theData);
+
+    if(!theStateIsValid)
+    {
+        // Probably saved by a newer version of BGMDriver. It will be overwritten with the current
+        // format the next time the settings change.
+        LogWarning("BGM_Device::RestorePersistentState: Ignoring saved state in an unknown format");
+        return;
+    }
+
+    mClients.RestorePastClients(theState.mApps);
+
+    if(theState.mMusicPlayerBundleID.IsValid())
+    {
+        mClients.SetMusicPlayer(theState.mMusicPlayerBundleID);
+    }
+
+    // Activate only activates the controls that are enabled.
+    mPendingOutputVolumeControlEnabled = theState.mVolumeControlEnabled;
+    mPendingOutputMuteControlEnabled = theState.mMuteControlEnabled;
+
+    UInt64 theRestoreNs = CAHostTimeBase::ConvertToNanos(CAHostTimeBase::GetTheCurrentTime() -
+                                                         BGM_PlugIn::GetLoadHostTime());
+    (void)theRestoreNs;  // Suppress the unused variable warning in release builds.
+
+    DebugMsg("BGM_Device::RestorePersistentState: Restored the settings for %lu apps %llu us after "
+             "the driver was loaded",
+             static_cast<unsigned long>(theState.mApps.size()),
+             theRestoreNs / NSEC_PER_USEC);
+}
+
+void    BGM_Device::RequestPersistentStateSave()
+{
+    if(GetObjectID() != kObjectID_Device)
+    {
+        return;
+    }
+
+    // Wait until the settings stop changing, e.g. when the user is dragging an app volume slider,
+    // before writing them. WriteToStorage makes the host write to disk.
+    UInt64 theChangeCount = ++mPersistentStateChangeCount;
+
+    CADispatchQueue::GetGlobalSerialQueue().Dispatch(kPersistentStateSaveDelayNs, ^{
+        if(mPersistentStateChangeCount == theChangeCount)
+        {
+            BGMLogAndSwallowExceptions("BGM_Device::RequestPersistentStateSave", [&] {
+                SavePersistentState();
+            });
+        }
+    });
+}
+
+void    BGM_Device::SavePersistentState()
+{
+    BGM_PersistentState::State theState;
+
+    {
+        CAMutex::Locker theStateLocker(mStateMutex);
+        theState.mVolumeControlEnabled = mVolumeControl.IsActive();
+        theState.mMuteControlEnabled = mMuteControl.IsActive();
+    }
+
+    theState.mMusicPlayerBundleID = CACFString(mClients.CopyMusicPlayerBundleIDProperty());
+    theState.mApps = mClients.CopyClientsForStorage();
+
+    std::vector<UInt8> theEncodedState = BGM_PersistentState::Encode(theState);
+
+    CFDataRef theData = CFDataCreate(kCFAllocatorDefault,
+                                     theEncodedState.data(),
+                                     static_cast<CFIndex>(theEncodedState.size()));
+    ThrowIfNULL(theData,
+                CAException(kAudioHardwareUnspecifiedError),
+                "BGM_Device::SavePersistentState: CFDataCreate failed");
+
+    OSStatus theError = BGM_PlugIn::Host_WriteToStorage(CFSTR(kPersistentStateStorageKey), theData);
+    CFRelease(theData);
+
+    if(theError != kAudioHardwareNoError)
+    {
+        // Not worth stopping debug builds for. The settings will be saved again the next time they
+        // change.
+        LogWarning("BGM_Device::SavePersistentState: WriteToStorage failed. theError=%d", theError);
+        return;
+    }
+
+    DebugMsg("BGM_Device::SavePersistentState: Saved %lu bytes for %lu apps",
+             static_cast<unsigned long>(theEncodedState.size()),
+             static_cast<unsigned long>(theState.mApps.size()));
+}
+
 #pragma mark Hardware Accessors
 
 // TODO: Out of laziness, some of these hardware functions do more than their names suggest
@@ -1890,6 +2939,10 @@ kern_return_t	BGM_Device::_HW_StartIO()
 	// at a time).
 	BGMAssert(mIOMutex.IsFree(), "BGM_Device::_HW_StartIO: IO mutex taken before starting IO");
     mAudibleState.Reset();
+    mMusicDucker.Reset();
+    mLimiters.Reset();
+    mClientDSP.Reset();
+    mLoopbackSilenceStartTime = -1;
     
     return KERN_SUCCESS;
 }
@@ -1939,6 +2992,16 @@ void	BGM_Device::AddClient(const AudioServerPlugInClientInfo* inClientInfo)
     CAMutex::Locker theStateLocker(mStateMutex);
 
     mClients.AddClient(inClientInfo);
+
+    // If the client's app has DSP settings, give the client the app's slot. The client info's
+    // bundle ID is owned by the host, so it's wrapped without being retained or released.
+    BGM_String theBundleID(inClientInfo->mBundleID, false);
+    SInt32 theDSPSlot = mClientDSP.FindApp(inClientInfo->mProcessID, theBundleID);
+
+    if(theDSPSlot != -1)
+    {
+        mClients.SetClientsDSPSlot(inClientInfo->mProcessID, theBundleID, theDSPSlot);
+    }
 }
 
 void	BGM_Device::RemoveClient(const AudioServerPlugInClientInfo* inClientInfo)
@@ -1972,10 +3035,54 @@ void	BGM_Device::PerformConfigChange(UInt64 inChangeAction, void* inChangeInfo)
             SetSampleRate(mPendingSampleRate);
             break;
 
+        case ChangeAction::SetChannelCount:
+            SetChannelCount(mPendingChannelCount);
+            break;
+
         case ChangeAction::SetEnabledControls:
             SetEnabledControls(mPendingOutputVolumeControlEnabled,
                                mPendingOutputMuteControlEnabled);
             break;
+
+        case ChangeAction::SetBoostStageEnabled:
+            {
+                CAMutex::Locker theStateLocker(mStateMutex);
+                CAMutex::Locker theIOLocker(mIOMutex);
+
+                UInt32 theOldLatencyFrames = mLimiters.GetLatencyFrames();
+
+                if(mBoostStage.Update(mBoostControl.GetVolumeDb()))
+                {
+                    // The mix hasn't been boosted since the stage was disabled, so ramp up from
+                    // unity gain rather than from whatever gain was applied last.
+                    mBoostControl.ResetGainRamp(1.0f);
+                }
+
+                DebugMsg("BGM_Device::PerformConfigChange: Boost stage %s",
+                         (mBoostStage.IsEnabled() ? "enabled" : "disabled"));
+
+                // The boost stage requires the mix limiter, which changes the device's latency if
+                // the user hasn't enabled the mix limiter anyway.
+                if(mLimiters.GetLatencyFrames() != theOldLatencyFrames)
+                {
+                    AudioObjectID theDeviceObjectID = GetObjectID();
+
+                    CADispatchQueue::GetGlobalSerialQueue().Dispatch(false, ^{
+                        AudioObjectPropertyAddress theChangedProperties[] = {
+                            { kAudioDevicePropertyLatency,
+                              kAudioObjectPropertyScopeOutput,
+                              kAudioObjectPropertyElementMaster },
+                            { kAudioDevicePropertyLatency,
+                              kAudioObjectPropertyScopeInput,
+                              kAudioObjectPropertyElementMaster }
+                        };
+                        BGM_PlugIn::Host_PropertiesChanged(theDeviceObjectID,
+                                                           2,
+                                                           theChangedProperties);
+                    });
+                }
+            }
+            break;
     }
 }
 
@@ -37,15 +37,25 @@
 #include "BGM_Clients.h"
 #include "BGM_TaskQueue.h"
 #include "BGM_AudibleState.h"
+#include "BGM_BoostStage.h"
+#include "BGM_GainRamp.h"
+#include "BGM_ClientDSP.h"
+#include "BGM_IOStats.h"
+#include "BGM_Limiter.h"
+#include "BGM_MusicDucker.h"
 #include "BGM_Stream.h"
 #include "BGM_VolumeControl.h"
 #include "BGM_MuteControl.h"
+#include "BGM_PropertyTable.h"
 
 // PublicUtility Includes
 #include "CAMutex.h"
 #include "CAVolumeCurve.h"
 #include "CARingBuffer.h"
 
+// STL Includes
+#include <atomic>
+
 // System Includes
 #include <CoreFoundation/CoreFoundation.h>
 #include <pthread.h>
@@ -73,7 +83,8 @@ protected:
                                            AudioObjectID inInputStreamID,
                                            AudioObjectID inOutputStreamID,
                                            AudioObjectID inOutputVolumeControlID,
-										   AudioObjectID inOutputMuteControlID);
+										   AudioObjectID inOutputMuteControlID,
+                                           AudioObjectID inBoostControlID);
     virtual						~BGM_Device();
     
     virtual void				Activate();
@@ -100,6 +111,13 @@ private:
 	void						Device_GetPropertyData(AudioObjectID inObjectID, pid_t inClientPID, const AudioObjectPropertyAddress& inAddress, UInt32 inQualifierDataSize, const void* __nullable inQualifierData, UInt32 inDataSize, UInt32& outDataSize, void* __nonnull outData) const;
 	void						Device_SetPropertyData(AudioObjectID inObjectID, pid_t inClientPID, const AudioObjectPropertyAddress& inAddress, UInt32 inQualifierDataSize, const void* __nullable inQualifierData, UInt32 inDataSize, const void* __nonnull inData);
 
+	static const BGM_PropertyTable<BGM_Device>& GetPropertyTable();
+	// The sizes of the properties whose sizes depend on the address's scope or the enabled controls.
+	UInt32						GetOwnedObjectsDataSize(const AudioObjectPropertyAddress& inAddress) const;
+	UInt32						GetStreamsDataSize(const AudioObjectPropertyAddress& inAddress) const;
+	UInt32						GetControlListDataSize(const AudioObjectPropertyAddress& inAddress) const;
+	UInt32						GetPreferredChannelLayoutDataSize(const AudioObjectPropertyAddress& inAddress) const;
+
 #pragma mark IO Operations
     
 public:
@@ -115,8 +133,13 @@ public:
 
 private:
 	void						ReadInputData(UInt32 inIOBufferFrameSize, Float64 inSampleTime, void* __nonnull outBuffer);
-    void						WriteOutputData(UInt32 inIOBufferFrameSize, Float64 inSampleTime, const void* __nonnull inBuffer);
-    void                        ApplyClientRelativeVolume(UInt32 inClientID, UInt32 inIOBufferFrameSize, void* __nonnull inBuffer) const;
+    // inBufferIsSilent should be true if every sample in inBuffer is 0. Silent buffers aren't
+    // stored. See mLoopbackSilenceStartTime.
+    void						WriteOutputData(UInt32 inIOBufferFrameSize, Float64 inSampleTime, bool inBufferIsSilent, const void* __nonnull inBuffer);
+    // Silent buffers (see BGM_AudibleState::LastBufferWasSilent) skip the processing that wouldn't
+    // change them.
+    void                        ApplyClientRelativeVolume(UInt32 inClientID, UInt32 inIOBufferFrameSize, bool inBufferIsSilent, void* __nonnull inBuffer);
+    void                        ApplyClientDSP(UInt32 inClientID, UInt32 inIOBufferFrameSize, bool inBufferIsSilent, Float32* __nonnull ioBuffer);
 
 #pragma mark Accessors
 
@@ -132,6 +155,15 @@ public:
     Float64						GetSampleRate() const;
     void                        RequestSampleRate(Float64 inRequestedSampleRate);
 
+    /*! The number of channels in both of the device's streams. See BGM_Stream. */
+    UInt32                      GetChannelCount() const;
+    /*!
+     Change the number of channels in the device's streams. Async, like RequestSampleRate.
+
+     @throws CAException if the streams don't support inRequestedChannelCount.
+     */
+    void                        RequestChannelCount(UInt32 inRequestedChannelCount);
+
 private:
 	/*!
      @return The Audio Object that has the ID inObjectID and belongs to this device.
@@ -149,6 +181,8 @@ private:
 	         output volume and mute controls.
 	 */
     UInt32 						GetNumberOfOutputControls() const;
+	/*! @return The number of control Audio Objects with global scope, i.e. the boost control. */
+    UInt32 						GetNumberOfGlobalControls() const;
     /*!
      Enable or disable the device's volume and/or mute controls.
 
@@ -171,6 +205,34 @@ private:
              fails.
      */
     void                        SetSampleRate(Float64 inNewSampleRate, bool force = false);
+    /*!
+     Set the number of channels in the device's streams and its loopback buffer.
+
+     Private for the same reason as SetSampleRate.
+     */
+    void                        SetChannelCount(UInt32 inNewChannelCount);
+    /*!
+     Ask the host to reconfigure the device if the boost control has moved to or from 0 dB, so it
+     asks again whether the device will do kAudioServerPlugInIOOperationProcessMix. When the boost
+     moves to 0 dB, the request is delayed until its gain has ramped down to unity, so disabling
+     the boost stage doesn't make the mix's level jump.
+     */
+    void                        RequestBoostStageUpdate();
+
+    /*!
+     Restore the settings SavePersistentState saved in the host's storage: the apps' relative
+     volumes and pan positions, the music player's bundle ID and which output controls are enabled.
+     Called by Activate, before the host adds any clients. Does nothing for the UI sounds instance,
+     which doesn't save its settings. The state mutex must be held.
+     */
+    void                        RestorePersistentState();
+    /*!
+     Save the settings after kPersistentStateSaveDelayNs, on a non-real-time queue. Changes made
+     before then are saved together.
+     */
+    void                        RequestPersistentStateSave();
+    /*! Write the settings to the host's storage. See BGM_PersistentState for the format. */
+    void                        SavePersistentState();
 
     /*! @return True if inObjectID is the ID of one of this device's streams. */
     inline bool                 IsStreamID(AudioObjectID inObjectID) const noexcept;
@@ -208,6 +270,8 @@ private:
     #define kDeviceName                 "Background Music"
     #define kDeviceName_UISounds        "Background Music (UI Sounds)"
     #define kDeviceManufacturerName     "Background Music contributors"
+    // The key the main instance's settings are saved under in the host's storage.
+    #define kPersistentStateStorageKey  "Device State"
 
 	const CFStringRef __nonnull	mDeviceName;
 	const CFStringRef __nonnull mDeviceUID;
@@ -220,7 +284,13 @@ private:
 
 								kNumberOfStreams					= 2,
 								kNumberOfInputStreams				= 1,
-								kNumberOfOutputStreams				= 1
+								kNumberOfOutputStreams				= 1,
+
+#if BGM_IOStatsEnabled
+								kNumberOfCustomProperties			= 12
+#else
+								kNumberOfCustomProperties			= 11
+#endif
 	};
 
     CAMutex                     mStateMutex;
@@ -230,6 +300,11 @@ private:
     // Before we can change sample rate, the host has to stop the device. The new sample rate is
     // stored here while it does.
     Float64                     mPendingSampleRate = kSampleRateDefault;
+    // The number of channels in the streams, the loopback buffer and the buffers passed to
+    // DoIOOperation. Like mLoopbackSampleRate, it only changes while the host has stopped IO, so the
+    // IO functions can read it without taking the state lock.
+    UInt32                      mChannelCount = 2;
+    UInt32                      mPendingChannelCount = 2;
     
     BGM_WrappedAudioEngine* __nullable mWrappedAudioEngine;
     
@@ -240,6 +315,10 @@ private:
     #define kLoopbackRingBufferFrameSize    16384
     Float64                     mLoopbackSampleRate;
     CARingBuffer                mLoopbackRingBuffer;
+    // The sample time of the first frame of the current run of silent mixes, which aren't stored
+    // in mLoopbackRingBuffer, or -1 if the last mix wasn't silent. Only used on the IO thread, with
+    // the IO mutex held.
+    Float64                     mLoopbackSilenceStartTime = -1;
 
     // TODO: a comment explaining why we need a clock for loopback-only mode
     struct {
@@ -253,10 +332,30 @@ private:
 
     BGM_AudibleState            mAudibleState;
 
+    // Smooths changes to the clients' relative volumes (i.e. app volumes). Only used during IO.
+    BGM_ClientGainRamps         mClientGainRamps;
+
+    // Ducks the music player for kAudioDeviceCustomPropertyMusicDucking. Its IO state is guarded by
+    // the IO mutex.
+    BGM_MusicDucker             mMusicDucker;
+
+    // The soft limiters for the clients and the mix, for kAudioDeviceCustomPropertyLimiter. Their
+    // IO state is guarded by the IO mutex.
+    BGM_Limiters                mLimiters;
+
+    // The apps' EQs and compressors, for kAudioDeviceCustomPropertyAppDSP. The clients' chains are
+    // guarded by the IO mutex.
+    BGM_ClientDSP               mClientDSP;
+
+    // Timings of the IO operations for kAudioDeviceCustomPropertyIOStats.
+    BGM_IOStats                 mIOStats;
+
     enum class ChangeAction : UInt64
     {
         SetSampleRate,
-        SetEnabledControls
+        SetChannelCount,
+        SetEnabledControls,
+        SetBoostStageEnabled
     };
 
     BGM_VolumeControl			mVolumeControl;
@@ -264,6 +363,19 @@ private:
     bool                        mPendingOutputVolumeControlEnabled = true;
     bool                        mPendingOutputMuteControlEnabled   = true;
 
+    // The system-wide volume boost, from 0 dB to +12 dB. Only the main instance has one. It's applied
+    // to the mix in kAudioServerPlugInIOOperationProcessMix, before the mix limiter.
+    BGM_VolumeControl           mBoostControl;
+    // Enabled if the boost control isn't at 0 dB, in which case the device does ProcessMix and the
+    // mix limiter is kept enabled. Only updated in PerformConfigChange, while the host has stopped
+    // IO, because the host only calls WillDoIOOperation when IO starts.
+    BGM_BoostStage              mBoostStage;
+
+    // Incremented by RequestPersistentStateSave, so the saves it queues can tell whether the
+    // settings have changed again since.
+    std::atomic<UInt64>         mPersistentStateChangeCount { 0 };
+    static const UInt64         kPersistentStateSaveDelayNs = 1 * NSEC_PER_SEC;
+
 };
 
 #endif /* BGMDriver__BGM_Device */
@@ -0,0 +1,157 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_GainRamp.cpp
+//  BGMDriver
+//
+//  Copyright © 2026 Kyle Neideck
+//
+
+// Self Include
+#include "BGM_GainRamp.h"
+
+// STL Includes
+#include <algorithm>
+
+
+#pragma clang assume_nonnull begin
+
+#pragma mark BGM_GainRamp
+
+BGM_GainRamp::BGM_GainRamp(Float32 inInitialGain)
+:
+    mCurrentGain(inInitialGain),
+    mTargetGain(inInitialGain),
+    mGainPerFrame(0.0f),
+    mFramesLeft(0)
+{
+}
+
+void    BGM_GainRamp::Reset(Float32 inGain)
+{
+    mCurrentGain = inGain;
+    mTargetGain = inGain;
+    mGainPerFrame = 0.0f;
+    mFramesLeft = 0;
+}
+
+BGM_IOKernels::GainRamp BGM_GainRamp::NextBuffer(Float32 inTargetGain,
+                                                 UInt32 inFrameCount,
+                                                 UInt32 inLengthFrames)
+{
+    if(inTargetGain != mTargetGain)
+    {
+        if(inLengthFrames == 0)
+        {
+            Reset(inTargetGain);
+        }
+        else
+        {
+            // Start the new ramp from wherever the last one got to, so the gain stays continuous
+            // even if the target changes part way through a ramp.
+            mTargetGain = inTargetGain;
+            mGainPerFrame = (mTargetGain - mCurrentGain) / static_cast<Float32>(inLengthFrames);
+            mFramesLeft = inLengthFrames;
+        }
+    }
+
+    BGM_IOKernels::GainRamp theRamp;
+    theRamp.mStartGain = mCurrentGain;
+    theRamp.mGainPerFrame = mGainPerFrame;
+    theRamp.mRampFrameCount = std::min(inFrameCount, mFramesLeft);
+
+    mFramesLeft -= theRamp.mRampFrameCount;
+
+    if(mFramesLeft == 0)
+    {
+        // Finish exactly on the target rather than wherever the rounding errors would leave us.
+        mCurrentGain = mTargetGain;
+        mGainPerFrame = 0.0f;
+    }
+    else
+    {
+        mCurrentGain += mGainPerFrame * static_cast<Float32>(theRamp.mRampFrameCount);
+    }
+
+    theRamp.mEndGain = mCurrentGain;
+
+    return theRamp;
+}
+
+#pragma mark BGM_ClientGainRamps
+
+BGM_ClientGainRamps::BGM_ClientGainRamps()
+:
+    mUseCounter(0),
+    mRampLengthFrames(BGM_GainRamp::kDefaultLengthFrames)
+{
+    for(Entry& theEntry : mEntries)
+    {
+        theEntry.mInUse = false;
+        theEntry.mClientID = 0;
+        theEntry.mLastUsed = 0;
+    }
+}
+
+void    BGM_ClientGainRamps::SetRampLengthFrames(UInt32 inLengthFrames)
+{
+    mRampLengthFrames.store(BGM_GainRamp::ClampLengthFrames(inLengthFrames),
+                            std::memory_order_relaxed);
+}
+
+UInt32  BGM_ClientGainRamps::GetRampLengthFrames() const
+{
+    return mRampLengthFrames.load(std::memory_order_relaxed);
+}
+
+BGM_IOKernels::GainRamp BGM_ClientGainRamps::NextBufferRT(UInt32 inClientID,
+                                                          Float32 inTargetGain,
+                                                          UInt32 inFrameCount)
+{
+    // A linear search is fine for this many entries and is easy to keep real-time safe.
+    Entry* theEntry = nullptr;
+    Entry* theLeastRecentlyUsed = &mEntries[0];
+
+    for(Entry& theCandidate : mEntries)
+    {
+        if(theCandidate.mInUse && (theCandidate.mClientID == inClientID))
+        {
+            theEntry = &theCandidate;
+            break;
+        }
+
+        if(!theCandidate.mInUse ||
+           (theLeastRecentlyUsed->mInUse && (theCandidate.mLastUsed < theLeastRecentlyUsed->mLastUsed)))
+        {
+            theLeastRecentlyUsed = &theCandidate;
+        }
+    }
+
+    if(!theEntry)
+    {
+        theEntry = theLeastRecentlyUsed;
+        theEntry->mInUse = true;
+        theEntry->mClientID = inClientID;
+        theEntry->mRamp.Reset(inTargetGain);
+    }
+
+    theEntry->mLastUsed = ++mUseCounter;
+
+    return theEntry->mRamp.NextBuffer(inTargetGain, inFrameCount, GetRampLengthFrames());
+}
+
+#pragma clang assume_nonnull end
+
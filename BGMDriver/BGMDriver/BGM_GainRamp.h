@@ -0,0 +1,153 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_GainRamp.h
+//  BGMDriver
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  Smooths changes in gain so they don't click. When the volume changes, instead of jumping
+//  straight to the new gain at the start of the next IO buffer, we move to it linearly over a
+//  fixed number of frames, which can span several buffers. The ramps are generated inside the
+//  gain loops in BGM_IOKernels, so they don't add any passes over the audio.
+//
+//  The target gains are set on non-real-time threads, but BGM_GainRamp itself only keeps the
+//  IO thread's state, so it doesn't need any synchronisation. The owner passes in the current
+//  target each IO cycle.
+//
+
+#ifndef BGMDriver__BGM_GainRamp
+#define BGMDriver__BGM_GainRamp
+
+// Local Includes
+#include "BGM_IOKernels.h"
+#include "BGM_Types.h"
+
+// STL Includes
+#include <atomic>
+
+// System Includes
+#include <MacTypes.h>
+
+
+#pragma clang assume_nonnull begin
+
+class BGM_GainRamp
+{
+
+public:
+    // About 10 ms at 48 kHz. Long enough to be click-free without making the volume feel laggy.
+    static const UInt32         kDefaultLengthFrames = kBGMVolumeRampDefaultLengthFrames;
+    // About a second at 48 kHz. Longer ramps would make volume changes feel broken.
+    static const UInt32         kMaxLengthFrames = kBGMVolumeRampMaxLengthFrames;
+
+    /*! @return inLengthFrames limited to kMaxLengthFrames. */
+    static UInt32               ClampLengthFrames(UInt32 inLengthFrames)
+                                {
+                                    return (inLengthFrames > kMaxLengthFrames) ?
+                                            kMaxLengthFrames : inLengthFrames;
+                                }
+
+public:
+    explicit                    BGM_GainRamp(Float32 inInitialGain = 1.0f);
+
+    /*!
+     Jump to inGain without ramping. Real-time safe.
+     */
+    void                        Reset(Float32 inGain);
+
+    /*!
+     Get the gains to apply to the next IO buffer and advance the ramp past it. If inTargetGain
+     isn't the target of the current ramp, a new ramp starts from the current gain and reaches
+     inTargetGain after inLengthFrames frames.
+
+     Real-time safe, but not thread safe. Should only be called on the IO thread.
+
+     @param inTargetGain The gain to ramp to.
+     @param inFrameCount The number of frames in the IO buffer.
+     @param inLengthFrames The length of the ramp, if a new one starts. 0 to jump straight to
+                           inTargetGain.
+     @return The gains for each frame of the buffer. Pass this to one of the BGM_IOKernels
+             functions that take a GainRamp.
+     */
+    BGM_IOKernels::GainRamp     NextBuffer(Float32 inTargetGain,
+                                           UInt32 inFrameCount,
+                                           UInt32 inLengthFrames);
+
+    Float32                     GetCurrentGain() const { return mCurrentGain; }
+    bool                        IsRamping() const { return mFramesLeft > 0; }
+
+private:
+    Float32                     mCurrentGain;
+    Float32                     mTargetGain;
+    Float32                     mGainPerFrame;
+    UInt32                      mFramesLeft;
+
+};
+
+//==================================================================================================
+//	BGM_ClientGainRamps
+//
+//  A BGM_GainRamp for each client's relative volume. The IO thread owns the ramps, so this doesn't
+//  allocate or lock. It holds a fixed number of ramps and reuses the least recently used one if a
+//  client needs a ramp when they're all taken, which only resets that client's ramp.
+//==================================================================================================
+
+class BGM_ClientGainRamps
+{
+
+public:
+                                BGM_ClientGainRamps();
+                                BGM_ClientGainRamps(const BGM_ClientGainRamps&) = delete;
+                                BGM_ClientGainRamps& operator=(const BGM_ClientGainRamps&) = delete;
+
+    /*!
+     Set the length of the ramps that start after this call. Lengths over
+     BGM_GainRamp::kMaxLengthFrames are clamped. Can be called from any thread.
+     */
+    void                        SetRampLengthFrames(UInt32 inLengthFrames);
+    UInt32                      GetRampLengthFrames() const;
+
+    /*!
+     BGM_GainRamp::NextBuffer for a client's ramp. A client without a ramp starts at its target
+     gain, so new clients don't fade in. Real-time safe. Should only be called on the IO thread.
+     */
+    BGM_IOKernels::GainRamp     NextBufferRT(UInt32 inClientID,
+                                             Float32 inTargetGain,
+                                             UInt32 inFrameCount);
+
+private:
+    struct Entry
+    {
+        bool                    mInUse;
+        UInt32                  mClientID;
+        UInt64                  mLastUsed;
+        BGM_GainRamp            mRamp;
+    };
+
+    // More than the number of clients that usually play audio at the same time.
+    static const UInt32         kMaxClients = 64;
+
+    Entry                       mEntries[kMaxClients];
+    UInt64                      mUseCounter;
+    std::atomic<UInt32>         mRampLengthFrames;
+
+};
+
+#pragma clang assume_nonnull end
+
+#endif /* BGMDriver__BGM_GainRamp */
+
@@ -0,0 +1,545 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_IOKernels.cpp
+//  BGMDriver
+//
+//  Copyright © 2026 Kyle Neideck
+//
+
+// Self Include
+#include "BGM_IOKernels.h"
+
+// Local Includes
+#include "BGM_Platform.h"
+#include "BGM_Types.h"
+
+// STL Includes
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// System Includes
+#if BGM_PLATFORM_MACH
+#include <Accelerate/Accelerate.h>
+#endif
+
+
+#pragma clang assume_nonnull begin
+
+namespace BGM_IOKernels
+{
+    // Clamp to [-1, 1].
+    // (This way is roughly 6 times faster than using std::min and std::max because the compiler can vectorize the loop.)
+    static inline Float32 ClampSample(Float32 inSample)
+    {
+        const Float32 theSampleClippedBelow = inSample < -1.0f ? -1.0f : inSample;
+        return theSampleClippedBelow > 1.0f ? 1.0f : theSampleClippedBelow;
+    }
+
+    // The kernels that depend on the channel count. See DispatchOnChannelCount. kChannels is 0 when
+    // the channel count is only known at runtime.
+
+    // Multiplies kFrames consecutive frames by the gain matrix. All of the frames are read before
+    // any are written, which lets the compiler use SIMD across frames, e.g. two stereo frames in one
+    // vector.
+    template <UInt32 kFrames>
+    static inline void ApplyGainMatrixToFrames(UInt32 inChannelCount,
+                                               Float32* ioSamples,
+                                               const Float32 (&inGains)[kMaxChannelCount][kMaxChannelCount])
+    {
+        Float32 theInput[kFrames * kMaxChannelCount];
+
+        for(UInt32 i = 0; i < kFrames * inChannelCount; i++)
+        {
+            theInput[i] = ioSamples[i];
+        }
+
+        for(UInt32 theFrame = 0; theFrame < kFrames; theFrame++)
+        {
+            const Float32* theFrameInput = theInput + theFrame * inChannelCount;
+
+            for(UInt32 theOut = 0; theOut < inChannelCount; theOut++)
+            {
+                Float32 theSample = theFrameInput[0] * inGains[theOut][0];
+
+                for(UInt32 theIn = 1; theIn < inChannelCount; theIn++)
+                {
+                    theSample += theFrameInput[theIn] * inGains[theOut][theIn];
+                }
+
+                ioSamples[theFrame * inChannelCount + theOut] = theSample;
+            }
+        }
+    }
+
+    template <UInt32 kChannels>
+    struct GainMatrixKernel
+    {
+        static void Run(UInt32 inChannelCount,
+                        Float32* ioBuffer,
+                        UInt32 inFrameCount,
+                        const GainMatrix* inMatrix)
+        {
+            const UInt32 theChannels = (kChannels != 0) ? kChannels : inChannelCount;
+
+            // Copy the gains so the compiler knows writing to the buffer doesn't change them.
+            Float32 theGains[kMaxChannelCount][kMaxChannelCount];
+            memcpy(theGains, inMatrix->mGains, sizeof(theGains));
+
+            UInt32 theFrame = 0;
+
+            for(; theFrame + 2 <= inFrameCount; theFrame += 2)
+            {
+                ApplyGainMatrixToFrames<2>(theChannels, ioBuffer + theFrame * theChannels, theGains);
+            }
+
+            if(theFrame < inFrameCount)
+            {
+                ApplyGainMatrixToFrames<1>(theChannels, ioBuffer + theFrame * theChannels, theGains);
+            }
+        }
+    };
+
+    template <UInt32 kChannels>
+    struct RelativeVolumeKernel
+    {
+        static void Run(UInt32 inChannelCount,
+                        Float32* ioBuffer,
+                        UInt32 inFrameCount,
+                        const GainRamp* inRelativeVolume)
+        {
+            const UInt32 theChannels = (kChannels != 0) ? kChannels : inChannelCount;
+            // Copied so the compiler knows writing to the buffer doesn't change it.
+            const GainRamp theRelativeVolume = *inRelativeVolume;
+
+            // The frames in the ramp (if there is one) get their own gain each.
+            // (Looping over the samples rather than the frames lets the compiler vectorize it.)
+            for(UInt32 i = 0; i < theRelativeVolume.mRampFrameCount * theChannels; i++)
+            {
+                const Float32 theGain =
+                        theRelativeVolume.mStartGain +
+                        static_cast<Float32>(i / theChannels) * theRelativeVolume.mGainPerFrame;
+                ioBuffer[i] = ClampSample(ioBuffer[i] * theGain);
+            }
+
+            if(theRelativeVolume.mEndGain != 1.0f)
+            {
+                for(UInt32 i = theRelativeVolume.mRampFrameCount * theChannels;
+                    i < inFrameCount * theChannels;
+                    i++)
+                {
+                    ioBuffer[i] = ClampSample(ioBuffer[i] * theRelativeVolume.mEndGain);
+                }
+            }
+        }
+    };
+
+    template <UInt32 kChannels>
+    struct GainRampKernel
+    {
+        static void Run(UInt32 inChannelCount,
+                        Float32* ioBuffer,
+                        UInt32 inRampFrameCount,
+                        Float32 inStartGain,
+                        Float32 inGainPerFrame)
+        {
+            const UInt32 theChannels = (kChannels != 0) ? kChannels : inChannelCount;
+
+            for(UInt32 i = 0; i < inRampFrameCount * theChannels; i++)
+            {
+                ioBuffer[i] *= inStartGain + static_cast<Float32>(i / theChannels) * inGainPerFrame;
+            }
+        }
+    };
+
+    template <UInt32 kChannels>
+    struct FrameGainsKernel
+    {
+        static void Run(UInt32 inChannelCount,
+                        Float32* ioBuffer,
+                        UInt32 inFrameCount,
+                        const Float32* inGains,
+                        bool inClamp)
+        {
+            const UInt32 theChannels = (kChannels != 0) ? kChannels : inChannelCount;
+
+            for(UInt32 theFrame = 0; theFrame < inFrameCount; theFrame++)
+            {
+                const Float32 theGain = inGains[theFrame];
+                Float32* theSamples = ioBuffer + theFrame * theChannels;
+
+                for(UInt32 i = 0; i < theChannels; i++)
+                {
+                    theSamples[i] = inClamp ? ClampSample(theSamples[i] * theGain)
+                                            : theSamples[i] * theGain;
+                }
+            }
+        }
+    };
+
+    template <UInt32 kChannels>
+    struct FramePeaksKernel
+    {
+        static Float32 Run(UInt32 inChannelCount,
+                           const Float32* inBuffer,
+                           UInt32 inFrameCount,
+                           Float32* outPeaks)
+        {
+            const UInt32 theChannels = (kChannels != 0) ? kChannels : inChannelCount;
+            Float32 theMaxPeak = 0.0f;
+
+            for(UInt32 theFrame = 0; theFrame < inFrameCount; theFrame++)
+            {
+                const Float32* theSamples = inBuffer + theFrame * theChannels;
+                Float32 thePeak = fabsf(theSamples[0]);
+
+                for(UInt32 i = 1; i < theChannels; i++)
+                {
+                    thePeak = std::max(thePeak, fabsf(theSamples[i]));
+                }
+
+                outPeaks[theFrame] = thePeak;
+                theMaxPeak = std::max(theMaxPeak, thePeak);
+            }
+
+            return theMaxPeak;
+        }
+    };
+
+    template <UInt32 kChannels>
+    struct AudibilityKernel
+    {
+        static Audibility Run(UInt32 inChannelCount,
+                              const Float32* inBuffer,
+                              UInt32 inFrameCount,
+                              Float32 inMargin)
+        {
+            const UInt32 theChannels = (kChannels != 0) ? kChannels : inChannelCount;
+
+            if(inFrameCount == 0)
+            {
+                return Audibility::Silent;
+            }
+
+            // The frames are checked in blocks of kBlockFrames. The first block is checked a frame
+            // at a time, since audible buffers are usually audible from their first few frames.
+            // The rest are checked a block at a time, which is slower to stop at an audible frame
+            // but lets the comparisons be vectorised, so silent buffers are scanned much faster.
+            const UInt32 kBlockFrames = 16;
+            const UInt32 theBlockSamples = kBlockFrames * theChannels;
+            const UInt32 theFirstBlockFrames = std::min(kBlockFrames, inFrameCount);
+
+            // The bounds for each channel's samples, repeated for each frame of a block so a block
+            // can be compared as one run of samples.
+            Float32 theLower[kBlockFrames * kMaxChannelCount];
+            Float32 theUpper[kBlockFrames * kMaxChannelCount];
+
+            for(UInt32 i = 0; i < theChannels; i++)
+            {
+                theLower[i] = inBuffer[i] - inMargin;
+                theUpper[i] = inBuffer[i] + inMargin;
+            }
+
+            // Non-zero if any sample isn't 0. Checking for digital silence in the same pass costs
+            // much less than a second pass over silent buffers would.
+            UInt32 theIsNonZero = 0;
+
+            for(UInt32 theFrame = 0; theFrame < theFirstBlockFrames; theFrame++)
+            {
+                bool theFrameIsAudible = false;
+
+                for(UInt32 i = 0; i < theChannels; i++)
+                {
+                    const Float32 theSample = inBuffer[theFrame * theChannels + i];
+                    theFrameIsAudible =
+                            theFrameIsAudible || (theSample < theLower[i]) || (theSample > theUpper[i]);
+                    theIsNonZero |= (theSample != 0.0f);
+                }
+
+                if(theFrameIsAudible)
+                {
+                    return Audibility::Audible;
+                }
+            }
+
+            for(UInt32 i = 0; i < theChannels; i++)
+            {
+                for(UInt32 j = 1; j < kBlockFrames; j++)
+                {
+                    theLower[j * theChannels + i] = theLower[i];
+                    theUpper[j * theChannels + i] = theUpper[i];
+                }
+            }
+
+            UInt32 theFrame = theFirstBlockFrames;
+
+            for(; theFrame + kBlockFrames <= inFrameCount; theFrame += kBlockFrames)
+            {
+                const Float32* theBlock = inBuffer + theFrame * theChannels;
+                UInt32 theBlockIsAudible = 0;
+
+                for(UInt32 i = 0; i < theBlockSamples; i++)
+                {
+                    theBlockIsAudible |= (theBlock[i] < theLower[i]) | (theBlock[i] > theUpper[i]);
+                    theIsNonZero |= (theBlock[i] != 0.0f);
+                }
+
+                if(theBlockIsAudible)
+                {
+                    return Audibility::Audible;
+                }
+            }
+
+            // The frames after the last whole block.
+            const Float32* theRemainder = inBuffer + theFrame * theChannels;
+            const UInt32 theRemainderSamples = (inFrameCount - theFrame) * theChannels;
+            UInt32 theRemainderIsAudible = 0;
+
+            for(UInt32 i = 0; i < theRemainderSamples; i++)
+            {
+                theRemainderIsAudible |=
+                        (theRemainder[i] < theLower[i]) | (theRemainder[i] > theUpper[i]);
+                theIsNonZero |= (theRemainder[i] != 0.0f);
+            }
+
+            if(theRemainderIsAudible)
+            {
+                return Audibility::Audible;
+            }
+
+            return theIsNonZero ? Audibility::Inaudible : Audibility::Silent;
+        }
+    };
+
+    GainMatrix  MakePanMatrix(SInt32 inPanPositionRaw, UInt32 inChannelCount)
+    {
+        GainMatrix theMatrix;
+        theMatrix.mChannelCount = (inChannelCount < kMaxChannelCount) ? inChannelCount : kMaxChannelCount;
+
+        for(UInt32 theOut = 0; theOut < kMaxChannelCount; theOut++)
+        {
+            for(UInt32 theIn = 0; theIn < kMaxChannelCount; theIn++)
+            {
+                theMatrix.mGains[theOut][theIn] = (theOut == theIn) ? 1.0f : 0.0f;
+            }
+        }
+
+        // TODO: It would be worth looking into kAudioFormatProperty_PanningMatrix and
+        //       kAudioFormatProperty_BalanceFade in AudioFormat.h for the surround channels.
+        const Float32 thePanPosition = static_cast<Float32>(inPanPositionRaw) / 100.0f;
+
+        // The left and right channels of the front, surround and rear surround pairs.
+        static const UInt32 kPairs[][2] = { { 0, 1 }, { 4, 5 }, { 6, 7 } };
+
+        for(const auto& thePair : kPairs)
+        {
+            const UInt32 L = thePair[0];
+            const UInt32 R = thePair[1];
+
+            if(R >= theMatrix.mChannelCount)
+            {
+                break;
+            }
+
+            // Apply balance w/ crossfeed.
+            if(thePanPosition > 0.0f)
+            {
+                theMatrix.mGains[L][L] = 1 - thePanPosition;
+                theMatrix.mGains[R][L] = thePanPosition;
+            }
+            else if(thePanPosition < 0.0f)
+            {
+                theMatrix.mGains[L][R] = -thePanPosition;
+                theMatrix.mGains[R][R] = 1 + thePanPosition;
+            }
+        }
+
+        return theMatrix;
+    }
+
+    void    ApplyGainMatrix(Float32* ioBuffer, UInt32 inFrameCount, const GainMatrix& inMatrix)
+    {
+        DispatchOnChannelCount<GainMatrixKernel>(inMatrix.mChannelCount,
+                                                 ioBuffer,
+                                                 inFrameCount,
+                                                 &inMatrix);
+    }
+
+    void    ApplyPan(Float32* ioBuffer,
+                     UInt32 inFrameCount,
+                     UInt32 inChannelCount,
+                     SInt32 inPanPositionRaw)
+    {
+        if(inPanPositionRaw != kAppPanCenterRawValue)
+        {
+            ApplyGainMatrix(ioBuffer, inFrameCount, MakePanMatrix(inPanPositionRaw, inChannelCount));
+        }
+    }
+
+    void    ApplyPanAndRelativeVolume(Float32* ioBuffer,
+                                      UInt32 inFrameCount,
+                                      UInt32 inChannelCount,
+                                      SInt32 inPanPositionRaw,
+                                      Float32 inRelativeVolume)
+    {
+        GainRamp theRelativeVolume;
+        theRelativeVolume.mStartGain = inRelativeVolume;
+        theRelativeVolume.mGainPerFrame = 0.0f;
+        theRelativeVolume.mRampFrameCount = 0;
+        theRelativeVolume.mEndGain = inRelativeVolume;
+
+        ApplyPanAndRelativeVolume(ioBuffer,
+                                  inFrameCount,
+                                  inChannelCount,
+                                  inPanPositionRaw,
+                                  theRelativeVolume);
+    }
+
+    void    ApplyPanAndRelativeVolume(Float32* ioBuffer,
+                                      UInt32 inFrameCount,
+                                      UInt32 inChannelCount,
+                                      SInt32 inPanPositionRaw,
+                                      const GainRamp& inRelativeVolume)
+    {
+        // TODO precompute matrix coefficients w/ volume and do everything in one pass
+        ApplyPan(ioBuffer, inFrameCount, inChannelCount, inPanPositionRaw);
+
+        DispatchOnChannelCount<RelativeVolumeKernel>(inChannelCount,
+                                                     ioBuffer,
+                                                     inFrameCount,
+                                                     &inRelativeVolume);
+    }
+    
+    void    ApplyGain(Float32* ioBuffer, UInt32 inFrameCount, UInt32 inChannelCount, Float32 inGain)
+    {
+#if BGM_PLATFORM_MACH
+        // This call to vDSP_vsmul is equivalent to the loop below, but a bit faster on processors
+        // with newer SIMD instructions.
+        vDSP_vsmul(ioBuffer, 1, &inGain, ioBuffer, 1, inFrameCount * inChannelCount);
+#else
+        for(UInt32 i = 0; i < inFrameCount * inChannelCount; i++)
+        {
+            ioBuffer[i] *= inGain;
+        }
+#endif
+    }
+
+    void    ApplyGain(Float32* ioBuffer,
+                      UInt32 inFrameCount,
+                      UInt32 inChannelCount,
+                      const GainRamp& inGain)
+    {
+        const UInt32 theRampFrameCount = inGain.mRampFrameCount;
+
+        if(theRampFrameCount > 0)
+        {
+#if BGM_PLATFORM_MACH
+            if(inChannelCount == 2)
+            {
+                // Ramps both channels of the interleaved buffer in one pass. vDSP_vrampmul2 updates
+                // the start value as it goes, so it needs a copy.
+                Float32 theStartGain = inGain.mStartGain;
+                vDSP_vrampmul2(ioBuffer,
+                               ioBuffer + 1,
+                               2,
+                               &theStartGain,
+                               &inGain.mGainPerFrame,
+                               ioBuffer,
+                               ioBuffer + 1,
+                               2,
+                               theRampFrameCount);
+            }
+            else
+            {
+                // One pass for each channel.
+                for(UInt32 i = 0; i < inChannelCount; i++)
+                {
+                    Float32 theStartGain = inGain.mStartGain;
+                    vDSP_vrampmul(ioBuffer + i,
+                                  inChannelCount,
+                                  &theStartGain,
+                                  &inGain.mGainPerFrame,
+                                  ioBuffer + i,
+                                  inChannelCount,
+                                  theRampFrameCount);
+                }
+            }
+#else
+            DispatchOnChannelCount<GainRampKernel>(inChannelCount,
+                                                   ioBuffer,
+                                                   theRampFrameCount,
+                                                   inGain.mStartGain,
+                                                   inGain.mGainPerFrame);
+#endif
+        }
+
+        if((inGain.mEndGain != 1.0f) && (theRampFrameCount < inFrameCount))
+        {
+            ApplyGain(ioBuffer + theRampFrameCount * inChannelCount,
+                      inFrameCount - theRampFrameCount,
+                      inChannelCount,
+                      inGain.mEndGain);
+        }
+    }
+
+    void    ApplyFrameGains(Float32* ioBuffer,
+                            UInt32 inFrameCount,
+                            UInt32 inChannelCount,
+                            const Float32* inGains,
+                            bool inClamp)
+    {
+        DispatchOnChannelCount<FrameGainsKernel>(inChannelCount,
+                                                 ioBuffer,
+                                                 inFrameCount,
+                                                 inGains,
+                                                 inClamp);
+    }
+
+    Float32 GetFramePeaks(const Float32* inBuffer,
+                          UInt32 inFrameCount,
+                          UInt32 inChannelCount,
+                          Float32* outPeaks)
+    {
+        return DispatchOnChannelCount<FramePeaksKernel>(inChannelCount,
+                                                        inBuffer,
+                                                        inFrameCount,
+                                                        outPeaks);
+    }
+
+    Audibility  GetAudibility(const Float32* inBuffer,
+                              UInt32 inFrameCount,
+                              UInt32 inChannelCount,
+                              Float32 inMargin)
+    {
+        return DispatchOnChannelCount<AudibilityKernel>(inChannelCount,
+                                                        inBuffer,
+                                                        inFrameCount,
+                                                        inMargin);
+    }
+
+    bool    IsAudible(const Float32* inBuffer,
+                      UInt32 inFrameCount,
+                      UInt32 inChannelCount,
+                      Float32 inMargin)
+    {
+        return GetAudibility(inBuffer, inFrameCount, inChannelCount, inMargin) ==
+                Audibility::Audible;
+    }
+}
+
+#pragma clang assume_nonnull end
+
@@ -0,0 +1,179 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_IOKernels.h
+//  BGMDriver
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  The sample-processing loops BGM_Device and BGM_VolumeControl run on the IO thread, pulled out
+//  into free functions so they can be built and benchmarked without the rest of the driver. All of
+//  them are real-time safe and work on interleaved Float32 buffers.
+//
+//  The kernels that need to know which channel a sample is in are templates on the channel count,
+//  so the compiler can unroll and vectorise each frame's loop. The functions here call the
+//  instantiation for the channel counts BGMDevice supports (2, 6 and 8) and fall back to a
+//  generic loop for any other count, so stereo runs the same code it did before the device
+//  supported more channels.
+//
+
+#ifndef BGMDriver__BGM_IOKernels
+#define BGMDriver__BGM_IOKernels
+
+// System Includes
+#include <MacTypes.h>
+
+
+#pragma clang assume_nonnull begin
+
+namespace BGM_IOKernels
+{
+    // The most channels BGMDevice's streams can have. The channels are in the order of BGM_Device's
+    // kAudioDevicePropertyPreferredChannelLayout: left and right, then, for 5.1 and 7.1, centre,
+    // LFE, left and right surround and, for 7.1, left and right rear surround. The kernels' channel
+    // counts must be from 1 to this.
+    static const UInt32 kMaxChannelCount = 8;
+
+    // A gain that changes linearly over the first part of a buffer. Frame i gets the gain
+    // mStartGain + i * mGainPerFrame if i < mRampFrameCount and mEndGain otherwise. See
+    // BGM_GainRamp.
+    struct GainRamp
+    {
+        Float32 mStartGain;
+        Float32 mGainPerFrame;
+        UInt32  mRampFrameCount;
+        Float32 mEndGain;
+    };
+
+    // How loud a buffer is, from BGM_AudibleState's point of view. See GetAudibility.
+    enum class Audibility
+    {
+        // Every sample is exactly 0.0 (or -0.0), i.e. digital silence.
+        Silent,
+        // The samples don't change by more than the margin, but they aren't all 0.
+        Inaudible,
+        Audible
+    };
+
+    // Mixes each frame's channels into each other. Output channel i of a frame is the sum of its
+    // input channels j times mGains[i][j], for i and j less than mChannelCount.
+    struct GainMatrix
+    {
+        UInt32  mChannelCount;
+        Float32 mGains[kMaxChannelCount][kMaxChannelCount];
+    };
+
+    // Returns the gain matrix for a client's pan position (in the range [kAppPanLeftRawValue,
+    // kAppPanRightRawValue]). Each left/right pair of channels is panned the way stereo is, by
+    // crossfeeding the channel being panned away from into the other one. The centre and LFE
+    // channels are left as they are.
+    GainMatrix  MakePanMatrix(SInt32 inPanPositionRaw, UInt32 inChannelCount);
+
+    // Applies inMatrix to the frames in ioBuffer, which has inMatrix.mChannelCount channels.
+    void    ApplyGainMatrix(Float32* ioBuffer, UInt32 inFrameCount, const GainMatrix& inMatrix);
+
+    // Applies a client's pan position to the frames in ioBuffer. See MakePanMatrix. Does nothing
+    // if the client is panned to the centre.
+    void    ApplyPan(Float32* ioBuffer,
+                     UInt32 inFrameCount,
+                     UInt32 inChannelCount,
+                     SInt32 inPanPositionRaw);
+
+    // Applies a client's pan position (see ApplyPan) and relative volume (in [0.0, 4.0]) to the
+    // frames in ioBuffer. The result is clamped to [-1, 1] when the volume isn't 1.0. To limit the
+    // result with BGM_Limiter instead of clamping it, use ApplyPan and ApplyGain.
+    void    ApplyPanAndRelativeVolume(Float32* ioBuffer,
+                                      UInt32 inFrameCount,
+                                      UInt32 inChannelCount,
+                                      SInt32 inPanPositionRaw,
+                                      Float32 inRelativeVolume);
+
+    // The same, but ramps the relative volume. Still only makes one pass over the buffer for the
+    // volume.
+    void    ApplyPanAndRelativeVolume(Float32* ioBuffer,
+                                      UInt32 inFrameCount,
+                                      UInt32 inChannelCount,
+                                      SInt32 inPanPositionRaw,
+                                      const GainRamp& inRelativeVolume);
+
+    // Multiplies each sample by inGain.
+    void    ApplyGain(Float32* ioBuffer, UInt32 inFrameCount, UInt32 inChannelCount, Float32 inGain);
+
+    // Multiplies each sample by its frame's gain in inGain. Skips the frames after the ramp if
+    // their gain is 1.0.
+    void    ApplyGain(Float32* ioBuffer,
+                      UInt32 inFrameCount,
+                      UInt32 inChannelCount,
+                      const GainRamp& inGain);
+
+    // Multiplies each sample by its frame's gain in inGains, which has inFrameCount gains. If
+    // inClamp is true, the results are also clamped to [-1, 1].
+    void    ApplyFrameGains(Float32* ioBuffer,
+                            UInt32 inFrameCount,
+                            UInt32 inChannelCount,
+                            const Float32* inGains,
+                            bool inClamp);
+
+    // Writes the largest absolute sample in each frame of inBuffer to outPeaks, which must have
+    // room for inFrameCount peaks, and returns the largest of them (or 0 if inFrameCount is 0). For
+    // the limiter and compressor, which give every channel the same gain.
+    Float32 GetFramePeaks(const Float32* inBuffer,
+                          UInt32 inFrameCount,
+                          UInt32 inChannelCount,
+                          Float32* outPeaks);
+
+    // Returns Audible if any sample in inBuffer differs from the one in the same channel of the
+    // first frame by more than inMargin, Silent if every sample is 0 and Inaudible otherwise. Stops
+    // at the first audible frame. Finding digital silence only adds a comparison per sample to the
+    // scan, so the IO thread can use it to skip processing that wouldn't change a silent buffer.
+    // See BGM_AudibleState.
+    Audibility  GetAudibility(const Float32* inBuffer,
+                              UInt32 inFrameCount,
+                              UInt32 inChannelCount,
+                              Float32 inMargin);
+
+    // Returns true if GetAudibility would return Audible.
+    bool    IsAudible(const Float32* inBuffer,
+                      UInt32 inFrameCount,
+                      UInt32 inChannelCount,
+                      Float32 inMargin);
+
+    // Calls Kernel<N>::Run(inChannelCount, inArgs...) with N = inChannelCount if it's one of the
+    // channel counts BGMDevice supports, or with N = 0 if not. The kernels use N as their channel
+    // count when it isn't 0, so its loops over each frame's channels can be unrolled, and
+    // inChannelCount when it is.
+    template <template <UInt32> class Kernel, typename... Args>
+    inline auto DispatchOnChannelCount(UInt32 inChannelCount, Args... inArgs)
+            -> decltype(Kernel<0>::Run(inChannelCount, inArgs...))
+    {
+        switch(inChannelCount)
+        {
+            case 2:
+                return Kernel<2>::Run(inChannelCount, inArgs...);
+            case 6:
+                return Kernel<6>::Run(inChannelCount, inArgs...);
+            case 8:
+                return Kernel<8>::Run(inChannelCount, inArgs...);
+            default:
+                return Kernel<0>::Run(inChannelCount, inArgs...);
+        }
+    }
+}
+
+#pragma clang assume_nonnull end
+
+#endif /* BGMDriver__BGM_IOKernels */
+
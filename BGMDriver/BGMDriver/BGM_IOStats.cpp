@@ -0,0 +1,360 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_IOStats.cpp
+//  BGMDriver
+//
+//  Copyright © 2026 Kyle Neideck
+//
+
+// Self Include
+#include "BGM_IOStats.h"
+
+// Local Includes
+#include "BGM_Platform.h"
+
+// STL Includes
+#include <algorithm>
+#include <cstring>
+
+
+#pragma clang assume_nonnull begin
+
+#if BGM_IOStatsEnabled
+
+// Recording has to be real-time safe, so the counters can't fall back to using locks.
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "BGM_IOStats needs lock-free 64-bit atomics");
+
+// Each counter is only written by the thread that owns it, so it can be updated with a relaxed
+// load and store instead of a (more expensive) read-modify-write.
+static inline void BGM_AddToCounter(std::atomic<UInt64>& ioCounter, UInt64 inAmount)
+{
+    ioCounter.store(ioCounter.load(std::memory_order_relaxed) + inAmount, std::memory_order_relaxed);
+}
+
+#pragma mark Timer
+
+BGM_IOStats::Timer::Timer(BGM_IOStats& inStats,
+                          UInt32 inOperation,
+                          UInt64 inIOCycleCounter,
+                          UInt64 inIOBufferDurationNs) noexcept
+:
+    mStats(inStats),
+    mOperation(inOperation),
+    mIOCycleCounter(inIOCycleCounter),
+    mIOBufferDurationNs(inIOBufferDurationNs),
+    mStartHostTime(BGM_Platform::GetCurrentHostTime())
+{
+}
+
+BGM_IOStats::Timer::~Timer()
+{
+    UInt64 theEndHostTime = BGM_Platform::GetCurrentHostTime();
+    UInt64 theDurationNs =
+            BGM_Platform::ConvertHostTimeToNanos(theEndHostTime - mStartHostTime);
+
+    mStats.RecordOperation(mOperation, mIOCycleCounter, mIOBufferDurationNs, theDurationNs);
+}
+
+#pragma mark Construction/Destruction
+
+BGM_IOStats::BGM_IOStats()
+{
+    // std::atomic's default constructor doesn't initialise the value.
+    for(ThreadStats& theThreadStats : mThreadStats)
+    {
+        theThreadStats.mOwnerThreadID.store(0);
+
+        for(Operation& theOperation : theThreadStats.mOperations)
+        {
+            theOperation.mCount.store(0);
+            theOperation.mTotalNs.store(0);
+            theOperation.mMaxNs.store(0);
+
+            for(std::atomic<UInt64>& theBucket : theOperation.mHistogram)
+            {
+                theBucket.store(0);
+            }
+        }
+
+        theThreadStats.mDeadlineMisses.store(0);
+
+        for(Limiter& theLimiter : theThreadStats.mLimiters)
+        {
+            theLimiter.mFrameCount.store(0);
+            theLimiter.mLimitedFrameCount.store(0);
+            theLimiter.mMaxGainReductionDb.store(0.0f);
+        }
+
+        theThreadStats.mIsInCycle = false;
+        theThreadStats.mCycleCounter = 0;
+        theThreadStats.mCycleDurationNs = 0;
+        theThreadStats.mCycleIOBufferDurationNs = 0;
+    }
+
+    mUnrecordedOperations.store(0);
+
+    for(std::atomic<Float32>& theGainReduction : mLatestGainReductionDb)
+    {
+        theGainReduction.store(0.0f);
+    }
+}
+
+#pragma mark Recording
+
+void    BGM_IOStats::RecordOperation(UInt32 inOperation,
+                                     UInt64 inIOCycleCounter,
+                                     UInt64 inIOBufferDurationNs,
+                                     UInt64 inDurationNs) noexcept
+{
+    if(inOperation >= kBGMIOStatsOperation_Cycle)
+    {
+        return;
+    }
+
+    ThreadStats* theThreadStats = GetCurrentThreadStats();
+
+    if(!theThreadStats)
+    {
+        mUnrecordedOperations.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    RecordDuration(theThreadStats->mOperations[inOperation], inDurationNs);
+
+    // Add the operation to the total for its IO cycle. GetZeroTimeStamp isn't included because the
+    // HAL doesn't tell us which cycle it's for.
+    if(inOperation != kBGMIOStatsOperation_GetZeroTimeStamp)
+    {
+        if(theThreadStats->mIsInCycle && (theThreadStats->mCycleCounter != inIOCycleCounter))
+        {
+            FinishCycle(*theThreadStats);
+        }
+
+        theThreadStats->mIsInCycle = true;
+        theThreadStats->mCycleCounter = inIOCycleCounter;
+        theThreadStats->mCycleDurationNs += inDurationNs;
+        theThreadStats->mCycleIOBufferDurationNs = inIOBufferDurationNs;
+    }
+}
+
+void    BGM_IOStats::RecordLimiter(UInt32 inLimiter,
+                                   UInt32 inFrameCount,
+                                   UInt32 inLimitedFrameCount,
+                                   Float32 inMaxGainReductionDb) noexcept
+{
+    if(inLimiter >= kBGMIOStatsLimiterCount)
+    {
+        return;
+    }
+
+    mLatestGainReductionDb[inLimiter].store(inMaxGainReductionDb, std::memory_order_relaxed);
+
+    ThreadStats* theThreadStats = GetCurrentThreadStats();
+
+    if(!theThreadStats)
+    {
+        return;
+    }
+
+    Limiter& theLimiter = theThreadStats->mLimiters[inLimiter];
+
+    BGM_AddToCounter(theLimiter.mFrameCount, inFrameCount);
+    BGM_AddToCounter(theLimiter.mLimitedFrameCount, inLimitedFrameCount);
+
+    if(inMaxGainReductionDb > theLimiter.mMaxGainReductionDb.load(std::memory_order_relaxed))
+    {
+        theLimiter.mMaxGainReductionDb.store(inMaxGainReductionDb, std::memory_order_relaxed);
+    }
+}
+
+void    BGM_IOStats::IOThreadWillStop() noexcept
+{
+    ThreadStats* theThreadStats = GetCurrentThreadStats();
+
+    if(theThreadStats)
+    {
+        FinishCycle(*theThreadStats);
+        // Release the stats so the next thread to claim them sees all of our updates.
+        theThreadStats->mOwnerThreadID.store(0, std::memory_order_release);
+    }
+}
+
+BGM_IOStats::ThreadStats* __nullable BGM_IOStats::GetCurrentThreadStats() noexcept
+{
+    UInt64 theThreadID = BGM_Platform::GetCurrentThreadID();
+
+    for(ThreadStats& theThreadStats : mThreadStats)
+    {
+        if(theThreadStats.mOwnerThreadID.load(std::memory_order_relaxed) == theThreadID)
+        {
+            return &theThreadStats;
+        }
+    }
+
+    for(ThreadStats& theThreadStats : mThreadStats)
+    {
+        UInt64 theUnowned = 0;
+
+        if(theThreadStats.mOwnerThreadID.compare_exchange_strong(theUnowned,
+                                                                 theThreadID,
+                                                                 std::memory_order_acquire,
+                                                                 std::memory_order_relaxed))
+        {
+            theThreadStats.mIsInCycle = false;
+            theThreadStats.mCycleDurationNs = 0;
+            return &theThreadStats;
+        }
+    }
+
+    return nullptr;
+}
+
+// static
+void    BGM_IOStats::FinishCycle(ThreadStats& ioThreadStats) noexcept
+{
+    if(!ioThreadStats.mIsInCycle)
+    {
+        return;
+    }
+
+    RecordDuration(ioThreadStats.mOperations[kBGMIOStatsOperation_Cycle],
+                   ioThreadStats.mCycleDurationNs);
+
+    if((ioThreadStats.mCycleIOBufferDurationNs > 0) &&
+       (ioThreadStats.mCycleDurationNs > ioThreadStats.mCycleIOBufferDurationNs))
+    {
+        BGM_AddToCounter(ioThreadStats.mDeadlineMisses, 1);
+    }
+
+    ioThreadStats.mIsInCycle = false;
+    ioThreadStats.mCycleDurationNs = 0;
+}
+
+// static
+void    BGM_IOStats::RecordDuration(Operation& ioOperation, UInt64 inDurationNs) noexcept
+{
+    // The bucket is the index of the duration's highest set bit.
+    UInt32 theBucket = 0;
+
+    if(inDurationNs > 0)
+    {
+        theBucket = 63 - static_cast<UInt32>(__builtin_clzll(inDurationNs));
+        theBucket = std::min(theBucket, static_cast<UInt32>(kBGMIOStatsBucketCount - 1));
+    }
+
+    BGM_AddToCounter(ioOperation.mHistogram[theBucket], 1);
+    BGM_AddToCounter(ioOperation.mCount, 1);
+    BGM_AddToCounter(ioOperation.mTotalNs, inDurationNs);
+
+    if(inDurationNs > ioOperation.mMaxNs.load(std::memory_order_relaxed))
+    {
+        ioOperation.mMaxNs.store(inDurationNs, std::memory_order_relaxed);
+    }
+}
+
+#pragma mark Reading
+
+void    BGM_IOStats::GetStats(BGMDeviceIOStats& outStats) const noexcept
+{
+    memset(&outStats, 0, sizeof(BGMDeviceIOStats));
+
+    outStats.mVersion = kBGMIOStatsVersion;
+    outStats.mOperationCount = kBGMIOStatsOperationCount;
+    outStats.mBucketCount = kBGMIOStatsBucketCount;
+    outStats.mUnrecordedOperations = mUnrecordedOperations.load(std::memory_order_relaxed);
+
+    for(const ThreadStats& theThreadStats : mThreadStats)
+    {
+        outStats.mDeadlineMisses += theThreadStats.mDeadlineMisses.load(std::memory_order_relaxed);
+
+        for(UInt32 i = 0; i < kBGMIOStatsOperationCount; i++)
+        {
+            const Operation& theOperation = theThreadStats.mOperations[i];
+            BGMDeviceIOStatsOperation& theOutOperation = outStats.mOperations[i];
+
+            theOutOperation.mCount += theOperation.mCount.load(std::memory_order_relaxed);
+            theOutOperation.mTotalNs += theOperation.mTotalNs.load(std::memory_order_relaxed);
+            theOutOperation.mMaxNs = std::max(theOutOperation.mMaxNs,
+                                              theOperation.mMaxNs.load(std::memory_order_relaxed));
+
+            for(UInt32 j = 0; j < kBGMIOStatsBucketCount; j++)
+            {
+                theOutOperation.mHistogram[j] +=
+                        theOperation.mHistogram[j].load(std::memory_order_relaxed);
+            }
+        }
+
+        for(UInt32 i = 0; i < kBGMIOStatsLimiterCount; i++)
+        {
+            const Limiter& theLimiter = theThreadStats.mLimiters[i];
+            BGMDeviceIOStatsLimiter& theOutLimiter = outStats.mLimiters[i];
+
+            theOutLimiter.mFrameCount += theLimiter.mFrameCount.load(std::memory_order_relaxed);
+            theOutLimiter.mLimitedFrameCount +=
+                    theLimiter.mLimitedFrameCount.load(std::memory_order_relaxed);
+            theOutLimiter.mMaxGainReductionDb =
+                    std::max(theOutLimiter.mMaxGainReductionDb,
+                             theLimiter.mMaxGainReductionDb.load(std::memory_order_relaxed));
+        }
+    }
+
+    for(UInt32 i = 0; i < kBGMIOStatsLimiterCount; i++)
+    {
+        outStats.mLimiters[i].mLatestGainReductionDb =
+                mLatestGainReductionDb[i].load(std::memory_order_relaxed);
+    }
+}
+
+#else /* BGM_IOStatsEnabled */
+
+BGM_IOStats::BGM_IOStats()
+{
+}
+
+void    BGM_IOStats::RecordOperation(UInt32 inOperation,
+                                     UInt64 inIOCycleCounter,
+                                     UInt64 inIOBufferDurationNs,
+                                     UInt64 inDurationNs) noexcept
+{
+    #pragma unused(inOperation, inIOCycleCounter, inIOBufferDurationNs, inDurationNs)
+}
+
+void    BGM_IOStats::RecordLimiter(UInt32 inLimiter,
+                                   UInt32 inFrameCount,
+                                   UInt32 inLimitedFrameCount,
+                                   Float32 inMaxGainReductionDb) noexcept
+{
+    #pragma unused(inLimiter, inFrameCount, inLimitedFrameCount, inMaxGainReductionDb)
+}
+
+void    BGM_IOStats::IOThreadWillStop() noexcept
+{
+}
+
+void    BGM_IOStats::GetStats(BGMDeviceIOStats& outStats) const noexcept
+{
+    memset(&outStats, 0, sizeof(BGMDeviceIOStats));
+
+    outStats.mVersion = kBGMIOStatsVersion;
+    outStats.mOperationCount = kBGMIOStatsOperationCount;
+    outStats.mBucketCount = kBGMIOStatsBucketCount;
+}
+
+#endif /* BGM_IOStatsEnabled */
+
+#pragma clang assume_nonnull end
+
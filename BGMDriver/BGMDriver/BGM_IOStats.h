@@ -0,0 +1,207 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_IOStats.h
+//  BGMDriver
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  Timing statistics for a device's IO operations: a log2 histogram of the durations of each kind
+//  of operation, their maximums and an estimate of how many IO cycles missed their deadlines. Also
+//  how much the device's limiters have turned the audio down (see BGM_Limiter). The device exposes
+//  them through kAudioDeviceCustomPropertyIOStats. See BGMDeviceIOStats in
+//  BGM_Types.h.
+//
+//  Recording is real-time safe. It doesn't lock or allocate, and each IO thread writes to its own
+//  set of histograms, so the IO threads never write to the same memory. Reading the statistics
+//  sums the threads' histograms. It can run concurrently with recording, but the result won't
+//  necessarily be a consistent snapshot.
+//
+//  Build with BGM_IOStatsEnabled=0 to compile the instrumentation out.
+//
+
+#ifndef BGMDriver__BGM_IOStats
+#define BGMDriver__BGM_IOStats
+
+// Local Includes
+#include "BGM_Types.h"
+
+// STL Includes
+#include <atomic>
+
+// System Includes
+#include <MacTypes.h>
+
+
+#ifndef BGM_IOStatsEnabled
+#define BGM_IOStatsEnabled 1
+#endif
+
+#pragma clang assume_nonnull begin
+
+class BGM_IOStats
+{
+
+public:
+                                BGM_IOStats();
+                                BGM_IOStats(const BGM_IOStats&) = delete;
+                                BGM_IOStats& operator=(const BGM_IOStats&) = delete;
+
+    /*!
+     Times an IO operation, from when it's constructed to when it's destroyed, and records it.
+
+     Real-time safe.
+     */
+    class Timer
+    {
+
+    public:
+#if BGM_IOStatsEnabled
+                                /*!
+                                 @param inOperation One of the kBGMIOStatsOperation constants.
+                                 @param inIOCycleCounter The mIOCycleCounter of the operation's
+                                                         AudioServerPlugInIOCycleInfo. Ignored for
+                                                         GetZeroTimeStamp.
+                                 @param inIOBufferDurationNs The length of the IO buffer, i.e. the
+                                                             deadline for the IO cycle.
+                                 */
+                                Timer(BGM_IOStats& inStats,
+                                      UInt32 inOperation,
+                                      UInt64 inIOCycleCounter = 0,
+                                      UInt64 inIOBufferDurationNs = 0) noexcept;
+                                ~Timer();
+#else
+                                Timer(BGM_IOStats& inStats,
+                                      UInt32 inOperation,
+                                      UInt64 inIOCycleCounter = 0,
+                                      UInt64 inIOBufferDurationNs = 0) noexcept
+                                {
+                                    #pragma unused(inStats, inOperation, inIOCycleCounter, inIOBufferDurationNs)
+                                }
+#endif
+                                Timer(const Timer&) = delete;
+                                Timer& operator=(const Timer&) = delete;
+
+#if BGM_IOStatsEnabled
+    private:
+        BGM_IOStats&            mStats;
+        UInt32                  mOperation;
+        UInt64                  mIOCycleCounter;
+        UInt64                  mIOBufferDurationNs;
+        UInt64                  mStartHostTime;
+#endif
+
+    };
+
+    /*!
+     Record an IO operation that took inDurationNs. See Timer for the other parameters.
+
+     Real-time safe.
+     */
+    void                        RecordOperation(UInt32 inOperation,
+                                                UInt64 inIOCycleCounter,
+                                                UInt64 inIOBufferDurationNs,
+                                                UInt64 inDurationNs) noexcept;
+
+    /*!
+     Record a buffer processed by one of the device's limiters.
+
+     Real-time safe.
+
+     @param inLimiter One of the kBGMIOStatsLimiter constants.
+     @param inFrameCount The number of frames in the buffer.
+     @param inLimitedFrameCount The number of them the limiter turned down.
+     @param inMaxGainReductionDb The most the limiter turned a frame down by, in dB.
+     */
+    void                        RecordLimiter(UInt32 inLimiter,
+                                              UInt32 inFrameCount,
+                                              UInt32 inLimitedFrameCount,
+                                              Float32 inMaxGainReductionDb) noexcept;
+
+    /*!
+     Called on an IO thread when it will stop doing IO operations, e.g. at the end of
+     kAudioServerPlugInIOOperationThread. Records the thread's last IO cycle and frees up its space
+     for another IO thread. Its statistics are kept.
+
+     Real-time safe.
+     */
+    void                        IOThreadWillStop() noexcept;
+
+    /*!
+     Sum the statistics recorded so far. The IO cycles the IO threads are currently in aren't
+     included. Safe to call from any thread, but not real-time safe.
+     */
+    void                        GetStats(BGMDeviceIOStats& outStats) const noexcept;
+
+#if BGM_IOStatsEnabled
+
+private:
+    struct Operation
+    {
+        std::atomic<UInt64>     mCount;
+        std::atomic<UInt64>     mTotalNs;
+        std::atomic<UInt64>     mMaxNs;
+        std::atomic<UInt64>     mHistogram[kBGMIOStatsBucketCount];
+    };
+
+    struct Limiter
+    {
+        std::atomic<UInt64>     mFrameCount;
+        std::atomic<UInt64>     mLimitedFrameCount;
+        std::atomic<Float32>    mMaxGainReductionDb;
+    };
+
+    // The statistics recorded by one IO thread.
+    struct ThreadStats
+    {
+        // The BGM_Platform::GetCurrentThreadID of the thread that currently owns these stats, or 0
+        // if none does.
+        std::atomic<UInt64>     mOwnerThreadID;
+
+        Operation               mOperations[kBGMIOStatsOperationCount];
+        std::atomic<UInt64>     mDeadlineMisses;
+        Limiter                 mLimiters[kBGMIOStatsLimiterCount];
+
+        // The IO cycle the owner thread is in. Only accessed by the owner thread.
+        bool                    mIsInCycle;
+        UInt64                  mCycleCounter;
+        UInt64                  mCycleDurationNs;
+        UInt64                  mCycleIOBufferDurationNs;
+    };
+
+    // Finds the stats owned by the current thread or claims an unowned set for it. Returns null if
+    // there are none left.
+    ThreadStats* __nullable     GetCurrentThreadStats() noexcept;
+    static void                 FinishCycle(ThreadStats& ioThreadStats) noexcept;
+    static void                 RecordDuration(Operation& ioOperation, UInt64 inDurationNs) noexcept;
+
+    // The HAL uses one IO thread per device, but it can replace it when IO restarts. A few spare
+    // sets of stats cover any threads that don't tell us they've stopped.
+    static const UInt32         kMaxIOThreads = 4;
+
+    ThreadStats                 mThreadStats[kMaxIOThreads];
+    std::atomic<UInt64>         mUnrecordedOperations;
+    // Not per-thread because only the latest value is kept.
+    std::atomic<Float32>        mLatestGainReductionDb[kBGMIOStatsLimiterCount];
+
+#endif /* BGM_IOStatsEnabled */
+
+};
+
+#pragma clang assume_nonnull end
+
+#endif /* BGMDriver__BGM_IOStats */
+
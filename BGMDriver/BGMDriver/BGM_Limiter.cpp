@@ -0,0 +1,430 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_Limiter.cpp
+//  BGMDriver
+//
+//  Copyright © 2026 Kyle Neideck
+//
+
+// Self Include
+#include "BGM_Limiter.h"
+
+// STL Includes
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+
+#pragma clang assume_nonnull begin
+
+const Float32 BGM_Limiter::kMinThresholdDb = -24.0f;
+const Float32 BGM_Limiter::kMaxKneeDb = 12.0f;
+const Float32 BGM_Limiter::kMaxReleaseMs = 5000.0f;
+
+// 20 * log10(2). Converts log2 of a level to dB, so the curve can use log2f and exp2f.
+static const Float32 kDbPerLog2 = 6.0205999f;
+
+// Once the release gets this close to unity it's snapped to it, so the limiter can go idle.
+static const Float32 kReleaseUnitySnap = 0.99999f;
+
+// The gain the soft-knee curve gives for a peak level above the start of the knee. Above the knee
+// the ratio is infinite, so the output stays at the threshold.
+static inline Float32 StaticGain(Float32 inPeak, Float32 inThresholdDb, Float32 inKneeDb)
+{
+    const Float32 theOverDb = kDbPerLog2 * log2f(inPeak) - inThresholdDb;
+    Float32 theReductionDb = 0.0f;
+
+    if(2.0f * theOverDb >= inKneeDb)
+    {
+        theReductionDb = theOverDb;
+    }
+    else if(2.0f * theOverDb > -inKneeDb)
+    {
+        // Inside the knee. (The knee can't be 0 here.)
+        const Float32 theIntoKneeDb = theOverDb + inKneeDb / 2.0f;
+        theReductionDb = theIntoKneeDb * theIntoKneeDb / (2.0f * inKneeDb);
+    }
+
+    return exp2f(-theReductionDb / kDbPerLog2);
+}
+
+#pragma mark Parameters
+
+// static
+BGM_Limiter::Parameters BGM_Limiter::GetDefaultParameters()
+{
+    Parameters theParameters;
+    // Leaves some room for the output device's resampling, etc.
+    theParameters.mThresholdDb = -1.0f;
+    theParameters.mKneeDb = 2.0f;
+    // Short enough that quieter passages after a peak aren't noticeably turned down.
+    theParameters.mReleaseMs = 60.0f;
+    return theParameters;
+}
+
+// static
+BGM_Limiter::Parameters BGM_Limiter::ClampParameters(const Parameters& inParameters)
+{
+    // The comparisons are written this way so NaNs are replaced as well.
+    Parameters theParameters;
+    theParameters.mThresholdDb = (inParameters.mThresholdDb >= kMinThresholdDb) ?
+                                         std::min(inParameters.mThresholdDb, 0.0f) : kMinThresholdDb;
+    theParameters.mKneeDb = (inParameters.mKneeDb >= 0.0f) ?
+                                    std::min(inParameters.mKneeDb, kMaxKneeDb) : 0.0f;
+    theParameters.mReleaseMs = (inParameters.mReleaseMs >= 0.0f) ?
+                                       std::min(inParameters.mReleaseMs, kMaxReleaseMs) : 0.0f;
+    return theParameters;
+}
+
+#pragma mark Construction/Reset
+
+BGM_Limiter::BGM_Limiter()
+:
+    mChannelCount(2)
+{
+    Reset();
+}
+
+void    BGM_Limiter::Reset()
+{
+    memset(mDelayLine, 0, sizeof(mDelayLine));
+    mDelayPosition = 0;
+
+    mMinValues[0] = 1.0f;
+    mMinFrames[0] = 0;
+    mMinFront = 0;
+    mMinCount = 1;
+    mFrameCounter = 1;
+
+    mReleaseGain = 1.0f;
+
+    std::fill(mAverageValues, mAverageValues + kLookaheadFrames, 1.0f);
+    mAveragePosition = 0;
+    mAverageSum = kLookaheadFrames;
+    mAverageReducedCount = 0;
+}
+
+#pragma mark Processing
+
+BGM_Limiter::Result BGM_Limiter::ProcessRT(Float32* ioBuffer,
+                                           UInt32 inFrameCount,
+                                           UInt32 inChannelCount,
+                                           const Parameters& inParameters,
+                                           Float64 inSampleRate)
+{
+    Result theResult = { 0, 0.0f };
+
+    if((inChannelCount == 0) || (inChannelCount > BGM_IOKernels::kMaxChannelCount))
+    {
+        return theResult;
+    }
+
+    // The frames in the delay line would be split across the wrong channels.
+    if(inChannelCount != mChannelCount)
+    {
+        mChannelCount = inChannelCount;
+        Reset();
+    }
+
+    // The level where the knee starts. Peaks below it don't need any gain reduction.
+    const Float32 theKneeStartLevel =
+            exp2f((inParameters.mThresholdDb - inParameters.mKneeDb / 2.0f) / kDbPerLog2);
+
+    // The fraction of the distance back to unity the release covers each frame.
+    const Float64 theReleaseFrames = inParameters.mReleaseMs / 1000.0 * inSampleRate;
+    const Float32 theReleaseCoefficient =
+            (theReleaseFrames > 1.0) ? static_cast<Float32>(1.0 - exp(-1.0 / theReleaseFrames)) : 1.0f;
+
+    Float32 theMinGain = 1.0f;
+
+    for(UInt32 theOffset = 0; theOffset < inFrameCount; theOffset += kChunkFrames)
+    {
+        ProcessChunk(ioBuffer + theOffset * mChannelCount,
+                     std::min(kChunkFrames, inFrameCount - theOffset),
+                     theKneeStartLevel,
+                     inParameters.mThresholdDb,
+                     inParameters.mKneeDb,
+                     theReleaseCoefficient,
+                     theMinGain,
+                     theResult.mLimitedFrameCount);
+    }
+
+    if(theMinGain < 1.0f)
+    {
+        theResult.mMaxGainReductionDb = -kDbPerLog2 * log2f(theMinGain);
+    }
+
+    return theResult;
+}
+
+void    BGM_Limiter::ProcessChunk(Float32* ioBuffer,
+                                  UInt32 inFrameCount,
+                                  Float32 inKneeStartLevel,
+                                  Float32 inThresholdDb,
+                                  Float32 inKneeDb,
+                                  Float32 inReleaseCoefficient,
+                                  Float32& ioMinGain,
+                                  UInt32& ioLimitedFrameCount)
+{
+    // Find the linked peak of each frame, i.e. its loudest channel. (This and the other loops over
+    // whole chunks are written so the compiler can vectorize them.)
+    const Float32 theChunkPeak =
+            BGM_IOKernels::GetFramePeaks(ioBuffer, inFrameCount, mChannelCount, mGains);
+
+    // The fast path. If nothing in the lookahead window or this chunk needs limiting, the audio
+    // only has to go through the delay line.
+    if(IsIdle() && (theChunkPeak <= inKneeStartLevel))
+    {
+        DelayChunk(ioBuffer, inFrameCount);
+
+        mFrameCounter += inFrameCount;
+        // Everything in the minimum's window is at unity, so only the newest frame matters.
+        mMinValues[0] = 1.0f;
+        mMinFrames[0] = mFrameCounter - 1;
+        mMinFront = 0;
+        mMinCount = 1;
+        // Drop any rounding errors while we know the exact sum.
+        mAverageSum = kLookaheadFrames;
+
+        return;
+    }
+
+    // Turn the peaks into gains.
+    for(UInt32 i = 0; i < inFrameCount; i++)
+    {
+        const Float32 thePeak = mGains[i];
+        const Float32 theStaticGain =
+                (thePeak > inKneeStartLevel) ? StaticGain(thePeak, inThresholdDb, inKneeDb) : 1.0f;
+
+        // Take the minimum of the static gains over the window. Drop the oldest gain if it's
+        // left the window, then drop the gains that are no lower than the new one because they
+        // can't be the minimum again.
+        if((mMinCount > 0) && (mFrameCounter - mMinFrames[mMinFront] >= kMinWindowFrames))
+        {
+            mMinFront = (mMinFront + 1) % kMinWindowFrames;
+            mMinCount--;
+        }
+
+        while((mMinCount > 0) &&
+              (mMinValues[(mMinFront + mMinCount - 1) % kMinWindowFrames] >= theStaticGain))
+        {
+            mMinCount--;
+        }
+
+        const UInt32 theBack = (mMinFront + mMinCount) % kMinWindowFrames;
+        mMinValues[theBack] = theStaticGain;
+        mMinFrames[theBack] = mFrameCounter;
+        mMinCount++;
+        mFrameCounter++;
+
+        // Follow the minimum down immediately and release back up exponentially.
+        mReleaseGain += (1.0f - mReleaseGain) * inReleaseCoefficient;
+        mReleaseGain = (mReleaseGain > kReleaseUnitySnap) ? 1.0f : mReleaseGain;
+        mReleaseGain = std::min(mReleaseGain, mMinValues[mMinFront]);
+
+        // Smooth it with a moving average over the lookahead. Since the minimum's window is one
+        // frame longer, every gain in the average is at or below the gain needed for the frame
+        // coming out of the delay line.
+        const Float32 theOldValue = mAverageValues[mAveragePosition];
+        mAverageValues[mAveragePosition] = mReleaseGain;
+        mAveragePosition = (mAveragePosition + 1) % kLookaheadFrames;
+        mAverageSum += static_cast<Float64>(mReleaseGain) - theOldValue;
+        mAverageReducedCount += (mReleaseGain < 1.0f) ? 1 : 0;
+        mAverageReducedCount -= (theOldValue < 1.0f) ? 1 : 0;
+
+        if(mAverageReducedCount == 0)
+        {
+            mAverageSum = kLookaheadFrames;
+            mGains[i] = 1.0f;
+        }
+        else
+        {
+            mGains[i] = std::min(static_cast<Float32>(mAverageSum / kLookaheadFrames), 1.0f);
+        }
+    }
+
+    DelayChunk(ioBuffer, inFrameCount);
+
+    Float32 theMinGain = ioMinGain;
+    UInt32 theLimitedFrameCount = 0;
+
+    for(UInt32 i = 0; i < inFrameCount; i++)
+    {
+        theMinGain = (mGains[i] < theMinGain) ? mGains[i] : theMinGain;
+        theLimitedFrameCount += (mGains[i] < 1.0f) ? 1 : 0;
+    }
+
+    ioMinGain = theMinGain;
+    ioLimitedFrameCount += theLimitedFrameCount;
+
+    // Apply the gains. The clamp only catches rounding errors, since the threshold can't be
+    // above 0 dBFS.
+    BGM_IOKernels::ApplyFrameGains(ioBuffer, inFrameCount, mChannelCount, mGains, true);
+}
+
+void    BGM_Limiter::DelayChunk(Float32* ioBuffer, UInt32 inFrameCount)
+{
+    // Swapping each frame with the delay line outputs the frame from kLookaheadFrames ago and
+    // stores the new one in its place. Do it in runs that don't wrap around the delay line.
+    UInt32 theFramesDone = 0;
+
+    while(theFramesDone < inFrameCount)
+    {
+        const UInt32 theRunFrames = std::min(inFrameCount - theFramesDone,
+                                             kLookaheadFrames - mDelayPosition);
+
+        std::swap_ranges(ioBuffer + theFramesDone * mChannelCount,
+                         ioBuffer + (theFramesDone + theRunFrames) * mChannelCount,
+                         mDelayLine + mDelayPosition * mChannelCount);
+
+        theFramesDone += theRunFrames;
+        mDelayPosition = (mDelayPosition + theRunFrames) % kLookaheadFrames;
+    }
+}
+
+#pragma mark BGM_Limiters
+
+// static
+BGM_Limiters::Settings BGM_Limiters::GetDefaultSettings()
+{
+    Settings theSettings;
+    theSettings.mClientsEnabled = false;
+    theSettings.mMixEnabled = false;
+    theSettings.mParameters = BGM_Limiter::GetDefaultParameters();
+    return theSettings;
+}
+
+BGM_Limiters::BGM_Limiters()
+:
+    mUseCounter(0)
+{
+    for(Entry& theEntry : mEntries)
+    {
+        theEntry.mInUse = false;
+        theEntry.mClientID = 0;
+        theEntry.mLastUsed = 0;
+    }
+
+    SetSettings(GetDefaultSettings());
+}
+
+void    BGM_Limiters::SetSettings(const Settings& inSettings)
+{
+    BGM_Limiter::Parameters theParameters = BGM_Limiter::ClampParameters(inSettings.mParameters);
+
+    mThresholdDb.store(theParameters.mThresholdDb);
+    mKneeDb.store(theParameters.mKneeDb);
+    mReleaseMs.store(theParameters.mReleaseMs);
+    mClientsEnabled.store(inSettings.mClientsEnabled);
+    mMixEnabled.store(inSettings.mMixEnabled);
+}
+
+BGM_Limiters::Settings BGM_Limiters::GetSettings() const
+{
+    Settings theSettings;
+    theSettings.mClientsEnabled = mClientsEnabled.load();
+    theSettings.mMixEnabled = mMixEnabled.load();
+    theSettings.mParameters = GetParametersRT();
+    return theSettings;
+}
+
+void    BGM_Limiters::SetMixRequired(bool inMixRequired)
+{
+    mMixRequired.store(inMixRequired);
+}
+
+UInt32  BGM_Limiters::GetLatencyFrames() const
+{
+    return (AreClientsEnabled() ? BGM_Limiter::kLookaheadFrames : 0) +
+           (IsMixEnabled() ? BGM_Limiter::kLookaheadFrames : 0);
+}
+
+BGM_Limiter::Parameters BGM_Limiters::GetParametersRT() const
+{
+    BGM_Limiter::Parameters theParameters;
+    theParameters.mThresholdDb = mThresholdDb.load(std::memory_order_relaxed);
+    theParameters.mKneeDb = mKneeDb.load(std::memory_order_relaxed);
+    theParameters.mReleaseMs = mReleaseMs.load(std::memory_order_relaxed);
+    return theParameters;
+}
+
+void    BGM_Limiters::Reset()
+{
+    for(Entry& theEntry : mEntries)
+    {
+        theEntry.mInUse = false;
+    }
+
+    mMixLimiter.Reset();
+}
+
+BGM_Limiter::Result BGM_Limiters::ProcessClientRT(UInt32 inClientID,
+                                                  Float32* ioBuffer,
+                                                  UInt32 inFrameCount,
+                                                  UInt32 inChannelCount,
+                                                  Float64 inSampleRate)
+{
+    // Finds the client's limiter the same way BGM_ClientGainRamps::NextBufferRT finds its ramp.
+    Entry* theEntry = nullptr;
+    Entry* theLeastRecentlyUsed = &mEntries[0];
+
+    for(Entry& theCandidate : mEntries)
+    {
+        if(theCandidate.mInUse && (theCandidate.mClientID == inClientID))
+        {
+            theEntry = &theCandidate;
+            break;
+        }
+
+        if(!theCandidate.mInUse ||
+           (theLeastRecentlyUsed->mInUse && (theCandidate.mLastUsed < theLeastRecentlyUsed->mLastUsed)))
+        {
+            theLeastRecentlyUsed = &theCandidate;
+        }
+    }
+
+    if(!theEntry)
+    {
+        theEntry = theLeastRecentlyUsed;
+        theEntry->mInUse = true;
+        theEntry->mClientID = inClientID;
+        theEntry->mLimiter.Reset();
+    }
+
+    theEntry->mLastUsed = ++mUseCounter;
+
+    return theEntry->mLimiter.ProcessRT(ioBuffer,
+                                        inFrameCount,
+                                        inChannelCount,
+                                        GetParametersRT(),
+                                        inSampleRate);
+}
+
+BGM_Limiter::Result BGM_Limiters::ProcessMixRT(Float32* ioBuffer,
+                                               UInt32 inFrameCount,
+                                               UInt32 inChannelCount,
+                                               Float64 inSampleRate)
+{
+    return mMixLimiter.ProcessRT(ioBuffer,
+                                 inFrameCount,
+                                 inChannelCount,
+                                 GetParametersRT(),
+                                 inSampleRate);
+}
+
+#pragma clang assume_nonnull end
+
@@ -0,0 +1,281 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_Limiter.h
+//  BGMDriver
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  A soft-knee peak limiter with a short lookahead, for audio that would otherwise be clipped.
+//  Boosted app volumes can push a client's samples past full scale and the clients' mix can go
+//  over it even when none of them do. Without a limiter the samples are just clamped to [-1, 1],
+//  which sounds harsh.
+//
+//  The limiter delays the audio by kLookaheadFrames so it can start turning the gain down before a
+//  peak arrives. The gain is the minimum of the gains the static (soft-knee) curve gives over the
+//  lookahead window, followed by an exponential release and a moving average the length of the
+//  lookahead, which makes the attack a smooth ramp that reaches the peak's gain exactly when the
+//  peak comes out of the delay line. All of the channels get the same gain, so the stereo (or
+//  surround) image doesn't shift.
+//
+//  Audio that stays below the knee is only delayed. That case is checked for each chunk of frames,
+//  so the limiter is cheap while it isn't limiting.
+//
+
+#ifndef BGMDriver__BGM_Limiter
+#define BGMDriver__BGM_Limiter
+
+// Local Includes
+#include "BGM_IOKernels.h"
+
+// STL Includes
+#include <atomic>
+
+// System Includes
+#include <MacTypes.h>
+
+
+#pragma clang assume_nonnull begin
+
+class BGM_Limiter
+{
+
+public:
+    struct Parameters
+    {
+        // The level the output peaks are limited to, in dBFS. Clamped to [kMinThresholdDb, 0].
+        Float32                 mThresholdDb;
+        // The width of the soft knee, centred on the threshold, in dB. Clamped to [0, kMaxKneeDb].
+        Float32                 mKneeDb;
+        // The time for the gain to recover after a peak, in ms. Clamped to [0, kMaxReleaseMs].
+        Float32                 mReleaseMs;
+    };
+
+    static const Float32        kMinThresholdDb;
+    static const Float32        kMaxKneeDb;
+    static const Float32        kMaxReleaseMs;
+
+    // -1 dBFS threshold, 2 dB knee and 60 ms release.
+    static Parameters           GetDefaultParameters();
+
+    // Returns inParameters with each value clamped to its range. NaNs are replaced with the
+    // closest limit.
+    static Parameters           ClampParameters(const Parameters& inParameters);
+
+    // The length of the delay line. About 1.3 ms at 48 kHz.
+    static const UInt32         kLookaheadFrames = 64;
+
+    struct Result
+    {
+        // The number of frames the limiter turned down.
+        UInt32                  mLimitedFrameCount;
+        // The most the limiter turned any frame down by, in dB. Positive, or 0 if it didn't.
+        Float32                 mMaxGainReductionDb;
+    };
+
+public:
+                                BGM_Limiter();
+                                BGM_Limiter(const BGM_Limiter&) = delete;
+                                BGM_Limiter& operator=(const BGM_Limiter&) = delete;
+
+    /*!
+     Clear the delay line and go back to unity gain. Real-time safe.
+     */
+    void                        Reset();
+
+    /*!
+     Limit the frames in ioBuffer. The output is delayed by kLookaheadFrames, so the first call
+     after a reset starts with that many frames of silence. The limiter is reset if the channel
+     count isn't the same as the last call's.
+
+     Real-time safe, but not thread safe.
+
+     @param ioBuffer Interleaved.
+     @param inChannelCount From 1 to BGM_IOKernels::kMaxChannelCount.
+     @param inParameters Should already be clamped. See ClampParameters.
+     @param inSampleRate Used for the release time.
+     */
+    Result                      ProcessRT(Float32* ioBuffer,
+                                          UInt32 inFrameCount,
+                                          UInt32 inChannelCount,
+                                          const Parameters& inParameters,
+                                          Float64 inSampleRate);
+
+private:
+    // The frames are processed in chunks so the per-frame gains fit in mGains.
+    static const UInt32         kChunkFrames = 128;
+    // The number of static gains the minimum is taken over. One more than the lookahead so the
+    // moving average only includes gains at or below the peak's.
+    static const UInt32         kMinWindowFrames = kLookaheadFrames + 1;
+
+    void                        ProcessChunk(Float32* ioBuffer,
+                                             UInt32 inFrameCount,
+                                             Float32 inKneeStartLevel,
+                                             Float32 inThresholdDb,
+                                             Float32 inKneeDb,
+                                             Float32 inReleaseCoefficient,
+                                             Float32& ioMinGain,
+                                             UInt32& ioLimitedFrameCount);
+    void                        DelayChunk(Float32* ioBuffer, UInt32 inFrameCount);
+    bool                        IsIdle() const { return (mReleaseGain == 1.0f) &&
+                                                        (mAverageReducedCount == 0); }
+
+private:
+    // Interleaved, with mChannelCount channels. mDelayPosition is the frame that will be output
+    // next.
+    Float32                     mDelayLine[kLookaheadFrames * BGM_IOKernels::kMaxChannelCount];
+    UInt32                      mDelayPosition;
+    UInt32                      mChannelCount;
+
+    // A monotonic queue of static gains for the sliding minimum. The values increase from the
+    // front to the back. Each one is stored with the (wrapping) index of its input frame.
+    Float32                     mMinValues[kMinWindowFrames];
+    UInt32                      mMinFrames[kMinWindowFrames];
+    UInt32                      mMinFront;
+    UInt32                      mMinCount;
+    UInt32                      mFrameCounter;
+
+    // The gain after the release, before it's smoothed.
+    Float32                     mReleaseGain;
+
+    // The moving average of mReleaseGain over the last kLookaheadFrames frames.
+    Float32                     mAverageValues[kLookaheadFrames];
+    UInt32                      mAveragePosition;
+    Float64                     mAverageSum;
+    // The number of values in mAverageValues below 1.0.
+    UInt32                      mAverageReducedCount;
+
+    Float32                     mGains[kChunkFrames];
+
+};
+
+//==================================================================================================
+//	BGM_Limiters
+//
+//  The limiters for a device: one for each client and one for the mix. The settings can be
+//  changed from any thread. The rest should only be called on the IO thread.
+//
+//  The clients' limiters are kept the same way as BGM_ClientGainRamps. When they're all taken,
+//  the least recently used one is reset and given to the client that needs one.
+//==================================================================================================
+
+class BGM_Limiters
+{
+
+public:
+    struct Settings
+    {
+        // Limit each client's audio after its relative volume is applied.
+        bool                    mClientsEnabled;
+        // Limit the mix before it's written to the loopback buffer.
+        bool                    mMixEnabled;
+        BGM_Limiter::Parameters mParameters;
+    };
+
+    // Both disabled, with BGM_Limiter's default parameters.
+    static Settings             GetDefaultSettings();
+
+public:
+                                BGM_Limiters();
+                                BGM_Limiters(const BGM_Limiters&) = delete;
+                                BGM_Limiters& operator=(const BGM_Limiters&) = delete;
+
+    /*! Can be called from any thread. Out of range parameters are clamped. */
+    void                        SetSettings(const Settings& inSettings);
+    Settings                    GetSettings() const;
+
+    /*!
+     Keep the mix limiter enabled while inMixRequired is true, whatever the settings say, e.g.
+     because the mix is being boosted and could go past full scale. GetSettings still returns the
+     settings. Can be called from any thread.
+     */
+    void                        SetMixRequired(bool inMixRequired);
+
+    bool                        AreClientsEnabled() const { return mClientsEnabled.load(); }
+    bool                        IsMixEnabled() const
+                                {
+                                    return mMixEnabled.load() || mMixRequired.load();
+                                }
+
+    /*!
+     @param inMixIsSilent True if the mix going into the mix limiter is silent.
+     @return True if the mix coming out of it is silent. The limiter delays the audio, so while
+             it's enabled its output might not be silent even if its input is. Real-time safe.
+     */
+    bool                        IsMixOutputSilentRT(bool inMixIsSilent) const
+                                {
+                                    return inMixIsSilent && !IsMixEnabled();
+                                }
+
+    /*!
+     @return The number of frames the enabled limiters delay the audio by. The client limiters and
+             the mix limiter each add BGM_Limiter::kLookaheadFrames. Can be called from any thread.
+     */
+    UInt32                      GetLatencyFrames() const;
+
+    /*! Reset all of the limiters, e.g. when IO starts. Not thread safe. */
+    void                        Reset();
+
+    /*!
+     Limit a client's audio. Real-time safe. Should only be called on the IO thread.
+     */
+    BGM_Limiter::Result         ProcessClientRT(UInt32 inClientID,
+                                                Float32* ioBuffer,
+                                                UInt32 inFrameCount,
+                                                UInt32 inChannelCount,
+                                                Float64 inSampleRate);
+
+    /*!
+     Limit the mix. Real-time safe. Should only be called on the IO thread.
+     */
+    BGM_Limiter::Result         ProcessMixRT(Float32* ioBuffer,
+                                             UInt32 inFrameCount,
+                                             UInt32 inChannelCount,
+                                             Float64 inSampleRate);
+
+private:
+    BGM_Limiter::Parameters     GetParametersRT() const;
+
+private:
+    struct Entry
+    {
+        bool                    mInUse;
+        UInt32                  mClientID;
+        UInt64                  mLastUsed;
+        BGM_Limiter             mLimiter;
+    };
+
+    // The same as BGM_ClientGainRamps.
+    static const UInt32         kMaxClients = 64;
+
+    Entry                       mEntries[kMaxClients];
+    UInt64                      mUseCounter;
+
+    BGM_Limiter                 mMixLimiter;
+
+    std::atomic<bool>           mClientsEnabled;
+    std::atomic<bool>           mMixEnabled;
+    std::atomic<bool>           mMixRequired { false };
+    std::atomic<Float32>        mThresholdDb;
+    std::atomic<Float32>        mKneeDb;
+    std::atomic<Float32>        mReleaseMs;
+
+};
+
+#pragma clang assume_nonnull end
+
+#endif /* BGMDriver__BGM_Limiter */
+
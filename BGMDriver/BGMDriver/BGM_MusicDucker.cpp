@@ -0,0 +1,145 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_MusicDucker.cpp
+//  BGMDriver
+//
+//  Copyright © 2026 Kyle Neideck
+//
+
+// Self Include
+#include "BGM_MusicDucker.h"
+
+// STL Includes
+#include <algorithm>
+#include <cmath>
+
+
+#pragma clang assume_nonnull begin
+
+const Float32 BGM_MusicDucker::kMinDepthDb = -96.0f;
+const Float32 BGM_MusicDucker::kMaxTimeMs = 10000.0f;
+
+// static
+BGM_MusicDucker::Parameters BGM_MusicDucker::GetDefaultParameters()
+{
+    Parameters theParameters;
+    theParameters.mEnabled = false;
+    theParameters.mDepthDb = -20.0f;
+    // Short enough to finish within a typical IO buffer.
+    theParameters.mAttackMs = 5.0f;
+    // Long enough to bridge the gaps between words in speech.
+    theParameters.mHoldMs = 300.0f;
+    theParameters.mReleaseMs = 500.0f;
+    return theParameters;
+}
+
+BGM_MusicDucker::BGM_MusicDucker()
+:
+    mGainRamp(1.0f),
+    mLastBufferSampleTime(-1.0),
+    mLastBufferFrameSize(0),
+    mLastBufferGains{ 1.0f, 0.0f, 0, 1.0f }
+{
+    SetParameters(GetDefaultParameters());
+}
+
+void    BGM_MusicDucker::SetParameters(const Parameters& inParameters)
+{
+    // The comparisons are written this way so NaNs are replaced as well.
+    mDepthDb.store((inParameters.mDepthDb >= kMinDepthDb) ? std::min(inParameters.mDepthDb, 0.0f)
+                                                          : kMinDepthDb);
+    mAttackMs.store((inParameters.mAttackMs >= 0.0f) ? std::min(inParameters.mAttackMs, kMaxTimeMs)
+                                                     : 0.0f);
+    mHoldMs.store((inParameters.mHoldMs >= 0.0f) ? std::min(inParameters.mHoldMs, kMaxTimeMs)
+                                                 : 0.0f);
+    mReleaseMs.store((inParameters.mReleaseMs >= 0.0f) ? std::min(inParameters.mReleaseMs, kMaxTimeMs)
+                                                       : 0.0f);
+    mEnabled.store(inParameters.mEnabled);
+}
+
+BGM_MusicDucker::Parameters BGM_MusicDucker::GetParameters() const
+{
+    Parameters theParameters;
+    theParameters.mEnabled = mEnabled.load();
+    theParameters.mDepthDb = mDepthDb.load();
+    theParameters.mAttackMs = mAttackMs.load();
+    theParameters.mHoldMs = mHoldMs.load();
+    theParameters.mReleaseMs = mReleaseMs.load();
+    return theParameters;
+}
+
+void    BGM_MusicDucker::Reset()
+{
+    mGainRamp.Reset(1.0f);
+    mLastBufferSampleTime = -1.0;
+}
+
+BGM_IOKernels::GainRamp BGM_MusicDucker::NextMusicBufferRT(UInt32 inIOBufferFrameSize,
+                                                           Float64 inOutputSampleTime,
+                                                           Float64 inLatestAudibleNonMusicSampleTime,
+                                                           Float64 inSampleRate)
+{
+    // Another music player client has already advanced the ramp for this IO cycle.
+    if((inOutputSampleTime == mLastBufferSampleTime) && (inIOBufferFrameSize == mLastBufferFrameSize))
+    {
+        return mLastBufferGains;
+    }
+
+    bool theShouldDuck = false;
+
+    if(mEnabled.load(std::memory_order_relaxed) && (inLatestAudibleNonMusicSampleTime != 0))
+    {
+        // The HAL can process the music player's buffer before the other clients' buffers for the
+        // same IO cycle, so the latest audible non-music frame can be up to a buffer old even if
+        // the other audio is still playing. The hold time is never shorter than that.
+        Float64 theHoldFrames =
+                std::max(static_cast<Float64>(MsToFrames(mHoldMs.load(std::memory_order_relaxed),
+                                                         inSampleRate)),
+                         static_cast<Float64>(inIOBufferFrameSize));
+
+        theShouldDuck =
+                (inOutputSampleTime - inLatestAudibleNonMusicSampleTime) <= theHoldFrames;
+    }
+
+    Float32 theTargetGain = 1.0f;
+    UInt32 theRampLengthFrames;
+
+    if(theShouldDuck)
+    {
+        theTargetGain = powf(10.0f, mDepthDb.load(std::memory_order_relaxed) / 20.0f);
+        theRampLengthFrames = MsToFrames(mAttackMs.load(std::memory_order_relaxed), inSampleRate);
+    }
+    else
+    {
+        theRampLengthFrames = MsToFrames(mReleaseMs.load(std::memory_order_relaxed), inSampleRate);
+    }
+
+    mLastBufferSampleTime = inOutputSampleTime;
+    mLastBufferFrameSize = inIOBufferFrameSize;
+    mLastBufferGains = mGainRamp.NextBuffer(theTargetGain, inIOBufferFrameSize, theRampLengthFrames);
+
+    return mLastBufferGains;
+}
+
+// static
+UInt32  BGM_MusicDucker::MsToFrames(Float32 inMs, Float64 inSampleRate)
+{
+    return static_cast<UInt32>(static_cast<Float64>(inMs) / 1000.0 * inSampleRate + 0.5);
+}
+
+#pragma clang assume_nonnull end
+
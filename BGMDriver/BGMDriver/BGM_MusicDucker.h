@@ -0,0 +1,128 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_MusicDucker.h
+//  BGMDriver
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  Turns the music player down while other audio is playing and back up once it stops. This is
+//  an alternative to BGMApp pausing the music player (see BGMAutoPauseMusic), which has to wait
+//  for the audible state to change, tell BGMApp and then go through the music player's scripting
+//  interface. Since the ducker runs on the IO thread it can react within an IO cycle.
+//
+//  The ducker uses the non-music audio detection in BGM_AudibleState. When a non-music client's
+//  audio is audible, the music player's gain ramps down to the ducking depth over the attack time.
+//  It stays down until no non-music audio has been audible for the hold time and then ramps back
+//  up over the release time.
+//
+//  The parameters can be set from any thread. Everything else should only be called on the IO
+//  thread.
+//
+
+#ifndef BGMDriver__BGM_MusicDucker
+#define BGMDriver__BGM_MusicDucker
+
+// Local Includes
+#include "BGM_GainRamp.h"
+#include "BGM_IOKernels.h"
+
+// STL Includes
+#include <atomic>
+
+// System Includes
+#include <MacTypes.h>
+
+
+#pragma clang assume_nonnull begin
+
+class BGM_MusicDucker
+{
+
+public:
+    struct Parameters
+    {
+        bool                    mEnabled;
+        // How far to turn the music down, in dB. Clamped to [kMinDepthDb, 0].
+        Float32                 mDepthDb;
+        // The times are clamped to [0, kMaxTimeMs].
+        Float32                 mAttackMs;
+        Float32                 mHoldMs;
+        Float32                 mReleaseMs;
+    };
+
+    static const Float32        kMinDepthDb;
+    static const Float32        kMaxTimeMs;
+
+    // Disabled, -20 dB, 5 ms attack, 300 ms hold and 500 ms release.
+    static Parameters           GetDefaultParameters();
+
+public:
+                                BGM_MusicDucker();
+                                BGM_MusicDucker(const BGM_MusicDucker&) = delete;
+                                BGM_MusicDucker& operator=(const BGM_MusicDucker&) = delete;
+
+    /*! Can be called from any thread. Out of range values are clamped. */
+    void                        SetParameters(const Parameters& inParameters);
+    Parameters                  GetParameters() const;
+
+    /*! Restore the music player's full volume immediately, e.g. when IO starts. */
+    void                        Reset();
+
+    /*!
+     Get the gains to apply to the music player's next IO buffer. The ramp only advances once per
+     IO cycle, so if more than one client is the music player, e.g. a player with two output
+     streams, they all get the same gains for the same cycle.
+
+     Real-time safe. Not thread safe.
+
+     @param inIOBufferFrameSize The number of frames in the music player's buffer.
+     @param inOutputSampleTime The sample time of the first frame of the buffer.
+     @param inLatestAudibleNonMusicSampleTime The sample time of the latest audible frame from a
+                                              client other than the music player, or 0 if there
+                                              hasn't been one. See BGM_AudibleState.
+     @param inSampleRate The device's sample rate.
+     */
+    BGM_IOKernels::GainRamp     NextMusicBufferRT(UInt32 inIOBufferFrameSize,
+                                                  Float64 inOutputSampleTime,
+                                                  Float64 inLatestAudibleNonMusicSampleTime,
+                                                  Float64 inSampleRate);
+
+private:
+    static UInt32               MsToFrames(Float32 inMs, Float64 inSampleRate);
+
+private:
+    std::atomic<bool>           mEnabled;
+    std::atomic<Float32>        mDepthDb;
+    std::atomic<Float32>        mAttackMs;
+    std::atomic<Float32>        mHoldMs;
+    std::atomic<Float32>        mReleaseMs;
+
+    // The music player's gain. Only used on the IO thread.
+    BGM_GainRamp                mGainRamp;
+    // The sample time and size of the last buffer NextMusicBufferRT was called for and the gains
+    // it returned, so it can return them again for other clients in the same IO cycle. The sample
+    // time is -1 if there isn't one. Only used on the IO thread.
+    Float64                     mLastBufferSampleTime;
+    UInt32                      mLastBufferFrameSize;
+    BGM_IOKernels::GainRamp     mLastBufferGains;
+
+};
+
+#pragma clang assume_nonnull end
+
+#endif /* BGMDriver__BGM_MusicDucker */
+
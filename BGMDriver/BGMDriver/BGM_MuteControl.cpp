@@ -54,26 +54,29 @@ BGM_MuteControl::BGM_MuteControl(AudioObjectID inObjectID,
 
 #pragma mark Property Operations
 
+//static
+const BGM_PropertyTable<BGM_MuteControl>& BGM_MuteControl::GetPropertyTable()
+{
+    static constexpr BGM_PropertyDescriptor<BGM_MuteControl> kProperties[] = {
+        { kAudioBooleanControlPropertyValue, kBGMPropertyFlag_Settable, sizeof(UInt32), nullptr }
+    };
+
+    static constexpr auto kPropertySlots = BGM_MakePropertySlots<BGM_PropertyShift(kProperties)>(kProperties);
+    static constexpr BGM_PropertyTable<BGM_MuteControl> kPropertyTable(kPropertySlots);
+    return kPropertyTable;
+}
+
 bool    BGM_MuteControl::HasProperty(AudioObjectID inObjectID,
                                      pid_t inClientPID,
                                      const AudioObjectPropertyAddress& inAddress) const
 {
     CheckObjectID(inObjectID);
 
-    bool theAnswer = false;
-
-    switch(inAddress.mSelector)
-    {
-        case kAudioBooleanControlPropertyValue:
-            theAnswer = true;
-            break;
-
-        default:
-            theAnswer = BGM_Control::HasProperty(inObjectID, inClientPID, inAddress);
-            break;
-    };
+    auto theProperty = GetPropertyTable().Find(inAddress.mSelector);
 
-    return theAnswer;
+    return (theProperty != nullptr) ?
+            theProperty->HasProperty(inAddress) :
+            BGM_Control::HasProperty(inObjectID, inClientPID, inAddress);
 }
 
 bool    BGM_MuteControl::IsPropertySettable(AudioObjectID inObjectID,
@@ -82,20 +85,11 @@ bool    BGM_MuteControl::IsPropertySettable(AudioObjectID inObjectID,
 {
     CheckObjectID(inObjectID);
 
-    bool theAnswer = false;
-
-    switch(inAddress.mSelector)
-    {
-        case kAudioBooleanControlPropertyValue:
-            theAnswer = true;
-            break;
-
-        default:
-            theAnswer = BGM_Control::IsPropertySettable(inObjectID, inClientPID, inAddress);
-            break;
-    };
+    auto theProperty = GetPropertyTable().Find(inAddress.mSelector);
 
-    return theAnswer;
+    return (theProperty != nullptr) ?
+            theProperty->IsSettable() :
+            BGM_Control::IsPropertySettable(inObjectID, inClientPID, inAddress);
 }
 
 UInt32  BGM_MuteControl::GetPropertyDataSize(AudioObjectID inObjectID,
@@ -106,24 +100,15 @@ UInt32  BGM_MuteControl::GetPropertyDataSize(AudioObjectID inObjectID,
 {
     CheckObjectID(inObjectID);
 
-    UInt32 theAnswer = 0;
-
-    switch(inAddress.mSelector)
-    {
-        case kAudioBooleanControlPropertyValue:
-            theAnswer = sizeof(UInt32);
-            break;
-
-        default:
-            theAnswer = BGM_Control::GetPropertyDataSize(inObjectID,
-                                                         inClientPID,
-                                                         inAddress,
-                                                         inQualifierDataSize,
-                                                         inQualifierData);
-            break;
-    };
+    auto theProperty = GetPropertyTable().Find(inAddress.mSelector);
 
-    return theAnswer;
+    return (theProperty != nullptr) ?
+            theProperty->GetDataSize(*this, inAddress) :
+            BGM_Control::GetPropertyDataSize(inObjectID,
+                                             inClientPID,
+                                             inAddress,
+                                             inQualifierDataSize,
+                                             inQualifierData);
 }
 
 void    BGM_MuteControl::GetPropertyData(AudioObjectID inObjectID,
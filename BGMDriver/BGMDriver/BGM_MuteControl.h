@@ -26,6 +26,9 @@
 // Superclass Includes
 #include "BGM_Control.h"
 
+// Local Includes
+#include "BGM_PropertyTable.h"
+
 // PublicUtility Includes
 #include "CAMutex.h"
 
@@ -87,6 +90,8 @@ public:
 #pragma mark Implementation
 
 private:
+    static const BGM_PropertyTable<BGM_MuteControl>& GetPropertyTable();
+
     CAMutex                   mMutex;
     bool                      mMuted;
 
@@ -122,28 +122,39 @@ void    BGM_NullDevice::SendDeviceIsAlivePropertyNotifications()
 
 #pragma mark Property Operations
 
+//static
+const BGM_PropertyTable<BGM_NullDevice>& BGM_NullDevice::GetPropertyTable()
+{
+    static constexpr BGM_PropertyDescriptor<BGM_NullDevice> kProperties[] = {
+        { kAudioDevicePropertyDeviceCanBeDefaultDevice,         0, sizeof(UInt32),              nullptr },
+        { kAudioDevicePropertyDeviceCanBeDefaultSystemDevice,   0, sizeof(UInt32),              nullptr },
+        { kAudioDevicePropertyStreams,                          0, 1 * sizeof(AudioObjectID),   nullptr },
+        { kAudioDevicePropertyAvailableNominalSampleRates,      0, 1 * sizeof(AudioValueRange), nullptr }
+    };
+
+    static_assert(BGM_PropertySelectorsAreUnique(kProperties),
+                  "BGM_NullDevice has duplicate properties");
+
+    static constexpr auto kPropertySlots = BGM_MakePropertySlots<BGM_PropertyShift(kProperties)>(kProperties);
+    static constexpr BGM_PropertyTable<BGM_NullDevice> kPropertyTable(kPropertySlots);
+    return kPropertyTable;
+}
+
 bool    BGM_NullDevice::HasProperty(AudioObjectID inObjectID,
                                     pid_t inClientPID,
                                     const AudioObjectPropertyAddress& inAddress) const
 {
+    // Forward stream properties.
     if(inObjectID == mStream.GetObjectID())
     {
         return mStream.HasProperty(inObjectID, inClientPID, inAddress);
     }
 
-    bool theAnswer = false;
-    switch(inAddress.mSelector)
-    {
-        case kAudioDevicePropertyDeviceCanBeDefaultDevice:
-        case kAudioDevicePropertyDeviceCanBeDefaultSystemDevice:
-            theAnswer = true;
-            break;
+    auto theProperty = GetPropertyTable().Find(inAddress.mSelector);
 
-        default:
-            theAnswer = BGM_AbstractDevice::HasProperty(inObjectID, inClientPID, inAddress);
-            break;
-    };
-    return theAnswer;
+    return (theProperty != nullptr) ?
+            theProperty->HasProperty(inAddress) :
+            BGM_AbstractDevice::HasProperty(inObjectID, inClientPID, inAddress);
 }
 
 bool    BGM_NullDevice::IsPropertySettable(AudioObjectID inObjectID,
@@ -156,16 +167,11 @@ bool    BGM_NullDevice::IsPropertySettable(AudioObjectID inObjectID,
         return mStream.IsPropertySettable(inObjectID, inClientPID, inAddress);
     }
 
-    bool theAnswer = false;
+    auto theProperty = GetPropertyTable().Find(inAddress.mSelector);
 
-    switch(inAddress.mSelector)
-    {
-        default:
-            theAnswer = BGM_AbstractDevice::IsPropertySettable(inObjectID, inClientPID, inAddress);
-            break;
-    };
-
-    return theAnswer;
+    return (theProperty != nullptr) ?
+            theProperty->IsSettable() :
+            BGM_AbstractDevice::IsPropertySettable(inObjectID, inClientPID, inAddress);
 }
 
 UInt32    BGM_NullDevice::GetPropertyDataSize(AudioObjectID inObjectID,
@@ -184,28 +190,15 @@ UInt32    BGM_NullDevice::GetPropertyDataSize(AudioObjectID inObjectID,
                                            inQualifierData);
     }
 
-    UInt32 theAnswer = 0;
-
-    switch(inAddress.mSelector)
-    {
-        case kAudioDevicePropertyStreams:
-            theAnswer = 1 * sizeof(AudioObjectID);
-            break;
-
-        case kAudioDevicePropertyAvailableNominalSampleRates:
-            theAnswer = 1 * sizeof(AudioValueRange);
-            break;
-
-        default:
-            theAnswer = BGM_AbstractDevice::GetPropertyDataSize(inObjectID,
-                                                                inClientPID,
-                                                                inAddress,
-                                                                inQualifierDataSize,
-                                                                inQualifierData);
-            break;
-    };
+    auto theProperty = GetPropertyTable().Find(inAddress.mSelector);
 
-    return theAnswer;
+    return (theProperty != nullptr) ?
+            theProperty->GetDataSize(*this, inAddress) :
+            BGM_AbstractDevice::GetPropertyDataSize(inObjectID,
+                                                    inClientPID,
+                                                    inAddress,
+                                                    inQualifierDataSize,
+                                                    inQualifierData);
 }
 
 void    BGM_NullDevice::GetPropertyData(AudioObjectID inObjectID,
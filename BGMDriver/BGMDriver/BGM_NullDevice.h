@@ -45,6 +45,7 @@
 // Local Includes
 #include "BGM_Types.h"
 #include "BGM_Stream.h"
+#include "BGM_PropertyTable.h"
 
 // PublicUtility Includes
 #include "CAMutex.h"
@@ -160,6 +161,8 @@ public:
 #pragma clang diagnostic pop
 
 private:
+    static const BGM_PropertyTable<BGM_NullDevice>& GetPropertyTable();
+
     static pthread_once_t       sStaticInitializer;
     static BGM_NullDevice*      sInstance;
 
@@ -0,0 +1,290 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_PersistentState.cpp
+//  BGMDriver
+//
+//  Copyright © 2026 Kyle Neideck
+//
+
+// Self Include
+#include "BGM_PersistentState.h"
+
+// STL Includes
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <string>
+
+
+#pragma clang assume_nonnull begin
+
+namespace
+{
+    const UInt8 kFlagVolumeControlEnabled = 1 << 0;
+    const UInt8 kFlagMuteControlEnabled = 1 << 1;
+
+    // The range of BGM_Client::mRelativeVolume.
+    const Float32 kMaxRelativeVolume = 4.0f;
+    const SInt32 kMaxPanPosition = 100;
+
+    class Writer
+    {
+
+    public:
+        void                    WriteUInt8(UInt8 inValue) { mData.push_back(inValue); }
+
+        void                    WriteUInt16(UInt16 inValue)
+        {
+            WriteUInt8(static_cast<UInt8>(inValue));
+            WriteUInt8(static_cast<UInt8>(inValue >> 8));
+        }
+
+        void                    WriteUInt32(UInt32 inValue)
+        {
+            WriteUInt16(static_cast<UInt16>(inValue));
+            WriteUInt16(static_cast<UInt16>(inValue >> 16));
+        }
+
+        void                    WriteFloat32(Float32 inValue)
+        {
+            UInt32 theBits;
+            memcpy(&theBits, &inValue, sizeof(theBits));
+            WriteUInt32(theBits);
+        }
+
+        // Strings longer than a UInt16 count are truncated. (Bundle IDs are limited to 255 bytes
+        // anyway.)
+        void                    WriteString(const BGM_String& inString)
+        {
+            std::string theUTF8 = BGM_StringToUTF8(inString);
+            size_t theSize = std::min(theUTF8.size(),
+                                      static_cast<size_t>(std::numeric_limits<UInt16>::max()));
+
+            WriteUInt16(static_cast<UInt16>(theSize));
+            mData.insert(mData.end(), theUTF8.data(), theUTF8.data() + theSize);
+        }
+
+        std::vector<UInt8>      mData;
+
+    };
+
+    // Each Read method returns false if there aren't enough bytes left.
+    class Reader
+    {
+
+    public:
+                                Reader(const UInt8* inData, size_t inDataSize)
+                                :
+                                    mData(inData),
+                                    mRemaining(inDataSize)
+                                { }
+
+        bool                    ReadUInt8(UInt8& outValue)
+        {
+            if(mRemaining < 1)
+            {
+                return false;
+            }
+
+            outValue = *mData;
+            mData++;
+            mRemaining--;
+            return true;
+        }
+
+        bool                    ReadUInt16(UInt16& outValue)
+        {
+            if(mRemaining < 2)
+            {
+                return false;
+            }
+
+            outValue = static_cast<UInt16>(mData[0] | (mData[1] << 8));
+            mData += 2;
+            mRemaining -= 2;
+            return true;
+        }
+
+        bool                    ReadUInt32(UInt32& outValue)
+        {
+            UInt16 theLow;
+            UInt16 theHigh;
+
+            if(!ReadUInt16(theLow) || !ReadUInt16(theHigh))
+            {
+                return false;
+            }
+
+            outValue = theLow | (static_cast<UInt32>(theHigh) << 16);
+            return true;
+        }
+
+        bool                    ReadFloat32(Float32& outValue)
+        {
+            UInt32 theBits;
+
+            if(!ReadUInt32(theBits))
+            {
+                return false;
+            }
+
+            memcpy(&outValue, &theBits, sizeof(outValue));
+            return true;
+        }
+
+        bool                    ReadString(std::string& outString)
+        {
+            UInt16 theSize;
+
+            if(!ReadUInt16(theSize) || mRemaining < theSize)
+            {
+                return false;
+            }
+
+            outString.assign(reinterpret_cast<const char*>(mData), theSize);
+            mData += theSize;
+            mRemaining -= theSize;
+            return true;
+        }
+
+        bool                    IsAtEnd() const { return mRemaining == 0; }
+
+    private:
+        const UInt8*            mData;
+        size_t                  mRemaining;
+
+    };
+}
+
+std::vector<UInt8> BGM_PersistentState::Encode(const State& inState)
+{
+    Writer theWriter;
+
+    theWriter.WriteUInt32(kMagic);
+    theWriter.WriteUInt32(kFormatVersion);
+
+    UInt8 theFlags = static_cast<UInt8>((inState.mVolumeControlEnabled ? kFlagVolumeControlEnabled : 0) |
+                                        (inState.mMuteControlEnabled ? kFlagMuteControlEnabled : 0));
+    theWriter.WriteUInt8(theFlags);
+
+    theWriter.WriteString(inState.mMusicPlayerBundleID);
+
+    UInt32 theAppCount = 0;
+    for(const BGM_Client& theApp : inState.mApps)
+    {
+        if(theApp.mBundleID.IsValid())
+        {
+            theAppCount++;
+        }
+    }
+
+    theWriter.WriteUInt32(theAppCount);
+
+    for(const BGM_Client& theApp : inState.mApps)
+    {
+        if(theApp.mBundleID.IsValid())
+        {
+            theWriter.WriteString(theApp.mBundleID);
+            theWriter.WriteFloat32(theApp.mRelativeVolume);
+            theWriter.WriteUInt32(static_cast<UInt32>(theApp.mPanPosition));
+        }
+    }
+
+    return theWriter.mData;
+}
+
+bool BGM_PersistentState::Decode(const UInt8* __nullable inData, size_t inDataSize, State& outState)
+{
+    if(inData == nullptr)
+    {
+        return false;
+    }
+
+    Reader theReader(inData, inDataSize);
+
+    UInt32 theMagic;
+    UInt32 theVersion;
+
+    if(!theReader.ReadUInt32(theMagic) || theMagic != kMagic ||
+       !theReader.ReadUInt32(theVersion) || theVersion != kFormatVersion)
+    {
+        return false;
+    }
+
+    State theState;
+
+    UInt8 theFlags;
+    std::string theMusicPlayerBundleID;
+    UInt32 theAppCount;
+
+    if(!theReader.ReadUInt8(theFlags) ||
+       !theReader.ReadString(theMusicPlayerBundleID) ||
+       !theReader.ReadUInt32(theAppCount))
+    {
+        return false;
+    }
+
+    theState.mVolumeControlEnabled = (theFlags & kFlagVolumeControlEnabled) != 0;
+    theState.mMuteControlEnabled = (theFlags & kFlagMuteControlEnabled) != 0;
+    theState.mMusicPlayerBundleID = BGM_StringFromUTF8(theMusicPlayerBundleID);
+
+    for(UInt32 i = 0; i < theAppCount; i++)
+    {
+        std::string theBundleID;
+        Float32 theRelativeVolume;
+        UInt32 thePanPosition;
+
+        if(!theReader.ReadString(theBundleID) ||
+           !theReader.ReadFloat32(theRelativeVolume) ||
+           !theReader.ReadUInt32(thePanPosition))
+        {
+            return false;
+        }
+
+        SInt32 theSignedPanPosition = static_cast<SInt32>(thePanPosition);
+
+        // The comparisons are false for NaNs.
+        bool theVolumeIsValid = (theRelativeVolume >= 0.0f && theRelativeVolume <= kMaxRelativeVolume);
+        bool thePanIsValid = (theSignedPanPosition >= -kMaxPanPosition &&
+                              theSignedPanPosition <= kMaxPanPosition);
+
+        if(theBundleID.empty() || !theVolumeIsValid || !thePanIsValid)
+        {
+            return false;
+        }
+
+        BGM_Client theApp;
+        theApp.mClientID = 0;
+        theApp.mProcessID = -1;
+        theApp.mBundleID = BGM_StringFromUTF8(theBundleID);
+        theApp.mRelativeVolume = theRelativeVolume;
+        theApp.mPanPosition = theSignedPanPosition;
+
+        theState.mApps.push_back(theApp);
+    }
+
+    if(!theReader.IsAtEnd())
+    {
+        return false;
+    }
+
+    outState = theState;
+    return true;
+}
+
+#pragma clang assume_nonnull end
+
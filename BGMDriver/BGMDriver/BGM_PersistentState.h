@@ -0,0 +1,98 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_PersistentState.h
+//  BGMDriver
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  The settings BGM_Device saves in the host's storage (see WriteToStorage in AudioServerPlugIn.h)
+//  so it can restore them as soon as coreaudiod loads the driver again, rather than waiting for
+//  BGMApp to launch and set them.
+//
+//  The state is encoded as a small binary blob. All of the numbers are little-endian:
+//
+//      UInt32      kMagic
+//      UInt32      The format version, kFormatVersion.
+//      UInt8       Flags. Bit 0 is set if the volume control is enabled and bit 1 if the mute
+//                  control is.
+//      String      The music player's bundle ID. Empty if it's unset.
+//      UInt32      The number of apps, followed by that many of:
+//          String      The app's bundle ID. Never empty.
+//          Float32     The app's relative volume, after the volume curve. See BGM_Client.
+//          SInt32      The app's pan position.
+//
+//  Strings are a UInt16 byte count followed by that many bytes of UTF-8, without a terminator.
+//
+//  Decode rejects blobs with a newer format version, so a downgraded driver just starts with the
+//  default settings, and any blob that's truncated, has trailing bytes or has values out of range.
+//
+
+#ifndef BGMDriver__BGM_PersistentState
+#define BGMDriver__BGM_PersistentState
+
+// Local Includes
+#include "BGM_Client.h"
+#include "BGM_Platform.h"
+
+// STL Includes
+#include <vector>
+
+// System Includes
+#include <MacTypes.h>
+
+
+#pragma clang assume_nonnull begin
+
+class BGM_PersistentState
+{
+
+public:
+    // 'BGMs'
+    static const UInt32         kMagic = 0x42474D73;
+    static const UInt32         kFormatVersion = 1;
+
+    struct State
+    {
+        bool                    mVolumeControlEnabled = true;
+        bool                    mMuteControlEnabled = true;
+        // Invalid if the music player is unset or was only set by process ID, which wouldn't mean
+        // anything after a restart.
+        BGM_String              mMusicPlayerBundleID;
+        // Only the bundle IDs, relative volumes and pan positions are saved. Clients without bundle
+        // IDs are skipped.
+        std::vector<BGM_Client> mApps;
+    };
+
+    /*! @return inState in the format described above. */
+    static std::vector<UInt8>   Encode(const State& inState);
+
+    /*!
+     Decode a blob made by Encode. Only the decoded apps' bundle IDs, relative volumes and pan
+     positions are meaningful. Their client IDs are set to 0 and their process IDs to -1.
+
+     @return True if the blob was valid, in which case outState has been set.
+     */
+    static bool                 Decode(const UInt8* __nullable inData,
+                                       size_t inDataSize,
+                                       State& outState);
+
+};
+
+#pragma clang assume_nonnull end
+
+#endif /* BGMDriver__BGM_PersistentState */
+
@@ -36,6 +36,7 @@
 #include "CADebugMacros.h"
 #include "CAPropertyAddress.h"
 #include "CADispatchQueue.h"
+#include "CAHostTimeBase.h"
 
 
 #pragma mark Construction/Destruction
@@ -43,6 +44,7 @@
 pthread_once_t				BGM_PlugIn::sStaticInitializer = PTHREAD_ONCE_INIT;
 BGM_PlugIn*					BGM_PlugIn::sInstance = NULL;
 AudioServerPlugInHostRef	BGM_PlugIn::sHost = NULL;
+UInt64						BGM_PlugIn::sLoadHostTime = 0;
 
 BGM_PlugIn& BGM_PlugIn::GetInstance()
 {
@@ -52,6 +54,8 @@ BGM_PlugIn& BGM_PlugIn::GetInstance()
 
 void	BGM_PlugIn::StaticInitializer()
 {
+    sLoadHostTime = CAHostTimeBase::GetTheCurrentTime();
+
     try
     {
         sInstance = new BGM_PlugIn;
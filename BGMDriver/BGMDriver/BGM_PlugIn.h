@@ -62,6 +62,9 @@ public:
 	
 	static void						Host_PropertiesChanged(AudioObjectID inObjectID, UInt32 inNumberAddresses, const AudioObjectPropertyAddress inAddresses[])	{ if(sHost != NULL) { sHost->PropertiesChanged(sHost, inObjectID, inNumberAddresses, inAddresses); } }
 	static void						Host_RequestDeviceConfigurationChange(AudioObjectID inDeviceObjectID, UInt64 inChangeAction, void* inChangeInfo)			{ if(sHost != NULL) { sHost->RequestDeviceConfigurationChange(sHost, inDeviceObjectID, inChangeAction, inChangeInfo); } }
+	// The caller owns the data *outData is set to, if it isn't set to NULL.
+	static OSStatus					Host_CopyFromStorage(CFStringRef inKey, CFPropertyListRef* outData)		{ *outData = NULL; return (sHost != NULL) ? sHost->CopyFromStorage(sHost, inKey, outData) : kAudioHardwareNotRunningError; }
+	static OSStatus					Host_WriteToStorage(CFStringRef inKey, CFPropertyListRef inData)		{ return (sHost != NULL) ? sHost->WriteToStorage(sHost, inKey, inData) : kAudioHardwareNotRunningError; }
 
 #pragma mark Property Operations
     
@@ -76,6 +79,8 @@ public:
     
 public:
     const CFStringRef               GetBundleID() const { return CFSTR(kBGMDriverBundleID); }
+    // The host time when the host loaded the driver, i.e. when the plug-in object was created.
+    static UInt64                   GetLoadHostTime() { return sLoadHostTime; }
     
 private:
     CAMutex							mMutex;
@@ -83,6 +88,7 @@ private:
     static pthread_once_t			sStaticInitializer;
     static BGM_PlugIn*				sInstance;
 	static AudioServerPlugInHostRef	sHost;
+	static UInt64					sLoadHostTime;
 
 };
 
@@ -111,6 +111,7 @@ static BGM_Object& BGM_LookUpOwnerObject(AudioObjectID inObjectID)
         case kObjectID_Stream_Output:
         case kObjectID_Volume_Output_Master:
         case kObjectID_Mute_Output_Master:
+        case kObjectID_Volume_Boost:
             return BGM_Device::GetInstance();
 
         case kObjectID_Device_UI_Sounds:
@@ -35,21 +35,32 @@
 #include "CAPropertyAddress.h"
 #include "CADispatchQueue.h"
 
+// STL Includes
+#include <algorithm>
+#include <iterator>
+
 
 #pragma clang assume_nonnull begin
 
+// The channel counts a stream can have: stereo, 5.1 and 7.1. BGM_IOKernels has an instantiation of
+// its kernels for each of them. See BGM_IOKernels::DispatchOnChannelCount.
+static const UInt32 kChannelCounts[] = { 2, 6, 8 };
+
 BGM_Stream::BGM_Stream(AudioObjectID inObjectID,
                        AudioDeviceID inOwnerDeviceID,
                        bool inIsInput,
                        Float64 inSampleRate,
-                       UInt32 inStartingChannel)
+                       UInt32 inStartingChannel,
+                       UInt32 inMaxChannelCount)
 :
     BGM_Object(inObjectID, kAudioStreamClassID, kAudioObjectClassID, inOwnerDeviceID),
     mStateMutex(inIsInput ? "Input Stream State" : "Output Stream State"),
     mIsInput(inIsInput),
     mIsStreamActive(false),
     mSampleRate(inSampleRate),
-    mStartingChannel(inStartingChannel)
+    mStartingChannel(inStartingChannel),
+    mChannelCount(2),
+    mMaxChannelCount(inMaxChannelCount)
 {
 }
 
@@ -57,71 +68,51 @@ BGM_Stream::~BGM_Stream()
 {
 }
 
-bool    BGM_Stream::HasProperty(AudioObjectID inObjectID,
-                                pid_t inClientPID,
-                                const AudioObjectPropertyAddress& inAddress) const
+//static
+const BGM_PropertyTable<BGM_Stream>& BGM_Stream::GetPropertyTable()
 {
-    //    For each object, this driver implements all the required properties plus a few extras that
-    //    are useful but not required. There is more detailed commentary about each property in the
-    //    GetPropertyData() method.
+    // For each object, this driver implements all the required properties plus a few extras that
+    // are useful but not required. There is more detailed commentary about each property in the
+    // GetPropertyData() method.
+    static constexpr BGM_PropertyDescriptor<BGM_Stream> kProperties[] = {
+        { kAudioStreamPropertyIsActive,                 kBGMPropertyFlag_Settable,  sizeof(UInt32),                              nullptr },
+        { kAudioStreamPropertyDirection,                0,                          sizeof(UInt32),                              nullptr },
+        { kAudioStreamPropertyTerminalType,             0,                          sizeof(UInt32),                              nullptr },
+        { kAudioStreamPropertyStartingChannel,          0,                          sizeof(UInt32),                              nullptr },
+        { kAudioStreamPropertyLatency,                  0,                          sizeof(UInt32),                              nullptr },
+        { kAudioStreamPropertyVirtualFormat,            kBGMPropertyFlag_Settable,  sizeof(AudioStreamBasicDescription),         nullptr },
+        { kAudioStreamPropertyPhysicalFormat,           kBGMPropertyFlag_Settable,  sizeof(AudioStreamBasicDescription),         nullptr },
+        { kAudioStreamPropertyAvailableVirtualFormats,  0,                          0,                                           &BGM_Stream::GetAvailableFormatsDataSize },
+        { kAudioStreamPropertyAvailablePhysicalFormats, 0,                          0,                                           &BGM_Stream::GetAvailableFormatsDataSize }
+    };
 
-    bool theAnswer = false;
+    static_assert(BGM_PropertySelectorsAreUnique(kProperties), "BGM_Stream has duplicate properties");
 
-    switch(inAddress.mSelector)
-    {
-        case kAudioStreamPropertyIsActive:
-        case kAudioStreamPropertyDirection:
-        case kAudioStreamPropertyTerminalType:
-        case kAudioStreamPropertyStartingChannel:
-        case kAudioStreamPropertyLatency:
-        case kAudioStreamPropertyVirtualFormat:
-        case kAudioStreamPropertyPhysicalFormat:
-        case kAudioStreamPropertyAvailableVirtualFormats:
-        case kAudioStreamPropertyAvailablePhysicalFormats:
-            theAnswer = true;
-            break;
+    static constexpr auto kPropertySlots = BGM_MakePropertySlots<BGM_PropertyShift(kProperties)>(kProperties);
+    static constexpr BGM_PropertyTable<BGM_Stream> kPropertyTable(kPropertySlots);
+    return kPropertyTable;
+}
 
-        default:
-            theAnswer = BGM_Object::HasProperty(inObjectID, inClientPID, inAddress);
-            break;
-    };
+bool    BGM_Stream::HasProperty(AudioObjectID inObjectID,
+                                pid_t inClientPID,
+                                const AudioObjectPropertyAddress& inAddress) const
+{
+    auto theProperty = GetPropertyTable().Find(inAddress.mSelector);
 
-    return theAnswer;
+    return (theProperty != nullptr) ?
+            theProperty->HasProperty(inAddress) :
+            BGM_Object::HasProperty(inObjectID, inClientPID, inAddress);
 }
 
 bool    BGM_Stream::IsPropertySettable(AudioObjectID inObjectID,
                                        pid_t inClientPID,
                                        const AudioObjectPropertyAddress& inAddress) const
 {
-    // For each object, this driver implements all the required properties plus a few extras that
-    // are useful but not required. There is more detailed commentary about each property in the
-    // GetPropertyData() method.
-
-    bool theAnswer = false;
+    auto theProperty = GetPropertyTable().Find(inAddress.mSelector);
 
-    switch(inAddress.mSelector)
-    {
-        case kAudioStreamPropertyDirection:
-        case kAudioStreamPropertyTerminalType:
-        case kAudioStreamPropertyStartingChannel:
-        case kAudioStreamPropertyLatency:
-        case kAudioStreamPropertyAvailableVirtualFormats:
-        case kAudioStreamPropertyAvailablePhysicalFormats:
-            theAnswer = false;
-            break;
-
-        case kAudioStreamPropertyIsActive:
-        case kAudioStreamPropertyVirtualFormat:
-        case kAudioStreamPropertyPhysicalFormat:
-            theAnswer = true;
-            break;
-
-        default:
-            theAnswer = BGM_Object::IsPropertySettable(inObjectID, inClientPID, inAddress);
-            break;
-    };
-
-    return theAnswer;
+    return (theProperty != nullptr) ?
+            theProperty->IsSettable() :
+            BGM_Object::IsPropertySettable(inObjectID, inClientPID, inAddress);
 }
 
 UInt32    BGM_Stream::GetPropertyDataSize(AudioObjectID inObjectID,
@@ -130,54 +121,15 @@ UInt32    BGM_Stream::GetPropertyDataSize(AudioObjectID inObjectID,
                                           UInt32 inQualifierDataSize,
                                           const void* __nullable inQualifierData) const
 {
-    // For each object, this driver implements all the required properties plus a few extras that
-    // are useful but not required. There is more detailed commentary about each property in the
-    // GetPropertyData() method.
-
-    UInt32 theAnswer = 0;
-
-    switch(inAddress.mSelector)
-    {
-        case kAudioStreamPropertyIsActive:
-            theAnswer = sizeof(UInt32);
-            break;
-
-        case kAudioStreamPropertyDirection:
-            theAnswer = sizeof(UInt32);
-            break;
-
-        case kAudioStreamPropertyTerminalType:
-            theAnswer = sizeof(UInt32);
-            break;
-
-        case kAudioStreamPropertyStartingChannel:
-            theAnswer = sizeof(UInt32);
-            break;
-
-        case kAudioStreamPropertyLatency:
-            theAnswer = sizeof(UInt32);
-            break;
-
-        case kAudioStreamPropertyVirtualFormat:
-        case kAudioStreamPropertyPhysicalFormat:
-            theAnswer = sizeof(AudioStreamBasicDescription);
-            break;
-            
-        case kAudioStreamPropertyAvailableVirtualFormats:
-        case kAudioStreamPropertyAvailablePhysicalFormats:
-            theAnswer = 1 * sizeof(AudioStreamRangedDescription);
-            break;
-            
-        default:
-            theAnswer = BGM_Object::GetPropertyDataSize(inObjectID,
-                                                        inClientPID,
-                                                        inAddress,
-                                                        inQualifierDataSize,
-                                                        inQualifierData);
-            break;
-    };
-
-    return theAnswer;
+    auto theProperty = GetPropertyTable().Find(inAddress.mSelector);
+
+    return (theProperty != nullptr) ?
+            theProperty->GetDataSize(*this, inAddress) :
+            BGM_Object::GetPropertyDataSize(inObjectID,
+                                            inClientPID,
+                                            inAddress,
+                                            inQualifierDataSize,
+                                            inQualifierData);
 }
 
 void    BGM_Stream::GetPropertyData(AudioObjectID inObjectID,
@@ -307,20 +259,10 @@ void    BGM_Stream::GetPropertyData(AudioObjectID inObjectID,
                         "BGM_Stream::GetPropertyData: not enough space for the return "
                         "value of kAudioStreamPropertyVirtualFormat for the stream");
 
-                // This particular device always vends 32-bit native endian floats
-                AudioStreamBasicDescription* outASBD =
-                    reinterpret_cast<AudioStreamBasicDescription*>(outData);
-
-                // Our streams have the same sample rate as the device they belong to.
-                outASBD->mSampleRate = mSampleRate;
-                outASBD->mFormatID = kAudioFormatLinearPCM;
-                outASBD->mFormatFlags =
-                    kAudioFormatFlagIsFloat | kAudioFormatFlagsNativeEndian | kAudioFormatFlagIsPacked;
-                outASBD->mBytesPerPacket = 8;
-                outASBD->mFramesPerPacket = 1;
-                outASBD->mBytesPerFrame = 8;
-                outASBD->mChannelsPerFrame = 2;
-                outASBD->mBitsPerChannel = 32;
+                // This particular device always vends 32-bit native endian floats. Our streams have
+                // the same sample rate and number of channels as the device they belong to.
+                *reinterpret_cast<AudioStreamBasicDescription*>(outData) =
+                    MakeFormat(mSampleRate, mChannelCount);
 
                 outDataSize = sizeof(AudioStreamBasicDescription);
             }
@@ -329,31 +271,28 @@ void    BGM_Stream::GetPropertyData(AudioObjectID inObjectID,
         case kAudioStreamPropertyAvailableVirtualFormats:
         case kAudioStreamPropertyAvailablePhysicalFormats:
             // This returns an array of AudioStreamRangedDescriptions that describe what
-            // formats are supported.
-            if((inDataSize / sizeof(AudioStreamRangedDescription)) >= 1)
+            // formats are supported. There's one for each channel count.
             {
                 AudioStreamRangedDescription* outASRD =
                     reinterpret_cast<AudioStreamRangedDescription*>(outData);
+                UInt32 theNumberItemsToFetch = inDataSize / sizeof(AudioStreamRangedDescription);
+                UInt32 theNumberItems = 0;
 
-                outASRD[0].mFormat.mSampleRate = mSampleRate;
-                outASRD[0].mFormat.mFormatID = kAudioFormatLinearPCM;
-                outASRD[0].mFormat.mFormatFlags =
-                    kAudioFormatFlagIsFloat | kAudioFormatFlagsNativeEndian | kAudioFormatFlagIsPacked;
-                outASRD[0].mFormat.mBytesPerPacket = 8;
-                outASRD[0].mFormat.mFramesPerPacket = 1;
-                outASRD[0].mFormat.mBytesPerFrame = 8;
-                outASRD[0].mFormat.mChannelsPerFrame = 2;
-                outASRD[0].mFormat.mBitsPerChannel = 32;
-                // These match kAudioDevicePropertyAvailableNominalSampleRates.
-                outASRD[0].mSampleRateRange.mMinimum = 1.0;
-                outASRD[0].mSampleRateRange.mMaximum = 1000000000.0;
+                for(UInt32 theChannelCount : kChannelCounts)
+                {
+                    if(theNumberItems < theNumberItemsToFetch &&
+                       IsSupportedChannelCount(theChannelCount))
+                    {
+                        outASRD[theNumberItems].mFormat = MakeFormat(mSampleRate, theChannelCount);
+                        // These match kAudioDevicePropertyAvailableNominalSampleRates.
+                        outASRD[theNumberItems].mSampleRateRange.mMinimum = 1.0;
+                        outASRD[theNumberItems].mSampleRateRange.mMaximum = 1000000000.0;
+                        theNumberItems++;
+                    }
+                }
 
                 // Report how much we wrote.
-                outDataSize = sizeof(AudioStreamRangedDescription);
-            }
-            else
-            {
-                outDataSize = 0;
+                outDataSize = theNumberItems * sizeof(AudioStreamRangedDescription);
             }
             break;
 
@@ -416,8 +355,8 @@ void    BGM_Stream::SetPropertyData(AudioObjectID inObjectID,
                 // to be handled via the RequestConfigChange/PerformConfigChange machinery. The
                 // stream only needs to validate the format at this point.
                 //
-                // Note that because our devices only supports 2 channel 32 bit float data, the only
-                // thing that can change is the sample rate.
+                // Note that because our devices only support 32 bit float data, the only things
+                // that can change are the sample rate and the number of channels.
                 ThrowIf(inDataSize != sizeof(AudioStreamBasicDescription),
                         CAException(kAudioHardwareBadPropertySizeError),
                         "BGM_Stream::SetPropertyData: wrong size for the data for "
@@ -437,7 +376,11 @@ void    BGM_Stream::SetPropertyData(AudioObjectID inObjectID,
                         CAException(kAudioDeviceUnsupportedFormatError),
                         "BGM_Stream::SetPropertyData: unsupported format flags for "
                         "kAudioStreamPropertyPhysicalFormat");
-                ThrowIf(theNewFormat->mBytesPerPacket != 8,
+                ThrowIf(!IsSupportedChannelCount(theNewFormat->mChannelsPerFrame),
+                        CAException(kAudioDeviceUnsupportedFormatError),
+                        "BGM_Stream::SetPropertyData: unsupported channels per frame for "
+                        "kAudioStreamPropertyPhysicalFormat");
+                ThrowIf(theNewFormat->mBytesPerPacket != sizeof(Float32) * theNewFormat->mChannelsPerFrame,
                         CAException(kAudioDeviceUnsupportedFormatError),
                         "BGM_Stream::SetPropertyData: unsupported bytes per packet for "
                         "kAudioStreamPropertyPhysicalFormat");
@@ -445,14 +388,10 @@ void    BGM_Stream::SetPropertyData(AudioObjectID inObjectID,
                         CAException(kAudioDeviceUnsupportedFormatError),
                         "BGM_Stream::SetPropertyData: unsupported frames per packet for "
                         "kAudioStreamPropertyPhysicalFormat");
-                ThrowIf(theNewFormat->mBytesPerFrame != 8,
+                ThrowIf(theNewFormat->mBytesPerFrame != sizeof(Float32) * theNewFormat->mChannelsPerFrame,
                         CAException(kAudioDeviceUnsupportedFormatError),
                         "BGM_Stream::SetPropertyData: unsupported bytes per frame for "
                         "kAudioStreamPropertyPhysicalFormat");
-                ThrowIf(theNewFormat->mChannelsPerFrame != 2,
-                        CAException(kAudioDeviceUnsupportedFormatError),
-                        "BGM_Stream::SetPropertyData: unsupported channels per frame for "
-                        "kAudioStreamPropertyPhysicalFormat");
                 ThrowIf(theNewFormat->mBitsPerChannel != 32,
                         CAException(kAudioDeviceUnsupportedFormatError),
                         "BGM_Stream::SetPropertyData: unsupported bits per channel for "
@@ -484,5 +423,58 @@ void    BGM_Stream::SetSampleRate(Float64 inSampleRate)
     mSampleRate = inSampleRate;
 }
 
+UInt32    BGM_Stream::GetChannelCount() const
+{
+    return mChannelCount;
+}
+
+void    BGM_Stream::SetChannelCount(UInt32 inChannelCount)
+{
+    ThrowIf(!IsSupportedChannelCount(inChannelCount),
+            CAException(kAudioDeviceUnsupportedFormatError),
+            "BGM_Stream::SetChannelCount: unsupported channel count");
+
+    CAMutex::Locker theStateLocker(mStateMutex);
+    mChannelCount = inChannelCount;
+}
+
+bool    BGM_Stream::IsSupportedChannelCount(UInt32 inChannelCount) const
+{
+    return (inChannelCount <= mMaxChannelCount) &&
+            (std::find(std::begin(kChannelCounts), std::end(kChannelCounts), inChannelCount) !=
+                    std::end(kChannelCounts));
+}
+
+UInt32    BGM_Stream::GetAvailableFormatsDataSize(const AudioObjectPropertyAddress& inAddress) const
+{
+    #pragma unused(inAddress)
+
+    UInt32 theNumberItems = 0;
+
+    for(UInt32 theChannelCount : kChannelCounts)
+    {
+        theNumberItems += IsSupportedChannelCount(theChannelCount) ? 1 : 0;
+    }
+
+    return theNumberItems * sizeof(AudioStreamRangedDescription);
+}
+
+// static
+AudioStreamBasicDescription BGM_Stream::MakeFormat(Float64 inSampleRate, UInt32 inChannelCount)
+{
+    AudioStreamBasicDescription theFormat;
+    theFormat.mSampleRate = inSampleRate;
+    theFormat.mFormatID = kAudioFormatLinearPCM;
+    theFormat.mFormatFlags =
+        kAudioFormatFlagIsFloat | kAudioFormatFlagsNativeEndian | kAudioFormatFlagIsPacked;
+    theFormat.mBytesPerPacket = sizeof(Float32) * inChannelCount;
+    theFormat.mFramesPerPacket = 1;
+    theFormat.mBytesPerFrame = sizeof(Float32) * inChannelCount;
+    theFormat.mChannelsPerFrame = inChannelCount;
+    theFormat.mBitsPerChannel = 32;
+    theFormat.mReserved = 0;
+    return theFormat;
+}
+
 #pragma clang assume_nonnull end
 
@@ -31,6 +31,9 @@
 // SuperClass Includes
 #include "BGM_Object.h"
 
+// Local Includes
+#include "BGM_PropertyTable.h"
+
 // PublicUtility Includes
 #include "CAMutex.h"
 
@@ -52,7 +55,8 @@ public:
                                            AudioObjectID inOwnerDeviceID,
                                            bool inIsInput,
                                            Float64 inSampleRate,
-                                           UInt32 inStartingChannel = 1);
+                                           UInt32 inStartingChannel = 1,
+                                           UInt32 inMaxChannelCount = 2);
     virtual                     ~BGM_Stream();
 
 #pragma mark Property Operations
@@ -89,7 +93,19 @@ public:
 
     void                        SetSampleRate(Float64 inSampleRate);
 
+    /*! The number of channels in the stream's format. Starts at 2, i.e. stereo. */
+    UInt32                      GetChannelCount() const;
+    void                        SetChannelCount(UInt32 inChannelCount);
+    /*! @return True if the stream's format can have inChannelCount channels. */
+    bool                        IsSupportedChannelCount(UInt32 inChannelCount) const;
+
 private:
+    static const BGM_PropertyTable<BGM_Stream>& GetPropertyTable();
+    UInt32                      GetAvailableFormatsDataSize(const AudioObjectPropertyAddress& inAddress) const;
+
+    /*! @return The 32-bit float interleaved format with the given sample rate and channels. */
+    static AudioStreamBasicDescription MakeFormat(Float64 inSampleRate, UInt32 inChannelCount);
+
     CAMutex                     mStateMutex;
 
     bool                        mIsInput;
@@ -103,6 +119,9 @@ private:
      kAudioStreamPropertyStartingChannel.
      */
     UInt32                      mStartingChannel;
+    /*! One of the supported channel counts that aren't greater than mMaxChannelCount. */
+    UInt32                      mChannelCount;
+    UInt32                      mMaxChannelCount;
 
 };
 
@@ -26,10 +26,12 @@
 // Local Includes
 #include "BGM_Types.h"
 #include "BGM_Utils.h"
-#include "BGM_PlugIn.h"
-#include "BGM_Clients.h"
 #include "BGM_ClientMap.h"
 #include "BGM_ClientTasks.h"
+#if !BGM_CORE_STANDALONE
+#include "BGM_PlugIn.h"
+#include "BGM_Clients.h"
+#endif
 
 // PublicUtility Includes
 #include "CAException.h"
@@ -39,11 +41,6 @@
 #include "CAAtomic.h"
 #pragma clang diagnostic pop
 
-// System Includes
-#include <mach/mach_init.h>
-#include <mach/mach_time.h>
-#include <mach/task.h>
-
 
 #pragma clang assume_nonnull begin
 
@@ -57,31 +54,12 @@ BGM_TaskQueue::BGM_TaskQueue()
     // preempt us. (And that's only if they won't make our computation take longer than kRealTimeThreadMaximumComputationNs).
     mRealTimeThread(&BGM_TaskQueue::RealTimeThreadProc,
                     this,
-                    /* inPeriod = */ 0,
-                    NanosToAbsoluteTime(kRealTimeThreadNominalComputationNs),
-                    NanosToAbsoluteTime(kRealTimeThreadMaximumComputationNs),
+                    /* inPeriodNs = */ 0,
+                    kRealTimeThreadNominalComputationNs,
+                    kRealTimeThreadMaximumComputationNs,
                     /* inIsPreemptible = */ true),
     mNonRealTimeThread(&BGM_TaskQueue::NonRealTimeThreadProc, this)
 {
-    // Init the semaphores
-    auto createSemaphore = [] () {
-        semaphore_t theSemaphore;
-        kern_return_t theError = semaphore_create(mach_task_self(), &theSemaphore, SYNC_POLICY_FIFO, 0);
-        
-        BGM_Utils::ThrowIfMachError("BGM_TaskQueue::BGM_TaskQueue", "semaphore_create", theError);
-        
-        ThrowIf(theSemaphore == SEMAPHORE_NULL,
-                CAException(kAudioHardwareUnspecifiedError),
-                "BGM_TaskQueue::BGM_TaskQueue: Could not create semaphore");
-        
-        return theSemaphore;
-    };
-    
-    mRealTimeThreadWorkQueuedSemaphore = createSemaphore();
-    mNonRealTimeThreadWorkQueuedSemaphore = createSemaphore();
-    mRealTimeThreadSyncTaskCompletedSemaphore = createSemaphore();
-    mNonRealTimeThreadSyncTaskCompletedSemaphore = createSemaphore();
-    
     // Pre-allocate enough tasks in mNonRealTimeThreadTasksFreeList that the real-time threads should never have to
     // allocate memory when adding a task to the non-realtime queue.
     for(UInt32 i = 0; i < kNonRealTimeThreadTaskBufferSize; i++)
@@ -103,17 +81,7 @@ BGM_TaskQueue::~BGM_TaskQueue()
         QueueSync(kBGMTaskStopWorkerThread, /* inRunOnRealtimeThread = */ false);
     }));
 
-    // Destroy the semaphores
-    auto destroySemaphore = [] (semaphore_t inSemaphore) {
-        kern_return_t theError = semaphore_destroy(mach_task_self(), inSemaphore);
-        
-        BGM_Utils::LogIfMachError("BGM_TaskQueue::~BGM_TaskQueue", "semaphore_destroy", theError);
-    };
-    
-    destroySemaphore(mRealTimeThreadWorkQueuedSemaphore);
-    destroySemaphore(mNonRealTimeThreadWorkQueuedSemaphore);
-    destroySemaphore(mRealTimeThreadSyncTaskCompletedSemaphore);
-    destroySemaphore(mNonRealTimeThreadSyncTaskCompletedSemaphore);
+    // (The semaphores are destroyed after the threads, by their own destructors.)
     
     BGM_Task* theTask;
     
@@ -133,19 +101,6 @@ BGM_TaskQueue::~BGM_TaskQueue()
     }
 }
 
-//static
-UInt32  BGM_TaskQueue::NanosToAbsoluteTime(UInt32 inNanos)
-{
-    // Converts a duration from nanoseconds to absolute time (i.e. number of bus cycles). Used for calculating
-    // the real-time thread's time constraint policy.
-    
-    mach_timebase_info_data_t theTimebaseInfo;
-    mach_timebase_info(&theTimebaseInfo);
-    
-    Float64 theTicksPerNs = static_cast<Float64>(theTimebaseInfo.denom) / theTimebaseInfo.numer;
-    return static_cast<UInt32>(inNanos * theTicksPerNs);
-}
-
 #pragma mark Task queueing
 
 void    BGM_TaskQueue::QueueSync_SwapClientShadowMaps(BGM_ClientMap* inClientMap)
@@ -207,9 +162,8 @@ UInt64    BGM_TaskQueue::QueueSync(BGM_TaskID inTaskID, bool inRunOnRealtimeThre
     TAtomicStack<BGM_Task>& theTasks = (inRunOnRealtimeThread ? mRealTimeThreadTasks : mNonRealTimeThreadTasks);
     theTasks.push_atomic(&theTask);
     
-    // Wake the worker thread so it'll process the task. (Note that semaphore_signal has an implicit barrier.)
-    kern_return_t theError = semaphore_signal(inRunOnRealtimeThread ? mRealTimeThreadWorkQueuedSemaphore : mNonRealTimeThreadWorkQueuedSemaphore);
-    BGM_Utils::ThrowIfMachError("BGM_TaskQueue::QueueSync", "semaphore_signal", theError);
+    // Wake the worker thread so it'll process the task. (Note that signalling the semaphore has an implicit barrier.)
+    (inRunOnRealtimeThread ? mRealTimeThreadWorkQueuedSemaphore : mNonRealTimeThreadWorkQueuedSemaphore).Signal();
     
     // Wait until the task has been processed.
     //
@@ -218,24 +172,16 @@ UInt64    BGM_TaskQueue::QueueSync(BGM_TaskID inTaskID, bool inRunOnRealtimeThre
     bool didLogTimeoutMessage = false;
     while(!theTask.IsComplete())
     {
-        semaphore_t theTaskCompletedSemaphore =
+        BGM_Semaphore& theTaskCompletedSemaphore =
             inRunOnRealtimeThread ? mRealTimeThreadSyncTaskCompletedSemaphore : mNonRealTimeThreadSyncTaskCompletedSemaphore;
-        // TODO: Because the worker threads use semaphore_signal_all instead of semaphore_signal, a thread can miss the signal if
-        //       it isn't waiting at the right time. Using a timeout for now as a temporary fix so threads don't get stuck here.
-        theError = semaphore_timedwait(theTaskCompletedSemaphore,
-                                       (mach_timespec_t){ 0, kRealTimeThreadMaximumComputationNs * 4 });
+        // TODO: Because the worker threads use SignalAll instead of Signal, a thread can miss the signal if it isn't
+        //       waiting at the right time. Using a timeout for now as a temporary fix so threads don't get stuck here.
+        bool didGetSignal = theTaskCompletedSemaphore.TimedWait(kRealTimeThreadMaximumComputationNs * 4);
         
-        if(theError == KERN_OPERATION_TIMED_OUT)
-        {
-            if(!didLogTimeoutMessage && inRunOnRealtimeThread)
-            {
-                DebugMsg("BGM_TaskQueue::QueueSync: Task %d taking longer than expected.", theTask.GetTaskID());
-                didLogTimeoutMessage = true;
-            }
-        }
-        else
+        if(!didGetSignal && !didLogTimeoutMessage && inRunOnRealtimeThread)
         {
-            BGM_Utils::ThrowIfMachError("BGM_TaskQueue::QueueSync", "semaphore_timedwait", theError);
+            DebugMsg("BGM_TaskQueue::QueueSync: Task %d taking longer than expected.", theTask.GetTaskID());
+            didLogTimeoutMessage = true;
         }
         
         CAMemoryBarrier();
@@ -269,9 +215,8 @@ void   BGM_TaskQueue::QueueOnNonRealtimeThread(BGM_Task inTask)
     
     mNonRealTimeThreadTasks.push_atomic(freeTask);
     
-    // Signal the worker thread to process the task. (Note that semaphore_signal has an implicit barrier.)
-    kern_return_t theError = semaphore_signal(mNonRealTimeThreadWorkQueuedSemaphore);
-    BGM_Utils::ThrowIfMachError("BGM_TaskQueue::QueueOnNonRealtimeThread", "semaphore_signal", theError);
+    // Signal the worker thread to process the task. (Note that signalling the semaphore has an implicit barrier.)
+    mNonRealTimeThreadWorkQueuedSemaphore.Signal();
 }
 
 #pragma mark Worker threads
@@ -285,9 +230,9 @@ void    BGM_TaskQueue::AssertCurrentThreadIsRTWorkerThread(const char* inCallerM
         __ASSERT_STOP;  // TODO: Figure out a better way to assert with a formatted message
     }
     
-    Assert(mRealTimeThread.IsTimeConstraintThread(), "mRealTimeThread should be in a time-constraint priority band.");
+    Assert(mRealTimeThread.IsRealTime(), "mRealTimeThread should be in a time-constraint priority band.");
 #else
-    #pragma unused (inCallerMethodName)
+    (void)inCallerMethodName;
 #endif
 }
 
@@ -321,7 +266,7 @@ void* __nullable    BGM_TaskQueue::NonRealTimeThreadProc(void* inRefCon)
     return NULL;
 }
 
-void    BGM_TaskQueue::WorkerThreadProc(semaphore_t inWorkQueuedSemaphore, semaphore_t inSyncTaskCompletedSemaphore, TAtomicStack<BGM_Task>* inTasks, TAtomicStack2<BGM_Task>* __nullable inFreeList, std::function<bool(BGM_Task*)> inProcessTask)
+void    BGM_TaskQueue::WorkerThreadProc(BGM_Semaphore& inWorkQueuedSemaphore, BGM_Semaphore& inSyncTaskCompletedSemaphore, TAtomicStack<BGM_Task>* inTasks, TAtomicStack2<BGM_Task>* __nullable inFreeList, std::function<bool(BGM_Task*)> inProcessTask)
 {
     bool theThreadShouldStop = false;
     
@@ -331,8 +276,7 @@ void    BGM_TaskQueue::WorkerThreadProc(semaphore_t inWorkQueuedSemaphore, semap
         //
         // Note that we don't have to hold any lock before waiting. If the semaphore is signalled before we begin waiting we'll
         // still get the signal after we do.
-        kern_return_t theError = semaphore_wait(inWorkQueuedSemaphore);
-        BGM_Utils::ThrowIfMachError("BGM_TaskQueue::WorkerThreadProc", "semaphore_wait", theError);
+        inWorkQueuedSemaphore.Wait();
         
         // Fetch the tasks from the queue.
         //
@@ -370,13 +314,12 @@ void    BGM_TaskQueue::WorkerThreadProc(semaphore_t inWorkQueuedSemaphore, semap
                 
                 // Signal any threads waiting for their task to be processed.
                 //
-                // We use semaphore_signal_all instead of semaphore_signal to avoid a race condition in QueueSync. It's possible
-                // for threads calling QueueSync to wait on the semaphore in an order different to the order of the tasks they just
-                // added to the queue. So after each task is completed we have every waiting thread check if it was theirs.
+                // We use SignalAll instead of Signal to avoid a race condition in QueueSync. It's possible for threads calling
+                // QueueSync to wait on the semaphore in an order different to the order of the tasks they just added to the
+                // queue. So after each task is completed we have every waiting thread check if it was theirs.
                 //
-                // Note that semaphore_signal_all has an implicit barrier.
-                theError = semaphore_signal_all(inSyncTaskCompletedSemaphore);
-                BGM_Utils::ThrowIfMachError("BGM_TaskQueue::WorkerThreadProc", "semaphore_signal_all", theError);
+                // Note that SignalAll has an implicit barrier.
+                inSyncTaskCompletedSemaphore.SignalAll();
             }
             else if(inFreeList != NULL)
             {
@@ -420,7 +363,7 @@ bool    BGM_TaskQueue::ProcessNonRealTimeThreadTask(BGM_Task* inTask)
 {
 #if DEBUG  // This Assert macro always checks the condition, if for some reason the compiler doesn't optimise it away, even in release builds
     Assert(mNonRealTimeThread.IsCurrentThread(), "ProcessNonRealTimeThreadTask should only be called on the non-realtime worker thread.");
-    Assert(mNonRealTimeThread.IsTimeShareThread(), "mNonRealTimeThread should not be in a time-constraint priority band.");
+    Assert(!mNonRealTimeThread.IsRealTime(), "mNonRealTimeThread should not be in a time-constraint priority band.");
 #endif
     
     switch(inTask->GetTaskID())
@@ -430,6 +373,8 @@ bool    BGM_TaskQueue::ProcessNonRealTimeThreadTask(BGM_Task* inTask)
             // Return that the thread should stop itself
             return true;
             
+#if !BGM_CORE_STANDALONE
+        // bgm_core doesn't include BGM_Clients or BGM_PlugIn (see CMakeLists.txt), so these tasks can't be queued there.
         case kBGMTaskStartClientIO:
             DebugMsg("BGM_TaskQueue::ProcessNonRealTimeThreadTask: Processing kBGMTaskStartClientIO");
             try
@@ -475,6 +420,7 @@ bool    BGM_TaskQueue::ProcessNonRealTimeThreadTask(BGM_Task* inTask)
                 BGM_PlugIn::Host_PropertiesChanged(static_cast<AudioObjectID>(inTask->GetArg2()), 1, thePropertyAddress);
             }
             break;
+#endif
             
         default:
             Assert(false, "BGM_TaskQueue::ProcessNonRealTimeThreadTask: Unexpected task ID");
@@ -23,8 +23,10 @@
 #ifndef __BGMDriver__BGM_TaskQueue__
 #define __BGMDriver__BGM_TaskQueue__
 
+// Local Includes
+#include "BGM_Platform.h"
+
 // PublicUtility Includes
-#include "CAPThread.h"
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wsign-conversion"
 #include "CAAtomicStack.h"
@@ -34,7 +36,6 @@
 #include <functional>
 
 // System Includes
-#include <mach/semaphore.h>
 #include <CoreAudio/AudioHardware.h>
 
 
@@ -110,9 +111,6 @@ public:
                                         BGM_TaskQueue(const BGM_TaskQueue&) = delete;
                                         BGM_TaskQueue& operator=(const BGM_TaskQueue&) = delete;
     
-private:
-    static UInt32                       NanosToAbsoluteTime(UInt32 inNanos);
-    
 public:
     void                                QueueSync_SwapClientShadowMaps(BGM_ClientMap* inClientMap);
     
@@ -142,17 +140,13 @@ private:
     static void* __nullable             RealTimeThreadProc(void* inRefCon);
     static void* __nullable             NonRealTimeThreadProc(void* inRefCon);
     
-    void                                WorkerThreadProc(semaphore_t inWorkQueuedSemaphore, semaphore_t inSyncTaskCompletedSemaphore, TAtomicStack<BGM_Task>* inTasks, TAtomicStack2<BGM_Task>* __nullable inFreeList, std::function<bool(BGM_Task*)> inProcessTask);
+    void                                WorkerThreadProc(BGM_Semaphore& inWorkQueuedSemaphore, BGM_Semaphore& inSyncTaskCompletedSemaphore, TAtomicStack<BGM_Task>* inTasks, TAtomicStack2<BGM_Task>* __nullable inFreeList, std::function<bool(BGM_Task*)> inProcessTask);
     
     // These return true when the thread should be stopped
     bool                                ProcessRealTimeThreadTask(BGM_Task* inTask);
     bool                                ProcessNonRealTimeThreadTask(BGM_Task* inTask);
     
 private:
-    // The worker threads that perform the queued tasks
-    CAPThread                           mRealTimeThread;
-    CAPThread                           mNonRealTimeThread;
-    
     // The approximate amount of time we'll need whenever our real-time thread is scheduled. This is currently just
     // set to the minimum (see sched_prim.c) because our real-time tasks do very little work.
     //
@@ -164,14 +158,15 @@ private:
     // The maximum amount of time the real-time thread can take to finish its computation after being scheduled.
     static const UInt32                 kRealTimeThreadMaximumComputationNs = 60 * NSEC_PER_USEC;
     
-    // We use Mach semaphores for communication with the worker threads because signalling them is real-time safe.
+    // We use Mach semaphores (through BGM_Semaphore) for communication with the worker threads because signalling
+    // them is real-time safe.
     
     // Signalled to tell the worker threads when there are tasks for them process.
-    semaphore_t                         mRealTimeThreadWorkQueuedSemaphore;
-    semaphore_t                         mNonRealTimeThreadWorkQueuedSemaphore;
+    BGM_Semaphore                       mRealTimeThreadWorkQueuedSemaphore;
+    BGM_Semaphore                       mNonRealTimeThreadWorkQueuedSemaphore;
     // Signalled when a worker thread completes a task, if the thread that queued that task is blocking on it.
-    semaphore_t                         mRealTimeThreadSyncTaskCompletedSemaphore;
-    semaphore_t                         mNonRealTimeThreadSyncTaskCompletedSemaphore;
+    BGM_Semaphore                       mRealTimeThreadSyncTaskCompletedSemaphore;
+    BGM_Semaphore                       mNonRealTimeThreadSyncTaskCompletedSemaphore;
     
     // When a task is queued we add it to one of these, depending on which worker thread it will run on. Using
     // TAtomicStack lets us safely add and remove tasks on real-time threads.
@@ -194,6 +189,11 @@ private:
     // We can use TAtomicStack2 instead of TAtomicStack because we never call pop_all on the free list.
     TAtomicStack2<BGM_Task>             mNonRealTimeThreadTasksFreeList;
     
+    // The worker threads that perform the queued tasks. These are declared last so they're destroyed (and, on
+    // POSIX systems, joined) before anything they use.
+    BGM_Thread                          mRealTimeThread;
+    BGM_Thread                          mNonRealTimeThread;
+    
 };
 
 #pragma clang assume_nonnull end
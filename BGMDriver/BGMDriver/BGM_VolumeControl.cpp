@@ -26,6 +26,7 @@
 
 // Local Includes
 #include "BGM_PlugIn.h"
+#include "BGM_IOKernels.h"
 
 // PublicUtility Includes
 #include "CAException.h"
@@ -35,10 +36,10 @@
 
 // STL Includes
 #include <algorithm>
+#include <cmath>
 
 // System Includes
 #include <CoreAudio/AudioHardwareBase.h>
-#include <Accelerate/Accelerate.h>
 
 
 #pragma clang assume_nonnull begin
@@ -63,6 +64,8 @@ BGM_VolumeControl::BGM_VolumeControl(AudioObjectID inObjectID,
     mMaxVolumeRaw(kDefaultMaxRawVolume),
     mMinVolumeDb(kDefaultMinDbVolume),
     mMaxVolumeDb(kDefaultMaxDbVolume),
+    mGainRamp(mAmplitudeGain),
+    mGainRampLengthFrames(BGM_GainRamp::kDefaultLengthFrames),
     mWillApplyVolumeToAudio(false)
 {
     // Setup the volume curve with the one range
@@ -71,30 +74,36 @@ BGM_VolumeControl::BGM_VolumeControl(AudioObjectID inObjectID,
 
 #pragma mark Property Operations
 
+//static
+const BGM_PropertyTable<BGM_VolumeControl>& BGM_VolumeControl::GetPropertyTable()
+{
+    static constexpr BGM_PropertyDescriptor<BGM_VolumeControl> kProperties[] = {
+        { kAudioLevelControlPropertyScalarValue,             kBGMPropertyFlag_Settable,  sizeof(Float32),          nullptr },
+        { kAudioLevelControlPropertyDecibelValue,            kBGMPropertyFlag_Settable,  sizeof(Float32),          nullptr },
+        { kAudioLevelControlPropertyDecibelRange,            0,                          sizeof(AudioValueRange),  nullptr },
+        { kAudioLevelControlPropertyConvertScalarToDecibels, 0,                          sizeof(Float32),          nullptr },
+        { kAudioLevelControlPropertyConvertDecibelsToScalar, 0,                          sizeof(Float32),          nullptr }
+    };
+
+    static_assert(BGM_PropertySelectorsAreUnique(kProperties),
+                  "BGM_VolumeControl has duplicate properties");
+
+    static constexpr auto kPropertySlots = BGM_MakePropertySlots<BGM_PropertyShift(kProperties)>(kProperties);
+    static constexpr BGM_PropertyTable<BGM_VolumeControl> kPropertyTable(kPropertySlots);
+    return kPropertyTable;
+}
+
 bool    BGM_VolumeControl::HasProperty(AudioObjectID inObjectID,
                                        pid_t inClientPID,
                                        const AudioObjectPropertyAddress& inAddress) const
 {
     CheckObjectID(inObjectID);
 
-    bool theAnswer = false;
-
-    switch(inAddress.mSelector)
-    {
-        case kAudioLevelControlPropertyScalarValue:
-        case kAudioLevelControlPropertyDecibelValue:
-        case kAudioLevelControlPropertyDecibelRange:
-        case kAudioLevelControlPropertyConvertScalarToDecibels:
-        case kAudioLevelControlPropertyConvertDecibelsToScalar:
-            theAnswer = true;
-            break;
-
-        default:
-            theAnswer = BGM_Control::HasProperty(inObjectID, inClientPID, inAddress);
-            break;
-    };
+    auto theProperty = GetPropertyTable().Find(inAddress.mSelector);
 
-    return theAnswer;
+    return (theProperty != nullptr) ?
+            theProperty->HasProperty(inAddress) :
+            BGM_Control::HasProperty(inObjectID, inClientPID, inAddress);
 }
 
 bool    BGM_VolumeControl::IsPropertySettable(AudioObjectID inObjectID,
@@ -103,27 +112,11 @@ bool    BGM_VolumeControl::IsPropertySettable(AudioObjectID inObjectID,
 {
     CheckObjectID(inObjectID);
 
-    bool theAnswer = false;
-
-    switch(inAddress.mSelector)
-    {
-        case kAudioLevelControlPropertyDecibelRange:
-        case kAudioLevelControlPropertyConvertScalarToDecibels:
-        case kAudioLevelControlPropertyConvertDecibelsToScalar:
-            theAnswer = false;
-            break;
-
-        case kAudioLevelControlPropertyScalarValue:
-        case kAudioLevelControlPropertyDecibelValue:
-            theAnswer = true;
-            break;
-
-        default:
-            theAnswer = BGM_Control::IsPropertySettable(inObjectID, inClientPID, inAddress);
-            break;
-    };
+    auto theProperty = GetPropertyTable().Find(inAddress.mSelector);
 
-    return theAnswer;
+    return (theProperty != nullptr) ?
+            theProperty->IsSettable() :
+            BGM_Control::IsPropertySettable(inObjectID, inClientPID, inAddress);
 }
 
 UInt32  BGM_VolumeControl::GetPropertyDataSize(AudioObjectID inObjectID,
@@ -134,40 +127,15 @@ UInt32  BGM_VolumeControl::GetPropertyDataSize(AudioObjectID inObjectID,
 {
     CheckObjectID(inObjectID);
 
-    UInt32 theAnswer = 0;
-
-    switch(inAddress.mSelector)
-    {
-        case kAudioLevelControlPropertyScalarValue:
-            theAnswer = sizeof(Float32);
-            break;
-
-        case kAudioLevelControlPropertyDecibelValue:
-            theAnswer = sizeof(Float32);
-            break;
-
-        case kAudioLevelControlPropertyDecibelRange:
-            theAnswer = sizeof(AudioValueRange);
-            break;
-
-        case kAudioLevelControlPropertyConvertScalarToDecibels:
-            theAnswer = sizeof(Float32);
-            break;
+    auto theProperty = GetPropertyTable().Find(inAddress.mSelector);
 
-        case kAudioLevelControlPropertyConvertDecibelsToScalar:
-            theAnswer = sizeof(Float32);
-            break;
-
-        default:
-            theAnswer = BGM_Control::GetPropertyDataSize(inObjectID,
-                                                         inClientPID,
-                                                         inAddress,
-                                                         inQualifierDataSize,
-                                                         inQualifierData);
-            break;
-    };
-
-    return theAnswer;
+    return (theProperty != nullptr) ?
+            theProperty->GetDataSize(*this, inAddress) :
+            BGM_Control::GetPropertyDataSize(inObjectID,
+                                             inClientPID,
+                                             inAddress,
+                                             inQualifierDataSize,
+                                             inQualifierData);
 }
 
 void    BGM_VolumeControl::GetPropertyData(AudioObjectID inObjectID,
@@ -333,6 +301,35 @@ void    BGM_VolumeControl::SetPropertyData(AudioObjectID inObjectID,
 
 #pragma mark Accessors
 
+void    BGM_VolumeControl::SetVolumeRange(SInt32 inMinRaw,
+                                          SInt32 inMaxRaw,
+                                          Float32 inMinDb,
+                                          Float32 inMaxDb)
+{
+    ThrowIf((inMinRaw >= inMaxRaw) || !(inMinDb < inMaxDb),
+            CAException(kAudioHardwareIllegalOperationError),
+            "BGM_VolumeControl::SetVolumeRange: Empty range");
+
+    CAMutex::Locker theLocker(mMutex);
+
+    mMinVolumeRaw = inMinRaw;
+    mMaxVolumeRaw = inMaxRaw;
+    mMinVolumeDb = inMinDb;
+    mMaxVolumeDb = inMaxDb;
+
+    mVolumeCurve.ResetRange();
+    mVolumeCurve.AddRange(mMinVolumeRaw, mMaxVolumeRaw, mMinVolumeDb, mMaxVolumeDb);
+
+    mVolumeRaw = std::min(std::max(mMinVolumeRaw, mVolumeRaw), mMaxVolumeRaw);
+    UpdateAmplitudeGain();
+}
+
+Float32 BGM_VolumeControl::GetVolumeDb() const
+{
+    CAMutex::Locker theLocker(mMutex);
+    return mVolumeCurve.ConvertRawToDB(mVolumeRaw);
+}
+
 void    BGM_VolumeControl::SetVolumeScalar(Float32 inNewVolumeScalar)
 {
     // For the scalar volume, we clamp the new value to [0, 1]. Note that if this value changes, it
@@ -362,6 +359,22 @@ void    BGM_VolumeControl::SetWillApplyVolumeToAudio(bool inWillApplyVolumeToAud
     mWillApplyVolumeToAudio = inWillApplyVolumeToAudio;
 }
 
+void    BGM_VolumeControl::SetGainRampLengthFrames(UInt32 inLengthFrames)
+{
+    mGainRampLengthFrames.store(BGM_GainRamp::ClampLengthFrames(inLengthFrames),
+                                std::memory_order_relaxed);
+}
+
+UInt32  BGM_VolumeControl::GetGainRampLengthFrames() const
+{
+    return mGainRampLengthFrames.load(std::memory_order_relaxed);
+}
+
+void    BGM_VolumeControl::ResetGainRamp(Float32 inGain)
+{
+    mGainRamp.Reset(inGain);
+}
+
 #pragma mark IO Operations
 
 bool    BGM_VolumeControl::WillApplyVolumeToAudioRT() const
@@ -369,32 +382,31 @@ bool    BGM_VolumeControl::WillApplyVolumeToAudioRT() const
     return mWillApplyVolumeToAudio;
 }
 
-void    BGM_VolumeControl::ApplyVolumeToAudioRT(Float32* ioBuffer, UInt32 inBufferFrameSize) const
+void    BGM_VolumeControl::ApplyVolumeToAudioRT(Float32* ioBuffer,
+                                            UInt32 inBufferFrameSize,
+                                            UInt32 inChannelCount)
 {
     ThrowIf(!mWillApplyVolumeToAudio,
             CAException(kAudioHardwareIllegalOperationError),
             "BGM_VolumeControl::ApplyVolumeToAudioRT: This control doesn't process audio data");
 
+    BGM_IOKernels::GainRamp theGain =
+            mGainRamp.NextBuffer(mAmplitudeGain,
+                                 inBufferFrameSize,
+                                 mGainRampLengthFrames.load(std::memory_order_relaxed));
+
     // Don't bother if the change is very unlikely to be perceptible.
-    if((mAmplitudeGain < 0.99f) || (mAmplitudeGain > 1.01f))
+    if((theGain.mRampFrameCount > 0) || (theGain.mEndGain < 0.99f) || (theGain.mEndGain > 1.01f))
     {
         // Apply the amount of gain/loss for the current volume to the audio signal by multiplying
-        // each sample. This call to vDSP_vsmul is equivalent to
-        //
-        // for(UInt32 i = 0; i < inBufferFrameSize * 2; i++)
-        // {
-        //     ioBuffer[i] *= mAmplitudeGain;
-        // }
-        //
-        // but a bit faster on processors with newer SIMD instructions. However, it shouldn't take
-        // more than a few microseconds either way. (Unless some of the samples were subnormal
-        // numbers for some reason.)
+        // each sample. It shouldn't take more than a few microseconds. (Unless some of the samples
+        // were subnormal numbers for some reason.)
         //
         // It would be a tiny bit faster still to not do this in-place, i.e. use separate input and
         // output buffers, but then we'd have to copy the data into the output buffer when the
         // volume is at 1.0. With our current use of this class, most people will leave the volume
         // at 1.0, so it wouldn't be worth it.
-        vDSP_vsmul(ioBuffer, 1, &mAmplitudeGain, ioBuffer, 1, inBufferFrameSize * 2);
+        BGM_IOKernels::ApplyGain(ioBuffer, inBufferFrameSize, inChannelCount, theGain);
     }
 }
 
@@ -412,40 +424,7 @@ void    BGM_VolumeControl::SetVolumeRaw(SInt32 inNewVolumeRaw)
     {
         mVolumeRaw = inNewVolumeRaw;
 
-        // CAVolumeCurve deals with volumes in three different scales: scalar, dB and raw. Raw
-        // volumes are the number of steps along the dB curve, so dB and raw volumes are linearly
-        // related.
-        //
-        // macOS uses the scalar volume to set the position of its volume sliders for the
-        // device. We have to set the scalar volume to the position of our volume slider for a
-        // device (more specifically, a linear mapping of it onto [0,1]) or macOS's volume sliders
-        // or it will work differently to our own.
-        //
-        // When we set a new slider position as the device's scalar volume, we convert it to raw
-        // with CAVolumeCurve::ConvertScalarToRaw, which will "undo the curve". However, we haven't
-        // applied the curve at that point.
-        //
-        // So, to actually apply the curve, we use CAVolumeCurve::ConvertRawToScalar to get the
-        // linear slider position back, map it onto the range of raw volumes and use
-        // CAVolumeCurve::ConvertRawToScalar again to apply the curve.
-        //
-        // It might be that we should be using CAVolumeCurve with transfer functions x^n where
-        // 0 < n < 1, but a lot more of the transfer functions it supports have n >= 1, including
-        // the default one. So I'm a bit confused.
-        //
-        // TODO: I think this means the dB volume we report will be wrong. It also makes the code
-        //       pretty confusing.
-        Float32 theSliderPosition = mVolumeCurve.ConvertRawToScalar(mVolumeRaw);
-
-        // TODO: This assumes the control should never boost the signal. (So, technically, it never
-        //       actually applies gain, only loss.)
-        SInt32 theRawRange = mMaxVolumeRaw - mMinVolumeRaw;
-        SInt32 theSliderPositionInRawSteps = static_cast<SInt32>(theSliderPosition * theRawRange);
-        theSliderPositionInRawSteps += mMinVolumeRaw;
-
-        mAmplitudeGain = mVolumeCurve.ConvertRawToScalar(theSliderPositionInRawSteps);
-
-        BGMAssert((mAmplitudeGain >= 0.0f) && (mAmplitudeGain <= 1.0f), "Gain not in [0,1]");
+        UpdateAmplitudeGain();
 
         // Send notifications.
         CADispatchQueue::GetGlobalSerialQueue().Dispatch(false, ^{
@@ -458,5 +437,50 @@ void    BGM_VolumeControl::SetVolumeRaw(SInt32 inNewVolumeRaw)
     }
 }
 
+void    BGM_VolumeControl::UpdateAmplitudeGain()
+{
+    if(mMaxVolumeDb > 0.0f)
+    {
+        // This control can boost the signal, so use its dB volume directly. The scalar volume
+        // can't be mapped to a gain above 1.0 the way it is below.
+        mAmplitudeGain = powf(10.0f, mVolumeCurve.ConvertRawToDB(mVolumeRaw) / 20.0f);
+        return;
+    }
+
+    // CAVolumeCurve deals with volumes in three different scales: scalar, dB and raw. Raw
+    // volumes are the number of steps along the dB curve, so dB and raw volumes are linearly
+    // related.
+    //
+    // macOS uses the scalar volume to set the position of its volume sliders for the
+    // device. We have to set the scalar volume to the position of our volume slider for a
+    // device (more specifically, a linear mapping of it onto [0,1]) or macOS's volume sliders
+    // or it will work differently to our own.
+    //
+    // When we set a new slider position as the device's scalar volume, we convert it to raw
+    // with CAVolumeCurve::ConvertScalarToRaw, which will "undo the curve". However, we haven't
+    // applied the curve at that point.
+    //
+    // So, to actually apply the curve, we use CAVolumeCurve::ConvertRawToScalar to get the
+    // linear slider position back, map it onto the range of raw volumes and use
+    // CAVolumeCurve::ConvertRawToScalar again to apply the curve.
+    //
+    // It might be that we should be using CAVolumeCurve with transfer functions x^n where
+    // 0 < n < 1, but a lot more of the transfer functions it supports have n >= 1, including
+    // the default one. So I'm a bit confused.
+    //
+    // TODO: I think this means the dB volume we report will be wrong. It also makes the code
+    //       pretty confusing.
+    Float32 theSliderPosition = mVolumeCurve.ConvertRawToScalar(mVolumeRaw);
+
+    // This only gives gains in [0, 1]. Controls that boost the signal are handled above.
+    SInt32 theRawRange = mMaxVolumeRaw - mMinVolumeRaw;
+    SInt32 theSliderPositionInRawSteps = static_cast<SInt32>(theSliderPosition * theRawRange);
+    theSliderPositionInRawSteps += mMinVolumeRaw;
+
+    mAmplitudeGain = mVolumeCurve.ConvertRawToScalar(theSliderPositionInRawSteps);
+
+    BGMAssert((mAmplitudeGain >= 0.0f) && (mAmplitudeGain <= 1.0f), "Gain not in [0,1]");
+}
+
 #pragma clang assume_nonnull end
 
@@ -26,6 +26,10 @@
 // Superclass Includes
 #include "BGM_Control.h"
 
+// Local Includes
+#include "BGM_GainRamp.h"
+#include "BGM_PropertyTable.h"
+
 // PublicUtility Includes
 #include "CAVolumeCurve.h"
 #include "CAMutex.h"
@@ -85,6 +89,24 @@ public:
      */
     CAVolumeCurve&      GetVolumeCurve() { return mVolumeCurve; }
 
+    /*!
+     Replace the range of the control's volume curve. The current volume is clamped to the new
+     range. The range defaults to -96 dB to 0 dB in 96 raw steps.
+
+     If inMaxDb is above 0 dB, the control boosts the audio. Its gain then follows its dB volume
+     exactly, rather than the curve's scalar values, which can't go above 1.0.
+
+     Should be called before the control is published to the host, since it doesn't send any
+     notifications.
+     */
+    void                SetVolumeRange(SInt32 inMinRaw,
+                                       SInt32 inMaxRaw,
+                                       Float32 inMinDb,
+                                       Float32 inMaxDb);
+
+    /*! @return The volume of the control in decibels. */
+    Float32             GetVolumeDb() const;
+
     /*!
      Set the volume of this control to a given position along its volume curve. (See
      GetVolumeCurve.)
@@ -113,6 +135,19 @@ public:
      false initially.
      */
     void                SetWillApplyVolumeToAudio(bool inWillApplyVolumeToAudio);
+    /*!
+     Set the number of frames ApplyVolumeToAudioRT takes to move to a new volume. 0 to change it
+     at the start of the next IO buffer, which can click. Lengths over
+     BGM_GainRamp::kMaxLengthFrames are clamped. Defaults to BGM_GainRamp::kDefaultLengthFrames.
+     */
+    void                SetGainRampLengthFrames(UInt32 inLengthFrames);
+    UInt32              GetGainRampLengthFrames() const;
+    /*!
+     Make ApplyVolumeToAudioRT ramp from inGain instead of the gain it last applied, e.g. when it
+     hasn't been called for a while. Not thread safe, so it should only be called while IO is
+     stopped.
+     */
+    void                ResetGainRamp(Float32 inGain);
 
 #pragma mark IO Operations
 
@@ -123,22 +158,30 @@ public:
     bool                WillApplyVolumeToAudioRT() const;
     /*!
      Apply this volume control's volume to the samples in ioBuffer. That is, increase/decrease the
-     volumes of the samples by the current volume of this control.
+     volumes of the samples by the current volume of this control. When the volume changes, the
+     gain ramps to the new volume over the next few buffers. See SetGainRampLengthFrames.
 
      @param ioBuffer The audio sample buffer to process.
-     @param inBufferFrameSize The number of sample frames in ioBuffer. The audio is assumed to be in
-                              stereo, i.e. two samples per frame. (Though, hopefully we'll support
-                              more at some point.)
+     @param inBufferFrameSize The number of sample frames in ioBuffer.
+     @param inChannelCount The number of interleaved samples in each frame.
      @throws CAException If SetWillApplyVolumeToAudio hasn't been used to set this control to apply
                          its volume to audio data.
      */
-    void                ApplyVolumeToAudioRT(Float32* ioBuffer, UInt32 inBufferFrameSize) const;
+    void                ApplyVolumeToAudioRT(Float32* ioBuffer,
+                                             UInt32 inBufferFrameSize,
+                                             UInt32 inChannelCount);
 
 #pragma mark Implementation
 
 protected:
     void                SetVolumeRaw(SInt32 inNewVolumeRaw);
 
+private:
+    static const BGM_PropertyTable<BGM_VolumeControl>& GetPropertyTable();
+
+    // Sets mAmplitudeGain for mVolumeRaw. mMutex must be held.
+    void                UpdateAmplitudeGain();
+
 private:
     const SInt32        kDefaultMinRawVolume = 0;
     const SInt32        kDefaultMaxRawVolume = 96;
@@ -157,6 +200,9 @@ private:
     // The gain (or loss) to apply to an audio signal to increase/decrease its volume by the current
     // volume of this control.
     Float32             mAmplitudeGain;
+    // Moves the gain applied to the audio towards mAmplitudeGain. Only used on the IO thread.
+    BGM_GainRamp        mGainRamp;
+    std::atomic<UInt32> mGainRampLengthFrames;
 
     bool                mWillApplyVolumeToAudio;
 
@@ -0,0 +1,113 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_BundleIDTable.cpp
+//  BGMDriver
+//
+//  Copyright © 2026 Kyle Neideck
+//
+
+// Self Include
+#include "BGM_BundleIDTable.h"
+
+
+#pragma clang assume_nonnull begin
+
+const UInt32 BGM_BundleIDTable::kNoBundleID;
+
+UInt32  BGM_BundleIDTable::Intern(const BGM_String& inBundleID)
+{
+    if(!inBundleID.IsValid())
+    {
+        return kNoBundleID;
+    }
+
+    auto theTokenItr = mTokens.find(inBundleID);
+
+    if(theTokenItr != mTokens.end())
+    {
+        mEntries[theTokenItr->second].mReferenceCount++;
+        return theTokenItr->second;
+    }
+
+    UInt32 theToken;
+
+    if(!mFreeTokens.empty())
+    {
+        theToken = mFreeTokens.back();
+        mFreeTokens.pop_back();
+    }
+    else
+    {
+        theToken = static_cast<UInt32>(mEntries.size());
+        mEntries.push_back(Entry());
+    }
+
+    mTokens[inBundleID] = theToken;
+    mEntries[theToken].mBundleID = inBundleID;
+    mEntries[theToken].mReferenceCount = 1;
+
+    return theToken;
+}
+
+void    BGM_BundleIDTable::Retain(UInt32 inToken)
+{
+    if(inToken < mEntries.size() && mEntries[inToken].mReferenceCount > 0)
+    {
+        mEntries[inToken].mReferenceCount++;
+    }
+}
+
+void    BGM_BundleIDTable::Release(UInt32 inToken)
+{
+    if(inToken >= mEntries.size() || mEntries[inToken].mReferenceCount == 0)
+    {
+        return;
+    }
+
+    Entry& theEntry = mEntries[inToken];
+
+    if(--theEntry.mReferenceCount == 0)
+    {
+        mTokens.erase(theEntry.mBundleID);
+        theEntry.mBundleID = BGM_String();
+        mFreeTokens.push_back(inToken);
+    }
+}
+
+UInt32  BGM_BundleIDTable::Find(const BGM_String& inBundleID) const
+{
+    if(!inBundleID.IsValid())
+    {
+        return kNoBundleID;
+    }
+
+    auto theTokenItr = mTokens.find(inBundleID);
+    return (theTokenItr != mTokens.end()) ? theTokenItr->second : kNoBundleID;
+}
+
+BGM_String  BGM_BundleIDTable::GetBundleID(UInt32 inToken) const
+{
+    if(inToken >= mEntries.size())
+    {
+        return BGM_String();
+    }
+
+    return mEntries[inToken].mBundleID;
+}
+
+#pragma clang assume_nonnull end
+
@@ -0,0 +1,101 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_BundleIDTable.h
+//  BGMDriver
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  Interns bundle IDs as dense integer tokens, so BGM_ClientMap can match clients by bundle ID
+//  without comparing strings and its client records can be copied without retaining CF objects.
+//
+//  Each token is reference counted. Intern and Retain add a reference and Release removes one. A
+//  bundle ID keeps its token until its last reference is released, after which the token can be
+//  given to another bundle ID. Freed tokens are reused before new ones are assigned, so tokens stay
+//  dense (below the largest number of bundle IDs the table has held at once) and can be used as
+//  indices.
+//
+//  Not thread-safe and not real-time safe. BGM_ClientMap only uses it while holding its shadow
+//  maps mutex.
+//
+
+#ifndef BGMDriver__BGM_BundleIDTable
+#define BGMDriver__BGM_BundleIDTable
+
+// Local Includes
+#include "BGM_Platform.h"
+
+// STL Includes
+#include <map>
+#include <vector>
+
+// System Includes
+#include <MacTypes.h>
+
+
+#pragma clang assume_nonnull begin
+
+class BGM_BundleIDTable
+{
+
+public:
+    // The token for a missing or invalid bundle ID.
+    static const UInt32                 kNoBundleID = 0xFFFFFFFF;
+
+    /*!
+     @return The bundle ID's token, which is assigned if it doesn't have one yet. Adds a reference to
+             the token, unless it's kNoBundleID.
+     */
+    UInt32                              Intern(const BGM_String& inBundleID);
+
+    /*! Add a reference to an interned token. Does nothing for kNoBundleID. */
+    void                                Retain(UInt32 inToken);
+
+    /*!
+     Remove a reference to the token. When its last reference is removed, its bundle ID is forgotten
+     and the token can be reused. Does nothing for kNoBundleID.
+     */
+    void                                Release(UInt32 inToken);
+
+    /*! @return The bundle ID's token or kNoBundleID if it hasn't been interned. */
+    UInt32                              Find(const BGM_String& inBundleID) const;
+
+    /*! @return The bundle ID for the token or an invalid string if the token is kNoBundleID. */
+    BGM_String                          GetBundleID(UInt32 inToken) const;
+
+    /*! @return The number of bundle IDs that currently have tokens. */
+    size_t                              GetSize() const { return mTokens.size(); }
+
+private:
+    struct Entry
+    {
+        // Invalid if the token is free.
+        BGM_String                      mBundleID;
+        UInt32                          mReferenceCount = 0;
+    };
+
+    std::map<BGM_String, UInt32>        mTokens;
+    // Indexed by token.
+    std::vector<Entry>                  mEntries;
+    // The tokens that have been released, to be reused before new ones are assigned.
+    std::vector<UInt32>                 mFreeTokens;
+
+};
+
+#pragma clang assume_nonnull end
+
+#endif /* BGMDriver__BGM_BundleIDTable */
+
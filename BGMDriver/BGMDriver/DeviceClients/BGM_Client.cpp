@@ -31,12 +31,14 @@ BGM_Client::BGM_Client(const AudioServerPlugInClientInfo* inClientInfo)
     mIsNativeEndian(inClientInfo->mIsNativeEndian),
     mBundleID(inClientInfo->mBundleID)
 {
+#if BGM_PLATFORM_MACH
     // The bundle ID ref we were passed is only valid until our plugin returns control to the HAL, so we need to retain
     // it. (CACFString will handle the rest of its ownership/destruction.)
     if(inClientInfo->mBundleID != NULL)
     {
         CFRetain(inClientInfo->mBundleID);
     }
+#endif
 }
 
 void    BGM_Client::Copy(const BGM_Client& inClient)
@@ -44,10 +46,12 @@ void    BGM_Client::Copy(const BGM_Client& inClient)
     mClientID = inClient.mClientID;
     mProcessID = inClient.mProcessID;
     mBundleID = inClient.mBundleID;
+    mBundleIDToken = inClient.mBundleIDToken;
     mIsNativeEndian = inClient.mIsNativeEndian;
     mDoingIO = inClient.mDoingIO;
     mIsMusicPlayer = inClient.mIsMusicPlayer;
     mRelativeVolume = inClient.mRelativeVolume;
     mPanPosition = inClient.mPanPosition;
+    mDSPSlot = inClient.mDSPSlot;
 }
 
@@ -23,8 +23,9 @@
 #ifndef __BGMDriver__BGM_Client__
 #define __BGMDriver__BGM_Client__
 
-// PublicUtility Includes
-#include "CACFString.h"
+// Local Includes
+#include "BGM_BundleIDTable.h"
+#include "BGM_Platform.h"
 
 // System Includes
 #include <CoreAudio/AudioServerPlugIn.h>
@@ -54,11 +55,18 @@ private:
     
 public:
     // These fields are duplicated from AudioServerPlugInClientInfo (except the mBundleID CFStringRef is
-    // wrapped in a CACFString here).
+    // wrapped in a CACFString, or BGM_String off macOS, here).
+    //
+    // BGM_ClientMap doesn't keep mBundleID in its records, so they can be copied on real-time threads
+    // without retaining it. It's only set for clients given to and returned by BGM_ClientMap's
+    // non-real-time methods. mBundleIDToken is always set for clients in the map.
     UInt32                        mClientID;
     pid_t                         mProcessID;
     Boolean                       mIsNativeEndian = true;
-    CACFString                    mBundleID;
+    BGM_String                    mBundleID;
+    
+    // The token for mBundleID in the client map's BGM_BundleIDTable, or BGM_BundleIDTable::kNoBundleID.
+    UInt32                        mBundleIDToken = BGM_BundleIDTable::kNoBundleID;
     
     // Becomes true when the client triggers the plugin host to call StartIO or to begin
     // kAudioServerPlugInIOOperationThread, and false again on StopIO or when
@@ -75,6 +83,10 @@ public:
     // The client's pan position, in the range [-100, 100] where -100 is left and 100 is right
     SInt32                        mPanPosition = 0;
     
+    // The index of the client's app's slot in BGM_Device's BGM_ClientDSP, or -1 if the app doesn't
+    // have any DSP settings.
+    SInt32                        mDSPSlot = -1;
+    
 };
 
 #pragma clang assume_nonnull end
@@ -17,7 +17,7 @@
 //  BGM_ClientMap.cpp
 //  BGMDriver
 //
-//  Copyright © 2016, 2017, 2019, 2025 Kyle Neideck
+//  Copyright © 2016, 2017, 2019, 2025, 2026 Kyle Neideck
 //  Copyright © 2017 Andrew Tonner
 //
 
@@ -28,30 +28,71 @@
 #include "BGM_Types.h"
 
 // PublicUtility Includes
-#include "CACFDictionary.h"
 #include "CAException.h"
+#include "CADebugMacros.h"
+
+// STL Includes
+#include <algorithm>
 
 
 #pragma clang assume_nonnull begin
 
+UInt32  BGM_ClientMap::InternBundleID(const BGM_String& inBundleID)
+{
+    CAMutex::Locker theShadowMapsLocker(mShadowMapsMutex);
+    return mBundleIDs.Intern(inBundleID);
+}
+
+void    BGM_ClientMap::ReleaseBundleID(UInt32 inBundleIDToken)
+{
+    CAMutex::Locker theShadowMapsLocker(mShadowMapsMutex);
+    mBundleIDs.Release(inBundleIDToken);
+}
+
+UInt32  BGM_ClientMap::FindBundleID(const BGM_String& inBundleID) const
+{
+    CAMutex::Locker theShadowMapsLocker(mShadowMapsMutex);
+    return mBundleIDs.Find(inBundleID);
+}
+
+size_t  BGM_ClientMap::GetBundleIDCount() const
+{
+    CAMutex::Locker theShadowMapsLocker(mShadowMapsMutex);
+    return mBundleIDs.GetSize();
+}
+
 void    BGM_ClientMap::AddClient(BGM_Client inClient)
 {
     CAMutex::Locker theShadowMapsLocker(mShadowMapsMutex);
     
+    // The client holds a reference to its token until it's removed.
+    inClient.mBundleIDToken = mBundleIDs.Intern(inClient.mBundleID);
+    
+    // The maps only keep the token, so copying the client on a real-time thread doesn't retain the CFString.
+    inClient.mBundleID = BGM_String();
+    
     // If this client has been a client in the past (and has a bundle ID), copy its previous audio settings
-    auto pastClientItr = inClient.mBundleID.IsValid() ? mPastClientMap.find(inClient.mBundleID) : mPastClientMap.end();
-    if(pastClientItr != mPastClientMap.end())
+    const BGM_PastClientStore::Record* pastClient = mPastClients.Find(inClient.mBundleIDToken);
+    if(pastClient != nullptr)
     {
         DebugMsg("BGM_ClientMap::AddClient: Found previous volume %f and pan %d for client %u",
-                 pastClientItr->second.mRelativeVolume,
-                 pastClientItr->second.mPanPosition,
+                 pastClient->mRelativeVolume,
+                 pastClient->mPanPosition,
                  inClient.mClientID);
-        inClient.mRelativeVolume = pastClientItr->second.mRelativeVolume;
-        inClient.mPanPosition = pastClientItr->second.mPanPosition;
+        inClient.mRelativeVolume = pastClient->mRelativeVolume;
+        inClient.mPanPosition = pastClient->mPanPosition;
     }
     
     // Add the new client to the shadow maps
-    AddClientToShadowMaps(inClient);
+    try
+    {
+        AddClientToShadowMaps(inClient);
+    }
+    catch(...)
+    {
+        mBundleIDs.Release(inClient.mBundleIDToken);
+        throw;
+    }
     
     // Swap the maps with their shadow maps
     SwapInShadowMaps();
@@ -60,16 +101,13 @@ void    BGM_ClientMap::AddClient(BGM_Client inClient)
     // keep the sets of maps identical.
     AddClientToShadowMaps(inClient);
 
-    // Insert the client into the past clients map. We do this here rather than in RemoveClient
+    // Insert the client into the past clients. We do this here as well as in RemoveClient
     // because some apps add multiple clients with the same bundle ID and we want to give them all
     // the same settings (volume, etc.).
-    if(inClient.mBundleID.IsValid())
-    {
-        mPastClientMap[inClient.mBundleID] = inClient;
-    }
+    RememberSettings(inClient, false);
 }
 
-void    BGM_ClientMap::AddClientToShadowMaps(BGM_Client inClient)
+void    BGM_ClientMap::AddClientToShadowMaps(const BGM_Client& inClient)
 {
     ThrowIf(mClientMapShadow.count(inClient.mClientID) != 0,
             BGM_InvalidClientException(),
@@ -85,10 +123,67 @@ void    BGM_ClientMap::AddClientToShadowMaps(BGM_Client inClient)
     mClientMapByPIDShadow[inClient.mProcessID].push_back(&clientInMap);
     
     // Add to the bundle ID shadow map
-    if(inClient.mBundleID.IsValid())
+    if(inClient.mBundleIDToken != BGM_BundleIDTable::kNoBundleID)
+    {
+        mClientMapByBundleIDShadow[inClient.mBundleIDToken].push_back(&clientInMap);
+    }
+}
+
+void    BGM_ClientMap::RemoveClientFromShadowMaps(const BGM_Client& inClient)
+{
+    // Only remove this client's pointers. Other clients can have the same PID or bundle ID.
+    auto theRemoveFromList = [&] (BGM_ClientPtrList& ioClients) {
+        ioClients.erase(std::remove_if(ioClients.begin(),
+                                       ioClients.end(),
+                                       [&] (const BGM_Client* inOtherClient) {
+                                           return inOtherClient->mClientID == inClient.mClientID;
+                                       }),
+                        ioClients.end());
+    };
+    
+    auto thePIDItr = mClientMapByPIDShadow.find(inClient.mProcessID);
+    if(thePIDItr != mClientMapByPIDShadow.end())
     {
-        mClientMapByBundleIDShadow[inClient.mBundleID].push_back(&clientInMap);
+        theRemoveFromList(thePIDItr->second);
+        
+        if(thePIDItr->second.empty())
+        {
+            mClientMapByPIDShadow.erase(thePIDItr);
+        }
     }
+    
+    auto theBundleIDItr = mClientMapByBundleIDShadow.find(inClient.mBundleIDToken);
+    if(theBundleIDItr != mClientMapByBundleIDShadow.end())
+    {
+        theRemoveFromList(theBundleIDItr->second);
+        
+        if(theBundleIDItr->second.empty())
+        {
+            mClientMapByBundleIDShadow.erase(theBundleIDItr);
+        }
+    }
+    
+    // Erase the client last because the pointer maps point to it.
+    mClientMapShadow.erase(inClient.mClientID);
+}
+
+BGM_Client    BGM_ClientMap::CopyWithBundleID(const BGM_Client& inClient) const
+{
+    BGM_Client theClient = inClient;
+    theClient.mBundleID = mBundleIDs.GetBundleID(inClient.mBundleIDToken);
+    return theClient;
+}
+
+BGM_Client    BGM_ClientMap::MakePastClient(const BGM_PastClientStore::Record& inPastClient) const
+{
+    BGM_Client theClient;
+    theClient.mClientID = 0;
+    theClient.mProcessID = -1;
+    theClient.mBundleIDToken = inPastClient.mBundleIDToken;
+    theClient.mBundleID = mBundleIDs.GetBundleID(inPastClient.mBundleIDToken);
+    theClient.mRelativeVolume = inPastClient.mRelativeVolume;
+    theClient.mPanPosition = inPastClient.mPanPosition;
+    return theClient;
 }
 
 BGM_Client    BGM_ClientMap::RemoveClient(UInt32 inClientID)
@@ -105,25 +200,24 @@ BGM_Client    BGM_ClientMap::RemoveClient(UInt32 inClientID)
     BGM_Client theClient = theClientItr->second;
     
     // Remove the client from the shadow maps
-    mClientMapShadow.erase(theClientItr);
-    mClientMapByPIDShadow.erase(theClient.mProcessID);
-    if(theClient.mBundleID.IsValid())
-    {
-        mClientMapByBundleID.erase(theClient.mBundleID);
-    }
+    RemoveClientFromShadowMaps(theClient);
     
     // Swap the maps with their shadow maps
     SwapInShadowMaps();
     
-    // Erase the client again so the maps and their shadow maps are kept identical
-    mClientMapShadow.erase(inClientID);
-    mClientMapByPIDShadow.erase(theClient.mProcessID);
-    if(theClient.mBundleID.IsValid())
-    {
-        mClientMapByBundleID.erase(theClient.mBundleID);
-    }
+    // Remove the client again so the maps and their shadow maps are kept identical
+    RemoveClientFromShadowMaps(theClient);
     
-    return theClient;
+    // Keep the client's final settings so they're restored if it's added again.
+    RememberSettings(theClient, false);
+    
+    BGM_Client theRemovedClient = CopyWithBundleID(theClient);
+    
+    // Release the client's token after copying its bundle ID, which can free the token if the past clients
+    // don't have a record for it.
+    mBundleIDs.Release(theClient.mBundleIDToken);
+    
+    return theRemovedClient;
 }
 
 bool    BGM_ClientMap::GetClientRT(UInt32 inClientID, BGM_Client* outClient) const
@@ -135,7 +229,15 @@ bool    BGM_ClientMap::GetClientRT(UInt32 inClientID, BGM_Client* outClient) con
 bool    BGM_ClientMap::GetClientNonRT(UInt32 inClientID, BGM_Client* outClient) const
 {
     CAMutex::Locker theShadowMapsLocker(mShadowMapsMutex);
-    return GetClient(mClientMapShadow, inClientID, outClient);
+    
+    bool didFindClient = GetClient(mClientMapShadow, inClientID, outClient);
+    
+    if(didFindClient)
+    {
+        outClient->mBundleID = mBundleIDs.GetBundleID(outClient->mBundleIDToken);
+    }
+    
+    return didFindClient;
 }
 
 //static
@@ -164,7 +266,7 @@ std::vector<BGM_Client> BGM_ClientMap::GetClientsByPID(pid_t inPID) const
         // Found clients with the PID, so copy them into the return vector
         for(auto& theClientPtrsItr : theMapItr->second)
         {
-            theClients.push_back(*theClientPtrsItr);
+            theClients.push_back(CopyWithBundleID(*theClientPtrsItr));
         }
     }
     
@@ -177,7 +279,7 @@ void    BGM_ClientMap::UpdateMusicPlayerFlags(pid_t inMusicPlayerPID)
 {
     CAMutex::Locker theShadowMapsLocker(mShadowMapsMutex);
     
-    auto theIsMusicPlayerTest = [&] (BGM_Client theClient) {
+    auto theIsMusicPlayerTest = [&] (const BGM_Client& theClient) {
         return (theClient.mProcessID == inMusicPlayerPID);
     };
     
@@ -186,12 +288,13 @@ void    BGM_ClientMap::UpdateMusicPlayerFlags(pid_t inMusicPlayerPID)
     UpdateMusicPlayerFlagsInShadowMaps(theIsMusicPlayerTest);
 }
 
-void    BGM_ClientMap::UpdateMusicPlayerFlags(CACFString inMusicPlayerBundleID)
+void    BGM_ClientMap::UpdateMusicPlayerFlagsByBundleID(UInt32 inMusicPlayerBundleIDToken)
 {
     CAMutex::Locker theShadowMapsLocker(mShadowMapsMutex);
     
-    auto theIsMusicPlayerTest = [&] (BGM_Client theClient) {
-        return (theClient.mBundleID.IsValid() && theClient.mBundleID == inMusicPlayerBundleID);
+    auto theIsMusicPlayerTest = [&] (const BGM_Client& theClient) {
+        return (theClient.mBundleIDToken != BGM_BundleIDTable::kNoBundleID &&
+                theClient.mBundleIDToken == inMusicPlayerBundleIDToken);
     };
     
     UpdateMusicPlayerFlagsInShadowMaps(theIsMusicPlayerTest);
@@ -199,7 +302,7 @@ void    BGM_ClientMap::UpdateMusicPlayerFlags(CACFString inMusicPlayerBundleID)
     UpdateMusicPlayerFlagsInShadowMaps(theIsMusicPlayerTest);
 }
 
-void    BGM_ClientMap::UpdateMusicPlayerFlagsInShadowMaps(std::function<bool(BGM_Client)> inIsMusicPlayerTest)
+void    BGM_ClientMap::UpdateMusicPlayerFlagsInShadowMaps(std::function<bool(const BGM_Client&)> inIsMusicPlayerTest)
 {
     for(auto& theItr : mClientMapShadow)
     {
@@ -210,46 +313,121 @@ void    BGM_ClientMap::UpdateMusicPlayerFlagsInShadowMaps(std::function<bool(BGM
 
 #pragma mark App Volumes
 
-CACFArray   BGM_ClientMap::CopyClientRelativeVolumesAsAppVolumes(CAVolumeCurve inVolumeCurve) const
+std::vector<BGM_Client> BGM_ClientMap::CopyClientsWithNonDefaultVolumeOrPan() const
 {
     // Since this is a read-only, non-real-time operation, we can read from the shadow maps to avoid
     // locking the main maps.
     CAMutex::Locker theShadowMapsLocker(mShadowMapsMutex);
     
-    CACFArray theAppVolumes(false);
+    std::vector<BGM_Client> theClients;
+    
+    auto copyIfNonDefault = [&] (const BGM_Client& inClient) {
+        if(inClient.mRelativeVolume != 1.0 || inClient.mPanPosition != 0)
+        {
+            theClients.push_back(CopyWithBundleID(inClient));
+        }
+    };
     
     for(auto& theClientEntry : mClientMapShadow)
     {
-        CopyClientIntoAppVolumesArray(theClientEntry.second, inVolumeCurve, theAppVolumes);
+        copyIfNonDefault(theClientEntry.second);
     }
     
-    for(auto& thePastClientEntry : mPastClientMap)
+    // Skip the past clients that have current clients, which were copied above. (Their records are kept
+    // up to date, so they would just be duplicates.)
+    mPastClients.ForEach([&] (const BGM_PastClientStore::Record& inPastClient) {
+        if(mClientMapByBundleIDShadow.count(inPastClient.mBundleIDToken) == 0)
+        {
+            copyIfNonDefault(MakePastClient(inPastClient));
+        }
+    });
+    
+    return theClients;
+}
+
+std::vector<BGM_Client> BGM_ClientMap::CopyClientsForStorage() const
+{
+    CAMutex::Locker theShadowMapsLocker(mShadowMapsMutex);
+    
+    // Start with the past clients and then overwrite them with the current ones, which can have newer
+    // settings. (Some of the past clients' settings were only recorded when their clients were added.)
+    std::map<UInt32, BGM_PastClientStore::Record> theSettingsByBundleID;
+    
+    mPastClients.ForEach([&] (const BGM_PastClientStore::Record& inPastClient) {
+        theSettingsByBundleID[inPastClient.mBundleIDToken] = inPastClient;
+    });
+    
+    for(auto& theClientEntry : mClientMapShadow)
     {
-        CopyClientIntoAppVolumesArray(thePastClientEntry.second, inVolumeCurve, theAppVolumes);
+        const BGM_Client& theClient = theClientEntry.second;
+        
+        if(theClient.mBundleIDToken != BGM_BundleIDTable::kNoBundleID)
+        {
+            theSettingsByBundleID[theClient.mBundleIDToken] =
+                    { theClient.mBundleIDToken, theClient.mRelativeVolume, theClient.mPanPosition, 0 };
+        }
     }
     
-    return theAppVolumes;
+    std::vector<BGM_Client> theClients;
+    
+    for(auto& theSettingsEntry : theSettingsByBundleID)
+    {
+        if(theSettingsEntry.second.mRelativeVolume != 1.0 || theSettingsEntry.second.mPanPosition != 0)
+        {
+            theClients.push_back(MakePastClient(theSettingsEntry.second));
+        }
+    }
+    
+    return theClients;
 }
 
-void    BGM_ClientMap::CopyClientIntoAppVolumesArray(BGM_Client inClient, CAVolumeCurve inVolumeCurve, CACFArray& ioAppVolumes) const
+void    BGM_ClientMap::RestorePastClients(const std::vector<BGM_Client>& inClients)
 {
-    // Only include clients set to a non-default volume or pan
-    if(inClient.mRelativeVolume != 1.0 || inClient.mPanPosition != 0)
+    CAMutex::Locker theShadowMapsLocker(mShadowMapsMutex);
+    
+    for(const BGM_Client& theClient : inClients)
     {
-        CACFDictionary theAppVolume(false);
+        UInt32 theBundleIDToken = mBundleIDs.Intern(theClient.mBundleID);
         
-        theAppVolume.AddSInt32(CFSTR(kBGMAppVolumesKey_ProcessID), inClient.mProcessID);
-        theAppVolume.AddString(CFSTR(kBGMAppVolumesKey_BundleID), inClient.mBundleID.CopyCFString());
-        // Reverse the volume conversion from SetClientsRelativeVolumes
-        theAppVolume.AddSInt32(CFSTR(kBGMAppVolumesKey_RelativeVolume),
-                               inVolumeCurve.ConvertScalarToRaw(inClient.mRelativeVolume / 4));
-        theAppVolume.AddSInt32(CFSTR(kBGMAppVolumesKey_PanPosition),
-                               inClient.mPanPosition);
+        // These were saved because the user set them.
+        SetPastClient(theBundleIDToken, theClient.mRelativeVolume, theClient.mPanPosition, true);
         
-        ioAppVolumes.AppendDictionary(theAppVolume.GetDict());
+        mBundleIDs.Release(theBundleIDToken);
     }
 }
 
+void    BGM_ClientMap::GetPastClientStats(BGMDeviceIOStats& outStats) const
+{
+    CAMutex::Locker theShadowMapsLocker(mShadowMapsMutex);
+    
+    outStats.mPastClients.mCount = mPastClients.GetSize();
+    outStats.mPastClients.mCapacity = mPastClients.GetCapacity();
+    outStats.mPastClients.mEvictions = mPastClients.GetEvictionCount();
+}
+
+void    BGM_ClientMap::RememberSettings(const BGM_Client& inClient, bool inUserSet)
+{
+    SetPastClient(inClient.mBundleIDToken, inClient.mRelativeVolume, inClient.mPanPosition, inUserSet);
+}
+
+void    BGM_ClientMap::SetPastClient(UInt32 inBundleIDToken,
+                                     Float32 inRelativeVolume,
+                                     SInt32 inPanPosition,
+                                     bool inUserSet)
+{
+    const bool theHadRecord = mPastClients.Contains(inBundleIDToken);
+    
+    UInt32 theEvictedToken = mPastClients.Set(inBundleIDToken, inRelativeVolume, inPanPosition, inUserSet);
+    
+    if(!theHadRecord && mPastClients.Contains(inBundleIDToken))
+    {
+        mBundleIDs.Retain(inBundleIDToken);
+    }
+    
+    // Frees the evicted record's bundle ID unless a client or another caller still has its token.
+    mBundleIDs.Release(theEvictedToken);
+}
+
 template <typename T>
 std::vector<BGM_Client*> * _Nullable GetClientsFromMap(std::map<T, std::vector<BGM_Client*>> & map, T key) {
     auto theClientItr = map.find(key);
@@ -263,15 +441,19 @@ std::vector<BGM_Client*> * _Nullable BGM_ClientMap::GetClients(pid_t inAppPid) {
     return GetClientsFromMap(mClientMapByPIDShadow, inAppPid);
 }
 
-std::vector<BGM_Client*> * _Nullable BGM_ClientMap::GetClients(CACFString inAppBundleID) {
-    if(!inAppBundleID.IsValid()) {
+std::vector<BGM_Client*> * _Nullable BGM_ClientMap::GetClients(BGM_String inAppBundleID) {
+    return GetClientsByBundleIDToken(mBundleIDs.Find(inAppBundleID));
+}
+
+std::vector<BGM_Client*> * _Nullable BGM_ClientMap::GetClientsByBundleIDToken(UInt32 inAppBundleIDToken) {
+    if(inAppBundleIDToken == BGM_BundleIDTable::kNoBundleID) {
         return nullptr;
     }
-    return GetClientsFromMap(mClientMapByBundleIDShadow, inAppBundleID);
+    return GetClientsFromMap(mClientMapByBundleIDShadow, inAppBundleIDToken);
 }
 
 void ShowSetRelativeVolumeMessage(pid_t inAppPID, BGM_Client* theClient);
-void ShowSetRelativeVolumeMessage(CACFString inAppBundleID, BGM_Client* theClient);
+void ShowSetRelativeVolumeMessage(BGM_String inAppBundleID, BGM_Client* theClient);
 
 void ShowSetRelativeVolumeMessage(pid_t inAppPID, BGM_Client* theClient) {
     (void)inAppPID;
@@ -282,7 +464,7 @@ void ShowSetRelativeVolumeMessage(pid_t inAppPID, BGM_Client* theClient) {
              inAppPID);
 }
 
-void ShowSetRelativeVolumeMessage(CACFString inAppBundleID, BGM_Client* theClient) {
+void ShowSetRelativeVolumeMessage(BGM_String inAppBundleID, BGM_Client* theClient) {
     (void)inAppBundleID;
     (void)theClient;
     DebugMsg("BGM_ClientMap::ShowSetRelativeVolumeMessage: Set volume %f for client %u by bundle ID (%s)",
@@ -298,8 +480,8 @@ void ShowSetRelativeVolumeMessage(CACFString inAppBundleID, BGM_Client* theClien
 //    return SetClientsRelativeVolumeT<pid_t>(inAppPID, inRelativeVolume);
 //}
 
-//bool BGM_ClientMap::SetClientsRelativeVolume(CACFString inAppBundleID, Float32 inRelativeVolume) {
-//    return SetClientsRelativeVolumeT<CACFString>(inAppBundleID, inRelativeVolume)
+//bool BGM_ClientMap::SetClientsRelativeVolume(BGM_String inAppBundleID, Float32 inRelativeVolume) {
+//    return SetClientsRelativeVolumeT<BGM_String>(inAppBundleID, inRelativeVolume)
 //}
 
 //template <typename T>
@@ -320,6 +502,7 @@ bool BGM_ClientMap::SetClientsRelativeVolume(pid_t searchKey, Float32 inRelative
             for(BGM_Client* theClient : *theClients)
             {
                 theClient->mRelativeVolume = inRelativeVolume;
+                RememberSettings(*theClient, true);
                 
                 ShowSetRelativeVolumeMessage(searchKey, theClient);
                 
@@ -335,7 +518,7 @@ bool BGM_ClientMap::SetClientsRelativeVolume(pid_t searchKey, Float32 inRelative
     return didChangeVolume;
 }
 
-bool BGM_ClientMap::SetClientsRelativeVolume(CACFString searchKey, Float32 inRelativeVolume)
+bool BGM_ClientMap::SetClientsRelativeVolume(BGM_String searchKey, Float32 inRelativeVolume)
 {
     bool didChangeVolume = false;
 
@@ -350,6 +533,7 @@ bool BGM_ClientMap::SetClientsRelativeVolume(CACFString searchKey, Float32 inRel
             for(BGM_Client* theClient : *theClients)
             {
                 theClient->mRelativeVolume = inRelativeVolume;
+                RememberSettings(*theClient, true);
                 
                 ShowSetRelativeVolumeMessage(searchKey, theClient);
                 
@@ -377,6 +561,7 @@ bool BGM_ClientMap::SetClientsPanPosition(pid_t searchKey, SInt32 inPanPosition)
         if(theClients != nullptr) {
             for(auto theClient: *theClients) {
                 theClient->mPanPosition = inPanPosition;
+                RememberSettings(*theClient, true);
                 didChangePanPosition = true;
             }
         }
@@ -389,7 +574,7 @@ bool BGM_ClientMap::SetClientsPanPosition(pid_t searchKey, SInt32 inPanPosition)
     return didChangePanPosition;
 }
 
-bool BGM_ClientMap::SetClientsPanPosition(CACFString searchKey, SInt32 inPanPosition)
+bool BGM_ClientMap::SetClientsPanPosition(BGM_String searchKey, SInt32 inPanPosition)
 {
     bool didChangePanPosition = false;
 
@@ -401,6 +586,7 @@ bool BGM_ClientMap::SetClientsPanPosition(CACFString searchKey, SInt32 inPanPosi
         if(theClients != nullptr) {
             for(auto theClient: *theClients) {
                 theClient->mPanPosition = inPanPosition;
+                RememberSettings(*theClient, true);
                 didChangePanPosition = true;
             }
         }
@@ -413,6 +599,153 @@ bool BGM_ClientMap::SetClientsPanPosition(CACFString searchKey, SInt32 inPanPosi
     return didChangePanPosition;
 }
 
+bool BGM_ClientMap::SetClientsVolumesAndPans(const std::vector<AppVolumeChange>& inChanges)
+{
+    if(inChanges.empty())
+    {
+        return false;
+    }
+
+    bool didChangeClients = false;
+
+    CAMutex::Locker theShadowMapsLocker(mShadowMapsMutex);
+
+    auto theApplyChange = [&] (const AppVolumeChange& inChange, std::vector<BGM_Client*>* _Nullable inClients) {
+        if(inClients != nullptr)
+        {
+            for(BGM_Client* theClient : *inClients)
+            {
+                if(inChange.mSetsRelativeVolume)
+                {
+                    theClient->mRelativeVolume = inChange.mRelativeVolume;
+                }
+
+                if(inChange.mSetsPanPosition)
+                {
+                    theClient->mPanPosition = inChange.mPanPosition;
+                }
+
+                RememberSettings(*theClient, true);
+                didChangeClients = true;
+            }
+        }
+    };
+
+    // Look up the bundle IDs' tokens once rather than in both passes.
+    std::vector<UInt32> theBundleIDTokens;
+    theBundleIDTokens.reserve(inChanges.size());
+
+    for(const AppVolumeChange& theChange : inChanges)
+    {
+        theBundleIDTokens.push_back(theChange.mBundleID != nullptr ?
+                                    mBundleIDs.Find(*theChange.mBundleID) :
+                                    BGM_BundleIDTable::kNoBundleID);
+    }
+
+    auto theSetVolumesAndPansInShadowMapsFunc = [&] {
+        for(size_t i = 0; i < inChanges.size(); i++)
+        {
+            const AppVolumeChange& theChange = inChanges[i];
+
+            if(theChange.mProcessID != -1)
+            {
+                theApplyChange(theChange, GetClients(theChange.mProcessID));
+            }
+
+            theApplyChange(theChange, GetClientsByBundleIDToken(theBundleIDTokens[i]));
+        }
+    };
+
+    theSetVolumesAndPansInShadowMapsFunc();
+    SwapInShadowMaps();
+    theSetVolumesAndPansInShadowMapsFunc();
+
+    // Record the settings for apps that aren't clients at the moment. Any settings the change doesn't
+    // include are kept from the app's past record, if it has one.
+    for(size_t i = 0; i < inChanges.size(); i++)
+    {
+        const AppVolumeChange& theChange = inChanges[i];
+
+        if((theChange.mBundleID == nullptr) || (GetClientsByBundleIDToken(theBundleIDTokens[i]) != nullptr))
+        {
+            continue;
+        }
+
+        UInt32 theBundleIDToken = mBundleIDs.Intern(*theChange.mBundleID);
+
+        if(theBundleIDToken == BGM_BundleIDTable::kNoBundleID)
+        {
+            continue;
+        }
+
+        BGM_Client theSettings;
+        const BGM_PastClientStore::Record* _Nullable thePastClient = mPastClients.Find(theBundleIDToken);
+
+        if(thePastClient != nullptr)
+        {
+            theSettings.mRelativeVolume = thePastClient->mRelativeVolume;
+            theSettings.mPanPosition = thePastClient->mPanPosition;
+        }
+
+        SetPastClient(theBundleIDToken,
+                      theChange.mSetsRelativeVolume ? theChange.mRelativeVolume : theSettings.mRelativeVolume,
+                      theChange.mSetsPanPosition ? theChange.mPanPosition : theSettings.mPanPosition,
+                      true);
+        
+        mBundleIDs.Release(theBundleIDToken);
+    }
+
+    return didChangeClients;
+}
+
+bool BGM_ClientMap::SetClientsDSPSlot(pid_t searchKey, SInt32 inDSPSlot)
+{
+    bool didSetDSPSlot = false;
+
+    CAMutex::Locker theShadowMapsLocker(mShadowMapsMutex);
+
+    auto theSetSlotsInShadowMapsFunc = [&] {
+        // Look up the clients for the key and update their DSP slots
+        auto theClients = GetClients(searchKey);
+        if(theClients != nullptr) {
+            for(auto theClient: *theClients) {
+                theClient->mDSPSlot = inDSPSlot;
+                didSetDSPSlot = true;
+            }
+        }
+    };
+
+    theSetSlotsInShadowMapsFunc();
+    SwapInShadowMaps();
+    theSetSlotsInShadowMapsFunc();
+
+    return didSetDSPSlot;
+}
+
+bool BGM_ClientMap::SetClientsDSPSlot(BGM_String searchKey, SInt32 inDSPSlot)
+{
+    bool didSetDSPSlot = false;
+
+    CAMutex::Locker theShadowMapsLocker(mShadowMapsMutex);
+
+    auto theSetSlotsInShadowMapsFunc = [&] {
+        // Look up the clients for the key and update their DSP slots
+        auto theClients = GetClients(searchKey);
+        if(theClients != nullptr) {
+            for(auto theClient: *theClients) {
+                theClient->mDSPSlot = inDSPSlot;
+                didSetDSPSlot = true;
+            }
+        }
+    };
+
+    theSetSlotsInShadowMapsFunc();
+    SwapInShadowMaps();
+    theSetSlotsInShadowMapsFunc();
+
+    return didSetDSPSlot;
+}
+
 void    BGM_ClientMap::UpdateClientIOStateNonRT(UInt32 inClientID, bool inDoingIO)
 {
     CAMutex::Locker theShadowMapsLocker(mShadowMapsMutex);
@@ -17,21 +17,21 @@
 //  BGM_ClientMap.h
 //  BGMDriver
 //
-//  Copyright © 2016, 2025 Kyle Neideck
+//  Copyright © 2016, 2025, 2026 Kyle Neideck
 //
 
 #ifndef __BGMDriver__BGM_ClientMap__
 #define __BGMDriver__BGM_ClientMap__
 
 // Local Includes
+#include "BGM_BundleIDTable.h"
 #include "BGM_Client.h"
+#include "BGM_PastClientStore.h"
 #include "BGM_TaskQueue.h"
+#include "BGM_Types.h"
 
 // PublicUtility Includes
 #include "CAMutex.h"
-#include "CACFString.h"
-#include "CACFArray.h"
-#include "CAVolumeCurve.h"
 
 // STL Includes
 #include <map>
@@ -50,8 +50,12 @@ class BGM_ClientTasks;
 //
 //  This class stores the clients (BGM_Client) that have been registered with BGMDevice by the HAL.
 //  It also maintains maps from clients' PIDs and bundle IDs to the clients. When a client is
-//  removed by the HAL we add it to a map of past clients to keep track of settings specific to that
-//  client. (Currently only the client's volume.)
+//  removed by the HAL we add it to a store of past clients to keep track of settings specific to that
+//  client. (Currently only the client's volume and pan position.) See BGM_PastClientStore.
+//
+//  Bundle IDs are interned as tokens (see BGM_BundleIDTable) when clients are added, and the maps
+//  only store and compare the tokens. Clients are returned with their bundle IDs from the non-RT
+//  methods, but GetClientRT only sets mBundleIDToken.
 //
 //  Since the maps are read from during IO, this class has to be real-time safe when accessing
 //  them. So each map has an identical "shadow" map, which we use to buffer updates.
@@ -79,17 +83,50 @@ class BGM_ClientMap
 public:
                                                         BGM_ClientMap(BGM_TaskQueue* inTaskQueue) : mTaskQueue(inTaskQueue), mMapsMutex("Maps mutex"), mShadowMapsMutex("Shadow maps mutex") { };
 
+    // Returns the token for inBundleID, which can be used to match clients by bundle ID without comparing
+    // strings. Returns BGM_BundleIDTable::kNoBundleID if inBundleID is invalid. The token stays assigned to
+    // inBundleID until the caller passes it to ReleaseBundleID.
+    UInt32                                              InternBundleID(const BGM_String& inBundleID);
+    void                                                ReleaseBundleID(UInt32 inBundleIDToken);
+
+    // Returns the token for inBundleID, or BGM_BundleIDTable::kNoBundleID if it doesn't have one. Bundle IDs
+    // only have tokens while they're interned by a client, a past client or a caller of InternBundleID.
+    UInt32                                              FindBundleID(const BGM_String& inBundleID) const;
+
+    // Returns the number of bundle IDs that currently have tokens.
+    size_t                                              GetBundleIDCount() const;
+
+    // Interns inClient's bundle ID, replacing its mBundleIDToken. The client's token is released when it's
+    // removed.
     void                                                AddClient(BGM_Client inClient);
     
 private:
-    void                                                AddClientToShadowMaps(BGM_Client inClient);
+    void                                                AddClientToShadowMaps(const BGM_Client& inClient);
+    void                                                RemoveClientFromShadowMaps(const BGM_Client& inClient);
+    
+    // Returns a copy of inClient with mBundleID set from its token.
+    BGM_Client                                          CopyWithBundleID(const BGM_Client& inClient) const;
+    
+    // Returns a client with the past client's bundle ID and settings, a client ID of 0 and a PID of -1.
+    BGM_Client                                          MakePastClient(const BGM_PastClientStore::Record& inPastClient) const;
+    
+    // Records inClient's settings in the past clients, if it has a bundle ID.
+    void                                                RememberSettings(const BGM_Client& inClient, bool inUserSet);
+
+    // Adds or replaces the past client record for inBundleIDToken. The past clients hold a reference to each
+    // of their records' tokens, which is released when the record is evicted.
+    void                                                SetPastClient(UInt32 inBundleIDToken,
+                                                                      Float32 inRelativeVolume,
+                                                                      SInt32 inPanPosition,
+                                                                      bool inUserSet);
     
 public:
     // Returns the removed client
     BGM_Client                                          RemoveClient(UInt32 inClientID);
     
     // These methods are functionally identical except that GetClientRT must only be called from real-time threads and GetClientNonRT
-    // must only be called from non-real-time threads. Both return true if a client was found.
+    // must only be called from non-real-time threads. Both return true if a client was found. GetClientRT doesn't set the client's
+    // mBundleID, only its mBundleIDToken.
     bool                                                GetClientRT(UInt32 inClientID, BGM_Client* outClient) const;
     bool                                                GetClientNonRT(UInt32 inClientID, BGM_Client* outClient) const;
     
@@ -101,21 +138,30 @@ private:
 public:
     std::vector<BGM_Client>                             GetClientsByPID(pid_t inPID) const;
     
-    // Set the isMusicPlayer flag for each client. (True if the client has the given bundle ID/PID, false otherwise.)
+    // Set the isMusicPlayer flag for each client. (True if the client has the given PID/bundle ID token, false otherwise.)
+    // inMusicPlayerBundleIDToken is from InternBundleID and can be BGM_BundleIDTable::kNoBundleID to clear the flags.
     void                                                UpdateMusicPlayerFlags(pid_t inMusicPlayerPID);
-    void                                                UpdateMusicPlayerFlags(CACFString inMusicPlayerBundleID);
+    void                                                UpdateMusicPlayerFlagsByBundleID(UInt32 inMusicPlayerBundleIDToken);
     
 private:
-    void                                                UpdateMusicPlayerFlagsInShadowMaps(std::function<bool(BGM_Client)> inIsMusicPlayerTest);
+    void                                                UpdateMusicPlayerFlagsInShadowMaps(std::function<bool(const BGM_Client&)> inIsMusicPlayerTest);
     
 public:
-    // Copies the current and past clients into an array in the format expected for
-    // kAudioDeviceCustomPropertyAppVolumes. (Except that CACFArray and CACFDictionary are used instead
-    // of unwrapped CFArray and CFDictionary refs.)
-    CACFArray                                           CopyClientRelativeVolumesAsAppVolumes(CAVolumeCurve inVolumeCurve) const;
+    // Copies the current and past clients that are set to a non-default relative volume or pan position.
+    // BGM_Clients uses this to build the value of kAudioDeviceCustomPropertyAppVolumes.
+    std::vector<BGM_Client>                             CopyClientsWithNonDefaultVolumeOrPan() const;
     
-private:
-    void                                                CopyClientIntoAppVolumesArray(BGM_Client inClient, CAVolumeCurve inVolumeCurve, CACFArray& ioAppVolumes) const;
+    // Copies one client for each bundle ID that's set to a non-default relative volume or pan position. The
+    // settings are taken from the current clients if there are any for the bundle ID and otherwise from the past
+    // clients. BGM_Device saves these so the apps' settings can be restored after coreaudiod restarts.
+    std::vector<BGM_Client>                             CopyClientsForStorage() const;
+    
+    // Adds inClients to the past clients, replacing any with the same bundle IDs, so clients added later with
+    // those bundle IDs get their relative volumes and pan positions. Clients without bundle IDs are ignored.
+    void                                                RestorePastClients(const std::vector<BGM_Client>& inClients);
+    
+    // Sets the mPastClients fields of outStats.
+    void                                                GetPastClientStats(BGMDeviceIOStats& outStats) const;
     
 public:
     // Using the template function hits LLVM Bug 23987
@@ -132,13 +178,40 @@ public:
     bool                                                SetClientsRelativeVolume(pid_t inAppPID, Float32 inRelativeVolume);
     // Returns true if a client for bundle ID inAppBundleID was found and its relative volume changed.
     // inAppBundleID may contain a null CFStringRef, in which case it returns false.
-    bool                                                SetClientsRelativeVolume(CACFString inAppBundleID, Float32 inRelativeVolume);
+    bool                                                SetClientsRelativeVolume(BGM_String inAppBundleID, Float32 inRelativeVolume);
     
     // Returns true if a client for PID inAppPID was found and its pan position changed.
     bool                                                SetClientsPanPosition(pid_t inAppPID, SInt32 inPanPosition);
     // Returns true if a client for bundle ID inAppBundleID was found and its pan position changed.
     // inAppBundleID may contain a null CFStringRef, in which case it returns false.
-    bool                                                SetClientsPanPosition(CACFString inAppBundleID, SInt32 inPanPosition);
+    bool                                                SetClientsPanPosition(BGM_String inAppBundleID, SInt32 inPanPosition);
+    
+    // A change to the relative volume and/or pan position of an app's clients. See SetClientsVolumesAndPans.
+    struct AppVolumeChange
+    {
+        // -1 to only find the app's clients by bundle ID.
+        pid_t                                           mProcessID = -1;
+        // Null to only find the app's clients by PID. Not owned.
+        const BGM_String* _Nullable                     mBundleID = nullptr;
+        bool                                            mSetsRelativeVolume = false;
+        Float32                                         mRelativeVolume = 1.0f;
+        bool                                            mSetsPanPosition = false;
+        SInt32                                          mPanPosition = 0;
+    };
+    
+    // Makes all of the changes, finding each app's clients by PID and by bundle ID, with a single swap of the
+    // shadow maps. So the changes are applied in the same IO cycle and the caller only waits for the real-time
+    // thread once, rather than once per app and key. Returns true if any clients were found.
+    //
+    // Changes for bundle IDs that don't have any clients are recorded in the past clients, so the apps get
+    // their settings when they're next added.
+    bool                                                SetClientsVolumesAndPans(const std::vector<AppVolumeChange>& inChanges);
+    
+    // Returns true if a client for PID inAppPID was found and its DSP slot set.
+    bool                                                SetClientsDSPSlot(pid_t inAppPID, SInt32 inDSPSlot);
+    // Returns true if a client for bundle ID inAppBundleID was found and its DSP slot set.
+    // inAppBundleID may contain a null CFStringRef, in which case it returns false.
+    bool                                                SetClientsDSPSlot(BGM_String inAppBundleID, SInt32 inDSPSlot);
     
     void                                                StartIONonRT(UInt32 inClientID) { UpdateClientIOStateNonRT(inClientID, true); }
     void                                                StopIONonRT(UInt32 inClientID) { UpdateClientIOStateNonRT(inClientID, false); }
@@ -156,14 +229,15 @@ private:
     // Client lookup for PID inAppPID
     std::vector<BGM_Client*> * _Nullable                GetClients(pid_t inAppPid);
     // Client lookup for bundle ID inAppBundleID
-    std::vector<BGM_Client*> * _Nullable                GetClients(CACFString inAppBundleID);
+    std::vector<BGM_Client*> * _Nullable                GetClients(BGM_String inAppBundleID);
+    // Client lookup for bundle ID token inAppBundleIDToken
+    std::vector<BGM_Client*> * _Nullable                GetClientsByBundleIDToken(UInt32 inAppBundleIDToken);
     
 private:
     BGM_TaskQueue*                                      mTaskQueue;
     
-    // Must be held to access mClientMap or mClientMapByPID. Code that runs while holding this mutex needs
-    // to be real-time safe. Should probably not be held for most operations on mClientMapByBundleID because,
-    // as far as I can tell, code that works with CFStrings is unlikely to be real-time safe.
+    // Must be held to access mClientMap, mClientMapByPID or mClientMapByBundleID. Code that runs while holding
+    // this mutex needs to be real-time safe.
     CAMutex                                             mMapsMutex;
     // Should only be locked by non-real-time threads. Should not be released until the maps have been
     // made identical to their shadow maps.
@@ -181,12 +255,16 @@ private:
     std::map<pid_t, BGM_ClientPtrList>                  mClientMapByPID;
     std::map<pid_t, BGM_ClientPtrList>                  mClientMapByPIDShadow;
     
-    std::map<CACFString, BGM_ClientPtrList>             mClientMapByBundleID;
-    std::map<CACFString, BGM_ClientPtrList>             mClientMapByBundleIDShadow;
+    // Indexed by bundle ID token.
+    std::map<UInt32, BGM_ClientPtrList>                 mClientMapByBundleID;
+    std::map<UInt32, BGM_ClientPtrList>                 mClientMapByBundleIDShadow;
+    
+    // Only accessed while holding mShadowMapsMutex.
+    BGM_BundleIDTable                                   mBundleIDs;
     
-    // Clients are added to mPastClientMap so we can restore settings specific to them if they get
-    // added again.
-    std::map<CACFString, BGM_Client>                    mPastClientMap;
+    // Clients' settings are kept in mPastClients so we can restore them if they get added again. Only
+    // accessed while holding mShadowMapsMutex.
+    BGM_PastClientStore                                 mPastClients;
     
 };
 
@@ -26,8 +26,10 @@
 #define __BGMDriver__BGM_ClientTasks__
 
 // Local Includes
-#include "BGM_Clients.h"
 #include "BGM_ClientMap.h"
+#if !BGM_CORE_STANDALONE
+#include "BGM_Clients.h"
+#endif
 
 
 // Forward Declarations
@@ -42,8 +44,10 @@ class BGM_ClientTasks
     friend class BGM_TaskQueue;
     
 private:
+#if !BGM_CORE_STANDALONE
     static bool                            StartIONonRT(BGM_Clients* inClients, UInt32 inClientID) { return inClients->StartIONonRT(inClientID); }
     static bool                            StopIONonRT(BGM_Clients* inClients, UInt32 inClientID) { return inClients->StopIONonRT(inClientID); }
+#endif
     
     static void                            SwapInShadowMapsRT(BGM_ClientMap* inClientMap) { inClientMap->SwapInShadowMapsRT(); }
     
@@ -46,6 +46,8 @@ BGM_Clients::BGM_Clients(AudioObjectID inOwnerDeviceID, BGM_TaskQueue* inTaskQue
                                   kAppRelativeVolumeMaxRawValue,
                                   kAppRelativeVolumeMinDbValue,
                                   kAppRelativeVolumeMaxDbValue);
+    
+    mBGMAppBundleIDToken = mClientMap.InternBundleID(BGM_String(kBGMAppBundleID));
 }
 
 #pragma mark Add/Remove Clients
@@ -54,13 +56,17 @@ void    BGM_Clients::AddClient(BGM_Client inClient)
 {
     CAMutex::Locker theLocker(mMutex);
 
+    // Look up the client's bundle ID's token so we can compare tokens rather than strings. The client map
+    // interns it when the client is added. If it doesn't have a token yet, it can't be the music player's
+    // or BGMApp's, since we hold references to theirs.
+    inClient.mBundleIDToken = mClientMap.FindBundleID(inClient.mBundleID);
+
     // Check whether this is the music player's client
     bool pidMatchesMusicPlayerProperty =
         (mMusicPlayerProcessIDProperty != 0 && inClient.mProcessID == mMusicPlayerProcessIDProperty);
     bool bundleIDMatchesMusicPlayerProperty =
-        (mMusicPlayerBundleIDProperty != "" &&
-         inClient.mBundleID.IsValid() &&
-         inClient.mBundleID == mMusicPlayerBundleIDProperty);
+        (inClient.mBundleIDToken != BGM_BundleIDTable::kNoBundleID &&
+         inClient.mBundleIDToken == mMusicPlayerBundleIDToken);
     
     inClient.mIsMusicPlayer = (pidMatchesMusicPlayerProperty || bundleIDMatchesMusicPlayerProperty);
     
@@ -72,7 +78,7 @@ void    BGM_Clients::AddClient(BGM_Client inClient)
     mClientMap.AddClient(inClient);
     
     // If we're adding BGMApp, update our local copy of its client ID
-    if(inClient.mBundleID.IsValid() && inClient.mBundleID == kBGMAppBundleID)
+    if(inClient.mBundleIDToken != BGM_BundleIDTable::kNoBundleID && inClient.mBundleIDToken == mBGMAppBundleIDToken)
     {
         mBGMAppClientID = inClient.mClientID;
     }
@@ -254,6 +260,8 @@ bool    BGM_Clients::SetMusicPlayer(const pid_t inPID)
     mMusicPlayerProcessIDProperty = inPID;
     // Unset the bundle ID property
     mMusicPlayerBundleIDProperty = "";
+    mClientMap.ReleaseBundleID(mMusicPlayerBundleIDToken);
+    mMusicPlayerBundleIDToken = BGM_BundleIDTable::kNoBundleID;
     
     DebugMsg("BGM_Clients::SetMusicPlayer: Setting music player by PID. inPID=%d", inPID);
     
@@ -276,6 +284,10 @@ bool    BGM_Clients::SetMusicPlayer(const CACFString inBundleID)
     }
     
     mMusicPlayerBundleIDProperty = inBundleID;
+    // The empty string means the property is unset, as above.
+    mClientMap.ReleaseBundleID(mMusicPlayerBundleIDToken);
+    mMusicPlayerBundleIDToken =
+        (inBundleID != "") ? mClientMap.InternBundleID(inBundleID) : BGM_BundleIDTable::kNoBundleID;
     // Unset the PID property
     mMusicPlayerProcessIDProperty = 0;
     
@@ -283,7 +295,7 @@ bool    BGM_Clients::SetMusicPlayer(const CACFString inBundleID)
              CFStringGetCStringPtr(inBundleID.GetCFString(), kCFStringEncodingUTF8));
     
     // Update the clients' mIsMusicPlayer fields
-    mClientMap.UpdateMusicPlayerFlags(inBundleID);
+    mClientMap.UpdateMusicPlayerFlagsByBundleID(mMusicPlayerBundleIDToken);
     
     return true;
 }
@@ -311,6 +323,54 @@ SInt32 BGM_Clients::GetClientPanPositionRT(UInt32 inClientID) const
     return (didGetClient ? theClient.mPanPosition : kAppPanCenterRawValue);
 }
 
+SInt32 BGM_Clients::GetClientDSPSlotRT(UInt32 inClientID) const
+{
+    BGM_Client theClient;
+    bool didGetClient = mClientMap.GetClientRT(inClientID, &theClient);
+    return (didGetClient ? theClient.mDSPSlot : -1);
+}
+
+bool    BGM_Clients::SetClientsDSPSlot(pid_t inAppPID,
+                                       const BGM_String& inAppBundleID,
+                                       SInt32 inDSPSlot)
+{
+    bool didSetSlot = false;
+
+    if(inAppPID != -1)
+    {
+        didSetSlot = mClientMap.SetClientsDSPSlot(inAppPID, inDSPSlot);
+    }
+
+    if(inAppBundleID.IsValid())
+    {
+        didSetSlot = mClientMap.SetClientsDSPSlot(inAppBundleID, inDSPSlot) || didSetSlot;
+    }
+
+    return didSetSlot;
+}
+
+CACFArray   BGM_Clients::CopyClientRelativeVolumesAsAppVolumes() const
+{
+    CACFArray theAppVolumes(false);
+    
+    for(const BGM_Client& theClient : mClientMap.CopyClientsWithNonDefaultVolumeOrPan())
+    {
+        CACFDictionary theAppVolume(false);
+        
+        theAppVolume.AddSInt32(CFSTR(kBGMAppVolumesKey_ProcessID), theClient.mProcessID);
+        theAppVolume.AddString(CFSTR(kBGMAppVolumesKey_BundleID), theClient.mBundleID.CopyCFString());
+        // Reverse the volume conversion from SetClientsRelativeVolumes
+        theAppVolume.AddSInt32(CFSTR(kBGMAppVolumesKey_RelativeVolume),
+                               mRelativeVolumeCurve.ConvertScalarToRaw(theClient.mRelativeVolume / 4));
+        theAppVolume.AddSInt32(CFSTR(kBGMAppVolumesKey_PanPosition),
+                               theClient.mPanPosition);
+        
+        theAppVolumes.AppendDictionary(theAppVolume.GetDict());
+    }
+    
+    return theAppVolumes;
+}
+
 bool    BGM_Clients::SetClientsRelativeVolumes(const CACFArray inAppVolumes)
 {
     bool didChangeAppVolumes = false;
@@ -342,10 +402,8 @@ bool    BGM_Clients::SetClientsRelativeVolumes(const CACFArray inAppVolumes)
 
             if (didGetVolume) {
                 // Apply the volume curve to the raw volume
-                //
-                // mRelativeVolumeCurve uses the default kPow2Over1Curve transfer function, so we also multiply by 4 to
-                // keep the middle volume equal to 1 (meaning apps' volumes are unchanged by default).
-                Float32 theRelativeVolume = mRelativeVolumeCurve.ConvertRawToScalar(theRawRelativeVolume) * 4;
+                Float32 theRelativeVolume =
+                        BGM_PackedAppVolumes::RelativeVolumeFromRaw(mRelativeVolumeCurve, theRawRelativeVolume);
 
                 // Try to update the client's volume, first by PID and then by bundle ID. Always try
                 // both because apps can have multiple clients.
@@ -392,3 +450,19 @@ bool    BGM_Clients::SetClientsRelativeVolumes(const CACFArray inAppVolumes)
     return didChangeAppVolumes;
 }
 
+bool    BGM_Clients::SetClientsRelativeVolumesPacked(const void* inData, size_t inDataSize)
+{
+    CAMutex::Locker theLocker(mMutex);
+    
+    mPackedAppVolumes.Decode(inData, inDataSize, mRelativeVolumeCurve, mPackedAppVolumeChanges);
+    
+    // This also records the settings of apps that aren't currently clients in the past clients.
+    return mClientMap.SetClientsVolumesAndPans(mPackedAppVolumeChanges);
+}
+
+UInt32  BGM_Clients::GetPackedAppVolumesSessionID() const
+{
+    CAMutex::Locker theLocker(mMutex);
+    return mPackedAppVolumes.GetSessionID();
+}
+
@@ -26,6 +26,7 @@
 // Local Includes
 #include "BGM_Client.h"
 #include "BGM_ClientMap.h"
+#include "BGM_PackedAppVolumes.h"
 
 // PublicUtility Includes
 #include "CAVolumeCurve.h"
@@ -96,11 +97,13 @@ public:
     
     Float32                             GetClientRelativeVolumeRT(UInt32 inClientID) const;
     SInt32                              GetClientPanPositionRT(UInt32 inClientID) const;
+    // Returns the client's BGM_Client::mDSPSlot, or -1 if the client isn't found.
+    SInt32                              GetClientDSPSlotRT(UInt32 inClientID) const;
     
     // Copies the current and past clients into an array in the format expected for
     // kAudioDeviceCustomPropertyAppVolumes. (Except that CACFArray and CACFDictionary are used instead
     // of unwrapped CFArray and CFDictionary refs.)
-    CACFArray                           CopyClientRelativeVolumesAsAppVolumes() const { return mClientMap.CopyClientRelativeVolumesAsAppVolumes(mRelativeVolumeCurve); };
+    CACFArray                           CopyClientRelativeVolumesAsAppVolumes() const;
     
     // inAppVolumes is an array of dicts with the keys kBGMAppVolumesKey_ProcessID,
     // kBGMAppVolumesKey_BundleID and optionally kBGMAppVolumesKey_RelativeVolume and
@@ -110,6 +113,31 @@ public:
     // Returns true if any clients' relative volumes were changed.
     bool                                SetClientsRelativeVolumes(const CACFArray inAppVolumes);
     
+    // Makes the same changes as SetClientsRelativeVolumes, but from a value of
+    // kAudioDeviceCustomPropertyAppVolumesPacked and all in a single update of the client map. Throws
+    // BGM_InvalidClientRelativeVolumeException, without changing anything, if the value is invalid.
+    //
+    // Returns true if any clients' relative volumes or pan positions were changed.
+    bool                                SetClientsRelativeVolumesPacked(const void* inData, size_t inDataSize);
+    // The session ID of the last valid kAudioDeviceCustomPropertyAppVolumesPacked value, or 0.
+    UInt32                              GetPackedAppVolumesSessionID() const;
+    
+    // Sets the DSP slot of the clients for the app with PID inAppPID or bundle ID inAppBundleID.
+    // Either ID can be omitted by passing -1 or an invalid string. Returns true if any were found.
+    bool                                SetClientsDSPSlot(pid_t inAppPID,
+                                                          const BGM_String& inAppBundleID,
+                                                          SInt32 inDSPSlot);
+    
+    // The apps' relative volumes and pan positions, for BGM_Device to save. See
+    // BGM_ClientMap::CopyClientsForStorage.
+    std::vector<BGM_Client>             CopyClientsForStorage() const { return mClientMap.CopyClientsForStorage(); }
+    // Restores the settings BGM_Device saved, so they're applied to the apps' clients when they're
+    // added. See BGM_ClientMap::RestorePastClients.
+    void                                RestorePastClients(const std::vector<BGM_Client>& inClients) { mClientMap.RestorePastClients(inClients); }
+    
+    // Sets the mPastClients fields of outStats. See BGM_ClientMap::GetPastClientStats.
+    void                                GetPastClientStats(BGMDeviceIOStats& outStats) const { mClientMap.GetPastClientStats(outStats); }
+    
 private:
     AudioObjectID                       mOwnerDeviceID;
     BGM_ClientMap                       mClientMap;
@@ -139,10 +167,20 @@ private:
     // because there might be no client with that bundle ID. In that case we need to be able to give the
     // property's value if the HAL asks for it, and to recognise the music player if it's added a client.
     CACFString                          mMusicPlayerBundleIDProperty { "" };
+    // mMusicPlayerBundleIDProperty's token in mClientMap, or BGM_BundleIDTable::kNoBundleID if it's unset.
+    UInt32                              mMusicPlayerBundleIDToken = BGM_BundleIDTable::kNoBundleID;
+    
+    // BGMApp's bundle ID token in mClientMap.
+    UInt32                              mBGMAppBundleIDToken = BGM_BundleIDTable::kNoBundleID;
     
     // The volume curve we apply to raw client volumes before they're used
     CAVolumeCurve                       mRelativeVolumeCurve;
     
+    // The bundle ID tokens for kAudioDeviceCustomPropertyAppVolumesPacked and a buffer for the changes
+    // decoded from it, which is kept to avoid reallocating it. Guarded by mMutex.
+    BGM_PackedAppVolumes                mPackedAppVolumes;
+    std::vector<BGM_ClientMap::AppVolumeChange> mPackedAppVolumeChanges;
+    
 };
 
 #pragma clang assume_nonnull end
@@ -0,0 +1,219 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_PackedAppVolumes.cpp
+//  BGMDriver
+//
+//  Copyright © 2026 Kyle Neideck
+//
+
+// Self Include
+#include "BGM_PackedAppVolumes.h"
+
+// Local Includes
+#include "BGM_Types.h"
+
+// PublicUtility Includes
+#include "CADebugMacros.h"
+
+// STL Includes
+#include <bitset>
+#include <cstring>
+#include <string>
+#include <utility>
+
+
+#pragma clang assume_nonnull begin
+
+void BGM_PackedAppVolumes::Decode(const void* inData,
+                                  size_t inDataSize,
+                                  const CAVolumeCurve& inRelativeVolumeCurve,
+                                  std::vector<BGM_ClientMap::AppVolumeChange>& outChanges)
+{
+    const UInt8* theBytes = static_cast<const UInt8*>(inData);
+
+    BGMAppVolumesPackedHeader theHeader;
+
+    ThrowIf(inDataSize < sizeof(theHeader),
+            BGM_InvalidClientRelativeVolumeException(),
+            "BGM_PackedAppVolumes::Decode: Too small for the header");
+
+    memcpy(&theHeader, theBytes, sizeof(theHeader));
+
+    ThrowIf(theHeader.mVersion != kBGMAppVolumesPackedVersion,
+            BGM_InvalidClientRelativeVolumeException(),
+            "BGM_PackedAppVolumes::Decode: Unknown version");
+    ThrowIf(theHeader.mRecordCount > kBGMAppVolumesPackedMaxRecords ||
+                    theHeader.mBundleIDCount > kBGMAppVolumesPackedMaxTokens,
+            BGM_InvalidClientRelativeVolumeException(),
+            "BGM_PackedAppVolumes::Decode: Too many records or bundle IDs");
+
+    const size_t theRecordsSize = theHeader.mRecordCount * sizeof(BGMAppVolumesPackedRecord);
+
+    ThrowIf(inDataSize - sizeof(theHeader) < theRecordsSize,
+            BGM_InvalidClientRelativeVolumeException(),
+            "BGM_PackedAppVolumes::Decode: Too small for the records");
+
+    const UInt8* theRecords = theBytes + sizeof(theHeader);
+
+    // Read the definitions into CF strings before changing anything, so invalid UTF-8 is caught.
+    // These are the only CF objects Decode creates.
+    std::vector<std::pair<UInt32, BGM_String>> theDefinitions;
+    std::bitset<kBGMAppVolumesPackedMaxTokens> theDefinedTokens;
+
+    if(theHeader.mBundleIDCount > 0)
+    {
+        theDefinitions.reserve(theHeader.mBundleIDCount);
+    }
+
+    const UInt8* theCursor = theRecords + theRecordsSize;
+    size_t theRemaining = inDataSize - sizeof(theHeader) - theRecordsSize;
+
+    for(UInt32 i = 0; i < theHeader.mBundleIDCount; i++)
+    {
+        BGMAppVolumesPackedBundleID theDefinition;
+
+        ThrowIf(theRemaining < sizeof(theDefinition),
+                BGM_InvalidClientRelativeVolumeException(),
+                "BGM_PackedAppVolumes::Decode: Truncated bundle ID definition");
+
+        memcpy(&theDefinition, theCursor, sizeof(theDefinition));
+        theCursor += sizeof(theDefinition);
+        theRemaining -= sizeof(theDefinition);
+
+        ThrowIf(theDefinition.mToken >= kBGMAppVolumesPackedMaxTokens ||
+                        theDefinition.mLength == 0 ||
+                        theDefinition.mLength > kBGMAppVolumesPackedMaxBundleIDLength ||
+                        theRemaining < theDefinition.mLength,
+                BGM_InvalidClientRelativeVolumeException(),
+                "BGM_PackedAppVolumes::Decode: Invalid bundle ID definition");
+
+        // BGM_StringFromUTF8 would stop at a null byte.
+        ThrowIf(memchr(theCursor, 0, theDefinition.mLength) != nullptr,
+                BGM_InvalidClientRelativeVolumeException(),
+                "BGM_PackedAppVolumes::Decode: Bundle ID contains a null byte");
+
+        BGM_String theBundleID =
+                BGM_StringFromUTF8(std::string(reinterpret_cast<const char*>(theCursor),
+                                               theDefinition.mLength));
+
+        ThrowIf(!theBundleID.IsValid(),
+                BGM_InvalidClientRelativeVolumeException(),
+                "BGM_PackedAppVolumes::Decode: Bundle ID is not valid UTF-8");
+
+        theDefinitions.emplace_back(theDefinition.mToken, theBundleID);
+        theDefinedTokens.set(theDefinition.mToken);
+
+        theCursor += theDefinition.mLength;
+        theRemaining -= theDefinition.mLength;
+    }
+
+    ThrowIf(theRemaining != 0,
+            BGM_InvalidClientRelativeVolumeException(),
+            "BGM_PackedAppVolumes::Decode: Trailing bytes");
+
+    // A new session means the sender has forgotten its earlier definitions, so forget them too.
+    const bool theSessionChanged = (theHeader.mSessionID != mSessionID);
+
+    auto theTokenIsDefined = [&] (UInt32 inToken) {
+        return theDefinedTokens.test(inToken) ||
+                (!theSessionChanged && inToken < mBundleIDs.size() && mBundleIDs[inToken].IsValid());
+    };
+
+    for(UInt32 i = 0; i < theHeader.mRecordCount; i++)
+    {
+        BGMAppVolumesPackedRecord theRecord;
+        memcpy(&theRecord, theRecords + i * sizeof(theRecord), sizeof(theRecord));
+
+        const UInt32 theKnownFields =
+                kBGMAppVolumesPackedField_RelativeVolume | kBGMAppVolumesPackedField_PanPosition;
+        const bool theSetsVolume = (theRecord.mFields & kBGMAppVolumesPackedField_RelativeVolume) != 0;
+        const bool theSetsPan = (theRecord.mFields & kBGMAppVolumesPackedField_PanPosition) != 0;
+        const bool theHasBundleID = (theRecord.mBundleIDToken != kBGMAppVolumesPackedNoBundleID);
+
+        ThrowIf(theRecord.mFields == 0 || (theRecord.mFields & ~theKnownFields) != 0 ||
+                        theRecord.mFlags != 0,
+                BGM_InvalidClientRelativeVolumeException(),
+                "BGM_PackedAppVolumes::Decode: Invalid fields or flags");
+        ThrowIf(theRecord.mProcessID < -1 || (theRecord.mProcessID == -1 && !theHasBundleID),
+                BGM_InvalidClientRelativeVolumeException(),
+                "BGM_PackedAppVolumes::Decode: No PID or bundle ID");
+        ThrowIf(theSetsVolume && (theRecord.mRelativeVolume < kAppRelativeVolumeMinRawValue ||
+                                  theRecord.mRelativeVolume > kAppRelativeVolumeMaxRawValue),
+                BGM_InvalidClientRelativeVolumeException(),
+                "BGM_PackedAppVolumes::Decode: Relative volume out of range");
+        ThrowIf(theSetsPan && (theRecord.mPanPosition < kAppPanLeftRawValue ||
+                               theRecord.mPanPosition > kAppPanRightRawValue),
+                BGM_InvalidClientRelativeVolumeException(),
+                "BGM_PackedAppVolumes::Decode: Pan position out of range");
+        ThrowIf(theHasBundleID && (theRecord.mBundleIDToken >= kBGMAppVolumesPackedMaxTokens ||
+                                   !theTokenIsDefined(theRecord.mBundleIDToken)),
+                BGM_InvalidClientRelativeVolumeException(),
+                "BGM_PackedAppVolumes::Decode: Undefined bundle ID token");
+    }
+
+    // The value is valid, so commit the definitions.
+    if(theSessionChanged)
+    {
+        mBundleIDs.clear();
+        mSessionID = theHeader.mSessionID;
+    }
+
+    for(auto& theDefinition : theDefinitions)
+    {
+        if(theDefinition.first >= mBundleIDs.size())
+        {
+            mBundleIDs.resize(theDefinition.first + 1);
+        }
+
+        mBundleIDs[theDefinition.first] = std::move(theDefinition.second);
+    }
+
+    // Only resolve the bundle IDs now that mBundleIDs won't be resized again.
+    outChanges.clear();
+
+    for(UInt32 i = 0; i < theHeader.mRecordCount; i++)
+    {
+        BGMAppVolumesPackedRecord theRecord;
+        memcpy(&theRecord, theRecords + i * sizeof(theRecord), sizeof(theRecord));
+
+        BGM_ClientMap::AppVolumeChange theChange;
+        theChange.mProcessID = theRecord.mProcessID;
+
+        if(theRecord.mBundleIDToken != kBGMAppVolumesPackedNoBundleID)
+        {
+            theChange.mBundleID = &mBundleIDs[theRecord.mBundleIDToken];
+        }
+
+        if((theRecord.mFields & kBGMAppVolumesPackedField_RelativeVolume) != 0)
+        {
+            theChange.mSetsRelativeVolume = true;
+            theChange.mRelativeVolume = RelativeVolumeFromRaw(inRelativeVolumeCurve,
+                                                              theRecord.mRelativeVolume);
+        }
+
+        if((theRecord.mFields & kBGMAppVolumesPackedField_PanPosition) != 0)
+        {
+            theChange.mSetsPanPosition = true;
+            theChange.mPanPosition = theRecord.mPanPosition;
+        }
+
+        outChanges.push_back(theChange);
+    }
+}
+
+#pragma clang assume_nonnull end
+
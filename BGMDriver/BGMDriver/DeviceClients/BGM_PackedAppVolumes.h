@@ -0,0 +1,98 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_PackedAppVolumes.h
+//  BGMDriver
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  Decodes values of kAudioDeviceCustomPropertyAppVolumesPacked (see BGM_Types.h) into changes for
+//  BGM_ClientMap::SetClientsVolumesAndPans and keeps the bundle IDs the sender has defined tokens
+//  for.
+//
+//  Records are read straight from the property's bytes, so the only CF objects created are the
+//  bundle IDs in definitions, which BGMApp only sends the first time it changes each app's volume.
+//
+
+#ifndef BGMDriver__BGM_PackedAppVolumes
+#define BGMDriver__BGM_PackedAppVolumes
+
+// Local Includes
+#include "BGM_ClientMap.h"
+#include "BGM_Platform.h"
+
+// PublicUtility Includes
+#include "CAVolumeCurve.h"
+
+// STL Includes
+#include <vector>
+
+// System Includes
+#include <MacTypes.h>
+
+
+#pragma clang assume_nonnull begin
+
+class BGM_PackedAppVolumes
+{
+
+public:
+    /*!
+     Decode a value of kAudioDeviceCustomPropertyAppVolumesPacked. The whole value is validated
+     before anything is changed, so if this throws, the bundle ID definitions are unchanged.
+
+     Not thread-safe.
+
+     @param inRelativeVolumeCurve Applied to the raw relative volumes. See RelativeVolumeFromRaw.
+     @param outChanges Replaced with one change per record. Their bundle IDs point into this
+                       object, so they're only valid until Decode is called again.
+     @throws BGM_InvalidClientRelativeVolumeException If the value is invalid, which includes
+                                                      using a token that hasn't been defined.
+     */
+    void                                    Decode(const void* inData,
+                                                   size_t inDataSize,
+                                                   const CAVolumeCurve& inRelativeVolumeCurve,
+                                                   std::vector<BGM_ClientMap::AppVolumeChange>& outChanges);
+
+    /*! @return The session ID of the last valid value decoded, or 0 if there hasn't been one. */
+    UInt32                                  GetSessionID() const { return mSessionID; }
+
+    /*!
+     Apply the volume curve to a relative volume from kAudioDeviceCustomPropertyAppVolumes or
+     kAudioDeviceCustomPropertyAppVolumesPacked.
+
+     inRelativeVolumeCurve is expected to use the default kPow2Over1Curve transfer function, so
+     this also multiplies by 4 to keep the middle volume equal to 1, meaning apps' volumes are
+     unchanged by default.
+     */
+    static Float32                          RelativeVolumeFromRaw(const CAVolumeCurve& inRelativeVolumeCurve,
+                                                                  SInt32 inRawRelativeVolume)
+    {
+        return inRelativeVolumeCurve.ConvertRawToScalar(inRawRelativeVolume) * 4;
+    }
+
+private:
+    UInt32                                  mSessionID = 0;
+    // The bundle IDs the sender has defined tokens for, indexed by token. Invalid for tokens it
+    // hasn't defined.
+    std::vector<BGM_String>                 mBundleIDs;
+
+};
+
+#pragma clang assume_nonnull end
+
+#endif /* BGMDriver__BGM_PackedAppVolumes */
+
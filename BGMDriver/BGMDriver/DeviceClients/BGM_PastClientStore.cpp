@@ -0,0 +1,170 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_PastClientStore.cpp
+//  BGMDriver
+//
+//  Copyright © 2026 Kyle Neideck
+//
+
+// Self Include
+#include "BGM_PastClientStore.h"
+
+
+#pragma clang assume_nonnull begin
+
+const UInt32 BGM_PastClientStore::kDefaultCapacity;
+const UInt32 BGM_PastClientStore::kNoSlot;
+
+BGM_PastClientStore::BGM_PastClientStore(UInt32 inCapacity)
+:
+    mCapacity(inCapacity)
+{
+}
+
+const BGM_PastClientStore::Record* __nullable BGM_PastClientStore::Find(UInt32 inBundleIDToken)
+{
+    if(inBundleIDToken >= mSlotsByToken.size() || mSlotsByToken[inBundleIDToken] == kNoSlot)
+    {
+        return nullptr;
+    }
+
+    UInt32 theSlot = mSlotsByToken[inBundleIDToken];
+
+    Unlink(theSlot);
+    PushFront(theSlot);
+
+    return &mSlots[theSlot].mRecord;
+}
+
+UInt32  BGM_PastClientStore::Set(UInt32 inBundleIDToken,
+                                 Float32 inRelativeVolume,
+                                 SInt32 inPanPosition,
+                                 bool inUserSet)
+{
+    UInt32 theEvictedToken = BGM_BundleIDTable::kNoBundleID;
+
+    if(inBundleIDToken == BGM_BundleIDTable::kNoBundleID || mCapacity == 0)
+    {
+        return theEvictedToken;
+    }
+
+    if(inBundleIDToken >= mSlotsByToken.size())
+    {
+        mSlotsByToken.resize(inBundleIDToken + 1, kNoSlot);
+    }
+
+    UInt32 theSlot = mSlotsByToken[inBundleIDToken];
+
+    if(theSlot != kNoSlot)
+    {
+        // Unlink it first because setting the flag can move it to the other list.
+        Unlink(theSlot);
+    }
+    else if(mSlots.size() < mCapacity)
+    {
+        theSlot = static_cast<UInt32>(mSlots.size());
+        mSlots.push_back(Slot());
+        mSize++;
+    }
+    else
+    {
+        // Full, so reuse the least recently used record's slot, unless the user set it and there
+        // are records they didn't set.
+        List& theEvictionList = (mLists[0].mTail != kNoSlot) ? mLists[0] : mLists[1];
+        theSlot = theEvictionList.mTail;
+
+        Unlink(theSlot);
+        theEvictedToken = mSlots[theSlot].mRecord.mBundleIDToken;
+        mSlotsByToken[theEvictedToken] = kNoSlot;
+        mEvictionCount++;
+    }
+
+    Record& theRecord = mSlots[theSlot].mRecord;
+    const bool theWasUserSet = (mSlotsByToken[inBundleIDToken] == theSlot) &&
+            (theRecord.mFlags & kFlag_UserSet) != 0;
+
+    theRecord.mBundleIDToken = inBundleIDToken;
+    theRecord.mRelativeVolume = inRelativeVolume;
+    theRecord.mPanPosition = inPanPosition;
+    theRecord.mFlags = (inUserSet || theWasUserSet) ? static_cast<UInt32>(kFlag_UserSet) : 0;
+
+    mSlotsByToken[inBundleIDToken] = theSlot;
+    PushFront(theSlot);
+
+    return theEvictedToken;
+}
+
+void    BGM_PastClientStore::ForEach(const std::function<void(const Record&)>& inFunction) const
+{
+    for(const List& theList : mLists)
+    {
+        for(UInt32 theSlot = theList.mHead; theSlot != kNoSlot; theSlot = mSlots[theSlot].mNext)
+        {
+            inFunction(mSlots[theSlot].mRecord);
+        }
+    }
+}
+
+void    BGM_PastClientStore::Unlink(UInt32 inSlot)
+{
+    Slot& theSlot = mSlots[inSlot];
+    List& theList = mLists[ListIndex(theSlot.mRecord)];
+
+    if(theSlot.mPrevious != kNoSlot)
+    {
+        mSlots[theSlot.mPrevious].mNext = theSlot.mNext;
+    }
+    else
+    {
+        theList.mHead = theSlot.mNext;
+    }
+
+    if(theSlot.mNext != kNoSlot)
+    {
+        mSlots[theSlot.mNext].mPrevious = theSlot.mPrevious;
+    }
+    else
+    {
+        theList.mTail = theSlot.mPrevious;
+    }
+
+    theSlot.mPrevious = kNoSlot;
+    theSlot.mNext = kNoSlot;
+}
+
+void    BGM_PastClientStore::PushFront(UInt32 inSlot)
+{
+    Slot& theSlot = mSlots[inSlot];
+    List& theList = mLists[ListIndex(theSlot.mRecord)];
+
+    theSlot.mPrevious = kNoSlot;
+    theSlot.mNext = theList.mHead;
+
+    if(theList.mHead != kNoSlot)
+    {
+        mSlots[theList.mHead].mPrevious = inSlot;
+    }
+    else
+    {
+        theList.mTail = inSlot;
+    }
+
+    theList.mHead = inSlot;
+}
+
+#pragma clang assume_nonnull end
+
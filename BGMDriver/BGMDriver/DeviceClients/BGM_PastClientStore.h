@@ -0,0 +1,151 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_PastClientStore.h
+//  BGMDriver
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  The settings BGM_ClientMap restores when a client is added with a bundle ID it has seen before.
+//  One compact record per bundle ID token (see BGM_BundleIDTable).
+//
+//  The store holds at most a fixed number of records. When it's full, adding a record evicts the
+//  least recently used one, preferring records whose settings the user hasn't changed, so machines
+//  that run thousands of short-lived command-line tools don't lose the settings of the apps the
+//  user actually set.
+//
+//  Finding, setting and evicting records are all constant time. The records live in a fixed pool
+//  and are kept in two doubly-linked lists (one for records the user has set and one for the rest)
+//  in order of use, linked by index rather than by pointer.
+//
+//  Not thread-safe. BGM_ClientMap only uses it while holding its shadow maps mutex.
+//
+
+#ifndef BGMDriver__BGM_PastClientStore
+#define BGMDriver__BGM_PastClientStore
+
+// Local Includes
+#include "BGM_BundleIDTable.h"
+
+// STL Includes
+#include <functional>
+#include <vector>
+
+// System Includes
+#include <MacTypes.h>
+
+
+#pragma clang assume_nonnull begin
+
+class BGM_PastClientStore
+{
+
+public:
+    static const UInt32                 kDefaultCapacity = 512;
+
+    enum : UInt32
+    {
+        // The record's settings were set by the user (e.g. through kAudioDeviceCustomPropertyAppVolumes)
+        // rather than only recorded when a client was added or removed.
+        kFlag_UserSet                   = 1 << 0
+    };
+
+    struct Record
+    {
+        UInt32                          mBundleIDToken;
+        Float32                         mRelativeVolume;
+        SInt32                          mPanPosition;
+        UInt32                          mFlags;
+    };
+
+                                        BGM_PastClientStore(UInt32 inCapacity = kDefaultCapacity);
+
+    /*!
+     @return The record for inBundleIDToken, or null if there isn't one. Marks the record as the most
+             recently used. The pointer is only valid until the store is next changed.
+     */
+    const Record* __nullable            Find(UInt32 inBundleIDToken);
+
+    /*! @return True if there's a record for inBundleIDToken. Unlike Find, doesn't mark it as used. */
+    bool                                Contains(UInt32 inBundleIDToken) const
+    {
+        return inBundleIDToken < mSlotsByToken.size() && mSlotsByToken[inBundleIDToken] != kNoSlot;
+    }
+
+    /*!
+     Add or replace the record for inBundleIDToken and mark it as the most recently used. Evicts the
+     least recently used record if the store is full. Does nothing for BGM_BundleIDTable::kNoBundleID.
+
+     @param inUserSet True if the user set the settings. Once a record has kFlag_UserSet it keeps it.
+     @return The token of the record that was evicted, or BGM_BundleIDTable::kNoBundleID if none was.
+     */
+    UInt32                              Set(UInt32 inBundleIDToken,
+                                            Float32 inRelativeVolume,
+                                            SInt32 inPanPosition,
+                                            bool inUserSet);
+
+    /*! Call inFunction for each record, in no particular order. */
+    void                                ForEach(const std::function<void(const Record&)>& inFunction) const;
+
+    UInt32                              GetSize() const { return mSize; }
+    UInt32                              GetCapacity() const { return mCapacity; }
+    /*! @return The number of records that have been evicted to make room for others. */
+    UInt64                              GetEvictionCount() const { return mEvictionCount; }
+
+private:
+    static const UInt32                 kNoSlot = 0xFFFFFFFF;
+
+    struct Slot
+    {
+        Record                          mRecord;
+        UInt32                          mPrevious;
+        UInt32                          mNext;
+    };
+
+    // The most and least recently used records in one of the lists. Index 0 is for records without
+    // kFlag_UserSet and index 1 for records with it.
+    struct List
+    {
+        UInt32                          mHead = kNoSlot;
+        UInt32                          mTail = kNoSlot;
+    };
+
+    static UInt32                       ListIndex(const Record& inRecord)
+    {
+        return (inRecord.mFlags & kFlag_UserSet) != 0 ? 1 : 0;
+    }
+
+    void                                Unlink(UInt32 inSlot);
+    void                                PushFront(UInt32 inSlot);
+
+    UInt32                              mCapacity;
+    UInt32                              mSize = 0;
+    UInt64                              mEvictionCount = 0;
+
+    // Only grows, up to mCapacity. Slots are reused after evictions.
+    std::vector<Slot>                   mSlots;
+    List                                mLists[2];
+    // The slot holding each token's record, indexed by token. Tokens are dense and reused once
+    // they're released, so this grows with the number of bundle IDs interned at once rather than with
+    // the tokens' values.
+    std::vector<UInt32>                 mSlotsByToken;
+
+};
+
+#pragma clang assume_nonnull end
+
+#endif /* BGMDriver__BGM_PastClientStore */
+
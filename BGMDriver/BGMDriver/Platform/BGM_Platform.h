@@ -0,0 +1,221 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_Platform.h
+//  BGMDriver
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  The few OS services the driver's core (the IO kernels, client map, task queue and ring
+//  buffers) needs: semaphores, worker threads with real-time priority, host time and strings.
+//
+//  The driver itself only ever runs on macOS, so BGM_Platform_Mach.cpp is the real
+//  implementation. BGM_Platform_POSIX.cpp lets the core build as bgm_core (see CMakeLists.txt)
+//  on other systems, e.g. for running the benchmarks on Linux CI machines. The stand-ins for the
+//  Apple headers the core includes are in POSIXHeaders.
+//
+
+#ifndef BGMDriver__BGM_Platform
+#define BGMDriver__BGM_Platform
+
+#if defined(__APPLE__) && defined(__MACH__)
+    #define BGM_PLATFORM_MACH 1
+#else
+    #define BGM_PLATFORM_MACH 0
+#endif
+
+// PublicUtility Includes
+#if BGM_PLATFORM_MACH
+#include "CACFString.h"
+#include "CAPThread.h"
+#endif
+
+// STL Includes
+#include <string>
+
+// System Includes
+#include <MacTypes.h>
+#if BGM_PLATFORM_MACH
+#include <mach/semaphore.h>
+#else
+#include <CoreFoundation/CFBase.h>
+#include <pthread.h>
+#endif
+
+
+#pragma clang assume_nonnull begin
+
+#pragma mark Host Time
+
+namespace BGM_Platform
+{
+    // The current time in host ticks. The same clock as mHostTime in AudioTimeStamps.
+    UInt64      GetCurrentHostTime();
+
+    Float64     GetHostClockFrequency();  // Ticks per second
+
+    UInt64      ConvertNanosToHostTime(UInt64 inNanos);
+    UInt64      ConvertHostTimeToNanos(UInt64 inHostTime);
+}
+
+#pragma mark Threads
+
+namespace BGM_Platform
+{
+    // A number that identifies the calling thread. Never 0. Real-time safe.
+    UInt64      GetCurrentThreadID();
+}
+
+#pragma mark BGM_Semaphore
+
+//==================================================================================================
+//	BGM_Semaphore
+//
+//  A counting semaphore that starts at zero. On macOS this is a Mach semaphore, so Signal and
+//  SignalAll are real-time safe. The POSIX version uses a mutex and condition variable, so it
+//  isn't strictly, but there's no real-time IO thread to protect there.
+//==================================================================================================
+
+class BGM_Semaphore
+{
+
+public:
+                                BGM_Semaphore();
+                                ~BGM_Semaphore();
+                                // Disallow copying
+                                BGM_Semaphore(const BGM_Semaphore&) = delete;
+                                BGM_Semaphore& operator=(const BGM_Semaphore&) = delete;
+
+    void                        Signal();
+    // Wakes every thread currently waiting. Doesn't change the count if none are.
+    void                        SignalAll();
+    void                        Wait();
+    // Returns false if the timeout expired before the semaphore was signalled.
+    bool                        TimedWait(UInt64 inTimeoutNs);
+
+private:
+#if BGM_PLATFORM_MACH
+    semaphore_t                 mSemaphore;
+#else
+    pthread_mutex_t             mMutex;
+    pthread_cond_t              mCondition;
+    UInt64                      mCount = 0;
+    UInt64                      mWaiters = 0;
+#endif
+
+};
+
+#pragma mark BGM_Thread
+
+//==================================================================================================
+//	BGM_Thread
+//
+//  A worker thread, either with the default priority or with real-time priority. The real-time
+//  parameters are the same as thread_time_constraint_policy's, but in nanoseconds. On macOS
+//  this wraps CAPThread. On other systems the thread asks for SCHED_FIFO, which usually needs
+//  extra privileges, and just runs with the default policy if it doesn't get it.
+//==================================================================================================
+
+class BGM_Thread
+{
+
+public:
+    typedef void* __nullable    (*ThreadRoutine)(void* inParameter);
+
+                                // A thread with the default priority
+                                BGM_Thread(ThreadRoutine inThreadRoutine, void* inParameter);
+                                // A real-time thread
+                                BGM_Thread(ThreadRoutine inThreadRoutine,
+                                           void* inParameter,
+                                           UInt64 inPeriodNs,
+                                           UInt64 inComputationNs,
+                                           UInt64 inConstraintNs,
+                                           bool inIsPreemptible);
+                                ~BGM_Thread();
+                                // Disallow copying
+                                BGM_Thread(const BGM_Thread&) = delete;
+                                BGM_Thread& operator=(const BGM_Thread&) = delete;
+
+    void                        Start();
+
+    bool                        IsCurrentThread() const;
+    // True if the thread is actually running with real-time priority. (It might have asked for it
+    // and been refused.)
+    bool                        IsRealTime() const;
+
+private:
+#if BGM_PLATFORM_MACH
+    CAPThread                   mThread;
+#else
+    static void* __nullable     Entry(void* inThread);
+
+    ThreadRoutine               mThreadRoutine;
+    void*                       mParameter;
+    bool                        mWantsRealTime;
+    pthread_t                   mThread;
+    bool                        mStarted = false;
+    volatile bool               mIsRealTime = false;
+#endif
+
+};
+
+#pragma mark BGM_String
+
+#if BGM_PLATFORM_MACH
+
+// Strings we get from the host, i.e. bundle IDs.
+typedef CACFString BGM_String;
+
+#else
+
+//==================================================================================================
+//	BGM_String
+//
+//  The subset of CACFString's interface the core uses, over a UTF-8 std::string. CFStringRef is
+//  const char* in POSIXHeaders. Unlike CACFString, it copies the string when it's constructed.
+//==================================================================================================
+
+class BGM_String
+{
+
+public:
+                                BGM_String() : mIsValid(false) { }
+                                BGM_String(CFStringRef __nullable inString) : mString(inString ? inString : ""), mIsValid(inString != NULL) { }
+
+    bool                        IsValid() const { return mIsValid; }
+    CFStringRef __nullable      GetCFString() const { return mIsValid ? mString.c_str() : NULL; }
+
+    bool                        operator<(const BGM_String& inOther) const { return mString < inOther.mString; }
+    bool                        operator==(const BGM_String& inOther) const { return mString == inOther.mString; }
+    bool                        operator!=(const BGM_String& inOther) const { return !(*this == inOther); }
+
+private:
+    std::string                 mString;
+    bool                        mIsValid;
+
+};
+
+#endif /* BGM_PLATFORM_MACH */
+
+// Convert bundle IDs to and from UTF-8, e.g. to save them. An invalid BGM_String converts to the empty
+// string and the empty string converts to an invalid BGM_String.
+std::string                     BGM_StringToUTF8(const BGM_String& inString);
+BGM_String                      BGM_StringFromUTF8(const std::string& inString);
+
+#pragma clang assume_nonnull end
+
+#endif /* BGMDriver__BGM_Platform */
+
@@ -0,0 +1,231 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_Platform_Mach.cpp
+//  BGMDriver
+//
+//  Copyright © 2026 Kyle Neideck
+//
+
+// Self Include
+#include "BGM_Platform.h"
+
+#if BGM_PLATFORM_MACH
+
+// Local Includes
+#include "BGM_Utils.h"
+
+// PublicUtility Includes
+#include "CAException.h"
+#include "CADebugMacros.h"
+
+// STL Includes
+#include <vector>
+
+// System Includes
+#include <CoreAudio/AudioHardwareBase.h>
+#include <mach/mach_init.h>
+#include <mach/mach_time.h>
+#include <mach/semaphore.h>
+#include <mach/task.h>
+#include <pthread.h>
+
+
+#pragma clang assume_nonnull begin
+
+#pragma mark Host Time
+
+static const mach_timebase_info_data_t& BGM_GetTimebaseInfo()
+{
+    static mach_timebase_info_data_t sTimebaseInfo = [] {
+        mach_timebase_info_data_t theTimebaseInfo;
+        mach_timebase_info(&theTimebaseInfo);
+        return theTimebaseInfo;
+    }();
+
+    return sTimebaseInfo;
+}
+
+namespace BGM_Platform
+{
+    UInt64 GetCurrentHostTime()
+    {
+        return mach_absolute_time();
+    }
+
+    Float64 GetHostClockFrequency()
+    {
+        const mach_timebase_info_data_t& theTimebaseInfo = BGM_GetTimebaseInfo();
+        return (static_cast<Float64>(theTimebaseInfo.denom) / theTimebaseInfo.numer) * NSEC_PER_SEC;
+    }
+
+    UInt64 ConvertNanosToHostTime(UInt64 inNanos)
+    {
+        const mach_timebase_info_data_t& theTimebaseInfo = BGM_GetTimebaseInfo();
+        return static_cast<UInt64>(inNanos * (static_cast<Float64>(theTimebaseInfo.denom) / theTimebaseInfo.numer));
+    }
+
+    UInt64 ConvertHostTimeToNanos(UInt64 inHostTime)
+    {
+        const mach_timebase_info_data_t& theTimebaseInfo = BGM_GetTimebaseInfo();
+        return static_cast<UInt64>(inHostTime * (static_cast<Float64>(theTimebaseInfo.numer) / theTimebaseInfo.denom));
+    }
+}
+
+#pragma mark Threads
+
+namespace BGM_Platform
+{
+    UInt64 GetCurrentThreadID()
+    {
+        UInt64 theThreadID = 0;
+        // This can only fail if the thread passed is invalid.
+        pthread_threadid_np(NULL, &theThreadID);
+        return theThreadID;
+    }
+}
+
+#pragma mark BGM_Semaphore
+
+BGM_Semaphore::BGM_Semaphore()
+{
+    kern_return_t theError = semaphore_create(mach_task_self(), &mSemaphore, SYNC_POLICY_FIFO, 0);
+
+    BGM_Utils::ThrowIfMachError("BGM_Semaphore::BGM_Semaphore", "semaphore_create", theError);
+
+    ThrowIf(mSemaphore == SEMAPHORE_NULL,
+            CAException(kAudioHardwareUnspecifiedError),
+            "BGM_Semaphore::BGM_Semaphore: Could not create semaphore");
+}
+
+BGM_Semaphore::~BGM_Semaphore()
+{
+    kern_return_t theError = semaphore_destroy(mach_task_self(), mSemaphore);
+
+    BGM_Utils::LogIfMachError("BGM_Semaphore::~BGM_Semaphore", "semaphore_destroy", theError);
+}
+
+void    BGM_Semaphore::Signal()
+{
+    kern_return_t theError = semaphore_signal(mSemaphore);
+    BGM_Utils::ThrowIfMachError("BGM_Semaphore::Signal", "semaphore_signal", theError);
+}
+
+void    BGM_Semaphore::SignalAll()
+{
+    kern_return_t theError = semaphore_signal_all(mSemaphore);
+    BGM_Utils::ThrowIfMachError("BGM_Semaphore::SignalAll", "semaphore_signal_all", theError);
+}
+
+void    BGM_Semaphore::Wait()
+{
+    kern_return_t theError = semaphore_wait(mSemaphore);
+    BGM_Utils::ThrowIfMachError("BGM_Semaphore::Wait", "semaphore_wait", theError);
+}
+
+bool    BGM_Semaphore::TimedWait(UInt64 inTimeoutNs)
+{
+    mach_timespec_t theTimeout = {
+        static_cast<unsigned int>(inTimeoutNs / NSEC_PER_SEC),
+        static_cast<clock_res_t>(inTimeoutNs % NSEC_PER_SEC)
+    };
+
+    kern_return_t theError = semaphore_timedwait(mSemaphore, theTimeout);
+
+    if(theError == KERN_OPERATION_TIMED_OUT)
+    {
+        return false;
+    }
+
+    BGM_Utils::ThrowIfMachError("BGM_Semaphore::TimedWait", "semaphore_timedwait", theError);
+    return true;
+}
+
+#pragma mark BGM_Thread
+
+BGM_Thread::BGM_Thread(ThreadRoutine inThreadRoutine, void* inParameter)
+:
+    mThread(inThreadRoutine, inParameter)
+{
+}
+
+BGM_Thread::BGM_Thread(ThreadRoutine inThreadRoutine,
+                       void* inParameter,
+                       UInt64 inPeriodNs,
+                       UInt64 inComputationNs,
+                       UInt64 inConstraintNs,
+                       bool inIsPreemptible)
+:
+    mThread(inThreadRoutine,
+            inParameter,
+            static_cast<UInt32>(BGM_Platform::ConvertNanosToHostTime(inPeriodNs)),
+            static_cast<UInt32>(BGM_Platform::ConvertNanosToHostTime(inComputationNs)),
+            static_cast<UInt32>(BGM_Platform::ConvertNanosToHostTime(inConstraintNs)),
+            inIsPreemptible)
+{
+}
+
+BGM_Thread::~BGM_Thread()
+{
+}
+
+void    BGM_Thread::Start()
+{
+    mThread.Start();
+}
+
+bool    BGM_Thread::IsCurrentThread() const
+{
+    return mThread.IsCurrentThread();
+}
+
+bool    BGM_Thread::IsRealTime() const
+{
+    return mThread.IsTimeConstraintThread();
+}
+
+#pragma mark BGM_String
+
+std::string BGM_StringToUTF8(const BGM_String& inString)
+{
+    if(!inString.IsValid())
+    {
+        return "";
+    }
+
+    // Plus one for the null terminator CACFString::GetCString adds.
+    UInt32 theSize = inString.GetByteLength(kCFStringEncodingUTF8) + 1;
+    std::vector<char> theBytes(theSize);
+    inString.GetCString(theBytes.data(), theSize, kCFStringEncodingUTF8);
+
+    // theSize now includes the null terminator.
+    return std::string(theBytes.data(), theSize - 1);
+}
+
+BGM_String BGM_StringFromUTF8(const std::string& inString)
+{
+    if(inString.empty())
+    {
+        return BGM_String();
+    }
+
+    return BGM_String(inString.c_str(), kCFStringEncodingUTF8, true);
+}
+
+#pragma clang assume_nonnull end
+
+#endif /* BGM_PLATFORM_MACH */
+
@@ -0,0 +1,283 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_Platform_POSIX.cpp
+//  BGMDriver
+//
+//  Copyright © 2026 Kyle Neideck
+//
+
+// Self Include
+#include "BGM_Platform.h"
+
+#if !BGM_PLATFORM_MACH
+
+// PublicUtility Includes
+#include "CAException.h"
+#include "CADebugMacros.h"
+
+// System Includes
+#include <CoreAudio/AudioHardwareBase.h>
+#include <errno.h>
+#include <sched.h>
+#include <time.h>
+
+
+#pragma clang assume_nonnull begin
+
+#pragma mark Host Time
+
+// Host time is CLOCK_MONOTONIC in nanoseconds.
+
+namespace BGM_Platform
+{
+    UInt64 GetCurrentHostTime()
+    {
+        struct timespec theTime;
+        clock_gettime(CLOCK_MONOTONIC, &theTime);
+        return (static_cast<UInt64>(theTime.tv_sec) * NSEC_PER_SEC) + static_cast<UInt64>(theTime.tv_nsec);
+    }
+
+    Float64 GetHostClockFrequency()
+    {
+        return static_cast<Float64>(NSEC_PER_SEC);
+    }
+
+    UInt64 ConvertNanosToHostTime(UInt64 inNanos)
+    {
+        return inNanos;
+    }
+
+    UInt64 ConvertHostTimeToNanos(UInt64 inHostTime)
+    {
+        return inHostTime;
+    }
+}
+
+#pragma mark Threads
+
+namespace BGM_Platform
+{
+    UInt64 GetCurrentThreadID()
+    {
+        // pthread_t is an integer or a pointer on the systems we build on, and never 0 for a
+        // running thread.
+        return (UInt64)pthread_self();
+    }
+}
+
+#pragma mark BGM_Semaphore
+
+BGM_Semaphore::BGM_Semaphore()
+{
+    int theError = pthread_mutex_init(&mMutex, NULL);
+    ThrowIf(theError != 0,
+            CAException(kAudioHardwareUnspecifiedError),
+            "BGM_Semaphore::BGM_Semaphore: Could not init the mutex");
+
+    pthread_condattr_t theConditionAttributes;
+    pthread_condattr_init(&theConditionAttributes);
+    // TimedWait's deadlines are measured with the monotonic clock, so the condition has to be too.
+    pthread_condattr_setclock(&theConditionAttributes, CLOCK_MONOTONIC);
+    theError = pthread_cond_init(&mCondition, &theConditionAttributes);
+    pthread_condattr_destroy(&theConditionAttributes);
+
+    if(theError != 0)
+    {
+        pthread_mutex_destroy(&mMutex);
+        Throw(CAException(kAudioHardwareUnspecifiedError));
+    }
+}
+
+BGM_Semaphore::~BGM_Semaphore()
+{
+    pthread_cond_destroy(&mCondition);
+    pthread_mutex_destroy(&mMutex);
+}
+
+void    BGM_Semaphore::Signal()
+{
+    pthread_mutex_lock(&mMutex);
+    mCount++;
+    pthread_cond_signal(&mCondition);
+    pthread_mutex_unlock(&mMutex);
+}
+
+void    BGM_Semaphore::SignalAll()
+{
+    // Like semaphore_signal_all, only wake the threads that are already waiting.
+    pthread_mutex_lock(&mMutex);
+    if(mWaiters > mCount)
+    {
+        mCount = mWaiters;
+        pthread_cond_broadcast(&mCondition);
+    }
+    pthread_mutex_unlock(&mMutex);
+}
+
+void    BGM_Semaphore::Wait()
+{
+    pthread_mutex_lock(&mMutex);
+    mWaiters++;
+
+    while(mCount == 0)
+    {
+        pthread_cond_wait(&mCondition, &mMutex);
+    }
+
+    mWaiters--;
+    mCount--;
+    pthread_mutex_unlock(&mMutex);
+}
+
+bool    BGM_Semaphore::TimedWait(UInt64 inTimeoutNs)
+{
+    UInt64 theDeadlineNs = BGM_Platform::GetCurrentHostTime() + inTimeoutNs;
+    struct timespec theDeadline = {
+        static_cast<time_t>(theDeadlineNs / NSEC_PER_SEC),
+        static_cast<long>(theDeadlineNs % NSEC_PER_SEC)
+    };
+
+    bool didGetSignal = true;
+
+    pthread_mutex_lock(&mMutex);
+    mWaiters++;
+
+    while(mCount == 0)
+    {
+        if(pthread_cond_timedwait(&mCondition, &mMutex, &theDeadline) == ETIMEDOUT)
+        {
+            didGetSignal = (mCount != 0);
+            break;
+        }
+    }
+
+    mWaiters--;
+
+    if(didGetSignal)
+    {
+        mCount--;
+    }
+
+    pthread_mutex_unlock(&mMutex);
+
+    return didGetSignal;
+}
+
+#pragma mark BGM_Thread
+
+BGM_Thread::BGM_Thread(ThreadRoutine inThreadRoutine, void* inParameter)
+:
+    mThreadRoutine(inThreadRoutine),
+    mParameter(inParameter),
+    mWantsRealTime(false),
+    mThread()
+{
+}
+
+BGM_Thread::BGM_Thread(ThreadRoutine inThreadRoutine,
+                       void* inParameter,
+                       UInt64 inPeriodNs,
+                       UInt64 inComputationNs,
+                       UInt64 inConstraintNs,
+                       bool inIsPreemptible)
+:
+    mThreadRoutine(inThreadRoutine),
+    mParameter(inParameter),
+    mWantsRealTime(true),
+    mThread()
+{
+    // SCHED_FIFO doesn't have an equivalent for the time-constraint parameters.
+    (void)inPeriodNs;
+    (void)inComputationNs;
+    (void)inConstraintNs;
+    (void)inIsPreemptible;
+}
+
+BGM_Thread::~BGM_Thread()
+{
+    // CAPThread detaches its threads, but we join ours so the thread can't outlive the objects
+    // it uses. The thread routine must have returned (or be about to) by this point.
+    if(mStarted)
+    {
+        pthread_join(mThread, NULL);
+    }
+}
+
+void    BGM_Thread::Start()
+{
+    ThrowIf(mStarted,
+            CAException(kAudioHardwareIllegalOperationError),
+            "BGM_Thread::Start: The thread has already been started");
+
+    int theError = pthread_create(&mThread, NULL, &BGM_Thread::Entry, this);
+    ThrowIf(theError != 0,
+            CAException(kAudioHardwareUnspecifiedError),
+            "BGM_Thread::Start: Could not create the thread");
+
+    mStarted = true;
+}
+
+//static
+void* __nullable    BGM_Thread::Entry(void* inThread)
+{
+    BGM_Thread* theThread = static_cast<BGM_Thread*>(inThread);
+
+    if(theThread->mWantsRealTime)
+    {
+        // Best effort. This usually fails without CAP_SYS_NICE or an rtprio limit, in which case
+        // we just keep the default policy.
+        struct sched_param theParam;
+        theParam.sched_priority = sched_get_priority_min(SCHED_FIFO);
+
+        theThread->mIsRealTime = (pthread_setschedparam(pthread_self(), SCHED_FIFO, &theParam) == 0);
+
+        if(!theThread->mIsRealTime)
+        {
+            DebugMsg("BGM_Thread::Entry: Could not set SCHED_FIFO. Running with the default policy.");
+        }
+    }
+
+    return theThread->mThreadRoutine(theThread->mParameter);
+}
+
+bool    BGM_Thread::IsCurrentThread() const
+{
+    return mStarted && pthread_equal(pthread_self(), mThread);
+}
+
+bool    BGM_Thread::IsRealTime() const
+{
+    return mIsRealTime;
+}
+
+#pragma mark BGM_String
+
+std::string BGM_StringToUTF8(const BGM_String& inString)
+{
+    CFStringRef theString = inString.GetCFString();
+    return (theString != NULL) ? std::string(theString) : std::string();
+}
+
+BGM_String BGM_StringFromUTF8(const std::string& inString)
+{
+    return inString.empty() ? BGM_String() : BGM_String(inString.c_str());
+}
+
+#pragma clang assume_nonnull end
+
+#endif /* !BGM_PLATFORM_MACH */
+
@@ -0,0 +1,86 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  AudioHardwareBase.h
+//  BGMDriver
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  Stand-in for <CoreAudio/AudioHardwareBase.h>, only used when building bgm_core on non-Apple
+//  POSIX systems. Covers the audio object and property types, and the error codes, that the
+//  portable parts of the driver use. The values match Apple's.
+//
+
+#ifndef BGMDriver__POSIX__AudioHardwareBase
+#define BGMDriver__POSIX__AudioHardwareBase
+
+// Local Includes
+#include "../CoreAudioTypes.h"
+
+typedef UInt32  AudioObjectID;
+typedef UInt32  AudioClassID;
+typedef UInt32  AudioObjectPropertySelector;
+typedef UInt32  AudioObjectPropertyScope;
+typedef UInt32  AudioObjectPropertyElement;
+
+struct AudioObjectPropertyAddress
+{
+    AudioObjectPropertySelector mSelector;
+    AudioObjectPropertyScope    mScope;
+    AudioObjectPropertyElement  mElement;
+};
+typedef struct AudioObjectPropertyAddress AudioObjectPropertyAddress;
+
+enum
+{
+    kAudioHardwareNoError                   = 0,
+    kAudioHardwareNotRunningError           = 'stop',
+    kAudioHardwareUnspecifiedError          = 'what',
+    kAudioHardwareUnknownPropertyError      = 'who?',
+    kAudioHardwareBadPropertySizeError      = '!siz',
+    kAudioHardwareIllegalOperationError     = 'nope',
+    kAudioHardwareBadObjectError            = '!obj',
+    kAudioHardwareBadDeviceError            = '!dev',
+    kAudioHardwareBadStreamError            = '!str',
+    kAudioHardwareUnsupportedOperationError = 'unop',
+    kAudioDeviceUnsupportedFormatError      = '!dat',
+    kAudioDevicePermissionsError            = '!hog'
+};
+
+enum
+{
+    kAudioObjectUnknown                     = 0
+};
+
+enum
+{
+    kAudioObjectPropertyScopeGlobal         = 'glob',
+    kAudioObjectPropertyScopeInput          = 'inpt',
+    kAudioObjectPropertyScopeOutput         = 'outp',
+    kAudioObjectPropertyScopePlayThrough    = 'ptru',
+    kAudioObjectPropertyElementMaster       = 0,
+    kAudioObjectPropertyElementMain         = 0
+};
+
+enum
+{
+    kAudioObjectPropertySelectorWildcard    = '****',
+    kAudioObjectPropertyScopeWildcard       = '****',
+    kAudioObjectPropertyElementWildcard     = 0xFFFFFFFF
+};
+
+#endif /* BGMDriver__POSIX__AudioHardwareBase */
+
@@ -0,0 +1,65 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  AudioServerPlugIn.h
+//  BGMDriver
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  Stand-in for <CoreAudio/AudioServerPlugIn.h>, only used when building bgm_core on non-Apple
+//  POSIX systems. There's no HAL to load a plug-in there, so this only has the few declarations
+//  the portable parts of the driver share with the HAL-facing ones.
+//
+
+#ifndef BGMDriver__POSIX__AudioServerPlugIn
+#define BGMDriver__POSIX__AudioServerPlugIn
+
+// Local Includes
+#include "AudioHardwareBase.h"
+
+// System Includes
+#include <sys/types.h>
+
+enum
+{
+    kAudioObjectPlugInObject                        = 1
+};
+
+struct AudioServerPlugInClientInfo
+{
+    UInt32      mClientID;
+    pid_t       mProcessID;
+    Boolean     mIsNativeEndian;
+    CFStringRef mBundleID;
+};
+typedef struct AudioServerPlugInClientInfo AudioServerPlugInClientInfo;
+
+enum
+{
+    kAudioServerPlugInIOOperationThread             = 'thrd',
+    kAudioServerPlugInIOOperationCycle              = 'cycl',
+    kAudioServerPlugInIOOperationReadInput          = 'read',
+    kAudioServerPlugInIOOperationConvertInput       = 'cinp',
+    kAudioServerPlugInIOOperationProcessInput       = 'pinp',
+    kAudioServerPlugInIOOperationProcessOutput      = 'pout',
+    kAudioServerPlugInIOOperationMixOutput          = 'mixo',
+    kAudioServerPlugInIOOperationProcessMix         = 'pmix',
+    kAudioServerPlugInIOOperationConvertMix         = 'cmix',
+    kAudioServerPlugInIOOperationWriteMix           = 'rite'
+};
+
+#endif /* BGMDriver__POSIX__AudioServerPlugIn */
+
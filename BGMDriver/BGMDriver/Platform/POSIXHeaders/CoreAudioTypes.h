@@ -0,0 +1,131 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  CoreAudioTypes.h
+//  BGMDriver
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  Stand-in for <CoreAudio/CoreAudioTypes.h>, only used when building bgm_core on non-Apple POSIX
+//  systems. Just the types the IO path uses, laid out the same way as Apple's.
+//
+
+#ifndef BGMDriver__POSIX__CoreAudioTypes
+#define BGMDriver__POSIX__CoreAudioTypes
+
+// Local Includes
+#include "MacTypes.h"
+#include "CoreFoundation/CFBase.h"
+
+struct AudioValueRange
+{
+    Float64 mMinimum;
+    Float64 mMaximum;
+};
+typedef struct AudioValueRange AudioValueRange;
+
+struct AudioBuffer
+{
+    UInt32  mNumberChannels;
+    UInt32  mDataByteSize;
+    void*   mData;
+};
+typedef struct AudioBuffer AudioBuffer;
+
+struct AudioBufferList
+{
+    UInt32      mNumberBuffers;
+    AudioBuffer mBuffers[1];
+};
+typedef struct AudioBufferList AudioBufferList;
+
+typedef UInt32 AudioFormatID;
+typedef UInt32 AudioFormatFlags;
+
+struct AudioStreamBasicDescription
+{
+    Float64             mSampleRate;
+    AudioFormatID       mFormatID;
+    AudioFormatFlags    mFormatFlags;
+    UInt32              mBytesPerPacket;
+    UInt32              mFramesPerPacket;
+    UInt32              mBytesPerFrame;
+    UInt32              mChannelsPerFrame;
+    UInt32              mBitsPerChannel;
+    UInt32              mReserved;
+};
+typedef struct AudioStreamBasicDescription AudioStreamBasicDescription;
+
+enum
+{
+    kAudioFormatLinearPCM               = 'lpcm'
+};
+
+enum
+{
+    kAudioFormatFlagIsFloat             = (1U << 0),
+    kAudioFormatFlagIsBigEndian         = (1U << 1),
+    kAudioFormatFlagIsSignedInteger     = (1U << 2),
+    kAudioFormatFlagIsPacked            = (1U << 3),
+    kAudioFormatFlagIsAlignedHigh       = (1U << 4),
+    kAudioFormatFlagIsNonInterleaved    = (1U << 5),
+    kAudioFormatFlagIsNonMixable        = (1U << 6),
+#if TARGET_RT_BIG_ENDIAN
+    kAudioFormatFlagsNativeEndian       = kAudioFormatFlagIsBigEndian,
+#else
+    kAudioFormatFlagsNativeEndian       = 0,
+#endif
+    kAudioFormatFlagsNativeFloatPacked  = kAudioFormatFlagIsFloat | kAudioFormatFlagsNativeEndian | kAudioFormatFlagIsPacked
+};
+
+struct SMPTETime
+{
+    SInt16  mSubframes;
+    SInt16  mSubframeDivisor;
+    UInt32  mCounter;
+    UInt32  mType;
+    UInt32  mFlags;
+    SInt16  mHours;
+    SInt16  mMinutes;
+    SInt16  mSeconds;
+    SInt16  mFrames;
+};
+typedef struct SMPTETime SMPTETime;
+
+struct AudioTimeStamp
+{
+    Float64     mSampleTime;
+    UInt64      mHostTime;
+    Float64     mRateScalar;
+    UInt64      mWordClockTime;
+    SMPTETime   mSMPTETime;
+    UInt32      mFlags;
+    UInt32      mReserved;
+};
+typedef struct AudioTimeStamp AudioTimeStamp;
+
+enum
+{
+    kAudioTimeStampSampleTimeValid      = (1U << 0),
+    kAudioTimeStampHostTimeValid        = (1U << 1),
+    kAudioTimeStampRateScalarValid      = (1U << 2),
+    kAudioTimeStampWordClockTimeValid   = (1U << 3),
+    kAudioTimeStampSMPTETimeValid       = (1U << 4),
+    kAudioTimeStampSampleHostTimeValid  = (kAudioTimeStampSampleTimeValid | kAudioTimeStampHostTimeValid)
+};
+
+#endif /* BGMDriver__POSIX__CoreAudioTypes */
+
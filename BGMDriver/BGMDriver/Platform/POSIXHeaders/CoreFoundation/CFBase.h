@@ -0,0 +1,65 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  CFBase.h
+//  BGMDriver
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  Stand-in for <CoreFoundation/CFBase.h>, only used when building bgm_core on non-Apple POSIX
+//  systems. There's no CoreFoundation there, so strings from the host (just bundle IDs, so far)
+//  are plain UTF-8 C strings. BGM_String in BGM_Platform.h wraps them.
+//
+
+#ifndef BGMDriver__POSIX__CFBase
+#define BGMDriver__POSIX__CFBase
+
+// Local Includes
+#include "MacTypes.h"
+
+typedef const char* CFStringRef;
+typedef const void* CFTypeRef;
+typedef long        CFIndex;
+typedef UInt32      CFStringEncoding;
+
+// From CFString.h. Only used in log messages.
+enum
+{
+    kCFStringEncodingUTF8 = 0x08000100
+};
+
+static inline const char* CFStringGetCStringPtr(CFStringRef theString, CFStringEncoding encoding)
+{
+    (void)encoding;
+    return theString;
+}
+
+// From <dispatch/time.h>, which CoreFoundation pulls in on macOS.
+#ifndef NSEC_PER_SEC
+    #define NSEC_PER_SEC    1000000000ull
+#endif
+#ifndef NSEC_PER_MSEC
+    #define NSEC_PER_MSEC   1000000ull
+#endif
+#ifndef NSEC_PER_USEC
+    #define NSEC_PER_USEC   1000ull
+#endif
+#ifndef USEC_PER_SEC
+    #define USEC_PER_SEC    1000000ull
+#endif
+
+#endif /* BGMDriver__POSIX__CFBase */
+
@@ -0,0 +1,92 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  MacTypes.h
+//  BGMDriver
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  Stand-in for the Apple header of the same name, only used when building bgm_core on non-Apple
+//  POSIX systems.
+//
+
+#ifndef __MACTYPES__
+#define __MACTYPES__
+
+// Local Includes
+#include "TargetConditionals.h"
+
+// System Includes
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+// The same underlying types as Apple's, e.g. SInt64 is long long rather than int64_t (which is
+// long on LP64 Linux), so overload resolution works the same way.
+typedef unsigned char       UInt8;
+typedef signed char         SInt8;
+typedef unsigned short      UInt16;
+typedef signed short        SInt16;
+typedef unsigned int        UInt32;
+typedef signed int          SInt32;
+typedef unsigned long long  UInt64;
+typedef signed long long    SInt64;
+
+typedef UInt8               Byte;
+
+typedef float           Float32;
+typedef double          Float64;
+
+typedef unsigned char   Boolean;
+
+typedef SInt32          OSStatus;
+typedef UInt32          FourCharCode;
+typedef FourCharCode    OSType;
+
+enum
+{
+    noErr = 0
+};
+
+// The nullability qualifiers are Clang-only. (__nonnull is left alone because glibc's sys/cdefs.h
+// already uses that name for a function-like macro.)
+#if !defined(__clang__)
+    #define __nullable
+    #define _Nullable
+    #define _Nonnull
+    #define _Null_unspecified
+#endif
+
+// From the BSD stdlib.h.
+#if !defined(__APPLE__) && !defined(__FreeBSD__)
+static inline void* reallocf(void* ptr, size_t size)
+{
+    void* theNewPtr = realloc(ptr, size);
+    if(theNewPtr == NULL && size != 0)
+    {
+        free(ptr);
+    }
+    return theNewPtr;
+}
+#endif
+
+// From the BSD sys/cdefs.h.
+#ifndef __printflike
+    #define __printflike(fmtarg, firstvararg) __attribute__((__format__(__printf__, fmtarg, firstvararg)))
+#endif
+
+#endif /* __MACTYPES__ */
+
@@ -0,0 +1,62 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  TargetConditionals.h
+//  BGMDriver
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  Stand-in for the Apple header of the same name, only used when building bgm_core on non-Apple
+//  POSIX systems. (See Platform/BGM_Platform.h.)
+//
+//  The PublicUtility classes use TARGET_OS_MAC to choose their pthread-based implementations,
+//  which are the ones we want on any POSIX system, so it's set here even though we aren't
+//  building for macOS. Anything that actually needs Mach or CoreFoundation has to check
+//  BGM_PLATFORM_MACH instead.
+//
+
+#ifndef BGMDriver__POSIX__TargetConditionals
+#define BGMDriver__POSIX__TargetConditionals
+
+#define TARGET_OS_MAC               1
+#define TARGET_OS_OSX               0
+#define TARGET_OS_IPHONE            0
+#define TARGET_OS_WIN32             0
+#define TARGET_API_MAC_OSX          0
+
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+    #define TARGET_RT_BIG_ENDIAN    1
+    #define TARGET_RT_LITTLE_ENDIAN 0
+#else
+    #define TARGET_RT_BIG_ENDIAN    0
+    #define TARGET_RT_LITTLE_ENDIAN 1
+#endif
+
+#if defined(__LP64__) && __LP64__
+    #define TARGET_RT_64_BIT        1
+#else
+    #define TARGET_RT_64_BIT        0
+#endif
+
+// Some of the PublicUtility headers compare these (from AvailabilityMacros.h) to decide which
+// OSAtomic APIs they can use. Claiming 10.4 keeps them on the subset libkern/OSAtomic.h provides.
+#define MAC_OS_X_VERSION_10_4       1040
+#define MAC_OS_X_VERSION_10_5       1050
+#define MAC_OS_X_VERSION_10_10      101000
+#define MAC_OS_X_VERSION_MAX_ALLOWED MAC_OS_X_VERSION_10_4
+
+#endif /* BGMDriver__POSIX__TargetConditionals */
+
@@ -0,0 +1,149 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  OSAtomic.h
+//  BGMDriver
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  Stand-in for <libkern/OSAtomic.h>, only used when building bgm_core on non-Apple POSIX
+//  systems. Implements the functions CAAtomic.h and CAAtomicStack.h wrap with the GCC/Clang
+//  __atomic builtins. The Barrier variants are sequentially consistent, the others relaxed.
+//
+
+#ifndef BGMDriver__POSIX__OSAtomic
+#define BGMDriver__POSIX__OSAtomic
+
+// Local Includes
+#include "../MacTypes.h"
+
+// System Includes
+#include <stdint.h>
+#include <stdbool.h>
+#include <sched.h>
+
+#pragma mark Memory barriers
+
+static inline void OSMemoryBarrier(void)
+{
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+#pragma mark Arithmetic
+
+static inline int32_t OSAtomicAdd32Barrier(int32_t theAmount, volatile int32_t* theValue)
+{
+    return __atomic_add_fetch(theValue, theAmount, __ATOMIC_SEQ_CST);
+}
+
+static inline int32_t OSAtomicIncrement32(volatile int32_t* theValue)
+{
+    return __atomic_add_fetch(theValue, 1, __ATOMIC_RELAXED);
+}
+
+static inline int32_t OSAtomicIncrement32Barrier(volatile int32_t* theValue)
+{
+    return __atomic_add_fetch(theValue, 1, __ATOMIC_SEQ_CST);
+}
+
+static inline int32_t OSAtomicDecrement32(volatile int32_t* theValue)
+{
+    return __atomic_sub_fetch(theValue, 1, __ATOMIC_RELAXED);
+}
+
+static inline int32_t OSAtomicDecrement32Barrier(volatile int32_t* theValue)
+{
+    return __atomic_sub_fetch(theValue, 1, __ATOMIC_SEQ_CST);
+}
+
+#pragma mark Logical
+
+static inline int32_t OSAtomicOr32Barrier(uint32_t theMask, volatile uint32_t* theValue)
+{
+    return (int32_t)__atomic_or_fetch(theValue, theMask, __ATOMIC_SEQ_CST);
+}
+
+static inline int32_t OSAtomicAnd32Barrier(uint32_t theMask, volatile uint32_t* theValue)
+{
+    return (int32_t)__atomic_and_fetch(theValue, theMask, __ATOMIC_SEQ_CST);
+}
+
+#pragma mark Compare and swap
+
+static inline bool OSAtomicCompareAndSwap32Barrier(int32_t oldValue, int32_t newValue, volatile int32_t* theValue)
+{
+    return __atomic_compare_exchange_n(theValue, &oldValue, newValue, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+static inline bool OSAtomicCompareAndSwap64Barrier(int64_t oldValue, int64_t newValue, volatile int64_t* theValue)
+{
+    return __atomic_compare_exchange_n(theValue, &oldValue, newValue, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+static inline bool OSAtomicCompareAndSwapPtrBarrier(void* oldValue, void* newValue, void* volatile* theValue)
+{
+    return __atomic_compare_exchange_n(theValue, &oldValue, newValue, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+#pragma mark Bit test and set
+
+// Like Apple's versions, these address bit n as bit (0x80 >> (n & 7)) of byte (n >> 3).
+
+static inline bool OSAtomicTestAndSetBarrier(uint32_t n, volatile void* theAddress)
+{
+    volatile uint8_t* theByte = (volatile uint8_t*)theAddress + (n >> 3);
+    uint8_t theMask = (uint8_t)(0x80 >> (n & 7));
+    return (__atomic_fetch_or(theByte, theMask, __ATOMIC_SEQ_CST) & theMask) != 0;
+}
+
+static inline bool OSAtomicTestAndClearBarrier(uint32_t n, volatile void* theAddress)
+{
+    volatile uint8_t* theByte = (volatile uint8_t*)theAddress + (n >> 3);
+    uint8_t theMask = (uint8_t)(0x80 >> (n & 7));
+    return (__atomic_fetch_and(theByte, (uint8_t)~theMask, __ATOMIC_SEQ_CST) & theMask) != 0;
+}
+
+static inline bool OSAtomicTestAndClear(uint32_t n, volatile void* theAddress)
+{
+    volatile uint8_t* theByte = (volatile uint8_t*)theAddress + (n >> 3);
+    uint8_t theMask = (uint8_t)(0x80 >> (n & 7));
+    return (__atomic_fetch_and(theByte, (uint8_t)~theMask, __ATOMIC_RELAXED) & theMask) != 0;
+}
+
+#pragma mark Spin locks
+
+typedef int32_t OSSpinLock;
+
+static inline bool OSSpinLockTry(volatile OSSpinLock* theLock)
+{
+    return __atomic_exchange_n(theLock, 1, __ATOMIC_ACQUIRE) == 0;
+}
+
+static inline void OSSpinLockLock(volatile OSSpinLock* theLock)
+{
+    while(!OSSpinLockTry(theLock))
+    {
+        sched_yield();
+    }
+}
+
+static inline void OSSpinLockUnlock(volatile OSSpinLock* theLock)
+{
+    __atomic_store_n(theLock, 0, __ATOMIC_RELEASE);
+}
+
+#endif /* BGMDriver__POSIX__OSAtomic */
+
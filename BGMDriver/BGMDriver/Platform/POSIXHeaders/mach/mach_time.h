@@ -0,0 +1,66 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  mach_time.h
+//  BGMDriver
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  Stand-in for <mach/mach_time.h>, only used when building bgm_core on non-Apple POSIX systems.
+//  Some PublicUtility headers (e.g. CAHostTimeBase.h) include it. Host time is CLOCK_MONOTONIC in
+//  nanoseconds, the same as BGM_Platform's, so the timebase is 1/1.
+//
+
+#ifndef BGMDriver__POSIX__mach_time
+#define BGMDriver__POSIX__mach_time
+
+// Local Includes
+#include "../MacTypes.h"
+
+// System Includes
+#include <stdint.h>
+#include <time.h>
+
+typedef int kern_return_t;
+
+#ifndef KERN_SUCCESS
+    #define KERN_SUCCESS 0
+#endif
+
+struct mach_timebase_info
+{
+    uint32_t numer;
+    uint32_t denom;
+};
+typedef struct mach_timebase_info  mach_timebase_info_data_t;
+typedef struct mach_timebase_info* mach_timebase_info_t;
+
+static inline kern_return_t mach_timebase_info(mach_timebase_info_t info)
+{
+    info->numer = 1;
+    info->denom = 1;
+    return KERN_SUCCESS;
+}
+
+static inline uint64_t mach_absolute_time(void)
+{
+    struct timespec theTime;
+    clock_gettime(CLOCK_MONOTONIC, &theTime);
+    return ((uint64_t)theTime.tv_sec * 1000000000ull) + (uint64_t)theTime.tv_nsec;
+}
+
+#endif /* BGMDriver__POSIX__mach_time */
+
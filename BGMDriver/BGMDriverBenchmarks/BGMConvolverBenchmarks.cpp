@@ -0,0 +1,87 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGMConvolverBenchmarks.cpp
+//  BGMDriverBenchmarks
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  Benchmarks for BGMApp's BGMConvolver, which runs on the output device's IO thread in
+//  BGMPlayThrough. It's benchmarked here so it can share the runner and the baseline with the
+//  driver's benchmarks.
+//
+//  At 48 kHz, a 512-frame buffer has to be processed in 10.67 ms, so ns_per_iteration / 10.67e6
+//  is the fraction of one core the convolver needs for that impulse response length.
+//
+
+// Local Includes
+#include "BGM_Benchmark.h"
+#include "BGMConvolver.h"
+
+// STL Includes
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+#pragma clang assume_nonnull begin
+
+static const UInt32 kConvolverFrameCounts[] = { 128, 512 };
+// 85 ms, 341 ms and 1.37 s at 48 kHz.
+static const UInt32 kImpulseResponseFrameCounts[] = { 4096, 16384, BGMConvolver::kMaxImpulseResponseFrames };
+
+static const UInt32 kChannelCount = 2;
+
+BGM_BENCHMARK_SUITE(Convolver)
+{
+    for(UInt32 theFrameCount : kConvolverFrameCounts)
+    {
+        for(UInt32 theImpulseResponseFrameCount : kImpulseResponseFrameCounts)
+        {
+            std::vector<Float32> theSource(theFrameCount * kChannelCount);
+            BGM_BenchmarkSignals::FillWithNoise(theSource, 0.5f);
+            std::vector<Float32> theBuffer(theSource);
+            const size_t theBufferBytes = theSource.size() * sizeof(Float32);
+
+            std::vector<Float32> theImpulseResponse(theImpulseResponseFrameCount * kChannelCount);
+            BGM_BenchmarkSignals::FillWithNoise(theImpulseResponse, 0.01f);
+
+            BGMConvolver theConvolver;
+            theConvolver.Configure(kChannelCount, theFrameCount);
+            theConvolver.SetImpulseResponse(theImpulseResponse, kChannelCount);
+
+            // Wait for the loader thread to transform the impulse response.
+            while(theConvolver.GetLatencyFrames() == 0)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+
+            inRunner.Run("Convolver/ir=" + std::to_string(theImpulseResponseFrameCount) +
+                                 "/frames=" + std::to_string(theFrameCount),
+                         theFrameCount,
+                         [&] {
+                             memcpy(theBuffer.data(), theSource.data(), theBufferBytes);
+                             theConvolver.ProcessRT(theBuffer.data(), theFrameCount, kChannelCount);
+                             BGM_BenchmarkRunner::DoNotOptimize(theBuffer.data());
+                         });
+        }
+    }
+}
+
+#pragma clang assume_nonnull end
+
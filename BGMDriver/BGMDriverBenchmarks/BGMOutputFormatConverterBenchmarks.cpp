@@ -0,0 +1,134 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGMOutputFormatConverterBenchmarks.cpp
+//  BGMDriverBenchmarks
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  Benchmarks for BGMApp's BGMOutputFormatConverter, which BGMPlayThrough runs on the output
+//  device's IO thread when the device isn't a single interleaved stereo Float32 stream. Each case
+//  converts one IO buffer of stereo to a different output device layout.
+//
+
+// Local Includes
+#include "BGM_Benchmark.h"
+#include "BGMOutputFormatConverter.h"
+
+// STL Includes
+#include <string>
+#include <vector>
+
+
+#pragma clang assume_nonnull begin
+
+static const UInt32 kSourceChannelCount = 2;
+static const UInt32 kConverterFrameCounts[] = { 128, 512 };
+
+static AudioStreamBasicDescription MakeFormat(AudioFormatFlags inFlags,
+                                              UInt32 inChannelCount,
+                                              UInt32 inBitsPerChannel,
+                                              UInt32 inBytesPerSample)
+{
+    const bool theIsNonInterleaved = (inFlags & kAudioFormatFlagIsNonInterleaved) != 0;
+
+    AudioStreamBasicDescription theFormat = {};
+    theFormat.mSampleRate = 48000.0;
+    theFormat.mFormatID = kAudioFormatLinearPCM;
+    theFormat.mFormatFlags = inFlags | kAudioFormatFlagsNativeEndian;
+    theFormat.mFramesPerPacket = 1;
+    theFormat.mChannelsPerFrame = inChannelCount;
+    theFormat.mBitsPerChannel = inBitsPerChannel;
+    theFormat.mBytesPerFrame = inBytesPerSample * (theIsNonInterleaved ? 1 : inChannelCount);
+    theFormat.mBytesPerPacket = theFormat.mBytesPerFrame;
+    return theFormat;
+}
+
+BGM_BENCHMARK_SUITE(OutputFormatConverter)
+{
+    const AudioFormatFlags kFloat = kAudioFormatFlagIsFloat | kAudioFormatFlagIsPacked;
+    const AudioFormatFlags kInteger = kAudioFormatFlagIsSignedInteger | kAudioFormatFlagIsPacked;
+
+    // Stereo is routed to channels 3 and 4 of the multichannel devices, like an interface whose
+    // preferred stereo pair isn't its first.
+    const struct
+    {
+        const char*                 mName;
+        AudioStreamBasicDescription mFormat;
+        UInt32                      mLeft;
+        UInt32                      mRight;
+    } kLayouts[] = {
+        { "float32/interleaved/ch=8", MakeFormat(kFloat, 8, 32, 4), 3, 4 },
+        { "float32/noninterleaved/ch=8",
+          MakeFormat(kFloat | kAudioFormatFlagIsNonInterleaved, 8, 32, 4), 3, 4 },
+        { "int16/interleaved/ch=2", MakeFormat(kInteger, 2, 16, 2), 1, 2 },
+        { "int24/interleaved/ch=2", MakeFormat(kInteger, 2, 24, 3), 1, 2 },
+        { "int32/interleaved/ch=2", MakeFormat(kInteger, 2, 32, 4), 1, 2 },
+        { "int32/interleaved/ch=8", MakeFormat(kInteger, 8, 32, 4), 3, 4 }
+    };
+
+    for(UInt32 theFrameCount : kConverterFrameCounts)
+    {
+        for(const auto& theLayout : kLayouts)
+        {
+            const AudioStreamBasicDescription& theFormat = theLayout.mFormat;
+            const bool theIsNonInterleaved =
+                    (theFormat.mFormatFlags & kAudioFormatFlagIsNonInterleaved) != 0;
+            const UInt32 theBufferCount = theIsNonInterleaved ? theFormat.mChannelsPerFrame : 1;
+            const UInt32 theBufferBytes = theFrameCount * theFormat.mBytesPerFrame;
+
+            BGMOutputFormatConverter theConverter;
+            theConverter.Configure(kSourceChannelCount,
+                                   { theFormat },
+                                   BGMOutputFormatConverter::MakeChannelMap(
+                                           kSourceChannelCount,
+                                           theFormat.mChannelsPerFrame,
+                                           theLayout.mLeft,
+                                           theLayout.mRight),
+                                   theFrameCount);
+
+            std::vector<Float32> theSource(theFrameCount * kSourceChannelCount);
+            BGM_BenchmarkSignals::FillWithNoise(theSource, 0.5f);
+
+            // AudioBufferList only has room for one buffer, so allocate it with enough space for
+            // the rest.
+            std::vector<Byte> theOutputData(theBufferBytes * theBufferCount);
+            std::vector<Byte> theBufferListData(sizeof(AudioBufferList) +
+                                                sizeof(AudioBuffer) * theBufferCount);
+            AudioBufferList* theOutput = reinterpret_cast<AudioBufferList*>(theBufferListData.data());
+            theOutput->mNumberBuffers = theBufferCount;
+
+            for(UInt32 i = 0; i < theBufferCount; i++)
+            {
+                theOutput->mBuffers[i].mNumberChannels =
+                        theIsNonInterleaved ? 1 : theFormat.mChannelsPerFrame;
+                theOutput->mBuffers[i].mDataByteSize = theBufferBytes;
+                theOutput->mBuffers[i].mData = theOutputData.data() + i * theBufferBytes;
+            }
+
+            inRunner.Run(std::string("OutputFormatConverter/") + theLayout.mName +
+                                 "/frames=" + std::to_string(theFrameCount),
+                         theFrameCount,
+                         [&] {
+                             theConverter.ConvertRT(theSource.data(), theFrameCount, theOutput);
+                             BGM_BenchmarkRunner::DoNotOptimize(theOutputData.data());
+                         });
+        }
+    }
+}
+
+#pragma clang assume_nonnull end
+
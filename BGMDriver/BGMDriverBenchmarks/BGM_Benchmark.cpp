@@ -0,0 +1,415 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_Benchmark.cpp
+//  BGMDriverBenchmarks
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  The benchmark runner and bgm_core_benchmarks' main function.
+//
+//  Usage: bgm_core_benchmarks [--quick] [--filter <substring>] [--json <output file>]
+//                             [--baseline <baseline file> [--tolerance <fraction>]]
+//
+//  With --baseline, any benchmark whose median time per iteration is more than (1 + tolerance)
+//  times its time in the baseline file counts as a regression and the exit status is 1.
+//  Benchmarks that aren't in the baseline are reported but don't fail. To update the baseline,
+//  run the benchmarks (without --quick) with --json and check in the output.
+//
+
+// Self Include
+#include "BGM_Benchmark.h"
+
+// Local Includes
+#include "BGM_Platform.h"
+
+// STL Includes
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+
+#pragma clang assume_nonnull begin
+
+#pragma mark BGM_BenchmarkRunner
+
+// Each case is timed in a number of batches, each of which runs the case repeatedly for about
+// this long. The median batch is reported, which filters out most of the noise from preemption.
+static const UInt64 kBatchDurationNs      = 2 * NSEC_PER_MSEC;
+static const UInt32 kBatchCount           = 15;
+// --quick just checks that everything runs.
+static const UInt64 kQuickBatchDurationNs = 100 * NSEC_PER_USEC;
+static const UInt32 kQuickBatchCount      = 3;
+
+static const Float64 kDefaultTolerance    = 0.25;
+
+BGM_BenchmarkRunner::BGM_BenchmarkRunner(bool inQuick, const std::string& inFilter)
+:
+    mQuick(inQuick),
+    mFilter(inFilter)
+{
+}
+
+void    BGM_BenchmarkRunner::Run(const std::string& inName,
+                                 UInt32 inItemsPerIteration,
+                                 const std::function<void()>& inIteration)
+{
+    if(!mFilter.empty() && inName.find(mFilter) == std::string::npos)
+    {
+        return;
+    }
+
+    const UInt64 theBatchDurationNs = mQuick ? kQuickBatchDurationNs : kBatchDurationNs;
+    const UInt32 theBatchCount = mQuick ? kQuickBatchCount : kBatchCount;
+
+    auto theElapsedNs = [&](UInt64 inIterations) {
+        UInt64 theStart = BGM_Platform::GetCurrentHostTime();
+
+        for(UInt64 i = 0; i < inIterations; i++)
+        {
+            inIteration();
+        }
+
+        return BGM_Platform::ConvertHostTimeToNanos(BGM_Platform::GetCurrentHostTime() - theStart);
+    };
+
+    // Warm up the caches and find out roughly how many iterations fit in a batch.
+    UInt64 theIterationsPerBatch = 1;
+    UInt64 theWarmUpNs = theElapsedNs(theIterationsPerBatch);
+
+    while(theWarmUpNs < theBatchDurationNs / 4)
+    {
+        theIterationsPerBatch *= 2;
+        theWarmUpNs = theElapsedNs(theIterationsPerBatch);
+    }
+
+    theIterationsPerBatch =
+        std::max<UInt64>(1, (theIterationsPerBatch * theBatchDurationNs) / std::max<UInt64>(1, theWarmUpNs));
+
+    std::vector<Float64> theBatchNsPerIteration;
+    theBatchNsPerIteration.reserve(theBatchCount);
+
+    for(UInt32 i = 0; i < theBatchCount; i++)
+    {
+        theBatchNsPerIteration.push_back(static_cast<Float64>(theElapsedNs(theIterationsPerBatch)) /
+                                         static_cast<Float64>(theIterationsPerBatch));
+    }
+
+    std::sort(theBatchNsPerIteration.begin(), theBatchNsPerIteration.end());
+
+    BGM_BenchmarkResult theResult;
+    theResult.mName = inName;
+    theResult.mItemsPerIteration = inItemsPerIteration;
+    theResult.mIterations = theIterationsPerBatch * theBatchCount;
+    theResult.mMedianNsPerIteration = theBatchNsPerIteration[theBatchCount / 2];
+    theResult.mMinNsPerIteration = theBatchNsPerIteration[0];
+    mResults.push_back(theResult);
+
+    printf("%-64s %12.1f ns/iter %10.3f ns/item\n",
+           inName.c_str(),
+           theResult.mMedianNsPerIteration,
+           theResult.mMedianNsPerIteration / std::max<UInt32>(1, inItemsPerIteration));
+    fflush(stdout);
+}
+
+//static
+void    BGM_BenchmarkRunner::DoNotOptimize(const void* inPointer)
+{
+    // An empty asm statement that claims to read the pointer and clobber memory, so the compiler
+    // has to assume the results written through it are used.
+    __asm__ __volatile__("" : : "r"(inPointer) : "memory");
+}
+
+#pragma mark BGM_BenchmarkSuiteRegistrar
+
+typedef std::vector<std::pair<const char*, BGM_BenchmarkSuiteRegistrar::SuiteFunction>> BGM_BenchmarkSuiteList;
+
+static BGM_BenchmarkSuiteList& GetSuites()
+{
+    // A function-local static so the suites can register themselves during static
+    // initialization, in whatever order their files' initializers happen to run.
+    static BGM_BenchmarkSuiteList sSuites;
+    return sSuites;
+}
+
+BGM_BenchmarkSuiteRegistrar::BGM_BenchmarkSuiteRegistrar(const char* inName, SuiteFunction inSuite)
+{
+    GetSuites().push_back(std::make_pair(inName, inSuite));
+}
+
+//static
+void    BGM_BenchmarkSuiteRegistrar::RunAll(BGM_BenchmarkRunner& inRunner)
+{
+    // Sort by name so the output's order doesn't depend on the link order.
+    BGM_BenchmarkSuiteList theSuites = GetSuites();
+    std::sort(theSuites.begin(),
+              theSuites.end(),
+              [](const BGM_BenchmarkSuiteList::value_type& inA, const BGM_BenchmarkSuiteList::value_type& inB) {
+                  return strcmp(inA.first, inB.first) < 0;
+              });
+
+    for(const auto& theSuite : theSuites)
+    {
+        theSuite.second(inRunner);
+    }
+}
+
+#pragma mark Test Signals
+
+void    BGM_BenchmarkSignals::FillWithNoise(std::vector<Float32>& ioBuffer,
+                                            Float32 inAmplitude,
+                                            UInt32 inSeed)
+{
+    // A plain LCG. (std::minstd_rand would do, but its output isn't specified to be the same
+    // across standard libraries.)
+    UInt32 theState = inSeed;
+
+    for(Float32& theSample : ioBuffer)
+    {
+        theState = (theState * 1664525u) + 1013904223u;
+        Float32 theUnitValue = static_cast<Float32>(theState >> 8) / static_cast<Float32>(1 << 24);
+        theSample = ((theUnitValue * 2.0f) - 1.0f) * inAmplitude;
+    }
+}
+
+#pragma mark JSON
+
+static const char* GetPlatformName()
+{
+#if BGM_PLATFORM_MACH
+    return "macOS";
+#elif defined(__linux__)
+    return "Linux";
+#else
+    return "POSIX";
+#endif
+}
+
+static bool WriteJSON(const std::vector<BGM_BenchmarkResult>& inResults,
+                      bool inQuick,
+                      const char* inPath)
+{
+    FILE* theFile = fopen(inPath, "w");
+
+    if(!theFile)
+    {
+        fprintf(stderr, "Could not open %s for writing\n", inPath);
+        return false;
+    }
+
+    // One benchmark per line, so the baseline diffs nicely. (The names never need escaping.)
+    fprintf(theFile, "{\n");
+    fprintf(theFile, "  \"schema_version\": 1,\n");
+    fprintf(theFile, "  \"platform\": \"%s\",\n", GetPlatformName());
+    fprintf(theFile, "  \"quick\": %s,\n", inQuick ? "true" : "false");
+    fprintf(theFile, "  \"benchmarks\": [\n");
+
+    for(size_t i = 0; i < inResults.size(); i++)
+    {
+        const BGM_BenchmarkResult& theResult = inResults[i];
+
+        fprintf(theFile,
+                "    { \"name\": \"%s\", \"items_per_iteration\": %u, \"iterations\": %llu, "
+                "\"ns_per_iteration\": %.1f, \"min_ns_per_iteration\": %.1f, \"ns_per_item\": %.3f }%s\n",
+                theResult.mName.c_str(),
+                theResult.mItemsPerIteration,
+                theResult.mIterations,
+                theResult.mMedianNsPerIteration,
+                theResult.mMinNsPerIteration,
+                theResult.mMedianNsPerIteration / std::max<UInt32>(1, theResult.mItemsPerIteration),
+                (i + 1 < inResults.size()) ? "," : "");
+    }
+
+    fprintf(theFile, "  ]\n}\n");
+    fclose(theFile);
+
+    return true;
+}
+
+// Reads the name and ns_per_iteration of each benchmark in a file written by WriteJSON. Not a
+// general JSON parser, but it doesn't depend on the whitespace or the order of the fields.
+static bool ReadBaseline(const char* inPath, std::map<std::string, Float64>& outBaseline)
+{
+    std::ifstream theFile(inPath);
+
+    if(!theFile)
+    {
+        fprintf(stderr, "Could not open baseline file %s\n", inPath);
+        return false;
+    }
+
+    std::stringstream theContents;
+    theContents << theFile.rdbuf();
+    const std::string theJSON = theContents.str();
+
+    const std::string kNameKey = "\"name\"";
+    const std::string kTimeKey = "\"ns_per_iteration\"";
+
+    size_t theNamePos = theJSON.find(kNameKey);
+
+    while(theNamePos != std::string::npos)
+    {
+        size_t theNextNamePos = theJSON.find(kNameKey, theNamePos + kNameKey.size());
+        size_t theObjectEnd = theJSON.find('}', theNamePos);
+
+        size_t theNameStart = theJSON.find('"', theJSON.find(':', theNamePos + kNameKey.size()) + 1);
+        size_t theNameEnd = theJSON.find('"', theNameStart + 1);
+
+        size_t theTimePos = theJSON.find(kTimeKey, theNamePos);
+
+        if(theNameStart == std::string::npos ||
+           theNameEnd == std::string::npos ||
+           theTimePos == std::string::npos ||
+           theTimePos > theObjectEnd)
+        {
+            fprintf(stderr, "Could not parse baseline file %s\n", inPath);
+            return false;
+        }
+
+        std::string theName = theJSON.substr(theNameStart + 1, theNameEnd - theNameStart - 1);
+        size_t theValuePos = theJSON.find(':', theTimePos + kTimeKey.size()) + 1;
+        outBaseline[theName] = strtod(theJSON.c_str() + theValuePos, NULL);
+
+        theNamePos = theNextNamePos;
+    }
+
+    return true;
+}
+
+// Returns the number of regressions.
+static UInt32 CompareWithBaseline(const std::vector<BGM_BenchmarkResult>& inResults,
+                                  const std::map<std::string, Float64>& inBaseline,
+                                  Float64 inTolerance)
+{
+    UInt32 theRegressions = 0;
+
+    printf("\nCompared with the baseline (tolerance %.0f%%):\n", inTolerance * 100.0);
+
+    for(const BGM_BenchmarkResult& theResult : inResults)
+    {
+        auto theBaselineEntry = inBaseline.find(theResult.mName);
+
+        if(theBaselineEntry == inBaseline.end() || theBaselineEntry->second <= 0.0)
+        {
+            printf("  %-62s (not in baseline)\n", theResult.mName.c_str());
+            continue;
+        }
+
+        Float64 theRatio = theResult.mMedianNsPerIteration / theBaselineEntry->second;
+        bool isRegression = theRatio > (1.0 + inTolerance);
+
+        if(isRegression)
+        {
+            theRegressions++;
+        }
+
+        printf("  %-62s %7.2fx%s\n",
+               theResult.mName.c_str(),
+               theRatio,
+               isRegression ? "  REGRESSION" : "");
+    }
+
+    return theRegressions;
+}
+
+#pragma mark main
+
+static void PrintUsage(const char* inExecutableName)
+{
+    fprintf(stderr,
+            "Usage: %s [--quick] [--filter <substring>] [--json <output file>]\n"
+            "       %*s [--baseline <baseline file> [--tolerance <fraction, default %.2f>]]\n",
+            inExecutableName,
+            static_cast<int>(strlen(inExecutableName)),
+            "",
+            kDefaultTolerance);
+}
+
+int main(int argc, const char* argv[])
+{
+    bool theQuick = false;
+    std::string theFilter;
+    const char* __nullable theJSONPath = NULL;
+    const char* __nullable theBaselinePath = NULL;
+    Float64 theTolerance = kDefaultTolerance;
+
+    for(int i = 1; i < argc; i++)
+    {
+        bool hasValue = (i + 1 < argc);
+
+        if(strcmp(argv[i], "--quick") == 0)
+        {
+            theQuick = true;
+        }
+        else if(strcmp(argv[i], "--filter") == 0 && hasValue)
+        {
+            theFilter = argv[++i];
+        }
+        else if(strcmp(argv[i], "--json") == 0 && hasValue)
+        {
+            theJSONPath = argv[++i];
+        }
+        else if(strcmp(argv[i], "--baseline") == 0 && hasValue)
+        {
+            theBaselinePath = argv[++i];
+        }
+        else if(strcmp(argv[i], "--tolerance") == 0 && hasValue)
+        {
+            theTolerance = strtod(argv[++i], NULL);
+        }
+        else
+        {
+            PrintUsage(argv[0]);
+            return 2;
+        }
+    }
+
+    // Read the baseline first so a bad path fails before spending time on the benchmarks.
+    std::map<std::string, Float64> theBaseline;
+
+    if(theBaselinePath && !ReadBaseline(theBaselinePath, theBaseline))
+    {
+        return 2;
+    }
+
+    BGM_BenchmarkRunner theRunner(theQuick, theFilter);
+    BGM_BenchmarkSuiteRegistrar::RunAll(theRunner);
+
+    if(theJSONPath && !WriteJSON(theRunner.GetResults(), theQuick, theJSONPath))
+    {
+        return 2;
+    }
+
+    if(theBaselinePath)
+    {
+        UInt32 theRegressions = CompareWithBaseline(theRunner.GetResults(), theBaseline, theTolerance);
+
+        if(theRegressions > 0)
+        {
+            printf("\n%u benchmark(s) regressed by more than %.0f%%.\n", theRegressions, theTolerance * 100.0);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+#pragma clang assume_nonnull end
+
@@ -0,0 +1,119 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_Benchmark.h
+//  BGMDriverBenchmarks
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  A small harness for timing the code BGMDriver runs on the IO thread. Each benchmark file
+//  defines a suite with BGM_BENCHMARK_SUITE, which calls BGM_BenchmarkRunner::Run once per case.
+//  Cases are named like "IOKernels/ApplyGain/frames=512" so sweeps over buffer sizes and client
+//  counts sort together and can be selected with --filter.
+//
+//  The results can be written as JSON and compared against a baseline file (see
+//  BGMDriverBenchmarks/baseline.json) with a tolerance. See DEVELOPING.md.
+//
+
+#ifndef BGMDriverBenchmarks__BGM_Benchmark
+#define BGMDriverBenchmarks__BGM_Benchmark
+
+// STL Includes
+#include <functional>
+#include <string>
+#include <vector>
+
+// System Includes
+#include <MacTypes.h>
+
+
+#pragma clang assume_nonnull begin
+
+struct BGM_BenchmarkResult
+{
+    std::string                 mName;
+    // The number of frames, clients, etc. processed by each iteration. Used to report the time
+    // per item, which is easier to compare across buffer sizes.
+    UInt32                      mItemsPerIteration;
+    UInt64                      mIterations;
+    // The median and fastest of the batches' mean times per iteration.
+    Float64                     mMedianNsPerIteration;
+    Float64                     mMinNsPerIteration;
+};
+
+class BGM_BenchmarkRunner
+{
+
+public:
+                                BGM_BenchmarkRunner(bool inQuick, const std::string& inFilter);
+
+    // Times inIteration, which should do the work being measured exactly once. Any per-iteration
+    // setup it does is included in the time, so keep it small and cache-friendly.
+    void                        Run(const std::string& inName,
+                                    UInt32 inItemsPerIteration,
+                                    const std::function<void()>& inIteration);
+
+    const std::vector<BGM_BenchmarkResult>& GetResults() const { return mResults; }
+
+    // Stops the compiler from optimizing away work whose result is otherwise unused.
+    static void                 DoNotOptimize(const void* inPointer);
+
+private:
+    bool                        mQuick;
+    std::string                 mFilter;
+    std::vector<BGM_BenchmarkResult> mResults;
+
+};
+
+// Registers a suite of benchmarks. Usage:
+//
+//     BGM_BENCHMARK_SUITE(IOKernels)
+//     {
+//         inRunner.Run("IOKernels/Something/frames=512", 512, [&] { ... });
+//     }
+#define BGM_BENCHMARK_SUITE(inSuiteName)                                                    \
+    static void BGMBenchmarkSuite_##inSuiteName(BGM_BenchmarkRunner& inRunner);            \
+    static BGM_BenchmarkSuiteRegistrar sBGMBenchmarkSuiteRegistrar_##inSuiteName(         \
+        #inSuiteName, &BGMBenchmarkSuite_##inSuiteName);                                    \
+    static void BGMBenchmarkSuite_##inSuiteName(BGM_BenchmarkRunner& inRunner)
+
+class BGM_BenchmarkSuiteRegistrar
+{
+
+public:
+    typedef void                (*SuiteFunction)(BGM_BenchmarkRunner& inRunner);
+
+                                BGM_BenchmarkSuiteRegistrar(const char* inName, SuiteFunction inSuite);
+
+    static void                 RunAll(BGM_BenchmarkRunner& inRunner);
+
+};
+
+#pragma mark Test Signals
+
+namespace BGM_BenchmarkSignals
+{
+    // Fills ioBuffer with deterministic noise in [-inAmplitude, inAmplitude], so runs are
+    // repeatable and the kernels don't hit any all-zero or denormal special cases.
+    void                        FillWithNoise(std::vector<Float32>& ioBuffer,
+                                              Float32 inAmplitude,
+                                              UInt32 inSeed = 1);
+}
+
+#pragma clang assume_nonnull end
+
+#endif /* BGMDriverBenchmarks__BGM_Benchmark */
+
@@ -0,0 +1,1238 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_IOKernelsBenchmarks.cpp
+//  BGMDriverBenchmarks
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  Benchmarks for the code BGM_Device runs for each IO cycle: the per-client volume and pan
+//  (BGM_Device::ApplyClientRelativeVolume), the master volume (BGM_VolumeControl::
+//  ApplyVolumeToAudioRT), the audible state updates, the loopback ring buffer, the client map
+//  lookups, the volume curve conversions and setting app volumes. IOCycle puts them together the way BGM_Device does,
+//  to show how much of the cycle's time budget the driver uses for a given number of clients.
+//  IdleClients does the same for clients that are only sending silence, with and without the
+//  silence fast path.
+//
+
+// Local Includes
+#include "BGM_Benchmark.h"
+#include "BGM_IOKernels.h"
+#include "BGM_Limiter.h"
+#include "BGM_AudibleState.h"
+#include "BGM_TaskQueue.h"
+#include "BGM_ClientMap.h"
+#include "BGM_Client.h"
+#include "BGM_ClientDSP.h"
+#include "BGM_PackedAppVolumes.h"
+#include "BGM_PastClientStore.h"
+#include "BGM_PersistentState.h"
+#include "BGM_PropertyTable.h"
+#include "BGM_Types.h"
+
+// PublicUtility Includes
+#include "CARingBuffer.h"
+#include "CAVolumeCurve.h"
+
+// STL Includes
+#include <cstring>
+#include <string>
+#include <vector>
+
+
+#pragma clang assume_nonnull begin
+
+// The buffer sizes to sweep. The HAL's default is 512 frames. 14 is the smallest the HAL allows
+// and 4096 is a lot larger than it usually uses.
+static const UInt32 kFrameCounts[] = { 14, 64, 128, 512, 1024, 4096 };
+// The client counts to sweep for the benchmarks that loop over the clients.
+static const UInt32 kClientCounts[] = { 1, 4, 16, 64 };
+
+// The same as BGM_Device's kLoopbackRingBufferFrameSize.
+static const UInt32 kLoopbackRingBufferFrameSize = 16384;
+
+static const UInt32 kChannelCount = 2;
+
+static std::string Name(const std::string& inBase, const char* inParameter, UInt32 inValue)
+{
+    return inBase + "/" + inParameter + "=" + std::to_string(inValue);
+}
+
+#pragma mark IO Kernels
+
+BGM_BENCHMARK_SUITE(IOKernels)
+{
+    for(UInt32 theFrameCount : kFrameCounts)
+    {
+        std::vector<Float32> theSource(theFrameCount * kChannelCount);
+        BGM_BenchmarkSignals::FillWithNoise(theSource, 0.5f);
+        std::vector<Float32> theBuffer(theSource);
+        const size_t theBufferBytes = theSource.size() * sizeof(Float32);
+
+        // The kernels modify the buffer in place, so each iteration starts by copying fresh input
+        // into it. Otherwise it would decay towards zero and eventually into denormals. Copy
+        // measures just that part, to subtract from the others.
+        inRunner.Run(Name("IOKernels/Copy", "frames", theFrameCount), theFrameCount, [&] {
+            memcpy(theBuffer.data(), theSource.data(), theBufferBytes);
+            BGM_BenchmarkRunner::DoNotOptimize(theBuffer.data());
+        });
+
+        // A client left at the default volume and pan. The kernel should do nothing.
+        inRunner.Run(Name("IOKernels/ApplyPanAndRelativeVolume/default", "frames", theFrameCount),
+                     theFrameCount,
+                     [&] {
+                         memcpy(theBuffer.data(), theSource.data(), theBufferBytes);
+                         BGM_IOKernels::ApplyPanAndRelativeVolume(theBuffer.data(),
+                                                                  theFrameCount,
+                                                                  kChannelCount,
+                                                                  kAppPanCenterRawValue,
+                                                                  1.0f);
+                         BGM_BenchmarkRunner::DoNotOptimize(theBuffer.data());
+                     });
+
+        // Volume only, which includes clamping.
+        inRunner.Run(Name("IOKernels/ApplyPanAndRelativeVolume/volume", "frames", theFrameCount),
+                     theFrameCount,
+                     [&] {
+                         memcpy(theBuffer.data(), theSource.data(), theBufferBytes);
+                         BGM_IOKernels::ApplyPanAndRelativeVolume(theBuffer.data(),
+                                                                  theFrameCount,
+                                                                  kChannelCount,
+                                                                  kAppPanCenterRawValue,
+                                                                  2.5f);
+                         BGM_BenchmarkRunner::DoNotOptimize(theBuffer.data());
+                     });
+
+        // The worst case: panned and with a non-default volume.
+        inRunner.Run(Name("IOKernels/ApplyPanAndRelativeVolume/panAndVolume", "frames", theFrameCount),
+                     theFrameCount,
+                     [&] {
+                         memcpy(theBuffer.data(), theSource.data(), theBufferBytes);
+                         BGM_IOKernels::ApplyPanAndRelativeVolume(theBuffer.data(),
+                                                                  theFrameCount,
+                                                                  kChannelCount,
+                                                                  -40,
+                                                                  0.7f);
+                         BGM_BenchmarkRunner::DoNotOptimize(theBuffer.data());
+                     });
+
+        // BGM_VolumeControl::ApplyVolumeToAudioRT, minus taking the control's mutex.
+        inRunner.Run(Name("IOKernels/ApplyGain", "frames", theFrameCount), theFrameCount, [&] {
+            memcpy(theBuffer.data(), theSource.data(), theBufferBytes);
+            BGM_IOKernels::ApplyGain(theBuffer.data(), theFrameCount, kChannelCount, 0.6f);
+            BGM_BenchmarkRunner::DoNotOptimize(theBuffer.data());
+        });
+
+        // The same while the volume is changing, i.e. with the whole buffer in a BGM_GainRamp.
+        BGM_IOKernels::GainRamp theRamp;
+        theRamp.mStartGain = 0.6f;
+        theRamp.mGainPerFrame = 0.2f / static_cast<Float32>(theFrameCount);
+        theRamp.mRampFrameCount = theFrameCount;
+        theRamp.mEndGain = 0.8f;
+
+        inRunner.Run(Name("IOKernels/ApplyGain/ramp", "frames", theFrameCount), theFrameCount, [&] {
+            memcpy(theBuffer.data(), theSource.data(), theBufferBytes);
+            BGM_IOKernels::ApplyGain(theBuffer.data(), theFrameCount, kChannelCount, theRamp);
+            BGM_BenchmarkRunner::DoNotOptimize(theBuffer.data());
+        });
+
+        inRunner.Run(Name("IOKernels/ApplyPanAndRelativeVolume/volumeRamp", "frames", theFrameCount),
+                     theFrameCount,
+                     [&] {
+                         memcpy(theBuffer.data(), theSource.data(), theBufferBytes);
+                         BGM_IOKernels::ApplyPanAndRelativeVolume(theBuffer.data(),
+                                                                  theFrameCount,
+                                                                  kChannelCount,
+                                                                  kAppPanCenterRawValue,
+                                                                  theRamp);
+                         BGM_BenchmarkRunner::DoNotOptimize(theBuffer.data());
+                     });
+    }
+}
+
+#pragma mark Audible State
+
+BGM_BENCHMARK_SUITE(AudibleState)
+{
+    const UInt32 kFrameCount = 512;
+
+    // BufferIsAudible returns at the first audible sample, so silent buffers are the slow case.
+    for(bool isSilent : { false, true })
+    {
+        for(UInt32 theClientCount : kClientCounts)
+        {
+            std::vector<std::vector<Float32>> theClientBuffers(theClientCount,
+                                                               std::vector<Float32>(kFrameCount * kChannelCount, 0.0f));
+            std::vector<Float32> theMixedBuffer(kFrameCount * kChannelCount, 0.0f);
+
+            if(!isSilent)
+            {
+                for(UInt32 i = 0; i < theClientCount; i++)
+                {
+                    BGM_BenchmarkSignals::FillWithNoise(theClientBuffers[i], 0.1f, i + 1);
+                }
+
+                BGM_BenchmarkSignals::FillWithNoise(theMixedBuffer, 0.5f);
+            }
+
+            BGM_AudibleState theAudibleState;
+            Float64 theSampleTime = 0.0;
+
+            // One IO cycle: each client's buffer, then the mix. The first client is the music
+            // player.
+            auto theCycle = [&] {
+                for(UInt32 i = 0; i < theClientCount; i++)
+                {
+                    theAudibleState.UpdateWithClientIO(i == 0,
+                                                       kFrameCount,
+                                                       kChannelCount,
+                                                       theSampleTime,
+                                                       theClientBuffers[i].data());
+                }
+
+                bool theStateChanged =
+                    theAudibleState.UpdateWithMixedIO(kFrameCount,
+                                                      kChannelCount,
+                                                      theSampleTime,
+                                                      theMixedBuffer.data());
+                BGM_BenchmarkRunner::DoNotOptimize(&theStateChanged);
+
+                theSampleTime += kFrameCount;
+            };
+
+            inRunner.Run(Name(std::string("AudibleState/Cycle/") + (isSilent ? "silent" : "audible"),
+                              "clients",
+                              theClientCount),
+                         kFrameCount * theClientCount,
+                         theCycle);
+        }
+    }
+}
+
+#pragma mark Limiter
+
+BGM_BENCHMARK_SUITE(Limiter)
+{
+    // A 512-frame buffer at 48 kHz gives the IO cycle about 10.7 ms. The limiter should only take a
+    // few microseconds of that, even while every frame needs limiting.
+    const Float64 kSampleRate = 48000.0;
+
+    for(UInt32 theFrameCount : kFrameCounts)
+    {
+        for(bool isLimiting : { false, true })
+        {
+            // Noise below the knee only goes through the fast path. Noise at +6 dBFS is turned
+            // down in every frame.
+            std::vector<Float32> theSource(theFrameCount * kChannelCount);
+            BGM_BenchmarkSignals::FillWithNoise(theSource, isLimiting ? 2.0f : 0.5f);
+            std::vector<Float32> theBuffer(theSource);
+            const size_t theBufferBytes = theSource.size() * sizeof(Float32);
+
+            BGM_Limiter theLimiter;
+            const BGM_Limiter::Parameters theParameters = BGM_Limiter::GetDefaultParameters();
+
+            inRunner.Run(Name(std::string("Limiter/") + (isLimiting ? "limiting" : "idle"),
+                              "frames",
+                              theFrameCount),
+                         theFrameCount,
+                         [&] {
+                             memcpy(theBuffer.data(), theSource.data(), theBufferBytes);
+                             BGM_Limiter::Result theResult = theLimiter.ProcessRT(theBuffer.data(),
+                                                                                  theFrameCount,
+                                                                                  kChannelCount,
+                                                                                  theParameters,
+                                                                                  kSampleRate);
+                             BGM_BenchmarkRunner::DoNotOptimize(&theResult);
+                             BGM_BenchmarkRunner::DoNotOptimize(theBuffer.data());
+                         });
+        }
+    }
+}
+
+#pragma mark Client DSP
+
+BGM_BENCHMARK_SUITE(ClientDSP)
+{
+    // The cost of one client's chain, through BGM_ClientDSP so it includes checking for new
+    // settings. Each EQ band is a peak filter and the compressor is always compressing.
+    const Float64 kSampleRate = 48000.0;
+
+    struct { const char* mName; UInt32 mBandCount; bool mCompressorEnabled; } theConfigs[] = {
+        { "eq4", 4, false },
+        { "compressor", 0, true },
+        { "eq4_compressor", 4, true }
+    };
+
+    for(UInt32 theFrameCount : kFrameCounts)
+    {
+        for(auto& theConfig : theConfigs)
+        {
+            std::vector<Float32> theSource(theFrameCount * kChannelCount);
+            BGM_BenchmarkSignals::FillWithNoise(theSource, 0.5f);
+            std::vector<Float32> theBuffer(theSource);
+            const size_t theBufferBytes = theSource.size() * sizeof(Float32);
+
+            BGM_DSPChain::Settings theSettings = BGM_DSPChain::GetDefaultSettings();
+            theSettings.mBandCount = theConfig.mBandCount;
+
+            for(UInt32 i = 0; i < theConfig.mBandCount; i++)
+            {
+                theSettings.mBands[i].mFrequencyHz = 100.0f * static_cast<Float32>(1 << (2 * i));
+                theSettings.mBands[i].mGainDb = (i % 2 == 0) ? 3.0f : -3.0f;
+            }
+
+            theSettings.mCompressor.mEnabled = theConfig.mCompressorEnabled;
+            theSettings.mCompressor.mThresholdDb = -30.0f;
+
+            BGM_ClientDSP theClientDSP;
+            const SInt32 theSlot = theClientDSP.SetAppSettings(1234, BGM_String(), theSettings);
+
+            inRunner.Run(Name(std::string("ClientDSP/") + theConfig.mName, "frames", theFrameCount),
+                         theFrameCount,
+                         [&] {
+                             memcpy(theBuffer.data(), theSource.data(), theBufferBytes);
+                             theClientDSP.ProcessClientRT(7,
+                                                          theSlot,
+                                                          theBuffer.data(),
+                                                          theFrameCount,
+                                                          kChannelCount,
+                                                          kSampleRate);
+                             BGM_BenchmarkRunner::DoNotOptimize(theBuffer.data());
+                         });
+        }
+    }
+}
+
+#pragma mark Channel Layouts
+
+BGM_BENCHMARK_SUITE(ChannelLayouts)
+{
+    // The per-sample work BGM_Device does for each of the layouts BGMDevice's streams support:
+    // stereo, 5.1 and 7.1. Stereo and the surround layouts have their own instantiations of the
+    // kernels, so the time per frame should grow roughly with the number of channels, except for
+    // panning, which is a matrix multiply.
+    const UInt32 kFrameCount = 512;
+    const Float64 kSampleRate = 48000.0;
+
+    for(UInt32 theChannelCount : { 2U, 6U, 8U })
+    {
+        std::vector<Float32> theSource(kFrameCount * theChannelCount);
+        BGM_BenchmarkSignals::FillWithNoise(theSource, 0.5f);
+        std::vector<Float32> theBuffer(theSource);
+        const size_t theBufferBytes = theSource.size() * sizeof(Float32);
+
+        inRunner.Run(Name("ChannelLayouts/ApplyPanAndRelativeVolume/panAndVolume", "ch", theChannelCount),
+                     kFrameCount,
+                     [&] {
+                         memcpy(theBuffer.data(), theSource.data(), theBufferBytes);
+                         BGM_IOKernels::ApplyPanAndRelativeVolume(theBuffer.data(),
+                                                                  kFrameCount,
+                                                                  theChannelCount,
+                                                                  -40,
+                                                                  0.7f);
+                         BGM_BenchmarkRunner::DoNotOptimize(theBuffer.data());
+                     });
+
+        BGM_IOKernels::GainRamp theRamp;
+        theRamp.mStartGain = 0.6f;
+        theRamp.mGainPerFrame = 0.2f / static_cast<Float32>(kFrameCount);
+        theRamp.mRampFrameCount = kFrameCount;
+        theRamp.mEndGain = 0.8f;
+
+        inRunner.Run(Name("ChannelLayouts/ApplyGain/ramp", "ch", theChannelCount), kFrameCount, [&] {
+            memcpy(theBuffer.data(), theSource.data(), theBufferBytes);
+            BGM_IOKernels::ApplyGain(theBuffer.data(), kFrameCount, theChannelCount, theRamp);
+            BGM_BenchmarkRunner::DoNotOptimize(theBuffer.data());
+        });
+
+        // Silent buffers are the slow case for the audible state. See the AudibleState suite. The
+        // margin is BGM_AudibleState's.
+        std::vector<Float32> theSilence(kFrameCount * theChannelCount, 0.0f);
+
+        inRunner.Run(Name("ChannelLayouts/IsAudible/silent", "ch", theChannelCount), kFrameCount, [&] {
+            bool isAudible = BGM_IOKernels::IsAudible(theSilence.data(),
+                                                      kFrameCount,
+                                                      theChannelCount,
+                                                      0.0001f);
+            BGM_BenchmarkRunner::DoNotOptimize(&isAudible);
+        });
+
+        std::vector<Float32> theLoudSource(theSource);
+        BGM_BenchmarkSignals::FillWithNoise(theLoudSource, 2.0f);
+        BGM_Limiter theLimiter;
+        const BGM_Limiter::Parameters theParameters = BGM_Limiter::GetDefaultParameters();
+
+        inRunner.Run(Name("ChannelLayouts/Limiter/limiting", "ch", theChannelCount), kFrameCount, [&] {
+            memcpy(theBuffer.data(), theLoudSource.data(), theBufferBytes);
+            BGM_Limiter::Result theResult = theLimiter.ProcessRT(theBuffer.data(),
+                                                                 kFrameCount,
+                                                                 theChannelCount,
+                                                                 theParameters,
+                                                                 kSampleRate);
+            BGM_BenchmarkRunner::DoNotOptimize(&theResult);
+            BGM_BenchmarkRunner::DoNotOptimize(theBuffer.data());
+        });
+
+        BGM_DSPChain::Settings theSettings = BGM_DSPChain::GetDefaultSettings();
+        theSettings.mBandCount = 4;
+
+        for(UInt32 i = 0; i < theSettings.mBandCount; i++)
+        {
+            theSettings.mBands[i].mFrequencyHz = 100.0f * static_cast<Float32>(1 << (2 * i));
+            theSettings.mBands[i].mGainDb = (i % 2 == 0) ? 3.0f : -3.0f;
+        }
+
+        theSettings.mCompressor.mEnabled = true;
+        theSettings.mCompressor.mThresholdDb = -30.0f;
+
+        BGM_ClientDSP theClientDSP;
+        const SInt32 theSlot = theClientDSP.SetAppSettings(1234, BGM_String(), theSettings);
+
+        inRunner.Run(Name("ChannelLayouts/ClientDSP/eq4_compressor", "ch", theChannelCount),
+                     kFrameCount,
+                     [&] {
+                         memcpy(theBuffer.data(), theSource.data(), theBufferBytes);
+                         theClientDSP.ProcessClientRT(7,
+                                                      theSlot,
+                                                      theBuffer.data(),
+                                                      kFrameCount,
+                                                      theChannelCount,
+                                                      kSampleRate);
+                         BGM_BenchmarkRunner::DoNotOptimize(theBuffer.data());
+                     });
+    }
+}
+
+#pragma mark Ring Buffer
+
+BGM_BENCHMARK_SUITE(CARingBuffer)
+{
+    for(UInt32 theFrameCount : kFrameCounts)
+    {
+        std::vector<Float32> theInput(theFrameCount * kChannelCount);
+        BGM_BenchmarkSignals::FillWithNoise(theInput, 0.5f);
+        std::vector<Float32> theOutput(theFrameCount * kChannelCount);
+
+        const UInt32 theBufferBytes = static_cast<UInt32>(theInput.size() * sizeof(Float32));
+        AudioBufferList theInputList = { 1, { { kChannelCount, theBufferBytes, theInput.data() } } };
+        AudioBufferList theOutputList = { 1, { { kChannelCount, theBufferBytes, theOutput.data() } } };
+
+        // Set up like BGM_Device's loopback ring buffer.
+        CARingBuffer theRingBuffer;
+        theRingBuffer.Allocate(1, kChannelCount * sizeof(Float32), kLoopbackRingBufferFrameSize);
+
+        CARingBuffer::SampleTime theSampleTime = 0;
+
+        // Writing the mix into the ring buffer and reading it back for the input stream, as in the
+        // WriteMix and ReadInput IO operations.
+        inRunner.Run(Name("CARingBuffer/StoreFetch", "frames", theFrameCount), theFrameCount, [&] {
+            CARingBufferError theError = theRingBuffer.Store(&theInputList, theFrameCount, theSampleTime);
+            theError |= theRingBuffer.Fetch(&theOutputList, theFrameCount, theSampleTime);
+            BGM_BenchmarkRunner::DoNotOptimize(&theError);
+            BGM_BenchmarkRunner::DoNotOptimize(theOutput.data());
+
+            theSampleTime += theFrameCount;
+        });
+    }
+}
+
+#pragma mark Client Map
+
+static void AddClients(BGM_ClientMap& inClientMap, UInt32 inClientCount)
+{
+    for(UInt32 i = 0; i < inClientCount; i++)
+    {
+        std::string theBundleID = "com.example.client" + std::to_string(i);
+#if BGM_PLATFORM_MACH
+        BGM_String theBundleIDString(CFStringCreateWithCString(kCFAllocatorDefault,
+                                                               theBundleID.c_str(),
+                                                               kCFStringEncodingUTF8));
+#else
+        BGM_String theBundleIDString(theBundleID.c_str());
+#endif
+
+        AudioServerPlugInClientInfo theClientInfo = {
+            i + 1,
+            static_cast<pid_t>(1000 + i),
+            true,
+            theBundleIDString.GetCFString()
+        };
+
+        inClientMap.AddClient(BGM_Client(&theClientInfo));
+    }
+}
+
+BGM_BENCHMARK_SUITE(ClientMap)
+{
+    for(UInt32 theClientCount : kClientCounts)
+    {
+        BGM_TaskQueue theTaskQueue;
+        BGM_ClientMap theClientMap(&theTaskQueue);
+        AddClients(theClientMap, theClientCount);
+
+        // BGM_Device looks each client up at least once per IO cycle to get its volume, pan and
+        // whether it's the music player.
+        inRunner.Run(Name("ClientMap/GetClientRT", "clients", theClientCount), theClientCount, [&] {
+            BGM_Client theClient;
+
+            for(UInt32 theClientID = 1; theClientID <= theClientCount; theClientID++)
+            {
+                bool didFindClient = theClientMap.GetClientRT(theClientID, &theClient);
+                BGM_BenchmarkRunner::DoNotOptimize(&didFindClient);
+                BGM_BenchmarkRunner::DoNotOptimize(&theClient);
+            }
+        });
+
+        // Setting the music player by bundle ID compares each client's bundle ID token and swaps the
+        // shadow maps in on the task queue's real-time thread.
+        UInt32 theMusicPlayerToken = theClientMap.InternBundleID(BGM_String("com.example.client0"));
+
+        inRunner.Run(Name("ClientMap/UpdateMusicPlayerFlags", "clients", theClientCount), theClientCount, [&] {
+            theClientMap.UpdateMusicPlayerFlagsByBundleID(theMusicPlayerToken);
+        });
+    }
+}
+
+#pragma mark App Volumes
+
+// Builds a value of kAudioDeviceCustomPropertyAppVolumesPacked that sets the volumes of the clients
+// added by AddClients, by PID and bundle ID, the way BGMApp does once it's defined the tokens.
+static std::vector<UInt8> PackAppVolumes(UInt32 inAppCount, SInt32 inRawVolume, bool inDefineTokens)
+{
+    BGMAppVolumesPackedHeader theHeader = { kBGMAppVolumesPackedVersion, 1, inAppCount, inDefineTokens ? inAppCount : 0 };
+    std::vector<UInt8> theData(sizeof(theHeader) + inAppCount * sizeof(BGMAppVolumesPackedRecord));
+    memcpy(theData.data(), &theHeader, sizeof(theHeader));
+
+    for(UInt32 i = 0; i < inAppCount; i++)
+    {
+        BGMAppVolumesPackedRecord theRecord = {
+            static_cast<SInt32>(1000 + i), i, kBGMAppVolumesPackedField_RelativeVolume, inRawVolume, 0, 0
+        };
+        memcpy(theData.data() + sizeof(theHeader) + i * sizeof(theRecord), &theRecord, sizeof(theRecord));
+    }
+
+    for(UInt32 i = 0; inDefineTokens && i < inAppCount; i++)
+    {
+        std::string theBundleID = "com.example.client" + std::to_string(i);
+        BGMAppVolumesPackedBundleID theDefinition = { i, static_cast<UInt32>(theBundleID.size()) };
+        const UInt8* theDefinitionBytes = reinterpret_cast<const UInt8*>(&theDefinition);
+        theData.insert(theData.end(), theDefinitionBytes, theDefinitionBytes + sizeof(theDefinition));
+        theData.insert(theData.end(), theBundleID.begin(), theBundleID.end());
+    }
+
+    return theData;
+}
+
+BGM_BENCHMARK_SUITE(AppVolumes)
+{
+    CAVolumeCurve theCurve;
+    theCurve.AddRange(kAppRelativeVolumeMinRawValue,
+                      kAppRelativeVolumeMaxRawValue,
+                      kAppRelativeVolumeMinDbValue,
+                      kAppRelativeVolumeMaxDbValue);
+
+    for(UInt32 theAppCount : kClientCounts)
+    {
+        BGM_TaskQueue theTaskQueue;
+        BGM_ClientMap theClientMap(&theTaskQueue);
+        AddClients(theClientMap, theAppCount);
+
+        std::vector<BGM_String> theBundleIDs;
+        for(UInt32 i = 0; i < theAppCount; i++)
+        {
+            theBundleIDs.push_back(BGM_StringFromUTF8("com.example.client" + std::to_string(i)));
+        }
+
+        // Each step of a slider drag (or each app, for BGMApp's batched updates) as
+        // kAudioDeviceCustomPropertyAppVolumes applies it, not counting the CF parsing: a separate
+        // update of the client map, each waiting for the IO thread, by PID and then by bundle ID.
+        SInt32 theRawVolume = 0;
+        inRunner.Run(Name("AppVolumes/PerKey", "apps", theAppCount), theAppCount, [&] {
+            theRawVolume = (theRawVolume + 1) % (kAppRelativeVolumeMaxRawValue + 1);
+            Float32 theVolume = BGM_PackedAppVolumes::RelativeVolumeFromRaw(theCurve, theRawVolume);
+
+            for(UInt32 i = 0; i < theAppCount; i++)
+            {
+                bool didChange = theClientMap.SetClientsRelativeVolume(static_cast<pid_t>(1000 + i), theVolume);
+                didChange |= theClientMap.SetClientsRelativeVolume(theBundleIDs[i], theVolume);
+                BGM_BenchmarkRunner::DoNotOptimize(&didChange);
+            }
+        });
+
+        // The same changes through kAudioDeviceCustomPropertyAppVolumesPacked: building the value,
+        // decoding it and applying it in one update.
+        BGM_PackedAppVolumes thePacked;
+        std::vector<BGM_ClientMap::AppVolumeChange> theChanges;
+        std::vector<UInt8> theDefinitions = PackAppVolumes(theAppCount, 50, true);
+        thePacked.Decode(theDefinitions.data(), theDefinitions.size(), theCurve, theChanges);
+
+        inRunner.Run(Name("AppVolumes/Packed", "apps", theAppCount), theAppCount, [&] {
+            theRawVolume = (theRawVolume + 1) % (kAppRelativeVolumeMaxRawValue + 1);
+
+            std::vector<UInt8> theData = PackAppVolumes(theAppCount, theRawVolume, false);
+            thePacked.Decode(theData.data(), theData.size(), theCurve, theChanges);
+            bool didChange = theClientMap.SetClientsVolumesAndPans(theChanges);
+            BGM_BenchmarkRunner::DoNotOptimize(&didChange);
+        });
+    }
+}
+
+#pragma mark Past Clients
+
+BGM_BENCHMARK_SUITE(PastClients)
+{
+    for(UInt32 theCapacity : { 64u, BGM_PastClientStore::kDefaultCapacity })
+    {
+        BGM_PastClientStore theStore(theCapacity);
+
+        // One app the user set the volume of, then fill the store with tools they didn't.
+        theStore.Set(0, 0.5f, 0, true);
+
+        UInt32 theNextToken = 1;
+
+        while(theStore.GetSize() < theCapacity)
+        {
+            theStore.Set(theNextToken++, 1.0f, 0, false);
+        }
+
+        // A short-lived tool with a new bundle ID being added and removed, which evicts the least
+        // recently used tool, then the app being added again and getting its volume back.
+        inRunner.Run(Name("PastClients/Churn", "capacity", theCapacity), 1, [&] {
+            theStore.Set(theNextToken++, 1.0f, 0, false);
+            const BGM_PastClientStore::Record* theRecord = theStore.Find(0);
+            BGM_BenchmarkRunner::DoNotOptimize(&theRecord);
+        });
+    }
+}
+
+#pragma mark Persistent State
+
+BGM_BENCHMARK_SUITE(PersistentState)
+{
+    for(UInt32 theAppCount : kClientCounts)
+    {
+        BGM_TaskQueue theTaskQueue;
+        BGM_ClientMap theClientMap(&theTaskQueue);
+        AddClients(theClientMap, theAppCount);
+
+        for(UInt32 i = 0; i < theAppCount; i++)
+        {
+            theClientMap.SetClientsRelativeVolume(static_cast<pid_t>(1000 + i), 0.5f);
+        }
+
+        // What BGM_Device does (off the IO thread) each time the settings change: copy them and
+        // encode them for WriteToStorage.
+        inRunner.Run(Name("PersistentState/Encode", "apps", theAppCount), theAppCount, [&] {
+            BGM_PersistentState::State theState;
+            theState.mApps = theClientMap.CopyClientsForStorage();
+            std::vector<UInt8> theData = BGM_PersistentState::Encode(theState);
+            BGM_BenchmarkRunner::DoNotOptimize(theData.data());
+        });
+
+        BGM_PersistentState::State theState;
+        theState.mApps = theClientMap.CopyClientsForStorage();
+        std::vector<UInt8> theData = BGM_PersistentState::Encode(theState);
+
+        // What BGM_Device::Activate adds to the driver's load time. The apps have their volumes as
+        // soon as this is done.
+        inRunner.Run(Name("PersistentState/Restore", "apps", theAppCount), theAppCount, [&] {
+            BGM_PersistentState::State theDecodedState;
+            bool theStateIsValid = BGM_PersistentState::Decode(theData.data(),
+                                                               theData.size(),
+                                                               theDecodedState);
+            BGM_BenchmarkRunner::DoNotOptimize(&theStateIsValid);
+
+            BGM_ClientMap theRestoredClientMap(&theTaskQueue);
+            theRestoredClientMap.RestorePastClients(theDecodedState.mApps);
+            BGM_BenchmarkRunner::DoNotOptimize(&theRestoredClientMap);
+        });
+    }
+}
+
+#pragma mark Property Dispatch
+
+// The property operations the HAL calls. Like BGM_Object's, they're virtual, and each one is a
+// separate call that has to find the property itself.
+class BGMBenchmarkObject
+{
+public:
+    virtual ~BGMBenchmarkObject() = default;
+
+    virtual bool HasProperty(const AudioObjectPropertyAddress& inAddress) const = 0;
+    virtual bool IsPropertySettable(const AudioObjectPropertyAddress& inAddress) const = 0;
+    virtual UInt32 GetPropertyDataSize(const AudioObjectPropertyAddress& inAddress) const = 0;
+};
+
+// A stand-in for BGM_Device with the same number of properties. The selectors are the real ones,
+// written as literals because the POSIX headers don't define the HAL's.
+class BGMBenchmarkDevice
+{
+public:
+    UInt32 GetStreamsDataSize(const AudioObjectPropertyAddress& inAddress) const
+    {
+        return (inAddress.mScope == kAudioObjectPropertyScopeGlobal ? 2 : 1) * sizeof(UInt32);
+    }
+
+    static const BGM_PropertyTable<BGMBenchmarkDevice>& GetPropertyTable()
+    {
+        static constexpr BGM_PropertyDescriptor<BGMBenchmarkDevice> kProperties[] = {
+            { 'ownd', 0, 0, &BGMBenchmarkDevice::GetStreamsDataSize },
+            { 'stm#', 0, 0, &BGMBenchmarkDevice::GetStreamsDataSize },
+            { 'ctrl', 0, 3 * sizeof(UInt32), nullptr },
+            { 'ltnc', kBGMPropertyFlag_InputOutputScopes, sizeof(UInt32), nullptr },
+            { 'saft', kBGMPropertyFlag_InputOutputScopes, sizeof(UInt32), nullptr },
+            { 'dflt', kBGMPropertyFlag_InputOutputScopes, sizeof(UInt32), nullptr },
+            { 'sflt', kBGMPropertyFlag_InputOutputScopes, sizeof(UInt32), nullptr },
+            { 'nsrt', kBGMPropertyFlag_Settable, sizeof(Float64), nullptr },
+            { 'nsr#', 0, 2 * sizeof(Float64), nullptr },
+            { 'dch2', kBGMPropertyFlag_InputOutputScopes, 2 * sizeof(UInt32), nullptr },
+            { 'srnd', kBGMPropertyFlag_InputOutputScopes, 52, nullptr },
+            { 'icon', 0, sizeof(void*), nullptr },
+            { 'cust', 0, 11 * 12, nullptr },
+            { kAudioDeviceCustomPropertyDeviceAudibleState, 0, sizeof(void*), nullptr },
+            { kAudioDeviceCustomPropertyMusicPlayerProcessID, kBGMPropertyFlag_Settable, sizeof(void*), nullptr },
+            { kAudioDeviceCustomPropertyMusicPlayerBundleID, kBGMPropertyFlag_Settable, sizeof(void*), nullptr },
+            { kAudioDeviceCustomPropertyDeviceIsRunningSomewhereOtherThanBGMApp, 0, sizeof(void*), nullptr },
+            { kAudioDeviceCustomPropertyAppVolumes, kBGMPropertyFlag_Settable, sizeof(void*), nullptr },
+            { kAudioDeviceCustomPropertyEnabledOutputControls, kBGMPropertyFlag_Settable, sizeof(void*), nullptr },
+            { kAudioDeviceCustomPropertyMusicDucking, kBGMPropertyFlag_Settable, sizeof(void*), nullptr },
+            { kAudioDeviceCustomPropertyLimiter, kBGMPropertyFlag_Settable, sizeof(void*), nullptr },
+            { kAudioDeviceCustomPropertyAppDSP, kBGMPropertyFlag_Settable, sizeof(void*), nullptr },
+            { kAudioDeviceCustomPropertyAppVolumesPacked, kBGMPropertyFlag_Settable, sizeof(void*), nullptr },
+            { kAudioDeviceCustomPropertyIOStats, 0, sizeof(void*), nullptr }
+        };
+
+        static constexpr auto kPropertySlots = BGM_MakePropertySlots<BGM_PropertyShift(kProperties)>(kProperties);
+        static constexpr BGM_PropertyTable<BGMBenchmarkDevice> kPropertyTable(kPropertySlots);
+        return kPropertyTable;
+    }
+
+    // The same answers as the table, from switch statements like the ones it replaced.
+    bool HasPropertyBySwitch(const AudioObjectPropertyAddress& inAddress) const
+    {
+        switch(inAddress.mSelector)
+        {
+            case 'ownd': case 'stm#': case 'ctrl': case 'nsrt': case 'nsr#': case 'icon':
+            case 'cust':
+            case kAudioDeviceCustomPropertyDeviceAudibleState:
+            case kAudioDeviceCustomPropertyMusicPlayerProcessID:
+            case kAudioDeviceCustomPropertyMusicPlayerBundleID:
+            case kAudioDeviceCustomPropertyDeviceIsRunningSomewhereOtherThanBGMApp:
+            case kAudioDeviceCustomPropertyAppVolumes:
+            case kAudioDeviceCustomPropertyEnabledOutputControls:
+            case kAudioDeviceCustomPropertyMusicDucking:
+            case kAudioDeviceCustomPropertyLimiter:
+            case kAudioDeviceCustomPropertyAppDSP:
+            case kAudioDeviceCustomPropertyAppVolumesPacked:
+            case kAudioDeviceCustomPropertyIOStats:
+                return true;
+
+            case 'ltnc': case 'saft': case 'dflt': case 'sflt': case 'dch2': case 'srnd':
+                return (inAddress.mScope == kAudioObjectPropertyScopeInput) ||
+                        (inAddress.mScope == kAudioObjectPropertyScopeOutput);
+
+            default:
+                return false;
+        };
+    }
+
+    bool IsPropertySettableBySwitch(const AudioObjectPropertyAddress& inAddress) const
+    {
+        switch(inAddress.mSelector)
+        {
+            case 'nsrt':
+            case kAudioDeviceCustomPropertyMusicPlayerProcessID:
+            case kAudioDeviceCustomPropertyMusicPlayerBundleID:
+            case kAudioDeviceCustomPropertyAppVolumes:
+            case kAudioDeviceCustomPropertyEnabledOutputControls:
+            case kAudioDeviceCustomPropertyMusicDucking:
+            case kAudioDeviceCustomPropertyLimiter:
+            case kAudioDeviceCustomPropertyAppDSP:
+            case kAudioDeviceCustomPropertyAppVolumesPacked:
+                return true;
+
+            default:
+                return false;
+        };
+    }
+
+    UInt32 GetPropertyDataSizeBySwitch(const AudioObjectPropertyAddress& inAddress) const
+    {
+        switch(inAddress.mSelector)
+        {
+            case 'ownd': case 'stm#':
+                return GetStreamsDataSize(inAddress);
+
+            case 'ctrl':
+                return 3 * sizeof(UInt32);
+
+            case 'ltnc': case 'saft': case 'dflt': case 'sflt':
+                return sizeof(UInt32);
+
+            case 'nsrt':
+                return sizeof(Float64);
+
+            case 'nsr#':
+                return 2 * sizeof(Float64);
+
+            case 'dch2':
+                return 2 * sizeof(UInt32);
+
+            case 'srnd':
+                return 52;
+
+            case 'cust':
+                return 11 * 12;
+
+            case 'icon':
+            case kAudioDeviceCustomPropertyDeviceAudibleState:
+            case kAudioDeviceCustomPropertyMusicPlayerProcessID:
+            case kAudioDeviceCustomPropertyMusicPlayerBundleID:
+            case kAudioDeviceCustomPropertyDeviceIsRunningSomewhereOtherThanBGMApp:
+            case kAudioDeviceCustomPropertyAppVolumes:
+            case kAudioDeviceCustomPropertyEnabledOutputControls:
+            case kAudioDeviceCustomPropertyMusicDucking:
+            case kAudioDeviceCustomPropertyLimiter:
+            case kAudioDeviceCustomPropertyAppDSP:
+            case kAudioDeviceCustomPropertyAppVolumesPacked:
+            case kAudioDeviceCustomPropertyIOStats:
+                return sizeof(void*);
+
+            default:
+                return 0;
+        };
+    }
+};
+
+class BGMBenchmarkSwitchDevice : public BGMBenchmarkObject
+{
+public:
+    bool HasProperty(const AudioObjectPropertyAddress& inAddress) const override
+    {
+        return mDevice.HasPropertyBySwitch(inAddress);
+    }
+
+    bool IsPropertySettable(const AudioObjectPropertyAddress& inAddress) const override
+    {
+        return mDevice.IsPropertySettableBySwitch(inAddress);
+    }
+
+    UInt32 GetPropertyDataSize(const AudioObjectPropertyAddress& inAddress) const override
+    {
+        return mDevice.GetPropertyDataSizeBySwitch(inAddress);
+    }
+
+private:
+    BGMBenchmarkDevice mDevice;
+};
+
+// Looks properties up the way BGM_Device does.
+class BGMBenchmarkTableDevice : public BGMBenchmarkObject
+{
+public:
+    bool HasProperty(const AudioObjectPropertyAddress& inAddress) const override
+    {
+        auto theProperty = BGMBenchmarkDevice::GetPropertyTable().Find(inAddress.mSelector);
+        return (theProperty != nullptr) && theProperty->HasProperty(inAddress);
+    }
+
+    bool IsPropertySettable(const AudioObjectPropertyAddress& inAddress) const override
+    {
+        auto theProperty = BGMBenchmarkDevice::GetPropertyTable().Find(inAddress.mSelector);
+        return (theProperty != nullptr) && theProperty->IsSettable();
+    }
+
+    UInt32 GetPropertyDataSize(const AudioObjectPropertyAddress& inAddress) const override
+    {
+        auto theProperty = BGMBenchmarkDevice::GetPropertyTable().Find(inAddress.mSelector);
+        return (theProperty != nullptr) ? theProperty->GetDataSize(mDevice, inAddress) : 0;
+    }
+
+private:
+    BGMBenchmarkDevice mDevice;
+};
+
+BGM_BENCHMARK_SUITE(PropertyDispatch)
+{
+    // Roughly what the HAL and BGMApp ask for: mostly the device's own properties, in two scopes,
+    // and some that would fall through to the base classes ('lnam', 'uid ', 'clas').
+    static const AudioObjectPropertySelector kSelectors[] = {
+        'stm#', 'ltnc', 'saft', 'nsrt', 'srnd', 'dch2', 'lnam', 'uid ', 'clas', 'ctrl', 'ownd',
+        kAudioDeviceCustomPropertyAppVolumes,
+        kAudioDeviceCustomPropertyMusicPlayerBundleID,
+        kAudioDeviceCustomPropertyDeviceAudibleState,
+        kAudioDeviceCustomPropertyAppVolumesPacked,
+        kAudioDeviceCustomPropertyIOStats
+    };
+
+    std::vector<AudioObjectPropertyAddress> theAddresses;
+
+    for(AudioObjectPropertySelector theSelector : kSelectors)
+    {
+        for(AudioObjectPropertyScope theScope : { kAudioObjectPropertyScopeGlobal,
+                                                  kAudioObjectPropertyScopeOutput })
+        {
+            theAddresses.push_back({ theSelector, theScope, kAudioObjectPropertyElementMaster });
+        }
+    }
+
+    const UInt32 theAddressCount = static_cast<UInt32>(theAddresses.size());
+
+    BGMBenchmarkSwitchDevice theSwitchDevice;
+    BGMBenchmarkTableDevice theTableDevice;
+
+    // Each item is a HasProperty, IsPropertySettable and GetPropertyDataSize for one address,
+    // which is what the HAL usually asks before getting a property's data.
+    auto theRunFunc = [&] (const char* inName, const BGMBenchmarkObject* inObject) {
+        // Keep the compiler from calling the device's methods directly, since the HAL can't.
+        BGM_BenchmarkRunner::DoNotOptimize(&inObject);
+
+        inRunner.Run(inName, theAddressCount, [&] {
+            UInt32 theTotal = 0;
+
+            for(const AudioObjectPropertyAddress& theAddress : theAddresses)
+            {
+                if(inObject->HasProperty(theAddress))
+                {
+                    theTotal += inObject->IsPropertySettable(theAddress) ? 1u : 0u;
+                    theTotal += inObject->GetPropertyDataSize(theAddress);
+                }
+            }
+
+            BGM_BenchmarkRunner::DoNotOptimize(&theTotal);
+        });
+    };
+
+    theRunFunc("PropertyDispatch/Switch", &theSwitchDevice);
+    theRunFunc("PropertyDispatch/Table", &theTableDevice);
+}
+
+#pragma mark Volume Curve
+
+BGM_BENCHMARK_SUITE(CAVolumeCurve)
+{
+    // Set up like BGM_VolumeControl's curve.
+    CAVolumeCurve theMasterVolumeCurve;
+    theMasterVolumeCurve.AddRange(0, 96, -96.0f, 0.0f);
+
+    // Set up like BGM_Clients' relative volume curve.
+    CAVolumeCurve theRelativeVolumeCurve;
+    theRelativeVolumeCurve.AddRange(kAppRelativeVolumeMinRawValue,
+                                    kAppRelativeVolumeMaxRawValue,
+                                    kAppRelativeVolumeMinDbValue,
+                                    kAppRelativeVolumeMaxDbValue);
+
+    const UInt32 kConversions = 101;
+    Float32 theScalars[kConversions];
+
+    for(UInt32 i = 0; i < kConversions; i++)
+    {
+        theScalars[i] = static_cast<Float32>(i) / (kConversions - 1);
+    }
+
+    inRunner.Run("CAVolumeCurve/ConvertRawToScalar", kConversions, [&] {
+        Float32 theSum = 0.0f;
+
+        for(SInt32 theRaw = 0; theRaw < static_cast<SInt32>(kConversions); theRaw++)
+        {
+            theSum += theMasterVolumeCurve.ConvertRawToScalar(theRaw);
+        }
+
+        BGM_BenchmarkRunner::DoNotOptimize(&theSum);
+    });
+
+    inRunner.Run("CAVolumeCurve/ConvertScalarToDB", kConversions, [&] {
+        Float32 theSum = 0.0f;
+
+        for(Float32 theScalar : theScalars)
+        {
+            theSum += theMasterVolumeCurve.ConvertScalarToDB(theScalar);
+        }
+
+        BGM_BenchmarkRunner::DoNotOptimize(&theSum);
+    });
+
+    // What BGM_Clients does for each app when building the app volumes property.
+    inRunner.Run("CAVolumeCurve/ConvertScalarToRaw", kConversions, [&] {
+        SInt32 theSum = 0;
+
+        for(Float32 theScalar : theScalars)
+        {
+            theSum += theRelativeVolumeCurve.ConvertScalarToRaw(theScalar);
+        }
+
+        BGM_BenchmarkRunner::DoNotOptimize(&theSum);
+    });
+
+    // BGM_VolumeControl's kAudioLevelControlPropertyDecibelValue getter and setter.
+    inRunner.Run("CAVolumeCurve/ConvertRawToDB", kConversions, [&] {
+        Float32 theSum = 0.0f;
+
+        for(SInt32 theRaw = 0; theRaw < static_cast<SInt32>(kConversions); theRaw++)
+        {
+            theSum += theMasterVolumeCurve.ConvertRawToDB(theRaw);
+        }
+
+        BGM_BenchmarkRunner::DoNotOptimize(&theSum);
+    });
+
+    inRunner.Run("CAVolumeCurve/ConvertDBToRaw", kConversions, [&] {
+        SInt32 theSum = 0;
+
+        for(Float32 theScalar : theScalars)
+        {
+            theSum += theMasterVolumeCurve.ConvertDBToRaw((theScalar - 1.0f) * 96.0f);
+        }
+
+        BGM_BenchmarkRunner::DoNotOptimize(&theSum);
+    });
+
+    // The cost of changing the curve, which rebuilds its lookup tables.
+    inRunner.Run("CAVolumeCurve/Rebuild", 1, [&] {
+        CAVolumeCurve theCurve;
+        theCurve.AddRange(kAppRelativeVolumeMinRawValue,
+                          kAppRelativeVolumeMaxRawValue,
+                          kAppRelativeVolumeMinDbValue,
+                          kAppRelativeVolumeMaxDbValue);
+
+        BGM_BenchmarkRunner::DoNotOptimize(&theCurve);
+    });
+}
+
+#pragma mark IO Cycle
+
+BGM_BENCHMARK_SUITE(IOCycle)
+{
+    const UInt32 kIOCycleFrameCounts[] = { 128, 512 };
+
+    for(UInt32 theFrameCount : kIOCycleFrameCounts)
+    {
+        for(UInt32 theClientCount : kClientCounts)
+        {
+            BGM_TaskQueue theTaskQueue;
+            BGM_ClientMap theClientMap(&theTaskQueue);
+            AddClients(theClientMap, theClientCount);
+
+            const size_t theSampleCount = theFrameCount * kChannelCount;
+            std::vector<std::vector<Float32>> theSources(theClientCount, std::vector<Float32>(theSampleCount));
+
+            for(UInt32 i = 0; i < theClientCount; i++)
+            {
+                BGM_BenchmarkSignals::FillWithNoise(theSources[i], 0.1f, i + 1);
+            }
+
+            std::vector<Float32> theClientBuffer(theSampleCount);
+            std::vector<Float32> theMixBuffer(theSampleCount);
+
+            AudioBufferList theMixList = {
+                1, { { kChannelCount, static_cast<UInt32>(theSampleCount * sizeof(Float32)), theMixBuffer.data() } }
+            };
+
+            CARingBuffer theRingBuffer;
+            theRingBuffer.Allocate(1, kChannelCount * sizeof(Float32), kLoopbackRingBufferFrameSize);
+
+            BGM_AudibleState theAudibleState;
+            Float64 theSampleTime = 0.0;
+
+            // Roughly the work BGM_Device::DoIOOperation does for one cycle: each client's
+            // ProcessOutput (look up the client, apply its volume and pan, update the audible
+            // state, mix it in), then ProcessMix (the master volume) and WriteMix (store the mix in
+            // the loopback ring buffer). The HAL does the mixing for the real driver.
+            inRunner.Run(Name(Name("IOCycle", "frames", theFrameCount), "clients", theClientCount),
+                         theFrameCount,
+                         [&] {
+                             std::fill(theMixBuffer.begin(), theMixBuffer.end(), 0.0f);
+
+                             for(UInt32 i = 0; i < theClientCount; i++)
+                             {
+                                 BGM_Client theClient;
+                                 theClientMap.GetClientRT(i + 1, &theClient);
+
+                                 memcpy(theClientBuffer.data(), theSources[i].data(), theSampleCount * sizeof(Float32));
+
+                                 BGM_IOKernels::ApplyPanAndRelativeVolume(theClientBuffer.data(),
+                                                                          theFrameCount,
+                                                                          kChannelCount,
+                                                                          (i % 2 == 0) ? 0 : 30,
+                                                                          (i % 3 == 0) ? 1.0f : 0.8f);
+
+                                 theAudibleState.UpdateWithClientIO(i == 0,
+                                                                    theFrameCount,
+                                                                    kChannelCount,
+                                                                    theSampleTime,
+                                                                    theClientBuffer.data());
+
+                                 for(size_t j = 0; j < theSampleCount; j++)
+                                 {
+                                     theMixBuffer[j] += theClientBuffer[j];
+                                 }
+                             }
+
+                             BGM_IOKernels::ApplyGain(theMixBuffer.data(), theFrameCount, kChannelCount, 0.6f);
+                             theAudibleState.UpdateWithMixedIO(theFrameCount,
+                                                               kChannelCount,
+                                                               theSampleTime,
+                                                               theMixBuffer.data());
+
+                             CARingBufferError theError =
+                                 theRingBuffer.Store(&theMixList,
+                                                     theFrameCount,
+                                                     static_cast<CARingBuffer::SampleTime>(theSampleTime));
+                             BGM_BenchmarkRunner::DoNotOptimize(&theError);
+
+                             theSampleTime += theFrameCount;
+                         });
+        }
+    }
+}
+
+#pragma mark Idle Clients
+
+BGM_BENCHMARK_SUITE(IdleClients)
+{
+    // Apps that keep their audio output running while they aren't playing anything, e.g. browsers
+    // and chat apps, send BGMDevice buffers of silence every IO cycle.
+    const UInt32 kFrameCount = 512;
+    const UInt32 kIdleClientCount = 10;
+    const Float64 kSampleRate = 48000.0;
+    const size_t theSampleCount = kFrameCount * kChannelCount;
+
+    BGM_TaskQueue theTaskQueue;
+    BGM_ClientMap theClientMap(&theTaskQueue);
+    AddClients(theClientMap, kIdleClientCount);
+
+    // Give every client an app volume, a pan position and the EQ and compressor, so none of the
+    // per-client processing is skipped just because it has nothing to do.
+    BGM_DSPChain::Settings theSettings = BGM_DSPChain::GetDefaultSettings();
+    theSettings.mBandCount = 4;
+
+    for(UInt32 i = 0; i < theSettings.mBandCount; i++)
+    {
+        theSettings.mBands[i].mFrequencyHz = 100.0f * static_cast<Float32>(1 << (2 * i));
+        theSettings.mBands[i].mGainDb = (i % 2 == 0) ? 3.0f : -3.0f;
+    }
+
+    theSettings.mCompressor.mEnabled = true;
+    theSettings.mCompressor.mThresholdDb = -30.0f;
+
+    std::vector<Float32> theClientBuffer(theSampleCount);
+    std::vector<Float32> theMixBuffer(theSampleCount);
+    std::vector<Float32> theInputBuffer(theSampleCount);
+
+    AudioBufferList theMixList = {
+        1, { { kChannelCount, static_cast<UInt32>(theSampleCount * sizeof(Float32)), theMixBuffer.data() } }
+    };
+    AudioBufferList theInputList = {
+        1, { { kChannelCount, static_cast<UInt32>(theSampleCount * sizeof(Float32)), theInputBuffer.data() } }
+    };
+
+    // The same cycle as IOCycle, plus the clients' DSP and the loopback read, with and without the
+    // silence fast path: BGM_Device skipping the processing that wouldn't change a silent client
+    // buffer and not storing silent mixes in the loopback ring buffer.
+    for(bool theUseFastPath : { false, true })
+    {
+        BGM_ClientDSP theClientDSP;
+        const SInt32 theSlot = theClientDSP.SetAppSettings(1234, BGM_String(), theSettings);
+
+        CARingBuffer theRingBuffer;
+        theRingBuffer.Allocate(1, kChannelCount * sizeof(Float32), kLoopbackRingBufferFrameSize);
+
+        BGM_AudibleState theAudibleState;
+        Float64 theSampleTime = 0.0;
+        Float64 theSilenceStartTime = -1;
+
+        inRunner.Run(Name(Name(theUseFastPath ? "IdleClients/silenceFastPath" : "IdleClients/full",
+                               "frames",
+                               kFrameCount),
+                          "clients",
+                          kIdleClientCount),
+                     kFrameCount,
+                     [&] {
+                         std::fill(theMixBuffer.begin(), theMixBuffer.end(), 0.0f);
+
+                         for(UInt32 i = 0; i < kIdleClientCount; i++)
+                         {
+                             BGM_Client theClient;
+                             theClientMap.GetClientRT(i + 1, &theClient);
+
+                             std::fill(theClientBuffer.begin(), theClientBuffer.end(), 0.0f);
+
+                             theAudibleState.UpdateWithClientIO(false,
+                                                                kFrameCount,
+                                                                kChannelCount,
+                                                                theSampleTime,
+                                                                theClientBuffer.data());
+                             const bool theIsSilent =
+                                     theUseFastPath && theAudibleState.LastBufferWasSilent();
+
+                             if(!theIsSilent)
+                             {
+                                 BGM_IOKernels::ApplyPanAndRelativeVolume(theClientBuffer.data(),
+                                                                          kFrameCount,
+                                                                          kChannelCount,
+                                                                          30,
+                                                                          0.8f);
+                             }
+
+                             theClientDSP.ProcessClientRT(i + 1,
+                                                          theSlot,
+                                                          theClientBuffer.data(),
+                                                          kFrameCount,
+                                                          kChannelCount,
+                                                          kSampleRate,
+                                                          theIsSilent);
+
+                             for(size_t j = 0; j < theSampleCount; j++)
+                             {
+                                 theMixBuffer[j] += theClientBuffer[j];
+                             }
+                         }
+
+                         theAudibleState.UpdateWithMixedIO(kFrameCount,
+                                                           kChannelCount,
+                                                           theSampleTime,
+                                                           theMixBuffer.data());
+
+                         const CARingBuffer::SampleTime theRingBufferTime =
+                                 static_cast<CARingBuffer::SampleTime>(theSampleTime);
+
+                         // WriteMix, then ReadInput for the same frames.
+                         if(theUseFastPath && theAudibleState.LastBufferWasSilent())
+                         {
+                             if(theSilenceStartTime == -1)
+                             {
+                                 theSilenceStartTime = theSampleTime;
+                             }
+
+                             memset(theInputBuffer.data(), 0, theSampleCount * sizeof(Float32));
+                         }
+                         else
+                         {
+                             theSilenceStartTime = -1;
+                             CARingBufferError theError =
+                                     theRingBuffer.Store(&theMixList, kFrameCount, theRingBufferTime);
+                             theError = theRingBuffer.Fetch(&theInputList, kFrameCount, theRingBufferTime);
+                             BGM_BenchmarkRunner::DoNotOptimize(&theError);
+                         }
+
+                         BGM_BenchmarkRunner::DoNotOptimize(theInputBuffer.data());
+                         theSampleTime += kFrameCount;
+                     });
+    }
+}
+
+#pragma clang assume_nonnull end
+
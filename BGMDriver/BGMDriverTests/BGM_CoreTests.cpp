@@ -0,0 +1,1562 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_CoreTests.cpp
+//  BGMDriverTests
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  Smoke tests for bgm_core, mainly so the CMake build (see CMakeLists.txt) checks the platform
+//  layer actually works on the systems it builds on. The driver's XCTest tests cover the same
+//  classes in much more detail on macOS.
+//
+
+// Local Includes
+#include "BGM_Platform.h"
+#include "BGM_TaskQueue.h"
+#include "BGM_BundleIDTable.h"
+#include "BGM_ClientMap.h"
+#include "BGM_Client.h"
+#include "BGM_ClientDSP.h"
+#include "BGM_GainRamp.h"
+#include "BGM_IOKernels.h"
+#include "BGM_IOStats.h"
+#include "BGM_Limiter.h"
+#include "BGM_MusicDucker.h"
+#include "BGM_PackedAppVolumes.h"
+#include "BGM_PastClientStore.h"
+#include "BGM_PersistentState.h"
+#include "BGM_PropertyTable.h"
+#include "BGM_AudibleState.h"
+#include "BGM_BoostStage.h"
+#include "BGM_Types.h"
+
+// PublicUtility Includes
+#include "CAException.h"
+#include "CARingBuffer.h"
+#include "CAVolumeCurve.h"
+
+// STL Includes
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+static int sFailures = 0;
+
+#define BGMCheck(inCondition)                                                               \
+    if(!(inCondition))                                                                      \
+    {                                                                                       \
+        fprintf(stderr, "%s:%d: Check failed: %s\n", __FILE__, __LINE__, #inCondition);    \
+        sFailures++;                                                                        \
+    }
+
+static void TestHostTime()
+{
+    UInt64 theStart = BGM_Platform::GetCurrentHostTime();
+    UInt64 theEnd = BGM_Platform::GetCurrentHostTime();
+    BGMCheck(theEnd >= theStart);
+    
+    UInt64 theOneSecond = BGM_Platform::ConvertNanosToHostTime(NSEC_PER_SEC);
+    BGMCheck(std::fabs(static_cast<Float64>(theOneSecond) - BGM_Platform::GetHostClockFrequency()) < 2.0);
+    BGMCheck(BGM_Platform::ConvertHostTimeToNanos(theOneSecond) > (NSEC_PER_SEC - 1000));
+}
+
+static void TestSemaphore()
+{
+    BGM_Semaphore theSemaphore;
+    
+    // Nothing's signalled it yet.
+    BGMCheck(!theSemaphore.TimedWait(NSEC_PER_MSEC));
+    
+    theSemaphore.Signal();
+    BGMCheck(theSemaphore.TimedWait(NSEC_PER_MSEC));
+    
+    // SignalAll only wakes threads that are already waiting.
+    theSemaphore.SignalAll();
+    BGMCheck(!theSemaphore.TimedWait(NSEC_PER_MSEC));
+}
+
+static void TestClientMap()
+{
+    BGM_TaskQueue theTaskQueue;
+    BGM_ClientMap theClientMap(&theTaskQueue);
+    
+    AudioServerPlugInClientInfo theClientInfo = { 7, 1234, true, "com.example.client" };
+    BGM_Client theClient(&theClientInfo);
+    
+    // Adding the client swaps the shadow maps in on the task queue's real-time thread.
+    theClientMap.AddClient(theClient);
+    
+    BGM_Client theClientFromMap;
+    BGMCheck(theClientMap.GetClientRT(7, &theClientFromMap));
+    BGMCheck(theClientFromMap.mProcessID == 1234);
+    // The map's records only keep the bundle ID's token.
+    BGMCheck(!theClientFromMap.mBundleID.IsValid());
+    BGMCheck(theClientFromMap.mBundleIDToken == theClientMap.FindBundleID(BGM_String("com.example.client")));
+    BGMCheck(theClientMap.GetClientNonRT(7, &theClientFromMap));
+    BGMCheck(theClientFromMap.mBundleID == BGM_String("com.example.client"));
+    
+    BGMCheck(theClientMap.SetClientsRelativeVolume(BGM_String("com.example.client"), 0.5f));
+    BGMCheck(theClientMap.GetClientRT(7, &theClientFromMap));
+    BGMCheck(theClientFromMap.mRelativeVolume == 0.5f);
+    BGMCheck(theClientMap.CopyClientsWithNonDefaultVolumeOrPan().size() == 1);
+    
+    BGMCheck(theClientFromMap.mDSPSlot == -1);
+    BGMCheck(theClientMap.SetClientsDSPSlot(1234, 3));
+    BGMCheck(theClientMap.GetClientRT(7, &theClientFromMap));
+    BGMCheck(theClientFromMap.mDSPSlot == 3);
+    
+    theClientMap.RemoveClient(7);
+    BGMCheck(!theClientMap.GetClientRT(7, &theClientFromMap));
+}
+
+static void TestClientMapSharedKeys()
+{
+    BGM_TaskQueue theTaskQueue;
+    BGM_ClientMap theClientMap(&theTaskQueue);
+    
+    // Two clients from the same process and a third from another process with the same bundle ID.
+    AudioServerPlugInClientInfo theClientInfos[] = {
+        { 1, 100, true, "com.example.shared" },
+        { 2, 100, true, "com.example.shared" },
+        { 3, 200, true, "com.example.shared" }
+    };
+    
+    for(const AudioServerPlugInClientInfo& theClientInfo : theClientInfos)
+    {
+        theClientMap.AddClient(BGM_Client(&theClientInfo));
+    }
+    
+    // Removing a client should leave the others findable by PID and bundle ID.
+    BGM_Client theRemovedClient = theClientMap.RemoveClient(1);
+    BGMCheck(theRemovedClient.mBundleID == BGM_String("com.example.shared"));
+    BGMCheck(theClientMap.GetClientsByPID(100).size() == 1);
+    BGMCheck(theClientMap.GetClientsByPID(100)[0].mBundleID == BGM_String("com.example.shared"));
+    BGMCheck(theClientMap.SetClientsRelativeVolume(BGM_String("com.example.shared"), 0.25f));
+    
+    BGM_Client theClientFromMap;
+    BGMCheck(theClientMap.GetClientRT(2, &theClientFromMap) && theClientFromMap.mRelativeVolume == 0.25f);
+    BGMCheck(theClientMap.GetClientRT(3, &theClientFromMap) && theClientFromMap.mRelativeVolume == 0.25f);
+    BGMCheck(!theClientMap.SetClientsRelativeVolume(BGM_String("com.example.other"), 0.5f));
+    
+    // The music player flags are matched by token.
+    theClientMap.UpdateMusicPlayerFlagsByBundleID(theClientMap.FindBundleID(BGM_String("com.example.shared")));
+    BGMCheck(theClientMap.GetClientRT(3, &theClientFromMap) && theClientFromMap.mIsMusicPlayer);
+    theClientMap.UpdateMusicPlayerFlagsByBundleID(BGM_BundleIDTable::kNoBundleID);
+    BGMCheck(theClientMap.GetClientRT(3, &theClientFromMap) && !theClientFromMap.mIsMusicPlayer);
+    
+    // Once they're all removed, a new client with the bundle ID gets their last settings.
+    theClientMap.RemoveClient(2);
+    theClientMap.RemoveClient(3);
+    BGMCheck(theClientMap.GetClientsByPID(100).empty());
+    
+    std::vector<BGM_Client> theStoredClients = theClientMap.CopyClientsForStorage();
+    BGMCheck(theStoredClients.size() == 1);
+    BGMCheck(theStoredClients[0].mBundleID == BGM_String("com.example.shared"));
+    BGMCheck(theStoredClients[0].mProcessID == -1 && theStoredClients[0].mRelativeVolume == 0.25f);
+    
+    BGMDeviceIOStats theStats = {};
+    theClientMap.GetPastClientStats(theStats);
+    BGMCheck(theStats.mPastClients.mCount == 1);
+    BGMCheck(theStats.mPastClients.mCapacity == BGM_PastClientStore::kDefaultCapacity);
+    BGMCheck(theStats.mPastClients.mEvictions == 0);
+    
+    AudioServerPlugInClientInfo theNewClientInfo = { 4, 300, true, "com.example.shared" };
+    theClientMap.AddClient(BGM_Client(&theNewClientInfo));
+    BGMCheck(theClientMap.GetClientRT(4, &theClientFromMap) && theClientFromMap.mRelativeVolume == 0.25f);
+    
+    // Batched changes for apps that aren't clients are kept for when they're added. The second change only
+    // sets the pan position, so the volume from the first is kept.
+    BGM_String theAbsentBundleID("com.example.absent");
+    BGM_ClientMap::AppVolumeChange theAbsentChange;
+    theAbsentChange.mBundleID = &theAbsentBundleID;
+    theAbsentChange.mSetsRelativeVolume = true;
+    theAbsentChange.mRelativeVolume = 0.5f;
+    BGMCheck(!theClientMap.SetClientsVolumesAndPans({ theAbsentChange }));
+    
+    theAbsentChange.mSetsRelativeVolume = false;
+    theAbsentChange.mSetsPanPosition = true;
+    theAbsentChange.mPanPosition = -50;
+    BGMCheck(!theClientMap.SetClientsVolumesAndPans({ theAbsentChange }));
+    
+    AudioServerPlugInClientInfo theAbsentClientInfo = { 5, 400, true, "com.example.absent" };
+    theClientMap.AddClient(BGM_Client(&theAbsentClientInfo));
+    BGMCheck(theClientMap.GetClientRT(5, &theClientFromMap));
+    BGMCheck(theClientFromMap.mRelativeVolume == 0.5f && theClientFromMap.mPanPosition == -50);
+}
+
+static void TestClientMapBundleIDsBounded()
+{
+    BGM_TaskQueue theTaskQueue;
+    BGM_ClientMap theClientMap(&theTaskQueue);
+    
+    // Many short-lived clients with unique bundle IDs, e.g. command-line tools. Once the past clients are
+    // full, each new one evicts a record, which should free that record's bundle ID.
+    const UInt32 theClientCount = 4 * BGM_PastClientStore::kDefaultCapacity;
+    
+    for(UInt32 i = 0; i < theClientCount; i++)
+    {
+        std::string theBundleID = "com.example.tool" + std::to_string(i);
+        AudioServerPlugInClientInfo theClientInfo = { i + 1, static_cast<pid_t>(1000 + i), true, theBundleID.c_str() };
+        
+        theClientMap.AddClient(BGM_Client(&theClientInfo));
+        theClientMap.RemoveClient(i + 1);
+        
+        BGMCheck(theClientMap.GetBundleIDCount() <= BGM_PastClientStore::kDefaultCapacity);
+    }
+    
+    BGMCheck(theClientMap.GetBundleIDCount() == BGM_PastClientStore::kDefaultCapacity);
+    BGMCheck(theClientMap.FindBundleID(BGM_String("com.example.tool0")) == BGM_BundleIDTable::kNoBundleID);
+    
+    // A client's bundle ID keeps its token while the client exists, even after its record is evicted.
+    AudioServerPlugInClientInfo theLongLivedClientInfo = { theClientCount + 1, 99, true, "com.example.longlived" };
+    theClientMap.AddClient(BGM_Client(&theLongLivedClientInfo));
+    
+    for(UInt32 i = 0; i < BGM_PastClientStore::kDefaultCapacity; i++)
+    {
+        BGM_String theBundleID(("com.example.absent" + std::to_string(i)).c_str());
+        BGM_ClientMap::AppVolumeChange theChange;
+        theChange.mBundleID = &theBundleID;
+        theChange.mSetsRelativeVolume = true;
+        theChange.mRelativeVolume = 0.5f;
+        theClientMap.SetClientsVolumesAndPans({ theChange });
+    }
+    
+    BGMCheck(theClientMap.FindBundleID(BGM_String("com.example.longlived")) != BGM_BundleIDTable::kNoBundleID);
+    BGMCheck(theClientMap.GetBundleIDCount() == BGM_PastClientStore::kDefaultCapacity + 1);
+    
+    BGM_Client theRemovedClient = theClientMap.RemoveClient(theClientCount + 1);
+    BGMCheck(theRemovedClient.mBundleID == BGM_String("com.example.longlived"));
+    BGMCheck(theClientMap.GetBundleIDCount() <= BGM_PastClientStore::kDefaultCapacity);
+}
+
+static void TestBundleIDTable()
+{
+    BGM_BundleIDTable theTable;
+    
+    BGMCheck(theTable.Intern(BGM_String()) == BGM_BundleIDTable::kNoBundleID);
+    BGMCheck(theTable.Find(BGM_String("com.example.one")) == BGM_BundleIDTable::kNoBundleID);
+    
+    // Tokens are dense and stable.
+    BGMCheck(theTable.Intern(BGM_String("com.example.one")) == 0);
+    BGMCheck(theTable.Intern(BGM_String("com.example.two")) == 1);
+    BGMCheck(theTable.Intern(BGM_String("com.example.one")) == 0);
+    BGMCheck(theTable.Find(BGM_String("com.example.two")) == 1);
+    BGMCheck(theTable.GetSize() == 2);
+    
+    BGMCheck(theTable.GetBundleID(1) == BGM_String("com.example.two"));
+    BGMCheck(!theTable.GetBundleID(2).IsValid());
+    BGMCheck(!theTable.GetBundleID(BGM_BundleIDTable::kNoBundleID).IsValid());
+    
+    // "com.example.one" was interned twice, so it keeps its token until it's released twice.
+    theTable.Release(0);
+    BGMCheck(theTable.Find(BGM_String("com.example.one")) == 0);
+    theTable.Release(0);
+    BGMCheck(theTable.Find(BGM_String("com.example.one")) == BGM_BundleIDTable::kNoBundleID);
+    BGMCheck(!theTable.GetBundleID(0).IsValid());
+    BGMCheck(theTable.GetSize() == 1);
+    
+    // Releasing a free token does nothing.
+    theTable.Release(0);
+    theTable.Release(BGM_BundleIDTable::kNoBundleID);
+    BGMCheck(theTable.GetSize() == 1);
+    
+    // Freed tokens are reused.
+    BGMCheck(theTable.Intern(BGM_String("com.example.three")) == 0);
+    BGMCheck(theTable.Intern(BGM_String("com.example.four")) == 2);
+    BGMCheck(theTable.GetBundleID(0) == BGM_String("com.example.three"));
+    
+    theTable.Retain(1);
+    theTable.Release(1);
+    theTable.Release(1);
+    BGMCheck(theTable.GetSize() == 2);
+    theTable.Release(1);
+    BGMCheck(theTable.Find(BGM_String("com.example.two")) == BGM_BundleIDTable::kNoBundleID);
+}
+
+static void TestPastClientStore()
+{
+    BGM_PastClientStore theStore(3);
+    
+    theStore.Set(BGM_BundleIDTable::kNoBundleID, 0.5f, 0, false);
+    BGMCheck(theStore.GetSize() == 0);
+    BGMCheck(theStore.Find(0) == nullptr);
+    
+    // Token 1 is set by the user, so it's kept even though it's the least recently used.
+    theStore.Set(1, 0.5f, 10, true);
+    theStore.Set(2, 1.0f, 0, false);
+    theStore.Set(3, 1.0f, 0, false);
+    BGMCheck(theStore.GetSize() == 3);
+    
+    // Finding a record makes it the most recently used, so 3 is evicted rather than 2.
+    BGMCheck(theStore.Find(2) != nullptr);
+    BGMCheck(theStore.Contains(3));
+    BGMCheck(theStore.Set(4, 2.0f, -20, false) == 3);
+    BGMCheck(theStore.GetSize() == 3 && theStore.GetEvictionCount() == 1);
+    BGMCheck(!theStore.Contains(3));
+    BGMCheck(theStore.Find(3) == nullptr);
+    BGMCheck(theStore.Find(2) != nullptr);
+    
+    const BGM_PastClientStore::Record* theRecord = theStore.Find(1);
+    BGMCheck(theRecord != nullptr && theRecord->mRelativeVolume == 0.5f && theRecord->mPanPosition == 10);
+    BGMCheck(theRecord != nullptr && (theRecord->mFlags & BGM_PastClientStore::kFlag_UserSet) != 0);
+    
+    // Recording the settings again when a client is removed doesn't clear the flag.
+    theStore.Set(1, 0.25f, 10, false);
+    theRecord = theStore.Find(1);
+    BGMCheck(theRecord != nullptr && theRecord->mRelativeVolume == 0.25f);
+    BGMCheck(theRecord != nullptr && (theRecord->mFlags & BGM_PastClientStore::kFlag_UserSet) != 0);
+    
+    // Once every record is user-set, the least recently used one is evicted.
+    theStore.Set(2, 1.0f, 0, true);
+    theStore.Set(4, 1.0f, 0, true);
+    theStore.Find(1);
+    BGMCheck(theStore.Set(5, 1.0f, 0, true) == 2);
+    BGMCheck(theStore.Find(2) == nullptr);
+    BGMCheck(theStore.Find(1) != nullptr && theStore.Find(4) != nullptr && theStore.Find(5) != nullptr);
+    BGMCheck(theStore.GetEvictionCount() == 2);
+    
+    UInt32 theRecordCount = 0;
+    theStore.ForEach([&] (const BGM_PastClientStore::Record&) { theRecordCount++; });
+    BGMCheck(theRecordCount == 3);
+}
+
+static void TestPersistentState()
+{
+    BGM_PersistentState::State theState;
+    theState.mVolumeControlEnabled = false;
+    theState.mMuteControlEnabled = true;
+    theState.mMusicPlayerBundleID = BGM_String("com.example.player");
+    
+    BGM_Client theApp;
+    theApp.mBundleID = BGM_String("com.example.app");
+    theApp.mRelativeVolume = 0.25f;
+    theApp.mPanPosition = -40;
+    theState.mApps.push_back(theApp);
+    
+    // Apps without bundle IDs can't be matched after a restart, so they aren't saved.
+    theApp.mBundleID = BGM_String();
+    theState.mApps.push_back(theApp);
+    
+    std::vector<UInt8> theData = BGM_PersistentState::Encode(theState);
+    
+    BGM_PersistentState::State theDecodedState;
+    BGMCheck(BGM_PersistentState::Decode(theData.data(), theData.size(), theDecodedState));
+    BGMCheck(!theDecodedState.mVolumeControlEnabled);
+    BGMCheck(theDecodedState.mMuteControlEnabled);
+    BGMCheck(theDecodedState.mMusicPlayerBundleID == BGM_String("com.example.player"));
+    BGMCheck(theDecodedState.mApps.size() == 1);
+    BGMCheck(theDecodedState.mApps[0].mBundleID == BGM_String("com.example.app"));
+    BGMCheck(theDecodedState.mApps[0].mRelativeVolume == 0.25f);
+    BGMCheck(theDecodedState.mApps[0].mPanPosition == -40);
+    
+    // An unset music player round-trips as an invalid string.
+    BGM_PersistentState::State theDefaultState;
+    std::vector<UInt8> theDefaultData = BGM_PersistentState::Encode(theDefaultState);
+    BGMCheck(BGM_PersistentState::Decode(theDefaultData.data(), theDefaultData.size(), theDecodedState));
+    BGMCheck(!theDecodedState.mMusicPlayerBundleID.IsValid());
+    BGMCheck(theDecodedState.mApps.empty());
+    
+    // Every truncation is rejected, as are trailing bytes.
+    bool theTruncationsRejected = true;
+    for(size_t theSize = 0; theSize < theData.size(); theSize++)
+    {
+        BGM_PersistentState::State theIgnoredState;
+        theTruncationsRejected &= !BGM_PersistentState::Decode(theData.data(), theSize, theIgnoredState);
+    }
+    BGMCheck(theTruncationsRejected);
+    
+    std::vector<UInt8> theLongData = theData;
+    theLongData.push_back(0);
+    BGMCheck(!BGM_PersistentState::Decode(theLongData.data(), theLongData.size(), theDecodedState));
+    BGMCheck(!BGM_PersistentState::Decode(nullptr, 0, theDecodedState));
+    
+    // A newer format version.
+    std::vector<UInt8> theNewerData = theData;
+    theNewerData[4]++;
+    BGMCheck(!BGM_PersistentState::Decode(theNewerData.data(), theNewerData.size(), theDecodedState));
+    
+    // Out of range values.
+    theState.mApps.resize(1);
+    theState.mApps[0].mRelativeVolume = 5.0f;
+    theData = BGM_PersistentState::Encode(theState);
+    BGMCheck(!BGM_PersistentState::Decode(theData.data(), theData.size(), theDecodedState));
+    
+    theState.mApps[0].mRelativeVolume = std::nanf("");
+    theData = BGM_PersistentState::Encode(theState);
+    BGMCheck(!BGM_PersistentState::Decode(theData.data(), theData.size(), theDecodedState));
+    
+    theState.mApps[0].mRelativeVolume = 1.0f;
+    theState.mApps[0].mPanPosition = 101;
+    theData = BGM_PersistentState::Encode(theState);
+    BGMCheck(!BGM_PersistentState::Decode(theData.data(), theData.size(), theDecodedState));
+    
+    // The failed decodes didn't change the last decoded state.
+    BGMCheck(!theDecodedState.mMusicPlayerBundleID.IsValid());
+    
+    // Restoring the apps' settings into a client map, as BGM_Device does when it's activated.
+    BGM_TaskQueue theTaskQueue;
+    BGM_ClientMap theClientMap(&theTaskQueue);
+    
+    theApp.mBundleID = BGM_String("com.example.app");
+    theApp.mRelativeVolume = 2.0f;
+    theApp.mPanPosition = 50;
+    theClientMap.RestorePastClients(std::vector<BGM_Client>(1, theApp));
+    
+    AudioServerPlugInClientInfo theClientInfo = { 7, 1234, true, "com.example.app" };
+    theClientMap.AddClient(BGM_Client(&theClientInfo));
+    
+    BGM_Client theClientFromMap;
+    BGMCheck(theClientMap.GetClientRT(7, &theClientFromMap));
+    BGMCheck(theClientFromMap.mRelativeVolume == 2.0f);
+    BGMCheck(theClientFromMap.mPanPosition == 50);
+    
+    // The current client's settings are saved instead of the older ones from the past clients.
+    BGMCheck(theClientMap.SetClientsRelativeVolume(BGM_String("com.example.app"), 0.5f));
+    std::vector<BGM_Client> theClientsForStorage = theClientMap.CopyClientsForStorage();
+    BGMCheck(theClientsForStorage.size() == 1);
+    BGMCheck(theClientsForStorage.size() == 1 && theClientsForStorage[0].mRelativeVolume == 0.5f);
+    
+    // Apps at the default settings aren't saved.
+    BGMCheck(theClientMap.SetClientsRelativeVolume(BGM_String("com.example.app"), 1.0f));
+    BGMCheck(theClientMap.SetClientsPanPosition(BGM_String("com.example.app"), 0));
+    BGMCheck(theClientMap.CopyClientsForStorage().empty());
+}
+
+// Builds a value of kAudioDeviceCustomPropertyAppVolumesPacked.
+static std::vector<UInt8> PackAppVolumes(UInt32 inSessionID,
+                                         const std::vector<BGMAppVolumesPackedRecord>& inRecords,
+                                         const std::vector<std::pair<UInt32, std::string>>& inBundleIDs)
+{
+    BGMAppVolumesPackedHeader theHeader = { kBGMAppVolumesPackedVersion,
+                                            inSessionID,
+                                            static_cast<UInt32>(inRecords.size()),
+                                            static_cast<UInt32>(inBundleIDs.size()) };
+    
+    std::vector<UInt8> theData(sizeof(theHeader) + inRecords.size() * sizeof(BGMAppVolumesPackedRecord));
+    memcpy(theData.data(), &theHeader, sizeof(theHeader));
+    if(!inRecords.empty())
+    {
+        memcpy(theData.data() + sizeof(theHeader),
+               inRecords.data(),
+               inRecords.size() * sizeof(BGMAppVolumesPackedRecord));
+    }
+    
+    for(const auto& theBundleID : inBundleIDs)
+    {
+        BGMAppVolumesPackedBundleID theDefinition = { theBundleID.first,
+                                                      static_cast<UInt32>(theBundleID.second.size()) };
+        const UInt8* theDefinitionBytes = reinterpret_cast<const UInt8*>(&theDefinition);
+        theData.insert(theData.end(), theDefinitionBytes, theDefinitionBytes + sizeof(theDefinition));
+        theData.insert(theData.end(), theBundleID.second.begin(), theBundleID.second.end());
+    }
+    
+    return theData;
+}
+
+static void TestPackedAppVolumes()
+{
+    CAVolumeCurve theCurve;
+    theCurve.AddRange(kAppRelativeVolumeMinRawValue,
+                      kAppRelativeVolumeMaxRawValue,
+                      kAppRelativeVolumeMinDbValue,
+                      kAppRelativeVolumeMaxDbValue);
+    
+    BGM_TaskQueue theTaskQueue;
+    BGM_ClientMap theClientMap(&theTaskQueue);
+    
+    AudioServerPlugInClientInfo theClientInfoA = { 7, 1234, true, "com.example.a" };
+    AudioServerPlugInClientInfo theClientInfoB = { 8, 1235, true, "com.example.b" };
+    theClientMap.AddClient(BGM_Client(&theClientInfoA));
+    theClientMap.AddClient(BGM_Client(&theClientInfoB));
+    
+    BGM_PackedAppVolumes thePacked;
+    std::vector<BGM_ClientMap::AppVolumeChange> theChanges;
+    
+    // Set app A's volume by bundle ID, defining its token, and app B's pan position by PID.
+    BGMAppVolumesPackedRecord theRecordA = { -1, 3, kBGMAppVolumesPackedField_RelativeVolume, 75, 0, 0 };
+    BGMAppVolumesPackedRecord theRecordB =
+            { 1235, kBGMAppVolumesPackedNoBundleID, kBGMAppVolumesPackedField_PanPosition, 0, -60, 0 };
+    std::vector<UInt8> theData = PackAppVolumes(42, { theRecordA, theRecordB }, { { 3, "com.example.a" } });
+    
+    thePacked.Decode(theData.data(), theData.size(), theCurve, theChanges);
+    BGMCheck(thePacked.GetSessionID() == 42);
+    BGMCheck(theChanges.size() == 2);
+    BGMCheck(theChanges.size() == 2 && theChanges[0].mBundleID != nullptr && theChanges[1].mBundleID == nullptr);
+    BGMCheck(theClientMap.SetClientsVolumesAndPans(theChanges));
+    
+    Float32 theExpectedVolume = BGM_PackedAppVolumes::RelativeVolumeFromRaw(theCurve, 75);
+    BGM_Client theClientFromMap;
+    BGMCheck(theClientMap.GetClientRT(7, &theClientFromMap));
+    BGMCheck(theClientFromMap.mRelativeVolume == theExpectedVolume);
+    BGMCheck(theClientFromMap.mPanPosition == 0);
+    BGMCheck(theClientMap.GetClientRT(8, &theClientFromMap));
+    BGMCheck(theClientFromMap.mRelativeVolume == 1.0f);
+    BGMCheck(theClientFromMap.mPanPosition == -60);
+    
+    // The middle of the range leaves the volume unchanged.
+    BGMCheck(std::fabs(BGM_PackedAppVolumes::RelativeVolumeFromRaw(theCurve, 50) - 1.0f) < 0.001f);
+    
+    // Later values in the same session can use the token without defining it again.
+    theRecordA.mFields = kBGMAppVolumesPackedField_PanPosition;
+    theRecordA.mPanPosition = 30;
+    theData = PackAppVolumes(42, { theRecordA }, {});
+    thePacked.Decode(theData.data(), theData.size(), theCurve, theChanges);
+    BGMCheck(theClientMap.SetClientsVolumesAndPans(theChanges));
+    BGMCheck(theClientMap.GetClientRT(7, &theClientFromMap));
+    BGMCheck(theClientFromMap.mPanPosition == 30);
+    BGMCheck(theClientFromMap.mRelativeVolume == theExpectedVolume);
+    
+    auto theDecodeFails = [&] (const std::vector<UInt8>& inData) {
+        std::vector<BGM_ClientMap::AppVolumeChange> theIgnoredChanges;
+        try
+        {
+            thePacked.Decode(inData.data(), inData.size(), theCurve, theIgnoredChanges);
+        }
+        catch(const BGM_InvalidClientRelativeVolumeException&)
+        {
+            return true;
+        }
+        return false;
+    };
+    
+    // Undefined tokens, including ones defined in an earlier session, are rejected.
+    BGMAppVolumesPackedRecord theUndefinedRecord = theRecordA;
+    theUndefinedRecord.mBundleIDToken = 4;
+    BGMCheck(theDecodeFails(PackAppVolumes(42, { theUndefinedRecord }, {})));
+    BGMCheck(theDecodeFails(PackAppVolumes(43, { theRecordA }, {})));
+    // Failing didn't forget the session's definitions.
+    BGMCheck(thePacked.GetSessionID() == 42);
+    BGMCheck(!theDecodeFails(PackAppVolumes(42, { theRecordA }, {})));
+    
+    // Invalid records.
+    BGMAppVolumesPackedRecord theInvalidRecord = theRecordA;
+    theInvalidRecord.mFields = 0;
+    BGMCheck(theDecodeFails(PackAppVolumes(42, { theInvalidRecord }, {})));
+    theInvalidRecord = theRecordA;
+    theInvalidRecord.mFlags = 1;
+    BGMCheck(theDecodeFails(PackAppVolumes(42, { theInvalidRecord }, {})));
+    theInvalidRecord = theRecordA;
+    theInvalidRecord.mFields = kBGMAppVolumesPackedField_RelativeVolume;
+    theInvalidRecord.mRelativeVolume = kAppRelativeVolumeMaxRawValue + 1;
+    BGMCheck(theDecodeFails(PackAppVolumes(42, { theInvalidRecord }, {})));
+    theInvalidRecord = theRecordA;
+    theInvalidRecord.mPanPosition = kAppPanLeftRawValue - 1;
+    BGMCheck(theDecodeFails(PackAppVolumes(42, { theInvalidRecord }, {})));
+    theInvalidRecord = theRecordB;
+    theInvalidRecord.mProcessID = -1;
+    BGMCheck(theDecodeFails(PackAppVolumes(42, { theInvalidRecord }, {})));
+    
+    // Invalid definitions.
+    BGMCheck(theDecodeFails(PackAppVolumes(42, {}, { { kBGMAppVolumesPackedMaxTokens, "com.example.c" } })));
+    BGMCheck(theDecodeFails(PackAppVolumes(42, {}, { { 5, "" } })));
+    BGMCheck(theDecodeFails(PackAppVolumes(42, {}, { { 5, std::string("com\0example", 11) } })));
+    BGMCheck(theDecodeFails(PackAppVolumes(42, {}, { { 5, std::string(kBGMAppVolumesPackedMaxBundleIDLength + 1, 'a') } })));
+    
+    // Every truncation is rejected, as are trailing bytes and other versions.
+    theData = PackAppVolumes(42, { theRecordA, theRecordB }, { { 3, "com.example.a" } });
+    bool theTruncationsRejected = true;
+    for(size_t theSize = 0; theSize < theData.size(); theSize++)
+    {
+        theTruncationsRejected &= theDecodeFails(std::vector<UInt8>(theData.begin(), theData.begin() + static_cast<long>(theSize)));
+    }
+    BGMCheck(theTruncationsRejected);
+    
+    std::vector<UInt8> theLongData = theData;
+    theLongData.push_back(0);
+    BGMCheck(theDecodeFails(theLongData));
+    
+    std::vector<UInt8> theNewerData = theData;
+    theNewerData[0]++;
+    BGMCheck(theDecodeFails(theNewerData));
+    
+    // None of the failures changed the clients.
+    BGMCheck(theClientMap.GetClientRT(7, &theClientFromMap));
+    BGMCheck(theClientFromMap.mPanPosition == 30);
+}
+
+static void TestRingBuffer()
+{
+    const UInt32 kFrames = 512;
+    std::vector<Float32> theInput(kFrames * 2), theOutput(kFrames * 2, 0.0f);
+    
+    for(UInt32 i = 0; i < kFrames * 2; i++)
+    {
+        theInput[i] = static_cast<Float32>(i) / (kFrames * 2);
+    }
+    
+    CARingBuffer theRingBuffer;
+    theRingBuffer.Allocate(1, 2 * sizeof(Float32), 4096);
+    
+    AudioBufferList theInputList = { 1, { { 2, kFrames * 2 * sizeof(Float32), theInput.data() } } };
+    AudioBufferList theOutputList = { 1, { { 2, kFrames * 2 * sizeof(Float32), theOutput.data() } } };
+    
+    BGMCheck(theRingBuffer.Store(&theInputList, kFrames, 1000) == kCARingBufferError_OK);
+    BGMCheck(theRingBuffer.Fetch(&theOutputList, kFrames, 1000) == kCARingBufferError_OK);
+    BGMCheck(theInput == theOutput);
+}
+
+static void TestIOKernels()
+{
+    Float32 theBuffer[] = { 0.5f, 0.25f, -0.5f, 0.0f };
+    
+    // Fully right: the left channel crossfeeds into the right.
+    BGM_IOKernels::ApplyPanAndRelativeVolume(theBuffer, 2, 2, kAppPanRightRawValue, 1.0f);
+    BGMCheck(theBuffer[0] == 0.0f && theBuffer[1] == 0.75f);
+    BGMCheck(theBuffer[2] == 0.0f && theBuffer[3] == -0.5f);
+    
+    // Clamped to [-1, 1].
+    BGM_IOKernels::ApplyPanAndRelativeVolume(theBuffer, 2, 2, kAppPanCenterRawValue, 4.0f);
+    BGMCheck(theBuffer[1] == 1.0f && theBuffer[3] == -1.0f);
+    
+    BGM_IOKernels::ApplyGain(theBuffer, 2, 2, 0.5f);
+    BGMCheck(theBuffer[1] == 0.5f && theBuffer[3] == -0.5f);
+
+    // 7.1 (L R C LFE Ls Rs Rls Rrs): panning halfway left moves half of each right channel into
+    // the left channel of its pair. The centre and LFE channels aren't panned.
+    Float32 theSurround[] = { 0.1f, 0.2f, 0.3f, 0.4f, 0.5f, 0.3f, 0.6f, 0.2f };
+    BGM_IOKernels::ApplyPanAndRelativeVolume(theSurround, 1, 8, kAppPanLeftRawValue / 2, 1.0f);
+    BGMCheck(std::fabs(theSurround[0] - 0.2f) < 1e-6f && std::fabs(theSurround[1] - 0.1f) < 1e-6f);
+    BGMCheck(theSurround[2] == 0.3f && theSurround[3] == 0.4f);
+    BGMCheck(std::fabs(theSurround[4] - 0.65f) < 1e-6f && std::fabs(theSurround[5] - 0.15f) < 1e-6f);
+    BGMCheck(std::fabs(theSurround[6] - 0.7f) < 1e-6f && std::fabs(theSurround[7] - 0.1f) < 1e-6f);
+
+    // Each layout gets the same gain ramp. The generic kernel handles the channel counts without
+    // their own.
+    for(UInt32 theChannelCount : { 1U, 2U, 4U, 6U, 8U })
+    {
+        std::vector<Float32> theRamped(16 * theChannelCount, 1.0f);
+        BGM_IOKernels::GainRamp theRamp = { 0.0f, 0.125f, 8, 1.0f };
+        BGM_IOKernels::ApplyGain(theRamped.data(), 16, theChannelCount, theRamp);
+
+        bool theChannelsMatch = true;
+
+        for(UInt32 theFrame = 0; theFrame < 16; theFrame++)
+        {
+            const Float32 theExpected = std::min(1.0f, theFrame * 0.125f);
+
+            for(UInt32 theChannel = 0; theChannel < theChannelCount; theChannel++)
+            {
+                theChannelsMatch = theChannelsMatch &&
+                        std::fabs(theRamped[theFrame * theChannelCount + theChannel] - theExpected) < 1e-6f;
+            }
+        }
+
+        BGMCheck(theChannelsMatch);
+    }
+
+    // Audio in any channel, not just the first two, makes the buffer audible.
+    std::vector<Float32> theQuiet(64 * 6, 0.0f);
+    BGMCheck(!BGM_IOKernels::IsAudible(theQuiet.data(), 64, 6, 0.01f));
+    theQuiet[40 * 6 + 3] = 0.5f;
+    BGMCheck(BGM_IOKernels::IsAudible(theQuiet.data(), 64, 6, 0.01f));
+
+    // Digital silence is told apart from audio that's only inaudible, e.g. a DC offset or a
+    // very quiet tail.
+    std::vector<Float32> theSilence(64 * 2, 0.0f);
+    BGMCheck(BGM_IOKernels::GetAudibility(theSilence.data(), 64, 2, 0.01f) ==
+             BGM_IOKernels::Audibility::Silent);
+    theSilence[63 * 2 + 1] = 0.001f;
+    BGMCheck(BGM_IOKernels::GetAudibility(theSilence.data(), 64, 2, 0.01f) ==
+             BGM_IOKernels::Audibility::Inaudible);
+    theSilence[63 * 2 + 1] = -0.0f;
+    BGMCheck(BGM_IOKernels::GetAudibility(theSilence.data(), 64, 2, 0.01f) ==
+             BGM_IOKernels::Audibility::Silent);
+    BGMCheck(BGM_IOKernels::GetAudibility(theQuiet.data(), 64, 6, 0.01f) ==
+             BGM_IOKernels::Audibility::Audible);
+    // The scan works in blocks of frames, so check frames after the last whole block as well.
+    theSilence[58 * 2] = 0.5f;
+    BGMCheck(BGM_IOKernels::GetAudibility(theSilence.data(), 59, 2, 0.01f) ==
+             BGM_IOKernels::Audibility::Audible);
+    BGMCheck(BGM_IOKernels::GetAudibility(theSilence.data(), 58, 2, 0.01f) ==
+             BGM_IOKernels::Audibility::Silent);
+    theSilence[58 * 2] = 0.0f;
+
+    // BGM_AudibleState remembers whether the last buffer it scanned was silent.
+    BGM_AudibleState theAudibleState;
+    BGMCheck(!theAudibleState.LastBufferWasSilent());
+    theAudibleState.UpdateWithClientIO(false, 64, 2, 0.0, theSilence.data());
+    BGMCheck(theAudibleState.LastBufferWasSilent());
+    theAudibleState.UpdateWithClientIO(false, 64, 6, 0.0, theQuiet.data());
+    BGMCheck(!theAudibleState.LastBufferWasSilent());
+    // Once a non-music client has made the frames audible, the other clients' buffers for them
+    // aren't scanned, so they aren't known to be silent.
+    theAudibleState.UpdateWithClientIO(false, 64, 2, 0.0, theSilence.data());
+    BGMCheck(!theAudibleState.LastBufferWasSilent());
+    theAudibleState.UpdateWithMixedIO(64, 2, 0.0, theSilence.data());
+    BGMCheck(theAudibleState.LastBufferWasSilent());
+}
+
+static void TestIOStats()
+{
+    BGM_IOStats theIOStats;
+    
+    // Two IO cycles with a 10 ms deadline. The first takes 1 + 2 + 4 = 7 ms, the second 12 ms.
+    theIOStats.RecordOperation(kBGMIOStatsOperation_ProcessOutput, 1, 10000000, 1000000);
+    theIOStats.RecordOperation(kBGMIOStatsOperation_ProcessOutput, 1, 10000000, 2000000);
+    theIOStats.RecordOperation(kBGMIOStatsOperation_WriteMix, 1, 10000000, 4000000);
+    theIOStats.RecordOperation(kBGMIOStatsOperation_GetZeroTimeStamp, 0, 0, 100);
+    theIOStats.RecordOperation(kBGMIOStatsOperation_WriteMix, 2, 10000000, 12000000);
+    
+    BGMDeviceIOStats theStats;
+    theIOStats.GetStats(theStats);
+    
+    BGMCheck(theStats.mVersion == kBGMIOStatsVersion);
+    BGMCheck(theStats.mOperations[kBGMIOStatsOperation_ProcessOutput].mCount == 2);
+    BGMCheck(theStats.mOperations[kBGMIOStatsOperation_ProcessOutput].mTotalNs == 3000000);
+    BGMCheck(theStats.mOperations[kBGMIOStatsOperation_ProcessOutput].mMaxNs == 2000000);
+    // 2^19 <= 1 ms < 2^20 and 2^20 <= 2 ms < 2^21.
+    BGMCheck(theStats.mOperations[kBGMIOStatsOperation_ProcessOutput].mHistogram[19] == 1);
+    BGMCheck(theStats.mOperations[kBGMIOStatsOperation_ProcessOutput].mHistogram[20] == 1);
+    BGMCheck(theStats.mOperations[kBGMIOStatsOperation_GetZeroTimeStamp].mHistogram[6] == 1);
+    // The second cycle is still in progress, so only the first has been counted.
+    BGMCheck(theStats.mOperations[kBGMIOStatsOperation_Cycle].mCount == 1);
+    BGMCheck(theStats.mOperations[kBGMIOStatsOperation_Cycle].mMaxNs == 7000000);
+    BGMCheck(theStats.mDeadlineMisses == 0);
+    
+    theIOStats.IOThreadWillStop();
+    theIOStats.GetStats(theStats);
+    BGMCheck(theStats.mOperations[kBGMIOStatsOperation_Cycle].mCount == 2);
+    BGMCheck(theStats.mOperations[kBGMIOStatsOperation_Cycle].mMaxNs == 12000000);
+    BGMCheck(theStats.mDeadlineMisses == 1);
+    
+    // Another thread's operations are recorded separately and summed.
+    std::thread theOtherThread([&theIOStats] {
+        theIOStats.RecordOperation(kBGMIOStatsOperation_ReadInput, 7, 10000000, 0);
+        theIOStats.IOThreadWillStop();
+    });
+    theOtherThread.join();
+    
+    theIOStats.GetStats(theStats);
+    BGMCheck(theStats.mOperations[kBGMIOStatsOperation_ReadInput].mCount == 1);
+    BGMCheck(theStats.mOperations[kBGMIOStatsOperation_ReadInput].mHistogram[0] == 1);
+    BGMCheck(theStats.mOperations[kBGMIOStatsOperation_Cycle].mCount == 3);
+    BGMCheck(theStats.mUnrecordedOperations == 0);
+}
+
+static void TestVolumeCurve()
+{
+    // Set up like BGM_Clients' relative volume curve.
+    CAVolumeCurve theCurve;
+    theCurve.AddRange(kAppRelativeVolumeMinRawValue,
+                      kAppRelativeVolumeMaxRawValue,
+                      kAppRelativeVolumeMinDbValue,
+                      kAppRelativeVolumeMaxDbValue);
+    
+    // The lookup tables should give the same answers CAVolumeCurve used to calculate.
+    for(SInt32 theRaw = -1; theRaw <= 101; theRaw++)
+    {
+        SInt32 theClampedRaw = std::min(100, std::max(0, theRaw));
+        BGMCheck(theCurve.ConvertRawToScalar(theRaw) == powf(theClampedRaw / 100.0f, 2.0f));
+        BGMCheck(theCurve.ConvertRawToDB(theRaw) == -96.0f + (theClampedRaw * 0.96f));
+    }
+    
+    bool theScalarsMatch = true;
+    
+    for(UInt32 i = 0; i <= 10000; i++)
+    {
+        Float32 theScalar = i / 10000.0f;
+        SInt32 theExpectedRaw = static_cast<SInt32>(roundf(powf(theScalar, 0.5f) * 100.0f));
+        theScalarsMatch = theScalarsMatch && (theCurve.ConvertScalarToRaw(theScalar) == theExpectedRaw);
+    }
+    
+    BGMCheck(theScalarsMatch);
+    BGMCheck(theCurve.ConvertScalarToRaw(-1.0f) == 0);
+    BGMCheck(theCurve.ConvertScalarToRaw(2.0f) == 100);
+    
+    // Set up like BGM_VolumeControl's curve.
+    CAVolumeCurve theMasterCurve;
+    theMasterCurve.AddRange(0, 96, -96.0f, 0.0f);
+    
+    bool theDBsMatch = true;
+    
+    for(SInt32 i = -1000; i <= 10; i++)
+    {
+        Float32 theDB = i / 10.0f;
+        SInt32 theExpectedRaw = static_cast<SInt32>(roundf(std::max(-96.0f, std::min(0.0f, theDB)) + 96.0f));
+        theDBsMatch = theDBsMatch && (theMasterCurve.ConvertDBToRaw(theDB) == theExpectedRaw);
+    }
+    
+    BGMCheck(theDBsMatch);
+    
+    // The tables are rebuilt when the curve changes.
+    theMasterCurve.SetTransferFunction(CAVolumeCurve::kPow4Over1Curve);
+    BGMCheck(theMasterCurve.ConvertRawToScalar(48) == powf(0.5f, 4.0f));
+    BGMCheck(theMasterCurve.ConvertScalarToRaw(powf(0.5f, 4.0f)) == 48);
+    
+    theMasterCurve.ResetRange();
+    theMasterCurve.AddRange(0, 10, -20.0f, 0.0f);
+    BGMCheck(theMasterCurve.GetMaximumRaw() == 10);
+    BGMCheck(theMasterCurve.ConvertDBToRaw(-10.0f) == 5);
+    
+    // Copies share the tables.
+    CAVolumeCurve theCopy = theCurve;
+    BGMCheck(theCopy.ConvertScalarToRaw(0.25f) == 50);
+}
+
+// Runs a constant signal through a series of differently-sized IO buffers, changing the target gain
+// between (and during) ramps, and returns the left channel of the output.
+static std::vector<Float32> RunGainRamp(bool inUseClientRamps, UInt32 inRampLengthFrames)
+{
+    const UInt32 kBufferSizes[] = { 64, 37, 512, 100, 1, 256, 333, 128 };
+    const Float32 kTargets[] = { 1.0f, 0.25f, 0.25f, 3.0f, 0.0f, 0.0f, 1.5f, 1.5f };
+    const Float32 kInput = 0.25f;
+
+    BGM_GainRamp theRamp(1.0f);
+    BGM_ClientGainRamps theClientRamps;
+    theClientRamps.SetRampLengthFrames(inRampLengthFrames);
+
+    std::vector<Float32> theOutput;
+
+    for(UInt32 theCycle = 0; theCycle < 48; theCycle++)
+    {
+        const UInt32 theFrames = kBufferSizes[theCycle % 8];
+        const Float32 theTarget = kTargets[(theCycle / 3) % 8];
+        std::vector<Float32> theBuffer(theFrames * 2, kInput);
+
+        if(inUseClientRamps)
+        {
+            BGM_IOKernels::ApplyPanAndRelativeVolume(theBuffer.data(),
+                                                     theFrames,
+                                                     2,
+                                                     kAppPanCenterRawValue,
+                                                     theClientRamps.NextBufferRT(7,
+                                                                                 theTarget,
+                                                                                 theFrames));
+        }
+        else
+        {
+            BGM_IOKernels::ApplyGain(theBuffer.data(),
+                                     theFrames,
+                                     2,
+                                     theRamp.NextBuffer(theTarget, theFrames, inRampLengthFrames));
+        }
+
+        for(UInt32 i = 0; i < theFrames; i++)
+        {
+            BGMCheck(theBuffer[i * 2] == theBuffer[i * 2 + 1]);
+            theOutput.push_back(theBuffer[i * 2]);
+        }
+    }
+
+    return theOutput;
+}
+
+static Float32 MaxSampleToSampleChange(const std::vector<Float32>& inSamples)
+{
+    Float32 theMaxChange = 0.0f;
+
+    for(size_t i = 1; i < inSamples.size(); i++)
+    {
+        theMaxChange = std::max(theMaxChange, std::fabs(inSamples[i] - inSamples[i - 1]));
+    }
+
+    return theMaxChange;
+}
+
+static void TestGainRamp()
+{
+    const UInt32 kRampLength = 300;
+    // The largest change in gain is 3.0, so with the 0.25 input no step should be larger than
+    // 0.75 / kRampLength, across buffer boundaries included.
+    const Float32 kMaxStep = 0.75f / kRampLength * 1.01f;
+
+    std::vector<Float32> theOutput = RunGainRamp(false, kRampLength);
+    BGMCheck(MaxSampleToSampleChange(theOutput) <= kMaxStep);
+    // The ramps finish exactly on their targets.
+    BGMCheck(theOutput.back() == 0.25f * 1.5f);
+
+    // The relative volume is clamped, but none of these samples go over 1.0.
+    std::vector<Float32> theClientOutput = RunGainRamp(true, kRampLength);
+    BGMCheck(MaxSampleToSampleChange(theClientOutput) <= kMaxStep);
+    BGMCheck(theClientOutput.back() == 0.25f * 1.5f);
+
+    // Without ramps the gain jumps.
+    BGMCheck(MaxSampleToSampleChange(RunGainRamp(false, 0)) == 0.75f);
+
+    // A ramp that's still going at the end of a buffer continues in the next one.
+    BGM_GainRamp theRamp(0.0f);
+    BGM_IOKernels::GainRamp theFirst = theRamp.NextBuffer(1.0f, 100, 400);
+    BGMCheck(theFirst.mStartGain == 0.0f && theFirst.mRampFrameCount == 100);
+    BGMCheck(theRamp.IsRamping());
+    BGM_IOKernels::GainRamp theSecond = theRamp.NextBuffer(1.0f, 512, 400);
+    BGMCheck(theSecond.mStartGain == 0.25f && theSecond.mRampFrameCount == 300);
+    BGMCheck(theSecond.mEndGain == 1.0f && !theRamp.IsRamping());
+
+    // New clients start at their target gain.
+    BGM_ClientGainRamps theClientRamps;
+    BGM_IOKernels::GainRamp theNewClient = theClientRamps.NextBufferRT(1, 2.0f, 512);
+    BGMCheck(theNewClient.mRampFrameCount == 0 && theNewClient.mEndGain == 2.0f);
+
+    // The ramp length defaults to kDefaultLengthFrames and is clamped when it's set.
+    BGMCheck(theClientRamps.GetRampLengthFrames() == BGM_GainRamp::kDefaultLengthFrames);
+    BGMCheck(theClientRamps.NextBufferRT(1, 1.0f, 16).mRampFrameCount == 16);
+    theClientRamps.SetRampLengthFrames(BGM_GainRamp::kMaxLengthFrames + 1);
+    BGMCheck(theClientRamps.GetRampLengthFrames() == BGM_GainRamp::kMaxLengthFrames);
+    theClientRamps.SetRampLengthFrames(0);
+    BGMCheck(theClientRamps.GetRampLengthFrames() == 0);
+    BGMCheck(BGM_GainRamp::ClampLengthFrames(UINT32_MAX) == BGM_GainRamp::kMaxLengthFrames);
+}
+
+static void TestMusicDucker()
+{
+    const UInt32 kFrames = 512;
+    const Float64 kSampleRate = 48000.0;
+
+    BGM_MusicDucker theDucker;
+    BGM_AudibleState theAudibleState;
+
+    // Disabled by default, so the music isn't touched.
+    BGM_IOKernels::GainRamp theGain = theDucker.NextMusicBufferRT(kFrames, 0.0, 1000.0, kSampleRate);
+    BGMCheck(theGain.mRampFrameCount == 0 && theGain.mEndGain == 1.0f);
+
+    BGM_MusicDucker::Parameters theParameters = BGM_MusicDucker::GetDefaultParameters();
+    theParameters.mEnabled = true;
+    theParameters.mDepthDb = -20.0f;
+    theParameters.mAttackMs = 5.0f;    // 240 frames
+    theParameters.mHoldMs = 100.0f;    // 4800 frames
+    theParameters.mReleaseMs = 50.0f;  // 2400 frames
+    theDucker.SetParameters(theParameters);
+
+    std::vector<Float32> theSilence(kFrames * 2, 0.0f);
+    std::vector<Float32> theTone(kFrames * 2);
+    for(UInt32 i = 0; i < kFrames * 2; i++)
+    {
+        theTone[i] = ((i / 2) % 2 == 0) ? 0.5f : -0.5f;
+    }
+
+    std::vector<Float32> theMusicGains;
+    UInt32 theFirstDuckedCycle = 0;
+    UInt32 theLastDuckedCycle = 0;
+
+    // Another app plays audio from cycle 10 to cycle 20. Half the time the HAL processes the music
+    // player's buffer first.
+    for(UInt32 theCycle = 0; theCycle < 60; theCycle++)
+    {
+        const Float64 theSampleTime = 1000.0 + theCycle * kFrames;
+        const bool theOtherAppIsPlaying = (theCycle >= 10) && (theCycle <= 20);
+        const bool theMusicFirst = (theCycle % 2 == 0);
+
+        if(!theMusicFirst)
+        {
+            theAudibleState.UpdateWithClientIO(false, kFrames, 2, theSampleTime,
+                                               theOtherAppIsPlaying ? theTone.data() : theSilence.data());
+        }
+
+        std::vector<Float32> theMusic(kFrames * 2, 1.0f);
+        BGM_IOKernels::ApplyGain(theMusic.data(),
+                                 kFrames,
+                                 2,
+                                 theDucker.NextMusicBufferRT(kFrames,
+                                                             theSampleTime,
+                                                             theAudibleState.GetLatestAudibleNonMusicSampleTime(),
+                                                             kSampleRate));
+
+        if(theMusicFirst)
+        {
+            theAudibleState.UpdateWithClientIO(false, kFrames, 2, theSampleTime,
+                                               theOtherAppIsPlaying ? theTone.data() : theSilence.data());
+        }
+
+        for(UInt32 i = 0; i < kFrames; i++)
+        {
+            theMusicGains.push_back(theMusic[i * 2]);
+        }
+
+        if(theMusic[kFrames * 2 - 1] < 0.11f)
+        {
+            theFirstDuckedCycle = (theFirstDuckedCycle == 0) ? theCycle : theFirstDuckedCycle;
+            theLastDuckedCycle = theCycle;
+        }
+    }
+
+    // Ducked to -20 dB within the first IO cycle after the other audio starts, or the same one if
+    // the HAL processed the other app's buffer first.
+    BGMCheck(theFirstDuckedCycle == 10 || theFirstDuckedCycle == 11);
+    // Held for 100 ms after the other audio stops and then released.
+    BGMCheck(theLastDuckedCycle >= 20 + 4800 / kFrames);
+    BGMCheck(theLastDuckedCycle <= 21 + 4800 / kFrames);
+    BGMCheck(theMusicGains.back() == 1.0f);
+
+    // The gain ramps rather than jumping. The attack is the fastest change: 0.9 over 240 frames.
+    BGMCheck(MaxSampleToSampleChange(theMusicGains) <= 0.9f / 240.0f * 1.01f);
+
+    // With two music player clients, the ramp still only advances once per IO cycle. Duck and then
+    // release, which takes 2400 frames, i.e. five cycles.
+    BGM_MusicDucker theTwoClientDucker;
+    theTwoClientDucker.SetParameters(theParameters);
+    theTwoClientDucker.NextMusicBufferRT(kFrames, 0.0, 1.0, kSampleRate);
+
+    Float32 thePreviousEndGain = 0.1f;
+    UInt32 theReleaseCycles = 0;
+
+    for(UInt32 theCycle = 1; theCycle < 20; theCycle++)
+    {
+        const Float64 theSampleTime = 10000.0 + theCycle * kFrames;
+        BGM_IOKernels::GainRamp theFirst =
+                theTwoClientDucker.NextMusicBufferRT(kFrames, theSampleTime, 1.0, kSampleRate);
+        BGM_IOKernels::GainRamp theSecond =
+                theTwoClientDucker.NextMusicBufferRT(kFrames, theSampleTime, 1.0, kSampleRate);
+
+        BGMCheck(theFirst.mStartGain == theSecond.mStartGain);
+        BGMCheck(theFirst.mEndGain == theSecond.mEndGain);
+        BGMCheck(theFirst.mRampFrameCount == theSecond.mRampFrameCount);
+        BGMCheck(std::fabs(theFirst.mStartGain - thePreviousEndGain) < 1e-5f);
+
+        thePreviousEndGain = theFirst.mEndGain;
+        theReleaseCycles += (theFirst.mRampFrameCount > 0) ? 1 : 0;
+    }
+
+    BGMCheck(theReleaseCycles == (2400 + kFrames - 1) / kFrames);
+
+    // Out of range settings are clamped.
+    theParameters.mDepthDb = 10.0f;
+    theParameters.mHoldMs = -1.0f;
+    theDucker.SetParameters(theParameters);
+    BGMCheck(theDucker.GetParameters().mDepthDb == 0.0f);
+    BGMCheck(theDucker.GetParameters().mHoldMs == 0.0f);
+}
+
+static void TestLimiter()
+{
+    const UInt32 kLookahead = BGM_Limiter::kLookaheadFrames;
+    const Float64 kSampleRate = 48000.0;
+    const BGM_Limiter::Parameters kParameters = BGM_Limiter::GetDefaultParameters();
+    const Float32 kCeiling = powf(10.0f, kParameters.mThresholdDb / 20.0f);
+
+    // A one-second stereo signal that's quiet, then has a loud part with the left channel four
+    // times the right, then is quiet again. The buffer sizes don't divide the lookahead.
+    const UInt32 kFrames = 48000;
+    std::vector<Float32> theInput(kFrames * 2);
+
+    for(UInt32 i = 0; i < kFrames; i++)
+    {
+        const Float32 theLevel = (i >= 10000 && i < 20000) ? 2.0f : 0.25f;
+        const Float32 theSine = sinf(static_cast<Float32>(i) * 0.05f);
+        theInput[i * 2] = theLevel * theSine;
+        theInput[i * 2 + 1] = theLevel * 0.25f * theSine;
+    }
+
+    BGM_Limiter theLimiter;
+    std::vector<Float32> theOutput(theInput);
+    UInt32 theLimitedFrameCount = 0;
+    Float32 theMaxGainReductionDb = 0.0f;
+
+    for(UInt32 theOffset = 0; theOffset < kFrames; theOffset += 500)
+    {
+        BGM_Limiter::Result theResult = theLimiter.ProcessRT(theOutput.data() + theOffset * 2,
+                                                             std::min(500U, kFrames - theOffset),
+                                                             2,
+                                                             kParameters,
+                                                             kSampleRate);
+        theLimitedFrameCount += theResult.mLimitedFrameCount;
+        theMaxGainReductionDb = std::max(theMaxGainReductionDb, theResult.mMaxGainReductionDb);
+    }
+
+    bool thePeaksAreUnderTheCeiling = true;
+    bool theQuietPartIsOnlyDelayed = true;
+    bool theChannelsAreLinked = true;
+    bool theReleased = true;
+
+    for(UInt32 i = kLookahead; i < kFrames; i++)
+    {
+        const Float32 theLeft = theOutput[i * 2];
+        const Float32 theRight = theOutput[i * 2 + 1];
+        const Float32 theInputLeft = theInput[(i - kLookahead) * 2];
+        const Float32 theInputRight = theInput[(i - kLookahead) * 2 + 1];
+
+        thePeaksAreUnderTheCeiling &= (std::fabs(theLeft) <= kCeiling * 1.0001f);
+        theChannelsAreLinked &= (std::fabs(theLeft * theInputRight - theRight * theInputLeft) < 1e-6f);
+
+        if(i < 10000)
+        {
+            theQuietPartIsOnlyDelayed &= (theLeft == theInputLeft) && (theRight == theInputRight);
+        }
+        else if(i > 40000)
+        {
+            // Released back to (within 0.01 dB of) unity.
+            theReleased &= (std::fabs(theLeft - theInputLeft) <= std::fabs(theInputLeft) * 0.0012f);
+        }
+    }
+
+    BGMCheck(thePeaksAreUnderTheCeiling);
+    BGMCheck(theQuietPartIsOnlyDelayed);
+    BGMCheck(theChannelsAreLinked);
+    BGMCheck(theReleased);
+    // The first frames are the delay line's initial silence.
+    BGMCheck(theOutput[0] == 0.0f && theOutput[kLookahead * 2 - 1] == 0.0f);
+    // The loud part is 2.0 at its peaks, so it needs about 7 dB of gain reduction.
+    BGMCheck(theMaxGainReductionDb > 6.5f && theMaxGainReductionDb < 7.5f);
+    BGMCheck(theLimitedFrameCount >= 10000);
+    // The gain starts ramping down before the loud part comes out of the delay line.
+    UInt32 theFramesTurnedDownEarly = 0;
+
+    for(UInt32 i = 10000; i < 10000 + kLookahead; i++)
+    {
+        theFramesTurnedDownEarly +=
+                (std::fabs(theOutput[i * 2]) < std::fabs(theInput[(i - kLookahead) * 2]) * 0.99f) ? 1 : 0;
+    }
+
+    BGMCheck(theFramesTurnedDownEarly > kLookahead / 2);
+
+    // The limiters' stats.
+    BGM_IOStats theStats;
+    theStats.RecordLimiter(kBGMIOStatsLimiter_Mix, 512, 100, 3.0f);
+    theStats.RecordLimiter(kBGMIOStatsLimiter_Mix, 512, 0, 0.0f);
+
+    BGMDeviceIOStats theDeviceStats;
+    theStats.GetStats(theDeviceStats);
+    BGMCheck(theDeviceStats.mLimiters[kBGMIOStatsLimiter_Mix].mFrameCount == 1024);
+    BGMCheck(theDeviceStats.mLimiters[kBGMIOStatsLimiter_Mix].mLimitedFrameCount == 100);
+    BGMCheck(theDeviceStats.mLimiters[kBGMIOStatsLimiter_Mix].mMaxGainReductionDb == 3.0f);
+    BGMCheck(theDeviceStats.mLimiters[kBGMIOStatsLimiter_Mix].mLatestGainReductionDb == 0.0f);
+    BGMCheck(theDeviceStats.mLimiters[kBGMIOStatsLimiter_Clients].mFrameCount == 0);
+
+    // Each client gets its own limiter, so one client's peaks don't turn the others down.
+    BGM_Limiters theLimiters;
+    BGM_Limiters::Settings theSettings = theLimiters.GetSettings();
+    BGMCheck(!theSettings.mClientsEnabled && !theSettings.mMixEnabled);
+    BGMCheck(theLimiters.GetLatencyFrames() == 0);
+
+    // Each enabled stage adds the lookahead to the device's latency.
+    theSettings.mMixEnabled = true;
+    theLimiters.SetSettings(theSettings);
+    BGMCheck(theLimiters.GetLatencyFrames() == kLookahead);
+    theSettings.mClientsEnabled = true;
+    theLimiters.SetSettings(theSettings);
+    BGMCheck(theLimiters.GetLatencyFrames() == 2 * kLookahead);
+
+    std::vector<Float32> theLoud(512 * 2, 2.0f);
+    std::vector<Float32> theQuiet(512 * 2, 0.25f);
+    theLimiters.ProcessClientRT(1, theLoud.data(), 512, 2, kSampleRate);
+    BGMCheck(theLimiters.ProcessClientRT(2, theQuiet.data(), 512, 2, kSampleRate).mLimitedFrameCount == 0);
+    BGMCheck(theQuiet.back() == 0.25f);
+
+    // With 5.1, a peak in one of the surround channels turns every channel down.
+    BGM_Limiter theSurroundLimiter;
+    std::vector<Float32> theSurround(4096 * 6, 0.25f);
+
+    for(UInt32 i = 0; i < 4096; i++)
+    {
+        theSurround[i * 6 + 4] = 2.0f;
+    }
+
+    BGM_Limiter::Result theSurroundResult = theSurroundLimiter.ProcessRT(theSurround.data(),
+                                                                         4096,
+                                                                         6,
+                                                                         kParameters,
+                                                                         kSampleRate);
+    BGMCheck(theSurroundResult.mLimitedFrameCount > 0);
+    BGMCheck(theSurround[4095 * 6 + 4] <= kCeiling * 1.001f);
+    BGMCheck(std::fabs(theSurround[4095 * 6] / theSurround[4095 * 6 + 4] - 0.125f) < 1e-4f);
+
+    // Unsupported numbers of channels are left alone.
+    std::vector<Float32> theTooMany(16 * 9, 2.0f);
+    BGMCheck(theSurroundLimiter.ProcessRT(theTooMany.data(), 16, 9, kParameters, kSampleRate).mLimitedFrameCount == 0);
+    BGMCheck(theTooMany.back() == 2.0f);
+
+    // Out of range settings are clamped.
+    theSettings.mParameters.mThresholdDb = 3.0f;
+    theSettings.mParameters.mKneeDb = NAN;
+    theLimiters.SetSettings(theSettings);
+    BGMCheck(theLimiters.GetSettings().mParameters.mThresholdDb == 0.0f);
+    BGMCheck(theLimiters.GetSettings().mParameters.mKneeDb == 0.0f);
+}
+
+static void TestBoostStage()
+{
+    const Float64 kSampleRate = 48000.0;
+    const UInt32 kLookahead = BGM_Limiter::kLookaheadFrames;
+
+    BGM_Limiters theLimiters;
+    BGM_BoostStage theBoostStage(theLimiters);
+
+    // At 0 dB the main device doesn't do ProcessMix, doesn't add the mix limiter's latency and
+    // passes silent mixes through as silent.
+    BGMCheck(!theBoostStage.NeedsUpdate(0.0f));
+    BGMCheck(!theBoostStage.Update(0.0f));
+    BGMCheck(!theBoostStage.WillDoProcessMix(false));
+    BGMCheck(theBoostStage.WillDoProcessMix(true));
+    BGMCheck(theLimiters.GetLatencyFrames() == 0);
+    BGMCheck(theLimiters.IsMixOutputSilentRT(true));
+    BGMCheck(!theLimiters.IsMixOutputSilentRT(false));
+
+    // Boosting the mix enables the stage, which requires the mix limiter. Only the first update
+    // enables it, so only that one resets the gain ramp.
+    BGMCheck(theBoostStage.NeedsUpdate(6.0f));
+    BGMCheck(theBoostStage.Update(6.0f));
+    BGMCheck(!theBoostStage.Update(kBoostMaxDbValue));
+    BGMCheck(!theBoostStage.NeedsUpdate(3.0f));
+    BGMCheck(theBoostStage.WillDoProcessMix(false));
+    BGMCheck(theLimiters.GetLatencyFrames() == kLookahead);
+    BGMCheck(!theLimiters.IsMixOutputSilentRT(true));
+
+    // The user's mix limiter setting isn't changed.
+    BGMCheck(!theLimiters.GetSettings().mMixEnabled);
+
+    // A full-scale signal boosted to the maximum doesn't clip.
+    const Float32 kMaxBoostGain = powf(10.0f, kBoostMaxDbValue / 20.0f);
+    Float32 theBoostedPeak = 0.0f;
+
+    for(UInt32 theCycle = 0; theCycle < 20; theCycle++)
+    {
+        std::vector<Float32> theMix(512 * 2);
+
+        for(UInt32 i = 0; i < 512 * 2; i++)
+        {
+            theMix[i] = ((i / 2) % 2 == 0) ? 1.0f : -1.0f;
+        }
+
+        BGM_IOKernels::ApplyGain(theMix.data(), 512, 2, kMaxBoostGain);
+        theLimiters.ProcessMixRT(theMix.data(), 512, 2, kSampleRate);
+
+        for(Float32 theSample : theMix)
+        {
+            theBoostedPeak = std::max(theBoostedPeak, std::fabs(theSample));
+        }
+    }
+
+    BGMCheck(theBoostedPeak > 0.5f);
+    BGMCheck(theBoostedPeak <= 1.0f);
+
+    // Back at 0 dB, the stage is disabled and the device is as it was.
+    BGMCheck(theBoostStage.NeedsUpdate(0.0f));
+    BGMCheck(!theBoostStage.Update(0.0f));
+    BGMCheck(!theBoostStage.IsEnabled());
+    BGMCheck(!theBoostStage.WillDoProcessMix(false));
+    BGMCheck(theLimiters.GetLatencyFrames() == 0);
+    BGMCheck(theLimiters.IsMixOutputSilentRT(true));
+
+    // If the user has enabled the mix limiter, it stays enabled when the stage is disabled.
+    BGM_Limiters::Settings theSettings = theLimiters.GetSettings();
+    theSettings.mMixEnabled = true;
+    theLimiters.SetSettings(theSettings);
+    theBoostStage.Update(6.0f);
+    theBoostStage.Update(0.0f);
+    BGMCheck(theLimiters.IsMixEnabled());
+    BGMCheck(theLimiters.GetLatencyFrames() == kLookahead);
+
+    // The stage is disabled once the boost's gain has had time to ramp down to unity, which is
+    // longer than the ramp.
+    const UInt32 kRampLength = BGM_GainRamp::kDefaultLengthFrames;
+    BGMCheck(BGM_BoostStage::GetDisableDelayNs(kRampLength, kSampleRate) >
+             static_cast<UInt64>(kRampLength / kSampleRate * 1e9));
+    BGMCheck(BGM_BoostStage::GetDisableDelayNs(kRampLength, 0.0) == 0);
+}
+
+// Runs inFrames frames of a stereo signal through inChain in 512-frame buffers and returns the
+// output. inSignal gives the sample for a frame, which both channels get.
+template <typename T>
+static std::vector<Float32> RunDSPChain(BGM_DSPChain& inChain, UInt32 inFrames, T inSignal)
+{
+    std::vector<Float32> theBuffer(inFrames * 2);
+
+    for(UInt32 i = 0; i < inFrames; i++)
+    {
+        theBuffer[i * 2] = inSignal(i);
+        theBuffer[i * 2 + 1] = inSignal(i);
+    }
+
+    for(UInt32 theOffset = 0; theOffset < inFrames; theOffset += 512)
+    {
+        inChain.ProcessRT(theBuffer.data() + theOffset * 2, std::min(512U, inFrames - theOffset), 2);
+    }
+
+    return theBuffer;
+}
+
+static Float32 PeakOfLastFrames(const std::vector<Float32>& inBuffer, UInt32 inFrames)
+{
+    Float32 thePeak = 0.0f;
+
+    for(size_t i = inBuffer.size() - inFrames * 2; i < inBuffer.size(); i++)
+    {
+        thePeak = std::max(thePeak, std::fabs(inBuffer[i]));
+    }
+
+    return thePeak;
+}
+
+static void TestClientDSP()
+{
+    const Float64 kSampleRate = 48000.0;
+    const UInt32 kFrames = 48000;
+    auto theSine1kHz = [&](UInt32 i) {
+        return 0.25f * sinf(static_cast<Float32>(2.0 * M_PI * 1000.0 * i / kSampleRate));
+    };
+
+    // The default settings don't change the audio.
+    BGM_DSPChain::Settings theSettings = BGM_DSPChain::GetDefaultSettings();
+    BGMCheck(BGM_DSPChain::IsBypassed(theSettings));
+
+    BGM_DSPChain theChain;
+    std::vector<Float32> theOutput = RunDSPChain(theChain, 1000, theSine1kHz);
+    BGMCheck(theOutput[501 * 2] == theSine1kHz(501) && theOutput[501 * 2 + 1] == theSine1kHz(501));
+
+    // A low cut removes DC.
+    theSettings.mBandCount = 1;
+    theSettings.mBands[0].mType = kBGMAppDSPBandType_LowCut;
+    theSettings.mBands[0].mFrequencyHz = 100.0f;
+    theChain.SetSettings(theSettings, kSampleRate);
+    theChain.Reset();
+    theOutput = RunDSPChain(theChain, kFrames, [](UInt32) { return 0.5f; });
+    BGMCheck(PeakOfLastFrames(theOutput, 1000) < 1e-4f);
+
+    // A 6 dB peak at 1 kHz doubles a 1 kHz sine.
+    theSettings.mBands[0] = BGM_DSPChain::GetDefaultBand();
+    theSettings.mBands[0].mGainDb = 6.0206f;
+    theChain.SetSettings(theSettings, kSampleRate);
+    theChain.Reset();
+    theOutput = RunDSPChain(theChain, kFrames, theSine1kHz);
+    BGMCheck(std::fabs(PeakOfLastFrames(theOutput, 1000) - 0.5f) < 0.005f);
+
+    // A hard-knee 4:1 compressor with a -20 dBFS threshold turns a -6 dBFS signal down by
+    // 14 * 3/4 = 10.5 dB once it's settled.
+    theSettings = BGM_DSPChain::GetDefaultSettings();
+    theSettings.mCompressor.mEnabled = true;
+    theSettings.mCompressor.mThresholdDb = -20.0f;
+    theSettings.mCompressor.mRatio = 4.0f;
+    theSettings.mCompressor.mKneeDb = 0.0f;
+    theSettings.mCompressor.mAttackMs = 1.0f;
+    theChain.SetSettings(theSettings, kSampleRate);
+    theChain.Reset();
+    auto theSquareWave = [](UInt32 i) { return ((i / 50) % 2 == 0) ? 0.5f : -0.5f; };
+    theOutput = RunDSPChain(theChain, kFrames, theSquareWave);
+    BGMCheck(std::fabs(PeakOfLastFrames(theOutput, 1000) - 0.5f * powf(10.0f, -10.5f / 20.0f)) < 0.002f);
+
+    // Audio under the knee only gets the makeup gain.
+    theSettings.mCompressor.mMakeupDb = 6.0206f;
+    theChain.SetSettings(theSettings, kSampleRate);
+    theChain.Reset();
+    theOutput = RunDSPChain(theChain, 1000, [](UInt32) { return 0.01f; });
+    BGMCheck(std::fabs(theOutput[0] - 0.02f) < 1e-5f && std::fabs(theOutput.back() - 0.02f) < 1e-5f);
+
+    // Out of range settings are clamped.
+    theSettings.mBandCount = 20;
+    theSettings.mBands[0].mType = 99;
+    theSettings.mBands[0].mFrequencyHz = NAN;
+    theSettings.mCompressor.mRatio = 0.5f;
+    BGM_DSPChain::Settings theClampedSettings = BGM_DSPChain::ClampSettings(theSettings);
+    BGMCheck(theClampedSettings.mBandCount == BGM_DSPChain::kMaxBands);
+    BGMCheck(theClampedSettings.mBands[0].mType == kBGMAppDSPBandType_Peak);
+    BGMCheck(theClampedSettings.mBands[0].mFrequencyHz == 10.0f);
+    BGMCheck(theClampedSettings.mCompressor.mRatio == 1.0f);
+
+    // The apps' settings. Clients of apps without settings don't cost anything.
+    BGM_ClientDSP theClientDSP;
+    BGMCheck(!theClientDSP.HasAppsRT());
+    BGMCheck(theClientDSP.FindApp(1234, BGM_String("com.example.client")) == -1);
+
+    theSettings = BGM_DSPChain::GetDefaultSettings();
+    theSettings.mCompressor.mEnabled = true;
+    theSettings.mCompressor.mMakeupDb = 6.0206f;
+    SInt32 theSlot = theClientDSP.SetAppSettings(1234, BGM_String(), theSettings);
+    BGMCheck(theSlot >= 0);
+    BGMCheck(theClientDSP.HasAppsRT());
+
+    // Setting the bundle ID later matches the app by PID and adds the bundle ID to it.
+    BGMCheck(theClientDSP.SetAppSettings(1234, BGM_String("com.example.client"), theSettings) == theSlot);
+    BGMCheck(theClientDSP.FindApp(-1, BGM_String("com.example.client")) == theSlot);
+    BGMCheck(theClientDSP.FindApp(5678, BGM_String()) == -1);
+    BGMCheck(theClientDSP.CopyAppSettings().size() == 1);
+
+    std::vector<Float32> theBuffer(512 * 2, 0.01f);
+    theClientDSP.ProcessClientRT(7, theSlot, theBuffer.data(), 512, 2, kSampleRate);
+    BGMCheck(std::fabs(theBuffer.back() - 0.02f) < 1e-5f);
+
+    // The IO thread picks up new settings on the next buffer.
+    theSettings.mCompressor.mMakeupDb = 12.0412f;
+    theClientDSP.SetAppSettings(-1, BGM_String("com.example.client"), theSettings);
+    std::fill(theBuffer.begin(), theBuffer.end(), 0.01f);
+    theClientDSP.ProcessClientRT(7, theSlot, theBuffer.data(), 512, 2, kSampleRate);
+    BGMCheck(std::fabs(theBuffer.back() - 0.04f) < 1e-5f);
+
+    // 7.1 audio gets the same processing in every channel.
+    std::vector<Float32> theSurround(512 * 8, 0.01f);
+    theClientDSP.ProcessClientRT(7, theSlot, theSurround.data(), 512, 8, kSampleRate);
+    BGMCheck(std::fabs(theSurround.back() - 0.04f) < 1e-5f);
+    BGMCheck(std::fabs(theSurround[511 * 8 + 2] - 0.04f) < 1e-5f);
+
+    // Silent buffers are skipped once the chain is at rest, which gives the same output as
+    // processing them. Until then, the filters' tail is still played.
+    theSettings.mBandCount = 1;
+    theSettings.mBands[0] = BGM_DSPChain::GetDefaultBand();
+    theSettings.mBands[0].mGainDb = 12.0f;
+    theChain.SetSettings(theSettings, kSampleRate);
+    theChain.Reset();
+    BGMCheck(theChain.IsAtRest());
+    RunDSPChain(theChain, 512, theSine1kHz);
+    BGMCheck(!theChain.IsAtRest());
+
+    std::vector<Float32> theTail(512 * 2, 0.0f);
+    theChain.ProcessRT(theTail.data(), 512, 2, true);
+    BGMCheck(PeakOfLastFrames(theTail, 512) > 0.0f);
+
+    for(UInt32 i = 0; (i < 1000) && !theChain.IsAtRest(); i++)
+    {
+        std::fill(theTail.begin(), theTail.end(), 0.0f);
+        theChain.ProcessRT(theTail.data(), 512, 2, true);
+    }
+
+    BGMCheck(theChain.IsAtRest());
+    std::fill(theTail.begin(), theTail.end(), 0.0f);
+    theChain.ProcessRT(theTail.data(), 512, 2, true);
+    BGMCheck(PeakOfLastFrames(theTail, 512) == 0.0f);
+    BGMCheck(theChain.IsAtRest());
+
+    std::vector<Float32> theSilentClient(512 * 2, 0.0f);
+    theClientDSP.ProcessClientRT(7, theSlot, theSilentClient.data(), 512, 2, kSampleRate, true);
+    BGMCheck(PeakOfLastFrames(theSilentClient, 512) == 0.0f);
+
+    // Out of range slots are ignored.
+    std::fill(theBuffer.begin(), theBuffer.end(), 0.01f);
+    theClientDSP.ProcessClientRT(7, BGM_ClientDSP::kMaxApps, theBuffer.data(), 512, 2, kSampleRate);
+    BGMCheck(theBuffer.back() == 0.01f);
+
+    // There's a limit on the number of apps.
+    bool didThrow = false;
+
+    try
+    {
+        for(pid_t thePID = 2000; thePID < 2000 + static_cast<pid_t>(BGM_ClientDSP::kMaxApps); thePID++)
+        {
+            theClientDSP.SetAppSettings(thePID, BGM_String(), theSettings);
+        }
+    }
+    catch(const CAException&)
+    {
+        didThrow = true;
+    }
+
+    BGMCheck(didThrow);
+
+    for(SInt32 i = 0; i < static_cast<SInt32>(BGM_ClientDSP::kMaxApps); i++)
+    {
+        theClientDSP.RemoveApp(i);
+    }
+
+    BGMCheck(!theClientDSP.HasAppsRT());
+    BGMCheck(theClientDSP.FindApp(1234, BGM_String()) == -1);
+}
+
+class BGMTestPropertyObject
+{
+public:
+    UInt32 GetListDataSize(const AudioObjectPropertyAddress& inAddress) const
+    {
+        return (inAddress.mScope == kAudioObjectPropertyScopeGlobal ? 2 : 1) * mListLength;
+    }
+    
+    UInt32 mListLength = 4;
+};
+
+static void TestPropertyTable()
+{
+    // Deliberately not in selector order.
+    static constexpr BGM_PropertyDescriptor<BGMTestPropertyObject> kProperties[] = {
+        { kAudioDeviceCustomPropertyAppVolumes, kBGMPropertyFlag_Settable, sizeof(void*), nullptr },
+        { 'lst#', 0, 0, &BGMTestPropertyObject::GetListDataSize },
+        { 'ltnc', kBGMPropertyFlag_InputOutputScopes, sizeof(UInt32), nullptr },
+        { 'aaaa', 0, sizeof(Float64), nullptr }
+    };
+    
+    static_assert(BGM_PropertySelectorsAreUnique(kProperties), "Duplicate test properties");
+    
+    static constexpr BGM_PropertyDescriptor<BGMTestPropertyObject> kDuplicateProperties[] = {
+        { 'aaaa', 0, 0, nullptr },
+        { 'bbbb', 0, 0, nullptr },
+        { 'aaaa', 0, 0, nullptr }
+    };
+    
+    static_assert(!BGM_PropertySelectorsAreUnique(kDuplicateProperties), "Missed duplicate");
+    
+    // The table is built at compile time.
+    static constexpr auto kPropertySlots = BGM_MakePropertySlots<BGM_PropertyShift(kProperties)>(kProperties);
+    static constexpr BGM_PropertyTable<BGMTestPropertyObject> theTable(kPropertySlots);
+    
+    static_assert(kPropertySlots.mMultiplier != 0, "No perfect hash for the test properties");
+    static_assert(sizeof(kPropertySlots.mSlots) / sizeof(kPropertySlots.mSlots[0]) == 8,
+                  "Expected twice as many slots as properties");
+    BGMTestPropertyObject theObject;
+    
+    AudioObjectPropertyAddress theAddress = { 'lst#', kAudioObjectPropertyScopeGlobal, 0 };
+    
+    BGMCheck(theTable.Find('zzzz') == nullptr);
+    BGMCheck(theTable.Find(0) == nullptr);
+    
+    for(const BGM_PropertyDescriptor<BGMTestPropertyObject>& theDescriptor : kProperties)
+    {
+        BGMCheck(theTable.Find(theDescriptor.mSelector) != nullptr &&
+                 theTable.Find(theDescriptor.mSelector)->mSelector == theDescriptor.mSelector);
+    }
+    
+    auto theProperty = theTable.Find('lst#');
+    BGMCheck(theProperty != nullptr && theProperty->HasProperty(theAddress));
+    BGMCheck(theProperty != nullptr && !theProperty->IsSettable());
+    BGMCheck(theProperty != nullptr && theProperty->GetDataSize(theObject, theAddress) == 8);
+    
+    theAddress.mScope = kAudioObjectPropertyScopeOutput;
+    theObject.mListLength = 3;
+    BGMCheck(theProperty != nullptr && theProperty->GetDataSize(theObject, theAddress) == 3);
+    
+    theProperty = theTable.Find('ltnc');
+    BGMCheck(theProperty != nullptr && theProperty->HasProperty(theAddress));
+    theAddress.mScope = kAudioObjectPropertyScopeGlobal;
+    BGMCheck(theProperty != nullptr && !theProperty->HasProperty(theAddress));
+    BGMCheck(theProperty != nullptr && theProperty->GetDataSize(theObject, theAddress) == sizeof(UInt32));
+    
+    theProperty = theTable.Find(kAudioDeviceCustomPropertyAppVolumes);
+    BGMCheck(theProperty != nullptr && theProperty->IsSettable());
+    
+    theProperty = theTable.Find('aaaa');
+    BGMCheck(theProperty != nullptr && theProperty->GetDataSize(theObject, theAddress) == sizeof(Float64));
+}
+
+int main()
+{
+    TestHostTime();
+    TestSemaphore();
+    TestClientMap();
+    TestClientMapSharedKeys();
+    TestClientMapBundleIDsBounded();
+    TestBundleIDTable();
+    TestPastClientStore();
+    TestPersistentState();
+    TestPackedAppVolumes();
+    TestRingBuffer();
+    TestIOKernels();
+    TestGainRamp();
+    TestMusicDucker();
+    TestLimiter();
+    TestBoostStage();
+    TestClientDSP();
+    TestPropertyTable();
+    TestIOStats();
+    TestVolumeCurve();
+    
+    if(sFailures == 0)
+    {
+        printf("All bgm_core tests passed.\n");
+    }
+    
+    return (sFailures == 0) ? 0 : 1;
+}
+
@@ -57,7 +57,8 @@ TestBGM_Device::TestBGM_Device()
                kObjectID_Stream_Input,
                kObjectID_Stream_Output,
                kObjectID_Volume_Output_Master,
-               kObjectID_Mute_Output_Master)
+               kObjectID_Mute_Output_Master,
+               kObjectID_Volume_Boost)
 {
     Activate();
 }
@@ -0,0 +1,606 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_IOCycleSimulator.cpp
+//  BGMDriverTests
+//
+//  Copyright © 2026 Kyle Neideck
+//
+
+// Self Include
+#include "BGM_IOCycleSimulator.h"
+
+// Local Includes
+#include "BGM_Types.h"
+#include "BGM_PlugIn.h"
+
+// PublicUtility Includes
+#include "CAHostTimeBase.h"
+
+// STL Includes
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+
+// System Includes
+#include <time.h>
+
+
+#pragma clang assume_nonnull begin
+
+// BGM_PlugInInterface.cpp's factory function, which returns the driver's vtable.
+extern "C" void* BGM_Create(CFAllocatorRef inAllocator, CFUUIDRef inRequestedTypeUUID);
+
+// The host callbacks don't get a context pointer, and the driver only supports one host at a time
+// anyway.
+static std::atomic<BGM_IOCycleSimulator*> sCurrentSimulator(nullptr);
+
+static const char* const kOperationNames[] = {
+    "StartIO",
+    "StopIO",
+    "BeginIOOperation(Thread)",
+    "EndIOOperation(Thread)",
+    "DoIOOperation(ProcessOutput)",
+    "DoIOOperation(ProcessMix)",
+    "DoIOOperation(WriteMix)",
+    "DoIOOperation(ReadInput)"
+};
+
+// The client IDs and PIDs the HAL would assign. They're just arbitrary numbers that are unlikely
+// to clash with anything else the tests do with the device.
+static const UInt32 kFirstClientID = 9000;
+static const pid_t kFirstClientPID = 59000;
+
+#pragma mark Construction/Destruction
+
+BGM_IOCycleSimulator::BGM_IOCycleSimulator(const Config& inConfig)
+:
+    mConfig(inConfig),
+    mRandom(inConfig.mSeed),
+    mDriver(static_cast<AudioServerPlugInDriverRef>(BGM_Create(kCFAllocatorDefault,
+                                                               kAudioServerPlugInTypeUUID))),
+    mStorage(CFDictionaryCreateMutable(kCFAllocatorDefault,
+                                       0,
+                                       &kCFTypeDictionaryKeyCallBacks,
+                                       &kCFTypeDictionaryValueCallBacks)),
+    mSampleRate(44100.0),
+    mCycleInfo(),
+    mMixBuffer(inConfig.mIOBufferFrameSize * 2),
+    mInputBuffer(inConfig.mIOBufferFrameSize * 2),
+    mAudibleStateNotifications(0),
+    mConfigurationChangeRequests(0)
+{
+    mHost.PropertiesChanged = &Host_PropertiesChanged;
+    mHost.CopyFromStorage = &Host_CopyFromStorage;
+    mHost.WriteToStorage = &Host_WriteToStorage;
+    mHost.DeleteFromStorage = &Host_DeleteFromStorage;
+    mHost.RequestDeviceConfigurationChange = &Host_RequestDeviceConfigurationChange;
+
+    for(int i = 0; i < kOperationCount; i++)
+    {
+        OperationStats theStats;
+        theStats.mName = kOperationNames[i];
+        mReport.mOperations.push_back(theStats);
+    }
+
+    sCurrentSimulator = this;
+    (*mDriver)->Initialize(mDriver, &mHost);
+
+    UInt32 theDataSize = 0;
+    AudioObjectPropertyAddress theSampleRateAddress = {
+        kAudioDevicePropertyNominalSampleRate,
+        kAudioObjectPropertyScopeGlobal,
+        kAudioObjectPropertyElementMaster
+    };
+    (*mDriver)->GetPropertyData(mDriver,
+                                kObjectID_Device,
+                                0,
+                                &theSampleRateAddress,
+                                0,
+                                NULL,
+                                sizeof(Float64),
+                                &theDataSize,
+                                &mSampleRate);
+
+    for(UInt32 i = 0; i < mConfig.mClientCount; i++)
+    {
+        Client theClient;
+        theClient.mBundleID = CFStringCreateWithFormat(kCFAllocatorDefault,
+                                                       NULL,
+                                                       CFSTR("com.bearisdriving.BGMDriver.Simulator.Client%u"),
+                                                       i);
+        theClient.mInfo.mClientID = kFirstClientID + i;
+        theClient.mInfo.mProcessID = kFirstClientPID + static_cast<pid_t>(i);
+        theClient.mInfo.mIsNativeEndian = true;
+        theClient.mInfo.mBundleID = theClient.mBundleID;
+        theClient.mBuffer.resize(mConfig.mIOBufferFrameSize * 2);
+
+        (*mDriver)->AddDeviceClient(mDriver, kObjectID_Device, &theClient.mInfo);
+        mClients.push_back(theClient);
+    }
+
+    // Make the first client the music player, so the audible state distinguishes it from the rest.
+    if(!mClients.empty())
+    {
+        (*mDriver)->SetPropertyData(mDriver,
+                                    kObjectID_Device,
+                                    0,
+                                    &kBGMMusicPlayerBundleIDAddress,
+                                    0,
+                                    NULL,
+                                    sizeof(CFStringRef),
+                                    &mClients[0].mBundleID);
+    }
+}
+
+BGM_IOCycleSimulator::~BGM_IOCycleSimulator()
+{
+    for(Client& theClient : mClients)
+    {
+        if(theClient.mIsRunning)
+        {
+            StopClient(theClient);
+        }
+
+        (*mDriver)->RemoveDeviceClient(mDriver, kObjectID_Device, &theClient.mInfo);
+        CFRelease(theClient.mBundleID);
+    }
+
+    // Put the music player property back to its default.
+    CFStringRef theEmptyBundleID = CFSTR("");
+    (*mDriver)->SetPropertyData(mDriver,
+                                kObjectID_Device,
+                                0,
+                                &kBGMMusicPlayerBundleIDAddress,
+                                0,
+                                NULL,
+                                sizeof(CFStringRef),
+                                &theEmptyBundleID);
+
+    // Disconnect the fake host, since it's about to be destroyed. Notifications the driver has
+    // already queued will be dropped.
+    BGM_PlugIn::SetHost(NULL);
+    sCurrentSimulator = nullptr;
+
+    CFRelease(mStorage);
+}
+
+#pragma mark Simulation
+
+BGM_IOCycleSimulator::Report    BGM_IOCycleSimulator::Run()
+{
+    UInt64 theStartNs = clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
+    SInt32 theAudibleState = GetAudibleState();
+
+    for(UInt64 theCycle = 0; theCycle < mConfig.mCycleCount; theCycle++)
+    {
+        RunCycle(theCycle);
+
+        SInt32 theNewAudibleState = GetAudibleState();
+
+        if(theNewAudibleState != theAudibleState)
+        {
+            mReport.mAudibleStateTransitions++;
+            theAudibleState = theNewAudibleState;
+        }
+    }
+
+    UInt64 theElapsedNs = std::max<UInt64>(1, clock_gettime_nsec_np(CLOCK_UPTIME_RAW) - theStartNs);
+
+    Float64 theSimulatedNs =
+        (static_cast<Float64>(mConfig.mCycleCount) * mConfig.mIOBufferFrameSize / mSampleRate) * NSEC_PER_SEC;
+
+    mReport.mCycles = mConfig.mCycleCount;
+    mReport.mSpeedRelativeToRealTime = theSimulatedNs / static_cast<Float64>(theElapsedNs);
+    mReport.mAudibleStateNotifications = mAudibleStateNotifications;
+    mReport.mConfigurationChangeRequests = mConfigurationChangeRequests;
+
+    return mReport;
+}
+
+void    BGM_IOCycleSimulator::RunCycle(UInt64 inCycle)
+{
+    std::uniform_real_distribution<Float64> theProbability(0.0, 1.0);
+
+    // Start and stop clients. On the first cycle, start all of them.
+    for(Client& theClient : mClients)
+    {
+        if(inCycle == 0 || theProbability(mRandom) < mConfig.mChurnProbability)
+        {
+            if(theClient.mIsRunning)
+            {
+                StopClient(theClient);
+            }
+            else
+            {
+                StartClient(theClient);
+            }
+        }
+    }
+
+    bool anyClientIsRunning =
+        std::any_of(mClients.begin(), mClients.end(), [](const Client& inClient) { return inClient.mIsRunning; });
+
+    if(!anyClientIsRunning)
+    {
+        // The HAL doesn't run the device's IO cycles while no clients are doing IO.
+        return;
+    }
+
+    SetUpCycleInfo(inCycle);
+
+    // The HAL doesn't process the clients in any particular order.
+    std::vector<Client*> theRunningClients;
+
+    for(Client& theClient : mClients)
+    {
+        if(theClient.mIsRunning)
+        {
+            theRunningClients.push_back(&theClient);
+        }
+    }
+
+    std::shuffle(theRunningClients.begin(), theRunningClients.end(), mRandom);
+
+    std::fill(mMixBuffer.begin(), mMixBuffer.end(), 0.0f);
+
+    for(Client* theClient : theRunningClients)
+    {
+        FillClientBuffer(*theClient);
+
+        Call(kOperationProcessOutput, [&] {
+            return (*mDriver)->DoIOOperation(mDriver,
+                                             kObjectID_Device,
+                                             kObjectID_Stream_Output,
+                                             theClient->mInfo.mClientID,
+                                             kAudioServerPlugInIOOperationProcessOutput,
+                                             mConfig.mIOBufferFrameSize,
+                                             &mCycleInfo,
+                                             theClient->mBuffer.data(),
+                                             NULL);
+        });
+
+        // Mix, like the HAL would between ProcessOutput and ProcessMix.
+        for(size_t i = 0; i < mMixBuffer.size(); i++)
+        {
+            mMixBuffer[i] += theClient->mBuffer[i];
+        }
+    }
+
+    // The device-wide operations are done with the first running client's ID, like the HAL.
+    UInt32 theClientID = theRunningClients[0]->mInfo.mClientID;
+
+    Boolean willDoProcessMix = false;
+    Boolean willDoProcessMixInPlace = true;
+    (*mDriver)->WillDoIOOperation(mDriver,
+                                  kObjectID_Device,
+                                  theClientID,
+                                  kAudioServerPlugInIOOperationProcessMix,
+                                  &willDoProcessMix,
+                                  &willDoProcessMixInPlace);
+
+    if(willDoProcessMix)
+    {
+        Call(kOperationProcessMix, [&] {
+            return (*mDriver)->DoIOOperation(mDriver,
+                                             kObjectID_Device,
+                                             kObjectID_Stream_Output,
+                                             theClientID,
+                                             kAudioServerPlugInIOOperationProcessMix,
+                                             mConfig.mIOBufferFrameSize,
+                                             &mCycleInfo,
+                                             mMixBuffer.data(),
+                                             NULL);
+        });
+    }
+
+    Call(kOperationWriteMix, [&] {
+        return (*mDriver)->DoIOOperation(mDriver,
+                                         kObjectID_Device,
+                                         kObjectID_Stream_Output,
+                                         theClientID,
+                                         kAudioServerPlugInIOOperationWriteMix,
+                                         mConfig.mIOBufferFrameSize,
+                                         &mCycleInfo,
+                                         mMixBuffer.data(),
+                                         NULL);
+    });
+
+    // Read the mix back from the input stream. The input time is the same as the output time, so
+    // it should be exactly the same audio.
+    Call(kOperationReadInput, [&] {
+        return (*mDriver)->DoIOOperation(mDriver,
+                                         kObjectID_Device,
+                                         kObjectID_Stream_Input,
+                                         theClientID,
+                                         kAudioServerPlugInIOOperationReadInput,
+                                         mConfig.mIOBufferFrameSize,
+                                         &mCycleInfo,
+                                         mInputBuffer.data(),
+                                         NULL);
+    });
+
+    for(UInt32 theFrame = 0; theFrame < mConfig.mIOBufferFrameSize; theFrame++)
+    {
+        if(mInputBuffer[theFrame * 2] != mMixBuffer[theFrame * 2] ||
+           mInputBuffer[(theFrame * 2) + 1] != mMixBuffer[(theFrame * 2) + 1])
+        {
+            mReport.mLoopbackMismatchedFrames++;
+        }
+    }
+}
+
+void    BGM_IOCycleSimulator::SetUpCycleInfo(UInt64 inCycle)
+{
+    const Float64 theSampleTime = static_cast<Float64>(inCycle * mConfig.mIOBufferFrameSize);
+    const Float64 theHostTicksPerFrame = CAHostTimeBase::GetFrequency() / mSampleRate;
+    const UInt64 theHostTime = static_cast<UInt64>(theSampleTime * theHostTicksPerFrame);
+
+    SInt64 theJitter = 0;
+
+    if(mConfig.mHostTimeJitterNs > 0)
+    {
+        SInt64 theMaxJitter = static_cast<SInt64>(CAHostTimeBase::ConvertFromNanos(mConfig.mHostTimeJitterNs));
+        theJitter = std::uniform_int_distribution<SInt64>(-theMaxJitter, theMaxJitter)(mRandom);
+    }
+
+    mCycleInfo.mIOCycleCounter = inCycle;
+    mCycleInfo.mNominalIOBufferFrameSize = mConfig.mIOBufferFrameSize;
+    mCycleInfo.mMainHostTicksPerFrame = theHostTicksPerFrame;
+    mCycleInfo.mDeviceHostTicksPerFrame = theHostTicksPerFrame;
+
+    for(AudioTimeStamp* theTimeStamp : { &mCycleInfo.mCurrentTime, &mCycleInfo.mInputTime, &mCycleInfo.mOutputTime })
+    {
+        *theTimeStamp = AudioTimeStamp();
+        theTimeStamp->mSampleTime = theSampleTime;
+        theTimeStamp->mHostTime = static_cast<UInt64>(std::max<SInt64>(0, static_cast<SInt64>(theHostTime) + theJitter));
+        theTimeStamp->mRateScalar = 1.0;
+        theTimeStamp->mFlags = kAudioTimeStampSampleHostTimeValid | kAudioTimeStampRateScalarValid;
+    }
+}
+
+void    BGM_IOCycleSimulator::FillClientBuffer(Client& ioClient)
+{
+    if(ioClient.mCyclesLeftInPhase == 0)
+    {
+        ioClient.mIsPlayingAudio = !ioClient.mIsPlayingAudio;
+        ioClient.mCyclesLeftInPhase =
+            std::uniform_int_distribution<UInt32>(1, std::max<UInt32>(1, mConfig.mMaxPhaseCycles))(mRandom);
+    }
+
+    ioClient.mCyclesLeftInPhase--;
+
+    if(ioClient.mIsPlayingAudio)
+    {
+        std::uniform_real_distribution<Float32> theNoise(-0.05f, 0.05f);
+
+        for(Float32& theSample : ioClient.mBuffer)
+        {
+            theSample = theNoise(mRandom);
+        }
+    }
+    else
+    {
+        std::fill(ioClient.mBuffer.begin(), ioClient.mBuffer.end(), 0.0f);
+    }
+}
+
+void    BGM_IOCycleSimulator::StartClient(Client& ioClient)
+{
+    // The HAL calls StartIO and then begins the client's IO thread operation.
+    Call(kOperationStartIO, [&] {
+        return (*mDriver)->StartIO(mDriver, kObjectID_Device, ioClient.mInfo.mClientID);
+    });
+
+    Call(kOperationBeginThread, [&] {
+        return (*mDriver)->BeginIOOperation(mDriver,
+                                            kObjectID_Device,
+                                            ioClient.mInfo.mClientID,
+                                            kAudioServerPlugInIOOperationThread,
+                                            mConfig.mIOBufferFrameSize,
+                                            &mCycleInfo);
+    });
+
+    ioClient.mIsRunning = true;
+    mReport.mClientStarts++;
+}
+
+void    BGM_IOCycleSimulator::StopClient(Client& ioClient)
+{
+    Call(kOperationEndThread, [&] {
+        return (*mDriver)->EndIOOperation(mDriver,
+                                          kObjectID_Device,
+                                          ioClient.mInfo.mClientID,
+                                          kAudioServerPlugInIOOperationThread,
+                                          mConfig.mIOBufferFrameSize,
+                                          &mCycleInfo);
+    });
+
+    Call(kOperationStopIO, [&] {
+        return (*mDriver)->StopIO(mDriver, kObjectID_Device, ioClient.mInfo.mClientID);
+    });
+
+    ioClient.mIsRunning = false;
+    mReport.mClientStops++;
+}
+
+template <typename F>
+void    BGM_IOCycleSimulator::Call(Operation inOperation, F inFunction)
+{
+    UInt64 theStartNs = clock_gettime_nsec_np(CLOCK_THREAD_CPUTIME_ID);
+    OSStatus theError = inFunction();
+    UInt64 theCPUTimeNs = clock_gettime_nsec_np(CLOCK_THREAD_CPUTIME_ID) - theStartNs;
+
+    OperationStats& theStats = mReport.mOperations[inOperation];
+    theStats.mCount++;
+    theStats.mTotalCPUTimeNs += theCPUTimeNs;
+    theStats.mMaxCPUTimeNs = std::max(theStats.mMaxCPUTimeNs, theCPUTimeNs);
+
+    if(theError != kAudioHardwareNoError)
+    {
+        mReport.mErrors++;
+    }
+}
+
+SInt32  BGM_IOCycleSimulator::GetAudibleState()
+{
+    SInt32 theAudibleState = kBGMDeviceIsSilent;
+    UInt32 theDataSize = 0;
+
+    (*mDriver)->GetPropertyData(mDriver,
+                                kObjectID_Device,
+                                0,
+                                &kBGMAudibleStateAddress,
+                                0,
+                                NULL,
+                                sizeof(SInt32),
+                                &theDataSize,
+                                &theAudibleState);
+
+    return theAudibleState;
+}
+
+#pragma mark Report
+
+std::string BGM_IOCycleSimulator::Report::ToString() const
+{
+    std::ostringstream theString;
+
+    theString << "Cycles: " << mCycles
+              << ", errors: " << mErrors
+              << ", loopback mismatched frames: " << mLoopbackMismatchedFrames
+              << ", audible state transitions: " << mAudibleStateTransitions
+              << " (notifications: " << mAudibleStateNotifications << ")"
+              << ", client starts/stops: " << mClientStarts << "/" << mClientStops
+              << ", configuration change requests: " << mConfigurationChangeRequests
+              << ", speed: " << mSpeedRelativeToRealTime << "x real time\n";
+
+    for(const OperationStats& theStats : mOperations)
+    {
+        if(theStats.mCount > 0)
+        {
+            theString << "  " << theStats.mName
+                      << ": count " << theStats.mCount
+                      << ", mean " << (theStats.mTotalCPUTimeNs / theStats.mCount) << " ns"
+                      << ", max " << theStats.mMaxCPUTimeNs << " ns\n";
+        }
+    }
+
+    return theString.str();
+}
+
+#pragma mark Fake Host
+
+//static
+OSStatus    BGM_IOCycleSimulator::Host_PropertiesChanged(AudioServerPlugInHostRef inHost,
+                                                         AudioObjectID inObjectID,
+                                                         UInt32 inNumberAddresses,
+                                                         const AudioObjectPropertyAddress* inAddresses)
+{
+    #pragma unused(inHost, inObjectID)
+
+    // Called on the driver's non-real-time task queue thread.
+    BGM_IOCycleSimulator* theSimulator = sCurrentSimulator;
+
+    if(theSimulator)
+    {
+        for(UInt32 i = 0; i < inNumberAddresses; i++)
+        {
+            if(inAddresses[i].mSelector == kAudioDeviceCustomPropertyDeviceAudibleState)
+            {
+                theSimulator->mAudibleStateNotifications++;
+            }
+        }
+    }
+
+    return kAudioHardwareNoError;
+}
+
+//static
+OSStatus    BGM_IOCycleSimulator::Host_CopyFromStorage(AudioServerPlugInHostRef inHost,
+                                                       CFStringRef inKey,
+                                                       CFPropertyListRef* outData)
+{
+    #pragma unused(inHost)
+
+    BGM_IOCycleSimulator* theSimulator = sCurrentSimulator;
+    CFPropertyListRef theData = theSimulator ? CFDictionaryGetValue(theSimulator->mStorage, inKey) : NULL;
+
+    if(theData)
+    {
+        CFRetain(theData);
+    }
+
+    *outData = theData;
+
+    return kAudioHardwareNoError;
+}
+
+//static
+OSStatus    BGM_IOCycleSimulator::Host_WriteToStorage(AudioServerPlugInHostRef inHost,
+                                                      CFStringRef inKey,
+                                                      CFPropertyListRef inData)
+{
+    #pragma unused(inHost)
+
+    BGM_IOCycleSimulator* theSimulator = sCurrentSimulator;
+
+    if(theSimulator)
+    {
+        CFDictionarySetValue(theSimulator->mStorage, inKey, inData);
+    }
+
+    return kAudioHardwareNoError;
+}
+
+//static
+OSStatus    BGM_IOCycleSimulator::Host_DeleteFromStorage(AudioServerPlugInHostRef inHost, CFStringRef inKey)
+{
+    #pragma unused(inHost)
+
+    BGM_IOCycleSimulator* theSimulator = sCurrentSimulator;
+
+    if(theSimulator)
+    {
+        CFDictionaryRemoveValue(theSimulator->mStorage, inKey);
+    }
+
+    return kAudioHardwareNoError;
+}
+
+//static
+OSStatus    BGM_IOCycleSimulator::Host_RequestDeviceConfigurationChange(AudioServerPlugInHostRef inHost,
+                                                                        AudioObjectID inDeviceObjectID,
+                                                                        UInt64 inChangeAction,
+                                                                        void* __nullable inChangeInfo)
+{
+    #pragma unused(inHost, inDeviceObjectID, inChangeAction, inChangeInfo)
+
+    // The HAL would call PerformDeviceConfigurationChange later, from another thread. The driver
+    // only asks for configuration changes when BGMApp changes the sample rate, which the simulator
+    // doesn't do, so just count the requests.
+    BGM_IOCycleSimulator* theSimulator = sCurrentSimulator;
+
+    if(theSimulator)
+    {
+        theSimulator->mConfigurationChangeRequests++;
+    }
+
+    return kAudioHardwareNoError;
+}
+
+#pragma clang assume_nonnull end
+
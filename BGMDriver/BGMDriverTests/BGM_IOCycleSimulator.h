@@ -0,0 +1,206 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_IOCycleSimulator.h
+//  BGMDriverTests
+//
+//  Copyright © 2026 Kyle Neideck
+//
+//  Runs BGMDevice's IO path in-process, as fast as it can, by calling the driver through its
+//  AudioServerPlugInDriverInterface (the same vtable the HAL uses) with a stand-in for the
+//  AudioServerPlugInHost. No coreaudiod, so IO can be simulated deterministically and much faster
+//  than real time.
+//
+//  Each simulated IO cycle is roughly what the HAL does for a device with a few clients, but
+//  serialised onto one thread:
+//
+//    - Each running client, in a random order, does kAudioServerPlugInIOOperationProcessOutput
+//      with its own buffer, which the simulator then mixes.
+//    - ProcessMix (if the driver wants to do it) and WriteMix with the mixed buffer.
+//    - ReadInput, reading the same frames back out of the loopback ring buffer.
+//
+//  Clients can be set to stop and restart IO at random (the churn), in which case the simulator
+//  calls StopIO/StartIO and ends/begins the kAudioServerPlugInIOOperationThread operation, as the
+//  HAL would.
+//
+//  The simulator is seeded, so a configuration always produces the same sequence of calls. The
+//  timings in the report obviously aren't deterministic.
+//
+
+#ifndef BGMDriverTests__BGM_IOCycleSimulator
+#define BGMDriverTests__BGM_IOCycleSimulator
+
+// STL Includes
+#include <atomic>
+#include <random>
+#include <string>
+#include <vector>
+
+// System Includes
+#include <CoreAudio/AudioServerPlugIn.h>
+#include <CoreFoundation/CoreFoundation.h>
+
+
+#pragma clang assume_nonnull begin
+
+class BGM_IOCycleSimulator
+{
+
+public:
+    struct Config
+    {
+        // The number of device clients, i.e. processes playing audio. The first one is set as the
+        // music player.
+        UInt32                  mClientCount = 4;
+        UInt32                  mIOBufferFrameSize = 512;
+        UInt32                  mCycleCount = 1000;
+        // The maximum error added to (or subtracted from) each cycle's host times. The driver
+        // shouldn't care, since it only uses the sample times.
+        UInt64                  mHostTimeJitterNs = 0;
+        // The probability, per client per cycle, that a running client stops IO or a stopped
+        // client starts it again.
+        Float64                 mChurnProbability = 0.0;
+        // Each client alternates between playing audio and silence, for a random number of
+        // cycles up to this, so the audible state changes.
+        UInt32                  mMaxPhaseCycles = 50;
+        UInt32                  mSeed = 1;
+    };
+
+    // The time spent in one kind of driver call.
+    struct OperationStats
+    {
+        std::string             mName;
+        UInt64                  mCount = 0;
+        UInt64                  mTotalCPUTimeNs = 0;
+        UInt64                  mMaxCPUTimeNs = 0;
+    };
+
+    struct Report
+    {
+        UInt64                  mCycles = 0;
+        std::vector<OperationStats> mOperations;
+        // Calls into the driver that returned an error.
+        UInt64                  mErrors = 0;
+        // Frames that ReadInput didn't return exactly as WriteMix stored them, e.g. because the
+        // ring buffer returned silence.
+        UInt64                  mLoopbackMismatchedFrames = 0;
+        // Changes to kAudioDeviceCustomPropertyDeviceAudibleState, checked after every cycle.
+        UInt64                  mAudibleStateTransitions = 0;
+        // The notifications the driver sent for that property. They're sent asynchronously from
+        // another thread, so there can be fewer than the transitions if the state changes back
+        // quickly.
+        UInt64                  mAudibleStateNotifications = 0;
+        UInt64                  mClientStarts = 0;
+        UInt64                  mClientStops = 0;
+        // Calls to the host's RequestDeviceConfigurationChange. (The simulator doesn't perform
+        // the changes.)
+        UInt64                  mConfigurationChangeRequests = 0;
+        // The duration of the simulated audio divided by the time the simulation took.
+        Float64                 mSpeedRelativeToRealTime = 0.0;
+
+        // For logging.
+        std::string             ToString() const;
+    };
+
+public:
+                                BGM_IOCycleSimulator(const Config& inConfig);
+                                // Removes the simulated clients and disconnects the fake host.
+                                ~BGM_IOCycleSimulator();
+                                BGM_IOCycleSimulator(const BGM_IOCycleSimulator&) = delete;
+                                BGM_IOCycleSimulator& operator=(const BGM_IOCycleSimulator&) = delete;
+
+    Report                      Run();
+
+private:
+    enum Operation
+    {
+        kOperationStartIO,
+        kOperationStopIO,
+        kOperationBeginThread,
+        kOperationEndThread,
+        kOperationProcessOutput,
+        kOperationProcessMix,
+        kOperationWriteMix,
+        kOperationReadInput,
+        kOperationCount
+    };
+
+    struct Client
+    {
+        AudioServerPlugInClientInfo mInfo;
+        CFStringRef             mBundleID;
+        bool                    mIsRunning = false;
+        bool                    mIsPlayingAudio = false;
+        UInt32                  mCyclesLeftInPhase = 0;
+        std::vector<Float32>    mBuffer;
+    };
+
+    // Calls into the driver through the vtable, timing the call and counting any error.
+    template <typename F>
+    void                        Call(Operation inOperation, F inFunction);
+
+    void                        StartClient(Client& ioClient);
+    void                        StopClient(Client& ioClient);
+    void                        RunCycle(UInt64 inCycle);
+    void                        FillClientBuffer(Client& ioClient);
+    void                        SetUpCycleInfo(UInt64 inCycle);
+    SInt32                      GetAudibleState();
+
+    static OSStatus             Host_PropertiesChanged(AudioServerPlugInHostRef inHost,
+                                                       AudioObjectID inObjectID,
+                                                       UInt32 inNumberAddresses,
+                                                       const AudioObjectPropertyAddress* inAddresses);
+    static OSStatus             Host_CopyFromStorage(AudioServerPlugInHostRef inHost,
+                                                     CFStringRef inKey,
+                                                     CFPropertyListRef* outData);
+    static OSStatus             Host_WriteToStorage(AudioServerPlugInHostRef inHost,
+                                                    CFStringRef inKey,
+                                                    CFPropertyListRef inData);
+    static OSStatus             Host_DeleteFromStorage(AudioServerPlugInHostRef inHost, CFStringRef inKey);
+    static OSStatus             Host_RequestDeviceConfigurationChange(AudioServerPlugInHostRef inHost,
+                                                                      AudioObjectID inDeviceObjectID,
+                                                                      UInt64 inChangeAction,
+                                                                      void* __nullable inChangeInfo);
+
+private:
+    Config                      mConfig;
+    std::mt19937                mRandom;
+
+    AudioServerPlugInDriverRef  mDriver;
+    AudioServerPlugInHostInterface mHost;
+
+    // The fake host's storage (see AudioServerPlugInHostInterface::CopyFromStorage, etc.), which
+    // just keeps everything in memory.
+    CFMutableDictionaryRef      mStorage;
+
+    // The device's nominal sample rate.
+    Float64                     mSampleRate;
+
+    std::vector<Client>         mClients;
+    AudioServerPlugInIOCycleInfo mCycleInfo;
+    std::vector<Float32>        mMixBuffer;
+    std::vector<Float32>        mInputBuffer;
+
+    Report                      mReport;
+    std::atomic<UInt64>         mAudibleStateNotifications;
+    std::atomic<UInt64>         mConfigurationChangeRequests;
+
+};
+
+#pragma clang assume_nonnull end
+
+#endif /* BGMDriverTests__BGM_IOCycleSimulator */
+
@@ -0,0 +1,102 @@
+// This file is part of Background Music.
+//
+// Background Music is free software: you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation, either version 2 of the
+// License, or (at your option) any later version.
+//
+// Background Music is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Background Music. If not, see <http://www.gnu.org/licenses/>.
+
+//
+//  BGM_IOCycleSimulatorTests.mm
+//  BGMDriverTests
+//
+//  Copyright © 2026 Kyle Neideck
+//
+
+// Unit Include
+#include "BGM_IOCycleSimulator.h"
+
+// Local Includes
+#include "BGM_TestUtils.h"
+
+
+@interface BGM_IOCycleSimulatorTests : XCTestCase
+
+@end
+
+@implementation BGM_IOCycleSimulatorTests
+
+- (void) checkNoGlitches:(const BGM_IOCycleSimulator::Report&)report {
+    NSLog(@"BGM_IOCycleSimulatorTests: %s", report.ToString().c_str());
+
+    XCTAssertEqual(report.mErrors, 0u);
+    XCTAssertEqual(report.mLoopbackMismatchedFrames, 0u);
+}
+
+- (void) testSteadyState {
+    BGM_IOCycleSimulator::Config config;
+    config.mClientCount = 4;
+    config.mIOBufferFrameSize = 512;
+    config.mCycleCount = 2000;
+
+    BGM_IOCycleSimulator::Report report = BGM_IOCycleSimulator(config).Run();
+
+    [self checkNoGlitches:report];
+    XCTAssertEqual(report.mClientStarts, 4u);
+    // The clients switch between audio and silence, so the audible state should have changed.
+    XCTAssertGreaterThan(report.mAudibleStateTransitions, 0u);
+    XCTAssertGreaterThan(report.mSpeedRelativeToRealTime, 1.0);
+}
+
+- (void) testChurnAndJitter {
+    BGM_IOCycleSimulator::Config config;
+    config.mClientCount = 8;
+    config.mIOBufferFrameSize = 128;
+    config.mCycleCount = 5000;
+    config.mHostTimeJitterNs = 200 * NSEC_PER_USEC;
+    config.mChurnProbability = 0.02;
+
+    BGM_IOCycleSimulator::Report report = BGM_IOCycleSimulator(config).Run();
+
+    [self checkNoGlitches:report];
+    XCTAssertGreaterThan(report.mClientStarts, config.mClientCount);
+    XCTAssertGreaterThan(report.mClientStops, 0u);
+}
+
+- (void) testBufferSizes {
+    // From the smallest buffer size the HAL allows to a lot larger than it usually uses.
+    for(UInt32 frameSize : { 14u, 64u, 512u, 4096u })
+    {
+        BGM_IOCycleSimulator::Config config;
+        config.mIOBufferFrameSize = frameSize;
+        config.mCycleCount = 500;
+        config.mChurnProbability = 0.01;
+
+        [self checkNoGlitches:BGM_IOCycleSimulator(config).Run()];
+    }
+}
+
+- (void) testDeterministic {
+    BGM_IOCycleSimulator::Config config;
+    config.mClientCount = 6;
+    config.mCycleCount = 1000;
+    config.mChurnProbability = 0.05;
+    config.mSeed = 42;
+
+    BGM_IOCycleSimulator::Report first = BGM_IOCycleSimulator(config).Run();
+    BGM_IOCycleSimulator::Report second = BGM_IOCycleSimulator(config).Run();
+
+    XCTAssertEqual(first.mAudibleStateTransitions, second.mAudibleStateTransitions);
+    XCTAssertEqual(first.mClientStarts, second.mClientStarts);
+    XCTAssertEqual(first.mClientStops, second.mClientStops);
+}
+
+@end
+
@@ -51,6 +51,9 @@
 #include "CAVolumeCurve.h"
 #include "CADebugMacros.h"
 #include <math.h>
+// BGM edit: Added for the lookup tables.
+#include <algorithm>
+#include <string.h>
 
 //=============================================================================
 //	CAVolumeCurve
@@ -71,7 +74,7 @@ CAVolumeCurve::~CAVolumeCurve()
 {
 }
 
-SInt32	CAVolumeCurve::GetMinimumRaw() const
+SInt32	CAVolumeCurve::CalculateMinimumRaw() const
 {
 	SInt32 theAnswer = 0;
 	
@@ -84,7 +87,7 @@ SInt32	CAVolumeCurve::GetMinimumRaw() const
 	return theAnswer;
 }
 
-SInt32	CAVolumeCurve::GetMaximumRaw() const
+SInt32	CAVolumeCurve::CalculateMaximumRaw() const
 {
 	SInt32 theAnswer = 0;
 	
@@ -98,7 +101,7 @@ SInt32	CAVolumeCurve::GetMaximumRaw() const
 	return theAnswer;
 }
 
-Float32	CAVolumeCurve::GetMinimumDB() const
+Float32	CAVolumeCurve::CalculateMinimumDB() const
 {
 	Float32 theAnswer = 0;
 	
@@ -111,7 +114,7 @@ Float32	CAVolumeCurve::GetMinimumDB() const
 	return theAnswer;
 }
 
-Float32	CAVolumeCurve::GetMaximumDB() const
+Float32	CAVolumeCurve::CalculateMaximumDB() const
 {
 	Float32 theAnswer = 0;
 	
@@ -125,6 +128,34 @@ Float32	CAVolumeCurve::GetMaximumDB() const
 	return theAnswer;
 }
 
+//	BGM edit: The public versions of the functions above use the lookup table if there is one.
+
+SInt32	CAVolumeCurve::GetMinimumRaw() const
+{
+	return mLookupTable ? mLookupTable->mMinimumRaw : CalculateMinimumRaw();
+}
+
+SInt32	CAVolumeCurve::GetMaximumRaw() const
+{
+	return mLookupTable ? mLookupTable->mMaximumRaw : CalculateMaximumRaw();
+}
+
+Float32	CAVolumeCurve::GetMinimumDB() const
+{
+	return mLookupTable ? mLookupTable->mMinimumDB : CalculateMinimumDB();
+}
+
+Float32	CAVolumeCurve::GetMaximumDB() const
+{
+	return mLookupTable ? mLookupTable->mMaximumDB : CalculateMaximumDB();
+}
+
+void	CAVolumeCurve::SetIsApplyingTransferFunction(bool inIsApplyingTransferFunction)
+{
+	mIsApplyingTransferFunction = inIsApplyingTransferFunction;
+	RebuildLookupTable();
+}
+
 void	CAVolumeCurve::SetTransferFunction(UInt32 inTransferFunction)
 {
 	mTransferFunction = inTransferFunction;
@@ -234,6 +265,8 @@ void	CAVolumeCurve::SetTransferFunction(UInt32 inTransferFunction)
 			mRawToScalarExponentDenominator = 1.0f;
 			break;
 	};
+	
+	RebuildLookupTable();
 }
 
 void	CAVolumeCurve::AddRange(SInt32 inMinRaw, SInt32 inMaxRaw, Float32 inMinDB, Float32 inMaxDB)
@@ -258,6 +291,7 @@ void	CAVolumeCurve::AddRange(SInt32 inMinRaw, SInt32 inMaxRaw, Float32 inMinDB,
 	if(!isOverlapped)
 	{
 		mCurveMap.insert(CurveMap::value_type(theRaw, theDB));
+		RebuildLookupTable();
 	}
 	else
 	{
@@ -268,6 +302,7 @@ void	CAVolumeCurve::AddRange(SInt32 inMinRaw, SInt32 inMaxRaw, Float32 inMinDB,
 void	CAVolumeCurve::ResetRange()
 {
 	mCurveMap.clear();
+	RebuildLookupTable();
 }
 
 bool	CAVolumeCurve::CheckForContinuity() const
@@ -304,10 +339,69 @@ bool	CAVolumeCurve::CheckForContinuity() const
 }
 
 SInt32	CAVolumeCurve::ConvertDBToRaw(Float32 inDB) const
+{
+	//	BGM edit: Look the answer up if we have a table.
+	if(!mLookupTable)
+	{
+		return CalculateDBToRaw(inDB);
+	}
+	
+	const LookupTable& theTable = *mLookupTable;
+	
+	//	clamp the value to the dB range
+	if(inDB < theTable.mMinimumDB) inDB = theTable.mMinimumDB;
+	if(inDB > theTable.mMaximumDB) inDB = theTable.mMaximumDB;
+	
+	UInt32 theBucket = GetBucket(inDB, theTable.mMinimumDB, theTable.mDBBucketsPerUnit, theTable.mNumberBuckets);
+	return LookUpThreshold(inDB, theTable.mMinimumRaw, theTable.mDBThresholds, theTable.mDBBuckets, theBucket);
+}
+
+Float32	CAVolumeCurve::ConvertRawToDB(SInt32 inRaw) const
+{
+	//	BGM edit: Look the answer up if we have a table.
+	if(!mLookupTable)
+	{
+		return CalculateRawToDB(inRaw);
+	}
+	
+	inRaw = std::min(mLookupTable->mMaximumRaw, std::max(mLookupTable->mMinimumRaw, inRaw));
+	return mLookupTable->mRawToDB[static_cast<size_t>(inRaw - mLookupTable->mMinimumRaw)];
+}
+
+Float32	CAVolumeCurve::ConvertRawToScalar(SInt32 inRaw) const
+{
+	//	BGM edit: Look the answer up if we have a table.
+	if(!mLookupTable)
+	{
+		return CalculateRawToScalar(inRaw);
+	}
+	
+	inRaw = std::min(mLookupTable->mMaximumRaw, std::max(mLookupTable->mMinimumRaw, inRaw));
+	return mLookupTable->mRawToScalar[static_cast<size_t>(inRaw - mLookupTable->mMinimumRaw)];
+}
+
+SInt32	CAVolumeCurve::ConvertScalarToRaw(Float32 inScalar) const
+{
+	//	BGM edit: Look the answer up if we have a table.
+	if(!mLookupTable)
+	{
+		return CalculateScalarToRaw(inScalar);
+	}
+	
+	const LookupTable& theTable = *mLookupTable;
+	
+	//	range the scalar value
+	inScalar = std::min(1.0f, std::max(0.0f, inScalar));
+	
+	UInt32 theBucket = GetBucket(inScalar, 0.0f, theTable.mScalarBucketsPerUnit, theTable.mNumberBuckets);
+	return LookUpThreshold(inScalar, theTable.mMinimumRaw, theTable.mScalarThresholds, theTable.mScalarBuckets, theBucket);
+}
+
+SInt32	CAVolumeCurve::CalculateDBToRaw(Float32 inDB) const
 {
 	//	clamp the value to the dB range
-	Float32 theOverallDBMin = GetMinimumDB();
-	Float32 theOverallDBMax = GetMaximumDB();
+	Float32 theOverallDBMin = CalculateMinimumDB();
+	Float32 theOverallDBMax = CalculateMaximumDB();
 	
 	if(inDB < theOverallDBMin) inDB = theOverallDBMin;
 	if(inDB > theOverallDBMax) inDB = theOverallDBMax;
@@ -362,13 +456,13 @@ SInt32	CAVolumeCurve::ConvertDBToRaw(Float32 inDB) const
 	return theAnswer;
 }
 
-Float32	CAVolumeCurve::ConvertRawToDB(SInt32 inRaw) const
+Float32	CAVolumeCurve::CalculateRawToDB(SInt32 inRaw) const
 {
 	Float32 theAnswer = 0;
 	
 	//	clamp the raw value
-	SInt32 theOverallRawMin = GetMinimumRaw();
-	SInt32 theOverallRawMax = GetMaximumRaw();
+	SInt32 theOverallRawMin = CalculateMinimumRaw();
+	SInt32 theOverallRawMax = CalculateMaximumRaw();
 	
 	if(inRaw < theOverallRawMin) inRaw = theOverallRawMin;
 	if(inRaw > theOverallRawMax) inRaw = theOverallRawMax;
@@ -412,14 +506,14 @@ Float32	CAVolumeCurve::ConvertRawToDB(SInt32 inRaw) const
 	return theAnswer;
 }
 
-Float32	CAVolumeCurve::ConvertRawToScalar(SInt32 inRaw) const
+Float32	CAVolumeCurve::CalculateRawToScalar(SInt32 inRaw) const
 {
 	//	get some important values
-	Float32	theDBMin = GetMinimumDB();
-	Float32	theDBMax = GetMaximumDB();
+	Float32	theDBMin = CalculateMinimumDB();
+	Float32	theDBMax = CalculateMaximumDB();
 	Float32	theDBRange = theDBMax - theDBMin;
-	SInt32	theRawMin = GetMinimumRaw();
-	SInt32	theRawMax = GetMaximumRaw();
+	SInt32	theRawMin = CalculateMinimumRaw();
+	SInt32	theRawMax = CalculateMaximumRaw();
 	SInt32	theRawRange = theRawMax - theRawMin;
 	
 	//	range the raw value
@@ -445,17 +539,17 @@ Float32	CAVolumeCurve::ConvertDBToScalar(Float32 inDB) const
 	return theAnswer;
 }
 
-SInt32	CAVolumeCurve::ConvertScalarToRaw(Float32 inScalar) const
+SInt32	CAVolumeCurve::CalculateScalarToRaw(Float32 inScalar) const
 {
 	//	range the scalar value
 	inScalar = std::min(1.0f, std::max(0.0f, inScalar));
 	
 	//	get some important values
-	Float32	theDBMin = GetMinimumDB();
-	Float32	theDBMax = GetMaximumDB();
+	Float32	theDBMin = CalculateMinimumDB();
+	Float32	theDBMax = CalculateMaximumDB();
 	Float32	theDBRange = theDBMax - theDBMin;
-	SInt32	theRawMin = GetMinimumRaw();
-	SInt32	theRawMax = GetMaximumRaw();
+	SInt32	theRawMin = CalculateMinimumRaw();
+	SInt32	theRawMax = CalculateMaximumRaw();
 	SInt32	theRawRange = theRawMax - theRawMin;
 	
 	//	have to undo the curve if the dB range is greater than 30
@@ -480,3 +574,175 @@ Float32	CAVolumeCurve::ConvertScalarToDB(Float32 inScalar) const
 	Float32 theAnswer = ConvertRawToDB(theRawValue);
 	return theAnswer;
 }
+
+//=============================================================================
+//	BGM edit: Lookup Table
+//=============================================================================
+
+//	Maps Float32s to UInt32s with the same order, so we can binary search over the Float32s.
+static UInt32	CAVolumeCurve_FloatToOrderedKey(Float32 inValue)
+{
+	UInt32 theBits;
+	memcpy(&theBits, &inValue, sizeof(theBits));
+	return ((theBits & 0x80000000U) != 0) ? ~theBits : (theBits | 0x80000000U);
+}
+
+static Float32	CAVolumeCurve_OrderedKeyToFloat(UInt32 inKey)
+{
+	UInt32 theBits = ((inKey & 0x80000000U) != 0) ? (inKey & 0x7FFFFFFFU) : ~inKey;
+	Float32 theValue;
+	memcpy(&theValue, &theBits, sizeof(theValue));
+	return theValue;
+}
+
+//	Returns the smallest value in [inLow, inHigh] that inIsAtThreshold returns true for, or infinity
+//	if there isn't one. inIsAtThreshold has to be monotonic.
+template <typename Predicate>
+static Float32	CAVolumeCurve_FindThreshold(Float32 inLow, Float32 inHigh, Predicate inIsAtThreshold)
+{
+	if(inIsAtThreshold(inLow))
+	{
+		return inLow;
+	}
+	
+	if(!inIsAtThreshold(inHigh))
+	{
+		return INFINITY;
+	}
+	
+	UInt32 theLow = CAVolumeCurve_FloatToOrderedKey(inLow);
+	UInt32 theHigh = CAVolumeCurve_FloatToOrderedKey(inHigh);
+	
+	while((theHigh - theLow) > 1)
+	{
+		UInt32 theMiddle = theLow + ((theHigh - theLow) / 2);
+		
+		if(inIsAtThreshold(CAVolumeCurve_OrderedKeyToFloat(theMiddle)))
+		{
+			theHigh = theMiddle;
+		}
+		else
+		{
+			theLow = theMiddle;
+		}
+	}
+	
+	return CAVolumeCurve_OrderedKeyToFloat(theHigh);
+}
+
+void	CAVolumeCurve::RebuildLookupTable()
+{
+	mLookupTable.reset();
+	
+	if(mCurveMap.empty())
+	{
+		return;
+	}
+	
+	SInt32 theRawMin = CalculateMinimumRaw();
+	SInt32 theRawMax = CalculateMaximumRaw();
+	SInt32 theRawRange = theRawMax - theRawMin;
+	
+	if((theRawRange <= 0) || (theRawRange > kMaximumLookupTableRawRange))
+	{
+		return;
+	}
+	
+	std::shared_ptr<LookupTable> theTable = std::make_shared<LookupTable>();
+	
+	theTable->mMinimumRaw = theRawMin;
+	theTable->mMaximumRaw = theRawMax;
+	theTable->mMinimumDB = CalculateMinimumDB();
+	theTable->mMaximumDB = CalculateMaximumDB();
+	
+	//	the forward conversions
+	theTable->mRawToScalar.reserve(static_cast<size_t>(theRawRange) + 1);
+	theTable->mRawToDB.reserve(static_cast<size_t>(theRawRange) + 1);
+	
+	for(SInt32 theRaw = theRawMin; theRaw <= theRawMax; theRaw++)
+	{
+		theTable->mRawToScalar.push_back(CalculateRawToScalar(theRaw));
+		theTable->mRawToDB.push_back(CalculateRawToDB(theRaw));
+	}
+	
+	//	the smallest scalar and dB values that convert to each raw value after the first
+	theTable->mScalarThresholds.reserve(static_cast<size_t>(theRawRange));
+	theTable->mDBThresholds.reserve(static_cast<size_t>(theRawRange));
+	
+	for(SInt32 theRaw = theRawMin + 1; theRaw <= theRawMax; theRaw++)
+	{
+		theTable->mScalarThresholds.push_back(
+				CAVolumeCurve_FindThreshold(0.0f, 1.0f, [&](Float32 inScalar) {
+					return CalculateScalarToRaw(inScalar) >= theRaw;
+				}));
+		theTable->mDBThresholds.push_back(
+				CAVolumeCurve_FindThreshold(theTable->mMinimumDB, theTable->mMaximumDB, [&](Float32 inDB) {
+					return CalculateDBToRaw(inDB) >= theRaw;
+				}));
+	}
+	
+	//	a few buckets per raw value keeps the number of thresholds in each bucket small
+	theTable->mNumberBuckets = std::max(1024U, 4U * static_cast<UInt32>(theRawRange));
+	theTable->mScalarBucketsPerUnit = static_cast<Float32>(theTable->mNumberBuckets);
+	Float32 theDBRange = theTable->mMaximumDB - theTable->mMinimumDB;
+	theTable->mDBBucketsPerUnit = (theDBRange > 0.0f) ? (static_cast<Float32>(theTable->mNumberBuckets) / theDBRange) : 0.0f;
+	
+	//	the number of thresholds before each bucket
+	theTable->mScalarBuckets.resize(theTable->mNumberBuckets);
+	theTable->mDBBuckets.resize(theTable->mNumberBuckets);
+	
+	UInt32 theNumberScalarThresholds = 0;
+	UInt32 theNumberDBThresholds = 0;
+	
+	for(UInt32 theBucket = 0; theBucket < theTable->mNumberBuckets; theBucket++)
+	{
+		while((theNumberScalarThresholds < theTable->mScalarThresholds.size()) &&
+			  (GetBucket(theTable->mScalarThresholds[theNumberScalarThresholds], 0.0f, theTable->mScalarBucketsPerUnit, theTable->mNumberBuckets) < theBucket))
+		{
+			theNumberScalarThresholds++;
+		}
+		
+		while((theNumberDBThresholds < theTable->mDBThresholds.size()) &&
+			  (GetBucket(theTable->mDBThresholds[theNumberDBThresholds], theTable->mMinimumDB, theTable->mDBBucketsPerUnit, theTable->mNumberBuckets) < theBucket))
+		{
+			theNumberDBThresholds++;
+		}
+		
+		theTable->mScalarBuckets[theBucket] = theNumberScalarThresholds;
+		theTable->mDBBuckets[theBucket] = theNumberDBThresholds;
+	}
+	
+	mLookupTable = theTable;
+}
+
+UInt32	CAVolumeCurve::GetBucket(Float32 inValue, Float32 inMinimum, Float32 inBucketsPerUnit, UInt32 inNumberBuckets)
+{
+	//	this has to be monotonic so a threshold can't be in an earlier bucket than a smaller value
+	Float32 thePosition = (inValue - inMinimum) * inBucketsPerUnit;
+	
+	if(!(thePosition < static_cast<Float32>(inNumberBuckets - 1)))
+	{
+		return inNumberBuckets - 1;
+	}
+	
+	if(!(thePosition > 0.0f))
+	{
+		return 0;
+	}
+	
+	return static_cast<UInt32>(thePosition);
+}
+
+SInt32	CAVolumeCurve::LookUpThreshold(Float32 inValue, SInt32 inMinimumRaw, const std::vector<Float32>& inThresholds, const std::vector<UInt32>& inBuckets, UInt32 inBucket)
+{
+	//	every threshold in an earlier bucket is smaller than the value, so we only have to check the
+	//	ones from this bucket on
+	UInt32 theNumberThresholds = inBuckets[inBucket];
+	
+	while((theNumberThresholds < inThresholds.size()) && (inValue >= inThresholds[theNumberThresholds]))
+	{
+		theNumberThresholds++;
+	}
+	
+	return inMinimumRaw + static_cast<SInt32>(theNumberThresholds);
+}
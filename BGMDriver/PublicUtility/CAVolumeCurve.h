@@ -57,6 +57,9 @@
 	#include <CoreAudioTypes.h>
 #endif
 #include <map>
+// BGM edit: Added for the lookup tables.
+#include <memory>
+#include <vector>
 
 //=============================================================================
 //	Types
@@ -145,7 +148,8 @@ public:
 	Float32			GetMinimumDB() const;
 	Float32			GetMaximumDB() const;
 	
-	void			SetIsApplyingTransferFunction(bool inIsApplyingTransferFunction)  { mIsApplyingTransferFunction = inIsApplyingTransferFunction; }
+	// BGM edit: Moved to the .cpp file because it has to rebuild the lookup tables.
+	void			SetIsApplyingTransferFunction(bool inIsApplyingTransferFunction);
 	UInt32			GetTransferFunction() const { return mTransferFunction; }
 	void			SetTransferFunction(UInt32 inTransferFunction);
 
@@ -166,12 +170,71 @@ public:
 private:
 	typedef	std::map<CARawPoint, CADBPoint>	CurveMap;
 	
+	// BGM edit: The conversions below walk the curve map and call powf, so the public functions
+	// look their answers up in a table instead. The table is built from these functions whenever
+	// the curve changes, so the answers are the same.
+	SInt32			CalculateMinimumRaw() const;
+	SInt32			CalculateMaximumRaw() const;
+	Float32			CalculateMinimumDB() const;
+	Float32			CalculateMaximumDB() const;
+	SInt32			CalculateDBToRaw(Float32 inDB) const;
+	Float32			CalculateRawToDB(SInt32 inRaw) const;
+	Float32			CalculateRawToScalar(SInt32 inRaw) const;
+	SInt32			CalculateScalarToRaw(Float32 inScalar) const;
+	
+	// BGM edit: The lookup tables, a "compiled" version of the curve.
+	//
+	// The raw to dB and raw to scalar tables have an entry for each raw value. The conversions in
+	// the other direction are step functions, so for them we store the smallest dB/scalar value
+	// that converts to each raw value (except the minimum raw value). To avoid searching those
+	// thresholds, we split the dB/scalar range into equal-sized buckets and store the number of
+	// thresholds before each bucket. Converting a value then only has to check the few thresholds
+	// in its bucket.
+	//
+	// The tables are immutable once built, so copies of the curve share them.
+	struct LookupTable
+	{
+		SInt32					mMinimumRaw;
+		SInt32					mMaximumRaw;
+		Float32					mMinimumDB;
+		Float32					mMaximumDB;
+		
+		std::vector<Float32>	mRawToScalar;
+		std::vector<Float32>	mRawToDB;
+		
+		UInt32					mNumberBuckets;
+		
+		std::vector<Float32>	mScalarThresholds;
+		Float32					mScalarBucketsPerUnit;
+		std::vector<UInt32>		mScalarBuckets;
+		
+		std::vector<Float32>	mDBThresholds;
+		Float32					mDBBucketsPerUnit;
+		std::vector<UInt32>		mDBBuckets;
+	};
+	
+	// The raw range above which we don't bother with a table. (BGMDriver's curves are much smaller.)
+	static const SInt32		kMaximumLookupTableRawRange = 1 << 16;
+	
+	void			RebuildLookupTable();
+	static UInt32	GetBucket(Float32 inValue,
+							  Float32 inMinimum,
+							  Float32 inBucketsPerUnit,
+							  UInt32 inNumberBuckets);
+	static SInt32	LookUpThreshold(Float32 inValue,
+									SInt32 inMinimumRaw,
+									const std::vector<Float32>& inThresholds,
+									const std::vector<UInt32>& inBuckets,
+									UInt32 inBucket);
+	
 	UInt32			mTag;
 	CurveMap		mCurveMap;
 	bool			mIsApplyingTransferFunction;
 	UInt32			mTransferFunction;
 	Float32			mRawToScalarExponentNumerator;
 	Float32			mRawToScalarExponentDenominator;
+	// BGM edit: Null if the curve is empty or its raw range is too large.
+	std::shared_ptr<const LookupTable>	mLookupTable;
 
 };
 
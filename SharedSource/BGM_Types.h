@@ -74,6 +74,8 @@ enum
     kObjectID_Stream_Input_UI_Sounds            = 10,  // Belongs to kObjectID_Device_UI_Sounds
     kObjectID_Stream_Output_UI_Sounds           = 11,  // Belongs to kObjectID_Device_UI_Sounds
     kObjectID_Volume_Output_Master_UI_Sounds    = 12,  // Belongs to kObjectID_Device_UI_Sounds
+    // BGMDevice's system-wide volume boost. Global scope, so it isn't mistaken for the output volume.
+    kObjectID_Volume_Boost                      = 13,  // Belongs to kObjectID_Device
 };
 
 // AudioObjectPropertyElement docs: "Elements are numbered sequentially where 0 represents the
@@ -121,7 +123,35 @@ enum
     kAudioDeviceCustomPropertyAppVolumes                              = 'apvs',
     // A CFArray of CFBooleans indicating which of BGMDevice's controls are enabled. All controls are enabled
     // by default. This property is settable. See the array indices below for more info.
-    kAudioDeviceCustomPropertyEnabledOutputControls                   = 'bgct'
+    kAudioDeviceCustomPropertyEnabledOutputControls                   = 'bgct',
+    // A CFData containing a BGMDeviceIOStats struct (see below) with timing statistics for the device's IO
+    // operations since the driver was loaded, and the size of its store of past clients' settings. Not settable. The device only has this property if BGMDriver was
+    // built with BGM_IOStatsEnabled, which it is by default.
+    kAudioDeviceCustomPropertyIOStats                                 = 'iost',
+    // A CFDictionary with the settings for ducking the music player, i.e. turning it down while other audio
+    // is playing. See the dictionary keys below. Settable. Keys left out when setting this property keep
+    // their current values.
+    kAudioDeviceCustomPropertyMusicDucking                            = 'mdck',
+    // A CFDictionary with the settings for the soft limiters that can replace the hard clipping of boosted
+    // clients and of the mix. See the dictionary keys below. Settable. Keys left out when setting this property
+    // keep their current values. The amount the limiters turn the audio down is in
+    // kAudioDeviceCustomPropertyIOStats.
+    kAudioDeviceCustomPropertyLimiter                                 = 'lmtr',
+    // A CFArray of CFDictionaries that each contain an app's pid and/or bundle ID and the settings for the EQ
+    // and compressor applied to its audio, after its relative volume. See the dictionary keys below. Setting
+    // this property adds or replaces the settings for the apps in the array. An app with no EQ bands and no
+    // compressor is removed. Getting it returns every app with settings. At most kBGMAppDSPMaxApps apps can
+    // have settings at a time.
+    kAudioDeviceCustomPropertyAppDSP                                  = 'adsp',
+    // A CFData that sets apps' relative volumes and pan positions in the same way as
+    // kAudioDeviceCustomPropertyAppVolumes, but in a packed binary format that's cheaper to build and parse. See
+    // the layout below. Setting it fails, without changing anything, if the data is invalid. Getting it returns
+    // a header with no records, so clients can check which session's bundle IDs the device has.
+    kAudioDeviceCustomPropertyAppVolumesPacked                        = 'apvp',
+    // A CFNumber with the number of frames the device takes to ramp the audio to a new app volume, output
+    // volume or boost, so the changes don't click. Settable. 0 changes the volumes at the start of the next IO
+    // buffer. Values over kBGMVolumeRampMaxLengthFrames are clamped. Defaults to kBGMVolumeRampDefaultLengthFrames.
+    kAudioDeviceCustomPropertyVolumeRampLength                        = 'vrmp'
 };
 
 // The number of silent/audible frames before BGMDriver will change kAudioDeviceCustomPropertyDeviceAudibleState
@@ -160,6 +190,17 @@ enum BGMDeviceAudibleState : SInt32
 #define kAppRelativeVolumeMinDbValue    -96.0f
 #define kAppRelativeVolumeMaxDbValue	0.0f
 
+// Volume curve range for the system-wide boost control (kObjectID_Volume_Boost). Quarter-dB steps.
+#define kBoostMinRawValue   0
+#define kBoostMaxRawValue   48
+#define kBoostMinDbValue    0.0f
+#define kBoostMaxDbValue    12.0f
+
+// kAudioDeviceCustomPropertyVolumeRampLength values, in frames. The default is about 10 ms at 48 kHz and the
+// maximum about a second.
+#define kBGMVolumeRampDefaultLengthFrames   512
+#define kBGMVolumeRampMaxLengthFrames       48000
+
 // Pan position values
 #define kAppPanLeftRawValue   -100
 #define kAppPanCenterRawValue 0
@@ -175,6 +216,220 @@ enum
     kBGMEnabledOutputControlsIndex_Mute   = 1
 };
 
+// kAudioDeviceCustomPropertyMusicDucking keys
+//
+// A CFBoolean. True to duck the music player. False by default.
+#define kBGMMusicDuckingKey_Enabled         "enab"
+// A CFNumber<Float32>. How far to turn the music player down while other audio is playing, in dB. Between
+// -96.0 and 0.0.
+#define kBGMMusicDuckingKey_DepthDb         "dpth"
+// CFNumber<Float32>s, in milliseconds. The time to turn the music player down once other audio starts, the
+// time to wait after the other audio stops and the time to turn the music player back up. Between 0.0 and
+// 10000.0.
+#define kBGMMusicDuckingKey_AttackMs        "atck"
+#define kBGMMusicDuckingKey_HoldMs          "hold"
+#define kBGMMusicDuckingKey_ReleaseMs       "rels"
+
+// kAudioDeviceCustomPropertyLimiter keys
+//
+// CFBooleans. True to limit each client's audio after its app volume is applied, and to limit the mix of all the
+// clients. Both false by default. Limiting adds about 1.3 ms (64 frames) of latency.
+#define kBGMLimiterKey_ClientsEnabled       "clim"
+#define kBGMLimiterKey_MixEnabled           "mlim"
+// A CFNumber<Float32>. The level the limiters keep the peaks under, in dBFS. Between -24.0 and 0.0.
+#define kBGMLimiterKey_ThresholdDb          "thrs"
+// A CFNumber<Float32>. The width of the soft knee around the threshold, in dB. Between 0.0 and 12.0.
+#define kBGMLimiterKey_KneeDb               "knee"
+// A CFNumber<Float32>. The time to recover from a peak, in milliseconds. Between 0.0 and 5000.0.
+#define kBGMLimiterKey_ReleaseMs            "rels"
+
+// kAudioDeviceCustomPropertyAppDSP keys
+//
+// The app is identified by kBGMAppVolumesKey_ProcessID and/or kBGMAppVolumesKey_BundleID, as in
+// kAudioDeviceCustomPropertyAppVolumes.
+//
+// A CFArray of up to kBGMAppDSPMaxBands CFDictionaries, one for each EQ band. The bands are applied in order.
+#define kBGMAppDSPKey_EQBands               "eqbd"
+// A CFDictionary with the compressor's settings. Leave it out to disable the compressor.
+#define kBGMAppDSPKey_Compressor            "comp"
+
+// EQ band keys
+//
+// A CFNumber<SInt32>. One of the kBGMAppDSPBandType values.
+#define kBGMAppDSPBandKey_Type              "type"
+// A CFNumber<Float32>. The band's cutoff or centre frequency, in Hz. Between 10.0 and 20000.0.
+#define kBGMAppDSPBandKey_FrequencyHz       "freq"
+// A CFNumber<Float32>. The band's gain in dB, for the shelf and peak bands. Between -24.0 and 24.0.
+#define kBGMAppDSPBandKey_GainDb            "gain"
+// A CFNumber<Float32>. The band's Q. Between 0.1 and 18.0. Defaults to 0.7071.
+#define kBGMAppDSPBandKey_Q                 "q"
+
+// Compressor keys
+//
+// A CFNumber<Float32>. The level the compressor starts turning the audio down at, in dBFS. Between -60.0 and
+// 0.0.
+#define kBGMAppDSPCompressorKey_ThresholdDb "thrs"
+// A CFNumber<Float32>. The compression ratio. Between 1.0 and 20.0.
+#define kBGMAppDSPCompressorKey_Ratio       "rato"
+// A CFNumber<Float32>. The width of the soft knee around the threshold, in dB. Between 0.0 and 24.0.
+#define kBGMAppDSPCompressorKey_KneeDb      "knee"
+// CFNumber<Float32>s, in milliseconds. Between 0.0 and 5000.0.
+#define kBGMAppDSPCompressorKey_AttackMs    "atck"
+#define kBGMAppDSPCompressorKey_ReleaseMs   "rels"
+// A CFNumber<Float32>. The gain applied after the compressor, in dB. Between 0.0 and 24.0.
+#define kBGMAppDSPCompressorKey_MakeupDb    "mkup"
+
+#define kBGMAppDSPMaxApps                   32
+#define kBGMAppDSPMaxBands                  8
+
+enum BGMAppDSPBandType : SInt32
+{
+    // Second-order high-pass and low-pass filters. The gain is ignored.
+    kBGMAppDSPBandType_LowCut               = 0,
+    kBGMAppDSPBandType_HighCut              = 1,
+    kBGMAppDSPBandType_LowShelf             = 2,
+    kBGMAppDSPBandType_HighShelf            = 3,
+    kBGMAppDSPBandType_Peak                 = 4
+};
+
+// kAudioDeviceCustomPropertyIOStats layout
+//
+// The version of the layout. Incremented whenever the layout changes.
+#define kBGMIOStatsVersion 3
+// The number of buckets in each histogram. Bucket i counts the durations, in nanoseconds, from 2^i up to but not
+// including 2^(i+1). Bucket 0 also counts durations of 0 ns and the last bucket also counts anything longer.
+#define kBGMIOStatsBucketCount 32
+
+// The indices of BGMDeviceIOStats::mOperations.
+enum
+{
+    kBGMIOStatsOperation_ReadInput        = 0,
+    // Timed separately for each client, so there are usually several per IO cycle.
+    kBGMIOStatsOperation_ProcessOutput    = 1,
+    kBGMIOStatsOperation_ProcessMix       = 2,
+    kBGMIOStatsOperation_WriteMix         = 3,
+    kBGMIOStatsOperation_GetZeroTimeStamp = 4,
+    // The total time spent in the IO operations above (not including GetZeroTimeStamp) for each IO cycle.
+    kBGMIOStatsOperation_Cycle            = 5,
+    kBGMIOStatsOperationCount             = 6
+};
+
+// The indices of BGMDeviceIOStats::mLimiters. See kAudioDeviceCustomPropertyLimiter.
+enum
+{
+    // All of the clients' limiters together.
+    kBGMIOStatsLimiter_Clients            = 0,
+    kBGMIOStatsLimiter_Mix                = 1,
+    kBGMIOStatsLimiterCount               = 2
+};
+
+typedef struct
+{
+    UInt64 mCount;
+    UInt64 mTotalNs;
+    UInt64 mMaxNs;
+    UInt64 mHistogram[kBGMIOStatsBucketCount];
+} BGMDeviceIOStatsOperation;
+
+typedef struct
+{
+    // The frames the limiter processed and how many of them it turned down.
+    UInt64 mFrameCount;
+    UInt64 mLimitedFrameCount;
+    // The most it has turned any frame down by, in dB.
+    Float32 mMaxGainReductionDb;
+    // The most it turned a frame down by in the latest IO buffer, in dB. For the clients, this is the latest
+    // client's buffer.
+    Float32 mLatestGainReductionDb;
+} BGMDeviceIOStatsLimiter;
+
+// The driver's store of past clients' settings, which it restores when an app's client is added again.
+typedef struct
+{
+    // The number of bundle IDs it has settings for and the most it can hold.
+    UInt32 mCount;
+    UInt32 mCapacity;
+    // The number of bundle IDs whose settings have been dropped to make room for others.
+    UInt64 mEvictions;
+} BGMDeviceIOStatsPastClients;
+
+typedef struct
+{
+    UInt32 mVersion;         // kBGMIOStatsVersion
+    UInt32 mOperationCount;  // kBGMIOStatsOperationCount
+    UInt32 mBucketCount;     // kBGMIOStatsBucketCount
+    UInt32 mReserved;
+    // The number of IO cycles that took longer than the duration of their IO buffer. The device would have
+    // missed its deadline for at least those cycles, though it can also miss it in shorter cycles.
+    UInt64 mDeadlineMisses;
+    // IO operations that weren't recorded because more threads were doing IO than the driver had room to
+    // keep statistics for.
+    UInt64 mUnrecordedOperations;
+    BGMDeviceIOStatsOperation mOperations[kBGMIOStatsOperationCount];
+    // Added in version 2.
+    BGMDeviceIOStatsLimiter mLimiters[kBGMIOStatsLimiterCount];
+    // Added in version 3.
+    BGMDeviceIOStatsPastClients mPastClients;
+} BGMDeviceIOStats;
+
+// kAudioDeviceCustomPropertyAppVolumesPacked layout
+//
+// A BGMAppVolumesPackedHeader, then mRecordCount BGMAppVolumesPackedRecords, then mBundleIDCount bundle ID
+// definitions. Each definition is a BGMAppVolumesPackedBundleID followed by mLength bytes of UTF-8, without a
+// terminator or padding. The numbers are in native byte order because the data never leaves the machine.
+//
+// Records refer to bundle IDs by token so they don't have to be sent with every change. A token only needs to be
+// defined once, in any message before or including the first one that uses it, and the device keeps its
+// definitions until it's sent a different mSessionID. Each instance of BGMDevice has its own definitions. If a
+// record uses a token the device doesn't have, e.g. because coreaudiod has restarted since it was defined, setting
+// the property fails with kAudioHardwareIllegalOperationError and the client should send the definitions again.
+//
+// The version of the layout. Incremented whenever the layout changes.
+#define kBGMAppVolumesPackedVersion 1
+#define kBGMAppVolumesPackedMaxRecords 1024
+// Tokens must be less than this.
+#define kBGMAppVolumesPackedMaxTokens 1024
+// Bundle IDs can't be longer than this many bytes.
+#define kBGMAppVolumesPackedMaxBundleIDLength 255
+// The value of BGMAppVolumesPackedRecord::mBundleIDToken for records that only have a pid.
+#define kBGMAppVolumesPackedNoBundleID 0xFFFFFFFF
+
+// The bits of BGMAppVolumesPackedRecord::mFields.
+enum
+{
+    kBGMAppVolumesPackedField_RelativeVolume = 1 << 0,
+    kBGMAppVolumesPackedField_PanPosition    = 1 << 1
+};
+
+typedef struct {
+    UInt32 mVersion;         // kBGMAppVolumesPackedVersion
+    // Chosen by the client, e.g. randomly when it launches. The device forgets its bundle ID tokens when this
+    // changes.
+    UInt32 mSessionID;
+    UInt32 mRecordCount;
+    UInt32 mBundleIDCount;
+} BGMAppVolumesPackedHeader;
+
+typedef struct {
+    // -1 if the app is only identified by its bundle ID.
+    SInt32 mProcessID;
+    // A token defined in this message or an earlier one, or kBGMAppVolumesPackedNoBundleID.
+    UInt32 mBundleIDToken;
+    // Which of the values below to set. Must be nonzero.
+    UInt32 mFields;
+    // As in kBGMAppVolumesKey_RelativeVolume.
+    SInt32 mRelativeVolume;
+    // As in kBGMAppVolumesKey_PanPosition.
+    SInt32 mPanPosition;
+    // Reserved. Must be 0.
+    UInt32 mFlags;
+} BGMAppVolumesPackedRecord;
+
+typedef struct {
+    UInt32 mToken;
+    UInt32 mLength;
+} BGMAppVolumesPackedBundleID;
+
 #pragma mark BGMDevice Custom Property Addresses
 
 // For convenience.
@@ -215,6 +470,42 @@ static const AudioObjectPropertyAddress kBGMEnabledOutputControlsAddress = {
     kAudioObjectPropertyElementMaster
 };
 
+static const AudioObjectPropertyAddress kBGMIOStatsAddress = {
+    kAudioDeviceCustomPropertyIOStats,
+    kAudioObjectPropertyScopeGlobal,
+    kAudioObjectPropertyElementMaster
+};
+
+static const AudioObjectPropertyAddress kBGMMusicDuckingAddress = {
+    kAudioDeviceCustomPropertyMusicDucking,
+    kAudioObjectPropertyScopeGlobal,
+    kAudioObjectPropertyElementMaster
+};
+
+static const AudioObjectPropertyAddress kBGMLimiterAddress = {
+    kAudioDeviceCustomPropertyLimiter,
+    kAudioObjectPropertyScopeGlobal,
+    kAudioObjectPropertyElementMaster
+};
+
+static const AudioObjectPropertyAddress kBGMAppDSPAddress = {
+    kAudioDeviceCustomPropertyAppDSP,
+    kAudioObjectPropertyScopeGlobal,
+    kAudioObjectPropertyElementMaster
+};
+
+static const AudioObjectPropertyAddress kBGMAppVolumesPackedAddress = {
+    kAudioDeviceCustomPropertyAppVolumesPacked,
+    kAudioObjectPropertyScopeGlobal,
+    kAudioObjectPropertyElementMaster
+};
+
+static const AudioObjectPropertyAddress kBGMVolumeRampLengthAddress = {
+    kAudioDeviceCustomPropertyVolumeRampLength,
+    kAudioObjectPropertyScopeGlobal,
+    kAudioObjectPropertyElementMaster
+};
+
 #pragma mark XPC Return Codes
 
 enum {
@@ -28,12 +28,16 @@
 
 // System Includes
 #include <MacTypes.h>
+#if defined(__APPLE__)
 #include <mach/mach_error.h>
 #include <CoreFoundation/CoreFoundation.h>  // For kCFCoreFoundationVersionNumber
+#endif
 
 
 #pragma clang assume_nonnull begin
 
+#if defined(__APPLE__)
+
 dispatch_queue_t BGMGetDispatchQueue_PriorityUserInteractive()
 {
     long queueClass;
@@ -58,6 +62,8 @@ dispatch_queue_t BGMGetDispatchQueue_PriorityUserInteractive()
     return dispatch_get_global_queue(queueClass, 0);
 }
 
+#endif /* defined(__APPLE__) */
+
 namespace BGM_Utils
 {
     // Forward declarations
@@ -70,6 +76,8 @@ namespace BGM_Utils
 
 #pragma mark Exception utils
     
+#if defined(__APPLE__)
+    
     bool LogIfMachError(const char* callerName,
                         const char* errorReturnedBy,
                         mach_error_t error)
@@ -98,6 +106,8 @@ namespace BGM_Utils
         }
     }
     
+#endif /* defined(__APPLE__) */
+    
     OSStatus LogAndSwallowExceptions(const char* __nullable fileName,
                                      int lineNumber,
                                      const char* callerName,
@@ -36,8 +36,10 @@
 #endif /* defined(__cplusplus) */
 
 // System Includes
+#if defined(__APPLE__)
 #include <mach/error.h>
 #include <dispatch/dispatch.h>
+#endif
 
 #pragma mark Macros
 
@@ -144,7 +146,9 @@
 
 #pragma mark C Utility Functions
 
+#if defined(__APPLE__)
 dispatch_queue_t BGMGetDispatchQueue_PriorityUserInteractive(void);
+#endif
 
 #if defined(__cplusplus)
 
@@ -155,11 +159,12 @@ namespace BGM_Utils
     // Used to explicitly cast from nullable to non-null. For Objective-C objects, use the BGMNN
     // macro (above).
     template <typename T>
-    inline T __nonnull NN(T __nullable v) {
+    inline T _Nonnull NN(T _Nullable v) {
         BGMAssertNonNull(v);
-        return static_cast<T __nonnull>(v);
+        return static_cast<T _Nonnull>(v);
     }
     
+#if defined(__APPLE__)
     // Log (and swallow) errors returned by Mach functions. Returns false if there was an error.
     bool LogIfMachError(const char* callerName,
                         const char* errorReturnedBy,
@@ -170,6 +175,7 @@ namespace BGM_Utils
     void ThrowIfMachError(const char* callerName,
                           const char* errorReturnedBy,
                           mach_error_t error);
+#endif
     
     // If function throws an exception, log an error and continue.
     //